@@ -3,7 +3,7 @@
  *
  * Yori execute scripts based on current directory to update environment
  *
- * Copyright (c) 2019 Malcolm J. Smith
+ * Copyright (c) 2019-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -41,7 +41,12 @@ CHAR strDirenvHelpText[] =
         "\n"
         "   -a             Apply changes based on the current directory\n"
         "   -i             Install directory change monitor\n"
-        "   -u             Uninstall directory change monitor\n";
+        "   -u             Uninstall directory change monitor\n"
+        "\n"
+        "The environment and alias changes made by each script are remembered, and are\n"
+        " reapplied without executing the script when the directory is revisited,\n"
+        " provided the script has not been modified and the variables and aliases it\n"
+        " changes still have the values they had when it was executed.\n";
 
 /**
  Display usage text to the user.
@@ -107,6 +112,192 @@ BOOLEAN DirenvInstalled;
  */
 BOOLEAN DirenvApplyInvoked;
 
+/**
+ A single change made to an environment variable or alias by a script.
+ */
+typedef struct _DIRENV_CHANGE {
+
+    /**
+     The name of the variable or alias.  This string is NULL terminated.
+     */
+    YORI_STRING Name;
+
+    /**
+     The value of the variable or alias before the script was executed.
+     This string is NULL terminated, and is empty if it was not defined.
+     */
+    YORI_STRING OldValue;
+
+    /**
+     The value of the variable or alias after the script was executed.  This
+     string is NULL terminated.  It is only meaningful if HasNewValue is
+     TRUE.
+     */
+    YORI_STRING NewValue;
+
+    /**
+     TRUE if the variable or alias was defined after the script was
+     executed, FALSE if the script deleted it.
+     */
+    BOOLEAN HasNewValue;
+
+    /**
+     TRUE if the change is to an alias, FALSE if it is to an environment
+     variable.
+     */
+    BOOLEAN IsAlias;
+} DIRENV_CHANGE, *PDIRENV_CHANGE;
+
+/**
+ A record of the environment and alias changes made by executing a script
+ expression, so that the changes can be reapplied without executing the
+ script again.
+ The entry, its array of changes, and the text of all strings are a single
+ allocation.
+ */
+typedef struct _DIRENV_CACHE_ENTRY {
+
+    /**
+     The links of this entry within the list of cached scripts.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The expression that was executed, consisting of the script path and
+     any arguments.
+     */
+    YORI_STRING Expression;
+
+    /**
+     The last write time of the script when it was executed.
+     */
+    FILETIME LastWriteTime;
+
+    /**
+     The size of the script when it was executed.
+     */
+    LARGE_INTEGER FileSize;
+
+    /**
+     The number of elements in the Changes array.
+     */
+    DWORD ChangeCount;
+
+    /**
+     An array of changes made by the script.
+     */
+    PDIRENV_CHANGE Changes;
+} DIRENV_CACHE_ENTRY, *PDIRENV_CACHE_ENTRY;
+
+/**
+ The list of scripts whose environment changes have been recorded.
+ */
+YORI_LIST_ENTRY DirenvCache;
+
+/**
+ An entry describing a variable or alias while comparing two blocks of
+ NAME=value strings.
+ */
+typedef struct _DIRENV_ENV_VAR {
+
+    /**
+     The hash table entry for this variable, keyed by the variable name.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The name of the variable.
+     */
+    YORI_STRING Name;
+
+    /**
+     The value of the variable.
+     */
+    YORI_STRING Value;
+
+    /**
+     TRUE if the variable is also present in the other environment block.
+     */
+    BOOLEAN Matched;
+} DIRENV_ENV_VAR, *PDIRENV_ENV_VAR;
+
+/**
+ The differences between two blocks of NAME=value strings.
+ */
+typedef struct _DIRENV_BLOCK_DIFF {
+
+    /**
+     An array of entries.  The first BeforeCount entries describe the
+     previous block, and the following AfterCount entries describe entries
+     in the new block that are new or changed.
+     */
+    PDIRENV_ENV_VAR Vars;
+
+    /**
+     A hash table of entries in the previous block, keyed by name.
+     */
+    PYORI_HASH_TABLE VarTable;
+
+    /**
+     The number of entries in the previous block.
+     */
+    DWORD BeforeCount;
+
+    /**
+     The number of entries in the new block that are new or changed.
+     */
+    DWORD AfterCount;
+
+    /**
+     The number of changes needed to describe the differences.
+     */
+    DWORD ChangeCount;
+
+    /**
+     The number of characters needed to record the differences.
+     */
+    DWORD CharsNeeded;
+} DIRENV_BLOCK_DIFF, *PDIRENV_BLOCK_DIFF;
+
+/**
+ The state that a script can change and which is recorded so that the
+ script does not need to be executed again.
+ */
+typedef struct _DIRENV_STATE {
+
+    /**
+     The environment block.
+     */
+    YORI_STRING Environment;
+
+    /**
+     The aliases, in the same form as the environment block.
+     */
+    YORI_STRING Aliases;
+} DIRENV_STATE, *PDIRENV_STATE;
+
+/**
+ Free all cached script results.
+ */
+VOID
+DirenvFreeCache(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PDIRENV_CACHE_ENTRY CacheEntry;
+
+    if (DirenvCache.Next == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&DirenvCache, NULL);
+    while (ListEntry != NULL) {
+        CacheEntry = CONTAINING_RECORD(ListEntry, DIRENV_CACHE_ENTRY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&DirenvCache, ListEntry);
+        YoriLibRemoveListItem(&CacheEntry->ListEntry);
+        YoriLibFree(CacheEntry);
+    }
+}
+
 /**
  Notification that the module is being unloaded or the shell is exiting,
  used to indicate any pending state should be cleaned up.
@@ -117,6 +308,573 @@ DirenvNotifyUnload(VOID)
 {
     YoriLibFreeStringContents(&DirenvPreviousExecutedScript);
     YoriLibFreeStringContents(&DirenvPreviousCurrentDirectory);
+    DirenvFreeCache();
+}
+
+/**
+ Split an environment string in NAME=value form into its components.
+ Entries that describe per-drive current directories are not considered
+ variables.
+
+ @param Entry Pointer to the NULL terminated environment string.
+
+ @param Var On successful completion, updated with the name and value.
+
+ @return TRUE if the string describes a variable, FALSE if it should be
+         ignored.
+ */
+BOOLEAN
+DirenvParseEnvironmentEntry(
+    __in LPTSTR Entry,
+    __out PDIRENV_ENV_VAR Var
+    )
+{
+    LPTSTR Equals;
+
+    if (Entry[0] == '=') {
+        return FALSE;
+    }
+
+    Equals = _tcschr(Entry, '=');
+    if (Equals == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&Var->Name);
+    Var->Name.StartOfString = Entry;
+    Var->Name.LengthInChars = (DWORD)(Equals - Entry);
+    YoriLibConstantString(&Var->Value, Equals + 1);
+    Var->Matched = FALSE;
+    return TRUE;
+}
+
+/**
+ Copy a string into a buffer and NULL terminate it, and update a Yori string
+ to refer to the copy.
+
+ @param Dest Pointer to the string to update.
+
+ @param Source Pointer to the string to copy.  This may be NULL to indicate
+        an empty string.
+
+ @param Buffer Pointer to the buffer location to copy into.  On completion,
+        updated to point after the NULL terminator.
+ */
+VOID
+DirenvCopyString(
+    __out PYORI_STRING Dest,
+    __in_opt PYORI_STRING Source,
+    __inout LPTSTR *Buffer
+    )
+{
+    YoriLibInitEmptyString(Dest);
+    Dest->StartOfString = *Buffer;
+    if (Source != NULL) {
+        memcpy(Dest->StartOfString, Source->StartOfString, Source->LengthInChars * sizeof(TCHAR));
+        Dest->LengthInChars = Source->LengthInChars;
+    }
+    Dest->StartOfString[Dest->LengthInChars] = '\0';
+    Dest->LengthAllocated = Dest->LengthInChars + 1;
+    *Buffer = *Buffer + Dest->LengthAllocated;
+}
+
+/**
+ Compare two blocks of NAME=value strings, such as the environment or the
+ set of aliases before and after executing a script, and determine the space
+ needed to record the differences.
+
+ @param Before Pointer to the block before the script was executed.
+
+ @param After Pointer to the block after the script was executed.
+
+ @param Diff On successful completion, populated with the differences.  The
+        caller should free this with @ref DirenvFreeBlockDiff .
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+DirenvDiffBlocks(
+    __in PYORI_STRING Before,
+    __in PYORI_STRING After,
+    __out PDIRENV_BLOCK_DIFF Diff
+    )
+{
+    PDIRENV_ENV_VAR Var;
+    PDIRENV_ENV_VAR OldVar;
+    PYORI_HASH_ENTRY HashEntry;
+    LPTSTR ThisVar;
+    DWORD BeforeCount;
+    DWORD AfterCount;
+    DWORD Index;
+
+    //
+    //  Count the entries in each block.  Entries from the previous block
+    //  are at the front of the array, entries from the new block follow.
+    //
+
+    BeforeCount = 0;
+    for (ThisVar = Before->StartOfString; *ThisVar != '\0'; ThisVar += _tcslen(ThisVar) + 1) {
+        BeforeCount++;
+    }
+
+    AfterCount = 0;
+    for (ThisVar = After->StartOfString; *ThisVar != '\0'; ThisVar += _tcslen(ThisVar) + 1) {
+        AfterCount++;
+    }
+
+    Diff->Vars = YoriLibMalloc((BeforeCount + AfterCount + 1) * sizeof(DIRENV_ENV_VAR));
+    if (Diff->Vars == NULL) {
+        return FALSE;
+    }
+
+    Diff->VarTable = YoriLibAllocateHashTable(BeforeCount / 2 + 31);
+    if (Diff->VarTable == NULL) {
+        YoriLibFree(Diff->Vars);
+        return FALSE;
+    }
+
+    BeforeCount = 0;
+    for (ThisVar = Before->StartOfString; *ThisVar != '\0'; ThisVar += _tcslen(ThisVar) + 1) {
+        Var = &Diff->Vars[BeforeCount];
+        if (DirenvParseEnvironmentEntry(ThisVar, Var) &&
+            YoriLibHashLookupByKey(Diff->VarTable, &Var->Name) == NULL) {
+
+            YoriLibHashInsertByKey(Diff->VarTable, &Var->Name, Var, &Var->HashEntry);
+            BeforeCount++;
+        }
+    }
+
+    //
+    //  Find entries that are new or changed, and determine the space
+    //  needed to record them.  Entries in the After portion of the array
+    //  that are unchanged are not retained.
+    //
+
+    Diff->ChangeCount = 0;
+    Diff->CharsNeeded = 0;
+    AfterCount = 0;
+    for (ThisVar = After->StartOfString; *ThisVar != '\0'; ThisVar += _tcslen(ThisVar) + 1) {
+        Var = &Diff->Vars[BeforeCount + AfterCount];
+        if (!DirenvParseEnvironmentEntry(ThisVar, Var)) {
+            continue;
+        }
+
+        HashEntry = YoriLibHashLookupByKey(Diff->VarTable, &Var->Name);
+        if (HashEntry != NULL) {
+            OldVar = HashEntry->Context;
+            OldVar->Matched = TRUE;
+            if (YoriLibCompareString(&OldVar->Value, &Var->Value) == 0) {
+                continue;
+            }
+            Diff->CharsNeeded += OldVar->Value.LengthInChars;
+        }
+
+        Diff->CharsNeeded += Var->Name.LengthInChars + Var->Value.LengthInChars + 3;
+        Diff->ChangeCount++;
+        AfterCount++;
+    }
+
+    for (Index = 0; Index < BeforeCount; Index++) {
+        Var = &Diff->Vars[Index];
+        if (!Var->Matched) {
+            Diff->CharsNeeded += Var->Name.LengthInChars + Var->Value.LengthInChars + 3;
+            Diff->ChangeCount++;
+        }
+    }
+
+    Diff->BeforeCount = BeforeCount;
+    Diff->AfterCount = AfterCount;
+    return TRUE;
+}
+
+/**
+ Record the differences between two blocks of NAME=value strings as changes
+ within a cache entry.
+
+ @param Diff Pointer to the differences, as returned from
+        @ref DirenvDiffBlocks .
+
+ @param IsAlias TRUE if the blocks describe aliases, FALSE if they describe
+        environment variables.
+
+ @param Change On input, points to the first change to populate.  On output,
+        updated to point after the last change populated.
+
+ @param Buffer On input, points to the buffer to copy strings into.  On
+        output, updated to point after the last string copied.
+ */
+VOID
+DirenvCopyBlockDiff(
+    __in PDIRENV_BLOCK_DIFF Diff,
+    __in BOOLEAN IsAlias,
+    __inout PDIRENV_CHANGE *Change,
+    __inout LPTSTR *Buffer
+    )
+{
+    PDIRENV_ENV_VAR Var;
+    PDIRENV_ENV_VAR OldVar;
+    PYORI_HASH_ENTRY HashEntry;
+    PDIRENV_CHANGE ThisChange;
+    DWORD Index;
+
+    ThisChange = *Change;
+    for (Index = 0; Index < Diff->AfterCount; Index++) {
+        Var = &Diff->Vars[Diff->BeforeCount + Index];
+        OldVar = NULL;
+        HashEntry = YoriLibHashLookupByKey(Diff->VarTable, &Var->Name);
+        if (HashEntry != NULL) {
+            OldVar = HashEntry->Context;
+        }
+        DirenvCopyString(&ThisChange->Name, &Var->Name, Buffer);
+        DirenvCopyString(&ThisChange->OldValue, (OldVar != NULL)?&OldVar->Value:NULL, Buffer);
+        DirenvCopyString(&ThisChange->NewValue, &Var->Value, Buffer);
+        ThisChange->HasNewValue = TRUE;
+        ThisChange->IsAlias = IsAlias;
+        ThisChange++;
+    }
+
+    for (Index = 0; Index < Diff->BeforeCount; Index++) {
+        Var = &Diff->Vars[Index];
+        if (!Var->Matched) {
+            DirenvCopyString(&ThisChange->Name, &Var->Name, Buffer);
+            DirenvCopyString(&ThisChange->OldValue, &Var->Value, Buffer);
+            DirenvCopyString(&ThisChange->NewValue, NULL, Buffer);
+            ThisChange->HasNewValue = FALSE;
+            ThisChange->IsAlias = IsAlias;
+            ThisChange++;
+        }
+    }
+
+    *Change = ThisChange;
+}
+
+/**
+ Free the differences between two blocks of NAME=value strings.
+
+ @param Diff Pointer to the differences, as returned from
+        @ref DirenvDiffBlocks .
+ */
+VOID
+DirenvFreeBlockDiff(
+    __in PDIRENV_BLOCK_DIFF Diff
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < Diff->BeforeCount; Index++) {
+        YoriLibHashRemoveByEntry(&Diff->Vars[Index].HashEntry);
+    }
+    YoriLibFreeEmptyHashTable(Diff->VarTable);
+    YoriLibFree(Diff->Vars);
+}
+
+/**
+ Compare the environment and aliases before and after executing a script,
+ and construct a cache entry describing the differences.
+
+ @param Before Pointer to the state before the script was executed.
+
+ @param After Pointer to the state after the script was executed.
+
+ @param Expression Pointer to the expression that was executed.
+
+ @param FindData Pointer to information about the script file.
+
+ @return Pointer to a newly allocated cache entry, or NULL on failure.
+ */
+PDIRENV_CACHE_ENTRY
+DirenvBuildCacheEntry(
+    __in PDIRENV_STATE Before,
+    __in PDIRENV_STATE After,
+    __in PYORI_STRING Expression,
+    __in PWIN32_FIND_DATA FindData
+    )
+{
+    DIRENV_BLOCK_DIFF EnvironmentDiff;
+    DIRENV_BLOCK_DIFF AliasDiff;
+    PDIRENV_CHANGE Change;
+    PDIRENV_CACHE_ENTRY CacheEntry;
+    LPTSTR Buffer;
+    DWORD ChangeCount;
+
+    if (!DirenvDiffBlocks(&Before->Environment, &After->Environment, &EnvironmentDiff)) {
+        return NULL;
+    }
+
+    if (!DirenvDiffBlocks(&Before->Aliases, &After->Aliases, &AliasDiff)) {
+        DirenvFreeBlockDiff(&EnvironmentDiff);
+        return NULL;
+    }
+
+    ChangeCount = EnvironmentDiff.ChangeCount + AliasDiff.ChangeCount;
+    CacheEntry = YoriLibMalloc(sizeof(DIRENV_CACHE_ENTRY) +
+                               ChangeCount * sizeof(DIRENV_CHANGE) +
+                               (Expression->LengthInChars + 1 + EnvironmentDiff.CharsNeeded + AliasDiff.CharsNeeded) * sizeof(TCHAR));
+
+    if (CacheEntry != NULL) {
+        CacheEntry->Changes = (PDIRENV_CHANGE)(CacheEntry + 1);
+        CacheEntry->ChangeCount = ChangeCount;
+        CacheEntry->LastWriteTime.dwLowDateTime = FindData->ftLastWriteTime.dwLowDateTime;
+        CacheEntry->LastWriteTime.dwHighDateTime = FindData->ftLastWriteTime.dwHighDateTime;
+        CacheEntry->FileSize.LowPart = FindData->nFileSizeLow;
+        CacheEntry->FileSize.HighPart = FindData->nFileSizeHigh;
+        Buffer = (LPTSTR)(CacheEntry->Changes + ChangeCount);
+        DirenvCopyString(&CacheEntry->Expression, Expression, &Buffer);
+
+        Change = CacheEntry->Changes;
+        DirenvCopyBlockDiff(&EnvironmentDiff, FALSE, &Change, &Buffer);
+        DirenvCopyBlockDiff(&AliasDiff, TRUE, &Change, &Buffer);
+    }
+
+    DirenvFreeBlockDiff(&AliasDiff);
+    DirenvFreeBlockDiff(&EnvironmentDiff);
+
+    return CacheEntry;
+}
+
+/**
+ Find the value of an entry within a block of NAME=value strings.
+
+ @param Block Pointer to the block.
+
+ @param Name Pointer to the name to find.
+
+ @param Value On completion, updated to refer to the value within the block,
+        or to an empty string if the name is not present.
+ */
+VOID
+DirenvFindBlockValue(
+    __in PYORI_STRING Block,
+    __in PYORI_STRING Name,
+    __out PYORI_STRING Value
+    )
+{
+    DIRENV_ENV_VAR Var;
+    LPTSTR ThisVar;
+
+    YoriLibInitEmptyString(Value);
+    for (ThisVar = Block->StartOfString; *ThisVar != '\0'; ThisVar += _tcslen(ThisVar) + 1) {
+        if (DirenvParseEnvironmentEntry(ThisVar, &Var) &&
+            YoriLibCompareStringInsensitive(&Var.Name, Name) == 0) {
+
+            Value->StartOfString = Var.Value.StartOfString;
+            Value->LengthInChars = Var.Value.LengthInChars;
+            return;
+        }
+    }
+}
+
+/**
+ Check whether a cache entry can be applied to the current environment.
+ This requires that every variable and alias the script changed still has
+ the value it had before the script was executed, so that applying the
+ recorded values produces the same result as executing the script.
+
+ @param CacheEntry Pointer to the cache entry.
+
+ @return TRUE if the cache entry can be applied, FALSE if the script needs
+         to be executed.
+ */
+BOOLEAN
+DirenvCacheEntryApplies(
+    __in PDIRENV_CACHE_ENTRY CacheEntry
+    )
+{
+    YORI_STRING Value;
+    YORI_STRING Aliases;
+    PDIRENV_CHANGE Change;
+    DWORD Index;
+    BOOLEAN HaveAliases;
+    BOOLEAN Result;
+
+    Result = TRUE;
+    HaveAliases = FALSE;
+    YoriLibInitEmptyString(&Value);
+    YoriLibInitEmptyString(&Aliases);
+    for (Index = 0; Index < CacheEntry->ChangeCount; Index++) {
+        Change = &CacheEntry->Changes[Index];
+        if (Change->IsAlias) {
+            if (!HaveAliases) {
+                if (!YoriCallGetAliasStrings(&Aliases)) {
+                    Result = FALSE;
+                    break;
+                }
+                HaveAliases = TRUE;
+            }
+
+            DirenvFindBlockValue(&Aliases, &Change->Name, &Value);
+            if (YoriLibCompareString(&Value, &Change->OldValue) != 0) {
+                Result = FALSE;
+                break;
+            }
+            continue;
+        }
+
+        if (!YoriLibAllocateAndGetEnvironmentVariable(Change->Name.StartOfString, &Value)) {
+            Result = FALSE;
+            break;
+        }
+
+        if (YoriLibCompareString(&Value, &Change->OldValue) != 0) {
+            Result = FALSE;
+        }
+        YoriLibFreeStringContents(&Value);
+        if (!Result) {
+            break;
+        }
+    }
+
+    if (HaveAliases) {
+        YoriCallFreeYoriString(&Aliases);
+    }
+
+    return Result;
+}
+
+/**
+ Capture the environment and aliases, so that the changes made by a script
+ can be determined.
+
+ @param State On successful completion, populated with the environment and
+        aliases.  The caller should free this with @ref DirenvFreeState .
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+DirenvCaptureState(
+    __out PDIRENV_STATE State
+    )
+{
+    if (!YoriLibGetEnvironmentStrings(&State->Environment)) {
+        return FALSE;
+    }
+
+    if (!YoriCallGetAliasStrings(&State->Aliases)) {
+        YoriLibFreeStringContents(&State->Environment);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Free the environment and aliases captured by @ref DirenvCaptureState .
+
+ @param State Pointer to the captured state.
+ */
+VOID
+DirenvFreeState(
+    __in PDIRENV_STATE State
+    )
+{
+    YoriLibFreeStringContents(&State->Environment);
+    YoriCallFreeYoriString(&State->Aliases);
+}
+
+/**
+ Execute a script expression.  If the script has been executed before, has
+ not been modified since, and its changes can be applied to the current
+ environment, the recorded changes are applied without executing the
+ script.  Otherwise the script is executed and its changes are recorded.
+
+ @param Expression Pointer to the expression to execute.  This consists of
+        the script path, optionally followed by arguments.
+
+ @param ScriptPathLength The number of characters in Expression that
+        describe the script path.
+ */
+VOID
+DirenvExecuteScript(
+    __in PYORI_STRING Expression,
+    __in DWORD ScriptPathLength
+    )
+{
+    WIN32_FIND_DATA FindData;
+    HANDLE FindHandle;
+    PYORI_LIST_ENTRY ListEntry;
+    PDIRENV_CACHE_ENTRY CacheEntry;
+    PDIRENV_CHANGE Change;
+    DIRENV_STATE Before;
+    DIRENV_STATE After;
+    TCHAR SavedChar;
+    DWORD Index;
+    BOOLEAN HaveBefore;
+
+    if (DirenvCache.Next == NULL) {
+        YoriLibInitializeListHead(&DirenvCache);
+    }
+
+    SavedChar = Expression->StartOfString[ScriptPathLength];
+    Expression->StartOfString[ScriptPathLength] = '\0';
+    FindHandle = FindFirstFile(Expression->StartOfString, &FindData);
+    Expression->StartOfString[ScriptPathLength] = SavedChar;
+
+    CacheEntry = NULL;
+    ListEntry = YoriLibGetNextListEntry(&DirenvCache, NULL);
+    while (ListEntry != NULL) {
+        CacheEntry = CONTAINING_RECORD(ListEntry, DIRENV_CACHE_ENTRY, ListEntry);
+        if (YoriLibCompareStringInsensitive(&CacheEntry->Expression, Expression) == 0) {
+            break;
+        }
+        CacheEntry = NULL;
+        ListEntry = YoriLibGetNextListEntry(&DirenvCache, ListEntry);
+    }
+
+    if (CacheEntry != NULL) {
+        if (FindHandle != INVALID_HANDLE_VALUE &&
+            CacheEntry->LastWriteTime.dwLowDateTime == FindData.ftLastWriteTime.dwLowDateTime &&
+            CacheEntry->LastWriteTime.dwHighDateTime == FindData.ftLastWriteTime.dwHighDateTime &&
+            CacheEntry->FileSize.LowPart == FindData.nFileSizeLow &&
+            (DWORD)CacheEntry->FileSize.HighPart == FindData.nFileSizeHigh &&
+            DirenvCacheEntryApplies(CacheEntry)) {
+
+            FindClose(FindHandle);
+            for (Index = 0; Index < CacheEntry->ChangeCount; Index++) {
+                Change = &CacheEntry->Changes[Index];
+                if (!Change->IsAlias) {
+                    YoriCallSetEnvironmentVariable(&Change->Name, Change->HasNewValue?&Change->NewValue:NULL);
+                } else if (Change->HasNewValue) {
+                    YoriCallAddAlias(&Change->Name, &Change->NewValue);
+                } else {
+                    YoriCallDeleteAlias(&Change->Name);
+                }
+            }
+            return;
+        }
+
+        YoriLibRemoveListItem(&CacheEntry->ListEntry);
+        YoriLibFree(CacheEntry);
+    }
+
+    //
+    //  Execute the script, and if its file information is known, capture
+    //  the environment and aliases around it to record what it changed.
+    //  If either cannot be captured the script is not cached, since its
+    //  effects cannot be reproduced.
+    //
+
+    HaveBefore = FALSE;
+    if (FindHandle != INVALID_HANDLE_VALUE) {
+        FindClose(FindHandle);
+        HaveBefore = DirenvCaptureState(&Before);
+    }
+
+    DirenvApplyInvoked = TRUE;
+    YoriCallExecuteExpression(Expression);
+    DirenvApplyInvoked = FALSE;
+
+    if (HaveBefore) {
+        if (DirenvCaptureState(&After)) {
+            CacheEntry = DirenvBuildCacheEntry(&Before, &After, Expression, &FindData);
+            if (CacheEntry != NULL) {
+                YoriLibAppendList(&DirenvCache, &CacheEntry->ListEntry);
+            }
+            DirenvFreeState(&After);
+        }
+        DirenvFreeState(&Before);
+    }
 }
 
 /**
@@ -126,12 +884,13 @@ DirenvNotifyUnload(VOID)
 VOID
 DirenvUndoPreviousScript(VOID)
 {
+    DWORD ScriptPathLength;
+
+    ScriptPathLength = DirenvPreviousExecutedScript.LengthInChars;
     YoriLibSPrintf(&DirenvPreviousExecutedScript.StartOfString[DirenvPreviousExecutedScript.LengthInChars], _T(" -undo"));
     DirenvPreviousExecutedScript.LengthInChars += sizeof(" -undo") - 1;
     ASSERT(DirenvPreviousExecutedScript.LengthInChars < DirenvPreviousExecutedScript.LengthAllocated);
-    DirenvApplyInvoked = TRUE;
-    YoriCallExecuteExpression(&DirenvPreviousExecutedScript);
-    DirenvApplyInvoked = FALSE;
+    DirenvExecuteScript(&DirenvPreviousExecutedScript, ScriptPathLength);
     YoriLibFreeStringContents(&DirenvPreviousExecutedScript);
 }
 
@@ -511,9 +1270,7 @@ DirenvApplyInternal(VOID)
             memcpy(&DirenvPreviousExecutedScript, &NewScript, sizeof(YORI_STRING));
             YoriLibInitEmptyString(&NewScript);
 
-            DirenvApplyInvoked = TRUE;
-            YoriCallExecuteExpression(&DirenvPreviousExecutedScript);
-            DirenvApplyInvoked = FALSE;
+            DirenvExecuteScript(&DirenvPreviousExecutedScript, DirenvPreviousExecutedScript.LengthInChars);
             break;
         }
 
@@ -575,7 +1332,7 @@ YoriCmd_DIRENVAPPLY(
                 DirenvApplyHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2019"));
+                YoriLibDisplayMitLicense(_T("2019-2026"));
                 return EXIT_SUCCESS;
             }
         }
@@ -645,7 +1402,7 @@ YoriCmd_DIRENV(
                 DirenvHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("019"));
+                YoriLibDisplayMitLicense(_T("2019-2026"));
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("a")) == 0) {
                 ArgumentUnderstood = TRUE;
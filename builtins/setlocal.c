@@ -196,6 +196,49 @@ SetlocalFreeStack(
     YoriLibFree(StackLocation);
 }
 
+/**
+ Check whether the environment captured by a new stack entry is identical to
+ the environment captured by the most recent entry which saved the
+ environment.  If so, the new entry shares the earlier copy rather than
+ retaining its own, so that nested contexts which have not changed the
+ environment only hold one copy between them.  The environment is restored
+ by applying only the differences, so sharing is invisible to endlocal.
+
+ @param NewStackEntry Pointer to the new stack entry, which has captured the
+        current environment.  It has not yet been inserted into the stack.
+ */
+VOID
+SetlocalShareEnvironment(
+    __in PSETLOCAL_STACK NewStackEntry
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PSETLOCAL_STACK StackLocation;
+    PYORI_STRING Previous;
+    PYORI_STRING Current;
+
+    if (SetlocalStack.Next == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetPreviousListEntry(&SetlocalStack, NULL);
+    while (ListEntry != NULL) {
+        StackLocation = CONTAINING_RECORD(ListEntry, SETLOCAL_STACK, StackLinks);
+        if (StackLocation->AttributesSaved & SETLOCAL_ATTRIBUTE_ENVIRONMENT) {
+            Previous = &StackLocation->PreviousEnvironment;
+            Current = &NewStackEntry->PreviousEnvironment;
+            if (Previous->LengthInChars == Current->LengthInChars &&
+                memcmp(Previous->StartOfString, Current->StartOfString, Current->LengthInChars * sizeof(TCHAR)) == 0) {
+
+                YoriLibFreeStringContents(Current);
+                YoriLibCloneString(Current, Previous);
+            }
+            return;
+        }
+        ListEntry = YoriLibGetPreviousListEntry(&SetlocalStack, ListEntry);
+    }
+}
+
 /**
  Pop a saved context from the stack.  This function is only
  registered/available if the stack has something to pop.
@@ -288,7 +331,8 @@ YoriCmd_ENDLOCAL(
     }
 
     //
-    //  Query the current environment and delete everything in it.
+    //  Restore the environment.  Only variables changed since the context
+    //  was saved are updated.
     //
 
     if (StackLocation->AttributesSaved & SETLOCAL_ATTRIBUTE_ENVIRONMENT) {
@@ -503,6 +547,7 @@ YoriCmd_SETLOCAL(
             SetlocalFreeStack(NewStackEntry);
             return EXIT_FAILURE;
         }
+        SetlocalShareEnvironment(NewStackEntry);
     }
 
     if (AttributesToSave & SETLOCAL_ATTRIBUTE_ALIASES) {
@@ -4,7 +4,7 @@
  * Copy HTML text onto the clipboard in HTML formatting for use in applications
  * that support rich text.
  *
- * Copyright (c) 2015-2020 Malcolm J. Smith
+ * Copyright (c) 2015-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -104,10 +104,15 @@ const CHAR ClipDummyFragEnd[] =
 #define HTMLCLIP_FRAGEND_SIZE (sizeof(ClipDummyFragEnd)-1)
 
 /**
- The maximum amount of data to buffer from a pipe before acting upon it.  The
- clipboard requires a full buffer of data to oeprate with.
+ The amount of data to read from a pipe before the size of the input is
+ known.  The buffer is doubled each time it fills.
  */
-#define MAX_PIPE_SIZE (4*1024*1024)
+#define CLIP_INITIAL_PIPE_SIZE (64*1024)
+
+/**
+ The largest amount of input that can be copied to the clipboard.
+ */
+#define CLIP_MAX_INPUT_SIZE (0x40000000)
 
 //
 //  Older versions of the analysis engine don't understand that a buffer
@@ -124,36 +129,57 @@ const CHAR ClipDummyFragEnd[] =
 #endif
 
 /**
- Copy the contents of a file or pipe to the clipboard in HTML format.
+ Read the contents of a file or pipe into a global memory allocation that
+ can be handed to the clipboard.  Space can be reserved before and after the
+ data, so that a clipboard format can be constructed around the input
+ without copying it again.
 
  @param hFile Handle to the file or pipe.
 
  @param FileSize The length of the file, in bytes.  For a pipe, this value is
-        not known beforehand, and is specified as MAX_PIPE_SIZE.
+        not known beforehand, and is specified as zero.
+
+ @param PrefixBytes The number of bytes to reserve before the data.
+
+ @param SuffixBytes The number of bytes to reserve after the data.
+
+ @param MemHandle On successful completion, populated with an unlocked global
+        memory handle whose size is PrefixBytes + BytesRead + SuffixBytes.
+
+ @param BytesRead On successful completion, populated with the number of
+        bytes of data read.
 
  @return TRUE to indicate success or FALSE to indicate failure.
  */
+__success(return)
 BOOL
-ClipCopyAsHtml(
+ClipReadToGlobalBuffer(
     __in HANDLE hFile,
-    __in DWORD FileSize
+    __in DWORD FileSize,
+    __in DWORD PrefixBytes,
+    __in DWORD SuffixBytes,
+    __out PHANDLE MemHandle,
+    __out PDWORD BytesRead
     )
 {
-    DWORD  AllocSize;
     HANDLE hMem;
+    HANDLE hNewMem;
     PUCHAR pMem;
-    DWORD  BytesTransferred;
+    DWORD  BufferSize;
     DWORD  CurrentOffset;
-    UINT   ClipFmt;
-    DWORD  Err;
-    LPTSTR ErrText;
+    DWORD  BytesTransferred;
 
-    //
-    //  Allocate space to copy the file or pipe contents.
-    //
+    BufferSize = FileSize;
+    if (BufferSize == 0) {
+        BufferSize = CLIP_INITIAL_PIPE_SIZE;
+    }
+
+    if (BufferSize > CLIP_MAX_INPUT_SIZE) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: input too large for clipboard\n"));
+        return FALSE;
+    }
 
-    AllocSize = FileSize + HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + HTMLCLIP_FRAGEND_SIZE + 2;
-    hMem = GlobalAlloc(GMEM_MOVEABLE|GMEM_DDESHARE, AllocSize);
+    hMem = GlobalAlloc(GMEM_MOVEABLE|GMEM_DDESHARE, PrefixBytes + BufferSize + SuffixBytes);
     if (hMem == NULL) {
         return FALSE;
     }
@@ -164,104 +190,108 @@ ClipCopyAsHtml(
         return FALSE;
     }
 
-    //
-    //  Note this is not Unicode.
-    //
-    //  First, prepare the header.  Leave a magic space at the end of the
-    //  header.
-    //
-
-    YoriLibSPrintfSA((PCHAR)pMem,
-                     AllocSize,
-                     "Version:0.9\n"
-                     "StartHTML:%08i\n"
-                     "EndHTML:%08i\n"
-                     "StartFragment:%08i\n"
-                     "EndFragment:%08i\n"
-                     "<!--StartFragment-->"
-                     " ",
-                     (int)HTMLCLIP_HDR_SIZE,
-                     (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + HTMLCLIP_FRAGEND_SIZE + 1 + FileSize),
-                     (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE),
-                     (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1 + FileSize));
-
     CurrentOffset = 0;
-
-    //
-    //  Read text immediately following the header that we just prepared.
-    //
-
-    while (ReadFile(hFile, pMem + HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1 + CurrentOffset, FileSize - CurrentOffset, &BytesTransferred, NULL)) {
-        CurrentOffset += BytesTransferred;
+    while (TRUE) {
 
         //
-        //  If we're reading from the pipe and have exceeded our storage,
-        //  fail.
+        //  If the size was known and has been read, stop.  Otherwise, if
+        //  the buffer is full, double it and keep reading.
         //
 
-        if (CurrentOffset == FileSize &&
-            FileSize == MAX_PIPE_SIZE &&
-            hFile == GetStdHandle(STD_INPUT_HANDLE)) {
+        if (FileSize != 0 && CurrentOffset == FileSize) {
+            break;
+        }
 
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Pipe data too large for buffer.  Limit is %i bytes\n"), MAX_PIPE_SIZE);
-            return FALSE;
+        if (CurrentOffset == BufferSize) {
+            if (BufferSize >= CLIP_MAX_INPUT_SIZE) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: input too large for clipboard\n"));
+                DllKernel32.pGlobalUnlock(hMem);
+                GlobalFree(hMem);
+                return FALSE;
+            }
+
+            DllKernel32.pGlobalUnlock(hMem);
+            hNewMem = GlobalReAlloc(hMem, PrefixBytes + BufferSize * 2 + SuffixBytes, GMEM_MOVEABLE);
+            if (hNewMem == NULL) {
+                GlobalFree(hMem);
+                return FALSE;
+            }
+            hMem = hNewMem;
+            BufferSize = BufferSize * 2;
+
+            pMem = DllKernel32.pGlobalLock(hMem);
+            if (pMem == NULL) {
+                GlobalFree(hMem);
+                return FALSE;
+            }
+        }
+
+        if (!ReadFile(hFile, pMem + PrefixBytes + CurrentOffset, BufferSize - CurrentOffset, &BytesTransferred, NULL)) {
+            break;
         }
 
         if (BytesTransferred == 0) {
             break;
         }
+
+        CurrentOffset += BytesTransferred;
     }
 
+    DllKernel32.pGlobalUnlock(hMem);
+
     if (CurrentOffset == 0) {
+        GlobalFree(hMem);
         ClipHelp();
         return FALSE;
     }
 
     //
-    //  If we don't have as much text as we expected, the header is wrong
-    //  and needs to be rewritten with correct values.
+    //  Release any space that was allocated for pipe input but not used.
     //
 
-    if (CurrentOffset < FileSize) {
-        FileSize = CurrentOffset;
-        YoriLibSPrintfA((PCHAR)pMem,
-                        "Version:0.9\n"
-                        "StartHTML:%08i\n"
-                        "EndHTML:%08i\n"
-                        "StartFragment:%08i\n"
-                        "EndFragment:%08i\n"
-                        "<!--StartFragment-->",
-                        (int)HTMLCLIP_HDR_SIZE,
-                        (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + HTMLCLIP_FRAGEND_SIZE + 1 + FileSize),
-                        (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE),
-                        (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1 + FileSize));
+    if (CurrentOffset < BufferSize) {
+        hNewMem = GlobalReAlloc(hMem, PrefixBytes + CurrentOffset + SuffixBytes, GMEM_MOVEABLE);
+        if (hNewMem != NULL) {
+            hMem = hNewMem;
+        }
+    }
 
-        //
-        //  That magic space from above has now been set to NULL by printf.
-        //  Put the magic space back.
-        //
+    *MemHandle = hMem;
+    *BytesRead = CurrentOffset;
+    return TRUE;
+}
 
-        pMem[HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE] = ' ';
-    }
+/**
+ Replace the contents of the clipboard with a single format.  On success,
+ the clipboard takes ownership of the memory handle.  On failure, the memory
+ handle is freed.
 
-    //
-    //  Fill in the footer of the protocol.
-    //
+ @param FormatName Optionally points to the name of a registered clipboard
+        format.  If NULL, Format is used.
 
-    YoriLibSPrintfA((PCHAR)(pMem + FileSize + HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1),
-                    "%s",
-                    ClipDummyFragEnd);
+ @param Format The clipboard format to use if FormatName is NULL.
 
-    DllKernel32.pGlobalUnlock(hMem);
+ @param hMem The global memory handle containing the data.
 
-    //
-    //  Send the buffer to the clipboard.
-    //
+ @return TRUE to indicate success or FALSE to indicate failure.
+ */
+BOOL
+ClipSetClipboardFormat(
+    __in_opt LPCTSTR FormatName,
+    __in UINT Format,
+    __in HANDLE hMem
+    )
+{
+    UINT   ClipFmt;
+    DWORD  Err;
+    LPTSTR ErrText;
 
     if (!YoriLibOpenClipboard()) {
         Err = GetLastError();
         ErrText = YoriLibGetWinErrorText(Err);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not open clipboard: %s\n"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        GlobalFree(hMem);
         return FALSE;
     }
 
@@ -269,64 +299,83 @@ ClipCopyAsHtml(
         Err = GetLastError();
         ErrText = YoriLibGetWinErrorText(Err);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not empty clipboard: %s\n"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
         DllUser32.pCloseClipboard();
+        GlobalFree(hMem);
         return FALSE;
     }
 
-    ClipFmt = DllUser32.pRegisterClipboardFormatW(_T("HTML Format"));
-    if (ClipFmt == 0) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not register clipboard format: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
-        return FALSE;
+    ClipFmt = Format;
+    if (FormatName != NULL) {
+        ClipFmt = DllUser32.pRegisterClipboardFormatW(FormatName);
+        if (ClipFmt == 0) {
+            Err = GetLastError();
+            ErrText = YoriLibGetWinErrorText(Err);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not register clipboard format: %s\n"), ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            DllUser32.pCloseClipboard();
+            GlobalFree(hMem);
+            return FALSE;
+        }
     }
 
+    //
+    //  Once the data is on the clipboard, the system owns the memory, so
+    //  it is only freed here on failure.
+    //
+
     if (DllUser32.pSetClipboardData(ClipFmt, hMem) == NULL) {
         Err = GetLastError();
         ErrText = YoriLibGetWinErrorText(Err);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not set clipboard data: %s\n"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
         DllUser32.pCloseClipboard();
+        GlobalFree(hMem);
         return FALSE;
     }
+
     DllUser32.pCloseClipboard();
-    GlobalFree(hMem);
     return TRUE;
 }
 
 /**
- Copy the contents of a file or pipe to the clipboard in RTF format.
+ Copy the contents of a file or pipe to the clipboard in HTML format.  The
+ input is read directly between the header and footer of the clipboard
+ format, so no copy of it is made.
 
  @param hFile Handle to the file or pipe.
 
  @param FileSize The length of the file, in bytes.  For a pipe, this value is
-        not known beforehand, and is specified as MAX_PIPE_SIZE.
+        not known beforehand, and is specified as zero.
 
  @return TRUE to indicate success or FALSE to indicate failure.
  */
 BOOL
-ClipCopyAsRtf(
+ClipCopyAsHtml(
     __in HANDLE hFile,
     __in DWORD FileSize
     )
 {
-    LPSTR  AnsiBuffer;
-    DWORD  AllocSize;
     HANDLE hMem;
-    PCHAR  pMem;
-    DWORD  BytesTransferred;
-    DWORD  CurrentOffset;
-    DWORD  Err;
-    LPTSTR ErrText;
-    UINT   ClipFmt;
+    PUCHAR pMem;
 
     //
-    //  Allocate space to copy the file or pipe contents.
+    //  Leave space for the header, and a magic space at the end of the
+    //  header, followed by the footer and a NULL terminator.
     //
 
-    AllocSize = FileSize + 1;
-    AnsiBuffer = YoriLibMalloc(AllocSize);
-    if (AnsiBuffer == NULL) {
+    if (!ClipReadToGlobalBuffer(hFile,
+                                FileSize,
+                                HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1,
+                                HTMLCLIP_FRAGEND_SIZE + 1,
+                                &hMem,
+                                &FileSize)) {
+        return FALSE;
+    }
+
+    pMem = DllKernel32.pGlobalLock(hMem);
+    if (pMem == NULL) {
+        GlobalFree(hMem);
         return FALSE;
     }
 
@@ -334,128 +383,91 @@ ClipCopyAsRtf(
     //  Note this is not Unicode.
     //
 
-    CurrentOffset = 0;
+    YoriLibSPrintfA((PCHAR)pMem,
+                    "Version:0.9\n"
+                    "StartHTML:%08i\n"
+                    "EndHTML:%08i\n"
+                    "StartFragment:%08i\n"
+                    "EndFragment:%08i\n"
+                    "<!--StartFragment-->",
+                    (int)HTMLCLIP_HDR_SIZE,
+                    (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + HTMLCLIP_FRAGEND_SIZE + 1 + FileSize),
+                    (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE),
+                    (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1 + FileSize));
 
     //
-    //  Read text.
+    //  The magic space has now been set to NULL by printf.  Put the magic
+    //  space back.
     //
 
-    while (ReadFile(hFile, AnsiBuffer + CurrentOffset, FileSize - CurrentOffset, &BytesTransferred, NULL)) {
-        CurrentOffset += BytesTransferred;
+    pMem[HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE] = ' ';
 
-        //
-        //  If we're reading from the pipe and have exceeded our storage,
-        //  fail.
-        //
+    //
+    //  Fill in the footer of the protocol.
+    //
 
-        if (CurrentOffset == FileSize &&
-            FileSize == MAX_PIPE_SIZE &&
-            hFile == GetStdHandle(STD_INPUT_HANDLE)) {
+    YoriLibSPrintfA((PCHAR)(pMem + FileSize + HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1),
+                    "%s",
+                    ClipDummyFragEnd);
 
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Pipe data too large for buffer.  Limit is %i bytes\n"), MAX_PIPE_SIZE);
-            return FALSE;
-        }
+    DllKernel32.pGlobalUnlock(hMem);
 
-        if (BytesTransferred == 0) {
-            break;
-        }
-    }
+    return ClipSetClipboardFormat(_T("HTML Format"), 0, hMem);
+}
 
-    if (CurrentOffset == 0) {
-        YoriLibFree(AnsiBuffer);
-        ClipHelp();
-        return FALSE;
-    }
+/**
+ Copy the contents of a file or pipe to the clipboard in RTF format.  The
+ input is converted in place, so no copy of it is made.
 
+ @param hFile Handle to the file or pipe.
 
-    AllocSize = CurrentOffset;
-    hMem = GlobalAlloc(GMEM_MOVEABLE|GMEM_DDESHARE, (AllocSize + 1) * sizeof(TCHAR));
-    if (hMem == NULL) {
-        YoriLibFree(AnsiBuffer);
+ @param FileSize The length of the file, in bytes.  For a pipe, this value is
+        not known beforehand, and is specified as zero.
+
+ @return TRUE to indicate success or FALSE to indicate failure.
+ */
+BOOL
+ClipCopyAsRtf(
+    __in HANDLE hFile,
+    __in DWORD FileSize
+    )
+{
+    HANDLE hMem;
+    PCHAR  pMem;
+    DWORD  CurrentOffset;
+
+    if (!ClipReadToGlobalBuffer(hFile, FileSize, 0, 1, &hMem, &FileSize)) {
         return FALSE;
     }
 
     pMem = DllKernel32.pGlobalLock(hMem);
     if (pMem == NULL) {
         GlobalFree(hMem);
-        YoriLibFree(AnsiBuffer);
         return FALSE;
     }
 
-    for (CurrentOffset = 0; CurrentOffset < AllocSize; CurrentOffset++) {
-
-        //
-        //  Analyze gets really confused here and thinks AnsiBuffer is
-        //  of size BytesTransferred (ie., it doesn't understand that
-        //  the read started partway through the buffer.)  At this point,
-        //  it is of size CurrentOffset.
-        //
-#if defined(_MSC_VER) && (_MSC_VER >= 1700)
-#pragma warning(suppress: 6385)
-#endif
-        pMem[CurrentOffset] = (CHAR)(AnsiBuffer[CurrentOffset] & 0x7f);
-    }
-
-    pMem[AllocSize] = '\0';
-    DllKernel32.pGlobalUnlock(hMem);
-
-    YoriLibFree(AnsiBuffer);
-
     //
-    //  Send the buffer to the clipboard.
+    //  Note this is not Unicode.  RTF predates Unicode, so any extended
+    //  characters must have already been encoded.
     //
 
-    if (!YoriLibOpenClipboard()) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not open clipboard: %s\n"), ErrText);
-        GlobalFree(hMem);
-        return FALSE;
-    }
-
-    if (!DllUser32.pEmptyClipboard()) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not empty clipboard: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
-        GlobalFree(hMem);
-        return FALSE;
-    }
-
-    ClipFmt = DllUser32.pRegisterClipboardFormatW(_T("Rich Text Format"));
-    if (ClipFmt == 0) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not register clipboard format: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
-        return FALSE;
+    for (CurrentOffset = 0; CurrentOffset < FileSize; CurrentOffset++) {
+        pMem[CurrentOffset] = (CHAR)(pMem[CurrentOffset] & 0x7f);
     }
 
-    if (DllUser32.pSetClipboardData(ClipFmt, hMem) == NULL) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not set clipboard data: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
-        GlobalFree(hMem);
-        return FALSE;
-    }
+    pMem[FileSize] = '\0';
+    DllKernel32.pGlobalUnlock(hMem);
 
-    DllUser32.pCloseClipboard();
-    GlobalFree(hMem);
-    return TRUE;
+    return ClipSetClipboardFormat(_T("Rich Text Format"), 0, hMem);
 }
 
-#if defined(_MSC_VER) && (_MSC_VER >= 1500) && (_MSC_VER <= 1600)
-#pragma warning(pop)
-#endif
-
 /**
  Copy the contents of a file or pipe to the clipboard in text format.
 
  @param hFile Handle to the file or pipe.
 
  @param FileSize The length of the file, in bytes.  For a pipe, this value is
-        not known beforehand, and is specified as MAX_PIPE_SIZE.
+        not known beforehand, and is specified as zero.
 
  @return TRUE to indicate success or FALSE to indicate failure.
  */
@@ -465,128 +477,58 @@ ClipCopyAsText(
     __in DWORD FileSize
     )
 {
-    LPSTR  AnsiBuffer;
+    HANDLE hInput;
+    LPSTR  pInput;
     DWORD  AllocSize;
     HANDLE hMem;
     PTCHAR pMem;
-    DWORD  BytesTransferred;
-    DWORD  CurrentOffset;
-    DWORD  Err;
-    LPTSTR ErrText;
-
-    //
-    //  Allocate space to copy the file or pipe contents.
-    //
 
-    AllocSize = FileSize + 1;
-    AnsiBuffer = YoriLibMalloc(AllocSize);
-    if (AnsiBuffer == NULL) {
+    if (!ClipReadToGlobalBuffer(hFile, FileSize, 0, 0, &hInput, &FileSize)) {
         return FALSE;
     }
 
-    //
-    //  Note this is not Unicode.
-    //
-
-    CurrentOffset = 0;
-
-    //
-    //  Read text.
-    //
-
-    while (ReadFile(hFile, AnsiBuffer + CurrentOffset, FileSize - CurrentOffset, &BytesTransferred, NULL)) {
-        CurrentOffset += BytesTransferred;
-
-        //
-        //  If we're reading from the pipe and have exceeded our storage,
-        //  fail.
-        //
-
-        if (CurrentOffset == FileSize &&
-            FileSize == MAX_PIPE_SIZE &&
-            hFile == GetStdHandle(STD_INPUT_HANDLE)) {
-
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Pipe data too large for buffer.  Limit is %i bytes\n"), MAX_PIPE_SIZE);
-            return FALSE;
-        }
-
-        if (BytesTransferred == 0) {
-            break;
-        }
-    }
-
-    if (CurrentOffset == 0) {
-        YoriLibFree(AnsiBuffer);
-        ClipHelp();
+    pInput = DllKernel32.pGlobalLock(hInput);
+    if (pInput == NULL) {
+        GlobalFree(hInput);
         return FALSE;
     }
 
+    //
+    //  Convert the input into the Unicode form placed on the clipboard.
+    //  The input is released as soon as it has been converted.
+    //
 
-    AllocSize = YoriLibGetMultibyteInputSizeNeeded(AnsiBuffer, CurrentOffset);
+    AllocSize = YoriLibGetMultibyteInputSizeNeeded(pInput, FileSize);
     hMem = GlobalAlloc(GMEM_MOVEABLE|GMEM_DDESHARE, (AllocSize + 1) * sizeof(TCHAR));
     if (hMem == NULL) {
-        YoriLibFree(AnsiBuffer);
+        DllKernel32.pGlobalUnlock(hInput);
+        GlobalFree(hInput);
         return FALSE;
     }
 
     pMem = DllKernel32.pGlobalLock(hMem);
     if (pMem == NULL) {
         GlobalFree(hMem);
-        YoriLibFree(AnsiBuffer);
+        DllKernel32.pGlobalUnlock(hInput);
+        GlobalFree(hInput);
         return FALSE;
     }
 
-    //
-    //  Analyze gets really confused here and thinks AnsiBuffer is
-    //  of size BytesTransferred (ie., it doesn't understand that
-    //  the read started partway through the buffer.)  At this point,
-    //  it is of size CurrentOffset.
-    //
-#if defined(_MSC_VER) && (_MSC_VER >= 1700)
-#pragma warning(suppress: 6385)
-#endif
-    YoriLibMultibyteInput(AnsiBuffer, CurrentOffset, pMem, AllocSize);
+    YoriLibMultibyteInput(pInput, FileSize, pMem, AllocSize);
 
     pMem[AllocSize] = '\0';
     DllKernel32.pGlobalUnlock(hMem);
 
-    YoriLibFree(AnsiBuffer);
-
-    //
-    //  Send the buffer to the clipboard.
-    //
-
-    if (!YoriLibOpenClipboard()) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not open clipboard: %s\n"), ErrText);
-        GlobalFree(hMem);
-        return FALSE;
-    }
-
-    if (!DllUser32.pEmptyClipboard()) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not empty clipboard: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
-        GlobalFree(hMem);
-        return FALSE;
-    }
+    DllKernel32.pGlobalUnlock(hInput);
+    GlobalFree(hInput);
 
-    if (DllUser32.pSetClipboardData(CF_UNICODETEXT, hMem) == NULL) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not set clipboard data: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
-        GlobalFree(hMem);
-        return FALSE;
-    }
-
-    DllUser32.pCloseClipboard();
-    GlobalFree(hMem);
-    return TRUE;
+    return ClipSetClipboardFormat(NULL, CF_UNICODETEXT, hMem);
 }
 
+#if defined(_MSC_VER) && (_MSC_VER >= 1500) && (_MSC_VER <= 1600)
+#pragma warning(pop)
+#endif
+
 /**
  Enumerate clipboard formats and find a registered format that matches a
  specified name.  If no matching registered format is found, return zero.
@@ -1055,7 +997,7 @@ ENTRYPOINT(
                 ClipHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2015-2020"));
+                YoriLibDisplayMitLicense(_T("2015-2026"));
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("e")) == 0) {
                 if (Op == ClipOperationUnknown) {
@@ -1151,6 +1093,9 @@ ENTRYPOINT(
                 }
 
                 FileSize = GetFileSize(hFile, NULL);
+                if (FileSize == INVALID_FILE_SIZE) {
+                    FileSize = 0;
+                }
                 OpenedFile = TRUE;
                 break;
             }
@@ -1171,7 +1116,7 @@ ENTRYPOINT(
             hFile = GetStdHandle(STD_OUTPUT_HANDLE);
         } else {
 
-            FileSize = MAX_PIPE_SIZE;
+            FileSize = 0;
             hFile = GetStdHandle(STD_INPUT_HANDLE);
 
             //
@@ -603,7 +603,9 @@ EditLoadFile(
     YoriWinMultilineEditClear(EditContext->MultilineEdit);
     SavedEncoding = YoriLibGetMultibyteInputEncoding();
     YoriLibSetMultibyteInputEncoding(EditContext->Encoding);
+    YORI_TRACE_BEGIN("Edit load file");
     EditPopulateFromStream(EditContext, hFile);
+    YORI_TRACE_END("Edit load file");
     YoriLibSetMultibyteInputEncoding(SavedEncoding);
     CloseHandle(hFile);
     return TRUE;
@@ -635,6 +637,7 @@ EditSaveFile(
     YORI_STRING TempFileName;
     HANDLE TempHandle;
     BOOLEAN ReplaceSucceeded;
+    BOOLEAN WriteSucceeded;
 
     if (FileName->StartOfString == NULL) {
         return FALSE;
@@ -713,27 +716,31 @@ EditSaveFile(
 
     SavedEncoding = YoriLibGetMultibyteOutputEncoding();
     YoriLibSetMultibyteOutputEncoding(EditContext->Encoding);
+    YORI_TRACE_BEGIN("Edit save file");
+    WriteSucceeded = TRUE;
     for (LineIndex = 0; LineIndex < LineCount; LineIndex++) {
         Line = YoriWinMultilineEditGetLineByIndex(EditContext->MultilineEdit, LineIndex);
         if (Line->LengthInChars > 0) {
             if (!YoriLibOutputTextToMultibyteDevice(TempHandle, Line)) {
-                CloseHandle(TempHandle);
-                DeleteFile(TempFileName.StartOfString);
-                YoriLibFreeStringContents(&TempFileName);
-                YoriLibSetMultibyteOutputEncoding(SavedEncoding);
-                return FALSE;
+                WriteSucceeded = FALSE;
+                break;
             }
         }
         if (!YoriLibOutputTextToMultibyteDevice(TempHandle, &EditContext->Newline)) {
-            CloseHandle(TempHandle);
-            DeleteFile(TempFileName.StartOfString);
-            YoriLibFreeStringContents(&TempFileName);
-            YoriLibSetMultibyteOutputEncoding(SavedEncoding);
-            return FALSE;
+            WriteSucceeded = FALSE;
+            break;
         }
     }
+    YORI_TRACE_END("Edit save file");
     YoriLibSetMultibyteOutputEncoding(SavedEncoding);
 
+    if (!WriteSucceeded) {
+        CloseHandle(TempHandle);
+        DeleteFile(TempFileName.StartOfString);
+        YoriLibFreeStringContents(&TempFileName);
+        return FALSE;
+    }
+
     //
     //  Flush the temporary file to ensure it's durable, and rename it over
     //  the top of the chosen file, replacing if necessary.  This ensures
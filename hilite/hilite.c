@@ -37,15 +37,19 @@ CHAR strHiliteHelpText[] =
         "or text matching specified criteria.\n"
         "\n"
         "HILITE [-license] [-b] [-c <string> <color>] [-h <string> <color>]\n"
-        "       [-i] [-m] [-s] [-t <string> <color>] [<file>...]\n"
+        "       [-i] [-m] [-r] [-s] [-t <string> <color>] [<file>...]\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -c             Highlight lines containing <string> with <color>\n"
         "   -h             Highlight lines starting with <string> with <color>\n"
         "   -i             Match insensitively\n"
         "   -m             Highlight matching text (as opposed to matching lines)\n"
+        "   -r             Interpret strings as regular expressions\n"
         "   -s             Process files from all subdirectories\n"
-        "   -t             Highlight lines ending with <string> with <color>\n";
+        "   -t             Highlight lines ending with <string> with <color>\n"
+        "\n"
+        "Regular expressions support . [] [^] * + ? {n,m} | () ^ $ and the escapes\n"
+        " \\d \\w \\s \\D \\W \\S \\t \\xHH.\n";
 
 /**
  Display usage text to the user.
@@ -145,6 +149,24 @@ typedef struct _HILITE_CONTEXT {
      */
     YORI_LIST_ENTRY EndMatches;
 
+    /**
+     TRUE if match strings are regular expressions, FALSE if they are
+     literal text.
+     */
+    BOOLEAN RegularExpressions;
+
+    /**
+     An expression containing every criteria, compiled so that all criteria
+     can be evaluated in one pass over each line.  This is NULL if there
+     are no criteria to evaluate.
+     */
+    PYORI_LIB_REGEX Regex;
+
+    /**
+     An array of criteria, indexed by the pattern number within Regex.
+     */
+    PHILITE_MATCH_CRITERIA *Criteria;
+
 } HILITE_CONTEXT, *PHILITE_CONTEXT;
 
 /**
@@ -214,6 +236,109 @@ HiliteGetNextMatch(
     return NULL;
 }
 
+/**
+ Compile all of the criteria into a single expression, so that each line can
+ be evaluated against all criteria in one pass.  Criteria are numbered in the
+ order they are returned from @ref HiliteGetNextMatch , so where more than
+ one criteria matches, the one returned first is used.
+
+ @param HiliteContext Pointer to the context.  On successful completion, the
+        compiled expression and the array of criteria it refers to are
+        populated in this context.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+HiliteCompileCriteria(
+    __inout PHILITE_CONTEXT HiliteContext
+    )
+{
+    PHILITE_MATCH_CRITERIA MatchCriteria;
+    PYORI_LIST_ENTRY ListHead;
+    PYORI_STRING Patterns;
+    PDWORD PatternFlags;
+    DWORD Count;
+    DWORD Flags;
+    DWORD ErrorPattern;
+    DWORD ErrorOffset;
+
+    Count = 0;
+    ListHead = NULL;
+    MatchCriteria = HiliteGetNextMatch(HiliteContext, &ListHead, NULL);
+    while (MatchCriteria != NULL) {
+        Count++;
+        MatchCriteria = HiliteGetNextMatch(HiliteContext, &ListHead, MatchCriteria);
+    }
+
+    if (Count == 0) {
+        return TRUE;
+    }
+
+    HiliteContext->Criteria = YoriLibMalloc(Count * (sizeof(PHILITE_MATCH_CRITERIA) + sizeof(YORI_STRING) + sizeof(DWORD)));
+    if (HiliteContext->Criteria == NULL) {
+        return FALSE;
+    }
+
+    Patterns = (PYORI_STRING)(HiliteContext->Criteria + Count);
+    PatternFlags = (PDWORD)(Patterns + Count);
+
+    //
+    //  When highlighting matching text, an empty string is never
+    //  highlighted, so it is not included.  When highlighting lines, an
+    //  empty string matches every line.
+    //
+
+    Count = 0;
+    ListHead = NULL;
+    MatchCriteria = HiliteGetNextMatch(HiliteContext, &ListHead, NULL);
+    while (MatchCriteria != NULL) {
+        if (!HiliteContext->HighlightMatchText ||
+            MatchCriteria->MatchString.LengthInChars > 0) {
+
+            HiliteContext->Criteria[Count] = MatchCriteria;
+            YoriLibInitEmptyString(&Patterns[Count]);
+            Patterns[Count].StartOfString = MatchCriteria->MatchString.StartOfString;
+            Patterns[Count].LengthInChars = MatchCriteria->MatchString.LengthInChars;
+            PatternFlags[Count] = 0;
+            if (!HiliteContext->RegularExpressions) {
+                PatternFlags[Count] = PatternFlags[Count] | YORI_LIB_REGEX_PATTERN_LITERAL;
+            }
+            if (MatchCriteria->MatchType == HiliteMatchTypeBeginsWith) {
+                PatternFlags[Count] = PatternFlags[Count] | YORI_LIB_REGEX_PATTERN_ANCHOR_START;
+            } else if (MatchCriteria->MatchType == HiliteMatchTypeEndsWith) {
+                PatternFlags[Count] = PatternFlags[Count] | YORI_LIB_REGEX_PATTERN_ANCHOR_END;
+            }
+            Count++;
+        }
+        MatchCriteria = HiliteGetNextMatch(HiliteContext, &ListHead, MatchCriteria);
+    }
+
+    if (Count == 0) {
+        return TRUE;
+    }
+
+    Flags = 0;
+    if (HiliteContext->Insensitive) {
+        Flags = Flags | YORI_LIB_REGEX_INSENSITIVE;
+    }
+
+    ErrorPattern = (DWORD)-1;
+    ErrorOffset = 0;
+    if (!YoriLibRegexCompile(Count, Patterns, PatternFlags, Flags, &HiliteContext->Regex, &ErrorPattern, &ErrorOffset)) {
+        if (ErrorPattern == (DWORD)-1) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hilite: out of memory\n"));
+        } else if (ErrorOffset < Patterns[ErrorPattern].LengthInChars) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hilite: invalid expression %y at offset %i\n"), &Patterns[ErrorPattern], ErrorOffset);
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hilite: invalid expression %y\n"), &Patterns[ErrorPattern]);
+        }
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /**
  Process a stream and apply the hilite criteria before outputting to standard
  output.
@@ -234,21 +359,16 @@ HiliteProcessStream(
     PVOID LineContext = NULL;
     CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
     YORI_STRING LineString;
-    YORI_STRING Substring;
     YORI_STRING DisplayString;
     PHILITE_MATCH_CRITERIA MatchCriteria;
-    PHILITE_MATCH_CRITERIA BestMatchCriteria;
-    DWORD BestMatchOffset;
-    YORILIB_COLOR_ATTRIBUTES ColorToUse;
-    PYORI_LIST_ENTRY ListHead;
-    BOOLEAN MatchFound;
-    BOOLEAN AnyMatchFound;
+    DWORD PatternIndex;
     DWORD MatchOffset;
+    DWORD MatchLength;
+    DWORD DisplayOffset;
+    DWORD SearchOffset;
 
     YoriLibInitEmptyString(&LineString);
-    YoriLibInitEmptyString(&Substring);
     YoriLibInitEmptyString(&DisplayString);
-    MatchOffset = 0;
 
     HiliteContext->FilesFound++;
 
@@ -258,169 +378,71 @@ HiliteProcessStream(
             break;
         }
 
-        Substring.StartOfString = LineString.StartOfString;
-        Substring.LengthInChars = LineString.LengthInChars;
-        ColorToUse.Ctrl = HiliteContext->DefaultColor.Ctrl;
-        ColorToUse.Win32Attr = HiliteContext->DefaultColor.Win32Attr;
+        DisplayOffset = 0;
 
-        while (Substring.LengthInChars > 0) {
+        if (HiliteContext->Regex == NULL) {
 
             //
-            //  Enumerate through the matches and see if there is anything to
-            //  apply.  At the start of the line, enumerate the matches to
-            //  the beginning of lines; after that enumerate the matches that
-            //  could be in the middle of a line.
+            //  With no criteria, display the line unchanged.
             //
 
-            BestMatchCriteria = NULL;
-            BestMatchOffset = 0;
-            AnyMatchFound = FALSE;
-            if (Substring.StartOfString == LineString.StartOfString) {
-                ListHead = &HiliteContext->StartMatches;
-            } else {
-                ListHead = &HiliteContext->MiddleMatches;
-            }
-            MatchCriteria = NULL;
-            MatchCriteria = HiliteGetNextMatch(HiliteContext, &ListHead, MatchCriteria);
-            while (MatchCriteria != NULL) {
-                MatchFound = FALSE;
-                if (MatchCriteria->MatchType == HiliteMatchTypeBeginsWith) {
-                    if (HiliteContext->Insensitive) {
-                        if (YoriLibCompareStringInsensitiveCount(&Substring,
-                                                                 &MatchCriteria->MatchString,
-                                                                 MatchCriteria->MatchString.LengthInChars) == 0) {
-                            MatchFound = TRUE;
-                            MatchOffset = 0;
-                        }
-                    } else {
-                        if (YoriLibCompareStringCount(&Substring,
-                                                      &MatchCriteria->MatchString,
-                                                      MatchCriteria->MatchString.LengthInChars) == 0) {
-                            MatchFound = TRUE;
-                            MatchOffset = 0;
-                        }
-                    }
-                } else if (MatchCriteria->MatchType == HiliteMatchTypeEndsWith) {
-                    YORI_STRING TailOfLine;
-
-                    if (Substring.LengthInChars >= MatchCriteria->MatchString.LengthInChars) {
-                        YoriLibInitEmptyString(&TailOfLine);
-                        TailOfLine.LengthInChars = MatchCriteria->MatchString.LengthInChars;
-                        TailOfLine.StartOfString = &Substring.StartOfString[Substring.LengthInChars - MatchCriteria->MatchString.LengthInChars];
-
-                        if (HiliteContext->Insensitive) {
-                            if (YoriLibCompareStringInsensitive(&TailOfLine, &MatchCriteria->MatchString) == 0) {
-                                MatchFound = TRUE;
-                                MatchOffset = Substring.LengthInChars - MatchCriteria->MatchString.LengthInChars;
-                            }
-                        } else {
-                            if (YoriLibCompareString(&TailOfLine, &MatchCriteria->MatchString) == 0) {
-                                MatchFound = TRUE;
-                                MatchOffset = Substring.LengthInChars - MatchCriteria->MatchString.LengthInChars;
-                            }
-                        }
-                    }
-                } else if (MatchCriteria->MatchType == HiliteMatchTypeContains) {
-                    if (HiliteContext->Insensitive) {
-                        if (YoriLibFindFirstMatchingSubstringInsensitive(&Substring, 1, &MatchCriteria->MatchString, &MatchOffset)) {
-                            MatchFound = TRUE;
-                        }
-                    } else {
-                        if (YoriLibFindFirstMatchingSubstring(&Substring, 1, &MatchCriteria->MatchString, &MatchOffset)) {
-                            MatchFound = TRUE;
-                        }
-                    }
-                }
-
-
-                //
-                //  When highlighting specific terms, look for the first match
-                //  within the line.  That string should be processed first.
-                //  When not matching specific terms, just use the first found
-                //  match to highlight the entire line.
-                //
-
-                if (MatchFound) {
+        } else if (!HiliteContext->HighlightMatchText) {
 
-                    if (!HiliteContext->HighlightMatchText) {
-                        BestMatchCriteria = MatchCriteria;
-                        BestMatchOffset = MatchOffset;
-                        break;
-                    }
-
-                    if (MatchCriteria->MatchString.LengthInChars > 0 &&
-                        (BestMatchCriteria == NULL || MatchOffset < BestMatchOffset)) {
-                        BestMatchCriteria = MatchCriteria;
-                        BestMatchOffset = MatchOffset;
-                    }
-                }
+            //
+            //  When highlighting lines, the first criteria to match anywhere
+            //  in the line determines the color of the line.
+            //
 
-                MatchCriteria = HiliteGetNextMatch(HiliteContext, &ListHead, MatchCriteria);
+            if (YoriLibRegexMatchAny(HiliteContext->Regex, &LineString, &PatternIndex)) {
+                MatchCriteria = HiliteContext->Criteria[PatternIndex];
+                YoriLibVtSetConsoleTextAttribute(YORI_LIB_OUTPUT_STDOUT, MatchCriteria->Color.Win32Attr);
+                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &LineString);
+                YoriLibVtSetConsoleTextAttribute(YORI_LIB_OUTPUT_STDOUT, HiliteContext->DefaultColor.Win32Attr);
+                DisplayOffset = LineString.LengthInChars;
             }
+        } else {
 
             //
-            //  If this is highlighting a search term only, display any
+            //  When highlighting text, find the earliest match, display any
             //  text before the match in regular color, then display the
-            //  match in the requested color.  If highlighting the whole
-            //  line, display all the text.  Then start searching again,
-            //  from all entries that can be in the middle of lines.
+            //  match in the requested color, and search again from the end
+            //  of the match.  An expression that matches empty text has
+            //  nothing to highlight, so search again from the next
+            //  character.
             //
 
-            DisplayString.StartOfString = Substring.StartOfString;
-            DisplayString.LengthInChars = Substring.LengthInChars;
-            if (BestMatchCriteria != NULL) {
-                AnyMatchFound = TRUE;
-                if (HiliteContext->HighlightMatchText) {
-                    if (BestMatchOffset > 0) {
-                        DisplayString.LengthInChars = BestMatchOffset;
-                        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &DisplayString);
-                        DisplayString.StartOfString = &Substring.StartOfString[BestMatchOffset];
-                        Substring.LengthInChars = Substring.LengthInChars - BestMatchOffset;
-                        Substring.StartOfString = &Substring.StartOfString[BestMatchOffset];
-                    }
-                    DisplayString.LengthInChars = BestMatchCriteria->MatchString.LengthInChars;
-                    //
-                    //  If searching for an empty string, treat it as not
-                    //  found and move to the next line.  This is only
-                    //  done when highlighting specific text; when
-                    //  highlighting an entire line, the empty string
-                    //  matches the line, and execution continues on the
-                    //  next line.
-                    //
-
-                    if (DisplayString.LengthInChars == 0) {
-                        ASSERT(BestMatchOffset == 0);
-                        break;
-                    }
-                    ColorToUse.Ctrl = BestMatchCriteria->Color.Ctrl;
-                    ColorToUse.Win32Attr = BestMatchCriteria->Color.Win32Attr;
-                } else {
-                    ColorToUse.Ctrl = BestMatchCriteria->Color.Ctrl;
-                    ColorToUse.Win32Attr = BestMatchCriteria->Color.Win32Attr;
+            SearchOffset = 0;
+            while (YoriLibRegexFindFirst(HiliteContext->Regex, &LineString, SearchOffset, &MatchOffset, &MatchLength, &PatternIndex)) {
+                if (MatchLength == 0) {
+                    SearchOffset = MatchOffset + 1;
+                    continue;
                 }
 
-                YoriLibVtSetConsoleTextAttribute(YORI_LIB_OUTPUT_STDOUT, ColorToUse.Win32Attr);
+                if (MatchOffset > DisplayOffset) {
+                    DisplayString.StartOfString = &LineString.StartOfString[DisplayOffset];
+                    DisplayString.LengthInChars = MatchOffset - DisplayOffset;
+                    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &DisplayString);
+                }
+
+                MatchCriteria = HiliteContext->Criteria[PatternIndex];
+                DisplayString.StartOfString = &LineString.StartOfString[MatchOffset];
+                DisplayString.LengthInChars = MatchLength;
+                YoriLibVtSetConsoleTextAttribute(YORI_LIB_OUTPUT_STDOUT, MatchCriteria->Color.Win32Attr);
                 YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &DisplayString);
                 YoriLibVtSetConsoleTextAttribute(YORI_LIB_OUTPUT_STDOUT, HiliteContext->DefaultColor.Win32Attr);
-                Substring.StartOfString = &Substring.StartOfString[DisplayString.LengthInChars];
-                Substring.LengthInChars = Substring.LengthInChars - DisplayString.LengthInChars;
-            }
-
-            //
-            //  If all matches have been navigated and the string hasn't
-            //  changed, no more matches were found, so move to the next line.
-            //
 
-            if (!AnyMatchFound) {
-                break;
+                DisplayOffset = MatchOffset + MatchLength;
+                SearchOffset = DisplayOffset;
             }
         }
 
         //
-        //  If no matches are found, display the line.
+        //  Display any text following the last match.
         //
 
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Substring);
+        DisplayString.StartOfString = &LineString.StartOfString[DisplayOffset];
+        DisplayString.LengthInChars = LineString.LengthInChars - DisplayOffset;
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &DisplayString);
 
         //
         //  Apply a newline if needed.
@@ -576,6 +598,16 @@ HiliteCleanupContext(
         YoriLibFree(MatchCriteria);
         MatchCriteria = NextMatchCriteria;
     }
+
+    if (HiliteContext->Regex != NULL) {
+        YoriLibRegexFree(HiliteContext->Regex);
+        HiliteContext->Regex = NULL;
+    }
+
+    if (HiliteContext->Criteria != NULL) {
+        YoriLibFree(HiliteContext->Criteria);
+        HiliteContext->Criteria = NULL;
+    }
 }
 
 
@@ -643,7 +675,7 @@ ENTRYPOINT(
                 HiliteCleanupContext(&HiliteContext);
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2018-2021"));
+                YoriLibDisplayMitLicense(_T("2018-2026"));
                 HiliteCleanupContext(&HiliteContext);
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
@@ -689,6 +721,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
                 HiliteContext.HighlightMatchText = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
+                HiliteContext.RegularExpressions = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 HiliteContext.Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -725,6 +760,11 @@ ENTRYPOINT(
         }
     }
 
+    if (!HiliteCompileCriteria(&HiliteContext)) {
+        HiliteCleanupContext(&HiliteContext);
+        return EXIT_FAILURE;
+    }
+
     //
     //  Attempt to enable backup privilege so an administrator can access more
     //  objects successfully.
@@ -3,7 +3,7 @@
  *
  * Yori query or set values in INI files
  *
- * Copyright (c) 2018 Malcolm J. Smith
+ * Copyright (c) 2018-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -36,17 +36,25 @@ CHAR strIniToolHelpText[] =
         "Query or set values in INI files.\n"
         "\n"
         "INITOOL [-license]\n"
+        "INITOOL -b <file> [<script>]\n"
         "INITOOL -d <file> <section> [<key>]\n"
         "INITOOL -l <file> <section>\n"
         "INITOOL -r <file> <section> <key>\n"
         "INITOOL -s <file>\n"
         "INITOOL -w <file> <section> <key> <value>\n"
         "\n"
+        "   -b             Apply operations from a script, or standard input, to an INI file\n"
         "   -d             Delete a specified key from an INI file\n"
         "   -l             List key/value pairs in a specified section from an INI file\n"
         "   -r             Read a specified key from an INI file\n"
         "   -s             List sections in an INI file\n"
-        "   -w             Write a specified value to an INI file\n";
+        "   -w             Write a specified value to an INI file\n"
+        "\n"
+        "In batch mode, each line contains an operation letter followed by its\n"
+        "arguments, for example \"w <section> <key> <value>\".  Empty lines and lines\n"
+        "starting with ';' or '#' are ignored.  The whole script is read and checked\n"
+        "before the file is loaded, the file is loaded once, all changes are written\n"
+        "back together, and the result of each read is displayed on its own line.\n";
 
 /**
  Display usage text to the user.
@@ -63,224 +71,732 @@ IniToolHelp(VOID)
 }
 
 /**
- Delete a value from an INI file.
+ A list of operations that the tool can perform.
+ */
+typedef enum _INITOOL_OPERATION {
+    IniToolOpNone = 0,
+    IniToolOpWriteValue = 1,
+    IniToolOpReadValue = 2,
+    IniToolOpDeleteValue = 3,
+    IniToolOpListSection = 4,
+    IniToolOpListSections = 5,
+    IniToolOpBatch = 6
+} INITOOL_OPERATION;
 
- @param UserFileName Pointer to the file name of the INI file.
+/**
+ State for applying one or more operations to a loaded INI file.
+ */
+typedef struct _INITOOL_CONTEXT {
+
+    /**
+     The INI file, which is loaded once and saved once regardless of the
+     number of operations applied to it.
+     */
+    PYORI_LIB_INI_DOCUMENT Document;
+
+    /**
+     A buffer to receive values queried from the INI file.  This is
+     allocated on first use and reused for each query.
+     */
+    YORI_STRING Value;
+
+    /**
+     Output generated by the operations.  This is displayed once all
+     operations have completed.
+     */
+    YORI_STRING Output;
 
- @param Section Pointer to the section within the INI file to update.
+    /**
+     If TRUE, a value read from the file is followed by a newline, so that
+     the results of multiple reads can be distinguished.
+     */
+    BOOLEAN TerminateValues;
+} INITOOL_CONTEXT, *PINITOOL_CONTEXT;
 
- @param Key Pointer to the key part of the key value pair.
+/**
+ A single operation read from a batch script, which has been checked but not
+ yet applied.
+ */
+typedef struct _INITOOL_BATCH_OPERATION {
+
+    /**
+     The operation to perform.
+     */
+    INITOOL_OPERATION Op;
+
+    /**
+     The line number of the operation within the script, used when
+     reporting errors.
+     */
+    DWORD LineNumber;
+
+    /**
+     The number of arguments, including the operation itself.
+     */
+    DWORD ArgC;
+
+    /**
+     The arguments, as returned from YoriLibCmdlineToArgcArgv.  The first
+     element is the operation, and the remainder are its arguments.
+     */
+    PYORI_STRING ArgV;
+} INITOOL_BATCH_OPERATION, *PINITOOL_BATCH_OPERATION;
+
+/**
+ Parse an operation letter into an operation.  A leading option character is
+ accepted, so batch scripts can use the same form as the command line.
+
+ @param String Pointer to the string to parse.
+
+ @return The operation, or IniToolOpNone if the string is not an operation
+         that can be applied to a loaded file.
+ */
+INITOOL_OPERATION
+IniToolOperationFromString(
+    __in PYORI_STRING String
+    )
+{
+    YORI_STRING Arg;
+
+    if (!YoriLibIsCommandLineOption(String, &Arg)) {
+        Arg.StartOfString = String->StartOfString;
+        Arg.LengthInChars = String->LengthInChars;
+    }
+
+    if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("d")) == 0) {
+        return IniToolOpDeleteValue;
+    } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
+        return IniToolOpListSection;
+    } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
+        return IniToolOpReadValue;
+    } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
+        return IniToolOpListSections;
+    } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("w")) == 0) {
+        return IniToolOpWriteValue;
+    }
+
+    return IniToolOpNone;
+}
+
+/**
+ Return the number of arguments an operation requires, not including the
+ file name.
+
+ @param Op The operation.
+
+ @param MinimumArgs On completion, the number of arguments that must be
+        specified.
+
+ @param MaximumArgs On completion, the number of arguments that can be
+        specified.
+ */
+VOID
+IniToolGetArgumentCount(
+    __in INITOOL_OPERATION Op,
+    __out PDWORD MinimumArgs,
+    __out PDWORD MaximumArgs
+    )
+{
+    switch(Op) {
+        case IniToolOpWriteValue:
+            *MinimumArgs = 3;
+            *MaximumArgs = 3;
+            break;
+        case IniToolOpReadValue:
+            *MinimumArgs = 2;
+            *MaximumArgs = 2;
+            break;
+        case IniToolOpDeleteValue:
+            *MinimumArgs = 1;
+            *MaximumArgs = 2;
+            break;
+        case IniToolOpListSection:
+            *MinimumArgs = 1;
+            *MaximumArgs = 1;
+            break;
+        default:
+            *MinimumArgs = 0;
+            *MaximumArgs = 0;
+            break;
+    }
+}
+
+/**
+ Append text to the output buffer, growing it as needed.
+
+ @param Context Pointer to the context.
+
+ @param Text Pointer to the text to append.
+
+ @param AppendNewline If TRUE, a newline is appended after the text.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
+__success(return)
 BOOL
-IniToolDeleteFromIniFile(
-    __in PYORI_STRING UserFileName,
-    __in PYORI_STRING Section,
-    __in_opt PYORI_STRING Key
+IniToolAppendOutput(
+    __in PINITOOL_CONTEXT Context,
+    __in PCYORI_STRING Text,
+    __in BOOLEAN AppendNewline
     )
 {
-    YORI_STRING RealFileName;
-
-    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
-        return FALSE;
+    DWORD LengthRequired;
+    DWORD LengthToAllocate;
+
+    LengthRequired = Context->Output.LengthInChars + Text->LengthInChars + 2;
+    if (LengthRequired > Context->Output.LengthAllocated) {
+        LengthToAllocate = Context->Output.LengthAllocated * 2;
+        if (LengthToAllocate < LengthRequired) {
+            LengthToAllocate = LengthRequired + 0x1000;
+        }
+        if (!YoriLibReallocateString(&Context->Output, LengthToAllocate)) {
+            return FALSE;
+        }
     }
 
-    if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
-        return FALSE;
+    memcpy(&Context->Output.StartOfString[Context->Output.LengthInChars], Text->StartOfString, Text->LengthInChars * sizeof(TCHAR));
+    Context->Output.LengthInChars = Context->Output.LengthInChars + Text->LengthInChars;
+    if (AppendNewline) {
+        Context->Output.StartOfString[Context->Output.LengthInChars] = '\n';
+        Context->Output.LengthInChars++;
     }
+    Context->Output.StartOfString[Context->Output.LengthInChars] = '\0';
+    return TRUE;
+}
 
-    if (!DllKernel32.pWritePrivateProfileStringW(Section->StartOfString, (Key != NULL)?Key->StartOfString:NULL, NULL, RealFileName.StartOfString)) {
-        YoriLibFreeStringContents(&RealFileName);
-        return FALSE;
+/**
+ Append each element of a multi string, as returned when querying a section
+ or the list of sections, to the output buffer, each on its own line.
+
+ @param Context Pointer to the context.  The multi string is in
+        Context->Value.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+IniToolAppendMultiString(
+    __in PINITOOL_CONTEXT Context
+    )
+{
+    YORI_STRING ThisVar;
+
+    YoriLibInitEmptyString(&ThisVar);
+    ThisVar.StartOfString = Context->Value.StartOfString;
+    while (*ThisVar.StartOfString != '\0') {
+        ThisVar.LengthInChars = _tcslen(ThisVar.StartOfString);
+        if (!IniToolAppendOutput(Context, &ThisVar, TRUE)) {
+            return FALSE;
+        }
+
+        ThisVar.StartOfString += ThisVar.LengthInChars;
+        ThisVar.StartOfString++;
     }
 
-    YoriLibFreeStringContents(&RealFileName);
     return TRUE;
 }
 
 /**
- List a section from an INI file and write it to standard output.
+ Apply a single operation to a loaded INI file.  Any changes are made to the
+ in memory copy of the file, and any results are appended to the output
+ buffer.
 
- @param UserFileName Pointer to the file name of the INI file.
+ @param Context Pointer to the context.
+
+ @param Op The operation to perform.
+
+ @param ArgC The number of arguments to the operation, which must be within
+        the range returned by @ref IniToolGetArgumentCount .
 
- @param Section Pointer to the section within the INI file to read.
+ @param ArgV Pointer to the arguments to the operation, not including the
+        file name.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
+__success(return)
 BOOL
-IniToolListSectionFromIniFile(
-    __in PYORI_STRING UserFileName,
-    __in PYORI_STRING Section
+IniToolApplyOperation(
+    __in PINITOOL_CONTEXT Context,
+    __in INITOOL_OPERATION Op,
+    __in DWORD ArgC,
+    __in PYORI_STRING ArgV
     )
 {
-    YORI_STRING RealFileName;
-    YORI_STRING Value;
-    LPTSTR ThisVar;
+    DWORD Index;
 
-    if (DllKernel32.pGetPrivateProfileSectionW == NULL) {
-        return FALSE;
+    for (Index = 0; Index < ArgC; Index++) {
+        ASSERT(YoriLibIsStringNullTerminated(&ArgV[Index]));
     }
 
-    if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
-        return FALSE;
-    }
+    //
+    //  Operations that display results need a buffer to receive them.
+    //  Sections can be much larger than individual values, so allocate
+    //  enough for those.
+    //
 
-    if (!YoriLibAllocateString(&Value, 64 * 1024)) {
-        YoriLibFreeStringContents(&RealFileName);
-        return FALSE;
+    if (Op != IniToolOpWriteValue && Op != IniToolOpDeleteValue &&
+        Context->Value.LengthAllocated == 0) {
+
+        if (!YoriLibAllocateString(&Context->Value, 64 * 1024)) {
+            return FALSE;
+        }
     }
 
-    Value.LengthInChars = DllKernel32.pGetPrivateProfileSectionW(Section->StartOfString, Value.StartOfString, Value.LengthAllocated, RealFileName.StartOfString);
-    ThisVar = Value.StartOfString;
-    while (*ThisVar != '\0') {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%s\n"), ThisVar);
+    switch(Op) {
+        case IniToolOpWriteValue:
+            return YoriLibIniSetString(Context->Document, ArgV[0].StartOfString, ArgV[1].StartOfString, ArgV[2].StartOfString);
+
+        case IniToolOpDeleteValue:
+            return YoriLibIniSetString(Context->Document, ArgV[0].StartOfString, (ArgC > 1)?ArgV[1].StartOfString:NULL, NULL);
 
-        ThisVar += _tcslen(ThisVar);
-        ThisVar++;
+        case IniToolOpReadValue:
+            Context->Value.LengthInChars = YoriLibIniGetString(Context->Document, ArgV[0].StartOfString, ArgV[1].StartOfString, _T(""), Context->Value.StartOfString, Context->Value.LengthAllocated);
+            return IniToolAppendOutput(Context, &Context->Value, Context->TerminateValues);
+
+        case IniToolOpListSection:
+            Context->Value.LengthInChars = YoriLibIniGetSection(Context->Document, ArgV[0].StartOfString, Context->Value.StartOfString, Context->Value.LengthAllocated);
+            return IniToolAppendMultiString(Context);
+
+        case IniToolOpListSections:
+            Context->Value.LengthInChars = YoriLibIniGetSectionNames(Context->Document, Context->Value.StartOfString, Context->Value.LengthAllocated);
+            return IniToolAppendMultiString(Context);
+
+        default:
+            break;
     }
 
-    YoriLibFreeStringContents(&RealFileName);
-    YoriLibFreeStringContents(&Value);
-    return TRUE;
+    return FALSE;
 }
 
 /**
- List sections from an INI file and write them to standard output.
+ Load an INI file so that operations can be applied to it.
+
+ @param Context Pointer to the context to initialize.
 
  @param UserFileName Pointer to the file name of the INI file.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
+__success(return)
 BOOL
-IniToolListSectionsFromIniFile(
+IniToolLoad(
+    __out PINITOOL_CONTEXT Context,
     __in PYORI_STRING UserFileName
     )
 {
     YORI_STRING RealFileName;
-    YORI_STRING Value;
-    LPTSTR ThisVar;
+    BOOL Result;
 
-    if (DllKernel32.pGetPrivateProfileSectionNamesW == NULL) {
-        return FALSE;
-    }
+    ZeroMemory(Context, sizeof(INITOOL_CONTEXT));
+    YoriLibInitEmptyString(&Context->Value);
+    YoriLibInitEmptyString(&Context->Output);
 
     if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&Value, 64 * 1024)) {
-        YoriLibFreeStringContents(&RealFileName);
+    Result = YoriLibIniLoad(&RealFileName, &Context->Document);
+    YoriLibFreeStringContents(&RealFileName);
+    return Result;
+}
+
+/**
+ Free a context after operations have been applied.  Any changes which have
+ not been saved are discarded.
+
+ @param Context Pointer to the context.
+ */
+VOID
+IniToolCleanup(
+    __in PINITOOL_CONTEXT Context
+    )
+{
+    if (Context->Document != NULL) {
+        YoriLibIniFree(Context->Document);
+        Context->Document = NULL;
+    }
+    YoriLibFreeStringContents(&Context->Value);
+    YoriLibFreeStringContents(&Context->Output);
+}
+
+/**
+ Write any changes back to the INI file, and display any output generated by
+ the operations that were applied.  The INI engine only writes the file if
+ it has been modified, and replaces the file as a whole, so other readers
+ observe either all of the changes or none of them.  The file is released
+ before output is displayed, so a slow reader of the output does not
+ prevent other processes from updating the file.
+
+ @param Context Pointer to the context.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+IniToolCommit(
+    __in PINITOOL_CONTEXT Context
+    )
+{
+    if (!YoriLibIniSave(Context->Document)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: could not write file\n"));
         return FALSE;
     }
 
-    Value.LengthInChars = DllKernel32.pGetPrivateProfileSectionNamesW(Value.StartOfString, Value.LengthAllocated, RealFileName.StartOfString);
-    ThisVar = Value.StartOfString;
-    while (*ThisVar != '\0') {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%s\n"), ThisVar);
+    YoriLibIniFree(Context->Document);
+    Context->Document = NULL;
 
-        ThisVar += _tcslen(ThisVar);
-        ThisVar++;
+    if (Context->Output.LengthInChars > 0) {
+        YoriLibOutputString(GetStdHandle(STD_OUTPUT_HANDLE), 0, &Context->Output);
     }
 
-    YoriLibFreeStringContents(&RealFileName);
-    YoriLibFreeStringContents(&Value);
     return TRUE;
 }
 
 /**
- Read a value from an INI file and write it to standard output.
+ Apply a single operation specified on the command line to an INI file.
 
  @param UserFileName Pointer to the file name of the INI file.
 
- @param Section Pointer to the section within the INI file to read.
+ @param Op The operation to perform.
 
- @param Key Pointer to the key part of the key value pair.
+ @param ArgC The number of arguments to the operation.
+
+ @param ArgV Pointer to the arguments to the operation, not including the
+        file name.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
+__success(return)
 BOOL
-IniToolReadFromIniFile(
+IniToolSingleOperation(
     __in PYORI_STRING UserFileName,
-    __in PYORI_STRING Section,
-    __in PYORI_STRING Key
+    __in INITOOL_OPERATION Op,
+    __in DWORD ArgC,
+    __in PYORI_STRING ArgV
     )
 {
-    YORI_STRING RealFileName;
-    YORI_STRING Value;
+    INITOOL_CONTEXT Context;
+    BOOL Result;
 
-    if (DllKernel32.pGetPrivateProfileStringW == NULL) {
+    if (!IniToolLoad(&Context, UserFileName)) {
+        IniToolCleanup(&Context);
         return FALSE;
     }
 
-    if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
-        return FALSE;
+    Result = FALSE;
+    if (IniToolApplyOperation(&Context, Op, ArgC, ArgV)) {
+        Result = IniToolCommit(&Context);
     }
 
-    if (!YoriLibAllocateString(&Value, 16 * 1024)) {
-        YoriLibFreeStringContents(&RealFileName);
-        return FALSE;
+    IniToolCleanup(&Context);
+    return Result;
+}
+
+/**
+ Free the arguments of a set of operations read from a batch script, and the
+ array of operations.
+
+ @param Operations Pointer to an array of operations.
+
+ @param OperationCount The number of elements in the array.
+ */
+VOID
+IniToolFreeBatchOperations(
+    __in_opt PINITOOL_BATCH_OPERATION Operations,
+    __in DWORD OperationCount
+    )
+{
+    DWORD Index;
+    DWORD ArgIndex;
+
+    if (Operations == NULL) {
+        return;
     }
 
-    Value.LengthInChars = DllKernel32.pGetPrivateProfileStringW(Section->StartOfString, Key->StartOfString, _T(""), Value.StartOfString, Value.LengthAllocated, RealFileName.StartOfString);
-    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Value);
+    for (Index = 0; Index < OperationCount; Index++) {
+        for (ArgIndex = 0; ArgIndex < Operations[Index].ArgC; ArgIndex++) {
+            YoriLibFreeStringContents(&Operations[Index].ArgV[ArgIndex]);
+        }
+        YoriLibDereference(Operations[Index].ArgV);
+    }
 
-    YoriLibFreeStringContents(&RealFileName);
-    YoriLibFreeStringContents(&Value);
-    return TRUE;
+    YoriLibFree(Operations);
 }
 
 /**
- Write a value to an INI file.
-
- @param UserFileName Pointer to the file name of the INI file.
+ Parse a single line from a batch script into an operation and check that it
+ has a valid number of arguments.
 
- @param Section Pointer to the section within the INI file to update.
+ @param Line Pointer to the line, which is NULL terminated.
 
- @param Key Pointer to the key part of the key value pair.
+ @param LineNumber The line number, used when reporting errors.
 
- @param Value Pointer to the new value to set into the file.
+ @param Operation On successful completion, populated with the operation and
+        its arguments.  The arguments should be freed with
+        @ref IniToolFreeBatchOperations .
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
+__success(return)
 BOOL
-IniToolWriteToIniFile(
-    __in PYORI_STRING UserFileName,
-    __in PYORI_STRING Section,
-    __in PYORI_STRING Key,
-    __in PYORI_STRING Value
+IniToolParseBatchLine(
+    __in PYORI_STRING Line,
+    __in DWORD LineNumber,
+    __out PINITOOL_BATCH_OPERATION Operation
     )
 {
-    YORI_STRING RealFileName;
+    PYORI_STRING ArgV;
+    DWORD ArgC;
+    DWORD Index;
+    DWORD MinimumArgs;
+    DWORD MaximumArgs;
+    INITOOL_OPERATION Op;
+    BOOL Result;
+
+    ASSERT(YoriLibIsStringNullTerminated(Line));
 
-    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
+    ArgV = YoriLibCmdlineToArgcArgv(Line->StartOfString, (DWORD)-1, FALSE, &ArgC);
+    if (ArgV == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: out of memory\n"));
         return FALSE;
     }
 
-    if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
+    Result = FALSE;
+    Op = IniToolOpNone;
+    if (ArgC > 0) {
+        Op = IniToolOperationFromString(&ArgV[0]);
+    }
+
+    if (Op == IniToolOpNone) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: line %i: operation not understood: %y\n"), LineNumber, Line);
+    } else {
+        IniToolGetArgumentCount(Op, &MinimumArgs, &MaximumArgs);
+        if (ArgC - 1 < MinimumArgs) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: line %i: missing argument\n"), LineNumber);
+        } else if (ArgC - 1 > MaximumArgs) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: line %i: too many arguments\n"), LineNumber);
+        } else {
+            Result = TRUE;
+        }
+    }
+
+    if (!Result) {
+        for (Index = 0; Index < ArgC; Index++) {
+            YoriLibFreeStringContents(&ArgV[Index]);
+        }
+        YoriLibDereference(ArgV);
         return FALSE;
     }
 
-    if (!DllKernel32.pWritePrivateProfileStringW(Section->StartOfString, Key->StartOfString, Value->StartOfString, RealFileName.StartOfString)) {
-        YoriLibFreeStringContents(&RealFileName);
+    Operation->Op = Op;
+    Operation->LineNumber = LineNumber;
+    Operation->ArgC = ArgC;
+    Operation->ArgV = ArgV;
+    return TRUE;
+}
+
+/**
+ Read every operation from a batch script and check that each is valid.
+
+ @param ScriptHandle Handle to the script.
+
+ @param Operations On successful completion, updated to point to an array of
+        operations.  This may be NULL if the script contains no operations.
+        The array should be freed with @ref IniToolFreeBatchOperations .
+
+ @param OperationCount On successful completion, updated to contain the
+        number of operations in the array.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+IniToolReadBatchScript(
+    __in HANDLE ScriptHandle,
+    __out PINITOOL_BATCH_OPERATION *Operations,
+    __out PDWORD OperationCount
+    )
+{
+    PINITOOL_BATCH_OPERATION NewOperations;
+    PINITOOL_BATCH_OPERATION Array;
+    YORI_STRING LineString;
+    YORI_STRING Line;
+    PVOID LineContext;
+    DWORD Count;
+    DWORD Allocated;
+    DWORD LineNumber;
+    BOOL Result;
+
+    YoriLibInitEmptyString(&LineString);
+    YoriLibInitEmptyString(&Line);
+    LineContext = NULL;
+    LineNumber = 0;
+    Array = NULL;
+    Count = 0;
+    Allocated = 0;
+    Result = TRUE;
+
+    while (TRUE) {
+        if (!YoriLibReadLineToString(&LineString, &LineContext, ScriptHandle)) {
+            break;
+        }
+
+        LineNumber++;
+
+        Line.StartOfString = LineString.StartOfString;
+        Line.LengthInChars = LineString.LengthInChars;
+        YoriLibTrimSpaces(&Line);
+
+        if (Line.LengthInChars == 0 ||
+            Line.StartOfString[0] == ';' ||
+            Line.StartOfString[0] == '#') {
+
+            continue;
+        }
+
+        //
+        //  The trimmed line is still within the buffer that was read, so it
+        //  can be terminated in place for parsing.
+        //
+
+        Line.StartOfString[Line.LengthInChars] = '\0';
+        Line.LengthAllocated = Line.LengthInChars + 1;
+
+        if (Count == Allocated) {
+            Allocated = Allocated * 2 + 16;
+            NewOperations = YoriLibMalloc(Allocated * sizeof(INITOOL_BATCH_OPERATION));
+            if (NewOperations == NULL) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: out of memory\n"));
+                Result = FALSE;
+                break;
+            }
+            if (Array != NULL) {
+                memcpy(NewOperations, Array, Count * sizeof(INITOOL_BATCH_OPERATION));
+                YoriLibFree(Array);
+            }
+            Array = NewOperations;
+        }
+
+        if (!IniToolParseBatchLine(&Line, LineNumber, &Array[Count])) {
+            Result = FALSE;
+            break;
+        }
+        Count++;
+    }
+
+    YoriLibFreeStringContents(&LineString);
+    YoriLibLineReadCloseOrCache(LineContext);
+
+    if (!Result) {
+        IniToolFreeBatchOperations(Array, Count);
         return FALSE;
     }
 
-    YoriLibFreeStringContents(&RealFileName);
+    *Operations = Array;
+    *OperationCount = Count;
     return TRUE;
 }
 
 /**
- A list of operations that the tool can perform.
+ Apply a series of operations from a script to an INI file.  The whole
+ script is read and checked before the INI file is loaded, so the file is
+ only held for as long as it takes to apply the operations, regardless of
+ how long the script takes to arrive.  The file is loaded once, every
+ operation is applied to the in memory copy, and the file is written back
+ once, all while holding the lock taken when the file is loaded.  If any
+ operation cannot be applied, no changes are written and no output is
+ displayed.
+
+ @param UserFileName Pointer to the file name of the INI file.
+
+ @param UserScriptName Optionally points to the file name of a script
+        containing operations.  If not specified, operations are read from
+        standard input.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
  */
-typedef enum _INITOOL_OPERATION {
-    IniToolOpNone = 0,
-    IniToolOpWriteValue = 1,
-    IniToolOpReadValue = 2,
-    IniToolOpDeleteValue = 3,
-    IniToolOpListSection = 4,
-    IniToolOpListSections = 5
-} INITOOL_OPERATION;
+__success(return)
+BOOL
+IniToolBatch(
+    __in PYORI_STRING UserFileName,
+    __in_opt PYORI_STRING UserScriptName
+    )
+{
+    INITOOL_CONTEXT Context;
+    PINITOOL_BATCH_OPERATION Operations;
+    PINITOOL_BATCH_OPERATION Operation;
+    YORI_STRING ScriptName;
+    HANDLE ScriptHandle;
+    DWORD OperationCount;
+    DWORD Index;
+    BOOL Result;
+
+    if (UserScriptName != NULL) {
+        if (!YoriLibUserStringToSingleFilePath(UserScriptName, TRUE, &ScriptName)) {
+            return FALSE;
+        }
+
+        ScriptHandle = CreateFile(ScriptName.StartOfString,
+                                  GENERIC_READ,
+                                  FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                  NULL,
+                                  OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN,
+                                  NULL);
+
+        if (ScriptHandle == INVALID_HANDLE_VALUE) {
+            DWORD LastError = GetLastError();
+            LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: open of %y failed: %s"), &ScriptName, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            YoriLibFreeStringContents(&ScriptName);
+            return FALSE;
+        }
+
+        YoriLibFreeStringContents(&ScriptName);
+    } else {
+        if (YoriLibIsStdInConsole()) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: no script provided\n"));
+            return FALSE;
+        }
+
+        ScriptHandle = GetStdHandle(STD_INPUT_HANDLE);
+    }
+
+    Result = IniToolReadBatchScript(ScriptHandle, &Operations, &OperationCount);
+    if (UserScriptName != NULL) {
+        CloseHandle(ScriptHandle);
+    }
+
+    if (!Result) {
+        return FALSE;
+    }
+
+    if (!IniToolLoad(&Context, UserFileName)) {
+        IniToolCleanup(&Context);
+        IniToolFreeBatchOperations(Operations, OperationCount);
+        return FALSE;
+    }
+
+    Context.TerminateValues = TRUE;
+
+    for (Index = 0; Index < OperationCount; Index++) {
+        Operation = &Operations[Index];
+        if (!IniToolApplyOperation(&Context, Operation->Op, Operation->ArgC - 1, &Operation->ArgV[1])) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: line %i: operation failed\n"), Operation->LineNumber);
+            Result = FALSE;
+            break;
+        }
+    }
+
+    if (Result) {
+        Result = IniToolCommit(&Context);
+    }
+
+    IniToolCleanup(&Context);
+    IniToolFreeBatchOperations(Operations, OperationCount);
+    return Result;
+}
 
 #ifdef YORI_BUILTIN
 /**
@@ -313,6 +829,9 @@ ENTRYPOINT(
     BOOL ArgumentUnderstood;
     DWORD i;
     DWORD StartArg = 0;
+    DWORD MinimumArgs;
+    DWORD MaximumArgs;
+    DWORD OpArgC;
     YORI_STRING Arg;
     INITOOL_OPERATION Op;
 
@@ -329,8 +848,11 @@ ENTRYPOINT(
                 IniToolHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2018"));
+                YoriLibDisplayMitLicense(_T("2018-2026"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
+                Op = IniToolOpBatch;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("d")) == 0) {
                 Op = IniToolOpDeleteValue;
                 ArgumentUnderstood = TRUE;
@@ -367,56 +889,34 @@ ENTRYPOINT(
         return EXIT_FAILURE;
     }
 
-    if (Op == IniToolOpWriteValue) {
-        if (StartArg == 0 || StartArg + 4 > ArgC) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: missing argument\n"));
-            return EXIT_FAILURE;
-        }
-
-        if (!IniToolWriteToIniFile(&ArgV[StartArg], &ArgV[StartArg + 1], &ArgV[StartArg + 2], &ArgV[StartArg + 3])) {
-            return EXIT_FAILURE;
-        }
-    } else if (Op == IniToolOpReadValue) {
-        if (StartArg == 0 || StartArg + 3 > ArgC) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: missing argument\n"));
-            return EXIT_FAILURE;
-        }
+    if (StartArg == 0 || StartArg >= ArgC) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: missing argument\n"));
+        return EXIT_FAILURE;
+    }
 
-        if (!IniToolReadFromIniFile(&ArgV[StartArg], &ArgV[StartArg + 1], &ArgV[StartArg + 2])) {
-            return EXIT_FAILURE;
-        }
-    } else if (Op == IniToolOpDeleteValue) {
-        if (StartArg == 0 || StartArg + 2 > ArgC) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: missing argument\n"));
+    if (Op == IniToolOpBatch) {
+        if (!IniToolBatch(&ArgV[StartArg], (StartArg + 1 < ArgC)?&ArgV[StartArg + 1]:NULL)) {
             return EXIT_FAILURE;
         }
+    } else {
 
-        if (StartArg + 2 < ArgC) {
+        //
+        //  Arguments following the file name are passed to the operation.
+        //  Any beyond what the operation uses are ignored.
+        //
 
-            if (!IniToolDeleteFromIniFile(&ArgV[StartArg], &ArgV[StartArg + 1], &ArgV[StartArg + 2])) {
-                return EXIT_FAILURE;
-            }
-        } else {
-            if (!IniToolDeleteFromIniFile(&ArgV[StartArg], &ArgV[StartArg + 1], NULL)) {
-                return EXIT_FAILURE;
-            }
-        }
-    } else if (Op == IniToolOpListSection) {
-        if (StartArg == 0 || StartArg + 2 > ArgC) {
+        IniToolGetArgumentCount(Op, &MinimumArgs, &MaximumArgs);
+        OpArgC = ArgC - StartArg - 1;
+        if (OpArgC < MinimumArgs) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: missing argument\n"));
             return EXIT_FAILURE;
         }
 
-        if (!IniToolListSectionFromIniFile(&ArgV[StartArg], &ArgV[StartArg + 1])) {
-            return EXIT_FAILURE;
-        }
-    } else if (Op == IniToolOpListSections) {
-        if (StartArg == 0 || StartArg + 1 > ArgC) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: missing argument\n"));
-            return EXIT_FAILURE;
+        if (OpArgC > MaximumArgs) {
+            OpArgC = MaximumArgs;
         }
 
-        if (!IniToolListSectionsFromIniFile(&ArgV[StartArg])) {
+        if (!IniToolSingleOperation(&ArgV[StartArg], Op, OpArgC, &ArgV[StartArg + 1])) {
             return EXIT_FAILURE;
         }
     }
@@ -3,7 +3,7 @@
  *
  * Yori shell terminate processes
  *
- * Copyright (c) 2020 Malcolm J. Smith
+ * Copyright (c) 2020-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -35,7 +35,10 @@ CHAR strKillHelpText[] =
         "\n"
         "Terminate processes.\n"
         "\n"
-        "KILL [-license] <pid>|<exename>\n";
+        "KILL [-license] [-s] [-t] <pid>|<exename>\n"
+        "\n"
+        "   -s             Only terminate processes by name in the current session\n"
+        "   -t             Terminate the process and all of its descendants\n";
 
 /**
  Display usage text to the user.
@@ -51,6 +54,151 @@ KillHelp(VOID)
     return TRUE;
 }
 
+/**
+ Context describing the processes to terminate.
+ */
+typedef struct _KILL_CONTEXT {
+
+    /**
+     A snapshot of processes in the system, or NULL if one has not been
+     captured yet.  This is only needed to find processes by name or to
+     find descendants.
+     */
+    PYORI_LIB_PROCESS_SNAPSHOT Snapshot;
+
+    /**
+     If TRUE, the descendants of each process are also terminated.
+     */
+    BOOLEAN KillTree;
+
+    /**
+     If TRUE, processes found by name are only terminated if they are in
+     the same session as this process.
+     */
+    BOOLEAN CurrentSessionOnly;
+
+    /**
+     The session of this process.
+     */
+    DWORD SessionId;
+
+    /**
+     When matching processes by name, the name to compare against.
+     */
+    YORI_STRING NameToCompare;
+
+    /**
+     When matching processes by name, the number of characters to compare,
+     or (DWORD)-1 to compare the entire name.
+     */
+    DWORD CharsToCompare;
+
+    /**
+     An array of process IDs to terminate.
+     */
+    PDWORD_PTR Pids;
+
+    /**
+     The number of process IDs in the Pids array.
+     */
+    DWORD PidCount;
+
+    /**
+     The number of elements allocated in the Pids array.
+     */
+    DWORD PidsAllocated;
+
+    /**
+     The number of processes that have been terminated.
+     */
+    DWORD KillCount;
+
+} KILL_CONTEXT, *PKILL_CONTEXT;
+
+/**
+ Add a process ID to the array of processes to terminate.
+
+ @param KillContext Pointer to the kill context.
+
+ @param ProcessPid The process ID to add.
+
+ @return TRUE to indicate success, FALSE to indicate allocation failure.
+ */
+BOOL
+KillAddPid(
+    __in PKILL_CONTEXT KillContext,
+    __in DWORD_PTR ProcessPid
+    )
+{
+    PDWORD_PTR NewPids;
+    DWORD NewAllocated;
+
+    if (KillContext->PidCount == KillContext->PidsAllocated) {
+        NewAllocated = KillContext->PidsAllocated * 2;
+        if (NewAllocated == 0) {
+            NewAllocated = 64;
+        }
+
+        NewPids = YoriLibMalloc(NewAllocated * sizeof(DWORD_PTR));
+        if (NewPids == NULL) {
+            return FALSE;
+        }
+
+        if (KillContext->PidCount > 0) {
+            memcpy(NewPids, KillContext->Pids, KillContext->PidCount * sizeof(DWORD_PTR));
+        }
+
+        if (KillContext->Pids != NULL) {
+            YoriLibFree(KillContext->Pids);
+        }
+
+        KillContext->Pids = NewPids;
+        KillContext->PidsAllocated = NewAllocated;
+    }
+
+    KillContext->Pids[KillContext->PidCount] = ProcessPid;
+    KillContext->PidCount++;
+    return TRUE;
+}
+
+/**
+ Capture a snapshot of processes in the system if one has not been captured
+ already.
+
+ @param KillContext Pointer to the kill context.
+
+ @return TRUE to indicate a snapshot is available, FALSE if it is not.
+ */
+BOOL
+KillCaptureSnapshot(
+    __in PKILL_CONTEXT KillContext
+    )
+{
+    PYORI_SYSTEM_PROCESS_INFORMATION Process;
+
+    if (KillContext->Snapshot != NULL) {
+        return TRUE;
+    }
+
+    if (DllNtDll.pNtQuerySystemInformation == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("OS support not present\n"));
+        return FALSE;
+    }
+
+    if (!YoriLibCreateProcessSnapshot(&KillContext->Snapshot)) {
+        KillContext->Snapshot = NULL;
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("kill: could not enumerate processes\n"));
+        return FALSE;
+    }
+
+    Process = YoriLibProcessSnapshotFindById(KillContext->Snapshot, GetCurrentProcessId());
+    if (Process != NULL) {
+        KillContext->SessionId = Process->SessionId;
+    }
+
+    return TRUE;
+}
+
 /**
  Terminate a process by process ID.  Note that this routine displays errors
  to the user when the process cannot be opened or terminated.
@@ -92,70 +240,306 @@ KillTerminateProcessById(
 }
 
 /**
- Kill processes with an image name that matches the input string.
+ A callback invoked for each process within a tree to add it to the array
+ of processes to terminate.
 
- @param ProcessList Pointer to a list of all processes in the system.
- 
- @param ProcessName Specifies the process name to terminate.
+ @param Process Pointer to the process.
+
+ @param Context Pointer to the kill context.
 
- @return The number of processes successfully terminated.
+ @return TRUE to continue enumerating, FALSE to stop.
  */
-__success(return)
-DWORD
-KillTerminateProcessByName(
-    __in PYORI_SYSTEM_PROCESS_INFORMATION ProcessList,
-    __in PYORI_STRING ProcessName
+BOOL
+KillAddTreeProcess(
+    __in PYORI_SYSTEM_PROCESS_INFORMATION Process,
+    __in PVOID Context
     )
 {
-    PYORI_SYSTEM_PROCESS_INFORMATION CurrentEntry;
-    YORI_STRING BaseName;
-    YORI_STRING NameToCompare;
-    DWORD CharsToCompare;
-    DWORD KillCount;
+    if (Process->ProcessId == GetCurrentProcessId()) {
+        return TRUE;
+    }
+
+    return KillAddPid((PKILL_CONTEXT)Context, Process->ProcessId);
+}
+
+/**
+ Determine whether a process has an ancestor that is also a root of a tree
+ being terminated, in which case the process is already part of that tree.
+
+ @param KillContext Pointer to the kill context.
+
+ @param Process Pointer to the process to check.
+
+ @param Roots Pointer to an array of process IDs forming the roots of trees
+        to terminate.
+
+ @param RootCount The number of elements in the Roots array.
+
+ @return TRUE if an ancestor of the process is in the Roots array.
+ */
+BOOL
+KillIsDescendantOfRoot(
+    __in PKILL_CONTEXT KillContext,
+    __in PYORI_SYSTEM_PROCESS_INFORMATION Process,
+    __in PDWORD_PTR Roots,
+    __in DWORD RootCount
+    )
+{
+    PYORI_SYSTEM_PROCESS_INFORMATION Ancestor;
+    DWORD Index;
+
+    Ancestor = YoriLibProcessSnapshotFindParent(KillContext->Snapshot, Process);
+    while (Ancestor != NULL) {
+        for (Index = 0; Index < RootCount; Index++) {
+            if (Roots[Index] == Ancestor->ProcessId) {
+                return TRUE;
+            }
+        }
+        Ancestor = YoriLibProcessSnapshotFindParent(KillContext->Snapshot, Ancestor);
+    }
+
+    return FALSE;
+}
+
+/**
+ Terminate all processes in the Pids array.  If tree termination was
+ requested, the array is first expanded to include all descendants.  Where
+ possible, processes are placed into a job object and terminated together,
+ so that a process that is not yet terminated cannot launch a child that
+ escapes.  Processes that cannot be added to the job are terminated
+ individually.
+
+ @param KillContext Pointer to the kill context.
+ */
+VOID
+KillTerminatePendingProcesses(
+    __in PKILL_CONTEXT KillContext
+    )
+{
+    PYORI_SYSTEM_PROCESS_INFORMATION Process;
+    PDWORD_PTR Roots;
+    DWORD RootCount;
+    DWORD TreeCount;
+    PHANDLE Handles;
+    PBOOLEAN InJob;
+    HANDLE hJob;
+    DWORD JobCount;
+    DWORD Index;
+    DWORD LastError;
+    LPTSTR ErrText;
+
+    if (KillContext->PidCount == 0) {
+        return;
+    }
 
     //
-    //  If the process name ends in '*', only compare the characters up to
-    //  that point, otherwise compare all.
+    //  Replace the array of roots with every process in each tree.  A
+    //  root that descends from another root is already covered by that
+    //  tree.
     //
 
-    YoriLibInitEmptyString(&NameToCompare);
-    NameToCompare.StartOfString = ProcessName->StartOfString;
-    NameToCompare.LengthInChars = ProcessName->LengthInChars;
-    CharsToCompare = (DWORD)-1;
+    if (KillContext->KillTree && KillCaptureSnapshot(KillContext)) {
+        Roots = KillContext->Pids;
+        RootCount = KillContext->PidCount;
+        KillContext->Pids = NULL;
+        KillContext->PidCount = 0;
+        KillContext->PidsAllocated = 0;
+
+        for (Index = 0; Index < RootCount; Index++) {
+            Process = YoriLibProcessSnapshotFindById(KillContext->Snapshot, Roots[Index]);
+            if (Process != NULL &&
+                KillIsDescendantOfRoot(KillContext, Process, Roots, RootCount)) {
+
+                continue;
+            }
+
+            //
+            //  If nothing was found, keep the root so the failure to
+            //  terminate it is reported.
+            //
+
+            TreeCount = YoriLibProcessSnapshotEnumerateTree(KillContext->Snapshot, Roots[Index], KillAddTreeProcess, KillContext);
+            if (TreeCount == 0 || TreeCount == (DWORD)-1) {
+                KillAddPid(KillContext, Roots[Index]);
+            }
+        }
 
-    if (NameToCompare.LengthInChars > 0 &&
-        NameToCompare.StartOfString[NameToCompare.LengthInChars - 1] == '*') {
+        YoriLibFree(Roots);
 
-        NameToCompare.LengthInChars--;
-        CharsToCompare = NameToCompare.LengthInChars;
+        if (KillContext->PidCount == 0) {
+            return;
+        }
     }
 
-    YoriLibInitEmptyString(&BaseName);
-    KillCount = 0;
+    Handles = YoriLibMalloc(KillContext->PidCount * (sizeof(HANDLE) + sizeof(BOOLEAN)));
+    if (Handles == NULL) {
+        for (Index = 0; Index < KillContext->PidCount; Index++) {
+            if (KillTerminateProcessById((DWORD)KillContext->Pids[Index])) {
+                KillContext->KillCount++;
+            }
+        }
+        KillContext->PidCount = 0;
+        return;
+    }
+    InJob = (PBOOLEAN)(Handles + KillContext->PidCount);
+
+    hJob = NULL;
+    if (KillContext->PidCount > 1) {
+        hJob = YoriLibCreateJobObject();
+    }
 
     //
-    //  Iterate through the list and kill the process IDs of anything that
-    //  matches.
+    //  Open every process before terminating any, so that a process ID
+    //  cannot be reused by a new process while this is in progress.
     //
 
-    CurrentEntry = ProcessList;
-    do {
-        BaseName.StartOfString = CurrentEntry->ImageName;
-        BaseName.LengthInChars = CurrentEntry->ImageNameLengthInBytes / sizeof(WCHAR);
+    JobCount = 0;
+    for (Index = 0; Index < KillContext->PidCount; Index++) {
+        InJob[Index] = FALSE;
+        Handles[Index] = NULL;
+        if (hJob != NULL) {
+            Handles[Index] = OpenProcess(PROCESS_TERMINATE | PROCESS_SET_QUOTA, FALSE, (DWORD)KillContext->Pids[Index]);
+        }
+        if (Handles[Index] == NULL) {
+            Handles[Index] = OpenProcess(PROCESS_TERMINATE, FALSE, (DWORD)KillContext->Pids[Index]);
+        }
+        if (Handles[Index] == NULL) {
+            LastError = GetLastError();
+            ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("kill: could not terminate process %i: %s"), (DWORD)KillContext->Pids[Index], ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            continue;
+        }
+
+        if (hJob != NULL &&
+            YoriLibAssignProcessToJobObject(hJob, Handles[Index])) {
+
+            InJob[Index] = TRUE;
+            JobCount++;
+        }
+    }
 
-        if (YoriLibCompareStringInsensitiveCount(&BaseName, &NameToCompare, CharsToCompare) == 0) {
-            if (KillTerminateProcessById((DWORD)CurrentEntry->ProcessId)) {
-                KillCount++;
+    if (JobCount > 0) {
+        if (YoriLibTerminateJobObject(hJob, EXIT_FAILURE)) {
+            KillContext->KillCount += JobCount;
+        } else {
+            for (Index = 0; Index < KillContext->PidCount; Index++) {
+                InJob[Index] = FALSE;
             }
         }
+    }
 
-        if (CurrentEntry->NextEntryOffset == 0) {
-            break;
+    for (Index = 0; Index < KillContext->PidCount; Index++) {
+        if (Handles[Index] == NULL) {
+            continue;
+        }
+
+        if (!InJob[Index]) {
+            if (TerminateProcess(Handles[Index], EXIT_FAILURE)) {
+                KillContext->KillCount++;
+            } else {
+                LastError = GetLastError();
+                ErrText = YoriLibGetWinErrorText(LastError);
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("kill: could not terminate process %i: %s"), (DWORD)KillContext->Pids[Index], ErrText);
+                YoriLibFreeWinErrorText(ErrText);
+            }
         }
-        CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
-    } while(TRUE);
 
-    return KillCount;
+        CloseHandle(Handles[Index]);
+    }
+
+    if (hJob != NULL) {
+        CloseHandle(hJob);
+    }
+
+    YoriLibFree(Handles);
+    KillContext->PidCount = 0;
+}
+
+/**
+ A callback invoked for each process that may match a name to terminate.
+
+ @param Process Pointer to the process.
+
+ @param Context Pointer to the kill context.
+
+ @return TRUE to continue enumerating, FALSE to stop.
+ */
+BOOL
+KillMatchProcessByName(
+    __in PYORI_SYSTEM_PROCESS_INFORMATION Process,
+    __in PVOID Context
+    )
+{
+    PKILL_CONTEXT KillContext;
+    YORI_STRING BaseName;
+
+    KillContext = (PKILL_CONTEXT)Context;
+
+    if (KillContext->CurrentSessionOnly &&
+        Process->SessionId != KillContext->SessionId) {
+
+        return TRUE;
+    }
+
+    if (KillContext->CharsToCompare != (DWORD)-1) {
+        YoriLibInitEmptyString(&BaseName);
+        BaseName.StartOfString = Process->ImageName;
+        BaseName.LengthInChars = Process->ImageNameLengthInBytes / sizeof(WCHAR);
+
+        if (YoriLibCompareStringInsensitiveCount(&BaseName, &KillContext->NameToCompare, KillContext->CharsToCompare) != 0) {
+            return TRUE;
+        }
+    }
+
+    if (Process->ProcessId == GetCurrentProcessId()) {
+        return TRUE;
+    }
+
+    return KillAddPid(KillContext, Process->ProcessId);
+}
+
+/**
+ Find processes with an image name that matches the input string, and add
+ them to the array of processes to terminate.
+
+ @param KillContext Pointer to the kill context.
+
+ @param ProcessName Specifies the process name to terminate.
+ */
+VOID
+KillFindProcessesByName(
+    __in PKILL_CONTEXT KillContext,
+    __in PYORI_STRING ProcessName
+    )
+{
+    //
+    //  If the process name ends in '*', only compare the characters up to
+    //  that point, otherwise compare all.
+    //
+
+    YoriLibInitEmptyString(&KillContext->NameToCompare);
+    KillContext->NameToCompare.StartOfString = ProcessName->StartOfString;
+    KillContext->NameToCompare.LengthInChars = ProcessName->LengthInChars;
+    KillContext->CharsToCompare = (DWORD)-1;
+
+    if (KillContext->NameToCompare.LengthInChars > 0 &&
+        KillContext->NameToCompare.StartOfString[KillContext->NameToCompare.LengthInChars - 1] == '*') {
+
+        KillContext->NameToCompare.LengthInChars--;
+        KillContext->CharsToCompare = KillContext->NameToCompare.LengthInChars;
+    }
+
+    //
+    //  A complete name can be found from the name index.  A prefix needs
+    //  to be compared against every process.
+    //
+
+    if (KillContext->CharsToCompare == (DWORD)-1) {
+        YoriLibProcessSnapshotEnumerateByName(KillContext->Snapshot, &KillContext->NameToCompare, KillMatchProcessByName, KillContext);
+    } else {
+        YoriLibProcessSnapshotEnumerate(KillContext->Snapshot, KillMatchProcessByName, KillContext);
+    }
 }
 
 
@@ -189,13 +573,13 @@ ENTRYPOINT(
 {
     BOOL ArgumentUnderstood;
     DWORD i;
-    DWORD StartArg = 1;
+    DWORD StartArg = 0;
     YORI_STRING Arg;
-    DWORD ProcessPid = 0;
     LONGLONG llTemp;
     DWORD CharsConsumed;
-    DWORD KillCount;
-    PYORI_SYSTEM_PROCESS_INFORMATION ProcessInfo = NULL;
+    KILL_CONTEXT KillContext;
+
+    ZeroMemory(&KillContext, sizeof(KillContext));
 
     for (i = 1; i < ArgC; i++) {
 
@@ -208,8 +592,14 @@ ENTRYPOINT(
                 KillHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2020"));
+                YoriLibDisplayMitLicense(_T("2020-2026"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
+                KillContext.CurrentSessionOnly = TRUE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("t")) == 0) {
+                KillContext.KillTree = TRUE;
+                ArgumentUnderstood = TRUE;
             }
         } else {
             ArgumentUnderstood = TRUE;
@@ -227,33 +617,30 @@ ENTRYPOINT(
         return EXIT_FAILURE;
     }
 
-    KillCount = 0;
+    //
+    //  Collect the processes to terminate, then terminate them together.
+    //  A single snapshot is used to resolve every name and tree.
+    //
+
     for (i = StartArg; i < ArgC; i++) {
         if (YoriLibStringToNumber(&ArgV[i], TRUE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
-            ProcessPid = (DWORD)llTemp;
-            if (KillTerminateProcessById(ProcessPid)) {
-                KillCount++;
-            }
-        } else {
-            if (ProcessInfo == NULL) {
-                if (DllNtDll.pNtQuerySystemInformation == NULL) {
-                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("OS support not present\n"));
-                } else if (!YoriLibGetSystemProcessList(&ProcessInfo)) {
-                    ProcessInfo = NULL;
-                }
-            }
-
-            if (ProcessInfo != NULL) {
-                KillCount += KillTerminateProcessByName(ProcessInfo, &ArgV[i]);
-            }
+            KillAddPid(&KillContext, (DWORD_PTR)llTemp);
+        } else if (KillCaptureSnapshot(&KillContext)) {
+            KillFindProcessesByName(&KillContext, &ArgV[i]);
         }
     }
 
-    if (ProcessInfo != NULL) {
-        YoriLibFree(ProcessInfo);
+    KillTerminatePendingProcesses(&KillContext);
+
+    if (KillContext.Pids != NULL) {
+        YoriLibFree(KillContext.Pids);
+    }
+
+    if (KillContext.Snapshot != NULL) {
+        YoriLibFreeProcessSnapshot(KillContext.Snapshot);
     }
 
-    if (KillCount == 0) {
+    if (KillContext.KillCount == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("kill: no processes terminated\n"));
         return EXIT_FAILURE;
     }
@@ -28,13 +28,43 @@
 #include "yorilib.h"
 #include "yoricall.h"
 
+/**
+ An entry describing a variable in the current environment, used while
+ applying a new environment to determine which variables need to change.
+ */
+typedef struct _YORI_LIB_BUILTIN_ENV_VAR {
+
+    /**
+     The hash table entry for this variable, keyed by the variable name.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The entire variable string, in NAME=value form.
+     */
+    YORI_STRING Entire;
+
+    /**
+     The name of the variable.
+     */
+    YORI_STRING Name;
+
+    /**
+     TRUE if the variable is also present in the new environment, indicating
+     it should not be deleted.
+     */
+    BOOLEAN Matched;
+} YORI_LIB_BUILTIN_ENV_VAR, *PYORI_LIB_BUILTIN_ENV_VAR;
+
 /**
  Retore a set of environment strings into the current environment.  This
  implies removing all currently defined variables and replacing them with
- the specified set.  This version of the routine is specific to builtin
- modules because it manipulates the environment through the YoriCall
- interface.  Note that the input buffer is modified temporarily (ie.,
- it is not immutable.)
+ the specified set.  Only variables which differ between the current
+ environment and the new environment are modified, so restoring an
+ environment that has had a small number of changes is proportionally
+ cheap.  This version of the routine is specific to builtin modules because
+ it manipulates the environment through the YoriCall interface.  Note that
+ the input buffer is modified temporarily (ie., it is not immutable.)
 
  @param NewEnvironment Pointer to the new environment strings to apply.
 
@@ -48,17 +78,51 @@ YoriLibBuiltinSetEnvironmentStrings(
     YORI_STRING CurrentEnvironment;
     YORI_STRING VariableName;
     YORI_STRING ValueName;
+    YORI_STRING Entire;
+    PYORI_LIB_BUILTIN_ENV_VAR Vars;
+    PYORI_LIB_BUILTIN_ENV_VAR Var;
+    PYORI_HASH_TABLE VarTable;
+    PYORI_HASH_ENTRY HashEntry;
     LPTSTR ThisVar;
     LPTSTR ThisValue;
     DWORD VarLen;
+    DWORD VarCount;
+    DWORD Index;
 
     if (!YoriLibGetEnvironmentStrings(&CurrentEnvironment)) {
         return FALSE;
     }
 
+    VarCount = 0;
+    ThisVar = CurrentEnvironment.StartOfString;
+    while (*ThisVar != '\0') {
+        VarCount++;
+        ThisVar += _tcslen(ThisVar);
+        ThisVar++;
+    }
+
+    Vars = YoriLibMalloc((VarCount + 1) * sizeof(YORI_LIB_BUILTIN_ENV_VAR));
+    if (Vars == NULL) {
+        YoriLibFreeStringContents(&CurrentEnvironment);
+        return FALSE;
+    }
+
+    VarTable = YoriLibAllocateHashTable(VarCount / 2 + 31);
+    if (VarTable == NULL) {
+        YoriLibFree(Vars);
+        YoriLibFreeStringContents(&CurrentEnvironment);
+        return FALSE;
+    }
+
     YoriLibInitEmptyString(&VariableName);
     YoriLibInitEmptyString(&ValueName);
+    YoriLibInitEmptyString(&Entire);
+
+    //
+    //  Index the current environment by variable name.
+    //
 
+    Index = 0;
     ThisVar = CurrentEnvironment.StartOfString;
     while (*ThisVar != '\0') {
         VarLen = _tcslen(ThisVar);
@@ -70,50 +134,96 @@ YoriLibBuiltinSetEnvironmentStrings(
 
         ThisValue = _tcschr(&ThisVar[1], '=');
         if (ThisValue != NULL) {
-            ThisValue[0] = '\0';
-            VariableName.StartOfString = ThisVar;
-            VariableName.LengthInChars = (DWORD)(ThisValue - ThisVar);
-            VariableName.LengthAllocated = VariableName.LengthInChars + 1;
-            YoriCallSetEnvironmentVariable(&VariableName, NULL);
+            Var = &Vars[Index];
+            YoriLibInitEmptyString(&Var->Entire);
+            Var->Entire.StartOfString = ThisVar;
+            Var->Entire.LengthInChars = VarLen;
+            YoriLibInitEmptyString(&Var->Name);
+            Var->Name.StartOfString = ThisVar;
+            Var->Name.LengthInChars = (DWORD)(ThisValue - ThisVar);
+            Var->Name.LengthAllocated = Var->Name.LengthInChars + 1;
+            Var->Matched = FALSE;
+            if (YoriLibHashLookupByKey(VarTable, &Var->Name) == NULL) {
+                YoriLibHashInsertByKey(VarTable, &Var->Name, Var, &Var->HashEntry);
+                Index++;
+            }
         }
 
         ThisVar += VarLen;
         ThisVar++;
     }
-    YoriLibFreeStringContents(&CurrentEnvironment);
+    VarCount = Index;
 
     //
-    //  Now restore the saved environment.
+    //  Apply each variable in the new environment that is not already
+    //  present with the same value.
     //
 
     ThisVar = NewEnvironment->StartOfString;
     while (*ThisVar != '\0') {
         VarLen = _tcslen(ThisVar);
 
-        //
-        //  We know there's at least one char.  Skip it if it's equals since
-        //  that's how drive current directories are recorded.
-        //
-
         ThisValue = _tcschr(&ThisVar[1], '=');
         if (ThisValue != NULL) {
-            ThisValue[0] = '\0';
             VariableName.StartOfString = ThisVar;
             VariableName.LengthInChars = (DWORD)(ThisValue - ThisVar);
             VariableName.LengthAllocated = VariableName.LengthInChars + 1;
-            ThisValue++;
-            ValueName.StartOfString = ThisValue;
-            ValueName.LengthInChars = VarLen - VariableName.LengthInChars - 1;
-            ValueName.LengthAllocated = ValueName.LengthInChars + 1;
-            YoriCallSetEnvironmentVariable(&VariableName, &ValueName);
-            ThisValue--;
-            ThisValue[0] = '=';
+            Entire.StartOfString = ThisVar;
+            Entire.LengthInChars = VarLen;
+
+            Var = NULL;
+            HashEntry = YoriLibHashLookupByKey(VarTable, &VariableName);
+            if (HashEntry != NULL) {
+                Var = HashEntry->Context;
+                Var->Matched = TRUE;
+            }
+
+            if (Var == NULL || YoriLibCompareString(&Var->Entire, &Entire) != 0) {
+
+                //
+                //  If the name differs only in case, delete the existing
+                //  variable so the name is restored as it was saved.
+                //
+
+                if (Var != NULL && YoriLibCompareString(&Var->Name, &VariableName) != 0) {
+                    Var->Name.StartOfString[Var->Name.LengthInChars] = '\0';
+                    YoriCallSetEnvironmentVariable(&Var->Name, NULL);
+                }
+
+                ThisValue[0] = '\0';
+                ThisValue++;
+                ValueName.StartOfString = ThisValue;
+                ValueName.LengthInChars = VarLen - VariableName.LengthInChars - 1;
+                ValueName.LengthAllocated = ValueName.LengthInChars + 1;
+                YoriCallSetEnvironmentVariable(&VariableName, &ValueName);
+                ThisValue--;
+                ThisValue[0] = '=';
+            }
         }
 
         ThisVar += VarLen;
         ThisVar++;
     }
 
+    //
+    //  Delete any variables that are not in the new environment.  The
+    //  current environment buffer is discarded after this, so names are
+    //  terminated in place.
+    //
+
+    for (Index = 0; Index < VarCount; Index++) {
+        Var = &Vars[Index];
+        YoriLibHashRemoveByEntry(&Var->HashEntry);
+        if (!Var->Matched) {
+            Var->Name.StartOfString[Var->Name.LengthInChars] = '\0';
+            YoriCallSetEnvironmentVariable(&Var->Name, NULL);
+        }
+    }
+
+    YoriLibFreeEmptyHashTable(VarTable);
+    YoriLibFree(Vars);
+    YoriLibFreeStringContents(&CurrentEnvironment);
+
     return TRUE;
 }
 
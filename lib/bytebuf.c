@@ -3,7 +3,7 @@
  *
  * Yori expandable memory buffer
  *
- * Copyright (c) 2017-2023 Malcolm J. Smith
+ * Copyright (c) 2017-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -75,7 +75,7 @@ YoriLibByteBufferInitialize(
         if (!YoriLibByteBufIsSizeAllocatable(InitialSize)) {
             return FALSE;
         }
-        Buffer->Buffer = YoriLibMalloc((DWORD)InitialSize);
+        Buffer->Buffer = YoriLibMallocForCaller((DWORD)InitialSize, YoriLibAllocProfileCaller());
         if (Buffer->Buffer == NULL) {
             return FALSE;
         }
@@ -117,23 +117,31 @@ YoriLibByteBufferReset(
 }
 
 /**
- Extend the byte buffer to a specified number of bytes.  This extends the
- allocation only without populating any contents.
+ Extend the byte buffer to a specified number of bytes on behalf of a
+ specified caller, so that an allocation profile attributes the memory to
+ the code using the buffer.
 
  @param Buffer Pointer to the byte buffer structure.
 
  @param NewTotalLength The new total length to allocate in the byte buffer.
 
+ @param CallSite The return address of the code extending the buffer.
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOLEAN
-YoriLibByteBufferExtend(
+YoriLibByteBufferExtendForCaller(
     __in PYORI_LIB_BYTE_BUFFER Buffer,
-    __in DWORDLONG NewTotalLength
+    __in DWORDLONG NewTotalLength,
+    __in_opt PVOID CallSite
     )
 {
     PUCHAR NewBuffer;
 
+#if YORI_SPECIAL_HEAP
+    UNREFERENCED_PARAMETER(CallSite);
+#endif
+
     if (Buffer->BytesAllocated >= NewTotalLength) {
         return FALSE;
     }
@@ -142,7 +150,7 @@ YoriLibByteBufferExtend(
         return FALSE;
     }
 
-    NewBuffer = YoriLibMalloc((DWORD)NewTotalLength);
+    NewBuffer = YoriLibMallocForCaller((DWORD)NewTotalLength, CallSite);
     if (NewBuffer == NULL) {
         return FALSE;
     }
@@ -161,6 +169,25 @@ YoriLibByteBufferExtend(
     return TRUE;
 }
 
+/**
+ Extend the byte buffer to a specified number of bytes.  This extends the
+ allocation only without populating any contents.
+
+ @param Buffer Pointer to the byte buffer structure.
+
+ @param NewTotalLength The new total length to allocate in the byte buffer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriLibByteBufferExtend(
+    __in PYORI_LIB_BYTE_BUFFER Buffer,
+    __in DWORDLONG NewTotalLength
+    )
+{
+    return YoriLibByteBufferExtendForCaller(Buffer, NewTotalLength, YoriLibAllocProfileCaller());
+}
+
 /**
  Get a pointer to the first invalid byte in the buffer so new data can be
  written to it.
@@ -199,7 +226,7 @@ YoriLibByteBufferGetPointerToEnd(
         if (NewLength < MinimumLengthRequired) {
             NewLength = MinimumLengthRequired;
         }
-        if (!YoriLibByteBufferExtend(Buffer, NewLength)) {
+        if (!YoriLibByteBufferExtendForCaller(Buffer, NewLength, YoriLibAllocProfileCaller())) {
             return NULL;
         }
 
@@ -241,5 +268,588 @@ YoriLibByteBufferAddToPopulatedLength(
     return TRUE;
 }
 
+/**
+ A single segment within a segmented buffer.  The data follows this
+ structure in the same allocation.  Segments are reference counted so that
+ slices of the buffer can remain valid after the buffer discards the
+ segment.
+ */
+typedef struct _YORI_LIB_BUFFER_SEGMENT {
+
+    /**
+     The link of this segment within the list of segments in the buffer.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The number of bytes of data that the segment can hold.
+     */
+    DWORD BytesAllocated;
+
+    /**
+     The number of bytes of data in the segment that contain valid data.
+     */
+    DWORD BytesPopulated;
+
+} YORI_LIB_BUFFER_SEGMENT, *PYORI_LIB_BUFFER_SEGMENT;
+
+/**
+ The default size of each segment in a segmented buffer.
+ */
+#define YORI_LIB_SEGMENTED_BUFFER_DEFAULT_SEGMENT (64 * 1024)
+
+/**
+ Initialize a segmented buffer.  A segmented buffer holds data in a list of
+ separate allocations, so appending data never requires existing data to be
+ copied.  Optionally, once the buffer holds more than a specified amount of
+ data in memory, data is moved to a temporary file.  The structure itself is
+ owned by the caller.  No allocation is performed until data is added.
+
+ @param Buffer Pointer to the buffer to initialize.
+
+ @param SegmentSize The number of bytes to allocate for each segment.  If
+        zero, a default size is used.
+
+ @param SpillThreshold The number of bytes to hold in memory before moving
+        data into a temporary file.  If zero, data is always held in memory.
+ */
+VOID
+YoriLibSegmentedBufferInitialize(
+    __out PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in DWORD SegmentSize,
+    __in DWORDLONG SpillThreshold
+    )
+{
+    YoriLibInitializeListHead(&Buffer->Segments);
+    if (SegmentSize == 0) {
+        SegmentSize = YORI_LIB_SEGMENTED_BUFFER_DEFAULT_SEGMENT;
+    }
+    Buffer->SegmentSize = SegmentSize;
+    Buffer->SpillThreshold = SpillThreshold;
+    Buffer->BytesPopulated = 0;
+    Buffer->BytesInMemory = 0;
+    Buffer->BytesSpilled = 0;
+    Buffer->SpillHandle = NULL;
+    YoriLibInitEmptyString(&Buffer->SpillFileName);
+}
+
+/**
+ Free all segments and any temporary file associated with a segmented
+ buffer.  Slices previously returned from the buffer remain valid until they
+ are freed.
+
+ @param Buffer Pointer to the buffer to clean up.
+ */
+VOID
+YoriLibSegmentedBufferCleanup(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_BUFFER_SEGMENT Segment;
+
+    ListEntry = YoriLibGetNextListEntry(&Buffer->Segments, NULL);
+    while (ListEntry != NULL) {
+        Segment = CONTAINING_RECORD(ListEntry, YORI_LIB_BUFFER_SEGMENT, ListEntry);
+        YoriLibRemoveListItem(&Segment->ListEntry);
+        YoriLibDereference(Segment);
+        ListEntry = YoriLibGetNextListEntry(&Buffer->Segments, NULL);
+    }
+
+    if (Buffer->SpillHandle != NULL) {
+        CloseHandle(Buffer->SpillHandle);
+        DeleteFile(Buffer->SpillFileName.StartOfString);
+    }
+
+    YoriLibFreeStringContents(&Buffer->SpillFileName);
+    YoriLibSegmentedBufferInitialize(Buffer, Buffer->SegmentSize, Buffer->SpillThreshold);
+}
+
+/**
+ Set the position within the temporary file used by a segmented buffer.
+
+ @param Buffer Pointer to the buffer.
+
+ @param Offset The offset within the temporary file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriLibSegmentedBufferSeekSpill(
+    __in PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in DWORDLONG Offset
+    )
+{
+    LARGE_INTEGER liOffset;
+
+    liOffset.QuadPart = Offset;
+    liOffset.LowPart = SetFilePointer(Buffer->SpillHandle, liOffset.LowPart, &liOffset.HighPart, FILE_BEGIN);
+    if (liOffset.LowPart == (DWORD)-1 && GetLastError() != NO_ERROR) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Move all segments in a segmented buffer into its temporary file,
+ creating the temporary file if it does not exist.
+
+ @param Buffer Pointer to the buffer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriLibSegmentedBufferSpill(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_BUFFER_SEGMENT Segment;
+    DWORD BytesWritten;
+    YORI_STRING TempPath;
+    YORI_STRING Prefix;
+
+    if (Buffer->SpillHandle == NULL) {
+        if (!YoriLibGetTempPath(&TempPath, 0)) {
+            return FALSE;
+        }
+
+        if (TempPath.LengthInChars > 0 &&
+            YoriLibIsSep(TempPath.StartOfString[TempPath.LengthInChars - 1])) {
+
+            TempPath.LengthInChars--;
+        }
+
+        YoriLibConstantString(&Prefix, _T("YBUF"));
+        if (!YoriLibGetTempFileName(&TempPath, &Prefix, &Buffer->SpillHandle, &Buffer->SpillFileName)) {
+            Buffer->SpillHandle = NULL;
+            YoriLibFreeStringContents(&TempPath);
+            return FALSE;
+        }
+        YoriLibFreeStringContents(&TempPath);
+    } else if (!YoriLibSegmentedBufferSeekSpill(Buffer, Buffer->BytesSpilled)) {
+        return FALSE;
+    }
+
+    //
+    //  This is called when a new segment is about to be allocated, so no
+    //  existing segment will receive more data.  Write all of them.
+    //
+
+    ListEntry = YoriLibGetNextListEntry(&Buffer->Segments, NULL);
+    while (ListEntry != NULL) {
+        Segment = CONTAINING_RECORD(ListEntry, YORI_LIB_BUFFER_SEGMENT, ListEntry);
+
+        if (!WriteFile(Buffer->SpillHandle, Segment + 1, Segment->BytesPopulated, &BytesWritten, NULL) ||
+            BytesWritten != Segment->BytesPopulated) {
+
+            return FALSE;
+        }
+
+        Buffer->BytesSpilled = Buffer->BytesSpilled + Segment->BytesPopulated;
+        Buffer->BytesInMemory = Buffer->BytesInMemory - Segment->BytesPopulated;
+        YoriLibRemoveListItem(&Segment->ListEntry);
+        YoriLibDereference(Segment);
+        ListEntry = YoriLibGetNextListEntry(&Buffer->Segments, NULL);
+    }
+
+    return TRUE;
+}
+
+/**
+ Get a pointer to the end of a segmented buffer so new data can be written
+ to it.  If the current segment does not have enough space, a new segment
+ is allocated; existing data is never moved.
+
+ @param Buffer Pointer to the buffer.
+
+ @param MinimumLengthRequired The number of bytes that must be available
+        for newly valid data.
+
+ @param BytesAvailable On successful completion, optionally updated to
+        contain the number of contiguous bytes that can be written to.
+
+ @return On successful completion, pointer to the buffer to write to.
+         Returns NULL on failure.
+ */
+__success(return != NULL)
+PUCHAR
+YoriLibSegmentedBufferGetPointerToEnd(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in DWORD MinimumLengthRequired,
+    __out_opt PDWORD BytesAvailable
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_BUFFER_SEGMENT Segment;
+    DWORD SegmentSize;
+
+    Segment = NULL;
+    ListEntry = YoriLibGetPreviousListEntry(&Buffer->Segments, NULL);
+    if (ListEntry != NULL) {
+        Segment = CONTAINING_RECORD(ListEntry, YORI_LIB_BUFFER_SEGMENT, ListEntry);
+        if (Segment->BytesAllocated - Segment->BytesPopulated < MinimumLengthRequired ||
+            Segment->BytesAllocated == Segment->BytesPopulated) {
+
+            Segment = NULL;
+        }
+    }
+
+    if (Segment == NULL) {
+        if (Buffer->SpillThreshold != 0 && Buffer->BytesInMemory >= Buffer->SpillThreshold) {
+            if (!YoriLibSegmentedBufferSpill(Buffer)) {
+                return NULL;
+            }
+        }
+
+        SegmentSize = Buffer->SegmentSize;
+        if (SegmentSize < MinimumLengthRequired) {
+            SegmentSize = MinimumLengthRequired;
+        }
+
+        Segment = YoriLibReferencedMalloc(sizeof(YORI_LIB_BUFFER_SEGMENT) + SegmentSize);
+        if (Segment == NULL) {
+            return NULL;
+        }
+
+        Segment->BytesAllocated = SegmentSize;
+        Segment->BytesPopulated = 0;
+        YoriLibAppendList(&Buffer->Segments, &Segment->ListEntry);
+    }
+
+    if (BytesAvailable != NULL) {
+        *BytesAvailable = Segment->BytesAllocated - Segment->BytesPopulated;
+    }
+
+    return (PUCHAR)(Segment + 1) + Segment->BytesPopulated;
+}
+
+/**
+ Indicate that the final segment of a segmented buffer has additional valid
+ bytes.
+
+ @param Buffer Pointer to the buffer.
+
+ @param NewBytesPopulated The number of newly valid bytes.  This cannot
+        exceed the number of bytes available returned from
+        @ref YoriLibSegmentedBufferGetPointerToEnd .
+
+ @return TRUE to indicate success, FALSE to indicate failure.  Failure implies
+         caller error where a caller is indicating more bytes to be valid than
+         the buffer contains.
+ */
+BOOLEAN
+YoriLibSegmentedBufferAddToPopulatedLength(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in DWORD NewBytesPopulated
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_BUFFER_SEGMENT Segment;
+
+    ListEntry = YoriLibGetPreviousListEntry(&Buffer->Segments, NULL);
+    if (ListEntry == NULL) {
+        return (BOOLEAN)(NewBytesPopulated == 0);
+    }
+
+    Segment = CONTAINING_RECORD(ListEntry, YORI_LIB_BUFFER_SEGMENT, ListEntry);
+    ASSERT(Segment->BytesPopulated + NewBytesPopulated <= Segment->BytesAllocated);
+    if (Segment->BytesPopulated + NewBytesPopulated > Segment->BytesAllocated) {
+        return FALSE;
+    }
+
+    Segment->BytesPopulated = Segment->BytesPopulated + NewBytesPopulated;
+    Buffer->BytesInMemory = Buffer->BytesInMemory + NewBytesPopulated;
+    Buffer->BytesPopulated = Buffer->BytesPopulated + NewBytesPopulated;
+    return TRUE;
+}
+
+/**
+ Append data to a segmented buffer.
+
+ @param Buffer Pointer to the buffer.
+
+ @param Data Pointer to the data to append.
+
+ @param Length The number of bytes to append.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriLibSegmentedBufferAppend(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in_bcount(Length) PVOID Data,
+    __in DWORD Length
+    )
+{
+    DWORD BytesAvailable;
+    DWORD BytesCopied;
+    DWORD BytesThisCopy;
+    PUCHAR Dest;
+
+    BytesCopied = 0;
+    while (BytesCopied < Length) {
+        Dest = YoriLibSegmentedBufferGetPointerToEnd(Buffer, 1, &BytesAvailable);
+        if (Dest == NULL) {
+            return FALSE;
+        }
+
+        BytesThisCopy = Length - BytesCopied;
+        if (BytesThisCopy > BytesAvailable) {
+            BytesThisCopy = BytesAvailable;
+        }
+
+        memcpy(Dest, YoriLibAddToPointer(Data, BytesCopied), BytesThisCopy);
+        YoriLibSegmentedBufferAddToPopulatedLength(Buffer, BytesThisCopy);
+        BytesCopied = BytesCopied + BytesThisCopy;
+    }
+
+    return TRUE;
+}
+
+/**
+ Read from a handle into a segmented buffer until the handle indicates no
+ more data is available.  Data is read directly into segments.
+
+ @param Buffer Pointer to the buffer.
+
+ @param hSource Handle to read from.
+
+ @return TRUE to indicate all data was read, FALSE if the data could not be
+         stored.
+ */
+BOOLEAN
+YoriLibSegmentedBufferReadFromHandle(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in HANDLE hSource
+    )
+{
+    DWORD BytesAvailable;
+    DWORD BytesRead;
+    PUCHAR Dest;
+
+    while (TRUE) {
+        Dest = YoriLibSegmentedBufferGetPointerToEnd(Buffer, 1, &BytesAvailable);
+        if (Dest == NULL) {
+            return FALSE;
+        }
+
+        if (!ReadFile(hSource, Dest, BytesAvailable, &BytesRead, NULL) ||
+            BytesRead == 0) {
+
+            break;
+        }
+
+        YoriLibSegmentedBufferAddToPopulatedLength(Buffer, BytesRead);
+    }
+
+    return TRUE;
+}
+
+/**
+ Write a block of memory to a handle, retrying until all of it is written.
+
+ @param hTarget Handle to write to.
+
+ @param Data Pointer to the data to write.
+
+ @param Length The number of bytes to write.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriLibSegmentedBufferWriteBlock(
+    __in HANDLE hTarget,
+    __in_bcount(Length) PVOID Data,
+    __in DWORD Length
+    )
+{
+    DWORD BytesSent;
+    DWORD BytesWritten;
+
+    BytesSent = 0;
+    while (BytesSent < Length) {
+        if (!WriteFile(hTarget, YoriLibAddToPointer(Data, BytesSent), Length - BytesSent, &BytesWritten, NULL) ||
+            BytesWritten == 0) {
+
+            return FALSE;
+        }
+        BytesSent = BytesSent + BytesWritten;
+    }
+
+    return TRUE;
+}
+
+/**
+ Write the entire contents of a segmented buffer to a handle.  Each segment
+ in memory is written directly without being copied into a contiguous
+ buffer.  Any data in the temporary file is copied to the handle first.
+
+ @param Buffer Pointer to the buffer.
+
+ @param hTarget Handle to write to.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriLibSegmentedBufferWriteToHandle(
+    __in PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in HANDLE hTarget
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_BUFFER_SEGMENT Segment;
+
+    if (Buffer->BytesSpilled > 0) {
+        PUCHAR CopyBuffer;
+        DWORDLONG BytesCopied;
+        DWORD BytesThisCopy;
+        DWORD BytesRead;
+
+        if (!YoriLibSegmentedBufferSeekSpill(Buffer, 0)) {
+            return FALSE;
+        }
+
+        CopyBuffer = YoriLibMalloc(Buffer->SegmentSize);
+        if (CopyBuffer == NULL) {
+            return FALSE;
+        }
+
+        BytesCopied = 0;
+        while (BytesCopied < Buffer->BytesSpilled) {
+            BytesThisCopy = Buffer->SegmentSize;
+            if (BytesThisCopy > Buffer->BytesSpilled - BytesCopied) {
+                BytesThisCopy = (DWORD)(Buffer->BytesSpilled - BytesCopied);
+            }
+
+            if (!ReadFile(Buffer->SpillHandle, CopyBuffer, BytesThisCopy, &BytesRead, NULL) ||
+                BytesRead == 0 ||
+                !YoriLibSegmentedBufferWriteBlock(hTarget, CopyBuffer, BytesRead)) {
+
+                YoriLibFree(CopyBuffer);
+                return FALSE;
+            }
+
+            BytesCopied = BytesCopied + BytesRead;
+        }
+
+        YoriLibFree(CopyBuffer);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Buffer->Segments, NULL);
+    while (ListEntry != NULL) {
+        Segment = CONTAINING_RECORD(ListEntry, YORI_LIB_BUFFER_SEGMENT, ListEntry);
+        if (!YoriLibSegmentedBufferWriteBlock(hTarget, Segment + 1, Segment->BytesPopulated)) {
+            return FALSE;
+        }
+        ListEntry = YoriLibGetNextListEntry(&Buffer->Segments, ListEntry);
+    }
+
+    return TRUE;
+}
+
+/**
+ Return a contiguous range of data from a segmented buffer starting at a
+ specified offset.  If the data is held in memory, the slice refers to the
+ buffer's memory without copying it, and remains valid even if the buffer
+ is subsequently cleaned up.  If the data has been moved to the temporary
+ file, it is read into a new allocation.  The slice ends at the end of the
+ segment containing the offset, so a caller wanting all data should request
+ further slices from the end of each slice.
+
+ @param Buffer Pointer to the buffer.
+
+ @param Offset The offset, in bytes from the start of the buffer, of the
+        first byte of the slice.
+
+ @param Slice On successful completion, populated with the slice.  This
+        should be freed with @ref YoriLibSegmentedBufferFreeSlice .
+
+ @return TRUE to indicate success, FALSE if the offset is beyond the data
+         in the buffer or the data could not be read.
+ */
+__success(return)
+BOOLEAN
+YoriLibSegmentedBufferGetSlice(
+    __in PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in DWORDLONG Offset,
+    __out PYORI_LIB_BYTE_SLICE Slice
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_BUFFER_SEGMENT Segment;
+    DWORDLONG SegmentOffset;
+    DWORD BytesRead;
+
+    if (Offset >= Buffer->BytesPopulated) {
+        return FALSE;
+    }
+
+    if (Offset < Buffer->BytesSpilled) {
+        DWORD BytesToRead;
+
+        BytesToRead = Buffer->SegmentSize;
+        if (BytesToRead > Buffer->BytesSpilled - Offset) {
+            BytesToRead = (DWORD)(Buffer->BytesSpilled - Offset);
+        }
+
+        if (!YoriLibSegmentedBufferSeekSpill(Buffer, Offset)) {
+            return FALSE;
+        }
+
+        Slice->MemoryToFree = YoriLibReferencedMalloc(BytesToRead);
+        if (Slice->MemoryToFree == NULL) {
+            return FALSE;
+        }
+
+        if (!ReadFile(Buffer->SpillHandle, Slice->MemoryToFree, BytesToRead, &BytesRead, NULL) ||
+            BytesRead == 0) {
+
+            YoriLibDereference(Slice->MemoryToFree);
+            Slice->MemoryToFree = NULL;
+            return FALSE;
+        }
+
+        Slice->Data = Slice->MemoryToFree;
+        Slice->Length = BytesRead;
+        return TRUE;
+    }
+
+    SegmentOffset = Buffer->BytesSpilled;
+    ListEntry = YoriLibGetNextListEntry(&Buffer->Segments, NULL);
+    while (ListEntry != NULL) {
+        Segment = CONTAINING_RECORD(ListEntry, YORI_LIB_BUFFER_SEGMENT, ListEntry);
+        if (Offset < SegmentOffset + Segment->BytesPopulated) {
+            YoriLibReference(Segment);
+            Slice->MemoryToFree = Segment;
+            Slice->Data = (PUCHAR)(Segment + 1) + (DWORD)(Offset - SegmentOffset);
+            Slice->Length = Segment->BytesPopulated - (DWORD)(Offset - SegmentOffset);
+            return TRUE;
+        }
+        SegmentOffset = SegmentOffset + Segment->BytesPopulated;
+        ListEntry = YoriLibGetNextListEntry(&Buffer->Segments, ListEntry);
+    }
+
+    return FALSE;
+}
+
+/**
+ Free a slice returned from @ref YoriLibSegmentedBufferGetSlice .
+
+ @param Slice Pointer to the slice to free.
+ */
+VOID
+YoriLibSegmentedBufferFreeSlice(
+    __inout PYORI_LIB_BYTE_SLICE Slice
+    )
+{
+    if (Slice->MemoryToFree != NULL) {
+        YoriLibDereference(Slice->MemoryToFree);
+    }
+    Slice->MemoryToFree = NULL;
+    Slice->Data = NULL;
+    Slice->Length = 0;
+}
 
 // vim:sw=4:ts=4:et:
@@ -4,7 +4,7 @@
  * Convert a Yori string containing HTML into a Utf-8 formatted text stream for
  * use in the clipboard.
  *
- * Copyright (c) 2015-2021 Malcolm J. Smith
+ * Copyright (c) 2015-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -364,8 +364,11 @@ YoriLibCopyText(
         return FALSE;
     }
 
+    //
+    //  The clipboard now owns the memory.
+    //
+
     DllUser32.pCloseClipboard();
-    GlobalFree(hMem);
     return TRUE;
 }
 
@@ -513,12 +516,17 @@ YoriLibCopyTextRtfAndHtml(
         return FALSE;
     }
 
+    //
+    //  Each handle that is successfully placed on the clipboard is owned
+    //  by the clipboard, so only handles that were not placed are freed
+    //  on failure.
+    //
+
     hClip = DllUser32.pSetClipboardData(RtfFmt, hRtf);
     if (hClip == NULL) {
         DllUser32.pCloseClipboard();
         GlobalFree(hHtml);
         GlobalFree(hRtf);
-        GlobalFree(hText);
         return FALSE;
     }
 
@@ -526,15 +534,10 @@ YoriLibCopyTextRtfAndHtml(
     if (hClip == NULL) {
         DllUser32.pCloseClipboard();
         GlobalFree(hHtml);
-        GlobalFree(hRtf);
-        GlobalFree(hText);
         return FALSE;
     }
 
     DllUser32.pCloseClipboard();
-    GlobalFree(hText);
-    GlobalFree(hRtf);
-    GlobalFree(hHtml);
     return TRUE;
 }
 
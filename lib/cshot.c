@@ -3,7 +3,7 @@
  *
  * Yori lib capture console text and reformat it
  *
- * Copyright (c) 2017-2018 Malcolm J. Smith
+ * Copyright (c) 2017-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -28,8 +28,150 @@
 #include <yorilib.h>
 
 
+/**
+ The maximum number of bytes of CHAR_INFO structures to request from the
+ console in a single read.  Older versions of Windows fail reads where the
+ buffer exceeds 64Kb, so each read is kept below this.
+ */
+#define YORI_LIB_CSHOT_READ_BYTES (0xF000)
+
+/**
+ Count the number of times the attribute changes across a set of console
+ cells.  This is used to determine the size of a buffer needed to contain
+ VT escapes for the cells, without generating the escapes twice.
+
+ @param Attributes Pointer to the first attribute.
+
+ @param Stride The distance between each attribute, in bytes.
+
+ @param Count The number of cells to examine.
+
+ @return The number of times the attribute differs from the previous cell.
+ */
+DWORD
+YoriLibCshotCountAttributeChanges(
+    __in PWORD Attributes,
+    __in DWORD Stride,
+    __in DWORD Count
+    )
+{
+    DWORD Index;
+    DWORD Changes;
+    WORD LastAttribute;
+    PUCHAR Next;
+
+    if (Count == 0) {
+        return 0;
+    }
+
+    Changes = 0;
+    LastAttribute = Attributes[0];
+    Next = (PUCHAR)Attributes;
+    for (Index = 1; Index < Count; Index++) {
+        Next = Next + Stride;
+        if (*(PWORD)Next != LastAttribute) {
+            LastAttribute = *(PWORD)Next;
+            Changes++;
+        }
+    }
+
+    return Changes;
+}
+
+/**
+ Append the VT escape sequence for an attribute to a string.  The caller is
+ expected to have allocated sufficient space.
+
+ @param String Pointer to the string to append to.
+
+ @param EscapeString Pointer to a temporary string to use when generating the
+        escape.
+
+ @param Attribute The attribute to generate an escape for.
+ */
+VOID
+YoriLibCshotAppendEscape(
+    __inout PYORI_STRING String,
+    __inout PYORI_STRING EscapeString,
+    __in WORD Attribute
+    )
+{
+    YoriLibVtStringForTextAttribute(EscapeString, 0, Attribute);
+    ASSERT(String->LengthInChars + EscapeString->LengthInChars <= String->LengthAllocated);
+    memcpy(&String->StartOfString[String->LengthInChars], EscapeString->StartOfString, EscapeString->LengthInChars * sizeof(TCHAR));
+    String->LengthInChars += EscapeString->LengthInChars;
+}
+
+/**
+ Read a range of lines from the console.  Where a large range cannot be
+ read in one request, it is retried with progressively smaller requests.
+
+ @param hConsole Handle to the console.
+
+ @param ReadBuffer Pointer to a buffer to populate with the contents of the
+        console.  This must be large enough for LineCount lines.
+
+ @param LineWidth The number of cells in each line.
+
+ @param FirstLine The first line to read.
+
+ @param LineCount The number of lines to read.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibCshotReadLines(
+    __in HANDLE hConsole,
+    __out PCHAR_INFO ReadBuffer,
+    __in WORD LineWidth,
+    __in WORD FirstLine,
+    __in WORD LineCount
+    )
+{
+    SMALL_RECT ReadWindow;
+    COORD ReadBufferSize;
+    COORD ReadBufferOffset;
+    WORD LinesThisRead;
+    WORD LinesRead;
+
+    ReadBufferOffset.X = 0;
+    ReadBufferOffset.Y = 0;
+    LinesThisRead = LineCount;
+    LinesRead = 0;
+
+    while (LinesRead < LineCount) {
+        if (LinesThisRead > LineCount - LinesRead) {
+            LinesThisRead = (WORD)(LineCount - LinesRead);
+        }
+
+        ReadWindow.Left = 0;
+        ReadWindow.Right = (SHORT)(LineWidth - 1);
+        ReadWindow.Top = (SHORT)(FirstLine + LinesRead);
+        ReadWindow.Bottom = (SHORT)(ReadWindow.Top + LinesThisRead - 1);
+
+        ReadBufferSize.X = LineWidth;
+        ReadBufferSize.Y = LinesThisRead;
+
+        if (!ReadConsoleOutput(hConsole, &ReadBuffer[LinesRead * LineWidth], ReadBufferSize, ReadBufferOffset, &ReadWindow)) {
+            if (LinesThisRead == 1) {
+                return FALSE;
+            }
+            LinesThisRead = (WORD)(LinesThisRead / 2);
+            continue;
+        }
+
+        LinesRead = (WORD)(LinesRead + LinesThisRead);
+    }
+
+    return TRUE;
+}
+
 /**
  Read contents from the console window and send the contents to a device.
+ The console is read in large chunks, and each chunk is converted to a VT
+ string and written before reading the next, so memory usage is bounded
+ and output begins immediately.
 
  @param hTarget Handle to the target device.  Can be a file or standard output.
 
@@ -49,12 +191,24 @@ YoriLibRewriteConsoleContents(
 {
     CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
     HANDLE hConsole;
-    SMALL_RECT ReadWindow;
     PCHAR_INFO ReadBuffer;
-    COORD ReadBufferSize;
-    COORD ReadBufferOffset;
-    DWORD LastAttribute;
+    WORD LineWidth;
+    WORD FirstLine;
+    WORD LinesPerChunk;
+    WORD LinesThisChunk;
     WORD LineIndex;
+    WORD CharIndex;
+    WORD LastAttribute;
+    DWORD LinesProcessed;
+    DWORD CellCount;
+    DWORD CharsNeeded;
+    DWORD CurrentMode;
+    BOOLEAN TargetIsConsole;
+    BOOL Result;
+    PCHAR_INFO Line;
+    YORI_STRING Output;
+    TCHAR EscapeStringBuffer[YORI_MAX_INTERNAL_VT_ESCAPE_CHARS];
+    YORI_STRING EscapeString;
 
     hConsole = CreateFile(_T("CONOUT$"), GENERIC_READ|GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
     if (hConsole == INVALID_HANDLE_VALUE) {
@@ -84,71 +238,105 @@ YoriLibRewriteConsoleContents(
         return FALSE;
     }
 
-    ReadWindow.Left = 0;
-    ReadWindow.Right = (WORD)(ScreenInfo.dwSize.X - 1);
-    ReadWindow.Top = (WORD)(ScreenInfo.dwCursorPosition.Y - SkipCount - LineCount);
-    ReadWindow.Bottom = (WORD)(ScreenInfo.dwCursorPosition.Y - SkipCount - 1);
+    LineWidth = (WORD)ScreenInfo.dwSize.X;
+    FirstLine = (WORD)(ScreenInfo.dwCursorPosition.Y - SkipCount - LineCount);
 
-    ReadBufferSize.X = (WORD)(ReadWindow.Right - ReadWindow.Left + 1);
-    ReadBufferSize.Y = (WORD)(ReadWindow.Bottom - ReadWindow.Top + 1);
+    LinesPerChunk = (WORD)(YORI_LIB_CSHOT_READ_BYTES / (LineWidth * sizeof(CHAR_INFO)));
+    if (LinesPerChunk == 0) {
+        LinesPerChunk = 1;
+    }
+    if (LinesPerChunk > LineCount) {
+        LinesPerChunk = (WORD)LineCount;
+    }
 
-    ReadBuffer = YoriLibMalloc(ReadBufferSize.X * ReadBufferSize.Y * sizeof(CHAR_INFO));
+    ReadBuffer = YoriLibMalloc(LinesPerChunk * LineWidth * sizeof(CHAR_INFO));
     if (ReadBuffer == NULL) {
         CloseHandle(hConsole);
         return FALSE;
     }
 
-    ReadBufferOffset.X = 0;
-    ReadBufferOffset.Y = 0;
+    YoriLibInitEmptyString(&EscapeString);
+    EscapeString.StartOfString = EscapeStringBuffer;
+    EscapeString.LengthAllocated = sizeof(EscapeStringBuffer)/sizeof(EscapeStringBuffer[0]);
+
+    YoriLibInitEmptyString(&Output);
 
     //
-    //  ReadConsoleOutput fails if it's given a large request, so give it
-    //  a pile of small (one line) requests.
+    //  If the target is a console, lines are as wide as the console and
+    //  wrap without needing a newline.
     //
 
-    for (LineIndex = 0; LineIndex < (WORD)ReadBufferSize.Y; LineIndex++) {
-        SMALL_RECT LineReadWindow;
-        COORD LineReadBufferSize;
-
-        LineReadWindow.Left = ReadWindow.Left;
-        LineReadWindow.Right = ReadWindow.Right;
-        LineReadWindow.Top = (WORD)(ReadWindow.Top + LineIndex);
-        LineReadWindow.Bottom = LineReadWindow.Top;
-
-        LineReadBufferSize.X = ReadBufferSize.X;
-        LineReadBufferSize.Y = 1;
-
-        if (!ReadConsoleOutput(hConsole, &ReadBuffer[LineIndex * ReadBufferSize.X], LineReadBufferSize, ReadBufferOffset, &LineReadWindow)) {
-            CloseHandle(hConsole);
-            YoriLibFree(ReadBuffer);
-            return FALSE;
-        }
+    TargetIsConsole = FALSE;
+    if (GetConsoleMode(hTarget, &CurrentMode)) {
+        TargetIsConsole = TRUE;
     }
 
-    YoriLibVtSetConsoleTextAttributeOnDevice(hTarget, 0, 0, ReadBuffer[0].Attributes);
-    LastAttribute = ReadBuffer[0].Attributes;
+    Result = TRUE;
+    LinesProcessed = 0;
+    while (LinesProcessed < LineCount) {
+        LinesThisChunk = LinesPerChunk;
+        if (LinesThisChunk > LineCount - LinesProcessed) {
+            LinesThisChunk = (WORD)(LineCount - LinesProcessed);
+        }
 
-    for (ReadBufferOffset.Y = 0; ReadBufferOffset.Y < ReadBufferSize.Y; ReadBufferOffset.Y++) {
-        DWORD CurrentMode;
+        if (!YoriLibCshotReadLines(hConsole, ReadBuffer, LineWidth, (WORD)(FirstLine + LinesProcessed), LinesThisChunk)) {
+            Result = FALSE;
+            break;
+        }
 
-        for (ReadBufferOffset.X = 0; ReadBufferOffset.X < ReadBufferSize.X; ReadBufferOffset.X++) {
-            DWORD CellIndex;
+        //
+        //  Each chunk starts with an escape for its first attribute, so it
+        //  can be processed as an independent stream, and needs another
+        //  escape each time the attribute changes.
+        //
+
+        CellCount = LinesThisChunk * LineWidth;
+        CharsNeeded = CellCount + LinesThisChunk * 2;
+        CharsNeeded += (YoriLibCshotCountAttributeChanges(&ReadBuffer[0].Attributes, sizeof(CHAR_INFO), CellCount) + 1) * (DWORD)YORI_MAX_INTERNAL_VT_ESCAPE_CHARS;
+
+        if (Output.LengthAllocated < CharsNeeded) {
+            YoriLibFreeStringContents(&Output);
+            if (!YoriLibAllocateString(&Output, CharsNeeded)) {
+                Result = FALSE;
+                break;
+            }
+        }
 
-            CellIndex = ReadBufferOffset.Y * ReadBufferSize.X + ReadBufferOffset.X;
+        Output.LengthInChars = 0;
+        LastAttribute = ReadBuffer[0].Attributes;
+        YoriLibCshotAppendEscape(&Output, &EscapeString, LastAttribute);
+
+        for (LineIndex = 0; LineIndex < LinesThisChunk; LineIndex++) {
+            Line = &ReadBuffer[LineIndex * LineWidth];
+            for (CharIndex = 0; CharIndex < LineWidth; CharIndex++) {
+                if (Line[CharIndex].Attributes != LastAttribute) {
+                    LastAttribute = Line[CharIndex].Attributes;
+                    YoriLibCshotAppendEscape(&Output, &EscapeString, LastAttribute);
+                }
+                Output.StartOfString[Output.LengthInChars] = Line[CharIndex].Char.UnicodeChar;
+                Output.LengthInChars++;
+            }
 
-            if (ReadBuffer[CellIndex].Attributes != LastAttribute) {
-                YoriLibVtSetConsoleTextAttributeOnDevice(hTarget, 0, 0, ReadBuffer[CellIndex].Attributes);
-                LastAttribute = ReadBuffer[CellIndex].Attributes;
+            if (!TargetIsConsole) {
+                Output.StartOfString[Output.LengthInChars] = '\n';
+                Output.LengthInChars++;
             }
-            YoriLibOutputToDevice(hTarget, 0, _T("%c"), ReadBuffer[CellIndex].Char.UnicodeChar);
         }
-        if (!GetConsoleMode(hTarget, &CurrentMode)) {
-            YoriLibOutputToDevice(hTarget, 0, _T("\n"));
+
+        if (!YoriLibOutputString(hTarget, 0, &Output)) {
+            Result = FALSE;
+            break;
         }
+
+        LinesProcessed += LinesThisChunk;
     }
 
+    ASSERT(EscapeString.StartOfString == EscapeStringBuffer);
+
+    YoriLibFreeStringContents(&Output);
     YoriLibFree(ReadBuffer);
-    return TRUE;
+    CloseHandle(hConsole);
+    return Result;
 }
 
 /**
@@ -176,8 +364,12 @@ YoriLibGenerateVtStringFromConsoleBuffers(
     )
 {
     DWORD BufferSizeNeeded;
+    DWORD CellCount;
+    DWORD LineStart;
+    DWORD RunStart;
+    DWORD RunEnd;
+    DWORD LineEnd;
     SHORT LineIndex;
-    SHORT CharIndex;
     WORD LastAttribute;
     TCHAR EscapeStringBuffer[YORI_MAX_INTERNAL_VT_ESCAPE_CHARS];
     YORI_STRING EscapeString;
@@ -192,29 +384,14 @@ YoriLibGenerateVtStringFromConsoleBuffers(
 
     //
     //  We'll need a buffer that's at least big enough to hold all the text
-    //  with some newlines and a terminator
+    //  with some newlines and a terminator, plus an escape for the initial
+    //  attribute and each time it changes.  Escapes are sized at their
+    //  maximum length so each is only generated once.
     //
 
+    CellCount = BufferSize.X * BufferSize.Y;
     BufferSizeNeeded = (BufferSize.X + 2) * BufferSize.Y + 1;
-
-    //
-    //  Now go through the attributes and add in the size of any escapes
-    //  needed
-    //
-
-    LastAttribute = AttrBuffer[0];
-    YoriLibVtStringForTextAttribute(&EscapeString, 0, LastAttribute);
-    BufferSizeNeeded += EscapeString.LengthInChars;
-
-    for (LineIndex = 0; LineIndex < BufferSize.Y; LineIndex++) {
-        for (CharIndex = 0; CharIndex < BufferSize.X; CharIndex++) {
-            if (AttrBuffer[LineIndex * BufferSize.X + CharIndex] != LastAttribute) {
-                LastAttribute = AttrBuffer[LineIndex * BufferSize.X + CharIndex];
-                YoriLibVtStringForTextAttribute(&EscapeString, 0, LastAttribute);
-                BufferSizeNeeded += EscapeString.LengthInChars;
-            }
-        }
-    }
+    BufferSizeNeeded += (YoriLibCshotCountAttributeChanges(AttrBuffer, sizeof(WORD), CellCount) + 1) * (DWORD)YORI_MAX_INTERNAL_VT_ESCAPE_CHARS;
 
     //
     //  Allocate a buffer of sufficient size if it's not allocated already
@@ -228,27 +405,33 @@ YoriLibGenerateVtStringFromConsoleBuffers(
     }
 
     //
-    //  Go through again populating both text and escapes into the output
-    //  buffer
+    //  Populate both text and escapes into the output buffer, copying each
+    //  run of characters sharing an attribute at once
     //
 
     String->LengthInChars = 0;
     LastAttribute = AttrBuffer[0];
-    YoriLibVtStringForTextAttribute(&EscapeString, 0, LastAttribute);
-
-    memcpy(&String->StartOfString[String->LengthInChars], EscapeString.StartOfString, EscapeString.LengthInChars * sizeof(TCHAR));
-    String->LengthInChars += EscapeString.LengthInChars;
+    YoriLibCshotAppendEscape(String, &EscapeString, LastAttribute);
 
     for (LineIndex = 0; LineIndex < BufferSize.Y; LineIndex++) {
-        for (CharIndex = 0; CharIndex < BufferSize.X; CharIndex++) {
-            if (AttrBuffer[LineIndex * BufferSize.X + CharIndex] != LastAttribute) {
-                LastAttribute = AttrBuffer[LineIndex * BufferSize.X + CharIndex];
-                YoriLibVtStringForTextAttribute(&EscapeString, 0, LastAttribute);
-                memcpy(&String->StartOfString[String->LengthInChars], EscapeString.StartOfString, EscapeString.LengthInChars * sizeof(TCHAR));
-                String->LengthInChars += EscapeString.LengthInChars;
+        LineStart = LineIndex * BufferSize.X;
+        LineEnd = LineStart + BufferSize.X;
+        RunStart = LineStart;
+        while (RunStart < LineEnd) {
+            if (AttrBuffer[RunStart] != LastAttribute) {
+                LastAttribute = AttrBuffer[RunStart];
+                YoriLibCshotAppendEscape(String, &EscapeString, LastAttribute);
             }
-            String->StartOfString[String->LengthInChars] = CharBuffer[LineIndex * BufferSize.X + CharIndex];
-            String->LengthInChars++;
+
+            for (RunEnd = RunStart + 1; RunEnd < LineEnd; RunEnd++) {
+                if (AttrBuffer[RunEnd] != LastAttribute) {
+                    break;
+                }
+            }
+
+            memcpy(&String->StartOfString[String->LengthInChars], &CharBuffer[RunStart], (RunEnd - RunStart) * sizeof(TCHAR));
+            String->LengthInChars += RunEnd - RunStart;
+            RunStart = RunEnd;
         }
 
         String->StartOfString[String->LengthInChars] = '\r';
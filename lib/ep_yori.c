@@ -56,6 +56,8 @@ VOID __cdecl CONSOLE_CRT_ENTRYPOINT(VOID)
 
     YoriLibLoadNtDllFunctions();
     YoriLibLoadKernel32Functions();
+    YoriLibAllocProfileInitialize();
+    YoriLibTraceInitialize();
 
     ArgV = YoriLibCmdlineToArgcArgv(GetCommandLine(), (DWORD)-1, FALSE, &ArgC);
     if (ArgV == NULL) {
@@ -67,6 +69,8 @@ VOID __cdecl CONSOLE_CRT_ENTRYPOINT(VOID)
     }
     YoriLibDereference(ArgV);
 
+    YoriLibTraceCleanup();
+    YoriLibAllocProfileCleanup();
     YoriLibDisplayMemoryUsage();
 
     ExitProcess(ExitCode);
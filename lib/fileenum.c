@@ -694,7 +694,11 @@ YoriLibForEachFile(
     BOOL SingleCharMode;
 
     if (MatchFlags & YORILIB_FILEENUM_BASIC_EXPANSION) {
-        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
+        BOOL Result;
+        YORI_TRACE_BEGIN("File enumerate");
+        Result = YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
+        YORI_TRACE_END("File enumerate");
+        return Result;
     }
 
     SingleCharMode = FALSE;
@@ -707,14 +711,17 @@ YoriLibForEachFile(
 
     if (CharsToOperator == FileSpec->LengthInChars) {
 
+        BOOL Result;
+
+        YORI_TRACE_BEGIN("File enumerate");
         if (YoriLibExpandHomeDirectories(FileSpec, &NewFileSpec)) {
-            BOOL Result;
             Result = YoriLibForEachFileEnum(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
             YoriLibFreeStringContents(&NewFileSpec);
-            return Result;
+        } else {
+            Result = YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
         }
-
-        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
+        YORI_TRACE_END("File enumerate");
+        return Result;
     }
 
     YoriLibInitEmptyString(&BeforeOperator);
@@ -146,58 +146,127 @@ YoriLibHashString(
 }
 
 /**
- Insert an object with a string based key into the hash table.
+ Return the bucket index within a hash table for a 32 bit hash value.  This
+ applies the same folding as @ref YoriLibHashString .
+
+ @param HashTable The hash table.
+
+ @param Hash The 32 bit hash value, as returned from
+        @ref YoriLibHashString32 with an initial hash of zero.
+
+ @return The index of the bucket that should contain the entry.
+ */
+DWORD
+YoriLibHashBucketIndex(
+    __in PYORI_HASH_TABLE HashTable,
+    __in DWORD Hash
+    )
+{
+    WORD FoldedHash;
+    FoldedHash = (WORD)(Hash ^ (Hash >> 16));
+    return FoldedHash % HashTable->NumberBuckets;
+}
+
+/**
+ Insert an object with a string based key into the hash table, where the
+ caller has already calculated the hash of the key.
 
  @param HashTable The hash table to insert the object into.
 
  @param KeyString Pointer to a Yori string describing the key for the
         entry.
 
+ @param Hash The hash of KeyString, as returned from
+        @ref YoriLibHashString32 with an initial hash of zero.
+
  @param Context Pointer to a blob of data which is meaningful to the caller.
 
  @param HashEntry On successful completion, populated with structures
         describing the entry within the hash table.
  */
 VOID
-YoriLibHashInsertByKey(
+YoriLibHashInsertByHashedKey(
     __in PYORI_HASH_TABLE HashTable,
     __in PYORI_STRING KeyString,
+    __in DWORD Hash,
     __in PVOID Context,
     __out PYORI_HASH_ENTRY HashEntry
     )
 {
-    DWORD BucketIndex = YoriLibHashString(KeyString) % HashTable->NumberBuckets;
+    DWORD BucketIndex = YoriLibHashBucketIndex(HashTable, Hash);
+
+    ASSERT(Hash == YoriLibHashString32(0, KeyString));
 
     YoriLibCloneString(&HashEntry->Key, KeyString);
     HashEntry->Context = Context;
+    HashEntry->Hash = Hash;
     YoriLibInsertList(&HashTable->Buckets[BucketIndex].ListHead, &HashEntry->ListEntry);
 }
 
 /**
- Locate an object within the hash table by a specified key.
+ Insert an object with a string based key into the hash table.
+
+ @param HashTable The hash table to insert the object into.
+
+ @param KeyString Pointer to a Yori string describing the key for the
+        entry.
+
+ @param Context Pointer to a blob of data which is meaningful to the caller.
+
+ @param HashEntry On successful completion, populated with structures
+        describing the entry within the hash table.
+ */
+VOID
+YoriLibHashInsertByKey(
+    __in PYORI_HASH_TABLE HashTable,
+    __in PYORI_STRING KeyString,
+    __in PVOID Context,
+    __out PYORI_HASH_ENTRY HashEntry
+    )
+{
+    YoriLibHashInsertByHashedKey(HashTable, KeyString, YoriLibHashString32(0, KeyString), Context, HashEntry);
+}
+
+/**
+ Locate an object within the hash table by a specified key, where the caller
+ has already calculated the hash of the key.  This allows a caller to search
+ multiple tables for the same key without hashing it for each.
 
  @param HashTable Pointer to the hash table to search for the object.
 
  @param KeyString Pointer to the key to identify the object.
 
+ @param Hash The hash of KeyString, as returned from
+        @ref YoriLibHashString32 with an initial hash of zero.
+
  @return Pointer to the entry within the hash table if a match is found.
          If no match is found, returns NULL.
  */
 PYORI_HASH_ENTRY
-YoriLibHashLookupByKey(
+YoriLibHashLookupByHashedKey(
     __in PYORI_HASH_TABLE HashTable,
-    __in PCYORI_STRING KeyString
+    __in PCYORI_STRING KeyString,
+    __in DWORD Hash
     )
 {
-    DWORD BucketIndex = YoriLibHashString(KeyString) % HashTable->NumberBuckets;
+    DWORD BucketIndex = YoriLibHashBucketIndex(HashTable, Hash);
     PYORI_LIST_ENTRY ListEntry;
     PYORI_HASH_ENTRY HashEntry;
 
+    ASSERT(Hash == YoriLibHashString32(0, KeyString));
+
+    //
+    //  Compare the full hash before comparing strings, so that entries
+    //  which share a bucket but not a key can be skipped cheaply.
+    //
+
     HashEntry = NULL;
     ListEntry = YoriLibGetNextListEntry(&HashTable->Buckets[BucketIndex].ListHead, NULL);
     while (ListEntry != NULL) {
         HashEntry = CONTAINING_RECORD(ListEntry, YORI_HASH_ENTRY, ListEntry);
-        if (YoriLibCompareStringInsensitive(KeyString, &HashEntry->Key) == 0) {
+        if (HashEntry->Hash == Hash &&
+            HashEntry->Key.LengthInChars == KeyString->LengthInChars &&
+            YoriLibCompareStringInsensitive(KeyString, &HashEntry->Key) == 0) {
             break;
         }
         HashEntry = NULL;
@@ -207,6 +276,25 @@ YoriLibHashLookupByKey(
     return HashEntry;
 }
 
+/**
+ Locate an object within the hash table by a specified key.
+
+ @param HashTable Pointer to the hash table to search for the object.
+
+ @param KeyString Pointer to the key to identify the object.
+
+ @return Pointer to the entry within the hash table if a match is found.
+         If no match is found, returns NULL.
+ */
+PYORI_HASH_ENTRY
+YoriLibHashLookupByKey(
+    __in PYORI_HASH_TABLE HashTable,
+    __in PCYORI_STRING KeyString
+    )
+{
+    return YoriLibHashLookupByHashedKey(HashTable, KeyString, YoriLibHashString32(0, KeyString));
+}
+
 /**
  Remove an entry from a hash table.  This routine assumes the entry must
  already be inserted into a hash table.
@@ -247,4 +335,229 @@ YoriLibHashRemoveByKey(
     return Entry;
 }
 
+/**
+ A string that has been interned.  The characters of the string follow this
+ structure in the same allocation, followed by the characters of the string
+ converted to upper case.  The MemoryToFree member of any interned string
+ points to this structure.
+ */
+typedef struct _YORI_INTERNED_STRING {
+
+    /**
+     The entry of this string within the intern table.  The key of this
+     entry is the interned string, and the reference it holds is the intern
+     table's reference to the allocation.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The string converted to upper case, so that interned strings can be
+     compared case insensitively without converting each character.
+     */
+    YORI_STRING Folded;
+
+} YORI_INTERNED_STRING, *PYORI_INTERNED_STRING;
+
+/**
+ Return a shared copy of a string.  Every call with an identical string
+ against the same intern table returns the same allocation, so strings used
+ repeatedly are only stored once, and interned strings from the same table
+ can be compared with @ref YoriLibAreInternedStringsEqual .  An intern table
+ is a hash table allocated with @ref YoriLibAllocateHashTable and freed with
+ @ref YoriLibFreeInternTable .  Interning is case sensitive, but each
+ interned string has its case insensitive hash and upper case form
+ calculated once.
+
+ @param InternTable Pointer to the intern table.
+
+ @param String Pointer to the string to intern.
+
+ @param InternedString On successful completion, populated with a
+        referenced string.  The caller should free this with
+        @ref YoriLibFreeStringContents .  Interned strings must not be
+        modified.
+
+ @return TRUE to indicate success, FALSE to indicate allocation failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibInternString(
+    __in PYORI_HASH_TABLE InternTable,
+    __in PCYORI_STRING String,
+    __out PYORI_STRING InternedString
+    )
+{
+    PYORI_INTERNED_STRING Interned;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_HASH_ENTRY HashEntry;
+    YORI_STRING NewString;
+    DWORD BucketIndex;
+    DWORD Hash;
+    DWORD Index;
+
+    Hash = YoriLibHashString32(0, String);
+    BucketIndex = YoriLibHashBucketIndex(InternTable, Hash);
+
+    ListEntry = YoriLibGetNextListEntry(&InternTable->Buckets[BucketIndex].ListHead, NULL);
+    while (ListEntry != NULL) {
+        HashEntry = CONTAINING_RECORD(ListEntry, YORI_HASH_ENTRY, ListEntry);
+        if (HashEntry->Hash == Hash &&
+            YoriLibCompareString(String, &HashEntry->Key) == 0) {
+
+            YoriLibCloneString(InternedString, &HashEntry->Key);
+            return TRUE;
+        }
+        ListEntry = YoriLibGetNextListEntry(&InternTable->Buckets[BucketIndex].ListHead, ListEntry);
+    }
+
+    Interned = YoriLibReferencedMalloc(sizeof(YORI_INTERNED_STRING) + 2 * (String->LengthInChars + 1) * sizeof(TCHAR));
+    if (Interned == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&NewString);
+    NewString.MemoryToFree = Interned;
+    NewString.StartOfString = (LPTSTR)(Interned + 1);
+    NewString.LengthInChars = String->LengthInChars;
+    NewString.LengthAllocated = String->LengthInChars + 1;
+    memcpy(NewString.StartOfString, String->StartOfString, String->LengthInChars * sizeof(TCHAR));
+    NewString.StartOfString[String->LengthInChars] = '\0';
+
+    YoriLibInitEmptyString(&Interned->Folded);
+    Interned->Folded.StartOfString = NewString.StartOfString + NewString.LengthAllocated;
+    Interned->Folded.LengthInChars = String->LengthInChars;
+    Interned->Folded.LengthAllocated = String->LengthInChars + 1;
+    for (Index = 0; Index < String->LengthInChars; Index++) {
+        Interned->Folded.StartOfString[Index] = YoriLibUpcaseChar(String->StartOfString[Index]);
+    }
+    Interned->Folded.StartOfString[String->LengthInChars] = '\0';
+
+    //
+    //  The hash entry takes a reference on the allocation for the table,
+    //  and the initial reference is returned to the caller.
+    //
+
+    YoriLibHashInsertByHashedKey(InternTable, &NewString, Hash, Interned, &Interned->HashEntry);
+    memcpy(InternedString, &NewString, sizeof(YORI_STRING));
+    return TRUE;
+}
+
+/**
+ Return the case insensitive hash of an interned string, as calculated by
+ @ref YoriLibHashString32 with an initial hash of zero.
+
+ @param InternedString Pointer to a string returned from
+        @ref YoriLibInternString .
+
+ @return The hash of the string.
+ */
+DWORD
+YoriLibGetInternedStringHash(
+    __in PCYORI_STRING InternedString
+    )
+{
+    PYORI_INTERNED_STRING Interned;
+    Interned = InternedString->MemoryToFree;
+    return Interned->HashEntry.Hash;
+}
+
+/**
+ Return the upper case form of an interned string.
+
+ @param InternedString Pointer to a string returned from
+        @ref YoriLibInternString .
+
+ @return Pointer to the upper case form of the string.  This remains valid
+         for as long as the caller holds the interned string.
+ */
+PCYORI_STRING
+YoriLibGetInternedStringFolded(
+    __in PCYORI_STRING InternedString
+    )
+{
+    PYORI_INTERNED_STRING Interned;
+    Interned = InternedString->MemoryToFree;
+    return &Interned->Folded;
+}
+
+/**
+ Compare two interned strings for equality without regard to case.  The
+ strings need not come from the same intern table.
+
+ @param First Pointer to the first interned string.
+
+ @param Second Pointer to the second interned string.
+
+ @return TRUE if the strings are equal without regard to case, FALSE if
+         they are different.
+ */
+BOOLEAN
+YoriLibAreInternedStringsEqualInsensitive(
+    __in PCYORI_STRING First,
+    __in PCYORI_STRING Second
+    )
+{
+    PYORI_INTERNED_STRING FirstInterned;
+    PYORI_INTERNED_STRING SecondInterned;
+
+    if (YoriLibAreInternedStringsEqual(First, Second)) {
+        return TRUE;
+    }
+
+    FirstInterned = First->MemoryToFree;
+    SecondInterned = Second->MemoryToFree;
+
+    if (FirstInterned->HashEntry.Hash != SecondInterned->HashEntry.Hash ||
+        FirstInterned->Folded.LengthInChars != SecondInterned->Folded.LengthInChars) {
+
+        return FALSE;
+    }
+
+    if (memcmp(FirstInterned->Folded.StartOfString,
+               SecondInterned->Folded.StartOfString,
+               FirstInterned->Folded.LengthInChars * sizeof(TCHAR)) != 0) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Free an intern table.  Interned strings still held by callers remain valid
+ until they are freed.
+
+ @param InternTable Pointer to the intern table to free.
+ */
+VOID
+YoriLibFreeInternTable(
+    __in PYORI_HASH_TABLE InternTable
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_HASH_ENTRY HashEntry;
+    YORI_STRING Key;
+    DWORD BucketIndex;
+
+    for (BucketIndex = 0; BucketIndex < InternTable->NumberBuckets; BucketIndex++) {
+        ListEntry = YoriLibGetNextListEntry(&InternTable->Buckets[BucketIndex].ListHead, NULL);
+        while (ListEntry != NULL) {
+
+            //
+            //  The key holds the table's reference on the allocation that
+            //  contains the hash entry, so the entry may be freed when the
+            //  key is released.  Capture the key before releasing it.
+            //
+
+            HashEntry = CONTAINING_RECORD(ListEntry, YORI_HASH_ENTRY, ListEntry);
+            YoriLibRemoveListItem(&HashEntry->ListEntry);
+            memcpy(&Key, &HashEntry->Key, sizeof(YORI_STRING));
+            YoriLibFreeStringContents(&Key);
+            ListEntry = YoriLibGetNextListEntry(&InternTable->Buckets[BucketIndex].ListHead, NULL);
+        }
+    }
+
+    YoriLibFreeEmptyHashTable(InternTable);
+}
+
 // vim:sw=4:ts=4:et:
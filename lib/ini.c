@@ -0,0 +1,2096 @@
+/**
+ * @file lib/ini.c
+ *
+ * Yori in memory INI file support
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+
+/**
+ A single line within an INI file.  Every line in the file, including
+ comments and blank lines, is retained so that the file can be written back
+ without disturbing content that was not modified.
+ */
+typedef struct _YORI_LIB_INI_LINE {
+
+    /**
+     The entry for this line within the list of lines in its section.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The entry for this line within the hash table of keys in its section.
+     This is only meaningful if Indexed is TRUE.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The full text of the line, excluding any line terminator.  If the line
+     has been modified this refers to an allocation owned by the line,
+     otherwise it refers to the contents of the document.
+     */
+    YORI_STRING Text;
+
+    /**
+     If the line describes a key, the name of the key with surrounding white
+     space removed.  This refers to a subset of Text.
+     */
+    YORI_STRING Key;
+
+    /**
+     If the line describes a key, the value of the key with surrounding white
+     space removed.  This refers to a subset of Text.
+     */
+    YORI_STRING Value;
+
+    /**
+     TRUE if the line describes a key, FALSE if it is a comment or blank.
+     */
+    BOOLEAN IsKey;
+
+    /**
+     TRUE if the line contains an equals sign separating a key from a value.
+     Lines without one are keys with no value.
+     */
+    BOOLEAN HasValue;
+
+    /**
+     TRUE if the line is inserted into the hash table of keys in its
+     section.  Only the first key with any given name is inserted, which
+     is the one that the OS functions would return.
+     */
+    BOOLEAN Indexed;
+} YORI_LIB_INI_LINE, *PYORI_LIB_INI_LINE;
+
+/**
+ A section within an INI file.
+ */
+typedef struct _YORI_LIB_INI_SECTION {
+
+    /**
+     The entry for this section within the list of sections in the
+     document.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The entry for this section within the hash table of sections in the
+     document.  This is only meaningful if Indexed is TRUE.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The full text of the line that starts the section, excluding any line
+     terminator.  This is empty for lines that precede any section.
+     */
+    YORI_STRING Header;
+
+    /**
+     The name of the section.  This refers to a subset of Header.
+     */
+    YORI_STRING Name;
+
+    /**
+     The list of lines within the section, in file order.
+     */
+    YORI_LIST_ENTRY Lines;
+
+    /**
+     A hash table of keys within the section.  This is NULL for lines that
+     precede any section, since those cannot be queried.
+     */
+    PYORI_HASH_TABLE Keys;
+
+    /**
+     The number of key lines within the section, used to size the hash
+     table when a file is loaded.
+     */
+    DWORD KeyCount;
+
+    /**
+     TRUE if the section is inserted into the hash table of sections in the
+     document.  Only the first section with any given name is inserted.
+     */
+    BOOLEAN Indexed;
+} YORI_LIB_INI_SECTION, *PYORI_LIB_INI_SECTION;
+
+/**
+ A lock on an INI file held by a thread in this process.
+ */
+typedef struct _YORI_LIB_INI_LOCK {
+
+    /**
+     The entry for this lock within the list of locks held by this process.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The name of the lock file.
+     */
+    YORI_STRING FileName;
+
+    /**
+     A handle to the lock file, which has the lock held on it.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The thread which acquired the lock.  Documents loaded by this thread
+     for the same file share the lock.
+     */
+    DWORD ThreadId;
+
+    /**
+     The number of documents which refer to this lock.
+     */
+    DWORD ReferenceCount;
+} YORI_LIB_INI_LOCK, *PYORI_LIB_INI_LOCK;
+
+/**
+ An INI file which has been parsed into memory.
+ */
+typedef struct _YORI_LIB_INI_DOCUMENT {
+
+    /**
+     The name of the file that the document was loaded from and will be
+     saved to.
+     */
+    YORI_STRING FileName;
+
+    /**
+     The decoded contents of the file when it was loaded.  Unmodified lines
+     refer to this buffer.
+     */
+    YORI_STRING Contents;
+
+    /**
+     Lines within the file that precede any section.
+     */
+    YORI_LIB_INI_SECTION Preamble;
+
+    /**
+     The list of sections within the document, in file order.
+     */
+    YORI_LIST_ENTRY Sections;
+
+    /**
+     A hash table of sections within the document.
+     */
+    PYORI_HASH_TABLE SectionTable;
+
+    /**
+     The encoding of the file, which is preserved when it is saved.  This is
+     CP_UTF16 if the file had a UTF-16 byte order mark, CP_UTF8 if the file
+     had a UTF-8 byte order mark, or CP_ACP otherwise.
+     */
+    DWORD Encoding;
+
+    /**
+     The lock which serializes access to the file between processes, or NULL
+     if the lock could not be obtained because the directory is not
+     writable.  The lock is held from when the document is loaded until it
+     is freed, so that another process cannot load the file, modify it, and
+     save it between this document being loaded and saved.
+     */
+    PYORI_LIB_INI_LOCK Lock;
+
+    /**
+     TRUE if lines in the file were terminated with a line feed only, which
+     is preserved when it is saved.  FALSE if lines were terminated with a
+     carriage return and line feed, or the file had no line terminators.
+     */
+    BOOLEAN LineFeedOnly;
+
+    /**
+     TRUE if the document has been modified since it was loaded or saved.
+     */
+    BOOLEAN Dirty;
+} YORI_LIB_INI_DOCUMENT;
+
+/**
+ The number of hash buckets to use for a section that is created in memory,
+ where the eventual number of keys is not known.
+ */
+#define YORI_LIB_INI_DEFAULT_BUCKETS (31)
+
+/**
+ The prefix to use for temporary files created when saving a document.
+ */
+#define YORI_LIB_INI_TEMP_PREFIX _T("YINI")
+
+/**
+ The suffix appended to the name of an INI file to form the name of its lock
+ file.
+ */
+#define YORI_LIB_INI_LOCK_SUFFIX _T(".lck")
+
+/**
+ The number of milliseconds to wait before retrying to open a lock file which
+ is being deleted by the process that last held it.
+ */
+#define YORI_LIB_INI_LOCK_RETRY_DELAY (20)
+
+/**
+ The list of locks on INI files held by this process.  This is protected by
+ the mutex returned from @ref YoriLibIniAcquireLockList.
+ */
+YORI_LIST_ENTRY YoriLibIniLockList;
+
+/**
+ TRUE once @ref YoriLibIniLockList has been initialized.
+ */
+BOOLEAN YoriLibIniLockListInitialized;
+
+/**
+ Return the number of hash buckets to use for a table that initially
+ contains a specified number of entries.
+
+ @param EntryCount The number of entries.
+
+ @return The number of hash buckets to allocate.
+ */
+DWORD
+YoriLibIniBucketCount(
+    __in DWORD EntryCount
+    )
+{
+    return EntryCount / 2 + YORI_LIB_INI_DEFAULT_BUCKETS;
+}
+
+/**
+ Remove spaces and tabs from the beginning and end of a string.  This is
+ what the OS functions consider white space within an INI file.
+
+ @param String Pointer to the string to trim.  On completion, updated to
+        refer to the subset of the string without surrounding white space.
+ */
+VOID
+YoriLibIniTrim(
+    __inout PYORI_STRING String
+    )
+{
+    while (String->LengthInChars > 0 &&
+           (String->StartOfString[0] == ' ' || String->StartOfString[0] == '\t')) {
+        String->StartOfString++;
+        String->LengthInChars--;
+    }
+
+    while (String->LengthInChars > 0 &&
+           (String->StartOfString[String->LengthInChars - 1] == ' ' ||
+            String->StartOfString[String->LengthInChars - 1] == '\t')) {
+        String->LengthInChars--;
+    }
+}
+
+/**
+ Parse the text of a line within a section to determine whether it
+ describes a key, and if so, the key name and value.  The Text member of the
+ line must be populated on entry.
+
+ @param Line Pointer to the line to parse.
+ */
+VOID
+YoriLibIniParseKeyLine(
+    __inout PYORI_LIB_INI_LINE Line
+    )
+{
+    YORI_STRING Trimmed;
+    DWORD Index;
+
+    YoriLibInitEmptyString(&Line->Key);
+    YoriLibInitEmptyString(&Line->Value);
+    Line->IsKey = FALSE;
+    Line->HasValue = FALSE;
+
+    YoriLibInitEmptyString(&Trimmed);
+    Trimmed.StartOfString = Line->Text.StartOfString;
+    Trimmed.LengthInChars = Line->Text.LengthInChars;
+    YoriLibIniTrim(&Trimmed);
+
+    if (Trimmed.LengthInChars == 0 || Trimmed.StartOfString[0] == ';') {
+        return;
+    }
+
+    Line->IsKey = TRUE;
+    Line->Key.StartOfString = Trimmed.StartOfString;
+    Line->Key.LengthInChars = Trimmed.LengthInChars;
+
+    for (Index = 0; Index < Trimmed.LengthInChars; Index++) {
+        if (Trimmed.StartOfString[Index] == '=') {
+            Line->HasValue = TRUE;
+            Line->Key.LengthInChars = Index;
+            Line->Value.StartOfString = &Trimmed.StartOfString[Index + 1];
+            Line->Value.LengthInChars = Trimmed.LengthInChars - Index - 1;
+            break;
+        }
+    }
+
+    YoriLibIniTrim(&Line->Key);
+    YoriLibIniTrim(&Line->Value);
+}
+
+/**
+ Allocate and initialize a section structure.
+
+ @param Header Pointer to the text of the line that starts the section.
+        This string is referenced by the section if it has a MemoryToFree
+        member.
+
+ @param NumberBuckets The number of buckets to allocate in the hash table of
+        keys, or zero to defer allocating the hash table.
+
+ @return Pointer to the section, or NULL on allocation failure.
+ */
+PYORI_LIB_INI_SECTION
+YoriLibIniAllocateSection(
+    __in PYORI_STRING Header,
+    __in DWORD NumberBuckets
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    DWORD Index;
+
+    Section = YoriLibMalloc(sizeof(YORI_LIB_INI_SECTION));
+    if (Section == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Section, sizeof(YORI_LIB_INI_SECTION));
+    YoriLibInitializeListHead(&Section->Lines);
+    if (NumberBuckets > 0) {
+        Section->Keys = YoriLibAllocateHashTable(NumberBuckets);
+        if (Section->Keys == NULL) {
+            YoriLibFree(Section);
+            return NULL;
+        }
+    }
+
+    YoriLibCloneString(&Section->Header, Header);
+
+    //
+    //  The name is the text between the opening bracket and the closing
+    //  bracket.  If there is no closing bracket, it extends to the end of
+    //  the line.
+    //
+
+    YoriLibInitEmptyString(&Section->Name);
+    Section->Name.StartOfString = Header->StartOfString;
+    Section->Name.LengthInChars = Header->LengthInChars;
+    YoriLibIniTrim(&Section->Name);
+    if (Section->Name.LengthInChars > 0 && Section->Name.StartOfString[0] == '[') {
+        Section->Name.StartOfString++;
+        Section->Name.LengthInChars--;
+    }
+
+    for (Index = 0; Index < Section->Name.LengthInChars; Index++) {
+        if (Section->Name.StartOfString[Index] == ']') {
+            Section->Name.LengthInChars = Index;
+            break;
+        }
+    }
+
+    YoriLibIniTrim(&Section->Name);
+    return Section;
+}
+
+/**
+ Insert a key line into the hash table of its section if no other key with
+ the same name is already present.
+
+ @param Section Pointer to the section containing the line.
+
+ @param Line Pointer to the line to insert.
+ */
+VOID
+YoriLibIniIndexLine(
+    __in PYORI_LIB_INI_SECTION Section,
+    __in PYORI_LIB_INI_LINE Line
+    )
+{
+    DWORD Hash;
+
+    ASSERT(Line->IsKey && !Line->Indexed);
+    Hash = YoriLibHashString32(0, &Line->Key);
+    if (YoriLibHashLookupByHashedKey(Section->Keys, &Line->Key, Hash) == NULL) {
+        YoriLibHashInsertByHashedKey(Section->Keys, &Line->Key, Hash, Line, &Line->HashEntry);
+        Line->Indexed = TRUE;
+    }
+}
+
+/**
+ Free a line within a section.  The line must already have been removed from
+ the list of lines and the hash table of keys.
+
+ @param Line Pointer to the line to free.
+ */
+VOID
+YoriLibIniFreeLine(
+    __in PYORI_LIB_INI_LINE Line
+    )
+{
+    ASSERT(!Line->Indexed);
+    YoriLibFreeStringContents(&Line->Text);
+    YoriLibFree(Line);
+}
+
+/**
+ Free all lines within a section.  The section itself and its hash table
+ remain allocated.
+
+ @param Section Pointer to the section whose lines should be freed.
+ */
+VOID
+YoriLibIniFreeSectionLines(
+    __in PYORI_LIB_INI_SECTION Section
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_LINE Line;
+
+    ListEntry = YoriLibGetNextListEntry(&Section->Lines, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Section->Lines, ListEntry);
+        YoriLibRemoveListItem(&Line->ListEntry);
+        if (Line->Indexed) {
+            YoriLibHashRemoveByEntry(&Line->HashEntry);
+            Line->Indexed = FALSE;
+        }
+        YoriLibIniFreeLine(Line);
+    }
+    Section->KeyCount = 0;
+}
+
+/**
+ Free all lines within a section and the section's hash table.  The section
+ structure itself is not freed.
+
+ @param Section Pointer to the section to clean up.
+ */
+VOID
+YoriLibIniCleanupSection(
+    __in PYORI_LIB_INI_SECTION Section
+    )
+{
+    YoriLibIniFreeSectionLines(Section);
+
+    if (Section->Keys != NULL) {
+        YoriLibFreeEmptyHashTable(Section->Keys);
+        Section->Keys = NULL;
+    }
+
+    YoriLibFreeStringContents(&Section->Header);
+}
+
+/**
+ Decode the raw contents of a file into the Contents member of a document,
+ recording the encoding that was used.
+
+ @param Document Pointer to the document.
+
+ @param Buffer Pointer to the raw contents of the file.
+
+ @param BytesInBuffer The number of bytes in Buffer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibIniDecode(
+    __inout PYORI_LIB_INI_DOCUMENT Document,
+    __in PUCHAR Buffer,
+    __in DWORD BytesInBuffer
+    )
+{
+    DWORD CharsNeeded;
+
+    if (BytesInBuffer >= 2 && Buffer[0] == 0xFF && Buffer[1] == 0xFE) {
+        Document->Encoding = CP_UTF16;
+        CharsNeeded = (BytesInBuffer - 2) / sizeof(WCHAR);
+        if (!YoriLibAllocateString(&Document->Contents, CharsNeeded + 1)) {
+            return FALSE;
+        }
+        memcpy(Document->Contents.StartOfString, &Buffer[2], CharsNeeded * sizeof(WCHAR));
+        Document->Contents.LengthInChars = CharsNeeded;
+        return TRUE;
+    }
+
+    Document->Encoding = CP_ACP;
+    if (BytesInBuffer >= 3 && Buffer[0] == 0xEF && Buffer[1] == 0xBB && Buffer[2] == 0xBF) {
+        Document->Encoding = CP_UTF8;
+        Buffer = Buffer + 3;
+        BytesInBuffer = BytesInBuffer - 3;
+    }
+
+    if (BytesInBuffer == 0) {
+        return TRUE;
+    }
+
+    CharsNeeded = MultiByteToWideChar(Document->Encoding, 0, (LPCSTR)Buffer, BytesInBuffer, NULL, 0);
+    if (CharsNeeded == 0) {
+        return FALSE;
+    }
+
+    if (!YoriLibAllocateString(&Document->Contents, CharsNeeded + 1)) {
+        return FALSE;
+    }
+
+    Document->Contents.LengthInChars = MultiByteToWideChar(Document->Encoding, 0, (LPCSTR)Buffer, BytesInBuffer, Document->Contents.StartOfString, CharsNeeded);
+    return TRUE;
+}
+
+/**
+ Split the Contents member of a document into sections and lines, and build
+ hash tables of sections and keys.
+
+ @param Document Pointer to the document.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibIniParse(
+    __inout PYORI_LIB_INI_DOCUMENT Document
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_LINE Line;
+    PYORI_LIST_ENTRY SectionEntry;
+    PYORI_LIST_ENTRY LineEntry;
+    YORI_STRING Remaining;
+    YORI_STRING LineText;
+    DWORD SectionCount;
+    DWORD Index;
+    DWORD Hash;
+
+    //
+    //  Lines refer to the contents buffer without holding a reference.  The
+    //  buffer is freed after all lines when the document is freed.
+    //
+
+    YoriLibInitEmptyString(&Remaining);
+    Remaining.StartOfString = Document->Contents.StartOfString;
+    Remaining.LengthInChars = Document->Contents.LengthInChars;
+
+    Section = &Document->Preamble;
+    SectionCount = 0;
+
+    while (Remaining.LengthInChars > 0) {
+        YoriLibInitEmptyString(&LineText);
+        LineText.StartOfString = Remaining.StartOfString;
+        for (Index = 0; Index < Remaining.LengthInChars; Index++) {
+            if (Remaining.StartOfString[Index] == '\n') {
+                break;
+            }
+        }
+
+        LineText.LengthInChars = Index;
+        if (Index < Remaining.LengthInChars) {
+
+            //
+            //  The first line terminator determines how lines are terminated
+            //  when the file is saved.
+            //
+
+            if (Remaining.StartOfString == Document->Contents.StartOfString &&
+                (Index == 0 || Remaining.StartOfString[Index - 1] != '\r')) {
+
+                Document->LineFeedOnly = TRUE;
+            }
+            Index++;
+        }
+        Remaining.StartOfString = Remaining.StartOfString + Index;
+        Remaining.LengthInChars = Remaining.LengthInChars - Index;
+
+        if (LineText.LengthInChars > 0 && LineText.StartOfString[LineText.LengthInChars - 1] == '\r') {
+            LineText.LengthInChars--;
+        }
+
+        //
+        //  Check if this line starts a new section.
+        //
+
+        for (Index = 0; Index < LineText.LengthInChars; Index++) {
+            if (LineText.StartOfString[Index] != ' ' && LineText.StartOfString[Index] != '\t') {
+                break;
+            }
+        }
+
+        if (Index < LineText.LengthInChars && LineText.StartOfString[Index] == '[') {
+            Section = YoriLibIniAllocateSection(&LineText, 0);
+            if (Section == NULL) {
+                return FALSE;
+            }
+            YoriLibAppendList(&Document->Sections, &Section->ListEntry);
+            SectionCount++;
+            continue;
+        }
+
+        Line = YoriLibMalloc(sizeof(YORI_LIB_INI_LINE));
+        if (Line == NULL) {
+            return FALSE;
+        }
+
+        ZeroMemory(Line, sizeof(YORI_LIB_INI_LINE));
+        Line->Text.StartOfString = LineText.StartOfString;
+        Line->Text.LengthInChars = LineText.LengthInChars;
+
+        //
+        //  Lines before any section cannot be queried, so there's no point
+        //  looking for keys there.
+        //
+
+        if (Section != &Document->Preamble) {
+            YoriLibIniParseKeyLine(Line);
+            if (Line->IsKey) {
+                Section->KeyCount++;
+            }
+        }
+        YoriLibAppendList(&Section->Lines, &Line->ListEntry);
+    }
+
+    //
+    //  Now that the number of sections and keys is known, build the hash
+    //  tables.
+    //
+
+    Document->SectionTable = YoriLibAllocateHashTable(YoriLibIniBucketCount(SectionCount));
+    if (Document->SectionTable == NULL) {
+        return FALSE;
+    }
+
+    SectionEntry = YoriLibGetNextListEntry(&Document->Sections, NULL);
+    while (SectionEntry != NULL) {
+        Section = CONTAINING_RECORD(SectionEntry, YORI_LIB_INI_SECTION, ListEntry);
+        Section->Keys = YoriLibAllocateHashTable(YoriLibIniBucketCount(Section->KeyCount));
+        if (Section->Keys == NULL) {
+            return FALSE;
+        }
+
+        Hash = YoriLibHashString32(0, &Section->Name);
+        if (YoriLibHashLookupByHashedKey(Document->SectionTable, &Section->Name, Hash) == NULL) {
+            YoriLibHashInsertByHashedKey(Document->SectionTable, &Section->Name, Hash, Section, &Section->HashEntry);
+            Section->Indexed = TRUE;
+        }
+
+        LineEntry = YoriLibGetNextListEntry(&Section->Lines, NULL);
+        while (LineEntry != NULL) {
+            Line = CONTAINING_RECORD(LineEntry, YORI_LIB_INI_LINE, ListEntry);
+            if (Line->IsKey) {
+                YoriLibIniIndexLine(Section, Line);
+            }
+            LineEntry = YoriLibGetNextListEntry(&Section->Lines, LineEntry);
+        }
+
+        SectionEntry = YoriLibGetNextListEntry(&Document->Sections, SectionEntry);
+    }
+
+    return TRUE;
+}
+
+/**
+ Open the mutex which protects the list of lock files held by this process,
+ and wait for it.  The mutex is named so that each caller obtains the same
+ object without needing any initialization.
+
+ @return A handle to the mutex, which the caller should pass to
+         @ref YoriLibIniReleaseLockList, or NULL on failure.
+ */
+HANDLE
+YoriLibIniAcquireLockList(VOID)
+{
+    TCHAR MutexName[32];
+    HANDLE hMutex;
+
+    YoriLibSPrintf(MutexName, _T("YoriLibIniLocks%x"), GetCurrentProcessId());
+    hMutex = CreateMutex(NULL, FALSE, MutexName);
+    if (hMutex == NULL) {
+        return NULL;
+    }
+
+    WaitForSingleObject(hMutex, INFINITE);
+    if (!YoriLibIniLockListInitialized) {
+        YoriLibInitializeListHead(&YoriLibIniLockList);
+        YoriLibIniLockListInitialized = TRUE;
+    }
+    return hMutex;
+}
+
+/**
+ Release the mutex which protects the list of lock files held by this
+ process.
+
+ @param hMutex The handle returned from @ref YoriLibIniAcquireLockList.
+ */
+VOID
+YoriLibIniReleaseLockList(
+    __in HANDLE hMutex
+    )
+{
+    ReleaseMutex(hMutex);
+    CloseHandle(hMutex);
+}
+
+/**
+ Acquire the lock which serializes access to the file described by a
+ document between processes.  The lock is a byte range lock on a file next
+ to the INI file, which is deleted when the last process using it closes it.
+ The INI file itself cannot be locked, because it is replaced by renaming
+ over it when saved, which fails if the target is open.  If the lock file
+ cannot be created because the directory is not writable, the document is
+ loaded without a lock, since it cannot be saved either.
+
+ A thread which already holds the lock for a file, because it has another
+ document for the same file loaded, shares that lock rather than waiting for
+ itself.
+
+ @param Document Pointer to the document, whose FileName must be
+        initialized.  On successful completion, Lock is updated to refer to
+        the lock if one was acquired.
+
+ @return TRUE to indicate the lock was acquired or is not needed, FALSE to
+         indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibIniLock(
+    __inout PYORI_LIB_INI_DOCUMENT Document
+    )
+{
+    YORI_STRING LockFileName;
+    OVERLAPPED Overlapped;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_LOCK Lock;
+    HANDLE hMutex;
+    HANDLE hLock;
+    DWORD ThreadId;
+    DWORD Err;
+
+    if (!YoriLibAllocateString(&LockFileName, Document->FileName.LengthInChars + sizeof(YORI_LIB_INI_LOCK_SUFFIX) / sizeof(TCHAR))) {
+        return FALSE;
+    }
+
+    LockFileName.LengthInChars = YoriLibSPrintf(LockFileName.StartOfString, _T("%y%s"), &Document->FileName, YORI_LIB_INI_LOCK_SUFFIX);
+
+    //
+    //  Check if this thread already holds the lock.
+    //
+
+    hMutex = YoriLibIniAcquireLockList();
+    if (hMutex == NULL) {
+        YoriLibFreeStringContents(&LockFileName);
+        return FALSE;
+    }
+
+    ThreadId = GetCurrentThreadId();
+    ListEntry = YoriLibGetNextListEntry(&YoriLibIniLockList, NULL);
+    while (ListEntry != NULL) {
+        Lock = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LOCK, ListEntry);
+        if (Lock->ThreadId == ThreadId &&
+            YoriLibCompareStringInsensitive(&Lock->FileName, &LockFileName) == 0) {
+
+            Lock->ReferenceCount++;
+            YoriLibIniReleaseLockList(hMutex);
+            YoriLibFreeStringContents(&LockFileName);
+            Document->Lock = Lock;
+            return TRUE;
+        }
+        ListEntry = YoriLibGetNextListEntry(&YoriLibIniLockList, ListEntry);
+    }
+
+    YoriLibIniReleaseLockList(hMutex);
+
+    while (TRUE) {
+        hLock = CreateFile(LockFileName.StartOfString,
+                           GENERIC_READ | GENERIC_WRITE,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL,
+                           OPEN_ALWAYS,
+                           FILE_ATTRIBUTE_HIDDEN | FILE_FLAG_DELETE_ON_CLOSE,
+                           NULL);
+
+        if (hLock != INVALID_HANDLE_VALUE) {
+            break;
+        }
+
+        //
+        //  If the lock file exists but is being deleted, the process that
+        //  last held it is going away, and a new lock file can be created
+        //  once it is gone.  Opening a file which is being deleted fails
+        //  with access denied, as does querying its attributes.  If the
+        //  lock file doesn't exist and cannot be created, or exists and
+        //  cannot be opened, the directory is not writable.
+        //
+
+        Err = GetLastError();
+        if (Err == ERROR_ACCESS_DENIED &&
+            GetFileAttributes(LockFileName.StartOfString) == (DWORD)-1 &&
+            GetLastError() == ERROR_ACCESS_DENIED) {
+
+            Sleep(YORI_LIB_INI_LOCK_RETRY_DELAY);
+            continue;
+        }
+
+        YoriLibFreeStringContents(&LockFileName);
+        if (Err == ERROR_ACCESS_DENIED || Err == ERROR_WRITE_PROTECT || Err == ERROR_PATH_NOT_FOUND) {
+            return TRUE;
+        }
+        SetLastError(Err);
+        return FALSE;
+    }
+
+    //
+    //  Wait for other processes, and other threads in this process, to
+    //  release the lock.  The list is not held while waiting, so that
+    //  threads holding other locks can release them.
+    //
+
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    if (!LockFileEx(hLock, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &Overlapped)) {
+        Err = GetLastError();
+        CloseHandle(hLock);
+        YoriLibFreeStringContents(&LockFileName);
+        SetLastError(Err);
+        return FALSE;
+    }
+
+    Lock = YoriLibMalloc(sizeof(YORI_LIB_INI_LOCK));
+    if (Lock == NULL) {
+        UnlockFileEx(hLock, 0, 1, 0, &Overlapped);
+        CloseHandle(hLock);
+        YoriLibFreeStringContents(&LockFileName);
+        return FALSE;
+    }
+
+    hMutex = YoriLibIniAcquireLockList();
+    if (hMutex == NULL) {
+        YoriLibFree(Lock);
+        UnlockFileEx(hLock, 0, 1, 0, &Overlapped);
+        CloseHandle(hLock);
+        YoriLibFreeStringContents(&LockFileName);
+        return FALSE;
+    }
+
+    memcpy(&Lock->FileName, &LockFileName, sizeof(YORI_STRING));
+    Lock->FileHandle = hLock;
+    Lock->ThreadId = ThreadId;
+    Lock->ReferenceCount = 1;
+    YoriLibAppendList(&YoriLibIniLockList, &Lock->ListEntry);
+    YoriLibIniReleaseLockList(hMutex);
+
+    Document->Lock = Lock;
+    return TRUE;
+}
+
+/**
+ Release the lock which serializes access to the file described by a
+ document between processes.  The lock file is closed when no document
+ loaded by the thread that acquired it refers to it.
+
+ @param Document Pointer to the document.
+ */
+VOID
+YoriLibIniUnlock(
+    __inout PYORI_LIB_INI_DOCUMENT Document
+    )
+{
+    OVERLAPPED Overlapped;
+    PYORI_LIB_INI_LOCK Lock;
+    HANDLE hMutex;
+    DWORD ReferenceCount;
+
+    Lock = Document->Lock;
+    if (Lock == NULL) {
+        return;
+    }
+    Document->Lock = NULL;
+
+    //
+    //  If the mutex cannot be opened the lock is leaked rather than risk
+    //  corrupting the list.  It is released when the process exits.
+    //
+
+    hMutex = YoriLibIniAcquireLockList();
+    if (hMutex == NULL) {
+        return;
+    }
+
+    Lock->ReferenceCount--;
+    ReferenceCount = Lock->ReferenceCount;
+    if (ReferenceCount == 0) {
+        YoriLibRemoveListItem(&Lock->ListEntry);
+    }
+    YoriLibIniReleaseLockList(hMutex);
+
+    if (ReferenceCount == 0) {
+        ZeroMemory(&Overlapped, sizeof(Overlapped));
+        UnlockFileEx(Lock->FileHandle, 0, 1, 0, &Overlapped);
+        CloseHandle(Lock->FileHandle);
+        YoriLibFreeStringContents(&Lock->FileName);
+        YoriLibFree(Lock);
+    }
+}
+
+/**
+ Free an INI document.  Any changes which have not been saved are discarded.
+ This releases the lock which prevents other processes from loading the
+ file.
+
+ @param Document Pointer to the document to free.
+ */
+VOID
+YoriLibIniFree(
+    __in PYORI_LIB_INI_DOCUMENT Document
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_SECTION Section;
+
+    ListEntry = YoriLibGetNextListEntry(&Document->Sections, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_SECTION, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Document->Sections, ListEntry);
+        YoriLibRemoveListItem(&Section->ListEntry);
+        if (Section->Indexed) {
+            YoriLibHashRemoveByEntry(&Section->HashEntry);
+        }
+        YoriLibIniCleanupSection(Section);
+        YoriLibFree(Section);
+    }
+
+    YoriLibIniCleanupSection(&Document->Preamble);
+
+    if (Document->SectionTable != NULL) {
+        YoriLibFreeEmptyHashTable(Document->SectionTable);
+    }
+
+    YoriLibIniUnlock(Document);
+    YoriLibFreeStringContents(&Document->Contents);
+    YoriLibFreeStringContents(&Document->FileName);
+    YoriLibFree(Document);
+}
+
+/**
+ Load an INI file into memory.  If the file does not exist, an empty
+ document is returned, which will create the file if it is modified and
+ saved.  Other processes loading the same file wait until the document is
+ freed, so callers should free documents promptly.
+
+ @param FileName Pointer to the name of the INI file.  This should be a
+        fully qualified path.
+
+ @param Document On successful completion, updated to point to the loaded
+        document.  The caller should free this with @ref YoriLibIniFree.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibIniLoad(
+    __in PCYORI_STRING FileName,
+    __out PYORI_LIB_INI_DOCUMENT *Document
+    )
+{
+    PYORI_LIB_INI_DOCUMENT NewDocument;
+    HANDLE hFile;
+    DWORD FileSizeHigh;
+    DWORD FileSize;
+    DWORD BytesRead;
+    DWORD Err;
+    PUCHAR Buffer;
+
+    NewDocument = YoriLibMalloc(sizeof(YORI_LIB_INI_DOCUMENT));
+    if (NewDocument == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(NewDocument, sizeof(YORI_LIB_INI_DOCUMENT));
+    YoriLibInitializeListHead(&NewDocument->Sections);
+    YoriLibInitializeListHead(&NewDocument->Preamble.Lines);
+    NewDocument->Encoding = CP_ACP;
+
+    if (!YoriLibAllocateString(&NewDocument->FileName, FileName->LengthInChars + 1)) {
+        YoriLibIniFree(NewDocument);
+        return FALSE;
+    }
+
+    memcpy(NewDocument->FileName.StartOfString, FileName->StartOfString, FileName->LengthInChars * sizeof(TCHAR));
+    NewDocument->FileName.StartOfString[FileName->LengthInChars] = '\0';
+    NewDocument->FileName.LengthInChars = FileName->LengthInChars;
+
+    if (!YoriLibIniLock(NewDocument)) {
+        YoriLibIniFree(NewDocument);
+        return FALSE;
+    }
+
+    hFile = CreateFile(NewDocument->FileName.StartOfString,
+                       GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL,
+                       NULL);
+
+    if (hFile == INVALID_HANDLE_VALUE) {
+        Err = GetLastError();
+        if (Err != ERROR_FILE_NOT_FOUND && Err != ERROR_PATH_NOT_FOUND) {
+            YoriLibIniFree(NewDocument);
+            return FALSE;
+        }
+    } else {
+        FileSize = GetFileSize(hFile, &FileSizeHigh);
+        if (FileSizeHigh != 0 || FileSize == (DWORD)-1) {
+            CloseHandle(hFile);
+            YoriLibIniFree(NewDocument);
+            return FALSE;
+        }
+
+        if (FileSize > 0) {
+            Buffer = YoriLibMalloc(FileSize);
+            if (Buffer == NULL) {
+                CloseHandle(hFile);
+                YoriLibIniFree(NewDocument);
+                return FALSE;
+            }
+
+            if (!ReadFile(hFile, Buffer, FileSize, &BytesRead, NULL) ||
+                !YoriLibIniDecode(NewDocument, Buffer, BytesRead)) {
+
+                YoriLibFree(Buffer);
+                CloseHandle(hFile);
+                YoriLibIniFree(NewDocument);
+                return FALSE;
+            }
+
+            YoriLibFree(Buffer);
+        }
+        CloseHandle(hFile);
+    }
+
+    if (!YoriLibIniParse(NewDocument)) {
+        YoriLibIniFree(NewDocument);
+        return FALSE;
+    }
+
+    *Document = NewDocument;
+    return TRUE;
+}
+
+/**
+ Find a section within a document by name.
+
+ @param Document Pointer to the document.
+
+ @param SectionName Pointer to the name of the section.
+
+ @return Pointer to the section, or NULL if no section with this name is
+         present.
+ */
+PYORI_LIB_INI_SECTION
+YoriLibIniFindSection(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in LPCTSTR SectionName
+    )
+{
+    YORI_STRING Name;
+    PYORI_HASH_ENTRY HashEntry;
+
+    YoriLibConstantString(&Name, SectionName);
+    YoriLibIniTrim(&Name);
+    HashEntry = YoriLibHashLookupByKey(Document->SectionTable, &Name);
+    if (HashEntry == NULL) {
+        return NULL;
+    }
+
+    return HashEntry->Context;
+}
+
+/**
+ Find a key within a section by name.
+
+ @param Section Pointer to the section.
+
+ @param KeyName Pointer to the name of the key.
+
+ @return Pointer to the line describing the key, or NULL if no key with this
+         name is present.
+ */
+PYORI_LIB_INI_LINE
+YoriLibIniFindKey(
+    __in PYORI_LIB_INI_SECTION Section,
+    __in LPCTSTR KeyName
+    )
+{
+    YORI_STRING Name;
+    PYORI_HASH_ENTRY HashEntry;
+
+    YoriLibConstantString(&Name, KeyName);
+    YoriLibIniTrim(&Name);
+    HashEntry = YoriLibHashLookupByKey(Section->Keys, &Name);
+    if (HashEntry == NULL) {
+        return NULL;
+    }
+
+    return HashEntry->Context;
+}
+
+/**
+ Append a string to a buffer of NULL terminated strings which is itself
+ terminated by an additional NULL.  This is the format returned by the OS
+ when enumerating sections or keys.
+
+ @param Buffer Pointer to the buffer.
+
+ @param BufferSize The size of the buffer, in characters.
+
+ @param Offset Pointer to the current offset within the buffer.  On
+        completion, updated to the offset after the string that was added.
+
+ @param First Pointer to the first part of the string to add.
+
+ @param Second Optionally points to a second part of the string to add,
+        which is separated from the first by an equals sign.
+
+ @return TRUE if the string was added, FALSE if the buffer is full.
+ */
+BOOLEAN
+YoriLibIniAppendToMultiString(
+    __out_ecount(BufferSize) LPTSTR Buffer,
+    __in DWORD BufferSize,
+    __inout PDWORD Offset,
+    __in PCYORI_STRING First,
+    __in_opt PCYORI_STRING Second
+    )
+{
+    DWORD LengthNeeded;
+
+    LengthNeeded = First->LengthInChars + 1;
+    if (Second != NULL) {
+        LengthNeeded = LengthNeeded + 1 + Second->LengthInChars;
+    }
+
+    //
+    //  Leave space for the string, its terminator, and the terminator of
+    //  the list.
+    //
+
+    if (*Offset + LengthNeeded + 1 > BufferSize) {
+        return FALSE;
+    }
+
+    memcpy(&Buffer[*Offset], First->StartOfString, First->LengthInChars * sizeof(TCHAR));
+    *Offset = *Offset + First->LengthInChars;
+    if (Second != NULL) {
+        Buffer[*Offset] = '=';
+        *Offset = *Offset + 1;
+        memcpy(&Buffer[*Offset], Second->StartOfString, Second->LengthInChars * sizeof(TCHAR));
+        *Offset = *Offset + Second->LengthInChars;
+    }
+    Buffer[*Offset] = '\0';
+    *Offset = *Offset + 1;
+    return TRUE;
+}
+
+/**
+ Complete a buffer of NULL terminated strings which was populated with
+ @ref YoriLibIniAppendToMultiString .
+
+ @param Buffer Pointer to the buffer.
+
+ @param BufferSize The size of the buffer, in characters.
+
+ @param Offset The offset after the final string in the buffer.
+
+ @param Truncated TRUE if not every string could fit in the buffer.
+
+ @return The number of characters to return to the caller, following the
+         convention of the OS functions.
+ */
+DWORD
+YoriLibIniCompleteMultiString(
+    __out_ecount(BufferSize) LPTSTR Buffer,
+    __in DWORD BufferSize,
+    __in DWORD Offset,
+    __in BOOLEAN Truncated
+    )
+{
+    if (BufferSize == 0) {
+        return 0;
+    }
+
+    if (BufferSize == 1) {
+        Buffer[0] = '\0';
+        return 0;
+    }
+
+    if (Truncated) {
+        Buffer[BufferSize - 2] = '\0';
+        Buffer[BufferSize - 1] = '\0';
+        return BufferSize - 2;
+    }
+
+    Buffer[Offset] = '\0';
+    return Offset;
+}
+
+/**
+ Query a string value from an INI document.  This follows the conventions of
+ GetPrivateProfileString.
+
+ @param Document Pointer to the document.
+
+ @param SectionName Pointer to the name of the section.  If NULL, the buffer
+        is populated with the names of all sections in the document.
+
+ @param KeyName Pointer to the name of the key.  If NULL, the buffer is
+        populated with the names of all keys in the section.
+
+ @param Default Pointer to the value to return if the key is not present.
+        If NULL, an empty string is returned.
+
+ @param Buffer Pointer to a buffer to populate with the result.
+
+ @param BufferSize The size of Buffer, in characters.
+
+ @return The number of characters copied into Buffer, not including the
+         NULL terminator.
+ */
+DWORD
+YoriLibIniGetString(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in_opt LPCTSTR SectionName,
+    __in_opt LPCTSTR KeyName,
+    __in_opt LPCTSTR Default,
+    __out_ecount(BufferSize) LPTSTR Buffer,
+    __in DWORD BufferSize
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_LINE Line;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_STRING Value;
+    DWORD Offset;
+    BOOLEAN Truncated;
+
+    if (BufferSize == 0) {
+        return 0;
+    }
+
+    Offset = 0;
+    Truncated = FALSE;
+
+    if (SectionName == NULL) {
+        ListEntry = YoriLibGetNextListEntry(&Document->Sections, NULL);
+        while (ListEntry != NULL) {
+            Section = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_SECTION, ListEntry);
+            if (!YoriLibIniAppendToMultiString(Buffer, BufferSize, &Offset, &Section->Name, NULL)) {
+                Truncated = TRUE;
+                break;
+            }
+            ListEntry = YoriLibGetNextListEntry(&Document->Sections, ListEntry);
+        }
+        return YoriLibIniCompleteMultiString(Buffer, BufferSize, Offset, Truncated);
+    }
+
+    Section = YoriLibIniFindSection(Document, SectionName);
+
+    if (KeyName == NULL) {
+        if (Section != NULL) {
+            ListEntry = YoriLibGetNextListEntry(&Section->Lines, NULL);
+            while (ListEntry != NULL) {
+                Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+                if (Line->IsKey) {
+                    if (!YoriLibIniAppendToMultiString(Buffer, BufferSize, &Offset, &Line->Key, NULL)) {
+                        Truncated = TRUE;
+                        break;
+                    }
+                }
+                ListEntry = YoriLibGetNextListEntry(&Section->Lines, ListEntry);
+            }
+        }
+        return YoriLibIniCompleteMultiString(Buffer, BufferSize, Offset, Truncated);
+    }
+
+    Line = NULL;
+    if (Section != NULL) {
+        Line = YoriLibIniFindKey(Section, KeyName);
+    }
+
+    if (Line != NULL) {
+        Value.StartOfString = Line->Value.StartOfString;
+        Value.LengthInChars = Line->Value.LengthInChars;
+
+        //
+        //  Like the OS, remove a matching pair of quotes surrounding the
+        //  value.
+        //
+
+        if (Value.LengthInChars >= 2 &&
+            (Value.StartOfString[0] == '"' || Value.StartOfString[0] == '\'') &&
+            Value.StartOfString[Value.LengthInChars - 1] == Value.StartOfString[0]) {
+
+            Value.StartOfString++;
+            Value.LengthInChars = Value.LengthInChars - 2;
+        }
+    } else {
+        YoriLibConstantString(&Value, (Default != NULL)?Default:_T(""));
+    }
+
+    Offset = Value.LengthInChars;
+    if (Offset >= BufferSize) {
+        Offset = BufferSize - 1;
+    }
+
+    memcpy(Buffer, Value.StartOfString, Offset * sizeof(TCHAR));
+    Buffer[Offset] = '\0';
+    return Offset;
+}
+
+/**
+ Query an integer value from an INI document.  This follows the conventions
+ of GetPrivateProfileInt.
+
+ @param Document Pointer to the document.
+
+ @param SectionName Pointer to the name of the section.
+
+ @param KeyName Pointer to the name of the key.
+
+ @param Default The value to return if the key is not present.
+
+ @return The value of the key, or Default if the key is not present.
+ */
+UINT
+YoriLibIniGetInt(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in LPCTSTR SectionName,
+    __in LPCTSTR KeyName,
+    __in INT Default
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_LINE Line;
+    LONGLONG Number;
+    DWORD CharsConsumed;
+
+    Section = YoriLibIniFindSection(Document, SectionName);
+    if (Section == NULL) {
+        return (UINT)Default;
+    }
+
+    Line = YoriLibIniFindKey(Section, KeyName);
+    if (Line == NULL) {
+        return (UINT)Default;
+    }
+
+    if (!YoriLibStringToNumber(&Line->Value, FALSE, &Number, &CharsConsumed) ||
+        CharsConsumed == 0) {
+
+        return 0;
+    }
+
+    return (UINT)(INT)Number;
+}
+
+/**
+ Query all keys and values within a section of an INI document.  This
+ follows the conventions of GetPrivateProfileSection, where each key and
+ value is returned as a NULL terminated key=value string, and the list is
+ terminated with an additional NULL.
+
+ @param Document Pointer to the document.
+
+ @param SectionName Pointer to the name of the section.
+
+ @param Buffer Pointer to a buffer to populate with the result.
+
+ @param BufferSize The size of Buffer, in characters.
+
+ @return The number of characters copied into Buffer, not including the
+         final NULL terminator.
+ */
+DWORD
+YoriLibIniGetSection(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in LPCTSTR SectionName,
+    __out_ecount(BufferSize) LPTSTR Buffer,
+    __in DWORD BufferSize
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_LINE Line;
+    PYORI_LIST_ENTRY ListEntry;
+    DWORD Offset;
+    BOOLEAN Truncated;
+
+    Offset = 0;
+    Truncated = FALSE;
+
+    Section = YoriLibIniFindSection(Document, SectionName);
+    if (Section != NULL) {
+        ListEntry = YoriLibGetNextListEntry(&Section->Lines, NULL);
+        while (ListEntry != NULL) {
+            Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+            if (Line->IsKey) {
+                if (!YoriLibIniAppendToMultiString(Buffer, BufferSize, &Offset, &Line->Key, Line->HasValue?&Line->Value:NULL)) {
+                    Truncated = TRUE;
+                    break;
+                }
+            }
+            ListEntry = YoriLibGetNextListEntry(&Section->Lines, ListEntry);
+        }
+    }
+
+    return YoriLibIniCompleteMultiString(Buffer, BufferSize, Offset, Truncated);
+}
+
+/**
+ Query the names of all sections within an INI document.  This follows the
+ conventions of GetPrivateProfileSectionNames.
+
+ @param Document Pointer to the document.
+
+ @param Buffer Pointer to a buffer to populate with the result.
+
+ @param BufferSize The size of Buffer, in characters.
+
+ @return The number of characters copied into Buffer, not including the
+         final NULL terminator.
+ */
+DWORD
+YoriLibIniGetSectionNames(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __out_ecount(BufferSize) LPTSTR Buffer,
+    __in DWORD BufferSize
+    )
+{
+    return YoriLibIniGetString(Document, NULL, NULL, NULL, Buffer, BufferSize);
+}
+
+/**
+ Delete all sections with a specified name from an INI document.
+
+ @param Document Pointer to the document.
+
+ @param SectionName Pointer to the name of the section to delete.
+ */
+VOID
+YoriLibIniDeleteSection(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in LPCTSTR SectionName
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_STRING Name;
+
+    YoriLibConstantString(&Name, SectionName);
+    YoriLibIniTrim(&Name);
+
+    ListEntry = YoriLibGetNextListEntry(&Document->Sections, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_SECTION, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Document->Sections, ListEntry);
+        if (YoriLibCompareStringInsensitive(&Section->Name, &Name) == 0) {
+            YoriLibRemoveListItem(&Section->ListEntry);
+            if (Section->Indexed) {
+                YoriLibHashRemoveByEntry(&Section->HashEntry);
+            }
+            YoriLibIniCleanupSection(Section);
+            YoriLibFree(Section);
+            Document->Dirty = TRUE;
+        }
+    }
+}
+
+/**
+ Delete a key from a section, and if another key with the same name exists
+ later in the section, make it the one that is found by lookups.
+
+ @param Section Pointer to the section.
+
+ @param Line Pointer to the line describing the key to delete.
+ */
+VOID
+YoriLibIniDeleteKey(
+    __in PYORI_LIB_INI_SECTION Section,
+    __in PYORI_LIB_INI_LINE Line
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_LINE Duplicate;
+
+    ListEntry = &Line->ListEntry;
+    YoriLibHashRemoveByEntry(&Line->HashEntry);
+    Line->Indexed = FALSE;
+
+    ListEntry = YoriLibGetNextListEntry(&Section->Lines, ListEntry);
+    while (ListEntry != NULL) {
+        Duplicate = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+        if (Duplicate->IsKey &&
+            YoriLibCompareStringInsensitive(&Duplicate->Key, &Line->Key) == 0) {
+
+            YoriLibIniIndexLine(Section, Duplicate);
+            break;
+        }
+        ListEntry = YoriLibGetNextListEntry(&Section->Lines, ListEntry);
+    }
+
+    YoriLibRemoveListItem(&Line->ListEntry);
+    YoriLibIniFreeLine(Line);
+}
+
+/**
+ Create a new, empty section at the end of a document.
+
+ @param Document Pointer to the document.
+
+ @param SectionName Pointer to the name of the section.
+
+ @return Pointer to the section, or NULL on allocation failure.
+ */
+PYORI_LIB_INI_SECTION
+YoriLibIniCreateSection(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in LPCTSTR SectionName
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    YORI_STRING Name;
+    YORI_STRING Text;
+
+    YoriLibConstantString(&Name, SectionName);
+    YoriLibIniTrim(&Name);
+    if (!YoriLibAllocateString(&Text, Name.LengthInChars + sizeof("[]"))) {
+        return NULL;
+    }
+
+    Text.LengthInChars = YoriLibSPrintf(Text.StartOfString, _T("[%y]"), &Name);
+    Section = YoriLibIniAllocateSection(&Text, YORI_LIB_INI_DEFAULT_BUCKETS);
+    YoriLibFreeStringContents(&Text);
+    if (Section == NULL) {
+        return NULL;
+    }
+
+    YoriLibAppendList(&Document->Sections, &Section->ListEntry);
+    YoriLibHashInsertByKey(Document->SectionTable, &Section->Name, Section, &Section->HashEntry);
+    Section->Indexed = TRUE;
+    return Section;
+}
+
+/**
+ Set a string value within an INI document, or delete a key or section.
+ This follows the conventions of WritePrivateProfileString, except that
+ changes are made in memory and are not written to disk until
+ @ref YoriLibIniSave is called.
+
+ @param Document Pointer to the document.
+
+ @param SectionName Pointer to the name of the section.  If the section does
+        not exist, it is created at the end of the document.
+
+ @param KeyName Pointer to the name of the key.  If NULL, the entire section
+        is deleted.
+
+ @param Value Pointer to the value to set.  If NULL, the key is deleted.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniSetString(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in LPCTSTR SectionName,
+    __in_opt LPCTSTR KeyName,
+    __in_opt LPCTSTR Value
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_LINE Line;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIST_ENTRY InsertAfter;
+    YORI_STRING Name;
+    YORI_STRING Text;
+    DWORD Length;
+
+    if (KeyName == NULL) {
+        YoriLibIniDeleteSection(Document, SectionName);
+        return TRUE;
+    }
+
+    Section = YoriLibIniFindSection(Document, SectionName);
+    if (Value == NULL) {
+        if (Section != NULL) {
+            Line = YoriLibIniFindKey(Section, KeyName);
+            if (Line != NULL) {
+                YoriLibIniDeleteKey(Section, Line);
+                Document->Dirty = TRUE;
+            }
+        }
+        return TRUE;
+    }
+
+    //
+    //  Create the section if it doesn't exist.
+    //
+
+    if (Section == NULL) {
+        Section = YoriLibIniCreateSection(Document, SectionName);
+        if (Section == NULL) {
+            return FALSE;
+        }
+    }
+
+    //
+    //  Build the new text of the line.  If the key already exists, retain
+    //  the existing name, which may differ in case.
+    //
+
+    Line = YoriLibIniFindKey(Section, KeyName);
+    if (Line != NULL) {
+        YoriLibInitEmptyString(&Name);
+        Name.StartOfString = Line->Key.StartOfString;
+        Name.LengthInChars = Line->Key.LengthInChars;
+    } else {
+        YoriLibConstantString(&Name, KeyName);
+        YoriLibIniTrim(&Name);
+    }
+
+    Length = (DWORD)_tcslen(Value);
+    if (!YoriLibAllocateString(&Text, Name.LengthInChars + 1 + Length + 1)) {
+        return FALSE;
+    }
+
+    Text.LengthInChars = YoriLibSPrintf(Text.StartOfString, _T("%y=%s"), &Name, Value);
+
+    if (Line != NULL) {
+
+        //
+        //  If the value is unchanged, leave the line alone so the document
+        //  isn't written needlessly.
+        //
+
+        if (Line->Text.LengthInChars == Text.LengthInChars &&
+            YoriLibCompareString(&Line->Text, &Text) == 0) {
+
+            YoriLibFreeStringContents(&Text);
+            return TRUE;
+        }
+
+        YoriLibHashRemoveByEntry(&Line->HashEntry);
+        YoriLibFreeStringContents(&Line->Text);
+        memcpy(&Line->Text, &Text, sizeof(YORI_STRING));
+        YoriLibIniParseKeyLine(Line);
+        YoriLibHashInsertByHashedKey(Section->Keys, &Line->Key, Line->HashEntry.Hash, Line, &Line->HashEntry);
+        Document->Dirty = TRUE;
+        return TRUE;
+    }
+
+    Line = YoriLibMalloc(sizeof(YORI_LIB_INI_LINE));
+    if (Line == NULL) {
+        YoriLibFreeStringContents(&Text);
+        return FALSE;
+    }
+
+    ZeroMemory(Line, sizeof(YORI_LIB_INI_LINE));
+    memcpy(&Line->Text, &Text, sizeof(YORI_STRING));
+    YoriLibIniParseKeyLine(Line);
+
+    //
+    //  Insert the new key after the last key in the section, so that any
+    //  comments or blank lines separating this section from the next stay
+    //  where they are.
+    //
+
+    InsertAfter = NULL;
+    ListEntry = YoriLibGetPreviousListEntry(&Section->Lines, NULL);
+    while (ListEntry != NULL) {
+        if (CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry)->IsKey) {
+            InsertAfter = ListEntry;
+            break;
+        }
+        ListEntry = YoriLibGetPreviousListEntry(&Section->Lines, ListEntry);
+    }
+
+    if (InsertAfter != NULL) {
+        YoriLibInsertList(InsertAfter, &Line->ListEntry);
+    } else {
+        YoriLibInsertList(&Section->Lines, &Line->ListEntry);
+    }
+
+    YoriLibIniIndexLine(Section, Line);
+    Document->Dirty = TRUE;
+    return TRUE;
+}
+
+/**
+ Replace the entire contents of a section within an INI document.  This
+ follows the conventions of WritePrivateProfileSection, except that changes
+ are made in memory and are not written to disk until @ref YoriLibIniSave is
+ called.  If the section already contains exactly the specified lines, it
+ is left alone and the document is not marked as modified, so callers that
+ periodically snapshot state only cause a write when something changed.
+
+ @param Document Pointer to the document.
+
+ @param SectionName Pointer to the name of the section.  If the section does
+        not exist, it is created at the end of the document.
+
+ @param KeyValuePairs Pointer to a set of NULL terminated lines, typically
+        in the form key=value, terminated by an additional NULL.  If NULL,
+        the entire section is deleted.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniSetSection(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in LPCTSTR SectionName,
+    __in_opt LPCTSTR KeyValuePairs
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_LINE Line;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_STRING Entry;
+    LPCTSTR Next;
+
+    if (KeyValuePairs == NULL) {
+        YoriLibIniDeleteSection(Document, SectionName);
+        return TRUE;
+    }
+
+    Section = YoriLibIniFindSection(Document, SectionName);
+    if (Section == NULL) {
+        Section = YoriLibIniCreateSection(Document, SectionName);
+        if (Section == NULL) {
+            return FALSE;
+        }
+    } else {
+
+        //
+        //  Check whether the section already has these lines, in order.
+        //
+
+        Next = KeyValuePairs;
+        ListEntry = YoriLibGetNextListEntry(&Section->Lines, NULL);
+        while (ListEntry != NULL && *Next != '\0') {
+            Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+            YoriLibConstantString(&Entry, Next);
+            if (YoriLibCompareString(&Line->Text, &Entry) != 0) {
+                break;
+            }
+            Next = Next + Entry.LengthInChars + 1;
+            ListEntry = YoriLibGetNextListEntry(&Section->Lines, ListEntry);
+        }
+
+        if (ListEntry == NULL && *Next == '\0') {
+            return TRUE;
+        }
+
+        YoriLibIniFreeSectionLines(Section);
+    }
+
+    Next = KeyValuePairs;
+    while (*Next != '\0') {
+        YoriLibConstantString(&Entry, Next);
+        Next = Next + Entry.LengthInChars + 1;
+
+        Line = YoriLibMalloc(sizeof(YORI_LIB_INI_LINE));
+        if (Line == NULL) {
+            Document->Dirty = TRUE;
+            return FALSE;
+        }
+
+        ZeroMemory(Line, sizeof(YORI_LIB_INI_LINE));
+        if (!YoriLibAllocateString(&Line->Text, Entry.LengthInChars + 1)) {
+            YoriLibFree(Line);
+            Document->Dirty = TRUE;
+            return FALSE;
+        }
+
+        memcpy(Line->Text.StartOfString, Entry.StartOfString, Entry.LengthInChars * sizeof(TCHAR));
+        Line->Text.StartOfString[Entry.LengthInChars] = '\0';
+        Line->Text.LengthInChars = Entry.LengthInChars;
+        YoriLibIniParseKeyLine(Line);
+        YoriLibAppendList(&Section->Lines, &Line->ListEntry);
+        if (Line->IsKey) {
+            Section->KeyCount++;
+            YoriLibIniIndexLine(Section, Line);
+        }
+    }
+
+    Document->Dirty = TRUE;
+    return TRUE;
+}
+
+/**
+ Append a line and a line terminator to a string being constructed to
+ save a document.
+
+ @param Output Pointer to the string being constructed, which must have
+        sufficient space allocated.
+
+ @param Line Pointer to the line to append.
+
+ @param LineFeedOnly TRUE to terminate the line with a line feed, FALSE to
+        terminate it with a carriage return and line feed.
+ */
+VOID
+YoriLibIniAppendLine(
+    __inout PYORI_STRING Output,
+    __in PCYORI_STRING Line,
+    __in BOOLEAN LineFeedOnly
+    )
+{
+    memcpy(&Output->StartOfString[Output->LengthInChars], Line->StartOfString, Line->LengthInChars * sizeof(TCHAR));
+    Output->LengthInChars = Output->LengthInChars + Line->LengthInChars;
+    if (!LineFeedOnly) {
+        Output->StartOfString[Output->LengthInChars] = '\r';
+        Output->LengthInChars++;
+    }
+    Output->StartOfString[Output->LengthInChars] = '\n';
+    Output->LengthInChars++;
+}
+
+/**
+ Construct the text of a section for saving, or calculate its length.
+
+ @param Section Pointer to the section.
+
+ @param LineFeedOnly TRUE to terminate lines with a line feed, FALSE to
+        terminate them with a carriage return and line feed.
+
+ @param Output Optionally points to a string to append the section to, which
+        must have sufficient space allocated.
+
+ @return The number of characters in the text of the section.
+ */
+DWORD
+YoriLibIniBuildSection(
+    __in PYORI_LIB_INI_SECTION Section,
+    __in BOOLEAN LineFeedOnly,
+    __inout_opt PYORI_STRING Output
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_LINE Line;
+    DWORD TerminatorLength;
+    DWORD Length;
+
+    TerminatorLength = 2;
+    if (LineFeedOnly) {
+        TerminatorLength = 1;
+    }
+
+    Length = 0;
+    if (Section->Keys != NULL) {
+        Length = Length + Section->Header.LengthInChars + TerminatorLength;
+        if (Output != NULL) {
+            YoriLibIniAppendLine(Output, &Section->Header, LineFeedOnly);
+        }
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Section->Lines, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+        Length = Length + Line->Text.LengthInChars + TerminatorLength;
+        if (Output != NULL) {
+            YoriLibIniAppendLine(Output, &Line->Text, LineFeedOnly);
+        }
+        ListEntry = YoriLibGetNextListEntry(&Section->Lines, ListEntry);
+    }
+
+    return Length;
+}
+
+/**
+ Write any changes to an INI document back to the file it was loaded from.
+ If the document has not been modified, this returns without writing.  The
+ document is written to a temporary file in the same directory, which then
+ replaces the original file, so that other readers never observe a partially
+ written file.  The file keeps the encoding and line terminators it was
+ loaded with.  The lock acquired when the document was loaded is held until
+ the document is freed, so no other process can modify the file between it
+ being loaded and replaced.
+
+ @param Document Pointer to the document.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibIniSave(
+    __in PYORI_LIB_INI_DOCUMENT Document
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_SECTION Section;
+    YORI_STRING Output;
+    YORI_STRING Directory;
+    YORI_STRING Prefix;
+    YORI_STRING TempFileName;
+    LPTSTR FinalSeperator;
+    HANDLE hTempFile;
+    PUCHAR Buffer;
+    DWORD BufferLength;
+    DWORD BytesWritten;
+    DWORD Length;
+    DWORD Err;
+    BOOLEAN Result;
+
+    if (!Document->Dirty) {
+        return TRUE;
+    }
+
+    //
+    //  Construct the text of the entire document.
+    //
+
+    Length = YoriLibIniBuildSection(&Document->Preamble, Document->LineFeedOnly, NULL);
+    ListEntry = YoriLibGetNextListEntry(&Document->Sections, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_SECTION, ListEntry);
+        Length = Length + YoriLibIniBuildSection(Section, Document->LineFeedOnly, NULL);
+        ListEntry = YoriLibGetNextListEntry(&Document->Sections, ListEntry);
+    }
+
+    if (!YoriLibAllocateString(&Output, Length + 1)) {
+        return FALSE;
+    }
+
+    YoriLibIniBuildSection(&Document->Preamble, Document->LineFeedOnly, &Output);
+    ListEntry = YoriLibGetNextListEntry(&Document->Sections, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_SECTION, ListEntry);
+        YoriLibIniBuildSection(Section, Document->LineFeedOnly, &Output);
+        ListEntry = YoriLibGetNextListEntry(&Document->Sections, ListEntry);
+    }
+
+    ASSERT(Output.LengthInChars == Length);
+
+    //
+    //  Encode the text in the encoding of the original file.
+    //
+
+    if (Document->Encoding == CP_UTF16) {
+        BufferLength = 2 + Output.LengthInChars * sizeof(WCHAR);
+        Buffer = YoriLibMalloc(BufferLength);
+        if (Buffer == NULL) {
+            YoriLibFreeStringContents(&Output);
+            return FALSE;
+        }
+        Buffer[0] = 0xFF;
+        Buffer[1] = 0xFE;
+        memcpy(&Buffer[2], Output.StartOfString, Output.LengthInChars * sizeof(WCHAR));
+    } else {
+        Length = 0;
+        if (Output.LengthInChars > 0) {
+            Length = WideCharToMultiByte(Document->Encoding, 0, Output.StartOfString, Output.LengthInChars, NULL, 0, NULL, NULL);
+            if (Length == 0) {
+                YoriLibFreeStringContents(&Output);
+                return FALSE;
+            }
+        }
+
+        BufferLength = Length;
+        if (Document->Encoding == CP_UTF8) {
+            BufferLength = BufferLength + 3;
+        }
+
+        Buffer = YoriLibMalloc(BufferLength + 1);
+        if (Buffer == NULL) {
+            YoriLibFreeStringContents(&Output);
+            return FALSE;
+        }
+
+        BufferLength = 0;
+        if (Document->Encoding == CP_UTF8) {
+            Buffer[0] = 0xEF;
+            Buffer[1] = 0xBB;
+            Buffer[2] = 0xBF;
+            BufferLength = 3;
+        }
+
+        if (Length > 0) {
+            WideCharToMultiByte(Document->Encoding, 0, Output.StartOfString, Output.LengthInChars, (LPSTR)&Buffer[BufferLength], Length, NULL, NULL);
+            BufferLength = BufferLength + Length;
+        }
+    }
+
+    YoriLibFreeStringContents(&Output);
+
+    //
+    //  Write to a temporary file in the same directory as the target, so
+    //  that it can be renamed over the target.
+    //
+
+    YoriLibInitEmptyString(&Directory);
+    FinalSeperator = YoriLibFindRightMostCharacter(&Document->FileName, '\\');
+    if (FinalSeperator != NULL) {
+        Directory.StartOfString = Document->FileName.StartOfString;
+        Directory.LengthInChars = (DWORD)(FinalSeperator - Document->FileName.StartOfString);
+    } else {
+        YoriLibConstantString(&Directory, _T("."));
+    }
+
+    YoriLibConstantString(&Prefix, YORI_LIB_INI_TEMP_PREFIX);
+    if (!YoriLibGetTempFileName(&Directory, &Prefix, &hTempFile, &TempFileName)) {
+        YoriLibFree(Buffer);
+        return FALSE;
+    }
+
+    Result = FALSE;
+    if (WriteFile(hTempFile, Buffer, BufferLength, &BytesWritten, NULL) &&
+        BytesWritten == BufferLength &&
+        FlushFileBuffers(hTempFile)) {
+
+        Result = TRUE;
+    }
+
+    CloseHandle(hTempFile);
+    YoriLibFree(Buffer);
+
+    if (Result) {
+        Err = YoriLibMoveFile(&TempFileName, &Document->FileName, TRUE, FALSE);
+        if (Err != ERROR_SUCCESS) {
+            Result = FALSE;
+        }
+    } else {
+        Err = GetLastError();
+    }
+
+    if (!Result) {
+        DeleteFile(TempFileName.StartOfString);
+        SetLastError(Err);
+    } else {
+        Document->Dirty = FALSE;
+    }
+
+    YoriLibFreeStringContents(&TempFileName);
+    return Result;
+}
+
+// vim:sw=4:ts=4:et:
@@ -4,7 +4,7 @@
  * Yori wrappers around Windows Job Object functionality.  Loads dynamically
  * to allow for fallback if the host OS doesn't support it.
  *
- * Copyright (c) 2017 Malcolm J. Smith
+ * Copyright (c) 2017-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -83,4 +83,26 @@ YoriLibLimitJobObjectPriority(
     return DllKernel32.pSetInformationJobObject(hJob, 2, &LimitInfo, sizeof(LimitInfo));
 }
 
+/**
+ Terminate all processes within a job object.  If the functionality is not
+ supported by the host OS, returns FALSE.
+
+ @param hJob Handle to the job object.
+
+ @param ExitCode The exit code to assign to each process.
+
+ @return TRUE on success, FALSE on failure.
+ */
+BOOL
+YoriLibTerminateJobObject(
+    __in HANDLE hJob,
+    __in DWORD ExitCode
+    )
+{
+    if (DllKernel32.pTerminateJobObject == NULL) {
+        return FALSE;
+    }
+    return DllKernel32.pTerminateJobObject(hJob, ExitCode);
+}
+
 // vim:sw=4:ts=4:et:
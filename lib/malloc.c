@@ -3,7 +3,7 @@
  *
  * Yori memory allocation wrappers
  *
- * Copyright (c) 2017-2019 Malcolm J. Smith
+ * Copyright (c) 2017-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -132,6 +132,613 @@ YORI_SPECIAL_HEAP_GLOBAL YoriLibSpecialHeap;
 #endif
 
 #if !YORI_SPECIAL_HEAP
+
+/**
+ The number of distinct call sites that can be tracked by the allocation
+ profiler.  Allocations from call sites beyond this are accumulated into a
+ single overflow entry.  This must be a power of two.
+ */
+#define YORI_LIB_ALLOC_PROFILE_SITES (4096)
+
+/**
+ The number of buckets in the allocation size histogram.  Bucket zero
+ contains zero byte allocations, and bucket N contains allocations of at
+ least 2^(N-1) bytes and less than 2^N bytes.
+ */
+#define YORI_LIB_ALLOC_PROFILE_BUCKETS (33)
+
+/**
+ A value combined with the address of a profiled allocation's header, used
+ to check that memory being freed was allocated while profiling.
+ */
+#define YORI_LIB_ALLOC_PROFILE_TAG ((DWORD_PTR)0x59414C50)
+
+/**
+ A header placed before each allocation made while profiling, recording the
+ size of the allocation so that frees do not need to query the heap.  This
+ is two pointers in size so that the allocation returned to the caller has
+ the same alignment as one returned by the heap.  Whether allocations have
+ a header is fixed before the first allocation, so a free never needs to
+ guess.
+ */
+typedef struct _YORI_LIB_ALLOC_PROFILE_HEADER {
+
+    /**
+     The address of this header combined with YORI_LIB_ALLOC_PROFILE_TAG.
+     This is only used to check for mismatched allocations and frees.
+     */
+    DWORD_PTR Tag;
+
+    /**
+     The number of bytes requested by the caller.
+     */
+    DWORD_PTR Bytes;
+
+} YORI_LIB_ALLOC_PROFILE_HEADER, *PYORI_LIB_ALLOC_PROFILE_HEADER;
+
+/**
+ Allocation information recorded for a single call site.
+ */
+typedef struct _YORI_LIB_ALLOC_PROFILE_SITE {
+
+    /**
+     The return address of the call to the allocator.  NULL indicates the
+     entry is not in use.
+     */
+    PVOID CallSite;
+
+    /**
+     The number of allocations made from this call site.
+     */
+    DWORDLONG Allocations;
+
+    /**
+     The number of bytes allocated from this call site.
+     */
+    DWORDLONG Bytes;
+
+} YORI_LIB_ALLOC_PROFILE_SITE, *PYORI_LIB_ALLOC_PROFILE_SITE;
+
+/**
+ A single bucket in the allocation size histogram.
+ */
+typedef struct _YORI_LIB_ALLOC_PROFILE_BUCKET {
+
+    /**
+     The number of allocations whose size falls within the bucket.
+     */
+    DWORDLONG Allocations;
+
+    /**
+     The number of bytes allocated by allocations within the bucket.
+     */
+    DWORDLONG Bytes;
+
+} YORI_LIB_ALLOC_PROFILE_BUCKET, *PYORI_LIB_ALLOC_PROFILE_BUCKET;
+
+/**
+ Process global state for the allocation profiler.
+ */
+typedef struct _YORI_LIB_ALLOC_PROFILE_GLOBAL {
+
+    /**
+     A lock synchronizing updates to the profile.
+     */
+    CRITICAL_SECTION Lock;
+
+    /**
+     An array of YORI_LIB_ALLOC_PROFILE_SITES call site entries, hashed by
+     call site address.
+     */
+    PYORI_LIB_ALLOC_PROFILE_SITE Sites;
+
+    /**
+     The number of entries in the Sites array that are in use.
+     */
+    DWORD SitesInUse;
+
+    /**
+     Allocations from call sites that could not be tracked because the
+     Sites array is full.
+     */
+    YORI_LIB_ALLOC_PROFILE_SITE OverflowSite;
+
+    /**
+     The number of allocations made while profiling.
+     */
+    DWORDLONG Allocations;
+
+    /**
+     The number of frees made while profiling.
+     */
+    DWORDLONG Frees;
+
+    /**
+     The number of bytes allocated while profiling.
+     */
+    DWORDLONG BytesAllocated;
+
+    /**
+     The number of bytes allocated while profiling that have not been
+     freed.
+     */
+    LONGLONG BytesLive;
+
+    /**
+     The largest value of BytesLive observed.
+     */
+    LONGLONG PeakBytesLive;
+
+    /**
+     A histogram of allocation sizes.
+     */
+    YORI_LIB_ALLOC_PROFILE_BUCKET Histogram[YORI_LIB_ALLOC_PROFILE_BUCKETS];
+
+    /**
+     The directory to write the profile into.  This is allocated directly
+     from the process heap, and is freed once the profile has been
+     written.
+     */
+    YORI_STRING OutputDirectory;
+
+} YORI_LIB_ALLOC_PROFILE_GLOBAL, *PYORI_LIB_ALLOC_PROFILE_GLOBAL;
+
+/**
+ Process global state for the allocation profiler.
+ */
+YORI_LIB_ALLOC_PROFILE_GLOBAL YoriLibAllocProfile;
+
+/**
+ TRUE if the allocation profiler is active in this module.  This is only
+ set before the module has allocated any memory, and is never cleared, so
+ every allocation made by the module while it is set has a header, and
+ every allocation made while it is clear does not.  When FALSE the
+ allocator performs a single test of this value.
+ */
+BOOLEAN YoriLibAllocProfileEnabled;
+
+/**
+ Set to TRUE when the module first allocates memory without a profile
+ header.  After this, profiling can no longer be enabled, since memory
+ without a header could later be freed as if it had one.
+ */
+BOOLEAN YoriLibAllocProfileTooLate;
+
+/**
+ Initialize allocation profiling for the process.  Profiling is enabled if
+ the YORI_ALLOC_PROFILE environment variable refers to a directory, in which
+ case a report is written into that directory by
+ @ref YoriLibAllocProfileWrite .  This must be called before the module
+ allocates any memory, and profiling remains enabled for the lifetime of
+ the module.  Memory must be freed by the module that allocated it.
+
+ @return TRUE if profiling has been enabled, FALSE if it has not.
+ */
+BOOLEAN
+YoriLibAllocProfileInitialize(VOID)
+{
+    YORI_STRING Directory;
+    DWORD LengthNeeded;
+
+    if (YoriLibAllocProfileEnabled) {
+        return TRUE;
+    }
+
+    if (YoriLibAllocProfileTooLate) {
+        return FALSE;
+    }
+
+    //
+    //  Allocate directly from the process heap so the profiler's own state
+    //  is not visible to itself, and so that no memory without a header is
+    //  allocated via the allocator.
+    //
+
+    YoriLibInitEmptyString(&Directory);
+    LengthNeeded = GetEnvironmentVariable(_T("YORI_ALLOC_PROFILE"), NULL, 0);
+    if (LengthNeeded <= 1) {
+        return FALSE;
+    }
+
+    Directory.StartOfString = HeapAlloc(GetProcessHeap(), 0, LengthNeeded * sizeof(TCHAR));
+    if (Directory.StartOfString == NULL) {
+        return FALSE;
+    }
+    Directory.LengthAllocated = LengthNeeded;
+    Directory.LengthInChars = GetEnvironmentVariable(_T("YORI_ALLOC_PROFILE"), Directory.StartOfString, Directory.LengthAllocated);
+    if (Directory.LengthInChars == 0 || Directory.LengthInChars >= Directory.LengthAllocated) {
+        HeapFree(GetProcessHeap(), 0, Directory.StartOfString);
+        return FALSE;
+    }
+
+    while (Directory.LengthInChars > 0 &&
+           YoriLibIsSep(Directory.StartOfString[Directory.LengthInChars - 1])) {
+
+        Directory.LengthInChars--;
+    }
+
+    YoriLibAllocProfile.Sites = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, YORI_LIB_ALLOC_PROFILE_SITES * sizeof(YORI_LIB_ALLOC_PROFILE_SITE));
+    if (YoriLibAllocProfile.Sites == NULL) {
+        HeapFree(GetProcessHeap(), 0, Directory.StartOfString);
+        return FALSE;
+    }
+
+    InitializeCriticalSection(&YoriLibAllocProfile.Lock);
+
+    memcpy(&YoriLibAllocProfile.OutputDirectory, &Directory, sizeof(YORI_STRING));
+    YoriLibAllocProfileEnabled = TRUE;
+    return TRUE;
+}
+
+/**
+ Record an allocation in the profile.
+
+ @param CallSite The return address of the call to the allocator.
+
+ @param Bytes The number of bytes allocated.
+ */
+VOID
+YoriLibAllocProfileRecordAlloc(
+    __in_opt PVOID CallSite,
+    __in DWORD Bytes
+    )
+{
+    PYORI_LIB_ALLOC_PROFILE_SITE Site;
+    DWORD Index;
+    DWORD Probe;
+    DWORD Bucket;
+
+    Bucket = 0;
+    while (Bucket < YORI_LIB_ALLOC_PROFILE_BUCKETS - 1 && (Bytes >> Bucket) != 0) {
+        Bucket++;
+    }
+
+    Index = (DWORD)(((DWORD_PTR)CallSite >> 2) * 2654435761UL);
+    Index = Index >> 20;
+
+    EnterCriticalSection(&YoriLibAllocProfile.Lock);
+
+    Site = &YoriLibAllocProfile.OverflowSite;
+    if (CallSite != NULL) {
+        for (Probe = 0; Probe < YORI_LIB_ALLOC_PROFILE_SITES; Probe++) {
+            PYORI_LIB_ALLOC_PROFILE_SITE Candidate;
+            Candidate = &YoriLibAllocProfile.Sites[(Index + Probe) & (YORI_LIB_ALLOC_PROFILE_SITES - 1)];
+            if (Candidate->CallSite == CallSite) {
+                Site = Candidate;
+                break;
+            }
+            if (Candidate->CallSite == NULL) {
+                if (YoriLibAllocProfile.SitesInUse < YORI_LIB_ALLOC_PROFILE_SITES - 1) {
+                    Candidate->CallSite = CallSite;
+                    YoriLibAllocProfile.SitesInUse++;
+                    Site = Candidate;
+                }
+                break;
+            }
+        }
+    }
+
+    Site->Allocations++;
+    Site->Bytes += Bytes;
+    YoriLibAllocProfile.Histogram[Bucket].Allocations++;
+    YoriLibAllocProfile.Histogram[Bucket].Bytes += Bytes;
+    YoriLibAllocProfile.Allocations++;
+    YoriLibAllocProfile.BytesAllocated += Bytes;
+    YoriLibAllocProfile.BytesLive += Bytes;
+    if (YoriLibAllocProfile.BytesLive > YoriLibAllocProfile.PeakBytesLive) {
+        YoriLibAllocProfile.PeakBytesLive = YoriLibAllocProfile.BytesLive;
+    }
+
+    LeaveCriticalSection(&YoriLibAllocProfile.Lock);
+}
+
+/**
+ Record a free in the profile.
+
+ @param Bytes The number of bytes in the allocation, as recorded in its
+        header.
+ */
+VOID
+YoriLibAllocProfileRecordFree(
+    __in DWORD_PTR Bytes
+    )
+{
+    EnterCriticalSection(&YoriLibAllocProfile.Lock);
+    YoriLibAllocProfile.Frees++;
+    YoriLibAllocProfile.BytesLive -= (LONGLONG)Bytes;
+    LeaveCriticalSection(&YoriLibAllocProfile.Lock);
+}
+
+/**
+ Display a call site as a module name and offset within the module, so
+ that it can be resolved against the symbols for the module.
+
+ @param hFile Handle to the file to write to.
+
+ @param Site Pointer to the call site information to display.
+ */
+VOID
+YoriLibAllocProfileOutputSite(
+    __in HANDLE hFile,
+    __in PYORI_LIB_ALLOC_PROFILE_SITE Site
+    )
+{
+    MEMORY_BASIC_INFORMATION MemoryInfo;
+    TCHAR ModuleBuffer[MAX_PATH];
+    YORI_STRING ModuleName;
+    LPTSTR FinalSep;
+
+    YoriLibInitEmptyString(&ModuleName);
+    if (Site->CallSite != NULL &&
+        VirtualQuery(Site->CallSite, &MemoryInfo, sizeof(MemoryInfo)) != 0 &&
+        MemoryInfo.AllocationBase != NULL) {
+
+        ModuleName.StartOfString = ModuleBuffer;
+        ModuleName.LengthAllocated = sizeof(ModuleBuffer)/sizeof(ModuleBuffer[0]);
+        ModuleName.LengthInChars = GetModuleFileName((HMODULE)MemoryInfo.AllocationBase, ModuleBuffer, ModuleName.LengthAllocated);
+        if (ModuleName.LengthInChars >= ModuleName.LengthAllocated) {
+            ModuleName.LengthInChars = 0;
+        }
+
+        FinalSep = YoriLibFindRightMostCharacter(&ModuleName, '\\');
+        if (FinalSep != NULL) {
+            ModuleName.LengthInChars = ModuleName.LengthInChars - (DWORD)(FinalSep - ModuleName.StartOfString + 1);
+            ModuleName.StartOfString = FinalSep + 1;
+        }
+    }
+
+    if (ModuleName.LengthInChars > 0) {
+        YoriLibOutputToDevice(hFile,
+                              0,
+                              _T("%12lli %16lli  %y+0x%x\n"),
+                              Site->Allocations,
+                              Site->Bytes,
+                              &ModuleName,
+                              (DWORD)((PUCHAR)Site->CallSite - (PUCHAR)MemoryInfo.AllocationBase));
+    } else if (Site->CallSite != NULL) {
+        YoriLibOutputToDevice(hFile,
+                              0,
+                              _T("%12lli %16lli  %p\n"),
+                              Site->Allocations,
+                              Site->Bytes,
+                              Site->CallSite);
+    } else {
+        YoriLibOutputToDevice(hFile,
+                              0,
+                              _T("%12lli %16lli  (other)\n"),
+                              Site->Allocations,
+                              Site->Bytes);
+    }
+}
+
+/**
+ Write the allocation profile to a file.  The file is placed in the
+ directory specified by YORI_ALLOC_PROFILE, and is named from the executable
+ name and process ID so that concurrent processes do not overwrite each
+ other.  Call sites are reported as a module and offset, ordered by the
+ number of bytes allocated.  This can be called at any point while the
+ process is running.
+
+ @return TRUE to indicate the profile was written, FALSE if profiling is not
+         enabled or the profile could not be written.
+ */
+BOOLEAN
+YoriLibAllocProfileWrite(VOID)
+{
+    YORI_LIB_ALLOC_PROFILE_GLOBAL Totals;
+    PYORI_LIB_ALLOC_PROFILE_SITE Sites;
+    YORI_LIB_ALLOC_PROFILE_SITE Swap;
+    YORI_STRING FileName;
+    YORI_STRING ModuleName;
+    TCHAR ModuleBuffer[MAX_PATH];
+    LPTSTR FinalSep;
+    DWORD SiteCount;
+    DWORD Index;
+    DWORD Gap;
+    DWORD Compare;
+    HANDLE hFile;
+
+    if (!YoriLibAllocProfileEnabled ||
+        YoriLibAllocProfile.OutputDirectory.StartOfString == NULL) {
+
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&ModuleName);
+    ModuleName.StartOfString = ModuleBuffer;
+    ModuleName.LengthAllocated = sizeof(ModuleBuffer)/sizeof(ModuleBuffer[0]);
+    ModuleName.LengthInChars = GetModuleFileName(NULL, ModuleBuffer, ModuleName.LengthAllocated);
+    if (ModuleName.LengthInChars == 0 || ModuleName.LengthInChars >= ModuleName.LengthAllocated) {
+        YoriLibConstantString(&ModuleName, _T("yori"));
+    } else {
+        FinalSep = YoriLibFindRightMostCharacter(&ModuleName, '\\');
+        if (FinalSep != NULL) {
+            ModuleName.LengthInChars = ModuleName.LengthInChars - (DWORD)(FinalSep - ModuleName.StartOfString + 1);
+            ModuleName.StartOfString = FinalSep + 1;
+        }
+    }
+
+    //
+    //  Capture a snapshot of the profile so that allocations made while
+    //  writing the report don't change the data being reported.
+    //
+
+    Sites = HeapAlloc(GetProcessHeap(), 0, (YORI_LIB_ALLOC_PROFILE_SITES + 1) * sizeof(YORI_LIB_ALLOC_PROFILE_SITE));
+    if (Sites == NULL) {
+        return FALSE;
+    }
+
+    SiteCount = 0;
+    EnterCriticalSection(&YoriLibAllocProfile.Lock);
+    memcpy(&Totals, &YoriLibAllocProfile, sizeof(YORI_LIB_ALLOC_PROFILE_GLOBAL));
+    for (Index = 0; Index < YORI_LIB_ALLOC_PROFILE_SITES; Index++) {
+        if (YoriLibAllocProfile.Sites[Index].CallSite != NULL) {
+            memcpy(&Sites[SiteCount], &YoriLibAllocProfile.Sites[Index], sizeof(YORI_LIB_ALLOC_PROFILE_SITE));
+            SiteCount++;
+        }
+    }
+    LeaveCriticalSection(&YoriLibAllocProfile.Lock);
+
+    if (Totals.OverflowSite.Allocations > 0) {
+        memcpy(&Sites[SiteCount], &Totals.OverflowSite, sizeof(YORI_LIB_ALLOC_PROFILE_SITE));
+        SiteCount++;
+    }
+
+    //
+    //  Shell sort the sites by bytes allocated, largest first.
+    //
+
+    for (Gap = SiteCount / 2; Gap > 0; Gap = Gap / 2) {
+        for (Index = Gap; Index < SiteCount; Index++) {
+            memcpy(&Swap, &Sites[Index], sizeof(YORI_LIB_ALLOC_PROFILE_SITE));
+            for (Compare = Index; Compare >= Gap && Sites[Compare - Gap].Bytes < Swap.Bytes; Compare -= Gap) {
+                memcpy(&Sites[Compare], &Sites[Compare - Gap], sizeof(YORI_LIB_ALLOC_PROFILE_SITE));
+            }
+            memcpy(&Sites[Compare], &Swap, sizeof(YORI_LIB_ALLOC_PROFILE_SITE));
+        }
+    }
+
+    YoriLibInitEmptyString(&FileName);
+    if (YoriLibYPrintf(&FileName, _T("%y\\%y.%i.alloc.txt"), &YoriLibAllocProfile.OutputDirectory, &ModuleName, GetCurrentProcessId()) < 0) {
+        HeapFree(GetProcessHeap(), 0, Sites);
+        return FALSE;
+    }
+
+    hFile = CreateFile(FileName.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    YoriLibFreeStringContents(&FileName);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        HeapFree(GetProcessHeap(), 0, Sites);
+        return FALSE;
+    }
+
+    YoriLibOutputToDevice(hFile, 0, _T("Allocation profile for %y, process %i\n\n"), &ModuleName, GetCurrentProcessId());
+    YoriLibOutputToDevice(hFile, 0, _T("Allocations:      %lli\n"), Totals.Allocations);
+    YoriLibOutputToDevice(hFile, 0, _T("Frees:            %lli\n"), Totals.Frees);
+    YoriLibOutputToDevice(hFile, 0, _T("Bytes allocated:  %lli\n"), Totals.BytesAllocated);
+    YoriLibOutputToDevice(hFile, 0, _T("Live bytes:       %lli\n"), Totals.BytesLive);
+    YoriLibOutputToDevice(hFile, 0, _T("Peak live bytes:  %lli\n"), Totals.PeakBytesLive);
+    YoriLibOutputToDevice(hFile, 0, _T("Call sites:       %i\n\n"), SiteCount);
+
+    YoriLibOutputToDevice(hFile, 0, _T("Size histogram:\n                   Size        Count            Bytes\n"));
+    for (Index = 0; Index < YORI_LIB_ALLOC_PROFILE_BUCKETS; Index++) {
+        if (Totals.Histogram[Index].Allocations == 0) {
+            continue;
+        }
+        if (Index == 0) {
+            YoriLibOutputToDevice(hFile, 0, _T("%23i"), 0);
+        } else {
+            YoriLibOutputToDevice(hFile, 0, _T("%10llu - %10llu"), (DWORDLONG)1 << (Index - 1), ((DWORDLONG)1 << Index) - 1);
+        }
+        YoriLibOutputToDevice(hFile, 0, _T(" %12lli %16lli\n"), Totals.Histogram[Index].Allocations, Totals.Histogram[Index].Bytes);
+    }
+
+    YoriLibOutputToDevice(hFile, 0, _T("\nCall sites by bytes allocated:\n       Count            Bytes  Site\n"));
+    for (Index = 0; Index < SiteCount; Index++) {
+        YoriLibAllocProfileOutputSite(hFile, &Sites[Index]);
+    }
+
+    CloseHandle(hFile);
+    HeapFree(GetProcessHeap(), 0, Sites);
+    return TRUE;
+}
+
+/**
+ Write the allocation profile.  This is intended to be called as the
+ process exits.  Profiling remains enabled, since allocations made while
+ profiling have headers and may still be freed, so the lock is not deleted
+ here.  Later calls do not write the profile again.
+ */
+VOID
+YoriLibAllocProfileCleanup(VOID)
+{
+    if (!YoriLibAllocProfileEnabled ||
+        YoriLibAllocProfile.OutputDirectory.StartOfString == NULL) {
+
+        return;
+    }
+
+    YoriLibAllocProfileWrite();
+    HeapFree(GetProcessHeap(), 0, YoriLibAllocProfile.OutputDirectory.StartOfString);
+    YoriLibInitEmptyString(&YoriLibAllocProfile.OutputDirectory);
+}
+
+#else
+
+/**
+ The allocation profiler is not available when the special heap is in use,
+ since the special heap already tracks each allocation.
+
+ @return FALSE to indicate profiling is not enabled.
+ */
+BOOLEAN
+YoriLibAllocProfileInitialize(VOID)
+{
+    return FALSE;
+}
+
+/**
+ The allocation profiler is not available when the special heap is in use.
+
+ @return FALSE to indicate no profile was written.
+ */
+BOOLEAN
+YoriLibAllocProfileWrite(VOID)
+{
+    return FALSE;
+}
+
+/**
+ The allocation profiler is not available when the special heap is in use.
+ */
+VOID
+YoriLibAllocProfileCleanup(VOID)
+{
+}
+
+#endif
+
+#if !YORI_SPECIAL_HEAP
+/**
+ Allocate memory on behalf of a specified caller.  This is used by library
+ routines that allocate memory for their callers, so that an allocation
+ profile attributes the memory to the code that requested it rather than
+ to the library routine.  This should be freed with @ref YoriLibFree when
+ it is no longer needed.
+
+ @param Bytes The number of bytes to allocate.
+
+ @param CallSite The return address of the code requesting the allocation.
+
+ @return A pointer to the newly allocated memory, or NULL on failure.
+ */
+PVOID
+YoriLibMallocForCaller(
+    __in DWORD Bytes,
+    __in_opt PVOID CallSite
+    )
+{
+    PYORI_LIB_ALLOC_PROFILE_HEADER Header;
+
+    if (!YoriLibAllocProfileEnabled) {
+        YoriLibAllocProfileTooLate = TRUE;
+        return HeapAlloc(GetProcessHeap(), 0, Bytes);
+    }
+
+    if (Bytes > (DWORD)-1 - sizeof(YORI_LIB_ALLOC_PROFILE_HEADER)) {
+        return NULL;
+    }
+
+    Header = HeapAlloc(GetProcessHeap(), 0, Bytes + sizeof(YORI_LIB_ALLOC_PROFILE_HEADER));
+    if (Header == NULL) {
+        return NULL;
+    }
+
+    Header->Tag = (DWORD_PTR)Header ^ YORI_LIB_ALLOC_PROFILE_TAG;
+    Header->Bytes = Bytes;
+    YoriLibAllocProfileRecordAlloc(CallSite, Bytes);
+    return Header + 1;
+}
+
 /**
  Allocate memory.  This should be freed with @ref YoriLibFree when it is no
  longer needed.
@@ -145,9 +752,7 @@ YoriLibMalloc(
     __in DWORD Bytes
     )
 {
-    PVOID Alloc;
-    Alloc = HeapAlloc(GetProcessHeap(), 0, Bytes);
-    return Alloc;
+    return YoriLibMallocForCaller(Bytes, YoriLibAllocProfileCaller());
 }
 #else
 
@@ -266,6 +871,25 @@ YoriLibFree(
     )
 {
 #if !YORI_SPECIAL_HEAP
+    PYORI_LIB_ALLOC_PROFILE_HEADER Header;
+
+    //
+    //  Profiling is enabled before this module allocates anything and is
+    //  never disabled, so if it is enabled, every allocation from this
+    //  module has a header.
+    //
+
+    if (Ptr == NULL) {
+        return;
+    }
+
+    if (YoriLibAllocProfileEnabled) {
+        Header = (PYORI_LIB_ALLOC_PROFILE_HEADER)Ptr - 1;
+        ASSERT(Header->Tag == ((DWORD_PTR)Header ^ YORI_LIB_ALLOC_PROFILE_TAG));
+        Header->Tag = 0;
+        YoriLibAllocProfileRecordFree(Header->Bytes);
+        Ptr = Header;
+    }
     HeapFree(GetProcessHeap(), 0, Ptr);
 #else
     PYORI_SPECIAL_HEAP_HEADER Header;
@@ -388,20 +1012,25 @@ typedef struct _YORILIB_REFERENCED_MALLOC_HEADER {
 #if !YORI_SPECIAL_HEAP
 /**
  Allocate a block of memory that can be reference counted and will be freed
- on final dereference.
+ on final dereference, on behalf of a specified caller.  This is used by
+ library routines that allocate memory for their callers, so that an
+ allocation profile attributes the memory to the code that requested it.
 
  @param Bytes The number of bytes to allocate.
 
+ @param CallSite The return address of the code requesting the allocation.
+
  @return Pointer to the allocated block of memory, or NULL on failure.
  */
 PVOID
-YoriLibReferencedMalloc(
-    __in DWORD Bytes
+YoriLibReferencedMallocForCaller(
+    __in DWORD Bytes,
+    __in_opt PVOID CallSite
     )
 {
     PYORILIB_REFERENCED_MALLOC_HEADER Header;
 
-    Header = YoriLibMalloc(Bytes + sizeof(YORILIB_REFERENCED_MALLOC_HEADER));
+    Header = YoriLibMallocForCaller(Bytes + sizeof(YORILIB_REFERENCED_MALLOC_HEADER), CallSite);
     if (Header == NULL) {
         return NULL;
     }
@@ -410,6 +1039,22 @@ YoriLibReferencedMalloc(
 
     return (PVOID)(Header + 1);
 }
+
+/**
+ Allocate a block of memory that can be reference counted and will be freed
+ on final dereference.
+
+ @param Bytes The number of bytes to allocate.
+
+ @return Pointer to the allocated block of memory, or NULL on failure.
+ */
+PVOID
+YoriLibReferencedMalloc(
+    __in DWORD Bytes
+    )
+{
+    return YoriLibReferencedMallocForCaller(Bytes, YoriLibAllocProfileCaller());
+}
 #else
 /**
  Allocate a block of memory that can be reference counted and will be freed
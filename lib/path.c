@@ -3,7 +3,7 @@
  *
  * Yori lookup expression in path and determine if it's an external executable
  *
- * Copyright (c) 2017 Malcolm J. Smith
+ * Copyright (c) 2017-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -231,26 +231,6 @@ YoriLibSearchEnv(
     }
 }
 
-/**
- A decomposed form of the PathExt environment variable, containing an array
- of this structure, indicating the extension name as a counted string and
- a boolean flag to indicate whether or not a match was found.  This allows
- a searcher to enumerate all files marking what was found, then later checking
- which one should be "first."
- */
-typedef struct _YORI_PATHEXT_COMPONENT {
-
-    /**
-     The extension to search for.
-     */
-    YORI_STRING Extension;
-
-    /**
-     Set to TRUE if the extension was found, remains FALSE if it was not.
-     */
-    BOOL Found;
-} YORI_PATHEXT_COMPONENT, *PYORI_PATHEXT_COMPONENT;
-
 /**
  Convert a directory name and matched file within that directory into a fully
  qualified file path.
@@ -817,6 +797,23 @@ YoriLibPathLocateUnknownExtensionUnknownLocation(
         }
     }
 
+    //
+    //  If the caller only wants the first match for a complete name, the
+    //  path index can answer without enumerating each directory.  If it
+    //  can't be used, fall back to searching the file system.
+    //
+
+    if (FoundPath->StartOfString[0] == '\0' &&
+        MatchAllCallback == NULL &&
+        YoriLibPathIndexIsEnabled()) {
+
+        if (YoriLibPathIndexLocate(SearchFor, PathVariable, PathExtComponents, PathExtCount, FoundPath)) {
+            YoriLibPathFreePathExtComponents(PathExtComponents, PathExtCount);
+            YoriLibFreeStringContents(&ScratchArea);
+            return TRUE;
+        }
+    }
+
     //
     //  If we don't have a match, check each of the path components
     //  until we find one.
@@ -0,0 +1,1751 @@
+/**
+ * @file lib/pathidx.c
+ *
+ * Yori persistent index of executables found in path directories
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ The file name of the index, within the user's temporary directory.
+ */
+#define YORI_LIB_PATH_INDEX_FILE_NAME _T("yoripath.idx")
+
+/**
+ A signature at the beginning of the index file.  This is only written once
+ the remainder of the file is complete.
+ */
+#define YORI_LIB_PATH_INDEX_SIGNATURE (0x58495059)
+
+/**
+ The version of the index file format.
+ */
+#define YORI_LIB_PATH_INDEX_VERSION (1)
+
+/**
+ The amount of time, in 100ns units, that a directory is trusted after its
+ timestamp has been checked.  Within this time, a hit is confirmed by
+ checking that the file still exists, rather than checking the timestamp of
+ every directory before it in the path.  A miss, or a hit which no longer
+ exists, always checks timestamps, so this interval only means a newly
+ created file may not take precedence over one later in the path.  Checking
+ a directory costs about a third of searching it, so the interval needs to
+ span many commands for the index to be cheaper than searching directly.
+ */
+#define YORI_LIB_PATH_INDEX_VALIDATE_INTERVAL (60 * 1000 * 1000 * 10)
+
+/**
+ The maximum number of directories to retain in the index.  If this is
+ exceeded, directories not in the path currently being searched are
+ discarded.
+ */
+#define YORI_LIB_PATH_INDEX_MAX_DIRECTORIES (256)
+
+/**
+ The maximum size of the index file.  Anything larger than this is assumed
+ to be corrupt.
+ */
+#define YORI_LIB_PATH_INDEX_MAX_SIZE (64 * 1024 * 1024)
+
+/**
+ The upper 32 bits of the file offset used to synchronize access to the
+ index between processes.  This is beyond the end of any valid index so
+ that reads and writes of the data are never blocked by the lock.
+ */
+#define YORI_LIB_PATH_INDEX_LOCK_OFFSET_HIGH (0x40000000)
+
+/**
+ A flag indicating the directory could not be opened when the index entry
+ was generated, so it contains no files.
+ */
+#define YORI_LIB_PATH_INDEX_DIRECTORY_MISSING (0x00000001)
+
+/**
+ Round a value up to a power of two alignment.
+ */
+#define YoriLibPathIndexAlign(Value, Alignment) (((Value) + (Alignment) - 1) & ~((DWORDLONG)(Alignment) - 1))
+
+/**
+ The header at the beginning of the index file.  This is followed by a set
+ of variable length directory records.
+ */
+typedef struct _YORI_LIB_PATH_INDEX_HEADER {
+
+    /**
+     YORI_LIB_PATH_INDEX_SIGNATURE if the index is complete.
+     */
+    DWORD Signature;
+
+    /**
+     YORI_LIB_PATH_INDEX_VERSION.
+     */
+    DWORD Version;
+
+    /**
+     The number of valid bytes in the index, including this header.
+     */
+    DWORD Size;
+
+    /**
+     The number of directory records following the header.
+     */
+    DWORD DirectoryCount;
+} YORI_LIB_PATH_INDEX_HEADER, *PYORI_LIB_PATH_INDEX_HEADER;
+
+/**
+ A record describing the executable files found in a single directory.
+ This is followed by the directory name, an array of
+ YORI_LIB_PATH_INDEX_NAME entries, a hash table of indexes into that array,
+ and the characters for each file name.
+ */
+typedef struct _YORI_LIB_PATH_INDEX_DIRECTORY {
+
+    /**
+     The number of bytes in this record, including all data following the
+     structure.  This is a multiple of 8 bytes.
+     */
+    DWORD RecordSize;
+
+    /**
+     YORI_LIB_PATH_INDEX_DIRECTORY_* flags.
+     */
+    DWORD Flags;
+
+    /**
+     The last write time of the directory when the record was generated.
+     */
+    LARGE_INTEGER WriteTime;
+
+    /**
+     The system time when the last write time of the directory was last
+     found to match WriteTime.  This is only updated while the index is
+     locked exclusively.
+     */
+    LARGE_INTEGER LastValidated;
+
+    /**
+     A hash of the PATHEXT value used to select files in the directory.
+     A process with a different PATHEXT regenerates the record.
+     */
+    DWORD PathExtHash;
+
+    /**
+     The number of characters in the directory name.
+     */
+    DWORD DirectoryLengthInChars;
+
+    /**
+     The number of file names in the record.
+     */
+    DWORD NameCount;
+
+    /**
+     The number of entries in the hash table.  This is zero or a power of
+     two larger than NameCount.
+     */
+    DWORD BucketCount;
+
+    /**
+     The number of characters of file names.
+     */
+    DWORD CharCount;
+} YORI_LIB_PATH_INDEX_DIRECTORY, *PYORI_LIB_PATH_INDEX_DIRECTORY;
+
+/**
+ A single file name within a directory record.
+ */
+typedef struct _YORI_LIB_PATH_INDEX_NAME {
+
+    /**
+     The offset, in characters, of the name within the record's characters.
+     */
+    DWORD Offset;
+
+    /**
+     The number of characters in the name.
+     */
+    DWORD LengthInChars;
+} YORI_LIB_PATH_INDEX_NAME, *PYORI_LIB_PATH_INDEX_NAME;
+
+/**
+ An index which has been opened by this process.
+ */
+typedef struct _YORI_LIB_PATH_INDEX {
+
+    /**
+     A handle to the index file.
+     */
+    HANDLE FileHandle;
+
+    /**
+     A handle to a mapping of the index file, if it is currently mapped.
+     */
+    HANDLE MappingHandle;
+
+    /**
+     Pointer to the contents of the index.  This is either a view of the
+     file or, after the index has been regenerated, a heap allocation
+     containing the data that was written to the file.
+     */
+    PUCHAR Base;
+
+    /**
+     The number of valid bytes in the index.
+     */
+    DWORD Size;
+
+    /**
+     TRUE if Base refers to a heap allocation rather than a view.
+     */
+    BOOLEAN Allocated;
+
+    /**
+     TRUE if the lock on the index file is held.
+     */
+    BOOLEAN Locked;
+
+    /**
+     TRUE if the lock on the index file is held exclusively.  Records are
+     only modified while this is set, so a process holding the lock shared
+     never observes a partially written record.
+     */
+    BOOLEAN Exclusive;
+} YORI_LIB_PATH_INDEX, *PYORI_LIB_PATH_INDEX;
+
+/**
+ Return TRUE if the path index should be used.  The index is used when the
+ YORIPATHCACHE environment variable is set to a nonzero value.  It is not
+ used from a 32 bit process on a 64 bit system, because file system
+ redirection means such a process can see different contents for the same
+ directory name.
+
+ @return TRUE if the path index should be used, FALSE if not.
+ */
+BOOLEAN
+YoriLibPathIndexIsEnabled(VOID)
+{
+    LONGLONG Enabled;
+    BOOL IsWow;
+
+    if (!YoriLibGetEnvironmentVariableAsNumber(_T("YORIPATHCACHE"), &Enabled) ||
+        Enabled == 0) {
+
+        return FALSE;
+    }
+
+    if (DllKernel32.pIsWow64Process != NULL) {
+        IsWow = FALSE;
+        if (DllKernel32.pIsWow64Process(GetCurrentProcess(), &IsWow) && IsWow) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Return TRUE if a path component refers to a fully specified directory, so
+ that it refers to the same directory regardless of the current directory
+ of any process.  Only these directories are indexed.
+
+ @param Directory Pointer to the directory name.
+
+ @return TRUE if the directory can be indexed, FALSE if not.
+ */
+BOOLEAN
+YoriLibPathIndexIsDirectoryIndexable(
+    __in PCYORI_STRING Directory
+    )
+{
+    DWORD Index;
+
+    if (Directory->LengthInChars == 0 || Directory->LengthInChars >= 0x8000) {
+        return FALSE;
+    }
+
+    for (Index = 0; Index < Directory->LengthInChars; Index++) {
+        if (Directory->StartOfString[Index] == '*' ||
+            Directory->StartOfString[Index] == '?' ||
+            Directory->StartOfString[Index] == '"') {
+
+            return FALSE;
+        }
+    }
+
+    if (YoriLibIsDriveLetterWithColonAndSlash(Directory)) {
+        return TRUE;
+    }
+
+    if (Directory->LengthInChars >= 3 &&
+        YoriLibIsSep(Directory->StartOfString[0]) &&
+        YoriLibIsSep(Directory->StartOfString[1])) {
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Add a string to a case insensitive hash.
+
+ @param Hash The hash value so far.
+
+ @param String Pointer to the string to add to the hash.
+
+ @return The updated hash value.
+ */
+DWORD
+YoriLibPathIndexHashString(
+    __in DWORD Hash,
+    __in PCYORI_STRING String
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < String->LengthInChars; Index++) {
+        Hash = Hash ^ YoriLibUpcaseChar(String->StartOfString[Index]);
+        Hash = Hash * 16777619;
+    }
+
+    return Hash;
+}
+
+/**
+ The initial value for a case insensitive hash.
+ */
+#define YORI_LIB_PATH_INDEX_HASH_SEED (0x811C9DC5)
+
+/**
+ Generate a hash of the set of extensions that are considered executable.
+
+ @param PathExtComponents Pointer to an array of extensions.
+
+ @param PathExtCount The number of elements in PathExtComponents.
+
+ @return The hash value.
+ */
+DWORD
+YoriLibPathIndexHashPathExt(
+    __in PYORI_PATHEXT_COMPONENT PathExtComponents,
+    __in DWORD PathExtCount
+    )
+{
+    DWORD Hash;
+    DWORD Index;
+
+    Hash = YORI_LIB_PATH_INDEX_HASH_SEED;
+    for (Index = 0; Index < PathExtCount; Index++) {
+        Hash = YoriLibPathIndexHashString(Hash, &PathExtComponents[Index].Extension);
+        Hash = Hash ^ ';';
+        Hash = Hash * 16777619;
+    }
+
+    return Hash;
+}
+
+/**
+ Calculate the offsets of each part of a directory record, and the number of
+ bytes the record requires.
+
+ @param Record Pointer to the record.
+
+ @param NamesOffset On completion, the byte offset of the names array.
+
+ @param BucketsOffset On completion, the byte offset of the hash table.
+
+ @param CharsOffset On completion, the byte offset of the characters of
+        file names.
+
+ @return The number of bytes the record requires.
+ */
+DWORDLONG
+YoriLibPathIndexRecordLayout(
+    __in PYORI_LIB_PATH_INDEX_DIRECTORY Record,
+    __out PDWORDLONG NamesOffset,
+    __out PDWORDLONG BucketsOffset,
+    __out PDWORDLONG CharsOffset
+    )
+{
+    DWORDLONG Offset;
+
+    Offset = sizeof(YORI_LIB_PATH_INDEX_DIRECTORY);
+    Offset = Offset + (DWORDLONG)Record->DirectoryLengthInChars * sizeof(TCHAR);
+    Offset = YoriLibPathIndexAlign(Offset, sizeof(DWORD));
+    *NamesOffset = Offset;
+    Offset = Offset + (DWORDLONG)Record->NameCount * sizeof(YORI_LIB_PATH_INDEX_NAME);
+    *BucketsOffset = Offset;
+    Offset = Offset + (DWORDLONG)Record->BucketCount * sizeof(DWORD);
+    *CharsOffset = Offset;
+    Offset = Offset + (DWORDLONG)Record->CharCount * sizeof(TCHAR);
+    return YoriLibPathIndexAlign(Offset, sizeof(LARGE_INTEGER));
+}
+
+/**
+ Check that a directory record is internally consistent.  This does not
+ check the contents of the names array or hash table, which are checked as
+ they are used.
+
+ @param Record Pointer to the record.
+
+ @param BytesRemaining The number of bytes in the index from the start of the
+        record.
+
+ @return TRUE if the record is valid, FALSE if it is not.
+ */
+BOOLEAN
+YoriLibPathIndexIsRecordValid(
+    __in PYORI_LIB_PATH_INDEX_DIRECTORY Record,
+    __in DWORD BytesRemaining
+    )
+{
+    DWORDLONG NamesOffset;
+    DWORDLONG BucketsOffset;
+    DWORDLONG CharsOffset;
+
+    if (BytesRemaining < sizeof(YORI_LIB_PATH_INDEX_DIRECTORY) ||
+        Record->RecordSize > BytesRemaining ||
+        (Record->RecordSize % sizeof(LARGE_INTEGER)) != 0) {
+
+        return FALSE;
+    }
+
+    if (Record->BucketCount != 0 &&
+        ((Record->BucketCount & (Record->BucketCount - 1)) != 0 ||
+         Record->BucketCount <= Record->NameCount)) {
+
+        return FALSE;
+    }
+
+    if (Record->NameCount != 0 && Record->BucketCount == 0) {
+        return FALSE;
+    }
+
+    if (YoriLibPathIndexRecordLayout(Record, &NamesOffset, &BucketsOffset, &CharsOffset) > Record->RecordSize) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Find a directory within the index.
+
+ @param Base Pointer to the start of the index.
+
+ @param Size The number of valid bytes in the index.
+
+ @param Directory Pointer to the directory name to find.
+
+ @return Pointer to the directory record, or NULL if it is not found.
+ */
+PYORI_LIB_PATH_INDEX_DIRECTORY
+YoriLibPathIndexFindDirectory(
+    __in PUCHAR Base,
+    __in DWORD Size,
+    __in PCYORI_STRING Directory
+    )
+{
+    PYORI_LIB_PATH_INDEX_HEADER Header;
+    PYORI_LIB_PATH_INDEX_DIRECTORY Record;
+    YORI_STRING RecordDirectory;
+    DWORD Offset;
+    DWORD Index;
+
+    if (Base == NULL) {
+        return NULL;
+    }
+
+    Header = (PYORI_LIB_PATH_INDEX_HEADER)Base;
+    Offset = sizeof(YORI_LIB_PATH_INDEX_HEADER);
+    YoriLibInitEmptyString(&RecordDirectory);
+
+    for (Index = 0; Index < Header->DirectoryCount; Index++) {
+        Record = YoriLibAddToPointer(Base, Offset);
+        RecordDirectory.StartOfString = (LPTSTR)(Record + 1);
+        RecordDirectory.LengthInChars = Record->DirectoryLengthInChars;
+        if (YoriLibCompareStringInsensitive(&RecordDirectory, Directory) == 0) {
+            return Record;
+        }
+        Offset = Offset + Record->RecordSize;
+    }
+
+    return NULL;
+}
+
+/**
+ Look for a file name with a specific extension in a directory record.
+
+ @param Record Pointer to the directory record.
+
+ @param FileName Pointer to the base file name.
+
+ @param Extension Pointer to the extension.
+
+ @param FoundName On successful completion, updated to point to the name of
+        the file within the index, which has the case of the file on disk.
+        This string is not NULL terminated.
+
+ @return TRUE if the file was found, FALSE if it was not.
+ */
+__success(return)
+BOOLEAN
+YoriLibPathIndexFindName(
+    __in PYORI_LIB_PATH_INDEX_DIRECTORY Record,
+    __in PCYORI_STRING FileName,
+    __in PCYORI_STRING Extension,
+    __out PYORI_STRING FoundName
+    )
+{
+    DWORDLONG NamesOffset;
+    DWORDLONG BucketsOffset;
+    DWORDLONG CharsOffset;
+    PYORI_LIB_PATH_INDEX_NAME Names;
+    PYORI_LIB_PATH_INDEX_NAME Name;
+    PDWORD Buckets;
+    LPTSTR Chars;
+    YORI_STRING Part;
+    DWORD Hash;
+    DWORD Bucket;
+    DWORD Probes;
+
+    if (Record->NameCount == 0) {
+        return FALSE;
+    }
+
+    YoriLibPathIndexRecordLayout(Record, &NamesOffset, &BucketsOffset, &CharsOffset);
+    Names = YoriLibAddToPointer(Record, NamesOffset);
+    Buckets = YoriLibAddToPointer(Record, BucketsOffset);
+    Chars = YoriLibAddToPointer(Record, CharsOffset);
+
+    Hash = YoriLibPathIndexHashString(YORI_LIB_PATH_INDEX_HASH_SEED, FileName);
+    Hash = YoriLibPathIndexHashString(Hash, Extension);
+
+    YoriLibInitEmptyString(&Part);
+    Bucket = Hash & (Record->BucketCount - 1);
+    for (Probes = 0; Probes < Record->BucketCount; Probes++) {
+        if (Buckets[Bucket] == 0 || Buckets[Bucket] > Record->NameCount) {
+            break;
+        }
+
+        Name = &Names[Buckets[Bucket] - 1];
+        if (Name->LengthInChars == FileName->LengthInChars + Extension->LengthInChars &&
+            Name->Offset <= Record->CharCount &&
+            Name->LengthInChars <= Record->CharCount - Name->Offset) {
+
+            Part.StartOfString = &Chars[Name->Offset];
+            Part.LengthInChars = FileName->LengthInChars;
+            if (YoriLibCompareStringInsensitive(&Part, FileName) == 0) {
+                Part.StartOfString = &Chars[Name->Offset + FileName->LengthInChars];
+                Part.LengthInChars = Extension->LengthInChars;
+                if (YoriLibCompareStringInsensitive(&Part, Extension) == 0) {
+                    YoriLibInitEmptyString(FoundName);
+                    FoundName->StartOfString = &Chars[Name->Offset];
+                    FoundName->LengthInChars = Name->LengthInChars;
+                    return TRUE;
+                }
+            }
+        }
+
+        Bucket = (Bucket + 1) & (Record->BucketCount - 1);
+    }
+
+    return FALSE;
+}
+
+/**
+ Return the current system time as a 64 bit value.
+
+ @param Now On completion, populated with the current system time.
+ */
+VOID
+YoriLibPathIndexGetSystemTime(
+    __out PLARGE_INTEGER Now
+    )
+{
+    FILETIME SystemTime;
+
+    GetSystemTimeAsFileTime(&SystemTime);
+    Now->LowPart = SystemTime.dwLowDateTime;
+    Now->HighPart = SystemTime.dwHighDateTime;
+}
+
+/**
+ Query the last write time of a directory.  This is updated by the file
+ system when files are created, deleted or renamed within the directory.
+ Where available, GetFileAttributesEx is used, which is a single call into
+ the kernel, compared to opening, querying and closing a handle.  Searching
+ a directory directly also requires an open, a query and a close, so the
+ check needs to be cheaper than that for the index to be worthwhile.
+
+ @param Directory Pointer to the directory name.  This need not be NULL
+        terminated.
+
+ @param WriteTime On successful completion, populated with the last write
+        time of the directory.
+
+ @return TRUE if the directory could be opened, FALSE if it could not.
+ */
+__success(return)
+BOOLEAN
+YoriLibPathIndexQueryDirectoryTime(
+    __in PCYORI_STRING Directory,
+    __out PLARGE_INTEGER WriteTime
+    )
+{
+    YORI_STRING DirectoryName;
+    YORI_WIN32_FILE_ATTRIBUTE_DATA AttributeData;
+    HANDLE DirHandle;
+    FILETIME LastWrite;
+    BOOL Result;
+
+    WriteTime->QuadPart = 0;
+
+    if (!YoriLibAllocateString(&DirectoryName, Directory->LengthInChars + 1)) {
+        return FALSE;
+    }
+
+    memcpy(DirectoryName.StartOfString, Directory->StartOfString, Directory->LengthInChars * sizeof(TCHAR));
+    DirectoryName.StartOfString[Directory->LengthInChars] = '\0';
+    DirectoryName.LengthInChars = Directory->LengthInChars;
+
+    if (DllKernel32.pGetFileAttributesExW != NULL) {
+        Result = DllKernel32.pGetFileAttributesExW(DirectoryName.StartOfString, YORI_GET_FILEEX_INFO_STANDARD, &AttributeData);
+        YoriLibFreeStringContents(&DirectoryName);
+        if (!Result ||
+            (AttributeData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+
+            return FALSE;
+        }
+
+        WriteTime->LowPart = AttributeData.ftLastWriteTime.dwLowDateTime;
+        WriteTime->HighPart = AttributeData.ftLastWriteTime.dwHighDateTime;
+        return TRUE;
+    }
+
+    DirHandle = CreateFile(DirectoryName.StartOfString,
+                           FILE_READ_ATTRIBUTES,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL,
+                           OPEN_EXISTING,
+                           FILE_FLAG_BACKUP_SEMANTICS,
+                           NULL);
+
+    YoriLibFreeStringContents(&DirectoryName);
+
+    if (DirHandle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    Result = GetFileTime(DirHandle, NULL, NULL, &LastWrite);
+    CloseHandle(DirHandle);
+
+    if (!Result) {
+        return FALSE;
+    }
+
+    WriteTime->LowPart = LastWrite.dwLowDateTime;
+    WriteTime->HighPart = LastWrite.dwHighDateTime;
+    return TRUE;
+}
+
+/**
+ Check whether a file found in a directory which was trusted without checking
+ its timestamp still exists.  This is a single call into the kernel.
+
+ @param FilePath Pointer to the full path to the file, which is NULL
+        terminated.
+
+ @return TRUE if the file exists, FALSE if it does not.
+ */
+BOOLEAN
+YoriLibPathIndexFileExists(
+    __in PCYORI_STRING FilePath
+    )
+{
+    YORI_WIN32_FILE_ATTRIBUTE_DATA AttributeData;
+    DWORD Attributes;
+
+    if (DllKernel32.pGetFileAttributesExW != NULL) {
+        if (!DllKernel32.pGetFileAttributesExW(FilePath->StartOfString, YORI_GET_FILEEX_INFO_STANDARD, &AttributeData)) {
+            return FALSE;
+        }
+        Attributes = AttributeData.dwFileAttributes;
+    } else {
+        Attributes = GetFileAttributes(FilePath->StartOfString);
+        if (Attributes == (DWORD)-1) {
+            return FALSE;
+        }
+    }
+
+    if ((Attributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Check whether a directory record still describes the directory on disk.
+
+ @param Record Pointer to the directory record.
+
+ @param Directory Pointer to the directory name.
+
+ @param PathExtHash The hash of the PATHEXT value in use by this process.
+
+ @param Now The current system time.
+
+ @param Force If TRUE, the directory timestamp is always checked.  If FALSE,
+        a record whose timestamp was checked recently is trusted.
+
+ @param Exclusive TRUE if the index is locked exclusively.  If so, the time
+        the record was checked is updated.  If not, the record is not
+        modified, and a record which is not trusted and not being forcibly
+        checked is reported as needing to be updated, so that the caller
+        can check it while holding the lock exclusively.
+
+ @param Trusted On completion, set to TRUE if the record was trusted without
+        checking the directory timestamp.
+
+ @return TRUE if the record is current, FALSE if it needs to be updated.
+ */
+BOOLEAN
+YoriLibPathIndexIsRecordCurrent(
+    __in PYORI_LIB_PATH_INDEX_DIRECTORY Record,
+    __in PCYORI_STRING Directory,
+    __in DWORD PathExtHash,
+    __in PLARGE_INTEGER Now,
+    __in BOOLEAN Force,
+    __in BOOLEAN Exclusive,
+    __out PBOOLEAN Trusted
+    )
+{
+    LARGE_INTEGER WriteTime;
+    BOOLEAN Exists;
+
+    *Trusted = FALSE;
+
+    if (Record->PathExtHash != PathExtHash) {
+        return FALSE;
+    }
+
+    //
+    //  A validation time in the future may be the result of a process
+    //  which started later updating it, or the clock moving backwards.
+    //  Either way it can't be trusted.
+    //
+
+    if (!Force) {
+        if (Record->LastValidated.QuadPart <= Now->QuadPart &&
+            Now->QuadPart - Record->LastValidated.QuadPart < YORI_LIB_PATH_INDEX_VALIDATE_INTERVAL) {
+
+            *Trusted = TRUE;
+            return TRUE;
+        }
+
+        if (!Exclusive) {
+            return FALSE;
+        }
+    }
+
+    Exists = YoriLibPathIndexQueryDirectoryTime(Directory, &WriteTime);
+    if (Exists) {
+        if ((Record->Flags & YORI_LIB_PATH_INDEX_DIRECTORY_MISSING) != 0 ||
+            Record->WriteTime.QuadPart != WriteTime.QuadPart) {
+
+            return FALSE;
+        }
+    } else if ((Record->Flags & YORI_LIB_PATH_INDEX_DIRECTORY_MISSING) == 0) {
+        return FALSE;
+    }
+
+    if (Exclusive) {
+        Record->LastValidated.QuadPart = Now->QuadPart;
+    }
+    return TRUE;
+}
+
+/**
+ Enumerate a directory and append a record describing the executable files
+ within it to a buffer.
+
+ @param Directory Pointer to the directory to enumerate.
+
+ @param PathExtComponents Pointer to an array of executable extensions.  Only
+        files with one of these extensions are recorded.
+
+ @param PathExtCount The number of elements in PathExtComponents.
+
+ @param PathExtHash The hash of the executable extensions.
+
+ @param Now The current system time.
+
+ @param Output Pointer to the buffer to append the record to.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibPathIndexBuildRecord(
+    __in PCYORI_STRING Directory,
+    __in PYORI_PATHEXT_COMPONENT PathExtComponents,
+    __in DWORD PathExtCount,
+    __in DWORD PathExtHash,
+    __in PLARGE_INTEGER Now,
+    __inout PYORI_LIB_BYTE_BUFFER Output
+    )
+{
+    YORI_LIB_PATH_INDEX_DIRECTORY NewRecord;
+    PYORI_LIB_PATH_INDEX_DIRECTORY Record;
+    PYORI_LIB_PATH_INDEX_NAME Names;
+    PYORI_LIB_PATH_INDEX_NAME Name;
+    YORI_LIB_BYTE_BUFFER NameBuffer;
+    YORI_LIB_BYTE_BUFFER CharBuffer;
+    YORI_STRING SearchName;
+    YORI_STRING FoundName;
+    WIN32_FIND_DATA FindData;
+    DWORDLONG NamesOffset;
+    DWORDLONG BucketsOffset;
+    DWORDLONG CharsOffset;
+    DWORDLONG RecordSize;
+    PUCHAR Buffer;
+    PDWORD Buckets;
+    HANDLE hFind;
+    DWORD Index;
+    DWORD Count;
+    DWORD Bucket;
+    DWORD Hash;
+
+    ZeroMemory(&NewRecord, sizeof(NewRecord));
+    NewRecord.PathExtHash = PathExtHash;
+    NewRecord.LastValidated.QuadPart = Now->QuadPart;
+    NewRecord.DirectoryLengthInChars = Directory->LengthInChars;
+
+    //
+    //  Query the timestamp before enumerating, so if the directory changes
+    //  while it is being enumerated the record will not match it later.
+    //
+
+    if (!YoriLibPathIndexQueryDirectoryTime(Directory, &NewRecord.WriteTime)) {
+        NewRecord.Flags = YORI_LIB_PATH_INDEX_DIRECTORY_MISSING;
+    }
+
+    if (!YoriLibByteBufferInitialize(&NameBuffer, 0)) {
+        return FALSE;
+    }
+
+    if (!YoriLibByteBufferInitialize(&CharBuffer, 0)) {
+        YoriLibByteBufferCleanup(&NameBuffer);
+        return FALSE;
+    }
+
+    if ((NewRecord.Flags & YORI_LIB_PATH_INDEX_DIRECTORY_MISSING) == 0) {
+
+        YoriLibInitEmptyString(&SearchName);
+        if (Directory->LengthInChars > 0 &&
+            YoriLibIsSep(Directory->StartOfString[Directory->LengthInChars - 1])) {
+            YoriLibYPrintf(&SearchName, _T("%y*"), Directory);
+        } else {
+            YoriLibYPrintf(&SearchName, _T("%y\\*"), Directory);
+        }
+
+        if (SearchName.StartOfString == NULL) {
+            YoriLibByteBufferCleanup(&CharBuffer);
+            YoriLibByteBufferCleanup(&NameBuffer);
+            return FALSE;
+        }
+
+        hFind = FindFirstFile(SearchName.StartOfString, &FindData);
+        YoriLibFreeStringContents(&SearchName);
+
+        if (hFind != INVALID_HANDLE_VALUE) {
+            do {
+                if ((FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+                    continue;
+                }
+
+                YoriLibConstantString(&FoundName, FindData.cFileName);
+                for (Count = 0; Count < PathExtCount; Count++) {
+                    if (FoundName.LengthInChars > PathExtComponents[Count].Extension.LengthInChars &&
+                        _tcsnicmp(PathExtComponents[Count].Extension.StartOfString,
+                                  &FoundName.StartOfString[FoundName.LengthInChars - PathExtComponents[Count].Extension.LengthInChars],
+                                  PathExtComponents[Count].Extension.LengthInChars) == 0) {
+
+                        break;
+                    }
+                }
+
+                if (Count == PathExtCount) {
+                    continue;
+                }
+
+                Name = (PYORI_LIB_PATH_INDEX_NAME)YoriLibByteBufferGetPointerToEnd(&NameBuffer, sizeof(YORI_LIB_PATH_INDEX_NAME), NULL);
+                Buffer = YoriLibByteBufferGetPointerToEnd(&CharBuffer, FoundName.LengthInChars * sizeof(TCHAR), NULL);
+                if (Name == NULL || Buffer == NULL) {
+                    FindClose(hFind);
+                    YoriLibByteBufferCleanup(&CharBuffer);
+                    YoriLibByteBufferCleanup(&NameBuffer);
+                    return FALSE;
+                }
+
+                Name->Offset = NewRecord.CharCount;
+                Name->LengthInChars = FoundName.LengthInChars;
+                memcpy(Buffer, FoundName.StartOfString, FoundName.LengthInChars * sizeof(TCHAR));
+                YoriLibByteBufferAddToPopulatedLength(&NameBuffer, sizeof(YORI_LIB_PATH_INDEX_NAME));
+                YoriLibByteBufferAddToPopulatedLength(&CharBuffer, FoundName.LengthInChars * sizeof(TCHAR));
+                NewRecord.NameCount++;
+                NewRecord.CharCount = NewRecord.CharCount + FoundName.LengthInChars;
+
+            } while (FindNextFile(hFind, &FindData));
+
+            FindClose(hFind);
+        }
+    }
+
+    //
+    //  Size the hash table to be no more than half full.
+    //
+
+    if (NewRecord.NameCount > 0) {
+        NewRecord.BucketCount = 4;
+        while (NewRecord.BucketCount < NewRecord.NameCount * 2) {
+            NewRecord.BucketCount = NewRecord.BucketCount * 2;
+        }
+    }
+
+    RecordSize = YoriLibPathIndexRecordLayout(&NewRecord, &NamesOffset, &BucketsOffset, &CharsOffset);
+    if (RecordSize > YORI_LIB_PATH_INDEX_MAX_SIZE) {
+        YoriLibByteBufferCleanup(&CharBuffer);
+        YoriLibByteBufferCleanup(&NameBuffer);
+        return FALSE;
+    }
+
+    NewRecord.RecordSize = (DWORD)RecordSize;
+
+    Buffer = YoriLibByteBufferGetPointerToEnd(Output, RecordSize, NULL);
+    if (Buffer == NULL) {
+        YoriLibByteBufferCleanup(&CharBuffer);
+        YoriLibByteBufferCleanup(&NameBuffer);
+        return FALSE;
+    }
+
+    ZeroMemory(Buffer, (DWORD)RecordSize);
+    Record = (PYORI_LIB_PATH_INDEX_DIRECTORY)Buffer;
+    memcpy(Record, &NewRecord, sizeof(NewRecord));
+    memcpy(Record + 1, Directory->StartOfString, Directory->LengthInChars * sizeof(TCHAR));
+
+    Names = YoriLibAddToPointer(Record, NamesOffset);
+    Buckets = YoriLibAddToPointer(Record, BucketsOffset);
+    if (NewRecord.NameCount > 0) {
+        memcpy(Names, NameBuffer.Buffer, NewRecord.NameCount * sizeof(YORI_LIB_PATH_INDEX_NAME));
+        memcpy(YoriLibAddToPointer(Record, CharsOffset), CharBuffer.Buffer, NewRecord.CharCount * sizeof(TCHAR));
+    }
+
+    YoriLibInitEmptyString(&FoundName);
+    for (Index = 0; Index < NewRecord.NameCount; Index++) {
+        FoundName.StartOfString = (LPTSTR)CharBuffer.Buffer + Names[Index].Offset;
+        FoundName.LengthInChars = Names[Index].LengthInChars;
+        Hash = YoriLibPathIndexHashString(YORI_LIB_PATH_INDEX_HASH_SEED, &FoundName);
+        Bucket = Hash & (NewRecord.BucketCount - 1);
+        while (Buckets[Bucket] != 0) {
+            Bucket = (Bucket + 1) & (NewRecord.BucketCount - 1);
+        }
+        Buckets[Bucket] = Index + 1;
+    }
+
+    YoriLibByteBufferAddToPopulatedLength(Output, RecordSize);
+
+    YoriLibByteBufferCleanup(&CharBuffer);
+    YoriLibByteBufferCleanup(&NameBuffer);
+    return TRUE;
+}
+
+/**
+ Lock the index file for shared or exclusive access.
+
+ @param Index Pointer to the index.
+
+ @param Exclusive TRUE to acquire the lock exclusively, FALSE to acquire it
+        shared.
+
+ @return TRUE if the lock was acquired, FALSE if it was not.
+ */
+__success(return)
+BOOLEAN
+YoriLibPathIndexLock(
+    __in PYORI_LIB_PATH_INDEX Index,
+    __in BOOLEAN Exclusive
+    )
+{
+    OVERLAPPED Overlapped;
+
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.OffsetHigh = YORI_LIB_PATH_INDEX_LOCK_OFFSET_HIGH;
+
+    if (!LockFileEx(Index->FileHandle, Exclusive?LOCKFILE_EXCLUSIVE_LOCK:0, 0, 1, 0, &Overlapped)) {
+        return FALSE;
+    }
+
+    Index->Locked = TRUE;
+    Index->Exclusive = Exclusive;
+    return TRUE;
+}
+
+/**
+ Release the lock on the index file.
+
+ @param Index Pointer to the index.
+ */
+VOID
+YoriLibPathIndexUnlock(
+    __in PYORI_LIB_PATH_INDEX Index
+    )
+{
+    OVERLAPPED Overlapped;
+
+    if (Index->Locked) {
+        ZeroMemory(&Overlapped, sizeof(Overlapped));
+        Overlapped.OffsetHigh = YORI_LIB_PATH_INDEX_LOCK_OFFSET_HIGH;
+        UnlockFileEx(Index->FileHandle, 0, 1, 0, &Overlapped);
+        Index->Locked = FALSE;
+        Index->Exclusive = FALSE;
+    }
+}
+
+/**
+ Stop referring to the contents of the index, unmapping the file or freeing
+ the regenerated contents.
+
+ @param Index Pointer to the index.
+ */
+VOID
+YoriLibPathIndexUnmap(
+    __in PYORI_LIB_PATH_INDEX Index
+    )
+{
+    if (Index->Base != NULL) {
+        if (Index->Allocated) {
+            YoriLibFree(Index->Base);
+        } else {
+            UnmapViewOfFile(Index->Base);
+        }
+        Index->Base = NULL;
+    }
+
+    if (Index->MappingHandle != NULL) {
+        CloseHandle(Index->MappingHandle);
+        Index->MappingHandle = NULL;
+    }
+
+    Index->Allocated = FALSE;
+    Index->Size = 0;
+}
+
+/**
+ Map the index file and validate its contents.  The lock must be held.  If
+ the file is empty or its contents are not valid, this succeeds and leaves
+ the index with no contents, so that it is regenerated.
+
+ @param Index Pointer to the index.
+ */
+VOID
+YoriLibPathIndexMap(
+    __in PYORI_LIB_PATH_INDEX Index
+    )
+{
+    PYORI_LIB_PATH_INDEX_HEADER Header;
+    PYORI_LIB_PATH_INDEX_DIRECTORY Record;
+    DWORD FileSize;
+    DWORD FileSizeHigh;
+    DWORD Offset;
+    DWORD Count;
+
+    ASSERT(Index->Base == NULL);
+
+    FileSize = GetFileSize(Index->FileHandle, &FileSizeHigh);
+    if (FileSize == INVALID_FILE_SIZE ||
+        FileSizeHigh != 0 ||
+        FileSize < sizeof(YORI_LIB_PATH_INDEX_HEADER) ||
+        FileSize > YORI_LIB_PATH_INDEX_MAX_SIZE) {
+
+        return;
+    }
+
+    Index->MappingHandle = CreateFileMapping(Index->FileHandle, NULL, PAGE_READWRITE, 0, 0, NULL);
+    if (Index->MappingHandle == NULL) {
+        return;
+    }
+
+    Index->Base = MapViewOfFile(Index->MappingHandle, FILE_MAP_WRITE, 0, 0, 0);
+    if (Index->Base == NULL) {
+        YoriLibPathIndexUnmap(Index);
+        return;
+    }
+
+    //
+    //  Check the header and the structure of every record up front, so
+    //  lookups can walk records without checking bounds.
+    //
+
+    Header = (PYORI_LIB_PATH_INDEX_HEADER)Index->Base;
+    if (Header->Signature != YORI_LIB_PATH_INDEX_SIGNATURE ||
+        Header->Version != YORI_LIB_PATH_INDEX_VERSION ||
+        Header->Size < sizeof(YORI_LIB_PATH_INDEX_HEADER) ||
+        Header->Size > FileSize) {
+
+        YoriLibPathIndexUnmap(Index);
+        return;
+    }
+
+    Offset = sizeof(YORI_LIB_PATH_INDEX_HEADER);
+    for (Count = 0; Count < Header->DirectoryCount; Count++) {
+        Record = YoriLibAddToPointer(Index->Base, Offset);
+        if (!YoriLibPathIndexIsRecordValid(Record, Header->Size - Offset)) {
+            YoriLibPathIndexUnmap(Index);
+            return;
+        }
+        Offset = Offset + Record->RecordSize;
+    }
+
+    Index->Size = Header->Size;
+}
+
+/**
+ Close an index opened with @ref YoriLibPathIndexOpen .
+
+ @param Index Pointer to the index.
+ */
+VOID
+YoriLibPathIndexClose(
+    __in PYORI_LIB_PATH_INDEX Index
+    )
+{
+    YoriLibPathIndexUnmap(Index);
+    YoriLibPathIndexUnlock(Index);
+    if (Index->FileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(Index->FileHandle);
+        Index->FileHandle = INVALID_HANDLE_VALUE;
+    }
+}
+
+/**
+ Open the index file for the current user, acquire a shared lock on it, and
+ map its contents.
+
+ @param Index On successful completion, populated with the opened index.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibPathIndexOpen(
+    __out PYORI_LIB_PATH_INDEX Index
+    )
+{
+    YORI_STRING FileName;
+
+    ZeroMemory(Index, sizeof(YORI_LIB_PATH_INDEX));
+    Index->FileHandle = INVALID_HANDLE_VALUE;
+
+    if (!YoriLibGetTempPath(&FileName, sizeof(YORI_LIB_PATH_INDEX_FILE_NAME) / sizeof(TCHAR))) {
+        return FALSE;
+    }
+
+    if (FileName.LengthInChars > 0 &&
+        !YoriLibIsSep(FileName.StartOfString[FileName.LengthInChars - 1])) {
+
+        FileName.StartOfString[FileName.LengthInChars] = '\\';
+        FileName.LengthInChars++;
+    }
+
+    FileName.LengthInChars += YoriLibSPrintfS(&FileName.StartOfString[FileName.LengthInChars],
+                                              FileName.LengthAllocated - FileName.LengthInChars,
+                                              _T("%s"),
+                                              YORI_LIB_PATH_INDEX_FILE_NAME);
+
+    Index->FileHandle = CreateFile(FileName.StartOfString,
+                                   GENERIC_READ | GENERIC_WRITE,
+                                   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                   NULL,
+                                   OPEN_ALWAYS,
+                                   FILE_ATTRIBUTE_NORMAL,
+                                   NULL);
+
+    YoriLibFreeStringContents(&FileName);
+
+    if (Index->FileHandle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    if (!YoriLibPathIndexLock(Index, FALSE)) {
+        YoriLibPathIndexClose(Index);
+        return FALSE;
+    }
+
+    YoriLibPathIndexMap(Index);
+    return TRUE;
+}
+
+/**
+ Append a copy of an existing directory record to a buffer.
+
+ @param Record Pointer to the record to copy.
+
+ @param Output Pointer to the buffer to append the record to.
+
+ @return Pointer to the new copy of the record, or NULL on allocation
+         failure.
+ */
+PYORI_LIB_PATH_INDEX_DIRECTORY
+YoriLibPathIndexCopyRecord(
+    __in PYORI_LIB_PATH_INDEX_DIRECTORY Record,
+    __inout PYORI_LIB_BYTE_BUFFER Output
+    )
+{
+    PUCHAR Buffer;
+
+    Buffer = YoriLibByteBufferGetPointerToEnd(Output, Record->RecordSize, NULL);
+    if (Buffer == NULL) {
+        return NULL;
+    }
+
+    memcpy(Buffer, Record, Record->RecordSize);
+    YoriLibByteBufferAddToPopulatedLength(Output, Record->RecordSize);
+    return (PYORI_LIB_PATH_INDEX_DIRECTORY)Buffer;
+}
+
+/**
+ Find the next component in a semicolon delimited path variable.
+
+ @param PathVariable Pointer to the path variable.
+
+ @param Offset On input, the offset to start searching from.  On output,
+        updated to the offset following the component that was found.
+
+ @param Component On successful completion, updated to refer to the
+        component within the path variable.
+
+ @return TRUE if a component was found, FALSE if the end of the variable was
+         reached.
+ */
+__success(return)
+BOOLEAN
+YoriLibPathIndexNextComponent(
+    __in PCYORI_STRING PathVariable,
+    __inout PDWORD Offset,
+    __out PYORI_STRING Component
+    )
+{
+    DWORD Index;
+
+    YoriLibInitEmptyString(Component);
+
+    Index = *Offset;
+    while (Index < PathVariable->LengthInChars && PathVariable->StartOfString[Index] == ';') {
+        Index++;
+    }
+
+    if (Index >= PathVariable->LengthInChars) {
+        *Offset = Index;
+        return FALSE;
+    }
+
+    Component->StartOfString = &PathVariable->StartOfString[Index];
+    while (Index < PathVariable->LengthInChars && PathVariable->StartOfString[Index] != ';') {
+        Index++;
+    }
+
+    Component->LengthInChars = (DWORD)(&PathVariable->StartOfString[Index] - Component->StartOfString);
+    *Offset = Index;
+    return TRUE;
+}
+
+/**
+ Regenerate the index for every indexable directory in a path variable and
+ write it back to the index file.  The caller must hold the lock
+ exclusively.  Directories whose records are still current are copied from
+ the existing index rather than enumerated again.  On success, the index
+ refers to the newly generated contents.
+
+ @param Index Pointer to the index.
+
+ @param PathVariable Pointer to the path variable.
+
+ @param PathExtComponents Pointer to an array of executable extensions.
+
+ @param PathExtCount The number of elements in PathExtComponents.
+
+ @param PathExtHash The hash of the executable extensions.
+
+ @param Now The current system time.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibPathIndexRegenerate(
+    __in PYORI_LIB_PATH_INDEX Index,
+    __in PCYORI_STRING PathVariable,
+    __in PYORI_PATHEXT_COMPONENT PathExtComponents,
+    __in DWORD PathExtCount,
+    __in DWORD PathExtHash,
+    __in PLARGE_INTEGER Now
+    )
+{
+    YORI_LIB_BYTE_BUFFER Output;
+    PYORI_LIB_PATH_INDEX_HEADER Header;
+    PYORI_LIB_PATH_INDEX_HEADER OldHeader;
+    PYORI_LIB_PATH_INDEX_DIRECTORY Record;
+    PYORI_LIB_PATH_INDEX_DIRECTORY NewRecord;
+    YORI_STRING Directory;
+    YORI_STRING RecordDirectory;
+    DWORD PathOffset;
+    DWORD Offset;
+    DWORD Count;
+    DWORD DirectoryCount;
+    DWORD BytesWritten;
+    DWORD Signature;
+    BOOLEAN Trusted;
+
+    ASSERT(Index->Locked && Index->Exclusive);
+
+    if (!YoriLibByteBufferInitialize(&Output, 0)) {
+        return FALSE;
+    }
+
+    Header = (PYORI_LIB_PATH_INDEX_HEADER)YoriLibByteBufferGetPointerToEnd(&Output, sizeof(YORI_LIB_PATH_INDEX_HEADER), NULL);
+    if (Header == NULL) {
+        YoriLibByteBufferCleanup(&Output);
+        return FALSE;
+    }
+    YoriLibByteBufferAddToPopulatedLength(&Output, sizeof(YORI_LIB_PATH_INDEX_HEADER));
+
+    //
+    //  Generate a record for every directory in this path, in path order,
+    //  skipping any directory that appears more than once.
+    //
+
+    DirectoryCount = 0;
+    PathOffset = 0;
+    while (YoriLibPathIndexNextComponent(PathVariable, &PathOffset, &Directory)) {
+        if (!YoriLibPathIndexIsDirectoryIndexable(&Directory)) {
+            continue;
+        }
+
+        ((PYORI_LIB_PATH_INDEX_HEADER)Output.Buffer)->DirectoryCount = DirectoryCount;
+        if (YoriLibPathIndexFindDirectory(Output.Buffer, (DWORD)Output.BytesPopulated, &Directory) != NULL) {
+            continue;
+        }
+
+        Record = YoriLibPathIndexFindDirectory(Index->Base, Index->Size, &Directory);
+        if (Record != NULL &&
+            YoriLibPathIndexIsRecordCurrent(Record, &Directory, PathExtHash, Now, TRUE, TRUE, &Trusted)) {
+
+            NewRecord = YoriLibPathIndexCopyRecord(Record, &Output);
+            if (NewRecord == NULL) {
+                YoriLibByteBufferCleanup(&Output);
+                return FALSE;
+            }
+        } else if (!YoriLibPathIndexBuildRecord(&Directory, PathExtComponents, PathExtCount, PathExtHash, Now, &Output)) {
+            YoriLibByteBufferCleanup(&Output);
+            return FALSE;
+        }
+
+        DirectoryCount++;
+    }
+
+    //
+    //  Retain records for directories from other paths, unless the index
+    //  has grown too large, in which case they are discarded.  These are
+    //  not validated here; that happens when they are next used.
+    //
+
+    if (Index->Base != NULL) {
+        OldHeader = (PYORI_LIB_PATH_INDEX_HEADER)Index->Base;
+        if (DirectoryCount + OldHeader->DirectoryCount <= YORI_LIB_PATH_INDEX_MAX_DIRECTORIES) {
+            YoriLibInitEmptyString(&RecordDirectory);
+            Offset = sizeof(YORI_LIB_PATH_INDEX_HEADER);
+            for (Count = 0; Count < OldHeader->DirectoryCount; Count++) {
+                Record = YoriLibAddToPointer(Index->Base, Offset);
+                Offset = Offset + Record->RecordSize;
+
+                RecordDirectory.StartOfString = (LPTSTR)(Record + 1);
+                RecordDirectory.LengthInChars = Record->DirectoryLengthInChars;
+                ((PYORI_LIB_PATH_INDEX_HEADER)Output.Buffer)->DirectoryCount = DirectoryCount;
+                if (YoriLibPathIndexFindDirectory(Output.Buffer, (DWORD)Output.BytesPopulated, &RecordDirectory) != NULL) {
+                    continue;
+                }
+
+                if (YoriLibPathIndexCopyRecord(Record, &Output) == NULL) {
+                    YoriLibByteBufferCleanup(&Output);
+                    return FALSE;
+                }
+                DirectoryCount++;
+            }
+        }
+    }
+
+    if (Output.BytesPopulated > YORI_LIB_PATH_INDEX_MAX_SIZE) {
+        YoriLibByteBufferCleanup(&Output);
+        return FALSE;
+    }
+
+    Header = (PYORI_LIB_PATH_INDEX_HEADER)Output.Buffer;
+    Header->Signature = 0;
+    Header->Version = YORI_LIB_PATH_INDEX_VERSION;
+    Header->Size = (DWORD)Output.BytesPopulated;
+    Header->DirectoryCount = DirectoryCount;
+
+    //
+    //  The file can't be truncated while it's mapped, so stop using the
+    //  previous contents before writing the new ones.  The signature is
+    //  written last, so if the write fails part way through the file is
+    //  not considered valid.
+    //
+
+    YoriLibPathIndexUnmap(Index);
+
+    SetFilePointer(Index->FileHandle, 0, NULL, FILE_BEGIN);
+    if (!WriteFile(Index->FileHandle, Output.Buffer, Header->Size, &BytesWritten, NULL) ||
+        BytesWritten != Header->Size ||
+        !SetEndOfFile(Index->FileHandle)) {
+
+        YoriLibByteBufferCleanup(&Output);
+        return FALSE;
+    }
+
+    Signature = YORI_LIB_PATH_INDEX_SIGNATURE;
+    SetFilePointer(Index->FileHandle, 0, NULL, FILE_BEGIN);
+    if (!WriteFile(Index->FileHandle, &Signature, sizeof(Signature), &BytesWritten, NULL)) {
+        YoriLibByteBufferCleanup(&Output);
+        return FALSE;
+    }
+    Header->Signature = Signature;
+
+    Index->Base = Output.Buffer;
+    Index->Size = Header->Size;
+    Index->Allocated = TRUE;
+    return TRUE;
+}
+
+/**
+ Search for a file in each directory of a path variable, using the index for
+ directories that are indexed and searching the file system for any that
+ are not.
+
+ @param Index Pointer to the index.
+
+ @param SearchFor Pointer to the file name to find, without an extension.
+
+ @param PathVariable Pointer to the path variable.
+
+ @param PathExtComponents Pointer to an array of executable extensions.
+
+ @param PathExtCount The number of elements in PathExtComponents.
+
+ @param PathExtHash The hash of the executable extensions.
+
+ @param Now The current system time.
+
+ @param Force If TRUE, the timestamp of each directory is checked.  If FALSE,
+        directories checked recently are trusted.
+
+ @param ScratchArea Pointer to a scratch buffer used when searching
+        directories that are not indexed.
+
+ @param FoundPath On successful completion, populated with the full path to
+        the file, or an empty string if it was not found.
+
+ @param NeedsRegenerate On completion, set to TRUE if a directory needed to
+        be checked or indexed before the search could complete.  Both of
+        these update the index, which requires the lock to be held
+        exclusively.
+
+ @param AnyTrusted On completion, set to TRUE if any directory was trusted
+        without checking its timestamp.
+
+ @param StaleHit On completion, set to TRUE if the file was found in a
+        directory which was trusted without checking its timestamp, but the
+        file no longer exists.  FoundPath is empty in this case, and the
+        search should be repeated with Force set.
+
+ @return TRUE to indicate the search completed, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibPathIndexSearch(
+    __in PYORI_LIB_PATH_INDEX Index,
+    __in PYORI_STRING SearchFor,
+    __in PCYORI_STRING PathVariable,
+    __in PYORI_PATHEXT_COMPONENT PathExtComponents,
+    __in DWORD PathExtCount,
+    __in DWORD PathExtHash,
+    __in PLARGE_INTEGER Now,
+    __in BOOLEAN Force,
+    __inout PYORI_STRING ScratchArea,
+    __inout PYORI_STRING FoundPath,
+    __out PBOOLEAN NeedsRegenerate,
+    __out PBOOLEAN AnyTrusted,
+    __out PBOOLEAN StaleHit
+    )
+{
+    PYORI_LIB_PATH_INDEX_DIRECTORY Record;
+    YORI_STRING Directory;
+    YORI_STRING FoundName;
+    WIN32_FIND_DATA FindData;
+    DWORD PathOffset;
+    DWORD Count;
+    BOOLEAN Trusted;
+
+    *NeedsRegenerate = FALSE;
+    *AnyTrusted = FALSE;
+    *StaleHit = FALSE;
+
+    PathOffset = 0;
+    while (YoriLibPathIndexNextComponent(PathVariable, &PathOffset, &Directory)) {
+
+        FoundPath->StartOfString[0] = '\0';
+        FoundPath->LengthInChars = 0;
+
+        if (!YoriLibPathIndexIsDirectoryIndexable(&Directory)) {
+            if (!YoriLibLocateFileExtensionsInOnePath(SearchFor,
+                                                      &Directory,
+                                                      ScratchArea,
+                                                      PathExtComponents,
+                                                      PathExtCount,
+                                                      NULL,
+                                                      NULL,
+                                                      FoundPath,
+                                                      FALSE)) {
+                return FALSE;
+            }
+
+            if (FoundPath->StartOfString[0] != '\0') {
+                return TRUE;
+            }
+            continue;
+        }
+
+        Record = YoriLibPathIndexFindDirectory(Index->Base, Index->Size, &Directory);
+        if (Record == NULL ||
+            !YoriLibPathIndexIsRecordCurrent(Record, &Directory, PathExtHash, Now, Force, Index->Exclusive, &Trusted)) {
+
+            *NeedsRegenerate = TRUE;
+            return TRUE;
+        }
+
+        if (Trusted) {
+            *AnyTrusted = TRUE;
+        }
+
+        for (Count = 0; Count < PathExtCount; Count++) {
+            if (YoriLibPathIndexFindName(Record, SearchFor, &PathExtComponents[Count].Extension, &FoundName)) {
+                if (FoundName.LengthInChars >= sizeof(FindData.cFileName)/sizeof(FindData.cFileName[0])) {
+                    return FALSE;
+                }
+
+                memcpy(FindData.cFileName, FoundName.StartOfString, FoundName.LengthInChars * sizeof(TCHAR));
+                FindData.cFileName[FoundName.LengthInChars] = '\0';
+                if (!YoriLibLocateBuildFullName(&Directory, &FindData, FoundPath, FALSE)) {
+                    return FALSE;
+                }
+
+                //
+                //  If the directory was trusted, the file may have been
+                //  deleted or renamed since it was checked.  Checking the
+                //  file is cheaper than checking every directory before it,
+                //  and if it is gone, the caller checks them all.
+                //
+
+                if (Trusted && !YoriLibPathIndexFileExists(FoundPath)) {
+                    FoundPath->StartOfString[0] = '\0';
+                    FoundPath->LengthInChars = 0;
+                    *StaleHit = TRUE;
+                }
+                return TRUE;
+            }
+        }
+    }
+
+    FoundPath->StartOfString[0] = '\0';
+    FoundPath->LengthInChars = 0;
+    return TRUE;
+}
+
+/**
+ Search for an executable in a path variable using the persistent path
+ index.  The index records the executable files in each path directory and
+ is shared between all processes for the user via a mapped file, so a
+ lookup does not need to enumerate each directory.  Directories are indexed
+ again when their timestamp changes.
+
+ @param SearchFor Pointer to the file name to find, without an extension.
+
+ @param PathVariable Pointer to the path variable.  This is not modified.
+
+ @param PathExtComponents Pointer to an array of executable extensions.
+
+ @param PathExtCount The number of elements in PathExtComponents.
+
+ @param FoundPath On successful completion, populated with the full path to
+        the file, or an empty string if it was not found.
+
+ @return TRUE if the search was performed, and FoundPath describes the
+         result.  FALSE if the index could not be used, and the caller
+         should search the file system directly.
+ */
+__success(return)
+BOOL
+YoriLibPathIndexLocate(
+    __in PYORI_STRING SearchFor,
+    __in PCYORI_STRING PathVariable,
+    __in PYORI_PATHEXT_COMPONENT PathExtComponents,
+    __in DWORD PathExtCount,
+    __inout PYORI_STRING FoundPath
+    )
+{
+    YORI_LIB_PATH_INDEX Index;
+    YORI_STRING ScratchArea;
+    LARGE_INTEGER Now;
+    DWORD PathExtHash;
+    DWORD Count;
+    BOOLEAN Force;
+    BOOLEAN Regenerated;
+    BOOLEAN NeedsRegenerate;
+    BOOLEAN AnyTrusted;
+    BOOLEAN StaleHit;
+
+    if (SearchFor->LengthInChars == 0) {
+        return FALSE;
+    }
+
+    for (Count = 0; Count < SearchFor->LengthInChars; Count++) {
+        if (SearchFor->StartOfString[Count] == '*' ||
+            SearchFor->StartOfString[Count] == '?' ||
+            YoriLibIsSep(SearchFor->StartOfString[Count]) ||
+            SearchFor->StartOfString[Count] == ':') {
+
+            return FALSE;
+        }
+    }
+
+    if (!YoriLibPathIndexOpen(&Index)) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&ScratchArea);
+    PathExtHash = YoriLibPathIndexHashPathExt(PathExtComponents, PathExtCount);
+    YoriLibPathIndexGetSystemTime(&Now);
+    Force = FALSE;
+    Regenerated = FALSE;
+
+    while (TRUE) {
+        if (!YoriLibPathIndexSearch(&Index,
+                                    SearchFor,
+                                    PathVariable,
+                                    PathExtComponents,
+                                    PathExtCount,
+                                    PathExtHash,
+                                    &Now,
+                                    Force,
+                                    &ScratchArea,
+                                    FoundPath,
+                                    &NeedsRegenerate,
+                                    &AnyTrusted,
+                                    &StaleHit)) {
+            break;
+        }
+
+        //
+        //  If a directory needs to be checked, isn't indexed or has
+        //  changed, the index needs to be updated.  This requires
+        //  exclusive access, so the shared lock is released first, and
+        //  another process may have done the work by the time this
+        //  process has acquired the lock, so search again before
+        //  regenerating.  Regenerating validates all directories, so the
+        //  search after it can't need it again.
+        //
+
+        if (NeedsRegenerate) {
+            if (!Index.Exclusive) {
+                YoriLibPathIndexUnmap(&Index);
+                YoriLibPathIndexUnlock(&Index);
+                if (!YoriLibPathIndexLock(&Index, TRUE)) {
+                    break;
+                }
+                YoriLibPathIndexMap(&Index);
+                continue;
+            }
+
+            if (Regenerated) {
+                break;
+            }
+
+            if (!YoriLibPathIndexRegenerate(&Index, PathVariable, PathExtComponents, PathExtCount, PathExtHash, &Now)) {
+                break;
+            }
+            Regenerated = TRUE;
+            continue;
+        }
+
+        //
+        //  If a file was found in a trusted directory but no longer
+        //  exists, check every directory, so the search finds the next
+        //  match in the path rather than a file that has gone.  Hits are
+        //  only checked in trusted directories, so this can't happen
+        //  once Force is set.
+        //
+
+        if (StaleHit) {
+            ASSERT(!Force);
+            Force = TRUE;
+            continue;
+        }
+
+        //
+        //  A file which was found is returned, even if its directory was
+        //  trusted, since it has been checked to still exist.  If nothing
+        //  was found, check that no directory has changed before
+        //  concluding that the file doesn't exist.
+        //
+
+        if (FoundPath->StartOfString[0] == '\0' && AnyTrusted && !Force && !Regenerated) {
+            Force = TRUE;
+            continue;
+        }
+
+        YoriLibFreeStringContents(&ScratchArea);
+        YoriLibPathIndexClose(&Index);
+        return TRUE;
+    }
+
+    FoundPath->StartOfString[0] = '\0';
+    FoundPath->LengthInChars = 0;
+    YoriLibFreeStringContents(&ScratchArea);
+    YoriLibPathIndexClose(&Index);
+    return FALSE;
+}
+
+// vim:sw=4:ts=4:et:
@@ -0,0 +1,322 @@
+/**
+ * @file lib/peimage.c
+ *
+ * Yori routines to map PE files and calculate or update their headers
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ Open a PE file, map it into memory, and locate its headers.
+
+ @param FileName Pointer to a fully qualified, NULL terminated file name.
+
+ @param Writable If TRUE, the file is opened and mapped for write access so
+        that the caller can update headers in place.  If FALSE, the file is
+        mapped read only.
+
+ @param Image On successful completion, populated with the mapped view of the
+        file and a pointer to its PE headers.  The caller should call
+        @ref YoriLibPeImageClose when it is no longer needed.
+
+ @return Win32 error code, including ERROR_SUCCESS to indicate success.
+         ERROR_BAD_EXE_FORMAT is returned if the file is not a PE file.
+ */
+__success(return == ERROR_SUCCESS)
+DWORD
+YoriLibPeImageOpen(
+    __in PCYORI_STRING FileName,
+    __in BOOLEAN Writable,
+    __out PYORI_LIB_PE_IMAGE Image
+    )
+{
+    DWORD Err;
+    DWORD FileSizeHigh;
+    DWORD DesiredAccess;
+    PIMAGE_DOS_HEADER DosHeader;
+    PYORILIB_PE_HEADERS PeHeaders;
+
+    ASSERT(YoriLibIsStringNullTerminated(FileName));
+
+    ZeroMemory(Image, sizeof(YORI_LIB_PE_IMAGE));
+    Image->FileHandle = INVALID_HANDLE_VALUE;
+    Image->Writable = Writable;
+
+    DesiredAccess = FILE_READ_ATTRIBUTES | FILE_READ_DATA;
+    if (Writable) {
+        DesiredAccess = DesiredAccess | FILE_WRITE_DATA;
+    }
+
+    Image->FileHandle = CreateFile(FileName->StartOfString,
+                                   DesiredAccess,
+                                   FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                   NULL,
+                                   OPEN_EXISTING,
+                                   FILE_FLAG_SEQUENTIAL_SCAN,
+                                   NULL);
+
+    if (Image->FileHandle == INVALID_HANDLE_VALUE) {
+        return GetLastError();
+    }
+
+    //
+    //  PE files are limited to 4Gb, and anything smaller than a DOS header
+    //  can't be one.  Checking this here also means the mapping below is
+    //  never attempted on an empty file, which would fail.
+    //
+
+    Image->FileSize = GetFileSize(Image->FileHandle, &FileSizeHigh);
+    if (Image->FileSize == INVALID_FILE_SIZE) {
+        Err = GetLastError();
+        if (Err != ERROR_SUCCESS) {
+            YoriLibPeImageClose(Image);
+            return Err;
+        }
+    }
+
+    if (FileSizeHigh != 0 || Image->FileSize < sizeof(IMAGE_DOS_HEADER)) {
+        YoriLibPeImageClose(Image);
+        return ERROR_BAD_EXE_FORMAT;
+    }
+
+    Image->MappingHandle = CreateFileMapping(Image->FileHandle,
+                                             NULL,
+                                             Writable?PAGE_READWRITE:PAGE_READONLY,
+                                             0,
+                                             0,
+                                             NULL);
+
+    if (Image->MappingHandle == NULL) {
+        Err = GetLastError();
+        YoriLibPeImageClose(Image);
+        return Err;
+    }
+
+    Image->Base = MapViewOfFile(Image->MappingHandle,
+                                Writable?FILE_MAP_WRITE:FILE_MAP_READ,
+                                0,
+                                0,
+                                0);
+
+    if (Image->Base == NULL) {
+        Err = GetLastError();
+        YoriLibPeImageClose(Image);
+        return Err;
+    }
+
+    //
+    //  Validate that the headers are present and within the file before
+    //  giving the caller a pointer to them.
+    //
+
+    DosHeader = (PIMAGE_DOS_HEADER)Image->Base;
+    if (DosHeader->e_magic != IMAGE_DOS_SIGNATURE ||
+        DosHeader->e_lfanew == 0 ||
+        Image->FileSize < sizeof(YORILIB_PE_HEADERS) ||
+        (DWORD)DosHeader->e_lfanew > Image->FileSize - sizeof(YORILIB_PE_HEADERS)) {
+
+        YoriLibPeImageClose(Image);
+        return ERROR_BAD_EXE_FORMAT;
+    }
+
+    PeHeaders = YoriLibAddToPointer(Image->Base, DosHeader->e_lfanew);
+    if (PeHeaders->Signature != IMAGE_NT_SIGNATURE ||
+        PeHeaders->ImageHeader.SizeOfOptionalHeader < FIELD_OFFSET(IMAGE_OPTIONAL_HEADER, CheckSum) + sizeof(PeHeaders->OptionalHeader.CheckSum)) {
+
+        YoriLibPeImageClose(Image);
+        return ERROR_BAD_EXE_FORMAT;
+    }
+
+    Image->PeHeaders = PeHeaders;
+    return ERROR_SUCCESS;
+}
+
+/**
+ Unmap and close a PE file previously opened with @ref YoriLibPeImageOpen.
+ If the file was opened for write, any changes made through the mapping are
+ flushed to the file before it is closed.
+
+ @param Image Pointer to the image to close.
+ */
+VOID
+YoriLibPeImageClose(
+    __in PYORI_LIB_PE_IMAGE Image
+    )
+{
+    if (Image->Base != NULL) {
+        if (Image->Writable) {
+            FlushViewOfFile(Image->Base, 0);
+        }
+        UnmapViewOfFile(Image->Base);
+        Image->Base = NULL;
+    }
+
+    if (Image->MappingHandle != NULL) {
+        CloseHandle(Image->MappingHandle);
+        Image->MappingHandle = NULL;
+    }
+
+    if (Image->FileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(Image->FileHandle);
+        Image->FileHandle = INVALID_HANDLE_VALUE;
+    }
+
+    Image->PeHeaders = NULL;
+}
+
+/**
+ Sum a buffer as a series of little endian 16 bit words, in the manner used
+ by the PE checksum.
+
+ The PE checksum adds each word and folds any carry back into the low 16
+ bits.  Because 0x10000 is equivalent to 1 under this arithmetic, adding a
+ 32 bit value is equivalent to adding both of its 16 bit halves, so this
+ routine consumes the buffer a DWORD at a time into 64 bit accumulators and
+ only folds once at the end.  Four independent accumulators are used so the
+ additions don't serialize on each other, which allows the compiler and
+ processor to overlap them.  A 64 bit accumulator cannot overflow for any
+ buffer smaller than 64Gb, and PE files are limited to 4Gb.
+
+ @param Buffer Pointer to the data to sum.  This is expected to be the base
+        of a mapped file, and therefore aligned.
+
+ @param Length The number of bytes in the buffer.
+
+ @return The folded 16 bit sum of the buffer.
+ */
+WORD
+YoriLibPeImageSumBuffer(
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORDLONG Sum0;
+    DWORDLONG Sum1;
+    DWORDLONG Sum2;
+    DWORDLONG Sum3;
+    PDWORD Dwords;
+    DWORD DwordCount;
+    DWORD Index;
+    DWORD Tail;
+
+    Sum0 = 0;
+    Sum1 = 0;
+    Sum2 = 0;
+    Sum3 = 0;
+
+    Dwords = (PDWORD)Buffer;
+    DwordCount = Length / sizeof(DWORD);
+
+    for (Index = 0; Index + 4 <= DwordCount; Index += 4) {
+        Sum0 = Sum0 + Dwords[Index];
+        Sum1 = Sum1 + Dwords[Index + 1];
+        Sum2 = Sum2 + Dwords[Index + 2];
+        Sum3 = Sum3 + Dwords[Index + 3];
+    }
+
+    for (; Index < DwordCount; Index++) {
+        Sum0 = Sum0 + Dwords[Index];
+    }
+
+    Sum0 = Sum0 + Sum1 + Sum2 + Sum3;
+
+    //
+    //  Any trailing bytes are summed as though the file were padded with
+    //  zeroes.  Since the data is little endian, the bytes land in the
+    //  same place as they would have within a complete DWORD.
+    //
+
+    Tail = 0;
+    for (Index = (DWORD)(DwordCount * sizeof(DWORD)); Index < Length; Index++) {
+        Tail = Tail | ((DWORD)Buffer[Index] << ((Index % sizeof(DWORD)) * 8));
+    }
+    Sum0 = Sum0 + Tail;
+
+    while ((Sum0 >> 16) != 0) {
+        Sum0 = (Sum0 & 0xFFFF) + (Sum0 >> 16);
+    }
+
+    return (WORD)Sum0;
+}
+
+/**
+ Calculate the checksum of a mapped PE file.  This generates the same result
+ as CheckSumMappedFile in imagehlp, without requiring imagehlp to be present
+ and without processing the file a word at a time.
+
+ @param Image Pointer to the mapped image.
+
+ @return The checksum that should be stored in the PE header.
+ */
+DWORD
+YoriLibPeImageCalculateChecksum(
+    __in PYORI_LIB_PE_IMAGE Image
+    )
+{
+    WORD Sum;
+    PWORD ExistingChecksum;
+
+    Sum = YoriLibPeImageSumBuffer(Image->Base, Image->FileSize);
+
+    //
+    //  The checksum field itself is not included in the checksum.  Rather
+    //  than splitting the buffer around it, subtract its two words from
+    //  the total with a borrow, matching the imagehlp implementation.
+    //
+
+    ExistingChecksum = (PWORD)&Image->PeHeaders->OptionalHeader.CheckSum;
+
+    Sum = (WORD)(Sum - (Sum < ExistingChecksum[0]));
+    Sum = (WORD)(Sum - ExistingChecksum[0]);
+    Sum = (WORD)(Sum - (Sum < ExistingChecksum[1]));
+    Sum = (WORD)(Sum - ExistingChecksum[1]);
+
+    return Sum + Image->FileSize;
+}
+
+/**
+ Calculate the checksum of a mapped PE file and store it in the PE header.
+ The image must have been opened for write.  If the header already contains
+ the correct checksum it is not written, so the file is left unmodified.
+
+ @param Image Pointer to the mapped image.
+
+ @return The checksum that was stored in the PE header.
+ */
+DWORD
+YoriLibPeImageUpdateChecksum(
+    __in PYORI_LIB_PE_IMAGE Image
+    )
+{
+    DWORD Checksum;
+
+    ASSERT(Image->Writable);
+    Checksum = YoriLibPeImageCalculateChecksum(Image);
+    if (Image->PeHeaders->OptionalHeader.CheckSum != Checksum) {
+        Image->PeHeaders->OptionalHeader.CheckSum = Checksum;
+    }
+    return Checksum;
+}
+
+// vim:sw=4:ts=4:et:
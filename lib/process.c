@@ -3,7 +3,7 @@
  *
  * Yori process enumeration support routines
  *
- * Copyright (c) 2018-2020 Malcolm J. Smith
+ * Copyright (c) 2018-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -153,4 +153,582 @@ YoriLibGetSystemHandlesList(
     return TRUE;
 }
 
+/**
+ A value used to terminate a chain of entries within a process snapshot.
+ */
+#define YORI_LIB_PROCESS_SNAPSHOT_END ((DWORD)-1)
+
+/**
+ Information about a single process within a process snapshot.  Each entry
+ is linked into three hash chains, so that processes can be found by
+ process ID, by image name, or by parent process ID without walking the
+ entire list.
+ */
+typedef struct _YORI_LIB_PROCESS_SNAPSHOT_ENTRY {
+
+    /**
+     Pointer to the information returned by the system for this process.
+     */
+    PYORI_SYSTEM_PROCESS_INFORMATION Process;
+
+    /**
+     The case insensitive hash of the image name of the process.
+     */
+    DWORD NameHash;
+
+    /**
+     The index of the next entry with the same process ID bucket.
+     */
+    DWORD NextById;
+
+    /**
+     The index of the next entry with the same image name bucket.
+     */
+    DWORD NextByName;
+
+    /**
+     The index of the next entry with the same parent process ID bucket.
+     */
+    DWORD NextByParent;
+
+} YORI_LIB_PROCESS_SNAPSHOT_ENTRY, *PYORI_LIB_PROCESS_SNAPSHOT_ENTRY;
+
+/**
+ A point in time capture of the processes in the system, indexed for
+ lookup.
+ */
+typedef struct _YORI_LIB_PROCESS_SNAPSHOT {
+
+    /**
+     The list of processes returned from the system.
+     */
+    PYORI_SYSTEM_PROCESS_INFORMATION ProcessList;
+
+    /**
+     The number of processes in the snapshot.
+     */
+    DWORD ProcessCount;
+
+    /**
+     The number of buckets in each index.
+     */
+    DWORD BucketCount;
+
+    /**
+     An array of ProcessCount entries, in the order returned by the system.
+     */
+    PYORI_LIB_PROCESS_SNAPSHOT_ENTRY Entries;
+
+    /**
+     An array of BucketCount entry indexes, hashed by process ID.
+     */
+    PDWORD IdBuckets;
+
+    /**
+     An array of BucketCount entry indexes, hashed by image name.
+     */
+    PDWORD NameBuckets;
+
+    /**
+     An array of BucketCount entry indexes, hashed by parent process ID.
+     */
+    PDWORD ParentBuckets;
+
+} YORI_LIB_PROCESS_SNAPSHOT;
+
+/**
+ Return the bucket for a process ID.  Process IDs are multiples of four, so
+ the low bits are discarded.
+
+ @param Snapshot Pointer to the process snapshot.
+
+ @param ProcessId The process ID.
+
+ @return The bucket index.
+ */
+DWORD
+YoriLibProcessSnapshotIdBucket(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in DWORD_PTR ProcessId
+    )
+{
+    return (DWORD)((ProcessId >> 2) % Snapshot->BucketCount);
+}
+
+/**
+ Capture the processes currently executing in the system and index them by
+ process ID, image name, and parent process ID.
+
+ @param Snapshot On successful completion, updated to point to the snapshot.
+        The caller should free this with @ref YoriLibFreeProcessSnapshot .
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibCreateProcessSnapshot(
+    __out PYORI_LIB_PROCESS_SNAPSHOT *Snapshot
+    )
+{
+    PYORI_LIB_PROCESS_SNAPSHOT LocalSnapshot;
+    PYORI_SYSTEM_PROCESS_INFORMATION ProcessList;
+    PYORI_SYSTEM_PROCESS_INFORMATION CurrentEntry;
+    PYORI_LIB_PROCESS_SNAPSHOT_ENTRY Entry;
+    YORI_STRING ImageName;
+    DWORD ProcessCount;
+    DWORD BucketCount;
+    DWORD Index;
+    DWORD Bucket;
+    DWORD SizeNeeded;
+
+    if (!YoriLibGetSystemProcessList(&ProcessList)) {
+        return FALSE;
+    }
+
+    ProcessCount = 0;
+    CurrentEntry = ProcessList;
+    do {
+        ProcessCount++;
+        if (CurrentEntry->NextEntryOffset == 0) {
+            break;
+        }
+        CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
+    } while(TRUE);
+
+    //
+    //  Keep chains short by having at least as many buckets as processes.
+    //  An odd number of buckets avoids clustering on names or IDs that
+    //  share low bits.
+    //
+
+    BucketCount = ProcessCount | 1;
+
+    SizeNeeded = sizeof(YORI_LIB_PROCESS_SNAPSHOT) +
+                 ProcessCount * sizeof(YORI_LIB_PROCESS_SNAPSHOT_ENTRY) +
+                 3 * BucketCount * sizeof(DWORD);
+
+    LocalSnapshot = YoriLibMalloc(SizeNeeded);
+    if (LocalSnapshot == NULL) {
+        YoriLibFree(ProcessList);
+        return FALSE;
+    }
+
+    LocalSnapshot->ProcessList = ProcessList;
+    LocalSnapshot->ProcessCount = ProcessCount;
+    LocalSnapshot->BucketCount = BucketCount;
+    LocalSnapshot->Entries = (PYORI_LIB_PROCESS_SNAPSHOT_ENTRY)(LocalSnapshot + 1);
+    LocalSnapshot->IdBuckets = (PDWORD)(LocalSnapshot->Entries + ProcessCount);
+    LocalSnapshot->NameBuckets = LocalSnapshot->IdBuckets + BucketCount;
+    LocalSnapshot->ParentBuckets = LocalSnapshot->NameBuckets + BucketCount;
+
+    for (Index = 0; Index < BucketCount; Index++) {
+        LocalSnapshot->IdBuckets[Index] = YORI_LIB_PROCESS_SNAPSHOT_END;
+        LocalSnapshot->NameBuckets[Index] = YORI_LIB_PROCESS_SNAPSHOT_END;
+        LocalSnapshot->ParentBuckets[Index] = YORI_LIB_PROCESS_SNAPSHOT_END;
+    }
+
+    CurrentEntry = ProcessList;
+    for (Index = 0; Index < ProcessCount; Index++) {
+        Entry = &LocalSnapshot->Entries[Index];
+        Entry->Process = CurrentEntry;
+
+        YoriLibInitEmptyString(&ImageName);
+        ImageName.StartOfString = CurrentEntry->ImageName;
+        ImageName.LengthInChars = CurrentEntry->ImageNameLengthInBytes / sizeof(WCHAR);
+        Entry->NameHash = YoriLibHashString32(0, &ImageName);
+
+        CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
+    }
+
+    //
+    //  Insert in reverse order so that each chain is in the order returned
+    //  by the system.
+    //
+
+    for (Index = ProcessCount; Index > 0; Index--) {
+        Entry = &LocalSnapshot->Entries[Index - 1];
+
+        Bucket = YoriLibProcessSnapshotIdBucket(LocalSnapshot, Entry->Process->ProcessId);
+        Entry->NextById = LocalSnapshot->IdBuckets[Bucket];
+        LocalSnapshot->IdBuckets[Bucket] = Index - 1;
+
+        Bucket = Entry->NameHash % BucketCount;
+        Entry->NextByName = LocalSnapshot->NameBuckets[Bucket];
+        LocalSnapshot->NameBuckets[Bucket] = Index - 1;
+
+        Bucket = YoriLibProcessSnapshotIdBucket(LocalSnapshot, Entry->Process->ParentProcessId);
+        Entry->NextByParent = LocalSnapshot->ParentBuckets[Bucket];
+        LocalSnapshot->ParentBuckets[Bucket] = Index - 1;
+    }
+
+    *Snapshot = LocalSnapshot;
+    return TRUE;
+}
+
+/**
+ Free a process snapshot.
+
+ @param Snapshot Pointer to the snapshot to free.
+ */
+VOID
+YoriLibFreeProcessSnapshot(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot
+    )
+{
+    YoriLibFree(Snapshot->ProcessList);
+    YoriLibFree(Snapshot);
+}
+
+/**
+ Return the index of the entry for a process ID within a snapshot.
+
+ @param Snapshot Pointer to the snapshot.
+
+ @param ProcessId The process ID to find.
+
+ @return The index of the entry, or YORI_LIB_PROCESS_SNAPSHOT_END if the
+         process is not in the snapshot.
+ */
+DWORD
+YoriLibProcessSnapshotFindIndexById(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in DWORD_PTR ProcessId
+    )
+{
+    DWORD Index;
+
+    Index = Snapshot->IdBuckets[YoriLibProcessSnapshotIdBucket(Snapshot, ProcessId)];
+    while (Index != YORI_LIB_PROCESS_SNAPSHOT_END) {
+        if (Snapshot->Entries[Index].Process->ProcessId == ProcessId) {
+            break;
+        }
+        Index = Snapshot->Entries[Index].NextById;
+    }
+
+    return Index;
+}
+
+/**
+ Find a process within a snapshot by its process ID.
+
+ @param Snapshot Pointer to the snapshot.
+
+ @param ProcessId The process ID to find.
+
+ @return Pointer to the process information, or NULL if the process is not
+         in the snapshot.  This remains valid until the snapshot is freed.
+ */
+PYORI_SYSTEM_PROCESS_INFORMATION
+YoriLibProcessSnapshotFindById(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in DWORD_PTR ProcessId
+    )
+{
+    DWORD Index;
+
+    Index = YoriLibProcessSnapshotFindIndexById(Snapshot, ProcessId);
+    if (Index == YORI_LIB_PROCESS_SNAPSHOT_END) {
+        return NULL;
+    }
+
+    return Snapshot->Entries[Index].Process;
+}
+
+/**
+ Invoke a callback for each process within a snapshot, in the order
+ returned by the system.
+
+ @param Snapshot Pointer to the snapshot.
+
+ @param Callback The function to invoke for each process.  If this returns
+        FALSE, enumeration stops.
+
+ @param Context Pointer to caller defined context to pass to the callback.
+
+ @return The number of processes for which the callback was invoked.
+ */
+DWORD
+YoriLibProcessSnapshotEnumerate(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in PYORILIB_PROCESS_ENUM_FN Callback,
+    __in_opt PVOID Context
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < Snapshot->ProcessCount; Index++) {
+        if (!Callback(Snapshot->Entries[Index].Process, Context)) {
+            Index++;
+            break;
+        }
+    }
+
+    return Index;
+}
+
+/**
+ Find the parent of a process within a snapshot.  Since process IDs can be
+ reused, a process is only considered the parent if it was created before
+ the child.
+
+ @param Snapshot Pointer to the snapshot.
+
+ @param Process Pointer to the process whose parent should be found.
+
+ @return Pointer to the parent process information, or NULL if the parent
+         is no longer executing.
+ */
+PYORI_SYSTEM_PROCESS_INFORMATION
+YoriLibProcessSnapshotFindParent(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in PYORI_SYSTEM_PROCESS_INFORMATION Process
+    )
+{
+    PYORI_SYSTEM_PROCESS_INFORMATION Parent;
+
+    Parent = YoriLibProcessSnapshotFindById(Snapshot, Process->ParentProcessId);
+    if (Parent == NULL ||
+        Parent == Process ||
+        Parent->CreateTime.QuadPart > Process->CreateTime.QuadPart) {
+
+        return NULL;
+    }
+
+    return Parent;
+}
+
+/**
+ Invoke a callback for each process within a snapshot whose image name
+ matches a specified name, without regard to case.
+
+ @param Snapshot Pointer to the snapshot.
+
+ @param ImageName The image name to find.
+
+ @param Callback The function to invoke for each matching process.  If this
+        returns FALSE, enumeration stops.
+
+ @param Context Pointer to caller defined context to pass to the callback.
+
+ @return The number of processes for which the callback was invoked.
+ */
+DWORD
+YoriLibProcessSnapshotEnumerateByName(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in PCYORI_STRING ImageName,
+    __in PYORILIB_PROCESS_ENUM_FN Callback,
+    __in_opt PVOID Context
+    )
+{
+    PYORI_LIB_PROCESS_SNAPSHOT_ENTRY Entry;
+    YORI_STRING EntryName;
+    DWORD Hash;
+    DWORD Index;
+    DWORD Count;
+
+    Hash = YoriLibHashString32(0, ImageName);
+    Count = 0;
+    YoriLibInitEmptyString(&EntryName);
+
+    Index = Snapshot->NameBuckets[Hash % Snapshot->BucketCount];
+    while (Index != YORI_LIB_PROCESS_SNAPSHOT_END) {
+        Entry = &Snapshot->Entries[Index];
+        EntryName.StartOfString = Entry->Process->ImageName;
+        EntryName.LengthInChars = Entry->Process->ImageNameLengthInBytes / sizeof(WCHAR);
+
+        if (Entry->NameHash == Hash &&
+            EntryName.LengthInChars == ImageName->LengthInChars &&
+            YoriLibCompareStringInsensitive(&EntryName, ImageName) == 0) {
+
+            Count++;
+            if (!Callback(Entry->Process, Context)) {
+                break;
+            }
+        }
+
+        Index = Entry->NextByName;
+    }
+
+    return Count;
+}
+
+/**
+ Invoke a callback for each direct child of a process within a snapshot.
+ Since process IDs can be reused, a process is only considered a child if
+ it was created after the parent.  If the parent is not in the snapshot,
+ every process that refers to its process ID is treated as a child.
+
+ @param Snapshot Pointer to the snapshot.
+
+ @param ParentProcessId The process ID of the parent.
+
+ @param Callback The function to invoke for each child.  If this returns
+        FALSE, enumeration stops.
+
+ @param Context Pointer to caller defined context to pass to the callback.
+
+ @return The number of processes for which the callback was invoked.
+ */
+DWORD
+YoriLibProcessSnapshotEnumerateChildren(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in DWORD_PTR ParentProcessId,
+    __in PYORILIB_PROCESS_ENUM_FN Callback,
+    __in_opt PVOID Context
+    )
+{
+    PYORI_SYSTEM_PROCESS_INFORMATION Parent;
+    PYORI_LIB_PROCESS_SNAPSHOT_ENTRY Entry;
+    DWORD Index;
+    DWORD Count;
+
+    Parent = YoriLibProcessSnapshotFindById(Snapshot, ParentProcessId);
+    Count = 0;
+
+    Index = Snapshot->ParentBuckets[YoriLibProcessSnapshotIdBucket(Snapshot, ParentProcessId)];
+    while (Index != YORI_LIB_PROCESS_SNAPSHOT_END) {
+        Entry = &Snapshot->Entries[Index];
+        if (Entry->Process->ParentProcessId == ParentProcessId &&
+            Entry->Process != Parent &&
+            (Parent == NULL ||
+             Entry->Process->CreateTime.QuadPart >= Parent->CreateTime.QuadPart)) {
+
+            Count++;
+            if (!Callback(Entry->Process, Context)) {
+                break;
+            }
+        }
+        Index = Entry->NextByParent;
+    }
+
+    return Count;
+}
+
+/**
+ Add the unvisited children of a process to the queue used when walking a
+ process tree.
+
+ @param Snapshot Pointer to the snapshot.
+
+ @param ParentProcessId The process ID of the parent.
+
+ @param Parent Optionally points to the parent process information.  If
+        present, only processes created after the parent are considered to
+        be children.
+
+ @param Queue Pointer to an array of entry indexes to visit.
+
+ @param QueueTail Pointer to the index of the next free slot in Queue.  On
+        completion, updated to include any children added.
+
+ @param Visited Pointer to an array indicating which entries have already
+        been added to the queue.
+ */
+VOID
+YoriLibProcessSnapshotQueueChildren(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in DWORD_PTR ParentProcessId,
+    __in_opt PYORI_SYSTEM_PROCESS_INFORMATION Parent,
+    __inout PDWORD Queue,
+    __inout PDWORD QueueTail,
+    __inout PUCHAR Visited
+    )
+{
+    PYORI_LIB_PROCESS_SNAPSHOT_ENTRY Entry;
+    DWORD Index;
+
+    Index = Snapshot->ParentBuckets[YoriLibProcessSnapshotIdBucket(Snapshot, ParentProcessId)];
+    while (Index != YORI_LIB_PROCESS_SNAPSHOT_END) {
+        Entry = &Snapshot->Entries[Index];
+        if (!Visited[Index] &&
+            Entry->Process->ParentProcessId == ParentProcessId &&
+            (Parent == NULL ||
+             Entry->Process->CreateTime.QuadPart >= Parent->CreateTime.QuadPart)) {
+
+            Visited[Index] = TRUE;
+            Queue[*QueueTail] = Index;
+            (*QueueTail)++;
+        }
+        Index = Entry->NextByParent;
+    }
+}
+
+/**
+ Invoke a callback for a process and all of its descendants within a
+ snapshot.  Each process is visited before any of its children.  Processes
+ are validated as in @ref YoriLibProcessSnapshotEnumerateChildren , and each
+ process is visited at most once.
+
+ @param Snapshot Pointer to the snapshot.
+
+ @param RootProcessId The process ID of the root of the tree.  If this
+        process is not in the snapshot, its surviving descendants are still
+        visited.
+
+ @param Callback The function to invoke for each process.  If this returns
+        FALSE, enumeration stops.
+
+ @param Context Pointer to caller defined context to pass to the callback.
+
+ @return The number of processes for which the callback was invoked, or
+         (DWORD)-1 if memory could not be allocated.
+ */
+DWORD
+YoriLibProcessSnapshotEnumerateTree(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in DWORD_PTR RootProcessId,
+    __in PYORILIB_PROCESS_ENUM_FN Callback,
+    __in_opt PVOID Context
+    )
+{
+    PYORI_SYSTEM_PROCESS_INFORMATION Process;
+    PDWORD Queue;
+    PUCHAR Visited;
+    DWORD QueueHead;
+    DWORD QueueTail;
+    DWORD Index;
+    DWORD Count;
+
+    Queue = YoriLibMalloc(Snapshot->ProcessCount * (sizeof(DWORD) + sizeof(UCHAR)));
+    if (Queue == NULL) {
+        return (DWORD)-1;
+    }
+    Visited = (PUCHAR)(Queue + Snapshot->ProcessCount);
+    ZeroMemory(Visited, Snapshot->ProcessCount);
+
+    //
+    //  Walk the tree breadth first.  The queue contains entry indexes and
+    //  each entry is queued at most once, so it never needs more slots
+    //  than there are processes.  If the root no longer exists, start with
+    //  its children.
+    //
+
+    QueueHead = 0;
+    QueueTail = 0;
+    Count = 0;
+
+    Index = YoriLibProcessSnapshotFindIndexById(Snapshot, RootProcessId);
+    if (Index != YORI_LIB_PROCESS_SNAPSHOT_END) {
+        Visited[Index] = TRUE;
+        Queue[QueueTail] = Index;
+        QueueTail++;
+    } else {
+        YoriLibProcessSnapshotQueueChildren(Snapshot, RootProcessId, NULL, Queue, &QueueTail, Visited);
+    }
+
+    while (QueueHead < QueueTail) {
+        Process = Snapshot->Entries[Queue[QueueHead]].Process;
+        QueueHead++;
+        Count++;
+        if (!Callback(Process, Context)) {
+            break;
+        }
+
+        YoriLibProcessSnapshotQueueChildren(Snapshot, Process->ProcessId, Process, Queue, &QueueTail, Visited);
+    }
+
+    YoriLibFree(Queue);
+    return Count;
+}
+
 // vim:sw=4:ts=4:et:
@@ -0,0 +1,3180 @@
+/**
+ * @file lib/regex.c
+ *
+ * Yori regular expression engine
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+
+//
+//  Expressions are parsed into a tree, and the tree is converted into a
+//  nondeterministic automaton where each pattern ends in its own match node.
+//  Matching is performed by a deterministic automaton whose states are sets
+//  of nondeterministic nodes.  These states are constructed on demand as
+//  characters are encountered and cached, so text is processed with one
+//  table lookup per character once the relevant states exist.  Characters
+//  are grouped into classes which no pattern distinguishes between, so each
+//  state only needs a transition for each class rather than each character.
+//  Case insensitivity is resolved when sets are built, so matching never
+//  needs to fold case.
+//
+//  Each pattern is also compiled in reverse, so that a match can be found
+//  by scanning backwards.  Finding the leftmost match scans forward to find
+//  where matches end, then backwards to find where the earliest one starts,
+//  so every character is examined a bounded number of times.
+//
+
+/**
+ An index indicating no node.
+ */
+#define YORI_LIB_REGEX_NO_INDEX ((DWORD)-1)
+
+/**
+ A repetition maximum indicating no upper bound.
+ */
+#define YORI_LIB_REGEX_INFINITE ((DWORD)-1)
+
+/**
+ The largest count that can be specified in a bounded repetition.
+ */
+#define YORI_LIB_REGEX_MAX_REPEAT (1000)
+
+/**
+ The deepest nesting of groups that an expression can contain.
+ */
+#define YORI_LIB_REGEX_MAX_DEPTH (256)
+
+/**
+ The largest number of automaton nodes that a compiled expression can
+ contain.
+ */
+#define YORI_LIB_REGEX_MAX_NODES (0x100000)
+
+/**
+ The number of deterministic states that can be cached.  When this is
+ exceeded the cache is discarded and states are constructed again as needed,
+ so pathological expressions use bounded memory.
+ */
+#define YORI_LIB_REGEX_MAX_STATES (2048)
+
+/**
+ The number of hash buckets used to find cached states.  This must be a
+ power of two.
+ */
+#define YORI_LIB_REGEX_STATE_BUCKETS (1024)
+
+/**
+ The number of bytes in a bitmap with one bit for every character.
+ */
+#define YORI_LIB_REGEX_BITMAP_SIZE (0x10000 / 8)
+
+/**
+ A range of characters, inclusive.
+ */
+typedef struct _YORI_LIB_REGEX_RANGE {
+
+    /**
+     The first character in the range.
+     */
+    TCHAR Low;
+
+    /**
+     The last character in the range.
+     */
+    TCHAR High;
+} YORI_LIB_REGEX_RANGE, *PYORI_LIB_REGEX_RANGE;
+
+/**
+ A set of characters, described as sorted, non-overlapping ranges.
+ */
+typedef struct _YORI_LIB_REGEX_SET {
+
+    /**
+     The number of ranges in the set.
+     */
+    DWORD RangeCount;
+
+    /**
+     An array of ranges.
+     */
+    PYORI_LIB_REGEX_RANGE Ranges;
+} YORI_LIB_REGEX_SET, *PYORI_LIB_REGEX_SET;
+
+/**
+ The types of element in a parsed expression.
+ */
+typedef enum _YORI_LIB_REGEX_AST_TYPE {
+    YoriLibRegexAstEmpty = 0,
+    YoriLibRegexAstSet = 1,
+    YoriLibRegexAstConcat = 2,
+    YoriLibRegexAstAlternate = 3,
+    YoriLibRegexAstRepeat = 4,
+    YoriLibRegexAstLineStart = 5,
+    YoriLibRegexAstLineEnd = 6
+} YORI_LIB_REGEX_AST_TYPE;
+
+/**
+ An element in a parsed expression.
+ */
+typedef struct _YORI_LIB_REGEX_AST {
+
+    /**
+     The type of the element.
+     */
+    YORI_LIB_REGEX_AST_TYPE Type;
+
+    /**
+     For concatenation or alternation, the first operand.  For repetition,
+     the element being repeated.
+     */
+    struct _YORI_LIB_REGEX_AST *Left;
+
+    /**
+     For concatenation or alternation, the second operand.
+     */
+    struct _YORI_LIB_REGEX_AST *Right;
+
+    /**
+     For repetition, the minimum number of repeats.
+     */
+    DWORD Min;
+
+    /**
+     For repetition, the maximum number of repeats, or
+     YORI_LIB_REGEX_INFINITE.
+     */
+    DWORD Max;
+
+    /**
+     For a set, the index of the set within the compiled expression.
+     */
+    DWORD SetIndex;
+} YORI_LIB_REGEX_AST, *PYORI_LIB_REGEX_AST;
+
+/**
+ The types of node in the nondeterministic automaton.
+ */
+typedef enum _YORI_LIB_REGEX_NODE_TYPE {
+    YoriLibRegexNodeSet = 1,
+    YoriLibRegexNodeSplit = 2,
+    YoriLibRegexNodeLineStart = 3,
+    YoriLibRegexNodeLineEnd = 4,
+    YoriLibRegexNodeMatch = 5
+} YORI_LIB_REGEX_NODE_TYPE;
+
+/**
+ A node in the nondeterministic automaton.
+ */
+typedef struct _YORI_LIB_REGEX_NODE {
+
+    /**
+     The type of the node.
+     */
+    YORI_LIB_REGEX_NODE_TYPE Type;
+
+    /**
+     The node to move to after consuming a character in the set, or the
+     first alternative of a split, or the node following an assertion.
+     */
+    DWORD Next;
+
+    /**
+     The second alternative of a split.
+     */
+    DWORD Alt;
+
+    /**
+     For a set node, the index of the set.  For a match node, the index of
+     the pattern that has matched.
+     */
+    DWORD Index;
+} YORI_LIB_REGEX_NODE, *PYORI_LIB_REGEX_NODE;
+
+/**
+ A deterministic state, consisting of a set of nondeterministic nodes.  The
+ state, its node array, its accept masks and its transitions are a single
+ allocation.
+ */
+typedef struct _YORI_LIB_REGEX_STATE {
+
+    /**
+     The next state in the same hash bucket.
+     */
+    struct _YORI_LIB_REGEX_STATE *HashNext;
+
+    /**
+     Transitions to the next state for each character class.  A NULL entry
+     indicates the transition has not been constructed yet.
+     */
+    struct _YORI_LIB_REGEX_STATE **Transitions;
+
+    /**
+     The sorted array of nondeterministic nodes in this state.  This
+     contains nodes which consume characters, match nodes, and end of line
+     assertions which cannot be resolved until the end of text is known.
+     */
+    PDWORD Nodes;
+
+    /**
+     A bitmask of patterns which have matched upon entering this state.
+     */
+    PDWORD Accept;
+
+    /**
+     A bitmask of patterns which have matched if the text ends in this
+     state.
+     */
+    PDWORD EndAccept;
+
+    /**
+     The hash of the node array.
+     */
+    DWORD Hash;
+
+    /**
+     The number of elements in the Nodes array.
+     */
+    DWORD NodeCount;
+
+    /**
+     TRUE if the state was constructed at the start of text, where start of
+     line assertions are satisfied.
+     */
+    BOOLEAN AtStart;
+
+    /**
+     TRUE if this is the state of an unanchored forward search with no
+     partial match in progress.  In this state, characters which cannot
+     start a match can be skipped, since consuming them returns to this
+     state.
+     */
+    BOOLEAN Idle;
+
+    /**
+     TRUE if no further match is possible from this state.
+     */
+    BOOLEAN Dead;
+
+    /**
+     TRUE if any bit is set in Accept.
+     */
+    BOOLEAN Accepting;
+
+    /**
+     TRUE if any bit is set in EndAccept.
+     */
+    BOOLEAN EndAccepting;
+} YORI_LIB_REGEX_STATE, *PYORI_LIB_REGEX_STATE;
+
+/**
+ A compiled set of regular expressions.
+ */
+typedef struct _YORI_LIB_REGEX {
+
+    /**
+     The number of patterns in the expression.
+     */
+    DWORD PatternCount;
+
+    /**
+     The number of DWORDs in a bitmask of patterns.
+     */
+    DWORD MaskWords;
+
+    /**
+     The number of nodes in the Nodes array.
+     */
+    DWORD NodeCount;
+
+    /**
+     The number of nodes allocated in the Nodes array.
+     */
+    DWORD NodesAllocated;
+
+    /**
+     The nodes of the nondeterministic automaton.
+     */
+    PYORI_LIB_REGEX_NODE Nodes;
+
+    /**
+     The number of sets in the Sets array.
+     */
+    DWORD SetCount;
+
+    /**
+     The number of sets allocated in the Sets array.
+     */
+    DWORD SetsAllocated;
+
+    /**
+     Character sets referenced by set nodes.
+     */
+    PYORI_LIB_REGEX_SET Sets;
+
+    /**
+     The node to begin a match that must start at a specific position.
+     */
+    DWORD AnchoredRoot;
+
+    /**
+     The node to begin a match that can start at any position.
+     */
+    DWORD UnanchoredRoot;
+
+    /**
+     The node which consumes any character to allow an unanchored match to
+     start at a later position.
+     */
+    DWORD AnyNode;
+
+    /**
+     The node to begin a reverse match that can end at any position.  The
+     reverse automaton accepts at each position where a match starts.
+     */
+    DWORD ReverseUnanchoredRoot;
+
+    /**
+     The node which consumes any character to allow a reverse match to
+     begin at an earlier position.
+     */
+    DWORD ReverseAnyNode;
+
+    /**
+     The number of character classes.
+     */
+    DWORD ClassCount;
+
+    /**
+     The first character in each class.  Classes are contiguous, so a
+     character belongs to the last class whose first character is less than
+     or equal to it.
+     */
+    PTCHAR ClassStart;
+
+    /**
+     The class for each of the first 256 characters.
+     */
+    DWORD ClassTable[256];
+
+    /**
+     TRUE for each of the first 256 characters which can begin a match.
+     */
+    BOOLEAN FirstChar[256];
+
+    /**
+     TRUE if any character above 255 can begin a match.
+     */
+    BOOLEAN FirstCharHigh;
+
+    /**
+     TRUE if the expression was compiled to match without regard to case.
+     */
+    BOOLEAN Insensitive;
+
+    /**
+     During compilation of a case insensitive expression, the upper case
+     form of every character.
+     */
+    PTCHAR FoldTable;
+
+    /**
+     The number of cached states.
+     */
+    DWORD StateCount;
+
+    /**
+     Hash buckets of cached states.
+     */
+    PYORI_LIB_REGEX_STATE StateBuckets[YORI_LIB_REGEX_STATE_BUCKETS];
+
+    /**
+     Cached initial states, indexed by whether the search is unanchored and
+     whether it begins at the start of the text.
+     */
+    PYORI_LIB_REGEX_STATE StartStates[2][2];
+
+    /**
+     Cached initial states of an unanchored reverse search, indexed by
+     whether the search begins at the end of the text.
+     */
+    PYORI_LIB_REGEX_STATE ReverseStartStates[2];
+
+    /**
+     The generation used to mark nodes visited while computing a closure.
+     */
+    DWORD MarkGeneration;
+
+    /**
+     For each node, the generation in which it was last visited.
+     */
+    PDWORD Marks;
+
+    /**
+     Scratch space for nodes pending a visit while computing a closure.
+     */
+    PDWORD Stack;
+
+    /**
+     Scratch space for nodes reached by consuming a character.
+     */
+    PDWORD Targets;
+
+    /**
+     Scratch space for the nodes of a state being constructed.
+     */
+    PDWORD ClosureNodes;
+
+    /**
+     Scratch space for the nodes reached at the end of text.
+     */
+    PDWORD EndNodes;
+
+    /**
+     The nodes of the state of an unanchored forward search with no partial
+     match in progress.  Any state with these nodes is marked Idle.
+     */
+    PDWORD IdleNodes;
+
+    /**
+     The number of elements in the IdleNodes array.
+     */
+    DWORD IdleNodeCount;
+} YORI_LIB_REGEX;
+
+/**
+ State used while parsing a pattern.
+ */
+typedef struct _YORI_LIB_REGEX_PARSER {
+
+    /**
+     The expression being compiled.
+     */
+    PYORI_LIB_REGEX Regex;
+
+    /**
+     The pattern being parsed.
+     */
+    PCYORI_STRING Pattern;
+
+    /**
+     The current offset within the pattern.
+     */
+    DWORD Offset;
+
+    /**
+     The current depth of nested groups.
+     */
+    DWORD Depth;
+
+    /**
+     Set to TRUE if a syntax error has been found.
+     */
+    BOOLEAN Error;
+
+    /**
+     Scratch space for building a set of characters.
+     */
+    PUCHAR Bitmap;
+
+    /**
+     Scratch space for folding a set of characters.
+     */
+    PUCHAR FoldBitmap;
+} YORI_LIB_REGEX_PARSER, *PYORI_LIB_REGEX_PARSER;
+
+/**
+ Word characters, for \\w.
+ */
+CONST YORI_LIB_REGEX_RANGE YoriLibRegexWordRanges[] = {
+    {'0', '9'},
+    {'A', 'Z'},
+    {'_', '_'},
+    {'a', 'z'}
+};
+
+/**
+ Digit characters, for \\d.
+ */
+CONST YORI_LIB_REGEX_RANGE YoriLibRegexDigitRanges[] = {
+    {'0', '9'}
+};
+
+/**
+ White space characters, for \\s.
+ */
+CONST YORI_LIB_REGEX_RANGE YoriLibRegexSpaceRanges[] = {
+    {'\t', '\r'},
+    {' ', ' '}
+};
+
+/**
+ Add a range of characters to a bitmap.
+
+ @param Bitmap Pointer to the bitmap.
+
+ @param Low The first character in the range.
+
+ @param High The last character in the range.
+ */
+VOID
+YoriLibRegexBitmapAddRange(
+    __inout PUCHAR Bitmap,
+    __in DWORD Low,
+    __in DWORD High
+    )
+{
+    DWORD Char;
+
+    for (Char = Low; Char <= High; Char++) {
+        Bitmap[Char / 8] = (UCHAR)(Bitmap[Char / 8] | (1 << (Char % 8)));
+    }
+}
+
+/**
+ Check whether a character is present in a bitmap.
+
+ @param Bitmap Pointer to the bitmap.
+
+ @param Char The character to check.
+
+ @return TRUE if the character is present, FALSE if it is not.
+ */
+BOOLEAN
+YoriLibRegexBitmapTest(
+    __in PUCHAR Bitmap,
+    __in DWORD Char
+    )
+{
+    if (Bitmap[Char / 8] & (1 << (Char % 8))) {
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ Add a set of predefined ranges to a bitmap, or add every character that is
+ not within the predefined ranges.
+
+ @param Bitmap Pointer to the bitmap.
+
+ @param Ranges Pointer to an array of sorted ranges.
+
+ @param RangeCount The number of elements in the Ranges array.
+
+ @param Negate If TRUE, add the characters not described by the ranges.
+ */
+VOID
+YoriLibRegexBitmapAddRanges(
+    __inout PUCHAR Bitmap,
+    __in_ecount(RangeCount) CONST YORI_LIB_REGEX_RANGE *Ranges,
+    __in DWORD RangeCount,
+    __in BOOLEAN Negate
+    )
+{
+    DWORD Index;
+    DWORD Low;
+
+    if (!Negate) {
+        for (Index = 0; Index < RangeCount; Index++) {
+            YoriLibRegexBitmapAddRange(Bitmap, Ranges[Index].Low, Ranges[Index].High);
+        }
+        return;
+    }
+
+    Low = 0;
+    for (Index = 0; Index < RangeCount; Index++) {
+        if (Ranges[Index].Low > Low) {
+            YoriLibRegexBitmapAddRange(Bitmap, Low, Ranges[Index].Low - 1);
+        }
+        Low = Ranges[Index].High + 1;
+    }
+
+    if (Low <= 0xFFFF) {
+        YoriLibRegexBitmapAddRange(Bitmap, Low, 0xFFFF);
+    }
+}
+
+/**
+ Add a new set to a compiled expression.  The caller populates the ranges.
+
+ @param Regex Pointer to the expression.
+
+ @param RangeCount The number of ranges to allocate.
+
+ @return The index of the new set, or YORI_LIB_REGEX_NO_INDEX on allocation
+         failure.
+ */
+DWORD
+YoriLibRegexAllocateSet(
+    __inout PYORI_LIB_REGEX Regex,
+    __in DWORD RangeCount
+    )
+{
+    PYORI_LIB_REGEX_SET NewSets;
+    PYORI_LIB_REGEX_SET Set;
+    DWORD NewAllocated;
+
+    if (Regex->SetCount == Regex->SetsAllocated) {
+        NewAllocated = Regex->SetsAllocated * 2;
+        if (NewAllocated == 0) {
+            NewAllocated = 16;
+        }
+
+        NewSets = YoriLibMalloc(NewAllocated * sizeof(YORI_LIB_REGEX_SET));
+        if (NewSets == NULL) {
+            return YORI_LIB_REGEX_NO_INDEX;
+        }
+
+        if (Regex->Sets != NULL) {
+            memcpy(NewSets, Regex->Sets, Regex->SetCount * sizeof(YORI_LIB_REGEX_SET));
+            YoriLibFree(Regex->Sets);
+        }
+        Regex->Sets = NewSets;
+        Regex->SetsAllocated = NewAllocated;
+    }
+
+    Set = &Regex->Sets[Regex->SetCount];
+    Set->RangeCount = RangeCount;
+    Set->Ranges = YoriLibMalloc((RangeCount + 1) * sizeof(YORI_LIB_REGEX_RANGE));
+    if (Set->Ranges == NULL) {
+        return YORI_LIB_REGEX_NO_INDEX;
+    }
+
+    Regex->SetCount++;
+    return Regex->SetCount - 1;
+}
+
+/**
+ Add a new set to a compiled expression containing a single range.
+
+ @param Regex Pointer to the expression.
+
+ @param Low The first character in the range.
+
+ @param High The last character in the range.
+
+ @return The index of the new set, or YORI_LIB_REGEX_NO_INDEX on allocation
+         failure.
+ */
+DWORD
+YoriLibRegexAddSetFromRange(
+    __inout PYORI_LIB_REGEX Regex,
+    __in TCHAR Low,
+    __in TCHAR High
+    )
+{
+    DWORD SetIndex;
+
+    SetIndex = YoriLibRegexAllocateSet(Regex, 1);
+    if (SetIndex != YORI_LIB_REGEX_NO_INDEX) {
+        Regex->Sets[SetIndex].Ranges[0].Low = Low;
+        Regex->Sets[SetIndex].Ranges[0].High = High;
+    }
+    return SetIndex;
+}
+
+/**
+ Add a new set to a compiled expression containing the characters in a
+ bitmap.
+
+ @param Regex Pointer to the expression.
+
+ @param Bitmap Pointer to the bitmap.
+
+ @return The index of the new set, or YORI_LIB_REGEX_NO_INDEX on allocation
+         failure.
+ */
+DWORD
+YoriLibRegexAddSetFromBitmap(
+    __inout PYORI_LIB_REGEX Regex,
+    __in PUCHAR Bitmap
+    )
+{
+    PYORI_LIB_REGEX_SET Set;
+    DWORD SetIndex;
+    DWORD RangeCount;
+    DWORD Char;
+    BOOLEAN InRange;
+
+    RangeCount = 0;
+    InRange = FALSE;
+    for (Char = 0; Char <= 0xFFFF; Char++) {
+        if (YoriLibRegexBitmapTest(Bitmap, Char)) {
+            if (!InRange) {
+                RangeCount++;
+                InRange = TRUE;
+            }
+        } else {
+            InRange = FALSE;
+        }
+    }
+
+    SetIndex = YoriLibRegexAllocateSet(Regex, RangeCount);
+    if (SetIndex == YORI_LIB_REGEX_NO_INDEX) {
+        return SetIndex;
+    }
+
+    Set = &Regex->Sets[SetIndex];
+    RangeCount = 0;
+    InRange = FALSE;
+    for (Char = 0; Char <= 0xFFFF; Char++) {
+        if (YoriLibRegexBitmapTest(Bitmap, Char)) {
+            if (!InRange) {
+                Set->Ranges[RangeCount].Low = (TCHAR)Char;
+                RangeCount++;
+                InRange = TRUE;
+            }
+            Set->Ranges[RangeCount - 1].High = (TCHAR)Char;
+        } else {
+            InRange = FALSE;
+        }
+    }
+
+    return SetIndex;
+}
+
+/**
+ Check whether a character is within a set.
+
+ @param Set Pointer to the set.
+
+ @param Char The character to check.
+
+ @return TRUE if the character is within the set, FALSE if it is not.
+ */
+BOOLEAN
+YoriLibRegexSetContains(
+    __in PYORI_LIB_REGEX_SET Set,
+    __in TCHAR Char
+    )
+{
+    DWORD Low;
+    DWORD High;
+    DWORD Mid;
+
+    Low = 0;
+    High = Set->RangeCount;
+    while (Low < High) {
+        Mid = (Low + High) / 2;
+        if (Char < Set->Ranges[Mid].Low) {
+            High = Mid;
+        } else if (Char > Set->Ranges[Mid].High) {
+            Low = Mid + 1;
+        } else {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ Allocate a new element of a parsed expression.
+
+ @param Type The type of the element.
+
+ @return Pointer to the element, or NULL on allocation failure.
+ */
+PYORI_LIB_REGEX_AST
+YoriLibRegexAllocateAst(
+    __in YORI_LIB_REGEX_AST_TYPE Type
+    )
+{
+    PYORI_LIB_REGEX_AST Ast;
+
+    Ast = YoriLibMalloc(sizeof(YORI_LIB_REGEX_AST));
+    if (Ast == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Ast, sizeof(YORI_LIB_REGEX_AST));
+    Ast->Type = Type;
+    Ast->SetIndex = YORI_LIB_REGEX_NO_INDEX;
+    return Ast;
+}
+
+/**
+ Free a parsed expression.  Concatenations are parsed with the longest chain
+ on the left, so the left side is followed iteratively to avoid recursing
+ once per character of the pattern.
+
+ @param Ast Pointer to the root element of the expression.
+ */
+VOID
+YoriLibRegexFreeAst(
+    __in_opt PYORI_LIB_REGEX_AST Ast
+    )
+{
+    PYORI_LIB_REGEX_AST Next;
+
+    while (Ast != NULL) {
+        if (Ast->Right != NULL) {
+            YoriLibRegexFreeAst(Ast->Right);
+        }
+        Next = Ast->Left;
+        YoriLibFree(Ast);
+        Ast = Next;
+    }
+}
+
+/**
+ Combine two elements into a concatenation or alternation.  On failure,
+ both elements are freed.
+
+ @param Type The type of element to create.
+
+ @param Left Pointer to the first operand.
+
+ @param Right Pointer to the second operand.
+
+ @return Pointer to the combined element, or NULL on allocation failure.
+ */
+PYORI_LIB_REGEX_AST
+YoriLibRegexCombineAst(
+    __in YORI_LIB_REGEX_AST_TYPE Type,
+    __in PYORI_LIB_REGEX_AST Left,
+    __in PYORI_LIB_REGEX_AST Right
+    )
+{
+    PYORI_LIB_REGEX_AST Ast;
+
+    Ast = YoriLibRegexAllocateAst(Type);
+    if (Ast == NULL) {
+        YoriLibRegexFreeAst(Left);
+        YoriLibRegexFreeAst(Right);
+        return NULL;
+    }
+
+    Ast->Left = Left;
+    Ast->Right = Right;
+    return Ast;
+}
+
+/**
+ Convert the characters in the parser's bitmap into a set element, applying
+ case insensitivity and negation.  For a case insensitive expression, the set
+ is expanded to every character whose upper case form is the upper case form
+ of a character in the set, so that matching does not need to fold case.
+
+ @param Parser Pointer to the parser.
+
+ @param Negate If TRUE, the set should contain every character not in the
+        bitmap.
+
+ @return Pointer to the element, or NULL on allocation failure.
+ */
+PYORI_LIB_REGEX_AST
+YoriLibRegexFinishSet(
+    __inout PYORI_LIB_REGEX_PARSER Parser,
+    __in BOOLEAN Negate
+    )
+{
+    PYORI_LIB_REGEX Regex;
+    PYORI_LIB_REGEX_AST Ast;
+    DWORD Char;
+
+    Regex = Parser->Regex;
+    if (Regex->Insensitive) {
+        ZeroMemory(Parser->FoldBitmap, YORI_LIB_REGEX_BITMAP_SIZE);
+        for (Char = 0; Char <= 0xFFFF; Char++) {
+            if (YoriLibRegexBitmapTest(Parser->Bitmap, Char)) {
+                YoriLibRegexBitmapAddRange(Parser->FoldBitmap, Regex->FoldTable[Char], Regex->FoldTable[Char]);
+            }
+        }
+        for (Char = 0; Char <= 0xFFFF; Char++) {
+            if (YoriLibRegexBitmapTest(Parser->FoldBitmap, Regex->FoldTable[Char])) {
+                YoriLibRegexBitmapAddRange(Parser->Bitmap, Char, Char);
+            }
+        }
+    }
+
+    if (Negate) {
+        for (Char = 0; Char < YORI_LIB_REGEX_BITMAP_SIZE; Char++) {
+            Parser->Bitmap[Char] = (UCHAR)~Parser->Bitmap[Char];
+        }
+    }
+
+    Ast = YoriLibRegexAllocateAst(YoriLibRegexAstSet);
+    if (Ast == NULL) {
+        return NULL;
+    }
+
+    Ast->SetIndex = YoriLibRegexAddSetFromBitmap(Regex, Parser->Bitmap);
+    if (Ast->SetIndex == YORI_LIB_REGEX_NO_INDEX) {
+        YoriLibFree(Ast);
+        return NULL;
+    }
+
+    return Ast;
+}
+
+/**
+ Create an element matching a single literal character.
+
+ @param Parser Pointer to the parser.
+
+ @param Char The character to match.
+
+ @return Pointer to the element, or NULL on allocation failure.
+ */
+PYORI_LIB_REGEX_AST
+YoriLibRegexLiteralAst(
+    __inout PYORI_LIB_REGEX_PARSER Parser,
+    __in TCHAR Char
+    )
+{
+    PYORI_LIB_REGEX_AST Ast;
+
+    if (Parser->Regex->Insensitive) {
+        ZeroMemory(Parser->Bitmap, YORI_LIB_REGEX_BITMAP_SIZE);
+        YoriLibRegexBitmapAddRange(Parser->Bitmap, Char, Char);
+        return YoriLibRegexFinishSet(Parser, FALSE);
+    }
+
+    Ast = YoriLibRegexAllocateAst(YoriLibRegexAstSet);
+    if (Ast == NULL) {
+        return NULL;
+    }
+
+    Ast->SetIndex = YoriLibRegexAddSetFromRange(Parser->Regex, Char, Char);
+    if (Ast->SetIndex == YORI_LIB_REGEX_NO_INDEX) {
+        YoriLibFree(Ast);
+        return NULL;
+    }
+
+    return Ast;
+}
+
+/**
+ If a character following a backslash describes a class of characters, add
+ the class to a bitmap.
+
+ @param Bitmap Pointer to the bitmap.
+
+ @param Char The character following the backslash.
+
+ @return TRUE if the character describes a class, FALSE if it does not.
+ */
+BOOLEAN
+YoriLibRegexAddEscapedClass(
+    __inout PUCHAR Bitmap,
+    __in TCHAR Char
+    )
+{
+    switch(Char) {
+        case 'd':
+        case 'D':
+            YoriLibRegexBitmapAddRanges(Bitmap, YoriLibRegexDigitRanges, sizeof(YoriLibRegexDigitRanges)/sizeof(YoriLibRegexDigitRanges[0]), (BOOLEAN)(Char == 'D'));
+            return TRUE;
+        case 'w':
+        case 'W':
+            YoriLibRegexBitmapAddRanges(Bitmap, YoriLibRegexWordRanges, sizeof(YoriLibRegexWordRanges)/sizeof(YoriLibRegexWordRanges[0]), (BOOLEAN)(Char == 'W'));
+            return TRUE;
+        case 's':
+        case 'S':
+            YoriLibRegexBitmapAddRanges(Bitmap, YoriLibRegexSpaceRanges, sizeof(YoriLibRegexSpaceRanges)/sizeof(YoriLibRegexSpaceRanges[0]), (BOOLEAN)(Char == 'S'));
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Parse a character following a backslash which describes a single
+ character.  On entry, the parser offset refers to the character following
+ the backslash.  On successful completion, it is advanced beyond the escape.
+
+ @param Parser Pointer to the parser.
+
+ @param Char On successful completion, updated to contain the character.
+
+ @return TRUE to indicate success, FALSE if the escape is invalid.
+ */
+__success(return)
+BOOLEAN
+YoriLibRegexParseEscapedChar(
+    __inout PYORI_LIB_REGEX_PARSER Parser,
+    __out PTCHAR Char
+    )
+{
+    PCYORI_STRING Pattern;
+    DWORD Digits;
+    DWORD Index;
+    DWORD Value;
+    TCHAR Digit;
+
+    Pattern = Parser->Pattern;
+    if (Parser->Offset >= Pattern->LengthInChars) {
+        return FALSE;
+    }
+
+    Digits = 0;
+    switch(Pattern->StartOfString[Parser->Offset]) {
+        case 't':
+            *Char = '\t';
+            break;
+        case 'n':
+            *Char = '\n';
+            break;
+        case 'r':
+            *Char = '\r';
+            break;
+        case 'f':
+            *Char = '\f';
+            break;
+        case 'v':
+            *Char = '\v';
+            break;
+        case 'x':
+            Digits = 2;
+            break;
+        case 'u':
+            Digits = 4;
+            break;
+        default:
+            *Char = Pattern->StartOfString[Parser->Offset];
+            break;
+    }
+    Parser->Offset++;
+
+    if (Digits == 0) {
+        return TRUE;
+    }
+
+    if (Parser->Offset + Digits > Pattern->LengthInChars) {
+        return FALSE;
+    }
+
+    Value = 0;
+    for (Index = 0; Index < Digits; Index++) {
+        Digit = Pattern->StartOfString[Parser->Offset + Index];
+        if (Digit >= '0' && Digit <= '9') {
+            Value = Value * 16 + Digit - '0';
+        } else if (Digit >= 'a' && Digit <= 'f') {
+            Value = Value * 16 + Digit - 'a' + 10;
+        } else if (Digit >= 'A' && Digit <= 'F') {
+            Value = Value * 16 + Digit - 'A' + 10;
+        } else {
+            return FALSE;
+        }
+    }
+
+    Parser->Offset += Digits;
+    *Char = (TCHAR)Value;
+    return TRUE;
+}
+
+/**
+ Parse a bracketed class of characters.  On entry, the parser offset refers
+ to the opening bracket.
+
+ @param Parser Pointer to the parser.
+
+ @return Pointer to the element, or NULL on failure.
+ */
+PYORI_LIB_REGEX_AST
+YoriLibRegexParseClass(
+    __inout PYORI_LIB_REGEX_PARSER Parser
+    )
+{
+    PCYORI_STRING Pattern;
+    BOOLEAN Negate;
+    BOOLEAN First;
+    TCHAR Low;
+    TCHAR High;
+
+    Pattern = Parser->Pattern;
+    Parser->Offset++;
+    Negate = FALSE;
+    if (Parser->Offset < Pattern->LengthInChars &&
+        Pattern->StartOfString[Parser->Offset] == '^') {
+
+        Negate = TRUE;
+        Parser->Offset++;
+    }
+
+    ZeroMemory(Parser->Bitmap, YORI_LIB_REGEX_BITMAP_SIZE);
+    First = TRUE;
+
+    while (TRUE) {
+        if (Parser->Offset >= Pattern->LengthInChars) {
+            Parser->Error = TRUE;
+            return NULL;
+        }
+
+        Low = Pattern->StartOfString[Parser->Offset];
+        if (Low == ']' && !First) {
+            Parser->Offset++;
+            break;
+        }
+        First = FALSE;
+
+        if (Low == '\\') {
+            Parser->Offset++;
+            if (Parser->Offset < Pattern->LengthInChars &&
+                YoriLibRegexAddEscapedClass(Parser->Bitmap, Pattern->StartOfString[Parser->Offset])) {
+
+                Parser->Offset++;
+                continue;
+            }
+            if (!YoriLibRegexParseEscapedChar(Parser, &Low)) {
+                Parser->Error = TRUE;
+                return NULL;
+            }
+        } else {
+            Parser->Offset++;
+        }
+
+        //
+        //  A hyphen describes a range unless it is the last character in
+        //  the class.
+        //
+
+        High = Low;
+        if (Parser->Offset + 1 < Pattern->LengthInChars &&
+            Pattern->StartOfString[Parser->Offset] == '-' &&
+            Pattern->StartOfString[Parser->Offset + 1] != ']') {
+
+            Parser->Offset++;
+            High = Pattern->StartOfString[Parser->Offset];
+            if (High == '\\') {
+                Parser->Offset++;
+                if (!YoriLibRegexParseEscapedChar(Parser, &High)) {
+                    Parser->Error = TRUE;
+                    return NULL;
+                }
+            } else {
+                Parser->Offset++;
+            }
+
+            if (High < Low) {
+                Parser->Error = TRUE;
+                return NULL;
+            }
+        }
+
+        YoriLibRegexBitmapAddRange(Parser->Bitmap, Low, High);
+    }
+
+    return YoriLibRegexFinishSet(Parser, Negate);
+}
+
+/**
+ Parse a decimal number within a bounded repetition.
+
+ @param Pattern Pointer to the pattern.
+
+ @param Offset Pointer to the offset within the pattern.  On successful
+        completion, updated to refer to the character after the number.
+
+ @param Value On successful completion, updated to contain the number.
+
+ @return TRUE if a number was found, FALSE if not.
+ */
+__success(return)
+BOOLEAN
+YoriLibRegexParseCount(
+    __in PCYORI_STRING Pattern,
+    __inout PDWORD Offset,
+    __out PDWORD Value
+    )
+{
+    DWORD Index;
+    DWORD Result;
+
+    Result = 0;
+    for (Index = *Offset; Index < Pattern->LengthInChars; Index++) {
+        if (Pattern->StartOfString[Index] < '0' || Pattern->StartOfString[Index] > '9') {
+            break;
+        }
+        Result = Result * 10 + Pattern->StartOfString[Index] - '0';
+        if (Result > YORI_LIB_REGEX_MAX_REPEAT) {
+            Result = YORI_LIB_REGEX_MAX_REPEAT + 1;
+        }
+    }
+
+    if (Index == *Offset) {
+        return FALSE;
+    }
+
+    *Offset = Index;
+    *Value = Result;
+    return TRUE;
+}
+
+/**
+ Parse a bounded repetition, in the form {n}, {n,} or {n,m}.  On entry, the
+ parser offset refers to the opening brace.  If the text does not describe a
+ repetition, the brace is treated as a literal and the offset is not
+ changed.
+
+ @param Parser Pointer to the parser.
+
+ @param Min On successful completion, the minimum number of repeats.
+
+ @param Max On successful completion, the maximum number of repeats.
+
+ @return TRUE if a repetition was parsed, FALSE if not.  If the repetition
+         is malformed, the parser's error flag is set.
+ */
+__success(return)
+BOOLEAN
+YoriLibRegexParseBounds(
+    __inout PYORI_LIB_REGEX_PARSER Parser,
+    __out PDWORD Min,
+    __out PDWORD Max
+    )
+{
+    PCYORI_STRING Pattern;
+    DWORD Offset;
+    DWORD Low;
+    DWORD High;
+
+    Pattern = Parser->Pattern;
+    Offset = Parser->Offset + 1;
+    if (!YoriLibRegexParseCount(Pattern, &Offset, &Low)) {
+        return FALSE;
+    }
+
+    High = Low;
+    if (Offset < Pattern->LengthInChars && Pattern->StartOfString[Offset] == ',') {
+        Offset++;
+        if (!YoriLibRegexParseCount(Pattern, &Offset, &High)) {
+            High = YORI_LIB_REGEX_INFINITE;
+        }
+    }
+
+    if (Offset >= Pattern->LengthInChars || Pattern->StartOfString[Offset] != '}') {
+        return FALSE;
+    }
+
+    if (Low > YORI_LIB_REGEX_MAX_REPEAT ||
+        (High != YORI_LIB_REGEX_INFINITE && (High > YORI_LIB_REGEX_MAX_REPEAT || High < Low))) {
+
+        Parser->Error = TRUE;
+        return FALSE;
+    }
+
+    Parser->Offset = Offset + 1;
+    *Min = Low;
+    *Max = High;
+    return TRUE;
+}
+
+PYORI_LIB_REGEX_AST
+YoriLibRegexParseAlternate(
+    __inout PYORI_LIB_REGEX_PARSER Parser
+    );
+
+/**
+ Parse a single element of an expression, which is a character, class,
+ group or assertion.
+
+ @param Parser Pointer to the parser.
+
+ @return Pointer to the element, or NULL on failure.
+ */
+PYORI_LIB_REGEX_AST
+YoriLibRegexParseAtom(
+    __inout PYORI_LIB_REGEX_PARSER Parser
+    )
+{
+    PCYORI_STRING Pattern;
+    PYORI_LIB_REGEX_AST Ast;
+    TCHAR Char;
+
+    Pattern = Parser->Pattern;
+    Char = Pattern->StartOfString[Parser->Offset];
+
+    switch(Char) {
+        case '(':
+            Parser->Offset++;
+            if (Parser->Offset + 1 < Pattern->LengthInChars &&
+                Pattern->StartOfString[Parser->Offset] == '?' &&
+                Pattern->StartOfString[Parser->Offset + 1] == ':') {
+
+                Parser->Offset += 2;
+            }
+
+            if (Parser->Depth >= YORI_LIB_REGEX_MAX_DEPTH) {
+                Parser->Error = TRUE;
+                return NULL;
+            }
+
+            Parser->Depth++;
+            Ast = YoriLibRegexParseAlternate(Parser);
+            Parser->Depth--;
+            if (Ast == NULL) {
+                return NULL;
+            }
+
+            if (Parser->Offset >= Pattern->LengthInChars ||
+                Pattern->StartOfString[Parser->Offset] != ')') {
+
+                YoriLibRegexFreeAst(Ast);
+                Parser->Error = TRUE;
+                return NULL;
+            }
+            Parser->Offset++;
+            return Ast;
+
+        case '[':
+            return YoriLibRegexParseClass(Parser);
+
+        case '.':
+            Parser->Offset++;
+            ZeroMemory(Parser->Bitmap, YORI_LIB_REGEX_BITMAP_SIZE);
+            YoriLibRegexBitmapAddRange(Parser->Bitmap, 0, '\n' - 1);
+            YoriLibRegexBitmapAddRange(Parser->Bitmap, '\n' + 1, 0xFFFF);
+            return YoriLibRegexFinishSet(Parser, FALSE);
+
+        case '^':
+            Parser->Offset++;
+            return YoriLibRegexAllocateAst(YoriLibRegexAstLineStart);
+
+        case '$':
+            Parser->Offset++;
+            return YoriLibRegexAllocateAst(YoriLibRegexAstLineEnd);
+
+        case '\\':
+            Parser->Offset++;
+            if (Parser->Offset < Pattern->LengthInChars) {
+                ZeroMemory(Parser->Bitmap, YORI_LIB_REGEX_BITMAP_SIZE);
+                if (YoriLibRegexAddEscapedClass(Parser->Bitmap, Pattern->StartOfString[Parser->Offset])) {
+                    Parser->Offset++;
+                    return YoriLibRegexFinishSet(Parser, FALSE);
+                }
+            }
+            if (!YoriLibRegexParseEscapedChar(Parser, &Char)) {
+                Parser->Error = TRUE;
+                return NULL;
+            }
+            return YoriLibRegexLiteralAst(Parser, Char);
+
+        case '*':
+        case '+':
+        case '?':
+            Parser->Error = TRUE;
+            return NULL;
+    }
+
+    Parser->Offset++;
+    return YoriLibRegexLiteralAst(Parser, Char);
+}
+
+/**
+ Parse an element of an expression followed by any repetition operators.
+
+ @param Parser Pointer to the parser.
+
+ @return Pointer to the element, or NULL on failure.
+ */
+PYORI_LIB_REGEX_AST
+YoriLibRegexParseRepeat(
+    __inout PYORI_LIB_REGEX_PARSER Parser
+    )
+{
+    PCYORI_STRING Pattern;
+    PYORI_LIB_REGEX_AST Atom;
+    PYORI_LIB_REGEX_AST Repeat;
+    DWORD Min;
+    DWORD Max;
+    TCHAR Char;
+
+    Pattern = Parser->Pattern;
+    Atom = YoriLibRegexParseAtom(Parser);
+    if (Atom == NULL) {
+        return NULL;
+    }
+
+    while (Parser->Offset < Pattern->LengthInChars) {
+        Char = Pattern->StartOfString[Parser->Offset];
+        if (Char == '*') {
+            Min = 0;
+            Max = YORI_LIB_REGEX_INFINITE;
+            Parser->Offset++;
+        } else if (Char == '+') {
+            Min = 1;
+            Max = YORI_LIB_REGEX_INFINITE;
+            Parser->Offset++;
+        } else if (Char == '?') {
+            Min = 0;
+            Max = 1;
+            Parser->Offset++;
+        } else if (Char == '{' && YoriLibRegexParseBounds(Parser, &Min, &Max)) {
+        } else {
+            break;
+        }
+
+        Repeat = YoriLibRegexAllocateAst(YoriLibRegexAstRepeat);
+        if (Repeat == NULL) {
+            YoriLibRegexFreeAst(Atom);
+            return NULL;
+        }
+
+        Repeat->Left = Atom;
+        Repeat->Min = Min;
+        Repeat->Max = Max;
+        Atom = Repeat;
+    }
+
+    if (Parser->Error) {
+        YoriLibRegexFreeAst(Atom);
+        return NULL;
+    }
+
+    return Atom;
+}
+
+/**
+ Parse a sequence of elements up to the end of a group or alternative.
+
+ @param Parser Pointer to the parser.
+
+ @return Pointer to the element, or NULL on failure.
+ */
+PYORI_LIB_REGEX_AST
+YoriLibRegexParseConcat(
+    __inout PYORI_LIB_REGEX_PARSER Parser
+    )
+{
+    PCYORI_STRING Pattern;
+    PYORI_LIB_REGEX_AST Result;
+    PYORI_LIB_REGEX_AST Atom;
+    TCHAR Char;
+
+    Pattern = Parser->Pattern;
+    Result = NULL;
+    while (Parser->Offset < Pattern->LengthInChars) {
+        Char = Pattern->StartOfString[Parser->Offset];
+        if (Char == '|' || Char == ')') {
+            break;
+        }
+
+        Atom = YoriLibRegexParseRepeat(Parser);
+        if (Atom == NULL) {
+            YoriLibRegexFreeAst(Result);
+            return NULL;
+        }
+
+        if (Result == NULL) {
+            Result = Atom;
+        } else {
+            Result = YoriLibRegexCombineAst(YoriLibRegexAstConcat, Result, Atom);
+            if (Result == NULL) {
+                return NULL;
+            }
+        }
+    }
+
+    if (Result == NULL) {
+        Result = YoriLibRegexAllocateAst(YoriLibRegexAstEmpty);
+    }
+
+    return Result;
+}
+
+/**
+ Parse a set of alternatives separated by vertical bars.
+
+ @param Parser Pointer to the parser.
+
+ @return Pointer to the element, or NULL on failure.
+ */
+PYORI_LIB_REGEX_AST
+YoriLibRegexParseAlternate(
+    __inout PYORI_LIB_REGEX_PARSER Parser
+    )
+{
+    PCYORI_STRING Pattern;
+    PYORI_LIB_REGEX_AST Result;
+    PYORI_LIB_REGEX_AST Alternative;
+
+    Pattern = Parser->Pattern;
+    Result = YoriLibRegexParseConcat(Parser);
+    if (Result == NULL) {
+        return NULL;
+    }
+
+    while (Parser->Offset < Pattern->LengthInChars &&
+           Pattern->StartOfString[Parser->Offset] == '|') {
+
+        Parser->Offset++;
+        Alternative = YoriLibRegexParseConcat(Parser);
+        if (Alternative == NULL) {
+            YoriLibRegexFreeAst(Result);
+            return NULL;
+        }
+
+        Result = YoriLibRegexCombineAst(YoriLibRegexAstAlternate, Result, Alternative);
+        if (Result == NULL) {
+            return NULL;
+        }
+    }
+
+    return Result;
+}
+
+/**
+ Parse a pattern which contains literal text only.
+
+ @param Parser Pointer to the parser.
+
+ @return Pointer to the element, or NULL on failure.
+ */
+PYORI_LIB_REGEX_AST
+YoriLibRegexParseLiteral(
+    __inout PYORI_LIB_REGEX_PARSER Parser
+    )
+{
+    PCYORI_STRING Pattern;
+    PYORI_LIB_REGEX_AST Result;
+    PYORI_LIB_REGEX_AST Atom;
+
+    Pattern = Parser->Pattern;
+    Result = YoriLibRegexAllocateAst(YoriLibRegexAstEmpty);
+    if (Result == NULL) {
+        return NULL;
+    }
+
+    for (Parser->Offset = 0; Parser->Offset < Pattern->LengthInChars; Parser->Offset++) {
+        Atom = YoriLibRegexLiteralAst(Parser, Pattern->StartOfString[Parser->Offset]);
+        if (Atom == NULL) {
+            YoriLibRegexFreeAst(Result);
+            return NULL;
+        }
+
+        Result = YoriLibRegexCombineAst(YoriLibRegexAstConcat, Result, Atom);
+        if (Result == NULL) {
+            return NULL;
+        }
+    }
+
+    return Result;
+}
+
+/**
+ Add a node to the nondeterministic automaton.
+
+ @param Regex Pointer to the expression.
+
+ @param Type The type of the node.
+
+ @param Next The node that follows this one.
+
+ @param Alt For a split, the second node that follows this one.
+
+ @param Index For a set node, the index of the set.  For a match node, the
+        index of the pattern.
+
+ @return The index of the new node, or YORI_LIB_REGEX_NO_INDEX on failure.
+ */
+DWORD
+YoriLibRegexAddNode(
+    __inout PYORI_LIB_REGEX Regex,
+    __in YORI_LIB_REGEX_NODE_TYPE Type,
+    __in DWORD Next,
+    __in DWORD Alt,
+    __in DWORD Index
+    )
+{
+    PYORI_LIB_REGEX_NODE NewNodes;
+    PYORI_LIB_REGEX_NODE Node;
+    DWORD NewAllocated;
+
+    if (Regex->NodeCount == Regex->NodesAllocated) {
+        if (Regex->NodesAllocated >= YORI_LIB_REGEX_MAX_NODES) {
+            return YORI_LIB_REGEX_NO_INDEX;
+        }
+
+        NewAllocated = Regex->NodesAllocated * 2;
+        if (NewAllocated == 0) {
+            NewAllocated = 64;
+        }
+
+        NewNodes = YoriLibMalloc(NewAllocated * sizeof(YORI_LIB_REGEX_NODE));
+        if (NewNodes == NULL) {
+            return YORI_LIB_REGEX_NO_INDEX;
+        }
+
+        if (Regex->Nodes != NULL) {
+            memcpy(NewNodes, Regex->Nodes, Regex->NodeCount * sizeof(YORI_LIB_REGEX_NODE));
+            YoriLibFree(Regex->Nodes);
+        }
+        Regex->Nodes = NewNodes;
+        Regex->NodesAllocated = NewAllocated;
+    }
+
+    Node = &Regex->Nodes[Regex->NodeCount];
+    Node->Type = Type;
+    Node->Next = Next;
+    Node->Alt = Alt;
+    Node->Index = Index;
+    Regex->NodeCount++;
+    return Regex->NodeCount - 1;
+}
+
+DWORD
+YoriLibRegexCompileAst(
+    __inout PYORI_LIB_REGEX Regex,
+    __in PYORI_LIB_REGEX_AST Ast,
+    __in DWORD Next,
+    __in BOOLEAN Reverse
+    );
+
+/**
+ Convert a chain of concatenated elements into nodes of a reverse automaton,
+ which matches the elements from last to first.  Concatenation chains nest
+ through their first operand, so the chain is collected into an array to
+ allow the first element to be compiled first without recursing through the
+ length of the chain.
+
+ @param Regex Pointer to the expression.
+
+ @param Ast Pointer to the concatenation to compile.
+
+ @param Next The node to move to after the chain has matched.
+
+ @return The node to begin matching the chain, or YORI_LIB_REGEX_NO_INDEX on
+         failure.
+ */
+DWORD
+YoriLibRegexCompileReverseConcat(
+    __inout PYORI_LIB_REGEX Regex,
+    __in PYORI_LIB_REGEX_AST Ast,
+    __in DWORD Next
+    )
+{
+    PYORI_LIB_REGEX_AST *Chain;
+    PYORI_LIB_REGEX_AST Element;
+    DWORD Count;
+    DWORD Index;
+
+    Count = 0;
+    for (Element = Ast; Element->Type == YoriLibRegexAstConcat; Element = Element->Left) {
+        Count++;
+    }
+
+    Chain = YoriLibMalloc(Count * sizeof(PYORI_LIB_REGEX_AST));
+    if (Chain == NULL) {
+        return YORI_LIB_REGEX_NO_INDEX;
+    }
+
+    Index = Count;
+    for (Element = Ast; Element->Type == YoriLibRegexAstConcat; Element = Element->Left) {
+        Index--;
+        Chain[Index] = Element;
+    }
+
+    Next = YoriLibRegexCompileAst(Regex, Element, Next, TRUE);
+    for (Index = 0; Index < Count && Next != YORI_LIB_REGEX_NO_INDEX; Index++) {
+        Next = YoriLibRegexCompileAst(Regex, Chain[Index]->Right, Next, TRUE);
+    }
+
+    YoriLibFree(Chain);
+    return Next;
+}
+
+/**
+ Convert a parsed expression into nodes of the nondeterministic automaton.
+ Nodes are constructed from the end of the expression towards the start, so
+ each element is compiled knowing the node that follows it.  Chains of
+ concatenation and alternation are processed iteratively, so recursion is
+ bounded by the nesting of groups and repetitions.
+
+ @param Regex Pointer to the expression.
+
+ @param Ast Pointer to the parsed element to compile.
+
+ @param Next The node to move to after the element has matched.
+
+ @param Reverse TRUE to construct an automaton which matches the element
+        from its end to its start, FALSE to match it from start to end.  In
+        a reverse automaton, start of line assertions are satisfied at the
+        end of the scan and end of line assertions at the start.
+
+ @return The node to begin matching the element, or YORI_LIB_REGEX_NO_INDEX
+         on failure.
+ */
+DWORD
+YoriLibRegexCompileAst(
+    __inout PYORI_LIB_REGEX Regex,
+    __in PYORI_LIB_REGEX_AST Ast,
+    __in DWORD Next,
+    __in BOOLEAN Reverse
+    )
+{
+    DWORD FirstSplit;
+    DWORD LastSplit;
+    DWORD Split;
+    DWORD Entry;
+    DWORD Body;
+    DWORD Count;
+
+    FirstSplit = YORI_LIB_REGEX_NO_INDEX;
+    LastSplit = YORI_LIB_REGEX_NO_INDEX;
+
+    while (TRUE) {
+        if (Ast->Type == YoriLibRegexAstConcat && !Reverse) {
+            Next = YoriLibRegexCompileAst(Regex, Ast->Right, Next, FALSE);
+            if (Next == YORI_LIB_REGEX_NO_INDEX) {
+                return YORI_LIB_REGEX_NO_INDEX;
+            }
+            Ast = Ast->Left;
+        } else if (Ast->Type == YoriLibRegexAstAlternate) {
+            Entry = YoriLibRegexCompileAst(Regex, Ast->Right, Next, Reverse);
+            if (Entry == YORI_LIB_REGEX_NO_INDEX) {
+                return YORI_LIB_REGEX_NO_INDEX;
+            }
+            Split = YoriLibRegexAddNode(Regex, YoriLibRegexNodeSplit, YORI_LIB_REGEX_NO_INDEX, Entry, 0);
+            if (Split == YORI_LIB_REGEX_NO_INDEX) {
+                return YORI_LIB_REGEX_NO_INDEX;
+            }
+            if (LastSplit == YORI_LIB_REGEX_NO_INDEX) {
+                FirstSplit = Split;
+            } else {
+                Regex->Nodes[LastSplit].Next = Split;
+            }
+            LastSplit = Split;
+            Ast = Ast->Left;
+        } else {
+            break;
+        }
+    }
+
+    switch(Ast->Type) {
+        case YoriLibRegexAstConcat:
+            Entry = YoriLibRegexCompileReverseConcat(Regex, Ast, Next);
+            break;
+        case YoriLibRegexAstSet:
+            Entry = YoriLibRegexAddNode(Regex, YoriLibRegexNodeSet, Next, YORI_LIB_REGEX_NO_INDEX, Ast->SetIndex);
+            break;
+        case YoriLibRegexAstLineStart:
+            Entry = YoriLibRegexAddNode(Regex, Reverse?YoriLibRegexNodeLineEnd:YoriLibRegexNodeLineStart, Next, YORI_LIB_REGEX_NO_INDEX, 0);
+            break;
+        case YoriLibRegexAstLineEnd:
+            Entry = YoriLibRegexAddNode(Regex, Reverse?YoriLibRegexNodeLineStart:YoriLibRegexNodeLineEnd, Next, YORI_LIB_REGEX_NO_INDEX, 0);
+            break;
+        case YoriLibRegexAstRepeat:
+
+            //
+            //  An unbounded repetition loops through a split.  A bounded
+            //  repetition is a chain of optional copies.  Either is
+            //  preceded by copies for the required minimum.
+            //
+
+            Entry = Next;
+            if (Ast->Max == YORI_LIB_REGEX_INFINITE) {
+                Split = YoriLibRegexAddNode(Regex, YoriLibRegexNodeSplit, YORI_LIB_REGEX_NO_INDEX, Next, 0);
+                if (Split == YORI_LIB_REGEX_NO_INDEX) {
+                    return YORI_LIB_REGEX_NO_INDEX;
+                }
+                Body = YoriLibRegexCompileAst(Regex, Ast->Left, Split, Reverse);
+                if (Body == YORI_LIB_REGEX_NO_INDEX) {
+                    return YORI_LIB_REGEX_NO_INDEX;
+                }
+                Regex->Nodes[Split].Next = Body;
+                Entry = Split;
+            } else {
+                for (Count = Ast->Min; Count < Ast->Max; Count++) {
+                    Body = YoriLibRegexCompileAst(Regex, Ast->Left, Entry, Reverse);
+                    if (Body == YORI_LIB_REGEX_NO_INDEX) {
+                        return YORI_LIB_REGEX_NO_INDEX;
+                    }
+                    Entry = YoriLibRegexAddNode(Regex, YoriLibRegexNodeSplit, Body, Next, 0);
+                    if (Entry == YORI_LIB_REGEX_NO_INDEX) {
+                        return YORI_LIB_REGEX_NO_INDEX;
+                    }
+                }
+            }
+
+            for (Count = 0; Count < Ast->Min; Count++) {
+                Entry = YoriLibRegexCompileAst(Regex, Ast->Left, Entry, Reverse);
+                if (Entry == YORI_LIB_REGEX_NO_INDEX) {
+                    return YORI_LIB_REGEX_NO_INDEX;
+                }
+            }
+            break;
+        default:
+            Entry = Next;
+            break;
+    }
+
+    if (Entry == YORI_LIB_REGEX_NO_INDEX) {
+        return YORI_LIB_REGEX_NO_INDEX;
+    }
+
+    if (LastSplit != YORI_LIB_REGEX_NO_INDEX) {
+        Regex->Nodes[LastSplit].Next = Entry;
+        return FirstSplit;
+    }
+
+    return Entry;
+}
+
+/**
+ Sort an array of node indexes.
+
+ @param Nodes Pointer to the array.
+
+ @param Count The number of elements in the array.
+ */
+VOID
+YoriLibRegexSortNodes(
+    __inout_ecount(Count) PDWORD Nodes,
+    __in DWORD Count
+    )
+{
+    DWORD Gap;
+    DWORD Index;
+    DWORD Compare;
+    DWORD Value;
+
+    for (Gap = Count / 2; Gap > 0; Gap = Gap / 2) {
+        for (Index = Gap; Index < Count; Index++) {
+            Value = Nodes[Index];
+            for (Compare = Index; Compare >= Gap && Nodes[Compare - Gap] > Value; Compare -= Gap) {
+                Nodes[Compare] = Nodes[Compare - Gap];
+            }
+            Nodes[Compare] = Value;
+        }
+    }
+}
+
+/**
+ Find every node reachable from a set of nodes without consuming a
+ character.  The result contains nodes which consume characters, match
+ nodes, and end of line assertions which cannot yet be resolved.
+
+ @param Regex Pointer to the expression.
+
+ @param Input Pointer to the array of nodes to start from.
+
+ @param InputCount The number of elements in the Input array.
+
+ @param AtStart TRUE if the position is the start of text, allowing start of
+        line assertions to be satisfied.
+
+ @param AtEnd TRUE if the position is the end of text, allowing end of line
+        assertions to be satisfied.
+
+ @param Output Pointer to an array to receive the sorted set of nodes.  This
+        must have space for every node in the expression.
+
+ @return The number of nodes in the Output array.
+ */
+DWORD
+YoriLibRegexClosure(
+    __inout PYORI_LIB_REGEX Regex,
+    __in_ecount(InputCount) PDWORD Input,
+    __in DWORD InputCount,
+    __in BOOLEAN AtStart,
+    __in BOOLEAN AtEnd,
+    __out PDWORD Output
+    )
+{
+    PYORI_LIB_REGEX_NODE Node;
+    DWORD Generation;
+    DWORD Depth;
+    DWORD Count;
+    DWORD Index;
+    DWORD NodeIndex;
+
+    Regex->MarkGeneration++;
+    if (Regex->MarkGeneration == 0) {
+        ZeroMemory(Regex->Marks, Regex->NodeCount * sizeof(DWORD));
+        Regex->MarkGeneration = 1;
+    }
+    Generation = Regex->MarkGeneration;
+
+    Depth = 0;
+    for (Index = 0; Index < InputCount; Index++) {
+        NodeIndex = Input[Index];
+        if (Regex->Marks[NodeIndex] != Generation) {
+            Regex->Marks[NodeIndex] = Generation;
+            Regex->Stack[Depth++] = NodeIndex;
+        }
+    }
+
+    Count = 0;
+    while (Depth > 0) {
+        NodeIndex = Regex->Stack[--Depth];
+        Node = &Regex->Nodes[NodeIndex];
+
+        switch(Node->Type) {
+            case YoriLibRegexNodeSet:
+            case YoriLibRegexNodeMatch:
+                Output[Count++] = NodeIndex;
+                break;
+            case YoriLibRegexNodeSplit:
+                if (Regex->Marks[Node->Alt] != Generation) {
+                    Regex->Marks[Node->Alt] = Generation;
+                    Regex->Stack[Depth++] = Node->Alt;
+                }
+                if (Regex->Marks[Node->Next] != Generation) {
+                    Regex->Marks[Node->Next] = Generation;
+                    Regex->Stack[Depth++] = Node->Next;
+                }
+                break;
+            case YoriLibRegexNodeLineStart:
+                if (AtStart && Regex->Marks[Node->Next] != Generation) {
+                    Regex->Marks[Node->Next] = Generation;
+                    Regex->Stack[Depth++] = Node->Next;
+                }
+                break;
+            case YoriLibRegexNodeLineEnd:
+                if (!AtEnd) {
+                    Output[Count++] = NodeIndex;
+                } else if (Regex->Marks[Node->Next] != Generation) {
+                    Regex->Marks[Node->Next] = Generation;
+                    Regex->Stack[Depth++] = Node->Next;
+                }
+                break;
+        }
+    }
+
+    YoriLibRegexSortNodes(Output, Count);
+    return Count;
+}
+
+/**
+ Discard all cached deterministic states.
+
+ @param Regex Pointer to the expression.
+ */
+VOID
+YoriLibRegexFlushStates(
+    __inout PYORI_LIB_REGEX Regex
+    )
+{
+    PYORI_LIB_REGEX_STATE State;
+    PYORI_LIB_REGEX_STATE Next;
+    DWORD Index;
+
+    for (Index = 0; Index < YORI_LIB_REGEX_STATE_BUCKETS; Index++) {
+        State = Regex->StateBuckets[Index];
+        while (State != NULL) {
+            Next = State->HashNext;
+            YoriLibFree(State);
+            State = Next;
+        }
+        Regex->StateBuckets[Index] = NULL;
+    }
+
+    Regex->StartStates[0][0] = NULL;
+    Regex->StartStates[0][1] = NULL;
+    Regex->StartStates[1][0] = NULL;
+    Regex->StartStates[1][1] = NULL;
+    Regex->ReverseStartStates[0] = NULL;
+    Regex->ReverseStartStates[1] = NULL;
+    Regex->StateCount = 0;
+}
+
+/**
+ Find the cached state for a set of nodes, or construct one.
+
+ @param Regex Pointer to the expression.
+
+ @param Nodes Pointer to the sorted array of nodes.  This must not be the
+        Targets or EndNodes scratch buffer, which are used here.
+
+ @param NodeCount The number of elements in the Nodes array.
+
+ @param AtStart TRUE if the state is at the start of text.
+
+ @param Flushed On completion, set to TRUE if the cache was discarded to make
+        room for the new state, indicating any previously returned state is
+        no longer valid.
+
+ @return Pointer to the state, or NULL on allocation failure.
+ */
+PYORI_LIB_REGEX_STATE
+YoriLibRegexFindState(
+    __inout PYORI_LIB_REGEX Regex,
+    __in_ecount(NodeCount) PDWORD Nodes,
+    __in DWORD NodeCount,
+    __in BOOLEAN AtStart,
+    __out PBOOLEAN Flushed
+    )
+{
+    PYORI_LIB_REGEX_STATE State;
+    PYORI_LIB_REGEX_NODE Node;
+    DWORD Hash;
+    DWORD Bucket;
+    DWORD Index;
+    DWORD TargetCount;
+    DWORD EndCount;
+    DWORD PatternIndex;
+
+    *Flushed = FALSE;
+
+    Hash = AtStart;
+    for (Index = 0; Index < NodeCount; Index++) {
+        Hash = Hash * 31 + Nodes[Index];
+    }
+    Bucket = (Hash ^ (Hash >> 16)) & (YORI_LIB_REGEX_STATE_BUCKETS - 1);
+
+    for (State = Regex->StateBuckets[Bucket]; State != NULL; State = State->HashNext) {
+        if (State->Hash == Hash &&
+            State->AtStart == AtStart &&
+            State->NodeCount == NodeCount &&
+            memcmp(State->Nodes, Nodes, NodeCount * sizeof(DWORD)) == 0) {
+
+            return State;
+        }
+    }
+
+    if (Regex->StateCount >= YORI_LIB_REGEX_MAX_STATES) {
+        YoriLibRegexFlushStates(Regex);
+        *Flushed = TRUE;
+    }
+
+    State = YoriLibMalloc(sizeof(YORI_LIB_REGEX_STATE) +
+                          Regex->ClassCount * sizeof(PYORI_LIB_REGEX_STATE) +
+                          (NodeCount + 2 * Regex->MaskWords) * sizeof(DWORD));
+    if (State == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(State, sizeof(YORI_LIB_REGEX_STATE) +
+                      Regex->ClassCount * sizeof(PYORI_LIB_REGEX_STATE) +
+                      (NodeCount + 2 * Regex->MaskWords) * sizeof(DWORD));
+
+    State->Transitions = (PYORI_LIB_REGEX_STATE *)(State + 1);
+    State->Accept = (PDWORD)(State->Transitions + Regex->ClassCount);
+    State->EndAccept = State->Accept + Regex->MaskWords;
+    State->Nodes = State->EndAccept + Regex->MaskWords;
+    State->Hash = Hash;
+    State->NodeCount = NodeCount;
+    State->AtStart = AtStart;
+    State->Dead = (BOOLEAN)(NodeCount == 0);
+    memcpy(State->Nodes, Nodes, NodeCount * sizeof(DWORD));
+
+    //
+    //  The idle state is reached both when a search begins and whenever a
+    //  partial match fails, so it is recognized by its nodes rather than
+    //  by how it was reached.
+    //
+
+    if (!AtStart &&
+        NodeCount == Regex->IdleNodeCount &&
+        memcmp(Nodes, Regex->IdleNodes, NodeCount * sizeof(DWORD)) == 0) {
+
+        State->Idle = TRUE;
+    }
+
+    //
+    //  Record which patterns match on entering this state, and which match
+    //  if the text ends here, which is when pending end of line assertions
+    //  are satisfied.
+    //
+
+    TargetCount = 0;
+    for (Index = 0; Index < NodeCount; Index++) {
+        Node = &Regex->Nodes[Nodes[Index]];
+        if (Node->Type == YoriLibRegexNodeMatch) {
+            PatternIndex = Node->Index;
+            State->Accept[PatternIndex / 32] |= (1 << (PatternIndex % 32));
+            State->Accepting = TRUE;
+        } else if (Node->Type == YoriLibRegexNodeLineEnd) {
+            Regex->Targets[TargetCount++] = Node->Next;
+        }
+    }
+
+    memcpy(State->EndAccept, State->Accept, Regex->MaskWords * sizeof(DWORD));
+    State->EndAccepting = State->Accepting;
+
+    if (TargetCount > 0) {
+        EndCount = YoriLibRegexClosure(Regex, Regex->Targets, TargetCount, AtStart, TRUE, Regex->EndNodes);
+        for (Index = 0; Index < EndCount; Index++) {
+            Node = &Regex->Nodes[Regex->EndNodes[Index]];
+            if (Node->Type == YoriLibRegexNodeMatch) {
+                PatternIndex = Node->Index;
+                State->EndAccept[PatternIndex / 32] |= (1 << (PatternIndex % 32));
+                State->EndAccepting = TRUE;
+            }
+        }
+    }
+
+    State->HashNext = Regex->StateBuckets[Bucket];
+    Regex->StateBuckets[Bucket] = State;
+    Regex->StateCount++;
+
+    return State;
+}
+
+/**
+ Return the state to begin a search.
+
+ @param Regex Pointer to the expression.
+
+ @param Unanchored TRUE if the match can begin at any position, FALSE if it
+        must begin at the position where the search starts.
+
+ @param AtStart TRUE if the search starts at the beginning of the text.
+
+ @return Pointer to the state, or NULL on allocation failure.
+ */
+PYORI_LIB_REGEX_STATE
+YoriLibRegexGetStartState(
+    __inout PYORI_LIB_REGEX Regex,
+    __in BOOLEAN Unanchored,
+    __in BOOLEAN AtStart
+    )
+{
+    PYORI_LIB_REGEX_STATE State;
+    DWORD Root;
+    DWORD Count;
+    BOOLEAN Flushed;
+
+    State = Regex->StartStates[Unanchored][AtStart];
+    if (State != NULL) {
+        return State;
+    }
+
+    if (Unanchored) {
+        Root = Regex->UnanchoredRoot;
+    } else {
+        Root = Regex->AnchoredRoot;
+    }
+
+    Count = YoriLibRegexClosure(Regex, &Root, 1, AtStart, FALSE, Regex->ClosureNodes);
+    State = YoriLibRegexFindState(Regex, Regex->ClosureNodes, Count, AtStart, &Flushed);
+    if (State == NULL) {
+        return NULL;
+    }
+
+    Regex->StartStates[Unanchored][AtStart] = State;
+    return State;
+}
+
+/**
+ Return the state to begin an unanchored reverse search, which scans
+ backwards through text and accepts at each position where a match starts.
+
+ @param Regex Pointer to the expression.
+
+ @param AtEnd TRUE if the search starts at the end of the text, where end of
+        line assertions are satisfied.
+
+ @return Pointer to the state, or NULL on allocation failure.
+ */
+PYORI_LIB_REGEX_STATE
+YoriLibRegexGetReverseStartState(
+    __inout PYORI_LIB_REGEX Regex,
+    __in BOOLEAN AtEnd
+    )
+{
+    PYORI_LIB_REGEX_STATE State;
+    DWORD Count;
+    BOOLEAN Flushed;
+
+    State = Regex->ReverseStartStates[AtEnd];
+    if (State != NULL) {
+        return State;
+    }
+
+    Count = YoriLibRegexClosure(Regex, &Regex->ReverseUnanchoredRoot, 1, AtEnd, FALSE, Regex->ClosureNodes);
+    State = YoriLibRegexFindState(Regex, Regex->ClosureNodes, Count, AtEnd, &Flushed);
+    if (State == NULL) {
+        return NULL;
+    }
+
+    Regex->ReverseStartStates[AtEnd] = State;
+    return State;
+}
+
+/**
+ Return a state equivalent to a state of an unanchored forward search, but
+ which does not begin new matches at later positions.  Continuing from this
+ state finds the end of every match which had started by the current
+ position.
+
+ @param Regex Pointer to the expression.
+
+ @param State Pointer to the state of an unanchored forward search.
+
+ @return Pointer to the state, or NULL on allocation failure.
+ */
+PYORI_LIB_REGEX_STATE
+YoriLibRegexStopStarting(
+    __inout PYORI_LIB_REGEX Regex,
+    __in PYORI_LIB_REGEX_STATE State
+    )
+{
+    DWORD Index;
+    DWORD Count;
+    BOOLEAN Flushed;
+
+    Count = 0;
+    for (Index = 0; Index < State->NodeCount; Index++) {
+        if (State->Nodes[Index] != Regex->AnyNode) {
+            Regex->ClosureNodes[Count++] = State->Nodes[Index];
+        }
+    }
+
+    return YoriLibRegexFindState(Regex, Regex->ClosureNodes, Count, State->AtStart, &Flushed);
+}
+
+/**
+ Return the character class containing a character.
+
+ @param Regex Pointer to the expression.
+
+ @param Char The character.
+
+ @return The index of the character class.
+ */
+DWORD
+YoriLibRegexClassOfChar(
+    __in PYORI_LIB_REGEX Regex,
+    __in TCHAR Char
+    )
+{
+    DWORD Low;
+    DWORD High;
+    DWORD Mid;
+
+    if (Char < 256) {
+        return Regex->ClassTable[Char];
+    }
+
+    Low = 0;
+    High = Regex->ClassCount;
+    while (High - Low > 1) {
+        Mid = (Low + High) / 2;
+        if (Regex->ClassStart[Mid] <= Char) {
+            Low = Mid;
+        } else {
+            High = Mid;
+        }
+    }
+
+    return Low;
+}
+
+/**
+ Move from one state to the next by consuming a character, constructing the
+ next state if it has not been encountered before.
+
+ @param Regex Pointer to the expression.
+
+ @param State Pointer to the current state.
+
+ @param Char The character to consume.
+
+ @return Pointer to the next state, or NULL on allocation failure.
+ */
+PYORI_LIB_REGEX_STATE
+YoriLibRegexStep(
+    __inout PYORI_LIB_REGEX Regex,
+    __in PYORI_LIB_REGEX_STATE State,
+    __in TCHAR Char
+    )
+{
+    PYORI_LIB_REGEX_STATE Next;
+    PYORI_LIB_REGEX_NODE Node;
+    DWORD Class;
+    DWORD Index;
+    DWORD TargetCount;
+    DWORD Count;
+    TCHAR Representative;
+    BOOLEAN Flushed;
+
+    Class = YoriLibRegexClassOfChar(Regex, Char);
+    Next = State->Transitions[Class];
+    if (Next != NULL) {
+        return Next;
+    }
+
+    //
+    //  Every character in a class behaves identically, so the transition is
+    //  computed for the first character of the class.
+    //
+
+    Representative = Regex->ClassStart[Class];
+    TargetCount = 0;
+    for (Index = 0; Index < State->NodeCount; Index++) {
+        Node = &Regex->Nodes[State->Nodes[Index]];
+        if (Node->Type == YoriLibRegexNodeSet &&
+            YoriLibRegexSetContains(&Regex->Sets[Node->Index], Representative)) {
+
+            Regex->Targets[TargetCount++] = Node->Next;
+        }
+    }
+
+    Count = YoriLibRegexClosure(Regex, Regex->Targets, TargetCount, FALSE, FALSE, Regex->ClosureNodes);
+    Next = YoriLibRegexFindState(Regex, Regex->ClosureNodes, Count, FALSE, &Flushed);
+    if (Next != NULL && !Flushed) {
+        State->Transitions[Class] = Next;
+    }
+
+    return Next;
+}
+
+/**
+ Return the lowest numbered pattern in a bitmask of patterns.
+
+ @param Regex Pointer to the expression.
+
+ @param Mask Pointer to the bitmask.
+
+ @return The index of the lowest pattern, or YORI_LIB_REGEX_NO_INDEX if no
+         pattern is in the mask.
+ */
+DWORD
+YoriLibRegexLowestPattern(
+    __in PYORI_LIB_REGEX Regex,
+    __in PDWORD Mask
+    )
+{
+    DWORD Word;
+    DWORD Bit;
+
+    for (Word = 0; Word < Regex->MaskWords; Word++) {
+        if (Mask[Word] != 0) {
+            for (Bit = 0; Bit < 32; Bit++) {
+                if (Mask[Word] & (1 << Bit)) {
+                    return Word * 32 + Bit;
+                }
+            }
+        }
+    }
+
+    return YORI_LIB_REGEX_NO_INDEX;
+}
+
+/**
+ Return TRUE if a character might begin a match.  Characters which return
+ FALSE can be skipped when no partial match is in progress.
+
+ @param Regex Pointer to the expression.
+
+ @param Char The character.
+
+ @return TRUE if the character might begin a match, FALSE if it cannot.
+ */
+BOOLEAN
+YoriLibRegexIsFirstChar(
+    __in PYORI_LIB_REGEX Regex,
+    __in TCHAR Char
+    )
+{
+    if (Char < 256) {
+        return Regex->FirstChar[Char];
+    }
+    return Regex->FirstCharHigh;
+}
+
+/**
+ Free a compiled expression.
+
+ @param Regex Pointer to the expression to free.
+ */
+VOID
+YoriLibRegexFree(
+    __in PYORI_LIB_REGEX Regex
+    )
+{
+    DWORD Index;
+
+    YoriLibRegexFlushStates(Regex);
+
+    for (Index = 0; Index < Regex->SetCount; Index++) {
+        YoriLibFree(Regex->Sets[Index].Ranges);
+    }
+
+    if (Regex->Sets != NULL) {
+        YoriLibFree(Regex->Sets);
+    }
+    if (Regex->Nodes != NULL) {
+        YoriLibFree(Regex->Nodes);
+    }
+    if (Regex->ClassStart != NULL) {
+        YoriLibFree(Regex->ClassStart);
+    }
+    if (Regex->FoldTable != NULL) {
+        YoriLibFree(Regex->FoldTable);
+    }
+    if (Regex->Marks != NULL) {
+        YoriLibFree(Regex->Marks);
+    }
+
+    YoriLibFree(Regex);
+}
+
+/**
+ Determine the character classes for a compiled expression.  Each range in
+ each set begins a class, and the character after each range begins a
+ class, so no set distinguishes between characters in the same class.
+
+ @param Regex Pointer to the expression.
+
+ @param Bitmap Pointer to a scratch bitmap.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibRegexBuildClasses(
+    __inout PYORI_LIB_REGEX Regex,
+    __in PUCHAR Bitmap
+    )
+{
+    PYORI_LIB_REGEX_SET Set;
+    DWORD SetIndex;
+    DWORD Index;
+    DWORD Char;
+    DWORD Class;
+
+    ZeroMemory(Bitmap, YORI_LIB_REGEX_BITMAP_SIZE);
+    YoriLibRegexBitmapAddRange(Bitmap, 0, 0);
+    for (SetIndex = 0; SetIndex < Regex->SetCount; SetIndex++) {
+        Set = &Regex->Sets[SetIndex];
+        for (Index = 0; Index < Set->RangeCount; Index++) {
+            YoriLibRegexBitmapAddRange(Bitmap, Set->Ranges[Index].Low, Set->Ranges[Index].Low);
+            if (Set->Ranges[Index].High < 0xFFFF) {
+                YoriLibRegexBitmapAddRange(Bitmap, Set->Ranges[Index].High + 1, Set->Ranges[Index].High + 1);
+            }
+        }
+    }
+
+    Regex->ClassCount = 0;
+    for (Char = 0; Char <= 0xFFFF; Char++) {
+        if (YoriLibRegexBitmapTest(Bitmap, Char)) {
+            Regex->ClassCount++;
+        }
+    }
+
+    Regex->ClassStart = YoriLibMalloc(Regex->ClassCount * sizeof(TCHAR));
+    if (Regex->ClassStart == NULL) {
+        return FALSE;
+    }
+
+    Class = 0;
+    for (Char = 0; Char <= 0xFFFF; Char++) {
+        if (YoriLibRegexBitmapTest(Bitmap, Char)) {
+            Regex->ClassStart[Class] = (TCHAR)Char;
+            Class++;
+        }
+        if (Char < 256) {
+            Regex->ClassTable[Char] = Class - 1;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Compile one or more regular expressions into a single matcher, so that all
+ of them can be evaluated with one pass over text.  When searching, each
+ pattern is identified by its index in the Patterns array, and where more
+ than one pattern matches, the lowest index is reported.
+
+ The supported syntax is:
+
+   .          Any character other than a newline
+   [abc]      Any of the characters in the brackets.  Ranges such as a-z and
+              the escapes below can be used within brackets.
+   [^abc]     Any character not in the brackets
+   ^ $        The start and end of the text
+   * + ?      Zero or more, one or more, or zero or one of the previous item
+   {n,m}      Between n and m of the previous item.  {n} and {n,} are also
+              accepted.
+   a|b        Either a or b
+   ( )        A group.  (?: ) is accepted as a synonym.
+   \\d \\w \\s   A digit, word character or white space character, and the
+              upper case forms for anything else
+   \\t \\n \\r   Tab, newline, carriage return, and \\f \\v \\xHH \\uHHHH
+   \\c         Any other character is a literal
+
+ Matches are leftmost and then longest, so repetition is always greedy.
+ Backreferences and lookaround are not supported.
+
+ A compiled expression caches state as it is used, so it must not be used by
+ more than one thread at a time.
+
+ @param PatternCount The number of patterns.
+
+ @param Patterns Pointer to an array of patterns.
+
+ @param PatternFlags Optionally points to an array of flags for each
+        pattern.  YORI_LIB_REGEX_PATTERN_LITERAL indicates the pattern is
+        literal text rather than an expression.
+        YORI_LIB_REGEX_PATTERN_ANCHOR_START and
+        YORI_LIB_REGEX_PATTERN_ANCHOR_END require the pattern to match at
+        the start or end of the text.
+
+ @param Flags Flags applying to all patterns.  YORI_LIB_REGEX_INSENSITIVE
+        indicates patterns should match without regard to case.
+
+ @param Regex On successful completion, updated to point to the compiled
+        expression.  The caller should free this with
+        @ref YoriLibRegexFree .
+
+ @param ErrorPattern If compilation fails due to invalid syntax, optionally
+        updated to contain the index of the invalid pattern.
+
+ @param ErrorOffset If compilation fails due to invalid syntax, optionally
+        updated to contain the offset within the pattern where the error was
+        detected.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibRegexCompile(
+    __in DWORD PatternCount,
+    __in_ecount(PatternCount) PCYORI_STRING Patterns,
+    __in_ecount_opt(PatternCount) PDWORD PatternFlags,
+    __in DWORD Flags,
+    __out PYORI_LIB_REGEX *Regex,
+    __out_opt PDWORD ErrorPattern,
+    __out_opt PDWORD ErrorOffset
+    )
+{
+    PYORI_LIB_REGEX NewRegex;
+    PYORI_LIB_REGEX_AST Ast;
+    PYORI_LIB_REGEX_NODE Node;
+    PYORI_LIB_REGEX_SET Set;
+    YORI_LIB_REGEX_PARSER Parser;
+    PDWORD Entries;
+    PDWORD ReverseEntries;
+    DWORD Index;
+    DWORD RangeIndex;
+    DWORD Char;
+    DWORD Entry;
+    DWORD Count;
+    DWORD ThisPatternFlags;
+    DWORD AnySet;
+
+    if (PatternCount == 0) {
+        return FALSE;
+    }
+
+    NewRegex = YoriLibMalloc(sizeof(YORI_LIB_REGEX));
+    if (NewRegex == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(NewRegex, sizeof(YORI_LIB_REGEX));
+    NewRegex->PatternCount = PatternCount;
+    NewRegex->MaskWords = (PatternCount + 31) / 32;
+    if (Flags & YORI_LIB_REGEX_INSENSITIVE) {
+        NewRegex->Insensitive = TRUE;
+    }
+
+    ZeroMemory(&Parser, sizeof(Parser));
+    Parser.Regex = NewRegex;
+    Parser.Bitmap = YoriLibMalloc(2 * YORI_LIB_REGEX_BITMAP_SIZE + 2 * PatternCount * sizeof(DWORD));
+    if (Parser.Bitmap == NULL) {
+        YoriLibRegexFree(NewRegex);
+        return FALSE;
+    }
+    Parser.FoldBitmap = Parser.Bitmap + YORI_LIB_REGEX_BITMAP_SIZE;
+    Entries = (PDWORD)(Parser.FoldBitmap + YORI_LIB_REGEX_BITMAP_SIZE);
+    ReverseEntries = Entries + PatternCount;
+
+    if (NewRegex->Insensitive) {
+        NewRegex->FoldTable = YoriLibMalloc(0x10000 * sizeof(TCHAR));
+        if (NewRegex->FoldTable == NULL) {
+            YoriLibFree(Parser.Bitmap);
+            YoriLibRegexFree(NewRegex);
+            return FALSE;
+        }
+
+        for (Char = 0; Char <= 0xFFFF; Char++) {
+            NewRegex->FoldTable[Char] = YoriLibUpcaseChar((TCHAR)Char);
+        }
+    }
+
+    //
+    //  Parse and compile each pattern, ending in its own match node.
+    //
+
+    for (Index = 0; Index < PatternCount; Index++) {
+        ThisPatternFlags = 0;
+        if (PatternFlags != NULL) {
+            ThisPatternFlags = PatternFlags[Index];
+        }
+
+        Parser.Pattern = &Patterns[Index];
+        Parser.Offset = 0;
+        Parser.Depth = 0;
+        Parser.Error = FALSE;
+
+        if (ThisPatternFlags & YORI_LIB_REGEX_PATTERN_LITERAL) {
+            Ast = YoriLibRegexParseLiteral(&Parser);
+        } else {
+            Ast = YoriLibRegexParseAlternate(&Parser);
+            if (Ast != NULL && Parser.Offset < Patterns[Index].LengthInChars) {
+                YoriLibRegexFreeAst(Ast);
+                Ast = NULL;
+                Parser.Error = TRUE;
+            }
+        }
+
+        if (Ast == NULL) {
+            if (Parser.Error) {
+                if (ErrorPattern != NULL) {
+                    *ErrorPattern = Index;
+                }
+                if (ErrorOffset != NULL) {
+                    *ErrorOffset = Parser.Offset;
+                }
+            }
+            YoriLibFree(Parser.Bitmap);
+            YoriLibRegexFree(NewRegex);
+            return FALSE;
+        }
+
+        Entry = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeMatch, YORI_LIB_REGEX_NO_INDEX, YORI_LIB_REGEX_NO_INDEX, Index);
+        if (Entry != YORI_LIB_REGEX_NO_INDEX && (ThisPatternFlags & YORI_LIB_REGEX_PATTERN_ANCHOR_END)) {
+            Entry = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeLineEnd, Entry, YORI_LIB_REGEX_NO_INDEX, 0);
+        }
+        if (Entry != YORI_LIB_REGEX_NO_INDEX) {
+            Entry = YoriLibRegexCompileAst(NewRegex, Ast, Entry, FALSE);
+        }
+        if (Entry != YORI_LIB_REGEX_NO_INDEX && (ThisPatternFlags & YORI_LIB_REGEX_PATTERN_ANCHOR_START)) {
+            Entry = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeLineStart, Entry, YORI_LIB_REGEX_NO_INDEX, 0);
+        }
+        Entries[Index] = Entry;
+
+        //
+        //  Compile the same pattern in reverse, where anchors at the start
+        //  of the pattern are checked at the end of the scan.
+        //
+
+        if (Entry != YORI_LIB_REGEX_NO_INDEX) {
+            Entry = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeMatch, YORI_LIB_REGEX_NO_INDEX, YORI_LIB_REGEX_NO_INDEX, Index);
+        }
+        if (Entry != YORI_LIB_REGEX_NO_INDEX && (ThisPatternFlags & YORI_LIB_REGEX_PATTERN_ANCHOR_START)) {
+            Entry = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeLineEnd, Entry, YORI_LIB_REGEX_NO_INDEX, 0);
+        }
+        if (Entry != YORI_LIB_REGEX_NO_INDEX) {
+            Entry = YoriLibRegexCompileAst(NewRegex, Ast, Entry, TRUE);
+        }
+        if (Entry != YORI_LIB_REGEX_NO_INDEX && (ThisPatternFlags & YORI_LIB_REGEX_PATTERN_ANCHOR_END)) {
+            Entry = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeLineStart, Entry, YORI_LIB_REGEX_NO_INDEX, 0);
+        }
+        ReverseEntries[Index] = Entry;
+
+        YoriLibRegexFreeAst(Ast);
+        if (Entry == YORI_LIB_REGEX_NO_INDEX) {
+            YoriLibFree(Parser.Bitmap);
+            YoriLibRegexFree(NewRegex);
+            return FALSE;
+        }
+    }
+
+    //
+    //  Join the patterns into a single anchored root, and construct an
+    //  unanchored root which can consume any character before starting.
+    //
+
+    Entry = Entries[PatternCount - 1];
+    for (Index = PatternCount - 1; Index > 0; Index--) {
+        if (Entry != YORI_LIB_REGEX_NO_INDEX) {
+            Entry = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeSplit, Entries[Index - 1], Entry, 0);
+        }
+    }
+    NewRegex->AnchoredRoot = Entry;
+
+    AnySet = YoriLibRegexAddSetFromRange(NewRegex, 0, 0xFFFF);
+    if (Entry != YORI_LIB_REGEX_NO_INDEX && AnySet != YORI_LIB_REGEX_NO_INDEX) {
+        NewRegex->AnyNode = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeSet, YORI_LIB_REGEX_NO_INDEX, YORI_LIB_REGEX_NO_INDEX, AnySet);
+        if (NewRegex->AnyNode != YORI_LIB_REGEX_NO_INDEX) {
+            NewRegex->UnanchoredRoot = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeSplit, NewRegex->AnchoredRoot, NewRegex->AnyNode, 0);
+            NewRegex->Nodes[NewRegex->AnyNode].Next = NewRegex->UnanchoredRoot;
+            Entry = NewRegex->UnanchoredRoot;
+        } else {
+            Entry = YORI_LIB_REGEX_NO_INDEX;
+        }
+    } else {
+        Entry = YORI_LIB_REGEX_NO_INDEX;
+    }
+
+    //
+    //  Construct the reverse roots in the same way.
+    //
+
+    if (Entry != YORI_LIB_REGEX_NO_INDEX) {
+        Entry = ReverseEntries[PatternCount - 1];
+        for (Index = PatternCount - 1; Index > 0; Index--) {
+            if (Entry != YORI_LIB_REGEX_NO_INDEX) {
+                Entry = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeSplit, ReverseEntries[Index - 1], Entry, 0);
+            }
+        }
+    }
+
+    if (Entry != YORI_LIB_REGEX_NO_INDEX) {
+        NewRegex->ReverseAnyNode = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeSet, YORI_LIB_REGEX_NO_INDEX, YORI_LIB_REGEX_NO_INDEX, AnySet);
+        if (NewRegex->ReverseAnyNode != YORI_LIB_REGEX_NO_INDEX) {
+            NewRegex->ReverseUnanchoredRoot = YoriLibRegexAddNode(NewRegex, YoriLibRegexNodeSplit, Entry, NewRegex->ReverseAnyNode, 0);
+            NewRegex->Nodes[NewRegex->ReverseAnyNode].Next = NewRegex->ReverseUnanchoredRoot;
+            Entry = NewRegex->ReverseUnanchoredRoot;
+        } else {
+            Entry = YORI_LIB_REGEX_NO_INDEX;
+        }
+    }
+
+    if (Entry == YORI_LIB_REGEX_NO_INDEX ||
+        !YoriLibRegexBuildClasses(NewRegex, Parser.Bitmap)) {
+
+        YoriLibFree(Parser.Bitmap);
+        YoriLibRegexFree(NewRegex);
+        return FALSE;
+    }
+
+    YoriLibFree(Parser.Bitmap);
+    if (NewRegex->FoldTable != NULL) {
+        YoriLibFree(NewRegex->FoldTable);
+        NewRegex->FoldTable = NULL;
+    }
+
+    //
+    //  Allocate scratch space used while constructing states.
+    //
+
+    Count = NewRegex->NodeCount;
+    NewRegex->Marks = YoriLibMalloc(6 * Count * sizeof(DWORD));
+    if (NewRegex->Marks == NULL) {
+        YoriLibRegexFree(NewRegex);
+        return FALSE;
+    }
+    ZeroMemory(NewRegex->Marks, Count * sizeof(DWORD));
+    NewRegex->Stack = NewRegex->Marks + Count;
+    NewRegex->Targets = NewRegex->Stack + Count;
+    NewRegex->ClosureNodes = NewRegex->Targets + Count;
+    NewRegex->EndNodes = NewRegex->ClosureNodes + Count;
+    NewRegex->IdleNodes = NewRegex->EndNodes + Count;
+
+    //
+    //  Determine which characters can begin a match away from the start of
+    //  the text.  These are the characters consumed by any node reachable
+    //  from the unanchored root, other than the node that skips characters.
+    //  The same nodes form the idle state, which any character that cannot
+    //  begin a match returns to.
+    //
+
+    Count = YoriLibRegexClosure(NewRegex, &NewRegex->UnanchoredRoot, 1, FALSE, FALSE, NewRegex->ClosureNodes);
+    memcpy(NewRegex->IdleNodes, NewRegex->ClosureNodes, Count * sizeof(DWORD));
+    NewRegex->IdleNodeCount = Count;
+    for (Index = 0; Index < Count; Index++) {
+        if (NewRegex->ClosureNodes[Index] == NewRegex->AnyNode) {
+            continue;
+        }
+        Node = &NewRegex->Nodes[NewRegex->ClosureNodes[Index]];
+        if (Node->Type != YoriLibRegexNodeSet) {
+            continue;
+        }
+        Set = &NewRegex->Sets[Node->Index];
+        for (RangeIndex = 0; RangeIndex < Set->RangeCount; RangeIndex++) {
+            for (Char = Set->Ranges[RangeIndex].Low; Char <= Set->Ranges[RangeIndex].High && Char < 256; Char++) {
+                NewRegex->FirstChar[Char] = TRUE;
+            }
+            if (Set->Ranges[RangeIndex].High >= 256) {
+                NewRegex->FirstCharHigh = TRUE;
+            }
+        }
+    }
+
+    *Regex = NewRegex;
+    return TRUE;
+}
+
+/**
+ Determine whether any pattern in a compiled expression matches anywhere
+ within a string.  This is a single pass over the string.
+
+ @param Regex Pointer to the compiled expression.
+
+ @param Text Pointer to the string to search.
+
+ @param PatternIndex Optionally points to a location to receive the index of
+        the lowest numbered pattern which matches.
+
+ @return TRUE if a pattern matches, FALSE if no pattern matches or on
+         allocation failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibRegexMatchAny(
+    __in PYORI_LIB_REGEX Regex,
+    __in PCYORI_STRING Text,
+    __out_opt PDWORD PatternIndex
+    )
+{
+    PYORI_LIB_REGEX_STATE State;
+    DWORD Index;
+    DWORD Best;
+    DWORD Lowest;
+
+    State = YoriLibRegexGetStartState(Regex, TRUE, TRUE);
+    if (State == NULL) {
+        return FALSE;
+    }
+
+    Best = YORI_LIB_REGEX_NO_INDEX;
+    if (State->Accepting) {
+        Best = YoriLibRegexLowestPattern(Regex, State->Accept);
+    }
+
+    Index = 0;
+    while (Best != 0 && Index < Text->LengthInChars) {
+        if (State->Idle) {
+            while (Index < Text->LengthInChars &&
+                   !YoriLibRegexIsFirstChar(Regex, Text->StartOfString[Index])) {
+                Index++;
+            }
+            if (Index == Text->LengthInChars) {
+                break;
+            }
+        }
+
+        State = YoriLibRegexStep(Regex, State, Text->StartOfString[Index]);
+        if (State == NULL) {
+            return FALSE;
+        }
+        Index++;
+
+        if (State->Accepting) {
+            Lowest = YoriLibRegexLowestPattern(Regex, State->Accept);
+            if (Lowest < Best) {
+                Best = Lowest;
+            }
+        }
+    }
+
+    if (Best != 0 && Index == Text->LengthInChars && State->EndAccepting) {
+        Lowest = YoriLibRegexLowestPattern(Regex, State->EndAccept);
+        if (Lowest < Best) {
+            Best = Lowest;
+        }
+    }
+
+    if (Best == YORI_LIB_REGEX_NO_INDEX) {
+        return FALSE;
+    }
+
+    if (PatternIndex != NULL) {
+        *PatternIndex = Best;
+    }
+    return TRUE;
+}
+
+/**
+ Update the best match found from a starting position with the patterns
+ that match ending at a position.  The lowest numbered pattern is preferred,
+ and for that pattern, the longest match.
+
+ @param Regex Pointer to the compiled expression.
+
+ @param Mask Pointer to the patterns which match ending at this position.
+
+ @param End The position where the matches end.
+
+ @param Best On input, the best pattern found so far.  On output, updated
+        if a better pattern was found.
+
+ @param BestEnd On input, the end of the best match so far.  On output,
+        updated if a better or longer match was found.
+ */
+VOID
+YoriLibRegexUpdateBest(
+    __in PYORI_LIB_REGEX Regex,
+    __in PDWORD Mask,
+    __in DWORD End,
+    __inout PDWORD Best,
+    __inout PDWORD BestEnd
+    )
+{
+    DWORD Lowest;
+
+    Lowest = YoriLibRegexLowestPattern(Regex, Mask);
+    if (Lowest == YORI_LIB_REGEX_NO_INDEX) {
+        return;
+    }
+
+    if (Lowest < *Best) {
+        *Best = Lowest;
+        *BestEnd = End;
+    } else if (Mask[*Best / 32] & (1 << (*Best % 32))) {
+        *BestEnd = End;
+    }
+}
+
+/**
+ Find the best match which starts at a specific position.
+
+ @param Regex Pointer to the compiled expression.
+
+ @param Text Pointer to the string to search.
+
+ @param Start The offset within the string where the match must start.
+
+ @param PatternIndex On successful completion, updated to contain the index
+        of the pattern which matched.
+
+ @param End On successful completion, updated to contain the offset of the
+        end of the match.
+
+ @return TRUE if a match was found, FALSE if not.
+ */
+__success(return)
+BOOLEAN
+YoriLibRegexMatchAt(
+    __in PYORI_LIB_REGEX Regex,
+    __in PCYORI_STRING Text,
+    __in DWORD Start,
+    __out PDWORD PatternIndex,
+    __out PDWORD End
+    )
+{
+    PYORI_LIB_REGEX_STATE State;
+    DWORD Index;
+    DWORD Best;
+    DWORD BestEnd;
+
+    State = YoriLibRegexGetStartState(Regex, FALSE, (BOOLEAN)(Start == 0));
+    if (State == NULL) {
+        return FALSE;
+    }
+
+    Best = YORI_LIB_REGEX_NO_INDEX;
+    BestEnd = Start;
+    if (State->Accepting) {
+        YoriLibRegexUpdateBest(Regex, State->Accept, Start, &Best, &BestEnd);
+    }
+
+    Index = Start;
+    while (Index < Text->LengthInChars && !State->Dead) {
+        State = YoriLibRegexStep(Regex, State, Text->StartOfString[Index]);
+        if (State == NULL) {
+            return FALSE;
+        }
+        Index++;
+        if (State->Accepting) {
+            YoriLibRegexUpdateBest(Regex, State->Accept, Index, &Best, &BestEnd);
+        }
+    }
+
+    if (Index == Text->LengthInChars && State->EndAccepting) {
+        YoriLibRegexUpdateBest(Regex, State->EndAccept, Index, &Best, &BestEnd);
+    }
+
+    if (Best == YORI_LIB_REGEX_NO_INDEX) {
+        return FALSE;
+    }
+
+    *PatternIndex = Best;
+    *End = BestEnd;
+    return TRUE;
+}
+
+/**
+ Find the first match of any pattern within a string.  The match which
+ starts earliest is returned.  If more than one pattern matches at that
+ position, the lowest numbered pattern is returned, with the longest match
+ for that pattern.
+
+ The search runs in time linear in the length of the text following
+ StartOffset.  A forward scan finds where the first match ends, and
+ continues without starting new matches to find where every match that
+ had started by then ends.  A reverse scan from there finds the earliest
+ position where a match starts, and the match is then measured from that
+ position.  Each of these visits a character at most once.
+
+ @param Regex Pointer to the compiled expression.
+
+ @param Text Pointer to the string to search.  Start of line and end of line
+        assertions refer to the start and end of this string.
+
+ @param StartOffset The offset within the string to begin searching from.
+
+ @param MatchOffset On successful completion, updated to contain the offset
+        of the match within the string.
+
+ @param MatchLength On successful completion, updated to contain the length
+        of the match.  This can be zero if a pattern matches empty text.
+
+ @param PatternIndex Optionally points to a location to receive the index of
+        the pattern which matched.
+
+ @return TRUE if a match was found, FALSE if no match was found or on
+         allocation failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibRegexFindFirst(
+    __in PYORI_LIB_REGEX Regex,
+    __in PCYORI_STRING Text,
+    __in DWORD StartOffset,
+    __out PDWORD MatchOffset,
+    __out PDWORD MatchLength,
+    __out_opt PDWORD PatternIndex
+    )
+{
+    PYORI_LIB_REGEX_STATE State;
+    DWORD Index;
+    DWORD FirstEnd;
+    DWORD LastEnd;
+    DWORD Start;
+    DWORD Pattern;
+    DWORD End;
+
+    if (StartOffset > Text->LengthInChars) {
+        return FALSE;
+    }
+
+    //
+    //  Scan forward to find where the first match ends.  The leftmost
+    //  match must start at or before this point, and if nothing matches
+    //  the text has been processed in a single pass.
+    //
+
+    State = YoriLibRegexGetStartState(Regex, TRUE, (BOOLEAN)(StartOffset == 0));
+    if (State == NULL) {
+        return FALSE;
+    }
+
+    FirstEnd = YORI_LIB_REGEX_NO_INDEX;
+    Index = StartOffset;
+    if (State->Accepting) {
+        FirstEnd = Index;
+    }
+
+    while (FirstEnd == YORI_LIB_REGEX_NO_INDEX && Index < Text->LengthInChars) {
+        if (State->Idle) {
+            while (Index < Text->LengthInChars &&
+                   !YoriLibRegexIsFirstChar(Regex, Text->StartOfString[Index])) {
+                Index++;
+            }
+            if (Index == Text->LengthInChars) {
+                break;
+            }
+        }
+
+        State = YoriLibRegexStep(Regex, State, Text->StartOfString[Index]);
+        if (State == NULL) {
+            return FALSE;
+        }
+        Index++;
+        if (State->Accepting) {
+            FirstEnd = Index;
+        }
+    }
+
+    if (FirstEnd == YORI_LIB_REGEX_NO_INDEX) {
+        if (!State->EndAccepting) {
+            return FALSE;
+        }
+        FirstEnd = Text->LengthInChars;
+    }
+
+    //
+    //  Continue forward without starting new matches until no match in
+    //  progress can continue.  Every match that starts at or before
+    //  FirstEnd, including the leftmost match, ends at or before LastEnd.
+    //
+
+    LastEnd = FirstEnd;
+    if (FirstEnd < Text->LengthInChars) {
+        State = YoriLibRegexStopStarting(Regex, State);
+        if (State == NULL) {
+            return FALSE;
+        }
+
+        Index = FirstEnd;
+        while (Index < Text->LengthInChars && !State->Dead) {
+            State = YoriLibRegexStep(Regex, State, Text->StartOfString[Index]);
+            if (State == NULL) {
+                return FALSE;
+            }
+            Index++;
+            if (State->Accepting) {
+                LastEnd = Index;
+            }
+        }
+
+        if (Index == Text->LengthInChars && State->EndAccepting) {
+            LastEnd = Index;
+        }
+    }
+
+    //
+    //  Scan backwards from LastEnd.  The reverse automaton accepts at each
+    //  position where a match ending at or before LastEnd starts, so the
+    //  last position where it accepts is the start of the leftmost match.
+    //  Matches starting after FirstEnd may also be seen, but cannot be
+    //  leftmost.
+    //
+
+    State = YoriLibRegexGetReverseStartState(Regex, (BOOLEAN)(LastEnd == Text->LengthInChars));
+    if (State == NULL) {
+        return FALSE;
+    }
+
+    Start = YORI_LIB_REGEX_NO_INDEX;
+    Index = LastEnd;
+    if (State->Accepting) {
+        Start = Index;
+    }
+
+    while (Index > StartOffset) {
+        State = YoriLibRegexStep(Regex, State, Text->StartOfString[Index - 1]);
+        if (State == NULL) {
+            return FALSE;
+        }
+        Index--;
+        if (State->Accepting) {
+            Start = Index;
+        }
+    }
+
+    if (Index == 0 && State->EndAccepting) {
+        Start = Index;
+    }
+
+    if (Start == YORI_LIB_REGEX_NO_INDEX) {
+        return FALSE;
+    }
+
+    //
+    //  Find the preferred pattern and longest match from that position.
+    //
+
+    if (!YoriLibRegexMatchAt(Regex, Text, Start, &Pattern, &End)) {
+        return FALSE;
+    }
+
+    *MatchOffset = Start;
+    *MatchLength = End - Start;
+    if (PatternIndex != NULL) {
+        *PatternIndex = Pattern;
+    }
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
@@ -154,17 +154,19 @@ YoriLibLoadColorTableFromScheme(
     TCHAR ValueName[16];
     TCHAR Value[64];
     COLORREF Color;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
-    if (DllKernel32.pGetPrivateProfileStringW == NULL) {
+    if (!YoriLibIniLoad(IniFileName, &IniDocument)) {
         return FALSE;
     }
 
     for (PrefixIndex = 0; PrefixIndex < sizeof(YoriLibSchemeColorPrefixes)/sizeof(YoriLibSchemeColorPrefixes[0]); PrefixIndex++) {
         for (ColorIndex = 0; ColorIndex < sizeof(YoriLibSchemeColorNames)/sizeof(YoriLibSchemeColorNames[0]); ColorIndex++) {
             YoriLibSPrintf(ValueName, _T("%s_%s"), YoriLibSchemeColorPrefixes[PrefixIndex], YoriLibSchemeColorNames[ColorIndex]);
-            DllKernel32.pGetPrivateProfileStringW(_T("Table"), ValueName, _T(""), Value, sizeof(Value)/sizeof(Value[0]), IniFileName->StartOfString);
+            YoriLibIniGetString(IniDocument, _T("Table"), ValueName, _T(""), Value, sizeof(Value)/sizeof(Value[0]));
 
             if (!YoriLibParseSchemeColorString(Value, &Color)) {
+                YoriLibIniFree(IniDocument);
                 return FALSE;
             }
 
@@ -174,6 +176,7 @@ YoriLibLoadColorTableFromScheme(
         }
     }
 
+    YoriLibIniFree(IniDocument);
     return TRUE;
 }
 
@@ -265,21 +268,24 @@ YoriLibLoadSectionColorFromScheme(
     YORI_STRING StringValue;
     UCHAR Foreground;
     UCHAR Background;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
-    if (DllKernel32.pGetPrivateProfileStringW == NULL) {
+    if (!YoriLibIniLoad(IniFileName, &IniDocument)) {
         return FALSE;
     }
 
     StringValue.StartOfString = Value;
     StringValue.LengthAllocated = sizeof(Value)/sizeof(Value[0]);
 
-    StringValue.LengthInChars = DllKernel32.pGetPrivateProfileStringW(SectionName, _T("Foreground"), _T(""), Value, sizeof(Value)/sizeof(Value[0]), IniFileName->StartOfString);
+    StringValue.LengthInChars = YoriLibIniGetString(IniDocument, SectionName, _T("Foreground"), _T(""), Value, sizeof(Value)/sizeof(Value[0]));
 
     if (!YoriLibLoadColorFromSchemeString(&StringValue, &Foreground)) {
+        YoriLibIniFree(IniDocument);
         return FALSE;
     }
 
-    StringValue.LengthInChars = DllKernel32.pGetPrivateProfileStringW(SectionName, _T("Background"), _T(""), Value, sizeof(Value)/sizeof(Value[0]), IniFileName->StartOfString);
+    StringValue.LengthInChars = YoriLibIniGetString(IniDocument, SectionName, _T("Background"), _T(""), Value, sizeof(Value)/sizeof(Value[0]));
+    YoriLibIniFree(IniDocument);
 
     if (!YoriLibLoadColorFromSchemeString(&StringValue, &Background)) {
         return FALSE;
@@ -353,8 +359,10 @@ YoriLibSaveColorTableToScheme(
     TCHAR ValueName[16];
     TCHAR Value[64];
     COLORREF Color;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
+    BOOL Result;
 
-    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
+    if (!YoriLibIniLoad(IniFileName, &IniDocument)) {
         return FALSE;
     }
 
@@ -364,11 +372,13 @@ YoriLibSaveColorTableToScheme(
             Index = PrefixIndex * sizeof(YoriLibSchemeColorNames)/sizeof(YoriLibSchemeColorNames[0]) + ColorIndex;
             Color = ColorTable[Index];
             YoriLibSPrintf(Value, _T("%i, %i, %i"), GetRValue(Color), GetGValue(Color), GetBValue(Color));
-            DllKernel32.pWritePrivateProfileStringW(_T("Table"), ValueName, Value, IniFileName->StartOfString);
+            YoriLibIniSetString(IniDocument, _T("Table"), ValueName, Value);
         }
     }
 
-    return TRUE;
+    Result = YoriLibIniSave(IniDocument);
+    YoriLibIniFree(IniDocument);
+    return Result;
 }
 
 /**
@@ -395,8 +405,10 @@ YoriLibSaveSectionColorToScheme(
     UCHAR Intensity;
     UCHAR Color;
     UCHAR Component;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
+    BOOL Result;
 
-    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
+    if (!YoriLibIniLoad(IniFileName, &IniDocument)) {
         return FALSE;
     }
 
@@ -406,7 +418,7 @@ YoriLibSaveSectionColorToScheme(
     Color = (UCHAR)(Component & (FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE));
 
     YoriLibSPrintf(Value, _T("%s_%s"), YoriLibSchemeColorPrefixes[Intensity], YoriLibSchemeColorNames[Component & (FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE)]);
-    DllKernel32.pWritePrivateProfileStringW(SectionName, _T("Foreground"), Value, IniFileName->StartOfString);
+    YoriLibIniSetString(IniDocument, SectionName, _T("Foreground"), Value);
 
     Component = (UCHAR)((WindowColor & 0xF0) >> 4);
 
@@ -414,9 +426,11 @@ YoriLibSaveSectionColorToScheme(
     Color = (UCHAR)(Component & (FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE));
 
     YoriLibSPrintf(Value, _T("%s_%s"), YoriLibSchemeColorPrefixes[Intensity], YoriLibSchemeColorNames[Component & (FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE)]);
-    DllKernel32.pWritePrivateProfileStringW(SectionName, _T("Background"), Value, IniFileName->StartOfString);
+    YoriLibIniSetString(IniDocument, SectionName, _T("Background"), Value);
 
-    return TRUE;
+    Result = YoriLibIniSave(IniDocument);
+    YoriLibIniFree(IniDocument);
+    return Result;
 }
 
 /**
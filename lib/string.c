@@ -3,7 +3,7 @@
  *
  * Yori string manipulation routines
  *
- * Copyright (c) 2017-2018 Malcolm J. Smith
+ * Copyright (c) 2017-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -79,7 +79,7 @@ YoriLibAllocateString(
     )
 {
     YoriLibInitEmptyString(String);
-    String->MemoryToFree = YoriLibReferencedMalloc(CharsToAllocate * sizeof(TCHAR));
+    String->MemoryToFree = YoriLibReferencedMallocForCaller(CharsToAllocate * sizeof(TCHAR), YoriLibAllocProfileCaller());
     if (String->MemoryToFree == NULL) {
         return FALSE;
     }
@@ -110,7 +110,7 @@ YoriLibReallocateString(
         return FALSE;
     }
 
-    NewMemoryToFree = YoriLibReferencedMalloc(CharsToAllocate * sizeof(TCHAR));
+    NewMemoryToFree = YoriLibReferencedMallocForCaller(CharsToAllocate * sizeof(TCHAR), YoriLibAllocProfileCaller());
     if (NewMemoryToFree == NULL) {
         return FALSE;
     }
@@ -151,7 +151,7 @@ YoriLibReallocateStringWithoutPreservingContents(
         return FALSE;
     }
 
-    NewMemoryToFree = YoriLibReferencedMalloc(CharsToAllocate * sizeof(TCHAR));
+    NewMemoryToFree = YoriLibReferencedMallocForCaller(CharsToAllocate * sizeof(TCHAR), YoriLibAllocProfileCaller());
     if (NewMemoryToFree == NULL) {
         return FALSE;
     }
@@ -184,7 +184,7 @@ YoriLibCStringFromYoriString(
 {
     LPTSTR Return;
 
-    Return = YoriLibReferencedMalloc((String->LengthInChars + 1) * sizeof(TCHAR));
+    Return = YoriLibReferencedMallocForCaller((String->LengthInChars + 1) * sizeof(TCHAR), YoriLibAllocProfileCaller());
     if (Return == NULL) {
         return NULL;
     }
@@ -0,0 +1,584 @@
+/**
+ * @file lib/trace.c
+ *
+ * Yori lightweight runtime tracing
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ The default number of events retained per thread.  Once a thread has
+ recorded this many events, older events are overwritten.
+ */
+#define YORI_LIB_TRACE_DEFAULT_EVENTS (16384)
+
+/**
+ The types of events that can be recorded.
+ */
+typedef enum _YORI_LIB_TRACE_EVENT_TYPE {
+    YoriLibTraceEventBegin = 0,
+    YoriLibTraceEventEnd = 1,
+    YoriLibTraceEventCounter = 2
+} YORI_LIB_TRACE_EVENT_TYPE;
+
+/**
+ A single recorded event.
+ */
+typedef struct _YORI_LIB_TRACE_EVENT {
+
+    /**
+     The performance counter value when the event was recorded.
+     */
+    LONGLONG Timestamp;
+
+    /**
+     For counter events, the value of the counter.
+     */
+    LONGLONG Value;
+
+    /**
+     The name of the event.  This must be a constant string that remains
+     valid for the life of the process.
+     */
+    LPCSTR Name;
+
+    /**
+     The type of the event.
+     */
+    YORI_LIB_TRACE_EVENT_TYPE Type;
+
+} YORI_LIB_TRACE_EVENT, *PYORI_LIB_TRACE_EVENT;
+
+/**
+ A ring buffer of events recorded by a single thread.  Only the owning
+ thread writes to the buffer, so recording an event requires no
+ synchronization.
+ */
+typedef struct _YORI_LIB_TRACE_THREAD_BUFFER {
+
+    /**
+     The link of this buffer within the list of all thread buffers.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The identifier of the thread that owns the buffer.
+     */
+    DWORD ThreadId;
+
+    /**
+     The number of events that can be held in the buffer.
+     */
+    DWORD Capacity;
+
+    /**
+     The total number of events written to the buffer.  If this exceeds
+     Capacity, the buffer has wrapped and only the most recent Capacity
+     events are retained.
+     */
+    DWORDLONG EventsWritten;
+
+    /**
+     An array of events.
+     */
+    YORI_LIB_TRACE_EVENT Events[1];
+
+} YORI_LIB_TRACE_THREAD_BUFFER, *PYORI_LIB_TRACE_THREAD_BUFFER;
+
+/**
+ Process global state for tracing.
+ */
+typedef struct _YORI_LIB_TRACE_GLOBAL {
+
+    /**
+     The TLS slot used to find the current thread's buffer.
+     */
+    DWORD TlsIndex;
+
+    /**
+     The number of events to allocate for each thread.
+     */
+    DWORD EventsPerThread;
+
+    /**
+     A mutex synchronizing the list of thread buffers.
+     */
+    HANDLE Mutex;
+
+    /**
+     A list of all thread buffers.
+     */
+    YORI_LIST_ENTRY ThreadBuffers;
+
+    /**
+     The performance counter value when tracing was initialized.  Events are
+     reported relative to this point.
+     */
+    LONGLONG StartTimestamp;
+
+    /**
+     The directory to write trace output to.
+     */
+    YORI_STRING OutputDirectory;
+
+} YORI_LIB_TRACE_GLOBAL, *PYORI_LIB_TRACE_GLOBAL;
+
+/**
+ Process global state for tracing.
+ */
+YORI_LIB_TRACE_GLOBAL YoriLibTraceGlobal;
+
+/**
+ TRUE if tracing is active in this process.  This is checked by the trace
+ macros before calling into this module, so a disabled trace costs a single
+ test of this value.
+ */
+BOOLEAN YoriLibTraceEnabled;
+
+/**
+ Initialize tracing for the process.  Tracing is enabled if the YORI_TRACE
+ environment variable refers to a directory, in which case a trace is written
+ into that directory by @ref YoriLibTraceWrite .  The number of events kept
+ per thread can be specified with YORI_TRACE_EVENTS.
+
+ @return TRUE if tracing has been enabled, FALSE if it has not.
+ */
+BOOLEAN
+YoriLibTraceInitialize(VOID)
+{
+    YORI_STRING Directory;
+    LARGE_INTEGER Now;
+    LONGLONG EventCount;
+
+    if (YoriLibTraceEnabled) {
+        return TRUE;
+    }
+
+    YoriLibInitEmptyString(&Directory);
+    if (!YoriLibAllocateAndGetEnvironmentVariable(_T("YORI_TRACE"), &Directory) ||
+        Directory.LengthInChars == 0) {
+
+        YoriLibFreeStringContents(&Directory);
+        return FALSE;
+    }
+
+    while (Directory.LengthInChars > 0 &&
+           YoriLibIsSep(Directory.StartOfString[Directory.LengthInChars - 1])) {
+
+        Directory.LengthInChars--;
+    }
+
+    YoriLibTraceGlobal.EventsPerThread = YORI_LIB_TRACE_DEFAULT_EVENTS;
+    if (YoriLibGetEnvironmentVariableAsNumber(_T("YORI_TRACE_EVENTS"), &EventCount) &&
+        EventCount >= 16 &&
+        EventCount <= 0x100000) {
+
+        YoriLibTraceGlobal.EventsPerThread = (DWORD)EventCount;
+    }
+
+    YoriLibTraceGlobal.TlsIndex = TlsAlloc();
+    if (YoriLibTraceGlobal.TlsIndex == TLS_OUT_OF_INDEXES) {
+        YoriLibFreeStringContents(&Directory);
+        return FALSE;
+    }
+
+    YoriLibTraceGlobal.Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (YoriLibTraceGlobal.Mutex == NULL) {
+        TlsFree(YoriLibTraceGlobal.TlsIndex);
+        YoriLibFreeStringContents(&Directory);
+        return FALSE;
+    }
+
+    YoriLibInitializeListHead(&YoriLibTraceGlobal.ThreadBuffers);
+    memcpy(&YoriLibTraceGlobal.OutputDirectory, &Directory, sizeof(YORI_STRING));
+
+    QueryPerformanceCounter(&Now);
+    YoriLibTraceGlobal.StartTimestamp = Now.QuadPart;
+    YoriLibTraceEnabled = TRUE;
+    return TRUE;
+}
+
+/**
+ Return the buffer for the current thread, allocating one if this is the
+ first event recorded by the thread.
+
+ @return Pointer to the current thread's buffer, or NULL if one could not
+         be allocated.
+ */
+PYORI_LIB_TRACE_THREAD_BUFFER
+YoriLibTraceGetThreadBuffer(VOID)
+{
+    PYORI_LIB_TRACE_THREAD_BUFFER Buffer;
+    DWORD BytesNeeded;
+
+    Buffer = TlsGetValue(YoriLibTraceGlobal.TlsIndex);
+    if (Buffer != NULL) {
+        return Buffer;
+    }
+
+    BytesNeeded = FIELD_OFFSET(YORI_LIB_TRACE_THREAD_BUFFER, Events) +
+                  YoriLibTraceGlobal.EventsPerThread * sizeof(YORI_LIB_TRACE_EVENT);
+
+    //
+    //  Allocate directly from the process heap so trace buffers are not
+    //  themselves visible to allocation tracking.
+    //
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, BytesNeeded);
+    if (Buffer == NULL) {
+        return NULL;
+    }
+
+    Buffer->ThreadId = GetCurrentThreadId();
+    Buffer->Capacity = YoriLibTraceGlobal.EventsPerThread;
+    Buffer->EventsWritten = 0;
+
+    WaitForSingleObject(YoriLibTraceGlobal.Mutex, INFINITE);
+    YoriLibAppendList(&YoriLibTraceGlobal.ThreadBuffers, &Buffer->ListEntry);
+    ReleaseMutex(YoriLibTraceGlobal.Mutex);
+
+    TlsSetValue(YoriLibTraceGlobal.TlsIndex, Buffer);
+    return Buffer;
+}
+
+/**
+ Record a single event into the current thread's buffer.
+
+ @param Type The type of the event.
+
+ @param Name The name of the event.  This must be a constant string.
+
+ @param Value For counters, the value of the counter.
+ */
+VOID
+YoriLibTraceRecord(
+    __in YORI_LIB_TRACE_EVENT_TYPE Type,
+    __in LPCSTR Name,
+    __in LONGLONG Value
+    )
+{
+    PYORI_LIB_TRACE_THREAD_BUFFER Buffer;
+    PYORI_LIB_TRACE_EVENT Event;
+    LARGE_INTEGER Now;
+
+    if (!YoriLibTraceEnabled) {
+        return;
+    }
+
+    Buffer = YoriLibTraceGetThreadBuffer();
+    if (Buffer == NULL) {
+        return;
+    }
+
+    QueryPerformanceCounter(&Now);
+    Event = &Buffer->Events[(DWORD)(Buffer->EventsWritten % Buffer->Capacity)];
+    Event->Timestamp = Now.QuadPart;
+    Event->Value = Value;
+    Event->Name = Name;
+    Event->Type = Type;
+    Buffer->EventsWritten++;
+}
+
+/**
+ Record the beginning of a traced region on the current thread.  Calls to
+ this function should generally be made through @ref YORI_TRACE_BEGIN so
+ that the call is skipped when tracing is disabled.
+
+ @param Name The name of the region.  This must be a constant string.
+ */
+VOID
+YoriLibTraceBegin(
+    __in LPCSTR Name
+    )
+{
+    YoriLibTraceRecord(YoriLibTraceEventBegin, Name, 0);
+}
+
+/**
+ Record the end of a traced region on the current thread.  Calls to this
+ function should generally be made through @ref YORI_TRACE_END so that the
+ call is skipped when tracing is disabled.
+
+ @param Name The name of the region.  This must be a constant string.
+ */
+VOID
+YoriLibTraceEnd(
+    __in LPCSTR Name
+    )
+{
+    YoriLibTraceRecord(YoriLibTraceEventEnd, Name, 0);
+}
+
+/**
+ Record the value of a counter.  Calls to this function should generally be
+ made through @ref YORI_TRACE_COUNTER so that the call is skipped when
+ tracing is disabled.
+
+ @param Name The name of the counter.  This must be a constant string.
+
+ @param Value The current value of the counter.
+ */
+VOID
+YoriLibTraceCounter(
+    __in LPCSTR Name,
+    __in LONGLONG Value
+    )
+{
+    YoriLibTraceRecord(YoriLibTraceEventCounter, Name, Value);
+}
+
+/**
+ Append a single event to a buffer in Chrome trace event format.
+
+ @param Output Pointer to the buffer to append to.
+
+ @param Event Pointer to the event to append.
+
+ @param ThreadId The thread that recorded the event.
+
+ @param Frequency The performance counter frequency.
+
+ @param First TRUE if this is the first event in the output, FALSE if a
+        seperator from a previous event is required.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibTraceFormatEvent(
+    __inout PYORI_LIB_BYTE_BUFFER Output,
+    __in PYORI_LIB_TRACE_EVENT Event,
+    __in DWORD ThreadId,
+    __in DWORDLONG Frequency,
+    __in BOOLEAN First
+    )
+{
+    DWORDLONG Ticks;
+    DWORDLONG Nanoseconds;
+    DWORDLONG BytesAvailable;
+    DWORD NameLength;
+    PUCHAR Dest;
+    LPCSTR Phase;
+    int Length;
+
+    Ticks = (DWORDLONG)(Event->Timestamp - YoriLibTraceGlobal.StartTimestamp);
+    Nanoseconds = (Ticks / Frequency) * 1000000000 + (Ticks % Frequency) * 1000000000 / Frequency;
+
+    for (NameLength = 0; Event->Name[NameLength] != '\0'; NameLength++);
+
+    Dest = YoriLibByteBufferGetPointerToEnd(Output, NameLength + 256, &BytesAvailable);
+    if (Dest == NULL) {
+        return FALSE;
+    }
+
+    if (BytesAvailable > 0x10000000) {
+        BytesAvailable = 0x10000000;
+    }
+
+    switch(Event->Type) {
+        case YoriLibTraceEventBegin:
+            Phase = "B";
+            break;
+        case YoriLibTraceEventEnd:
+            Phase = "E";
+            break;
+        default:
+            Phase = "C";
+            break;
+    }
+
+    if (Event->Type == YoriLibTraceEventCounter) {
+        Length = YoriLibSPrintfSA((LPSTR)Dest,
+                                  (DWORD)BytesAvailable,
+                                  "%hs\n{\"name\":\"%hs\",\"ph\":\"C\",\"ts\":%llu.%03llu,\"pid\":%i,\"tid\":%i,\"args\":{\"value\":%lli}}",
+                                  First?"":",",
+                                  Event->Name,
+                                  Nanoseconds / 1000,
+                                  Nanoseconds % 1000,
+                                  GetCurrentProcessId(),
+                                  ThreadId,
+                                  Event->Value);
+    } else {
+        Length = YoriLibSPrintfSA((LPSTR)Dest,
+                                  (DWORD)BytesAvailable,
+                                  "%hs\n{\"name\":\"%hs\",\"ph\":\"%hs\",\"ts\":%llu.%03llu,\"pid\":%i,\"tid\":%i}",
+                                  First?"":",",
+                                  Event->Name,
+                                  Phase,
+                                  Nanoseconds / 1000,
+                                  Nanoseconds % 1000,
+                                  GetCurrentProcessId(),
+                                  ThreadId);
+    }
+
+    if (Length <= 0) {
+        return FALSE;
+    }
+
+    YoriLibByteBufferAddToPopulatedLength(Output, Length);
+    return TRUE;
+}
+
+/**
+ Write all recorded events to a file in Chrome trace event JSON format.  The
+ file is placed in the directory specified by YORI_TRACE, and is named from
+ the executable name and process ID so that concurrent processes do not
+ overwrite each other.  Threads that are still running may continue to
+ record events while this occurs; any event recorded concurrently may or may
+ not be included.
+
+ @return TRUE to indicate the trace was written, FALSE if tracing is not
+         enabled or the trace could not be written.
+ */
+BOOLEAN
+YoriLibTraceWrite(VOID)
+{
+    YORI_LIB_BYTE_BUFFER Output;
+    YORI_STRING FileName;
+    YORI_STRING ModuleName;
+    TCHAR ModuleBuffer[MAX_PATH];
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_TRACE_THREAD_BUFFER Buffer;
+    LARGE_INTEGER Frequency;
+    DWORDLONG EventIndex;
+    DWORDLONG FirstEvent;
+    DWORD BytesWritten;
+    PUCHAR Dest;
+    HANDLE hFile;
+    LPTSTR FinalSep;
+    BOOLEAN First;
+    BOOLEAN Success;
+
+    if (!YoriLibTraceEnabled) {
+        return FALSE;
+    }
+
+    if (!QueryPerformanceFrequency(&Frequency) || Frequency.QuadPart == 0) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&ModuleName);
+    ModuleName.StartOfString = ModuleBuffer;
+    ModuleName.LengthAllocated = sizeof(ModuleBuffer)/sizeof(ModuleBuffer[0]);
+    ModuleName.LengthInChars = GetModuleFileName(NULL, ModuleBuffer, ModuleName.LengthAllocated);
+    if (ModuleName.LengthInChars == 0 || ModuleName.LengthInChars >= ModuleName.LengthAllocated) {
+        YoriLibConstantString(&ModuleName, _T("yori"));
+    } else {
+        FinalSep = YoriLibFindRightMostCharacter(&ModuleName, '\\');
+        if (FinalSep != NULL) {
+            ModuleName.LengthInChars = ModuleName.LengthInChars - (DWORD)(FinalSep - ModuleName.StartOfString + 1);
+            ModuleName.StartOfString = FinalSep + 1;
+        }
+    }
+
+    YoriLibInitEmptyString(&FileName);
+    if (YoriLibYPrintf(&FileName, _T("%y\\%y.%i.trace.json"), &YoriLibTraceGlobal.OutputDirectory, &ModuleName, GetCurrentProcessId()) < 0) {
+        return FALSE;
+    }
+
+    if (!YoriLibByteBufferInitialize(&Output, 1024 * 1024)) {
+        YoriLibFreeStringContents(&FileName);
+        return FALSE;
+    }
+
+    Success = FALSE;
+    Dest = YoriLibByteBufferGetPointerToEnd(&Output, 64, NULL);
+    if (Dest == NULL) {
+        goto Exit;
+    }
+    memcpy(Dest, "{\"traceEvents\":[", sizeof("{\"traceEvents\":[") - 1);
+    YoriLibByteBufferAddToPopulatedLength(&Output, sizeof("{\"traceEvents\":[") - 1);
+
+    First = TRUE;
+    WaitForSingleObject(YoriLibTraceGlobal.Mutex, INFINITE);
+    ListEntry = YoriLibGetNextListEntry(&YoriLibTraceGlobal.ThreadBuffers, NULL);
+    while (ListEntry != NULL) {
+        Buffer = CONTAINING_RECORD(ListEntry, YORI_LIB_TRACE_THREAD_BUFFER, ListEntry);
+
+        FirstEvent = 0;
+        if (Buffer->EventsWritten > Buffer->Capacity) {
+            FirstEvent = Buffer->EventsWritten - Buffer->Capacity;
+        }
+
+        for (EventIndex = FirstEvent; EventIndex < Buffer->EventsWritten; EventIndex++) {
+            if (!YoriLibTraceFormatEvent(&Output,
+                                         &Buffer->Events[(DWORD)(EventIndex % Buffer->Capacity)],
+                                         Buffer->ThreadId,
+                                         Frequency.QuadPart,
+                                         First)) {
+                ReleaseMutex(YoriLibTraceGlobal.Mutex);
+                goto Exit;
+            }
+            First = FALSE;
+        }
+
+        ListEntry = YoriLibGetNextListEntry(&YoriLibTraceGlobal.ThreadBuffers, ListEntry);
+    }
+    ReleaseMutex(YoriLibTraceGlobal.Mutex);
+
+    Dest = YoriLibByteBufferGetPointerToEnd(&Output, 64, NULL);
+    if (Dest == NULL) {
+        goto Exit;
+    }
+    memcpy(Dest, "\n],\"displayTimeUnit\":\"ms\"}\n", sizeof("\n],\"displayTimeUnit\":\"ms\"}\n") - 1);
+    YoriLibByteBufferAddToPopulatedLength(&Output, sizeof("\n],\"displayTimeUnit\":\"ms\"}\n") - 1);
+
+    hFile = CreateFile(FileName.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        goto Exit;
+    }
+
+    if (WriteFile(hFile, Output.Buffer, (DWORD)Output.BytesPopulated, &BytesWritten, NULL) &&
+        BytesWritten == (DWORD)Output.BytesPopulated) {
+
+        Success = TRUE;
+    }
+
+    CloseHandle(hFile);
+
+Exit:
+    YoriLibByteBufferCleanup(&Output);
+    YoriLibFreeStringContents(&FileName);
+    return Success;
+}
+
+/**
+ Write any trace for the process and stop recording events.  This is
+ intended to be called as the process exits.  Other threads may still be
+ running and may be partway through recording an event, so the per thread
+ buffers are not freed here and are reclaimed by process termination.
+ */
+VOID
+YoriLibTraceCleanup(VOID)
+{
+    if (!YoriLibTraceEnabled) {
+        return;
+    }
+
+    YoriLibTraceWrite();
+    YoriLibTraceEnabled = FALSE;
+    YoriLibFreeStringContents(&YoriLibTraceGlobal.OutputDirectory);
+}
+
+// vim:sw=4:ts=4:et:
@@ -182,6 +182,14 @@ typedef _Return_type_success_(return >= 0) long HRESULT;
 #define PROCESS_QUERY_LIMITED_INFORMATION  (0x1000)
 #endif
 
+#ifndef PROCESS_SUSPEND_RESUME
+/**
+ Definition for opening processes with access to suspend and resume them for
+ compilation environments that don't define it.
+ */
+#define PROCESS_SUSPEND_RESUME  (0x0800)
+#endif
+
 #ifndef SE_MANAGE_VOLUME_NAME
 /**
  Definition for manage volume privilege for compilation environments that
@@ -1084,15 +1092,30 @@ typedef struct _YORI_SYSTEM_PROCESS_INFORMATION {
      */
     DWORD_PTR ParentProcessId;
 
+    /**
+     The number of handles open in the process.
+     */
+    ULONG HandleCount;
+
+    /**
+     The session that the process is executing in.
+     */
+    ULONG SessionId;
+
     /**
      Ignored in this application.
      */
-    PVOID Reserved3[4];
+    PVOID Reserved3[3];
 
     /**
      Ignored in this application.
      */
-    ULONG Reserved4[3];
+    ULONG Reserved4;
+
+    /**
+     Ignored in this application.
+     */
+    SIZE_T PeakWorkingSetSize;
 
     /**
      The number of bytes in the working set of the process.
@@ -2219,6 +2242,13 @@ typedef struct _YORI_SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX {
 #define FSCTL_GET_REPARSE_POINT CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 42, METHOD_BUFFERED, FILE_ANY_ACCESS)
 #endif
 
+#ifndef FSCTL_SET_SPARSE
+/**
+ The FSCTL code to mark a file as sparse, if it's not already defined.
+ */
+#define FSCTL_SET_SPARSE CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 49, METHOD_BUFFERED, FILE_ANY_ACCESS)
+#endif
+
 #ifndef IO_REPARSE_TAG_MOUNT_POINT
 
 /**
@@ -3232,6 +3262,50 @@ typedef struct _YORI_FILE_RENAME_INFO {
     WCHAR FileName[1];
 } YORI_FILE_RENAME_INFO, *PYORI_FILE_RENAME_INFO;
 
+/**
+ The information level for GetFileAttributesEx which returns a
+ YORI_WIN32_FILE_ATTRIBUTE_DATA structure.
+ */
+#define YORI_GET_FILEEX_INFO_STANDARD (0)
+
+/**
+ Information about a file returned by GetFileAttributesEx.  This is defined
+ unconditionally with a different name because older compilers do not
+ include it.
+ */
+typedef struct _YORI_WIN32_FILE_ATTRIBUTE_DATA {
+
+    /**
+     The attributes of the file.
+     */
+    DWORD dwFileAttributes;
+
+    /**
+     The time the file was created.
+     */
+    FILETIME ftCreationTime;
+
+    /**
+     The time the file was last accessed.
+     */
+    FILETIME ftLastAccessTime;
+
+    /**
+     The time the file was last written.
+     */
+    FILETIME ftLastWriteTime;
+
+    /**
+     The high 32 bits of the file size.
+     */
+    DWORD nFileSizeHigh;
+
+    /**
+     The low 32 bits of the file size.
+     */
+    DWORD nFileSizeLow;
+} YORI_WIN32_FILE_ATTRIBUTE_DATA, *PYORI_WIN32_FILE_ATTRIBUTE_DATA;
+
 #ifndef STORAGE_INFO_FLAGS_ALIGNED_DEVICE
 
 /**
@@ -6534,6 +6608,18 @@ NT_QUERY_SYSTEM_INFORMATION(DWORD, PVOID, DWORD, PDWORD);
  */
 typedef NT_QUERY_SYSTEM_INFORMATION *PNT_QUERY_SYSTEM_INFORMATION;
 
+/**
+ A prototype for the NtResumeProcess function.
+ */
+typedef
+LONG WINAPI
+NT_RESUME_PROCESS(HANDLE);
+
+/**
+ A prototype for a pointer to the NtResumeProcess function.
+ */
+typedef NT_RESUME_PROCESS *PNT_RESUME_PROCESS;
+
 /**
  A prototype for the NtSetInformationFile function.
  */
@@ -6546,6 +6632,18 @@ NT_SET_INFORMATION_FILE(HANDLE, PIO_STATUS_BLOCK, PVOID, DWORD, DWORD);
  */
 typedef NT_SET_INFORMATION_FILE *PNT_SET_INFORMATION_FILE;
 
+/**
+ A prototype for the NtSuspendProcess function.
+ */
+typedef
+LONG WINAPI
+NT_SUSPEND_PROCESS(HANDLE);
+
+/**
+ A prototype for a pointer to the NtSuspendProcess function.
+ */
+typedef NT_SUSPEND_PROCESS *PNT_SUSPEND_PROCESS;
+
 /**
  A prototype for the NtSystemDebugControl function.
  */
@@ -6635,12 +6733,24 @@ typedef struct _YORI_NTDLL_FUNCTIONS {
      */
     PNT_QUERY_SYSTEM_INFORMATION pNtQuerySystemInformation;
 
+    /**
+     If it's available on the current system, a pointer to
+     NtResumeProcess.
+     */
+    PNT_RESUME_PROCESS pNtResumeProcess;
+
     /**
      If it's available on the current system, a pointer to
      NtSetInformationFile.
      */
     PNT_SET_INFORMATION_FILE pNtSetInformationFile;
 
+    /**
+     If it's available on the current system, a pointer to
+     NtSuspendProcess.
+     */
+    PNT_SUSPEND_PROCESS pNtSuspendProcess;
+
     /**
      If it's available on the current system, a pointer to
      NtSystemDebugControl.
@@ -6948,6 +7058,18 @@ GET_ENVIRONMENT_STRINGSW(VOID);
  */
 typedef GET_ENVIRONMENT_STRINGSW *PGET_ENVIRONMENT_STRINGSW;
 
+/**
+ A prototype for the GetFileAttributesExW function.
+ */
+typedef
+BOOL WINAPI
+GET_FILE_ATTRIBUTES_EXW(LPCWSTR, DWORD, PVOID);
+
+/**
+ A prototype for a pointer to the GetFileAttributesExW function.
+ */
+typedef GET_FILE_ATTRIBUTES_EXW *PGET_FILE_ATTRIBUTES_EXW;
+
 /**
  A prototype for the GetFileInformationByHandleEx function.
  */
@@ -7416,6 +7538,18 @@ SET_INFORMATION_JOB_OBJECT(HANDLE, DWORD, PVOID, DWORD);
  */
 typedef SET_INFORMATION_JOB_OBJECT *PSET_INFORMATION_JOB_OBJECT;
 
+/**
+ A prototype for the TerminateJobObject function.
+ */
+typedef
+BOOL WINAPI
+TERMINATE_JOB_OBJECT(HANDLE, UINT);
+
+/**
+ A prototype for a pointer to the TerminateJobObject function.
+ */
+typedef TERMINATE_JOB_OBJECT *PTERMINATE_JOB_OBJECT;
+
 /**
  A prototype for the WritePrivateProfileStringW function.
  */
@@ -7605,6 +7739,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PGET_ENVIRONMENT_STRINGSW pGetEnvironmentStringsW;
 
+    /**
+     If it's available on the current system, a pointer to GetFileAttributesExW.
+     */
+    PGET_FILE_ATTRIBUTES_EXW pGetFileAttributesExW;
+
     /**
      If it's available on the current system, a pointer to GetFileInformationByHandleEx.
      */
@@ -7800,6 +7939,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PSET_INFORMATION_JOB_OBJECT pSetInformationJobObject;
 
+    /**
+     If it's available on the current system, a pointer to TerminateJobObject.
+     */
+    PTERMINATE_JOB_OBJECT pTerminateJobObject;
+
     /**
      If it's available on the current system, a pointer to WritePrivateProfileStringW.
      */
@@ -97,6 +97,79 @@ typedef struct _YORI_LIB_BYTE_BUFFER {
 
 } YORI_LIB_BYTE_BUFFER, *PYORI_LIB_BYTE_BUFFER;
 
+/**
+ A buffer for a single data stream that is stored as a list of separately
+ allocated segments, and may be partially stored in a temporary file.
+ */
+typedef struct _YORI_LIB_SEGMENTED_BUFFER {
+
+    /**
+     A list of segments containing data held in memory.
+     */
+    YORI_LIST_ENTRY Segments;
+
+    /**
+     The number of bytes to allocate for each segment.
+     */
+    DWORD SegmentSize;
+
+    /**
+     The number of bytes to hold in memory before moving data to a temporary
+     file.  If zero, all data is held in memory.
+     */
+    DWORDLONG SpillThreshold;
+
+    /**
+     The total number of bytes of data in the buffer.
+     */
+    DWORDLONG BytesPopulated;
+
+    /**
+     The number of bytes of data held in memory.
+     */
+    DWORDLONG BytesInMemory;
+
+    /**
+     The number of bytes of data held in the temporary file.  This data
+     precedes all data held in memory.
+     */
+    DWORDLONG BytesSpilled;
+
+    /**
+     A handle to the temporary file, or NULL if no temporary file has been
+     created.
+     */
+    HANDLE SpillHandle;
+
+    /**
+     The name of the temporary file, so it can be deleted.
+     */
+    YORI_STRING SpillFileName;
+
+} YORI_LIB_SEGMENTED_BUFFER, *PYORI_LIB_SEGMENTED_BUFFER;
+
+/**
+ A contiguous range of data returned from a segmented buffer.
+ */
+typedef struct _YORI_LIB_BYTE_SLICE {
+
+    /**
+     A referenced allocation which contains the data.
+     */
+    PVOID MemoryToFree;
+
+    /**
+     Pointer to the first byte of the slice.
+     */
+    PUCHAR Data;
+
+    /**
+     The number of bytes in the slice.
+     */
+    DWORD Length;
+
+} YORI_LIB_BYTE_SLICE, *PYORI_LIB_BYTE_SLICE;
+
 /**
  A structure describing an entry that is an element of a hash table.
  */
@@ -117,6 +190,13 @@ typedef struct _YORI_HASH_ENTRY {
      table to identify the entry.
      */
     PVOID Context;
+
+    /**
+     The 32 bit hash of the key, as returned by @ref YoriLibHashString32
+     with an initial hash of zero.  This allows entries to be compared
+     without comparing strings.
+     */
+    DWORD Hash;
 } YORI_HASH_ENTRY, *PYORI_HASH_ENTRY;
 
 /**
@@ -495,6 +575,64 @@ YoriLibByteBufferAddToPopulatedLength(
     __in DWORDLONG NewBytesPopulated
     );
 
+VOID
+YoriLibSegmentedBufferInitialize(
+    __out PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in DWORD SegmentSize,
+    __in DWORDLONG SpillThreshold
+    );
+
+VOID
+YoriLibSegmentedBufferCleanup(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer
+    );
+
+__success(return != NULL)
+PUCHAR
+YoriLibSegmentedBufferGetPointerToEnd(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in DWORD MinimumLengthRequired,
+    __out_opt PDWORD BytesAvailable
+    );
+
+BOOLEAN
+YoriLibSegmentedBufferAddToPopulatedLength(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in DWORD NewBytesPopulated
+    );
+
+BOOLEAN
+YoriLibSegmentedBufferAppend(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in_bcount(Length) PVOID Data,
+    __in DWORD Length
+    );
+
+BOOLEAN
+YoriLibSegmentedBufferReadFromHandle(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in HANDLE hSource
+    );
+
+BOOLEAN
+YoriLibSegmentedBufferWriteToHandle(
+    __in PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in HANDLE hTarget
+    );
+
+__success(return)
+BOOLEAN
+YoriLibSegmentedBufferGetSlice(
+    __in PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in DWORDLONG Offset,
+    __out PYORI_LIB_BYTE_SLICE Slice
+    );
+
+VOID
+YoriLibSegmentedBufferFreeSlice(
+    __inout PYORI_LIB_BYTE_SLICE Slice
+    );
+
 // *** CABINET.C ***
 
 /**
@@ -2383,6 +2521,59 @@ YoriLibHashRemoveByKey(
     __in PYORI_STRING KeyString
     );
 
+VOID
+YoriLibHashInsertByHashedKey(
+    __in PYORI_HASH_TABLE HashTable,
+    __in PYORI_STRING KeyString,
+    __in DWORD Hash,
+    __in PVOID Context,
+    __out PYORI_HASH_ENTRY HashEntry
+    );
+
+PYORI_HASH_ENTRY
+YoriLibHashLookupByHashedKey(
+    __in PYORI_HASH_TABLE HashTable,
+    __in PCYORI_STRING KeyString,
+    __in DWORD Hash
+    );
+
+__success(return)
+BOOLEAN
+YoriLibInternString(
+    __in PYORI_HASH_TABLE InternTable,
+    __in PCYORI_STRING String,
+    __out PYORI_STRING InternedString
+    );
+
+DWORD
+YoriLibGetInternedStringHash(
+    __in PCYORI_STRING InternedString
+    );
+
+PCYORI_STRING
+YoriLibGetInternedStringFolded(
+    __in PCYORI_STRING InternedString
+    );
+
+BOOLEAN
+YoriLibAreInternedStringsEqualInsensitive(
+    __in PCYORI_STRING First,
+    __in PCYORI_STRING Second
+    );
+
+VOID
+YoriLibFreeInternTable(
+    __in PYORI_HASH_TABLE InternTable
+    );
+
+/**
+ Returns TRUE if two strings interned in the same table are identical.
+ Interned strings are shared, so this is a pointer comparison.
+ */
+#define YoriLibAreInternedStringsEqual(First, Second) \
+    ((First)->StartOfString == (Second)->StartOfString && \
+     (First)->LengthInChars == (Second)->LengthInChars)
+
 // *** HEXDUMP.C ***
 
 /**
@@ -2573,6 +2764,82 @@ YoriLibMultibyteInput(
     __in DWORD OutputBufferLength
     );
 
+// *** INI.C ***
+
+/**
+ An INI file which has been parsed into memory.  The structure of the
+ document is private to the library.
+ */
+typedef struct _YORI_LIB_INI_DOCUMENT *PYORI_LIB_INI_DOCUMENT;
+
+VOID
+YoriLibIniFree(
+    __in PYORI_LIB_INI_DOCUMENT Document
+    );
+
+__success(return)
+BOOLEAN
+YoriLibIniLoad(
+    __in PCYORI_STRING FileName,
+    __out PYORI_LIB_INI_DOCUMENT *Document
+    );
+
+DWORD
+YoriLibIniGetString(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in_opt LPCTSTR SectionName,
+    __in_opt LPCTSTR KeyName,
+    __in_opt LPCTSTR Default,
+    __out_ecount(BufferSize) LPTSTR Buffer,
+    __in DWORD BufferSize
+    );
+
+UINT
+YoriLibIniGetInt(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in LPCTSTR SectionName,
+    __in LPCTSTR KeyName,
+    __in INT Default
+    );
+
+DWORD
+YoriLibIniGetSection(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in LPCTSTR SectionName,
+    __out_ecount(BufferSize) LPTSTR Buffer,
+    __in DWORD BufferSize
+    );
+
+DWORD
+YoriLibIniGetSectionNames(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __out_ecount(BufferSize) LPTSTR Buffer,
+    __in DWORD BufferSize
+    );
+
+__success(return)
+BOOL
+YoriLibIniSetString(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in LPCTSTR SectionName,
+    __in_opt LPCTSTR KeyName,
+    __in_opt LPCTSTR Value
+    );
+
+__success(return)
+BOOL
+YoriLibIniSetSection(
+    __in PYORI_LIB_INI_DOCUMENT Document,
+    __in LPCTSTR SectionName,
+    __in_opt LPCTSTR KeyValuePairs
+    );
+
+__success(return)
+BOOLEAN
+YoriLibIniSave(
+    __in PYORI_LIB_INI_DOCUMENT Document
+    );
+
 // *** JOBOBJ.C ***
 
 HANDLE
@@ -2590,6 +2857,12 @@ YoriLibLimitJobObjectPriority(
     __in DWORD Priority
     );
 
+BOOL
+YoriLibTerminateJobObject(
+    __in HANDLE hJob,
+    __in DWORD ExitCode
+    );
+
 // *** LICENSE.C ***
 
 BOOL
@@ -2700,6 +2973,17 @@ YoriLibIsListEmpty(
 #define YORI_SPECIAL_HEAP 1
 #endif
 
+extern BOOLEAN YoriLibAllocProfileEnabled;
+
+BOOLEAN
+YoriLibAllocProfileInitialize(VOID);
+
+BOOLEAN
+YoriLibAllocProfileWrite(VOID);
+
+VOID
+YoriLibAllocProfileCleanup(VOID);
+
 #if YORI_SPECIAL_HEAP
 
 PVOID
@@ -2728,12 +3012,66 @@ YoriLibReferencedMallocSpecialHeap(
 #define YoriLibReferencedMalloc(Bytes) \
     YoriLibReferencedMallocSpecialHeap(Bytes, __FUNCTION__, __FILE__, __LINE__);
 
+/**
+ The special heap records the source location of each allocation, so the
+ caller is not used.
+ */
+#define YoriLibMallocForCaller(Bytes, CallSite) \
+    YoriLibMallocSpecialHeap(Bytes, __FUNCTION__, __FILE__, __LINE__);
+
+/**
+ The special heap records the source location of each allocation, so the
+ caller is not used.
+ */
+#define YoriLibReferencedMallocForCaller(Bytes, CallSite) \
+    YoriLibReferencedMallocSpecialHeap(Bytes, __FUNCTION__, __FILE__, __LINE__);
+
+/**
+ The special heap records the source location of each allocation, so the
+ caller is not captured.
+ */
+#define YoriLibAllocProfileCaller() NULL
+
 #else
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1300)
+PVOID _ReturnAddress(VOID);
+#pragma intrinsic(_ReturnAddress)
+
+/**
+ Return the address that the current function will return to, which is
+ used to identify the code that requested an allocation.  Library routines
+ which allocate memory for their callers capture this and pass it to
+ @ref YoriLibMallocForCaller so that allocations are attributed to the code
+ that called the library.
+ */
+#define YoriLibAllocProfileCaller() _ReturnAddress()
+#else
+
+/**
+ On compilers without a return address intrinsic, all allocations are
+ attributed to a single unknown call site.
+ */
+#define YoriLibAllocProfileCaller() NULL
+#endif
+
+PVOID
+YoriLibMallocForCaller(
+    __in DWORD Bytes,
+    __in_opt PVOID CallSite
+    );
+
 PVOID
 YoriLibMalloc(
     __in DWORD Bytes
     );
 
+PVOID
+YoriLibReferencedMallocForCaller(
+    __in DWORD Bytes,
+    __in_opt PVOID CallSite
+    );
+
 PVOID
 YoriLibReferencedMalloc(
     __in DWORD Bytes
@@ -2903,6 +3241,75 @@ YoriLibEnsureProcessSubsystemVersionAtLeast(
     __in WORD NewMinor
     );
 
+// *** PEIMAGE.C ***
+
+/**
+ A PE file that has been mapped into memory.
+ */
+typedef struct _YORI_LIB_PE_IMAGE {
+
+    /**
+     A handle to the file.
+     */
+    HANDLE FileHandle;
+
+    /**
+     A handle to the file mapping object.
+     */
+    HANDLE MappingHandle;
+
+    /**
+     The base address of the mapped view of the entire file.
+     */
+    PUCHAR Base;
+
+    /**
+     Pointer to the PE headers within the mapped view.
+     */
+    PYORILIB_PE_HEADERS PeHeaders;
+
+    /**
+     The size of the file, in bytes.
+     */
+    DWORD FileSize;
+
+    /**
+     TRUE if the file is mapped for write, so changes to the headers are
+     written back to the file.
+     */
+    BOOLEAN Writable;
+
+} YORI_LIB_PE_IMAGE, *PYORI_LIB_PE_IMAGE;
+
+__success(return == ERROR_SUCCESS)
+DWORD
+YoriLibPeImageOpen(
+    __in PCYORI_STRING FileName,
+    __in BOOLEAN Writable,
+    __out PYORI_LIB_PE_IMAGE Image
+    );
+
+VOID
+YoriLibPeImageClose(
+    __in PYORI_LIB_PE_IMAGE Image
+    );
+
+WORD
+YoriLibPeImageSumBuffer(
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    );
+
+DWORD
+YoriLibPeImageCalculateChecksum(
+    __in PYORI_LIB_PE_IMAGE Image
+    );
+
+DWORD
+YoriLibPeImageUpdateChecksum(
+    __in PYORI_LIB_PE_IMAGE Image
+    );
+
 
 // *** PRIV.C ***
 
@@ -2929,6 +3336,24 @@ YoriLibEnableTakeOwnershipPrivilege(VOID);
 
 // *** PROCESS.C ***
 
+/**
+ A capture of the processes in the system, indexed by process ID, image
+ name and parent process ID.  The structure is private to the library.
+ */
+typedef struct _YORI_LIB_PROCESS_SNAPSHOT *PYORI_LIB_PROCESS_SNAPSHOT;
+
+/**
+ A prototype for a callback function to invoke for each process found
+ within a process snapshot.  Return FALSE to stop enumerating.
+ */
+typedef BOOL YORILIB_PROCESS_ENUM_FN(PYORI_SYSTEM_PROCESS_INFORMATION Process, PVOID Context);
+
+/**
+ A pointer to a callback function to invoke for each process found within
+ a process snapshot.
+ */
+typedef YORILIB_PROCESS_ENUM_FN *PYORILIB_PROCESS_ENUM_FN;
+
 __success(return)
 BOOL
 YoriLibGetSystemProcessList(
@@ -2941,6 +3366,60 @@ YoriLibGetSystemHandlesList(
     __out PYORI_SYSTEM_HANDLE_INFORMATION_EX *HandlesInfo
     );
 
+__success(return)
+BOOL
+YoriLibCreateProcessSnapshot(
+    __out PYORI_LIB_PROCESS_SNAPSHOT *Snapshot
+    );
+
+VOID
+YoriLibFreeProcessSnapshot(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot
+    );
+
+PYORI_SYSTEM_PROCESS_INFORMATION
+YoriLibProcessSnapshotFindById(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in DWORD_PTR ProcessId
+    );
+
+DWORD
+YoriLibProcessSnapshotEnumerate(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in PYORILIB_PROCESS_ENUM_FN Callback,
+    __in_opt PVOID Context
+    );
+
+PYORI_SYSTEM_PROCESS_INFORMATION
+YoriLibProcessSnapshotFindParent(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in PYORI_SYSTEM_PROCESS_INFORMATION Process
+    );
+
+DWORD
+YoriLibProcessSnapshotEnumerateByName(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in PCYORI_STRING ImageName,
+    __in PYORILIB_PROCESS_ENUM_FN Callback,
+    __in_opt PVOID Context
+    );
+
+DWORD
+YoriLibProcessSnapshotEnumerateChildren(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in DWORD_PTR ParentProcessId,
+    __in PYORILIB_PROCESS_ENUM_FN Callback,
+    __in_opt PVOID Context
+    );
+
+DWORD
+YoriLibProcessSnapshotEnumerateTree(
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot,
+    __in DWORD_PTR RootProcessId,
+    __in PYORILIB_PROCESS_ENUM_FN Callback,
+    __in_opt PVOID Context
+    );
+
 // *** PROGMAN.C ***
 
 __success(return)
@@ -2961,6 +3440,70 @@ YoriLibRecycleBinFile(
     __in PYORI_STRING FilePath
     );
 
+// *** REGEX.C ***
+
+/**
+ A set of regular expressions compiled for matching.  The structure is
+ private to the library.
+ */
+typedef struct _YORI_LIB_REGEX *PYORI_LIB_REGEX;
+
+/**
+ Match all patterns without regard to case.
+ */
+#define YORI_LIB_REGEX_INSENSITIVE          0x00000001
+
+/**
+ The pattern is literal text rather than a regular expression.
+ */
+#define YORI_LIB_REGEX_PATTERN_LITERAL      0x00000001
+
+/**
+ The pattern must match at the start of the text.
+ */
+#define YORI_LIB_REGEX_PATTERN_ANCHOR_START 0x00000002
+
+/**
+ The pattern must match at the end of the text.
+ */
+#define YORI_LIB_REGEX_PATTERN_ANCHOR_END   0x00000004
+
+__success(return)
+BOOL
+YoriLibRegexCompile(
+    __in DWORD PatternCount,
+    __in_ecount(PatternCount) PCYORI_STRING Patterns,
+    __in_ecount_opt(PatternCount) PDWORD PatternFlags,
+    __in DWORD Flags,
+    __out PYORI_LIB_REGEX *Regex,
+    __out_opt PDWORD ErrorPattern,
+    __out_opt PDWORD ErrorOffset
+    );
+
+VOID
+YoriLibRegexFree(
+    __in PYORI_LIB_REGEX Regex
+    );
+
+__success(return)
+BOOLEAN
+YoriLibRegexMatchAny(
+    __in PYORI_LIB_REGEX Regex,
+    __in PCYORI_STRING Text,
+    __out_opt PDWORD PatternIndex
+    );
+
+__success(return)
+BOOLEAN
+YoriLibRegexFindFirst(
+    __in PYORI_LIB_REGEX Regex,
+    __in PCYORI_STRING Text,
+    __in DWORD StartOffset,
+    __out PDWORD MatchOffset,
+    __out PDWORD MatchLength,
+    __out_opt PDWORD PatternIndex
+    );
+
 // *** STRMENUM.C ***
 
 BOOL
@@ -2990,6 +3533,56 @@ YoriLibGetTempPath(
     __in DWORD ExtraChars
     );
 
+// *** TRACE.C ***
+
+extern BOOLEAN YoriLibTraceEnabled;
+
+BOOLEAN
+YoriLibTraceInitialize(VOID);
+
+VOID
+YoriLibTraceBegin(
+    __in LPCSTR Name
+    );
+
+VOID
+YoriLibTraceEnd(
+    __in LPCSTR Name
+    );
+
+VOID
+YoriLibTraceCounter(
+    __in LPCSTR Name,
+    __in LONGLONG Value
+    );
+
+BOOLEAN
+YoriLibTraceWrite(VOID);
+
+VOID
+YoriLibTraceCleanup(VOID);
+
+/**
+ Record the beginning of a traced region.  When tracing is not enabled this
+ is a single test of a global.
+ */
+#define YORI_TRACE_BEGIN(Name) \
+    do { if (YoriLibTraceEnabled) { YoriLibTraceBegin(Name); } } while(0)
+
+/**
+ Record the end of a traced region.  When tracing is not enabled this is a
+ single test of a global.
+ */
+#define YORI_TRACE_END(Name) \
+    do { if (YoriLibTraceEnabled) { YoriLibTraceEnd(Name); } } while(0)
+
+/**
+ Record the value of a counter.  When tracing is not enabled this is a
+ single test of a global.
+ */
+#define YORI_TRACE_COUNTER(Name, Value) \
+    do { if (YoriLibTraceEnabled) { YoriLibTraceCounter(Name, Value); } } while(0)
+
 // *** VT.C ***
 
 /**
@@ -3238,6 +3831,61 @@ typedef BOOL YORI_LIB_PATH_MATCH_FN(PYORI_STRING Match, PVOID Context);
  */
 typedef YORI_LIB_PATH_MATCH_FN *PYORI_LIB_PATH_MATCH_FN;
 
+/**
+ A decomposed form of the PathExt environment variable, containing an array
+ of this structure, indicating the extension name as a counted string and
+ a boolean flag to indicate whether or not a match was found.  This allows
+ a searcher to enumerate all files marking what was found, then later checking
+ which one should be "first."
+ */
+typedef struct _YORI_PATHEXT_COMPONENT {
+
+    /**
+     The extension to search for.
+     */
+    YORI_STRING Extension;
+
+    /**
+     Set to TRUE if the extension was found, remains FALSE if it was not.
+     */
+    BOOL Found;
+} YORI_PATHEXT_COMPONENT, *PYORI_PATHEXT_COMPONENT;
+
+__success(return)
+BOOL
+YoriLibLocateBuildFullName(
+    __in PYORI_STRING SearchPath,
+    __in PWIN32_FIND_DATA Match,
+    __inout PYORI_STRING Out,
+    __in BOOL FullPath
+    );
+
+__success(return != NULL)
+PYORI_PATHEXT_COMPONENT
+YoriLibPathBuildPathExtComponentList(
+    __out PDWORD ComponentCount
+    );
+
+VOID
+YoriLibPathFreePathExtComponents(
+    __in PYORI_PATHEXT_COMPONENT PathExtComponents,
+    __in DWORD PathExtComponentCount
+    );
+
+__success(return)
+BOOL
+YoriLibLocateFileExtensionsInOnePath(
+    __in PYORI_STRING FileName,
+    __in PYORI_STRING SearchPath,
+    __in PYORI_STRING ScratchArea,
+    __inout PYORI_PATHEXT_COMPONENT PathExtData,
+    __in DWORD PathExtCount,
+    __in_opt PYORI_LIB_PATH_MATCH_FN MatchAllCallback,
+    __in_opt PVOID MatchAllContext,
+    __inout PYORI_STRING Out,
+    __in BOOL FullPath
+    );
+
 __success(return)
 BOOL
 YoriLibPathLocateKnownExtensionUnknownLocation(
@@ -3277,6 +3925,20 @@ YoriLibLocateExecutableInPath(
     __out _When_(MatchAllCallback != NULL, _Post_invalid_) PYORI_STRING PathName
     );
 
+// *** PATHIDX.C ***
+
+BOOLEAN
+YoriLibPathIndexIsEnabled(VOID);
+
+__success(return)
+BOOL
+YoriLibPathIndexLocate(
+    __in PYORI_STRING SearchFor,
+    __in PCYORI_STRING PathVariable,
+    __in PYORI_PATHEXT_COMPONENT PathExtComponents,
+    __in DWORD PathExtCount,
+    __inout PYORI_STRING FoundPath
+    );
 
 // *** PRINTF.C ***
 
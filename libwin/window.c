@@ -3,7 +3,7 @@
  *
  * Yori display an overlapping window
  *
- * Copyright (c) 2019-2020 Malcolm J. Smith
+ * Copyright (c) 2019-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -111,6 +111,17 @@ typedef struct _YORI_WIN_WINDOW {
      */
     PYORI_WIN_NOTIFY_WINDOW_MANAGER_RESIZE WindowManagerResizeNotifyCallback;
 
+    /**
+     Optionally points to a callback function to invoke periodically.
+     */
+    PYORI_WIN_NOTIFY_WINDOW_TIMER TimerNotifyCallback;
+
+    /**
+     The timer used to invoke TimerNotifyCallback, or NULL if no timer is
+     active.
+     */
+    PYORI_WIN_CTRL_HANDLE Timer;
+
     /**
      An array of callbacks that can be invoked when particular events occur
      in the window, which were not processed by any control on the window.
@@ -729,6 +740,11 @@ YoriWinDestroyWindow(
 
     YoriWinMgrNotifyWindowDestroy(Window->WinMgrHandle, Window);
 
+    if (Window->Timer != NULL) {
+        YoriWinMgrFreeTimer(Window->Timer);
+        Window->Timer = NULL;
+    }
+
     if (Window->Contents != NULL) {
         YoriLibFree(Window->Contents);
         Window->Contents = NULL;
@@ -1987,6 +2003,49 @@ YoriWinSetWindowManagerResizeNotifyCallback(
     return TRUE;
 }
 
+/**
+ Set a callback to invoke periodically while the window exists.  This allows
+ a window to display the results of work performed asynchronously without
+ waiting for input.
+
+ @param WindowHandle Pointer to the window to invoke a callback from.
+
+ @param PeriodicInterval The time in milliseconds between each invocation.
+
+ @param NotifyCallback A function to invoke when the interval elapses, or
+        NULL to stop invoking a previously registered function.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriWinSetWindowTimerNotifyCallback(
+    __in PYORI_WIN_WINDOW_HANDLE WindowHandle,
+    __in DWORD PeriodicInterval,
+    __in_opt PYORI_WIN_NOTIFY_WINDOW_TIMER NotifyCallback
+    )
+{
+    PYORI_WIN_WINDOW Window;
+    Window = (PYORI_WIN_WINDOW)WindowHandle;
+
+    if (Window->Timer != NULL) {
+        YoriWinMgrFreeTimer(Window->Timer);
+        Window->Timer = NULL;
+    }
+
+    Window->TimerNotifyCallback = NotifyCallback;
+    if (NotifyCallback == NULL) {
+        return TRUE;
+    }
+
+    Window->Timer = YoriWinMgrAllocateRecurringTimer(Window->WinMgrHandle, &Window->Ctrl, PeriodicInterval);
+    if (Window->Timer == NULL) {
+        Window->TimerNotifyCallback = NULL;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /**
  Set a callback to be invoked when an event occurs on the window that is not
  explicitly handled by a control.  As of this writing, only one callback can
@@ -2467,6 +2526,12 @@ YoriWinNotifyEvent(
         if (Window->WindowManagerResizeNotifyCallback != NULL) {
             Window->WindowManagerResizeNotifyCallback(Window, &Event->WindowManagerResize.OldWinMgrDimensions, &Event->WindowManagerResize.NewWinMgrDimensions);
         }
+    } else if (Event->EventType == YoriWinEventTimer) {
+        if (Window->TimerNotifyCallback != NULL &&
+            Event->Timer.Timer == Window->Timer) {
+
+            Window->TimerNotifyCallback(Window);
+        }
     }
 
     if (Window->CustomNotifications != NULL &&
@@ -4,7 +4,7 @@
  * Header for control and window toolkit routines that may be of value from
  * the shell as well as external tools.
  *
- * Copyright (c) 2019-2022 Malcolm J. Smith
+ * Copyright (c) 2019-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -1057,6 +1057,16 @@ typedef VOID YORI_WIN_NOTIFY_WINDOW_MANAGER_RESIZE(PYORI_WIN_WINDOW_HANDLE, PSMA
  */
 typedef YORI_WIN_NOTIFY_WINDOW_MANAGER_RESIZE *PYORI_WIN_NOTIFY_WINDOW_MANAGER_RESIZE;
 
+/**
+ A function prototype that can be invoked periodically on a window.
+ */
+typedef VOID YORI_WIN_NOTIFY_WINDOW_TIMER(PYORI_WIN_WINDOW_HANDLE);
+
+/**
+ A pointer to a function that can be invoked periodically on a window.
+ */
+typedef YORI_WIN_NOTIFY_WINDOW_TIMER *PYORI_WIN_NOTIFY_WINDOW_TIMER;
+
 VOID
 YoriWinCloseWindow(
     __in PYORI_WIN_WINDOW_HANDLE WindowHandle,
@@ -1085,6 +1095,13 @@ YoriWinSetWindowManagerResizeNotifyCallback(
     __in PYORI_WIN_NOTIFY_WINDOW_MANAGER_RESIZE NotifyCallback
     );
 
+BOOLEAN
+YoriWinSetWindowTimerNotifyCallback(
+    __in PYORI_WIN_WINDOW_HANDLE WindowHandle,
+    __in DWORD PeriodicInterval,
+    __in_opt PYORI_WIN_NOTIFY_WINDOW_TIMER NotifyCallback
+    );
+
 PYORI_WIN_WINDOW_MANAGER_HANDLE
 YoriWinGetWindowManagerHandle(
     __in PYORI_WIN_WINDOW_HANDLE WindowHandle
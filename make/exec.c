@@ -1044,6 +1044,7 @@ MakeExecuteRequiredTargets(
                     goto Drain;
                 }
                 NumberActiveProcesses++;
+                YORI_TRACE_COUNTER("Make active processes", NumberActiveProcesses);
             }
         }
 
@@ -1114,6 +1115,7 @@ MakeExecuteRequiredTargets(
                 }
 
                 NumberActiveProcesses--;
+                YORI_TRACE_COUNTER("Make active processes", NumberActiveProcesses);
 
                 //
                 //  Everything in the final entry has been moved to earlier
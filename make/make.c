@@ -447,6 +447,12 @@ ENTRYPOINT(
         goto Cleanup;
     }
 
+    MakeContext.VariableNames = YoriLibAllocateHashTable(1000);
+    if (MakeContext.VariableNames == NULL) {
+        Result = EXIT_FAILURE;
+        goto Cleanup;
+    }
+
     for (i = 1; i < ArgC; i++) {
 
         ArgumentUnderstood = FALSE;
@@ -739,9 +745,11 @@ ENTRYPOINT(
     //  Preprocess the makefile
     //
 
+    YORI_TRACE_BEGIN("Make preprocess");
     QueryPerformanceCounter(&StartTime);
     MakeProcessStream(hStream, &MakeContext, &FullFileName);
     QueryPerformanceCounter(&EndTime);
+    YORI_TRACE_END("Make preprocess");
 
     MakeContext.TimeInPreprocessor = EndTime.QuadPart - StartTime.QuadPart;
 
@@ -758,6 +766,7 @@ ENTRYPOINT(
     //  Determine the tasks to execute
     //
 
+    YORI_TRACE_BEGIN("Make build graph");
     QueryPerformanceCounter(&StartTime);
 
     //
@@ -783,6 +792,7 @@ ENTRYPOINT(
                 ThisArg = &ArgV[i];
 
                 if (!MakeMarkCommandLineTargetForBuild(&MakeContext, ThisArg)) {
+                    YORI_TRACE_END("Make build graph");
                     YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Could not determine how to build target %y\n"), ThisArg);
                     Result = EXIT_FAILURE;
                     goto Cleanup;
@@ -805,6 +815,7 @@ ENTRYPOINT(
 
     if (!ExplicitTargetFound) {
         if (!MakeDetermineDependencies(&MakeContext)) {
+            YORI_TRACE_END("Make build graph");
             Result = EXIT_FAILURE;
             goto Cleanup;
         }
@@ -812,25 +823,30 @@ ENTRYPOINT(
 
     QueryPerformanceCounter(&EndTime);
     MakeContext.TimeBuildingGraph = EndTime.QuadPart - StartTime.QuadPart;
+    YORI_TRACE_END("Make build graph");
 
     //
     //  Execute the tasks
     //
 
+    YORI_TRACE_BEGIN("Make execute");
     StartTime.QuadPart = EndTime.QuadPart;
     if (!MakeExecuteRequiredTargets(&MakeContext)) {
+        YORI_TRACE_END("Make execute");
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Failed to build targets.\n"));
         Result = EXIT_FAILURE;
         goto Cleanup;
     }
     QueryPerformanceCounter(&EndTime);
     MakeContext.TimeInExecute = EndTime.QuadPart - StartTime.QuadPart;
+    YORI_TRACE_END("Make execute");
 
 
     Result = EXIT_SUCCESS;
 
 Cleanup:
 
+    YORI_TRACE_BEGIN("Make cleanup");
     QueryPerformanceCounter(&StartTime);
 
     MakeDeleteInlineFiles(&MakeContext);
@@ -855,6 +871,10 @@ Cleanup:
     MakeDeleteAllScopes(&MakeContext);
     MakeSaveAndDeleteAllPreprocessorCacheEntries(&MakeContext, &FullFileName);
 
+    if (MakeContext.VariableNames != NULL) {
+        YoriLibFreeInternTable(MakeContext.VariableNames);
+    }
+
     YoriLibFreeStringContents(&FullFileName);
 
     YoriLibFreeStringContents(&MakeContext.TempPath);
@@ -872,6 +892,7 @@ Cleanup:
 
     QueryPerformanceCounter(&EndTime);
     MakeContext.TimeInCleanup = EndTime.QuadPart - StartTime.QuadPart;
+    YORI_TRACE_END("Make cleanup");
 
     if (MakeContext.PerfDisplay && Result == EXIT_SUCCESS) {
         LARGE_INTEGER Frequency;
@@ -670,6 +670,13 @@ typedef struct _MAKE_CONTEXT {
      */
     PYORI_HASH_TABLE Targets;
 
+    /**
+     An intern table of variable names.  The same variable names tend to be
+     defined in every scope, so each scope refers to a single shared copy of
+     each name with a precomputed hash.
+     */
+    PYORI_HASH_TABLE VariableNames;
+
     /**
      A list of known targets, used to facilitate bulk delete.
      */
@@ -135,12 +135,20 @@ MakeLookupVariable(
     PYORI_HASH_ENTRY FoundVariableEntry;
     PMAKE_SCOPE_CONTEXT SearchScopeContext;
     PMAKE_VARIABLE FoundVariable;
+    DWORD Hash;
 
     SearchScopeContext = ScopeContext;
     FoundVariable = NULL;
 
+    //
+    //  The same name is searched for in each parent scope, so only hash
+    //  it once.
+    //
+
+    Hash = YoriLibHashString32(0, Variable);
+
     do {
-        FoundVariableEntry = YoriLibHashLookupByKey(SearchScopeContext->Variables, Variable);
+        FoundVariableEntry = YoriLibHashLookupByHashedKey(SearchScopeContext->Variables, Variable, Hash);
         if (FoundVariableEntry != NULL) {
             FoundVariable = FoundVariableEntry->Context;
             break;
@@ -583,38 +591,37 @@ MakeSetVariable(
         }
 
     } else {
-        YORI_STRING VariableNameCopy;
+        YORI_STRING VariableName;
         DWORD LengthNeeded;
 
-        LengthNeeded = Variable->LengthInChars;
+        //
+        //  The hash package will clone (reference) the string rather than
+        //  copy it.  Variable names are shared across every scope that
+        //  defines them, so use the interned copy of the name, which also
+        //  carries its hash.
+        //
+
+        if (!YoriLibInternString(ScopeContext->MakeContext->VariableNames, Variable, &VariableName)) {
+            return FALSE;
+        }
+
+        LengthNeeded = 0;
         if (Value != NULL) {
-            LengthNeeded = LengthNeeded + Value->LengthInChars;
+            LengthNeeded = Value->LengthInChars;
         }
 
         FoundVariable = YoriLibReferencedMalloc(sizeof(MAKE_VARIABLE) + LengthNeeded * sizeof(TCHAR));
         if (FoundVariable == NULL) {
+            YoriLibFreeStringContents(&VariableName);
             return FALSE;
         }
         ScopeContext->MakeContext->AllocVariable++;
 
-        //
-        //  The hash package will clone (reference) the string rather than
-        //  copy it.  It has to be copied somewhere, so we copy it here, into
-        //  the same allocation used to hold the value.  Note the variable
-        //  name is effectively immutable, so we don't need referencing or
-        //  to support reallocation.
-        //
-
-        YoriLibInitEmptyString(&VariableNameCopy);
-        VariableNameCopy.StartOfString = (LPTSTR)(FoundVariable + 1);
-        memcpy(VariableNameCopy.StartOfString, Variable->StartOfString, Variable->LengthInChars * sizeof(TCHAR));
-        VariableNameCopy.LengthInChars = Variable->LengthInChars;
-
         YoriLibInitEmptyString(&FoundVariable->Value);
         if (Value != NULL) {
             YoriLibReference(FoundVariable);
             FoundVariable->Value.MemoryToFree = FoundVariable;
-            FoundVariable->Value.StartOfString = VariableNameCopy.StartOfString + VariableNameCopy.LengthInChars;
+            FoundVariable->Value.StartOfString = (LPTSTR)(FoundVariable + 1);
             memcpy(FoundVariable->Value.StartOfString, Value->StartOfString, Value->LengthInChars * sizeof(TCHAR));
             FoundVariable->Value.LengthAllocated = Value->LengthInChars;
             FoundVariable->Value.LengthInChars = Value->LengthInChars;
@@ -628,7 +635,12 @@ MakeSetVariable(
 
         FoundVariable->Precedence = Precedence;
 
-        YoriLibHashInsertByKey(ScopeContext->Variables, &VariableNameCopy, FoundVariable, &FoundVariable->HashEntry);
+        YoriLibHashInsertByHashedKey(ScopeContext->Variables,
+                                     &VariableName,
+                                     YoriLibGetInternedStringHash(&VariableName),
+                                     FoundVariable,
+                                     &FoundVariable->HashEntry);
+        YoriLibFreeStringContents(&VariableName);
         YoriLibInsertList(&ScopeContext->VariableList, &FoundVariable->ListEntry);
     }
 
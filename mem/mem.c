@@ -3,7 +3,7 @@
  *
  * Yori shell display memory usage
  *
- * Copyright (c) 2019-2023 Malcolm J. Smith
+ * Copyright (c) 2019-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -35,10 +35,13 @@ CHAR strMemHelpText[] =
         "\n"
         "Display memory usage.\n"
         "\n"
-        "MEM [-license] [-c [-g]] [<fmt>]\n"
+        "MEM [-license] [-c [-g] [-n <count>] [-r] [-s <column>]] [<fmt>]\n"
         "\n"
         "   -c             Display memory usage of processes the user has access to\n"
         "   -g             Count all processes with the same name together\n"
+        "   -n             Only display the first <count> processes\n"
+        "   -r             Display processes as comma delimited values in bytes\n"
+        "   -s             Sort processes by commit, id, name, total or workingset\n"
         "\n"
         "Format specifiers are:\n"
         "   $AVAILABLECOMMIT$      The amount of memory that the system has available\n"
@@ -232,98 +235,362 @@ MemExpandVariables(
 }
 
 /**
- If the user has requested it, go through the set of found processes, and
- merge later entries with the same image name into the first entry.  On
- successful completion, update the count of processes to be reduced by the
- number of merges performed.
+ The columns that process memory usage can be sorted by.
+ */
+typedef enum _MEM_SORT_ORDER {
+    MemSortTotal = 0,
+    MemSortWorkingSet = 1,
+    MemSortCommit = 2,
+    MemSortName = 3,
+    MemSortId = 4
+} MEM_SORT_ORDER;
+
+/**
+ Information about a single process, or a group of processes with the same
+ image name, to display.
+ */
+typedef struct _MEM_PROCESS_ENTRY {
+
+    /**
+     The image name of the process.  This points into the process list
+     returned from the system.
+     */
+    YORI_STRING ImageName;
+
+    /**
+     The case insensitive hash of the image name.
+     */
+    DWORD Hash;
+
+    /**
+     When grouping, the index of the next entry in the same hash bucket.
+     */
+    DWORD NextInBucket;
+
+    /**
+     The process ID.  When grouping, this is the lowest process ID within
+     the group.
+     */
+    DWORD_PTR ProcessId;
+
+    /**
+     The number of processes described by this entry.
+     */
+    DWORD ProcessCount;
+
+    /**
+     The number of bytes in the working set of the process or group.
+     */
+    LONGLONG WorkingSetSize;
+
+    /**
+     The number of bytes committed by the process or group.
+     */
+    LONGLONG CommitSize;
+
+} MEM_PROCESS_ENTRY, *PMEM_PROCESS_ENTRY;
+
+/**
+ A value used to terminate a chain of entries within a hash bucket.
+ */
+#define MEM_BUCKET_END ((DWORD)-1)
+
+/**
+ Options controlling how process memory usage is displayed.
+ */
+typedef struct _MEM_PROCESS_OPTIONS {
+
+    /**
+     If TRUE, processes with the same image name are combined.
+     */
+    BOOLEAN GroupProcesses;
+
+    /**
+     If TRUE, output is comma delimited with sizes in bytes, so it can be
+     consumed by other programs.
+     */
+    BOOLEAN RawOutput;
+
+    /**
+     The column to sort by.
+     */
+    MEM_SORT_ORDER SortOrder;
+
+    /**
+     The maximum number of entries to display, or zero to display all.
+     */
+    DWORD MaximumEntries;
+
+} MEM_PROCESS_OPTIONS, *PMEM_PROCESS_OPTIONS;
+
+/**
+ Determine whether one entry should be displayed before another.
+
+ @param SortOrder The column to sort by.
+
+ @param GroupProcesses If TRUE, entries describe groups of processes, and
+        the ID column contains a process count.
+
+ @param First The first entry to compare.
+
+ @param Second The second entry to compare.
+
+ @return TRUE if First should be displayed before Second.
+ */
+BOOLEAN
+MemEntryPrecedes(
+    __in MEM_SORT_ORDER SortOrder,
+    __in BOOLEAN GroupProcesses,
+    __in PMEM_PROCESS_ENTRY First,
+    __in PMEM_PROCESS_ENTRY Second
+    )
+{
+    LONGLONG FirstValue;
+    LONGLONG SecondValue;
+    int NameCompare;
+
+    //
+    //  Sizes and counts are displayed largest first.  Names and process
+    //  IDs are displayed smallest first.
+    //
+
+    switch(SortOrder) {
+        case MemSortWorkingSet:
+            FirstValue = First->WorkingSetSize;
+            SecondValue = Second->WorkingSetSize;
+            break;
+        case MemSortCommit:
+            FirstValue = First->CommitSize;
+            SecondValue = Second->CommitSize;
+            break;
+        case MemSortName:
+            FirstValue = 0;
+            SecondValue = 0;
+            break;
+        case MemSortId:
+            if (GroupProcesses) {
+                FirstValue = First->ProcessCount;
+                SecondValue = Second->ProcessCount;
+            } else {
+                FirstValue = -(LONGLONG)First->ProcessId;
+                SecondValue = -(LONGLONG)Second->ProcessId;
+            }
+            break;
+        default:
+            FirstValue = First->WorkingSetSize + First->CommitSize;
+            SecondValue = Second->WorkingSetSize + Second->CommitSize;
+            break;
+    }
+
+    if (FirstValue != SecondValue) {
+        return (BOOLEAN)(FirstValue > SecondValue);
+    }
+
+    NameCompare = YoriLibCompareStringInsensitive(&First->ImageName, &Second->ImageName);
+    if (NameCompare != 0) {
+        return (BOOLEAN)(NameCompare < 0);
+    }
+
+    return (BOOLEAN)(First->ProcessId < Second->ProcessId);
+}
+
+/**
+ Move an entry down a heap until it is in the correct position.  The entry
+ at the top of the heap is the entry to display first.
+
+ @param Options Pointer to the options describing the sort order.
+
+ @param Heap Pointer to the array of entries forming the heap.
+
+ @param HeapSize The number of entries in the heap.
+
+ @param Index The index of the entry to move.
+ */
+VOID
+MemSiftDown(
+    __in PMEM_PROCESS_OPTIONS Options,
+    __inout_ecount(HeapSize) PMEM_PROCESS_ENTRY *Heap,
+    __in DWORD HeapSize,
+    __in DWORD Index
+    )
+{
+    PMEM_PROCESS_ENTRY Entry;
+    DWORD Child;
+
+    Entry = Heap[Index];
+    while (TRUE) {
+        Child = Index * 2 + 1;
+        if (Child >= HeapSize) {
+            break;
+        }
+
+        if (Child + 1 < HeapSize &&
+            MemEntryPrecedes(Options->SortOrder, Options->GroupProcesses, Heap[Child + 1], Heap[Child])) {
+
+            Child++;
+        }
+
+        if (!MemEntryPrecedes(Options->SortOrder, Options->GroupProcesses, Heap[Child], Entry)) {
+            break;
+        }
+
+        Heap[Index] = Heap[Child];
+        Index = Child;
+    }
+
+    Heap[Index] = Entry;
+}
+
+/**
+ Go through the set of found processes and populate an entry for each.  If
+ the user has requested it, processes with the same image name are combined
+ into a single entry.  This uses a hash of the image name so that each
+ process is only compared against entries that may have the same name.
 
  @param ProcessInfo Pointer to a linked list of processes.
 
- @param NumberOfProcesses Pointer to a count of the number of processes.
+ @param GroupProcesses If TRUE, combine processes with the same name.
+
+ @param Entries On successful completion, populated with an array of
+        entries.  The caller should free this with YoriLibFree.
+
+ @param NumberOfEntries On successful completion, populated with the number
+        of entries in the array.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
+__success(return)
 BOOL
-MemGroupProcessNames(
-    __inout PYORI_SYSTEM_PROCESS_INFORMATION ProcessInfo,
-    __inout PDWORD NumberOfProcesses
+MemBuildProcessEntries(
+    __in PYORI_SYSTEM_PROCESS_INFORMATION ProcessInfo,
+    __in BOOLEAN GroupProcesses,
+    __out PMEM_PROCESS_ENTRY *Entries,
+    __out PDWORD NumberOfEntries
     )
 {
-    PYORI_SYSTEM_PROCESS_INFORMATION FirstEntryWithName;
     PYORI_SYSTEM_PROCESS_INFORMATION CurrentEntry;
-    PYORI_SYSTEM_PROCESS_INFORMATION PreviousEntry;
-    DWORD ProcessCount;
-    YORI_STRING PrimaryName;
-    YORI_STRING FoundName;
+    PMEM_PROCESS_ENTRY LocalEntries;
+    PMEM_PROCESS_ENTRY Entry;
+    PDWORD Buckets;
+    YORI_STRING ImageName;
+    DWORD NumberOfProcesses;
+    DWORD BucketCount;
+    DWORD EntryCount;
+    DWORD Hash;
+    DWORD Index;
 
-    YoriLibInitEmptyString(&PrimaryName);
-    YoriLibInitEmptyString(&FoundName);
-    FirstEntryWithName = ProcessInfo;
-    ProcessCount = *NumberOfProcesses;
+    //
+    //  Count the number of processes so we can allocate the entries and
+    //  buckets.
+    //
 
+    NumberOfProcesses = 0;
+    CurrentEntry = ProcessInfo;
     do {
+        NumberOfProcesses++;
+        if (CurrentEntry->NextEntryOffset == 0) {
+            break;
+        }
+        CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
+    } while(TRUE);
 
-        PrimaryName.StartOfString = FirstEntryWithName->ImageName;
-        PrimaryName.LengthInChars = FirstEntryWithName->ImageNameLengthInBytes / sizeof(WCHAR);
+    BucketCount = NumberOfProcesses | 1;
+    LocalEntries = YoriLibMalloc(NumberOfProcesses * sizeof(MEM_PROCESS_ENTRY) + BucketCount * sizeof(DWORD));
+    if (LocalEntries == NULL) {
+        return FALSE;
+    }
 
-        FirstEntryWithName->ProcessId = 1;
-        CurrentEntry = FirstEntryWithName;
-        PreviousEntry = CurrentEntry;
+    Buckets = (PDWORD)(LocalEntries + NumberOfProcesses);
+    for (Index = 0; Index < BucketCount; Index++) {
+        Buckets[Index] = MEM_BUCKET_END;
+    }
 
-        while (CurrentEntry->NextEntryOffset != 0) {
+    YoriLibInitEmptyString(&ImageName);
+    EntryCount = 0;
+    CurrentEntry = ProcessInfo;
+    do {
+        ImageName.StartOfString = CurrentEntry->ImageName;
+        ImageName.LengthInChars = CurrentEntry->ImageNameLengthInBytes / sizeof(WCHAR);
 
-            CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
-            FoundName.StartOfString = CurrentEntry->ImageName;
-            FoundName.LengthInChars = CurrentEntry->ImageNameLengthInBytes / sizeof(WCHAR);
+        //
+        //  If grouping, look for an existing entry with this name and add
+        //  to it.
+        //
 
-            if (YoriLibCompareStringInsensitive(&PrimaryName, &FoundName) == 0) {
-                FirstEntryWithName->WorkingSetSize += CurrentEntry->WorkingSetSize;
-                FirstEntryWithName->CommitSize += CurrentEntry->CommitSize;
-                FirstEntryWithName->ProcessId++;
-                if (CurrentEntry->NextEntryOffset == 0) {
-                    PreviousEntry->NextEntryOffset = 0;
-                } else {
-                    PreviousEntry->NextEntryOffset += CurrentEntry->NextEntryOffset;
+        Entry = NULL;
+        Hash = 0;
+        if (GroupProcesses) {
+            Hash = YoriLibHashString32(0, &ImageName);
+            Index = Buckets[Hash % BucketCount];
+            while (Index != MEM_BUCKET_END) {
+                Entry = &LocalEntries[Index];
+                if (Entry->Hash == Hash &&
+                    Entry->ImageName.LengthInChars == ImageName.LengthInChars &&
+                    YoriLibCompareStringInsensitive(&Entry->ImageName, &ImageName) == 0) {
+
+                    break;
                 }
-                ProcessCount--;
-            } else {
-                PreviousEntry = CurrentEntry;
+                Entry = NULL;
+                Index = LocalEntries[Index].NextInBucket;
             }
         }
 
-        if (FirstEntryWithName->NextEntryOffset == 0) {
-            break;
+        if (Entry != NULL) {
+            Entry->ProcessCount++;
+            Entry->WorkingSetSize += CurrentEntry->WorkingSetSize;
+            Entry->CommitSize += CurrentEntry->CommitSize;
+            if (CurrentEntry->ProcessId < Entry->ProcessId) {
+                Entry->ProcessId = CurrentEntry->ProcessId;
+            }
+        } else {
+            Entry = &LocalEntries[EntryCount];
+            YoriLibInitEmptyString(&Entry->ImageName);
+            Entry->ImageName.StartOfString = ImageName.StartOfString;
+            Entry->ImageName.LengthInChars = ImageName.LengthInChars;
+            Entry->Hash = Hash;
+            Entry->ProcessId = CurrentEntry->ProcessId;
+            Entry->ProcessCount = 1;
+            Entry->WorkingSetSize = CurrentEntry->WorkingSetSize;
+            Entry->CommitSize = CurrentEntry->CommitSize;
+            if (GroupProcesses) {
+                Entry->NextInBucket = Buckets[Hash % BucketCount];
+                Buckets[Hash % BucketCount] = EntryCount;
+            }
+            EntryCount++;
         }
 
-        FirstEntryWithName = YoriLibAddToPointer(FirstEntryWithName, FirstEntryWithName->NextEntryOffset);
-    } while (TRUE);
-
-    *NumberOfProcesses = ProcessCount;
+        if (CurrentEntry->NextEntryOffset == 0) {
+            break;
+        }
+        CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
+    } while(TRUE);
 
+    *Entries = LocalEntries;
+    *NumberOfEntries = EntryCount;
     return TRUE;
 }
 
-
 /**
  Display the memory used by all processes that the current user has access
  to.
 
+ @param Options Pointer to options describing how to display processes.
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
 MemDisplayProcessMemoryUsage(
-    __in BOOLEAN GroupProcesses
+    __in PMEM_PROCESS_OPTIONS Options
     )
 {
-    PYORI_SYSTEM_PROCESS_INFORMATION ProcessInfo = NULL;
-    PYORI_SYSTEM_PROCESS_INFORMATION CurrentEntry;
-    DWORD BytesReturned;
-    DWORD BytesAllocated;
-    DWORD NumberOfProcesses;
-    DWORD CurrentProcessIndex;
-    PYORI_SYSTEM_PROCESS_INFORMATION *SortedProcesses;
-    LONG Status;
-    YORI_STRING BaseName;
+    PYORI_SYSTEM_PROCESS_INFORMATION ProcessInfo;
+    PMEM_PROCESS_ENTRY Entries;
+    PMEM_PROCESS_ENTRY CurrentEntry;
+    PMEM_PROCESS_ENTRY *Heap;
+    DWORD NumberOfEntries;
+    DWORD EntriesToDisplay;
+    DWORD HeapSize;
+    DWORD Index;
     LARGE_INTEGER liCommit;
     LARGE_INTEGER liWorkingSet;
     YORI_STRING CommitString;
@@ -346,117 +613,73 @@ MemDisplayProcessMemoryUsage(
         return FALSE;
     }
 
-    BytesAllocated = 0;
-
-    do {
-
-        if (ProcessInfo != NULL) {
-            YoriLibFree(ProcessInfo);
-        }
-
-        if (BytesAllocated == 0) {
-            BytesAllocated = 64 * 1024;
-        } else if (BytesAllocated <= 1024 * 1024) {
-            BytesAllocated = BytesAllocated * 4;
-        } else {
-            return FALSE;
-        }
-
-        ProcessInfo = YoriLibMalloc(BytesAllocated);
-        if (ProcessInfo == NULL) {
-            return FALSE;
-        }
-
-        Status = DllNtDll.pNtQuerySystemInformation(SystemProcessInformation, ProcessInfo, BytesAllocated, &BytesReturned);
-    } while (Status == STATUS_INFO_LENGTH_MISMATCH);
-
+    if (!YoriLibGetSystemProcessList(&ProcessInfo)) {
+        return FALSE;
+    }
 
-    if (Status != 0) {
+    if (!MemBuildProcessEntries(ProcessInfo, Options->GroupProcesses, &Entries, &NumberOfEntries)) {
         YoriLibFree(ProcessInfo);
         return FALSE;
     }
 
-    if (BytesReturned == 0) {
+    Heap = YoriLibMalloc(NumberOfEntries * sizeof(PMEM_PROCESS_ENTRY));
+    if (Heap == NULL) {
+        YoriLibFree(Entries);
         YoriLibFree(ProcessInfo);
         return FALSE;
     }
 
     //
-    //  Count the number of processes so we can allocate a sort array.
-    //
-
-    NumberOfProcesses = 0;
-    CurrentEntry = ProcessInfo;
-    do {
-        NumberOfProcesses++;
-        if (CurrentEntry->NextEntryOffset == 0) {
-            break;
-        }
-        CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
-    } while(TRUE);
-
-    //
-    //  If the user asked to combine all processes with the same name, do the
-    //  combining now.
+    //  Build a heap with the entry to display first at the top.  Each
+    //  entry is displayed as it is removed from the heap, so when only the
+    //  first few entries are requested, the remainder are never sorted.
     //
 
-    if (GroupProcesses) {
-        MemGroupProcessNames(ProcessInfo, &NumberOfProcesses);
+    for (Index = 0; Index < NumberOfEntries; Index++) {
+        Heap[Index] = &Entries[Index];
     }
 
-    //
-    //  Allocate the sort array.
-    //
-
-    SortedProcesses = YoriLibMalloc(NumberOfProcesses * sizeof(PYORI_SYSTEM_PROCESS_INFORMATION));
-    if (SortedProcesses == NULL) {
-        YoriLibFree(ProcessInfo);
-        return FALSE;
+    HeapSize = NumberOfEntries;
+    for (Index = HeapSize / 2; Index > 0; Index--) {
+        MemSiftDown(Options, Heap, HeapSize, Index - 1);
     }
 
-    //
-    //  Go through the list of processes and calculate it into sorted order.
-    //
-
-    NumberOfProcesses = 0;
-    CurrentEntry = ProcessInfo;
-    SortedProcesses[0] = CurrentEntry;
-    do {
+    EntriesToDisplay = NumberOfEntries;
+    if (Options->MaximumEntries != 0 && Options->MaximumEntries < EntriesToDisplay) {
+        EntriesToDisplay = Options->MaximumEntries;
+    }
 
-        NumberOfProcesses++;
-        if (CurrentEntry->NextEntryOffset == 0) {
-            break;
+    if (Options->RawOutput) {
+        if (Options->GroupProcesses) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Count,Process,WorkingSet,Commit\n"));
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Pid,Process,WorkingSet,Commit\n"));
         }
-        CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
-
-        CurrentProcessIndex = NumberOfProcesses;
-        do {
-            if (SortedProcesses[CurrentProcessIndex - 1]->WorkingSetSize + SortedProcesses[CurrentProcessIndex - 1]->CommitSize < CurrentEntry->WorkingSetSize + CurrentEntry->CommitSize) {
-                SortedProcesses[CurrentProcessIndex] = SortedProcesses[CurrentProcessIndex - 1];
-            } else {
-                SortedProcesses[CurrentProcessIndex] = CurrentEntry;
-                break;
-            }
-            CurrentProcessIndex--;
-            if (CurrentProcessIndex == 0) {
-                SortedProcesses[CurrentProcessIndex] = CurrentEntry;
-            }
-        } while(CurrentProcessIndex > 0);
-    } while(TRUE);
-
-    YoriLibInitEmptyString(&BaseName);
-
-    //
-    //  Now display the result in sorted order
-    //
-
-    if (GroupProcesses) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T(" Count | Process         | WorkingSet | Commit\n"));
     } else {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Pid  | Process         | WorkingSet | Commit\n"));
+        if (Options->GroupProcesses) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T(" Count | Process         | WorkingSet | Commit\n"));
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Pid  | Process         | WorkingSet | Commit\n"));
+        }
     }
-    for (CurrentProcessIndex = 0; CurrentProcessIndex < NumberOfProcesses; CurrentProcessIndex++) {
-        CurrentEntry = SortedProcesses[CurrentProcessIndex];
+
+    for (Index = 0; Index < EntriesToDisplay; Index++) {
+        CurrentEntry = Heap[0];
+        HeapSize--;
+        if (HeapSize > 0) {
+            Heap[0] = Heap[HeapSize];
+            MemSiftDown(Options, Heap, HeapSize, 0);
+        }
+
+        if (Options->RawOutput) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                          _T("%lli,\"%y\",%lli,%lli\n"),
+                          Options->GroupProcesses?(LONGLONG)CurrentEntry->ProcessCount:(LONGLONG)CurrentEntry->ProcessId,
+                          &CurrentEntry->ImageName,
+                          CurrentEntry->WorkingSetSize,
+                          CurrentEntry->CommitSize);
+            continue;
+        }
 
         //
         //  Hack to fix formats
@@ -467,17 +690,21 @@ MemDisplayProcessMemoryUsage(
         YoriLibFileSizeToString(&CommitString, &liCommit);
         YoriLibFileSizeToString(&WorkingSetString, &liWorkingSet);
 
-        BaseName.StartOfString = CurrentEntry->ImageName;
-        BaseName.LengthInChars = CurrentEntry->ImageNameLengthInBytes / sizeof(WCHAR);
-
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%-6i | %-15y | %-10y | %y\n"), CurrentEntry->ProcessId, &BaseName, &WorkingSetString, &CommitString);
-
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                      _T("%-6i | %-15y | %-10y | %y\n"),
+                      Options->GroupProcesses?CurrentEntry->ProcessCount:(DWORD)CurrentEntry->ProcessId,
+                      &CurrentEntry->ImageName,
+                      &WorkingSetString,
+                      &CommitString);
     }
 
-    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+    if (!Options->RawOutput) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+    }
 
+    YoriLibFree(Heap);
+    YoriLibFree(Entries);
     YoriLibFree(ProcessInfo);
-    YoriLibFree(SortedProcesses);
     return TRUE;
 }
 
@@ -513,9 +740,11 @@ ENTRYPOINT(
     DWORD i;
     DWORD StartArg = 0;
     BOOLEAN DisplayProcesses = FALSE;
-    BOOLEAN GroupProcesses = FALSE;
     BOOLEAN DisplayGraph = TRUE;
     YORI_STRING Arg;
+    MEM_PROCESS_OPTIONS ProcessOptions;
+    LONGLONG llTemp;
+    DWORD CharsConsumed;
     MEM_CONTEXT MemContext;
     YORI_STRING DisplayString;
     YORI_STRING AllocatedFormatString;
@@ -525,6 +754,8 @@ ENTRYPOINT(
                                  _T("Available Commit: $AVAILABLECOMMIT$\n");
 
     ZeroMemory(&MemContext, sizeof(MemContext));
+    ZeroMemory(&ProcessOptions, sizeof(ProcessOptions));
+    ProcessOptions.SortOrder = MemSortTotal;
 
     for (i = 1; i < ArgC; i++) {
 
@@ -537,14 +768,47 @@ ENTRYPOINT(
                 MemHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2019"));
+                YoriLibDisplayMitLicense(_T("2019-2026"));
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c")) == 0) {
                 DisplayProcesses = TRUE;
                 ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("g")) == 0) {
-                GroupProcesses = TRUE;
+                ProcessOptions.GroupProcesses = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("n")) == 0) {
+                if (ArgC > i + 1 &&
+                    YoriLibStringToNumber(&ArgV[i + 1], TRUE, &llTemp, &CharsConsumed) &&
+                    CharsConsumed > 0 &&
+                    llTemp > 0) {
+
+                    ProcessOptions.MaximumEntries = (DWORD)llTemp;
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
+                ProcessOptions.RawOutput = TRUE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
+                if (ArgC > i + 1) {
+                    ArgumentUnderstood = TRUE;
+                    if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("commit")) == 0) {
+                        ProcessOptions.SortOrder = MemSortCommit;
+                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("id")) == 0) {
+                        ProcessOptions.SortOrder = MemSortId;
+                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("name")) == 0) {
+                        ProcessOptions.SortOrder = MemSortName;
+                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("total")) == 0) {
+                        ProcessOptions.SortOrder = MemSortTotal;
+                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("workingset")) == 0) {
+                        ProcessOptions.SortOrder = MemSortWorkingSet;
+                    } else {
+                        ArgumentUnderstood = FALSE;
+                    }
+                    if (ArgumentUnderstood) {
+                        i++;
+                    }
+                }
             }
         } else {
             ArgumentUnderstood = TRUE;
@@ -567,7 +831,18 @@ ENTRYPOINT(
     }
 
     if (DisplayProcesses) {
-        MemDisplayProcessMemoryUsage(GroupProcesses);
+        MemDisplayProcessMemoryUsage(&ProcessOptions);
+
+        //
+        //  When displaying comma delimited values, only display system
+        //  memory usage if it was explicitly requested, so the output can
+        //  be consumed directly.
+        //
+
+        if (ProcessOptions.RawOutput && StartArg == 0) {
+            YoriLibFreeStringContents(&AllocatedFormatString);
+            return EXIT_SUCCESS;
+        }
     }
 
     if (DllKernel32.pGlobalMemoryStatusEx != NULL) {
@@ -251,6 +251,7 @@ MoreProcessStream(
     AllocContext.BufferOffset = 0;
     AllocContext.PreviousColor = MoreContext->InitialColor;
 
+    YORI_TRACE_BEGIN("More ingest stream");
     while (TRUE) {
 
         if (!YoriLibReadLineToStringEx(&LineString, &LineContext, !MoreContext->WaitForMore, INFINITE, hSource, &LineEnding, &TimeoutReached)) {
@@ -268,6 +269,7 @@ MoreProcessStream(
         }
 
     }
+    YORI_TRACE_END("More ingest stream");
 
     //
     //  If waiting for more, try to read another line.  If there's not
@@ -3,7 +3,7 @@
  *
  * Yori shell PE tool for manipulating PE files
  *
- * Copyright (c) 2021-2022 Malcolm J. Smith
+ * Copyright (c) 2021-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -36,13 +36,15 @@ CHAR strPeToolHelpText[] =
         "Manage PE files.\n"
         "\n"
         "PETOOL [-license]\n"
-        "PETOOL -c file\n"
-        "PETOOL -cu file\n"
+        "PETOOL -c [-b] [-s] file [file...]\n"
+        "PETOOL -cu [-b] [-s] file [file...]\n"
         "PETOOL -os file version\n"
         "\n"
-        "   -c             Calculate the PE checksum for a binary\n"
+        "   -b             Use basic search criteria for files only\n"
+        "   -c             Calculate the PE checksum for binaries\n"
         "   -cu            Update the checksum in the PE header from contents\n"
-        "   -os            Set the minimum OS version and update checksum\n";
+        "   -os            Set the minimum OS version and update checksum\n"
+        "   -s             Process files from all subdirectories\n";
 
 /**
  Display usage text to the user.
@@ -148,80 +150,6 @@ PeToolVersionRange[] = {
     {IMAGE_FILE_MACHINE_ARM64,    10,  0,  10,  0}
 };
 
-/**
- Write a new checksum to a PE header in a file.
-
- @param FullPath Pointer to the executable file name.
-
- @param Checksum The new checksum to apply to the PE header.
-
- @return Win32 error code, including ERROR_SUCCESS to indicate success.
- */
-DWORD
-PeToolWriteChecksumToFile(
-    __in PYORI_STRING FullPath,
-    __in DWORD Checksum
-    )
-{
-    DWORD PeHeaderOffset;
-    HANDLE hFileRead;
-    union {
-        IMAGE_DOS_HEADER DosHeader;
-        YORILIB_PE_HEADERS PeHeaders;
-    } u;
-    DWORD BytesReturned;
-    DWORD Err;
-
-    //
-    //  We want the earlier handle to be attribute only so we can
-    //  operate on directories, but we need data for this, so we
-    //  end up with two handles.
-    //
-
-    hFileRead = CreateFile(FullPath->StartOfString,
-                           FILE_READ_ATTRIBUTES|FILE_READ_DATA|FILE_WRITE_DATA,
-                           FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                           NULL,
-                           OPEN_EXISTING,
-                           FILE_FLAG_BACKUP_SEMANTICS,
-                           NULL);
-
-    if (hFileRead == INVALID_HANDLE_VALUE) {
-        Err = GetLastError();
-        return Err;
-    }
-
-    if (ReadFile(hFileRead, &u.DosHeader, sizeof(u.DosHeader), &BytesReturned, NULL) &&
-        BytesReturned == sizeof(u.DosHeader) &&
-        u.DosHeader.e_magic == IMAGE_DOS_SIGNATURE &&
-        u.DosHeader.e_lfanew != 0) {
-
-        PeHeaderOffset = u.DosHeader.e_lfanew;
-        SetFilePointer(hFileRead, PeHeaderOffset, NULL, FILE_BEGIN);
-
-        if (ReadFile(hFileRead, &u.PeHeaders, sizeof(YORILIB_PE_HEADERS), &BytesReturned, NULL) &&
-            BytesReturned == sizeof(YORILIB_PE_HEADERS) &&
-            u.PeHeaders.Signature == IMAGE_NT_SIGNATURE &&
-            u.PeHeaders.ImageHeader.SizeOfOptionalHeader >= FIELD_OFFSET(IMAGE_OPTIONAL_HEADER, CheckSum) + sizeof(u.PeHeaders.OptionalHeader.CheckSum)) {
-
-            u.PeHeaders.OptionalHeader.CheckSum = Checksum;
-            SetFilePointer(hFileRead, PeHeaderOffset, NULL, FILE_BEGIN);
-
-            if (!WriteFile(hFileRead, &u.PeHeaders, sizeof(YORILIB_PE_HEADERS), &BytesReturned, NULL)) {
-                Err = GetLastError();
-                CloseHandle(hFileRead);
-                return Err;
-            }
-
-            CloseHandle(hFileRead);
-            return ERROR_SUCCESS;
-        }
-    }
-
-    CloseHandle(hFileRead);
-    return ERROR_BAD_EXE_FORMAT;
-}
-
 /**
  Check if the specified version is valid for a specified architecture.
  This includes checking if the specified version is a valid version, and if
@@ -290,190 +218,421 @@ PeToolIsVersionValidForArchitecture(
 }
 
 /**
- Check if a specified version is applicable to an executable file, and if so,
- update the minimum OS version in the header with the specified values.
+ The maximum number of threads to use when processing a set of files.
+ */
+#define PETOOL_MAX_THREADS (16)
+
+/**
+ A single file to calculate or update the checksum for, and the result of
+ doing so.
+ */
+typedef struct _PETOOL_FILE {
+
+    /**
+     The full path to the file.
+     */
+    YORI_STRING FullPath;
 
- @param FullPath Pointer to the executable file name.
+    /**
+     The Win32 error encountered processing the file, or ERROR_SUCCESS.
+     */
+    DWORD Error;
 
- @param MajorVersion Specifies the new minimum major version.
+    /**
+     The checksum that was found in the PE header.
+     */
+    DWORD HeaderChecksum;
 
- @param MinorVersion Specifies the new minimum minor version.
+    /**
+     The checksum calculated from the file contents.
+     */
+    DWORD DataChecksum;
+} PETOOL_FILE, *PPETOOL_FILE;
 
- @return Win32 error code, including ERROR_SUCCESS to indicate success.
+/**
+ Context describing a set of files to calculate or update checksums for.
+ Files are collected while enumerating the command line arguments, and then
+ processed on several threads.
  */
-DWORD
-PeToolWriteSubsystemVersionToFile(
-    __in PYORI_STRING FullPath,
-    __in WORD MajorVersion,
-    __in WORD MinorVersion
+typedef struct _PETOOL_BATCH_CONTEXT {
+
+    /**
+     An array of files to process.
+     */
+    PPETOOL_FILE Files;
+
+    /**
+     The number of entries in the Files array that are populated.
+     */
+    DWORD FileCount;
+
+    /**
+     The number of entries allocated in the Files array.
+     */
+    DWORD FilesAllocated;
+
+    /**
+     The index of the next file to process.  This is incremented by each
+     worker thread as it claims a file.
+     */
+    LONG NextJob;
+
+    /**
+     The first error encountered when enumerating the current argument.
+     This is used to report when an argument matched nothing.
+     */
+    DWORD SavedErrorThisArg;
+
+    /**
+     The number of files found for the current argument.
+     */
+    DWORD FilesFoundThisArg;
+
+    /**
+     TRUE if the checksum in each file should be updated.  FALSE if it
+     should only be calculated.
+     */
+    BOOLEAN Update;
+
+    /**
+     TRUE if directories should be enumerated recursively.
+     */
+    BOOLEAN Recursive;
+
+} PETOOL_BATCH_CONTEXT, *PPETOOL_BATCH_CONTEXT;
+
+/**
+ Display an error encountered when processing a file.
+
+ @param FullPath Pointer to the file name.
+
+ @param Err The Win32 error code describing the failure.
+ */
+VOID
+PeToolDisplayError(
+    __in PCYORI_STRING FullPath,
+    __in DWORD Err
     )
 {
-    DWORD PeHeaderOffset;
-    HANDLE hFileRead;
-    union {
-        IMAGE_DOS_HEADER DosHeader;
-        YORILIB_PE_HEADERS PeHeaders;
-    } u;
-    DWORD BytesReturned;
-    DWORD Err;
+    LPTSTR ErrText;
 
-    //
-    //  We want the earlier handle to be attribute only so we can
-    //  operate on directories, but we need data for this, so we
-    //  end up with two handles.
-    //
+    if (Err == ERROR_OLD_WIN_VERSION) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("The specified version is not valid for the processor architecture of this program: %y\n"), FullPath);
+    } else if (Err == ERROR_BAD_EXE_FORMAT) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("This file is not a valid Windows executable: %y\n"), FullPath);
+    } else {
+        ErrText = YoriLibGetWinErrorText(Err);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of file failed: %y: %s"), FullPath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+    }
+}
+
+/**
+ Free all of the files collected in a batch.
 
-    hFileRead = CreateFile(FullPath->StartOfString,
-                           FILE_READ_ATTRIBUTES|FILE_READ_DATA|FILE_WRITE_DATA,
-                           FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                           NULL,
-                           OPEN_EXISTING,
-                           FILE_FLAG_BACKUP_SEMANTICS,
-                           NULL);
+ @param BatchContext Pointer to the batch context.
+ */
+VOID
+PeToolCleanupBatch(
+    __in PPETOOL_BATCH_CONTEXT BatchContext
+    )
+{
+    DWORD Index;
 
-    if (hFileRead == INVALID_HANDLE_VALUE) {
-        Err = GetLastError();
-        return Err;
+    for (Index = 0; Index < BatchContext->FileCount; Index++) {
+        YoriLibFreeStringContents(&BatchContext->Files[Index].FullPath);
     }
 
-    if (ReadFile(hFileRead, &u.DosHeader, sizeof(u.DosHeader), &BytesReturned, NULL) &&
-        BytesReturned == sizeof(u.DosHeader) &&
-        u.DosHeader.e_magic == IMAGE_DOS_SIGNATURE &&
-        u.DosHeader.e_lfanew != 0) {
+    if (BatchContext->Files != NULL) {
+        YoriLibFree(BatchContext->Files);
+        BatchContext->Files = NULL;
+    }
 
-        PeHeaderOffset = u.DosHeader.e_lfanew;
-        SetFilePointer(hFileRead, PeHeaderOffset, NULL, FILE_BEGIN);
+    BatchContext->FileCount = 0;
+    BatchContext->FilesAllocated = 0;
+}
 
-        if (ReadFile(hFileRead, &u.PeHeaders, sizeof(YORILIB_PE_HEADERS), &BytesReturned, NULL) &&
-            BytesReturned == sizeof(YORILIB_PE_HEADERS) &&
-            u.PeHeaders.Signature == IMAGE_NT_SIGNATURE &&
-            u.PeHeaders.ImageHeader.SizeOfOptionalHeader >= FIELD_OFFSET(IMAGE_OPTIONAL_HEADER, CheckSum) + sizeof(u.PeHeaders.OptionalHeader.CheckSum)) {
+/**
+ A callback that is invoked when a file is found that matches a search
+ criteria specified in the set of strings to enumerate.  The file is added
+ to the set of files to process.
 
-            if (!PeToolIsVersionValidForArchitecture(u.PeHeaders.ImageHeader.Machine, MajorVersion, MinorVersion)) {
-                CloseHandle(hFileRead);
-                return ERROR_OLD_WIN_VERSION;
-            }
+ @param FilePath Pointer to the file path that was found.
 
-            u.PeHeaders.OptionalHeader.MajorSubsystemVersion = MajorVersion;
-            u.PeHeaders.OptionalHeader.MinorSubsystemVersion = MinorVersion;
-            SetFilePointer(hFileRead, PeHeaderOffset, NULL, FILE_BEGIN);
+ @param FileInfo Information about the file.  This can be NULL if the file
+        was not found by enumeration.
 
-            if (!WriteFile(hFileRead, &u.PeHeaders, sizeof(YORILIB_PE_HEADERS), &BytesReturned, NULL)) {
-                Err = GetLastError();
-                CloseHandle(hFileRead);
-                return Err;
-            }
+ @param Depth Specifies the recursion depth.  Ignored in this application.
+
+ @param Context Pointer to the batch context.
+
+ @return TRUE to continue enumerating, FALSE to abort.
+ */
+BOOL
+PeToolFileFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in_opt PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PPETOOL_BATCH_CONTEXT BatchContext = (PPETOOL_BATCH_CONTEXT)Context;
+    PPETOOL_FILE NewFiles;
+    PPETOOL_FILE File;
+    DWORD NewAllocated;
+
+    UNREFERENCED_PARAMETER(FileInfo);
+    UNREFERENCED_PARAMETER(Depth);
+
+    ASSERT(YoriLibIsStringNullTerminated(FilePath));
+
+    if (BatchContext->FileCount >= BatchContext->FilesAllocated) {
+        NewAllocated = BatchContext->FilesAllocated * 2;
+        if (NewAllocated < 64) {
+            NewAllocated = 64;
+        }
 
-            CloseHandle(hFileRead);
-            return ERROR_SUCCESS;
+        NewFiles = YoriLibMalloc(NewAllocated * sizeof(PETOOL_FILE));
+        if (NewFiles == NULL) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: out of memory\n"));
+            return FALSE;
         }
+
+        if (BatchContext->Files != NULL) {
+            memcpy(NewFiles, BatchContext->Files, BatchContext->FileCount * sizeof(PETOOL_FILE));
+            YoriLibFree(BatchContext->Files);
+        }
+
+        BatchContext->Files = NewFiles;
+        BatchContext->FilesAllocated = NewAllocated;
     }
 
-    CloseHandle(hFileRead);
-    return ERROR_BAD_EXE_FORMAT;
-}
+    File = &BatchContext->Files[BatchContext->FileCount];
+    ZeroMemory(File, sizeof(PETOOL_FILE));
+    if (!YoriLibCopyString(&File->FullPath, FilePath)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: out of memory\n"));
+        return FALSE;
+    }
 
+    BatchContext->FileCount++;
+    BatchContext->FilesFoundThisArg++;
+    return TRUE;
+}
 
 /**
- Calculate and display the checksum for a specified file.
+ A callback that is invoked when a directory cannot be successfully
+ enumerated.
 
- @param FileName Pointer to the file name to calculate a checksum for.
+ @param FilePath Pointer to the file path that could not be enumerated.
 
- @return TRUE to indicate success, FALSE to indicate failure.
+ @param ErrorCode The Win32 error code describing the failure.
+
+ @param Depth Recursion depth, ignored in this application.
+
+ @param Context Pointer to the batch context.
+
+ @return TRUE to continue enumerating, FALSE to abort.
  */
-BOOLEAN
-PeToolCalculateChecksum(
-    __in PYORI_STRING FileName
+BOOL
+PeToolFileEnumerateErrorCallback(
+    __in PYORI_STRING FilePath,
+    __in DWORD ErrorCode,
+    __in DWORD Depth,
+    __in PVOID Context
     )
 {
-    DWORD Err;
-    DWORD HeaderChecksum;
-    DWORD DataChecksum;
-    YORI_STRING FullPath;
+    YORI_STRING UnescapedFilePath;
+    BOOL Result = FALSE;
+    PPETOOL_BATCH_CONTEXT BatchContext = (PPETOOL_BATCH_CONTEXT)Context;
 
-    YoriLibLoadImageHlpFunctions();
+    UNREFERENCED_PARAMETER(Depth);
 
-    if (DllImageHlp.pMapFileAndCheckSumW == NULL) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: OS support not present\n"));
-        return FALSE;
+    YoriLibInitEmptyString(&UnescapedFilePath);
+    if (!YoriLibUnescapePath(FilePath, &UnescapedFilePath)) {
+        UnescapedFilePath.StartOfString = FilePath->StartOfString;
+        UnescapedFilePath.LengthInChars = FilePath->LengthInChars;
     }
 
-    YoriLibInitEmptyString(&FullPath);
-    if (!YoriLibUserStringToSingleFilePath(FileName, TRUE, &FullPath)) {
-        return FALSE;
+    if (ErrorCode == ERROR_FILE_NOT_FOUND || ErrorCode == ERROR_PATH_NOT_FOUND) {
+        if (!BatchContext->Recursive) {
+            BatchContext->SavedErrorThisArg = ErrorCode;
+        }
+        Result = TRUE;
+    } else {
+        LPTSTR ErrText = YoriLibGetWinErrorText(ErrorCode);
+        YORI_STRING DirName;
+        LPTSTR FilePart;
+        YoriLibInitEmptyString(&DirName);
+        DirName.StartOfString = UnescapedFilePath.StartOfString;
+        FilePart = YoriLibFindRightMostCharacter(&UnescapedFilePath, '\\');
+        if (FilePart != NULL) {
+            DirName.LengthInChars = (DWORD)(FilePart - DirName.StartOfString);
+        } else {
+            DirName.LengthInChars = UnescapedFilePath.LengthInChars;
+        }
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Enumerate of %y failed: %s"), &DirName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
     }
+    YoriLibFreeStringContents(&UnescapedFilePath);
+    return Result;
+}
 
-    Err = DllImageHlp.pMapFileAndCheckSumW(FullPath.StartOfString, &HeaderChecksum, &DataChecksum);
-    if (Err != 0) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of source failed: %y\n"), FileName);
-        YoriLibFreeStringContents(&FullPath);
-        return FALSE;
+/**
+ Calculate, and optionally update, the checksum for a single file.  The
+ result is recorded in the file entry for display later.
+
+ @param File Pointer to the file to process.
+
+ @param Update If TRUE, the checksum in the PE header is updated to match
+        the file contents.
+ */
+VOID
+PeToolProcessFile(
+    __inout PPETOOL_FILE File,
+    __in BOOLEAN Update
+    )
+{
+    YORI_LIB_PE_IMAGE Image;
+
+    File->Error = YoriLibPeImageOpen(&File->FullPath, Update, &Image);
+    if (File->Error != ERROR_SUCCESS) {
+        return;
     }
 
-    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Checksum in PE header: %08x\n")
-                                          _T("Checksum of file contents: %08x\n"),
-                                          HeaderChecksum,
-                                          DataChecksum);
+    File->HeaderChecksum = Image.PeHeaders->OptionalHeader.CheckSum;
+    if (Update) {
+        File->DataChecksum = YoriLibPeImageUpdateChecksum(&Image);
+    } else {
+        File->DataChecksum = YoriLibPeImageCalculateChecksum(&Image);
+    }
 
-    YoriLibFreeStringContents(&FullPath);
-    return TRUE;
+    YoriLibPeImageClose(&Image);
 }
 
 /**
- Generate the checksum for a binary and update the header.
+ A thread which processes files until no files remain to be processed.
 
- @param FileName Pointer to the file name to generate a checksum for.
+ @param Context Pointer to the batch context.
 
- @return TRUE to indicate success, FALSE to indicate failure.
+ @return Zero.  Errors are recorded against each file.
  */
-BOOLEAN
-PeToolUpdateChecksum(
-    __in PYORI_STRING FileName
+DWORD WINAPI
+PeToolChecksumWorker(
+    __in LPVOID Context
     )
 {
-    DWORD Err;
-    DWORD HeaderChecksum;
-    DWORD DataChecksum;
-    YORI_STRING FullPath;
+    PPETOOL_BATCH_CONTEXT BatchContext = (PPETOOL_BATCH_CONTEXT)Context;
+    DWORD JobIndex;
 
-    YoriLibLoadImageHlpFunctions();
+    while (TRUE) {
+        JobIndex = (DWORD)(InterlockedIncrement(&BatchContext->NextJob) - 1);
+        if (JobIndex >= BatchContext->FileCount) {
+            break;
+        }
 
-    if (DllImageHlp.pMapFileAndCheckSumW == NULL) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: OS support not present\n"));
-        return FALSE;
+        PeToolProcessFile(&BatchContext->Files[JobIndex], BatchContext->Update);
     }
 
-    YoriLibInitEmptyString(&FullPath);
-    if (!YoriLibUserStringToSingleFilePath(FileName, TRUE, &FullPath)) {
-        return FALSE;
+    return 0;
+}
+
+/**
+ Calculate, and optionally update, the checksum for every file in a batch.
+ Since each file is independent, files are processed on several threads so
+ that IO on one file overlaps with summing the contents of another.  Results
+ are displayed once all files are complete so that output is in the order
+ the files were found.
+
+ @param BatchContext Pointer to the set of files to process.
+
+ @return TRUE to indicate all files were processed successfully, FALSE if
+         any file could not be processed.
+ */
+BOOLEAN
+PeToolProcessBatch(
+    __in PPETOOL_BATCH_CONTEXT BatchContext
+    )
+{
+    HANDLE Threads[PETOOL_MAX_THREADS];
+    SYSTEM_INFO SystemInfo;
+    PPETOOL_FILE File;
+    DWORD ThreadCount;
+    DWORD MaxThreads;
+    DWORD ThreadId;
+    DWORD Index;
+    BOOLEAN Result;
+
+    GetSystemInfo(&SystemInfo);
+    MaxThreads = SystemInfo.dwNumberOfProcessors;
+    if (MaxThreads < 2) {
+        MaxThreads = 2;
+    }
+    if (MaxThreads > PETOOL_MAX_THREADS) {
+        MaxThreads = PETOOL_MAX_THREADS;
+    }
+    if (MaxThreads > BatchContext->FileCount) {
+        MaxThreads = BatchContext->FileCount;
     }
 
-    Err = DllImageHlp.pMapFileAndCheckSumW(FullPath.StartOfString, &HeaderChecksum, &DataChecksum);
-    if (Err != 0) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of source failed: %y\n"), FileName);
-        YoriLibFreeStringContents(&FullPath);
-        return FALSE;
+    BatchContext->NextJob = 0;
+
+    //
+    //  This thread processes files alongside the worker threads, so a
+    //  single file doesn't create any threads, and if threads can't be
+    //  created all files are processed here.
+    //
+
+    ThreadCount = 0;
+    for (Index = 1; Index < MaxThreads; Index++) {
+        Threads[ThreadCount] = CreateThread(NULL, 0, PeToolChecksumWorker, BatchContext, 0, &ThreadId);
+        if (Threads[ThreadCount] != NULL) {
+            ThreadCount++;
+        }
     }
 
-    ASSERT(YoriLibIsStringNullTerminated(&FullPath));
+    PeToolChecksumWorker(BatchContext);
 
-    Err = PeToolWriteChecksumToFile(&FullPath, DataChecksum);
-    if (Err != ERROR_SUCCESS) {
-        LPTSTR ErrText;
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of file failed: %y: %s"), &FullPath, ErrText);
-        YoriLibFreeWinErrorText(ErrText);
+    if (ThreadCount > 0) {
+        WaitForMultipleObjects(ThreadCount, Threads, TRUE, INFINITE);
+        for (Index = 0; Index < ThreadCount; Index++) {
+            CloseHandle(Threads[Index]);
+        }
     }
 
-    YoriLibFreeStringContents(&FullPath);
+    Result = TRUE;
+    for (Index = 0; Index < BatchContext->FileCount; Index++) {
+        File = &BatchContext->Files[Index];
+        if (File->Error != ERROR_SUCCESS) {
+            PeToolDisplayError(&File->FullPath, File->Error);
+            Result = FALSE;
+        } else if (BatchContext->Update) {
+            if (BatchContext->FileCount > 1 && File->HeaderChecksum != File->DataChecksum) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%08x %y\n"), File->DataChecksum, &File->FullPath);
+            }
+        } else if (BatchContext->FileCount == 1) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Checksum in PE header: %08x\n")
+                                                  _T("Checksum of file contents: %08x\n"),
+                                                  File->HeaderChecksum,
+                                                  File->DataChecksum);
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                          _T("%08x %08x %c %y\n"),
+                          File->HeaderChecksum,
+                          File->DataChecksum,
+                          File->HeaderChecksum == File->DataChecksum?' ':'*',
+                          &File->FullPath);
+        }
+    }
 
-    return TRUE;
+    return Result;
 }
 
 /**
- Update the subsystem version for a PE file and regenerate the checksum.
+ Check if a specified version is applicable to an executable file, and if so,
+ update the minimum OS version in the header with the specified values and
+ regenerate the checksum.
 
- @param FileName Pointer to the file name to generate a checksum for.
+ @param FileName Pointer to the file name to update.
 
  @param NewSubsystemVersion Pointer to the new subsystem version.
 
@@ -486,22 +645,14 @@ PeToolUpdateSubsystemVersion(
     )
 {
     DWORD Err;
-    DWORD HeaderChecksum;
-    DWORD DataChecksum;
     YORI_STRING FullPath;
     YORI_STRING WinVer;
+    YORI_LIB_PE_IMAGE Image;
     LONGLONG llTemp;
     DWORD CharsConsumed;
     WORD MajorVersion;
     WORD MinorVersion;
 
-    YoriLibLoadImageHlpFunctions();
-
-    if (DllImageHlp.pMapFileAndCheckSumW == NULL) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: OS support not present\n"));
-        return FALSE;
-    }
-
     YoriLibInitEmptyString(&FullPath);
     if (!YoriLibUserStringToSingleFilePath(FileName, TRUE, &FullPath)) {
         return FALSE;
@@ -525,35 +676,25 @@ PeToolUpdateSubsystemVersion(
         }
     }
 
-    Err = PeToolWriteSubsystemVersionToFile(&FullPath, MajorVersion, MinorVersion);
-    if (Err == ERROR_OLD_WIN_VERSION) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("The specified version is not valid for the processor architecture of this program: %y\n"), &FullPath);
-    } else if (Err == ERROR_BAD_EXE_FORMAT) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("This file is not a valid Windows executable: %y\n"), &FullPath);
-    } else if (Err != ERROR_SUCCESS) {
-        LPTSTR ErrText;
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of file failed: %y: %s"), &FullPath, ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        YoriLibFreeStringContents(&FullPath);
-        return FALSE;
-    }
+    //
+    //  The version and checksum are both updated through a single mapping
+    //  of the file, so the file is only opened once.
+    //
 
-    Err = DllImageHlp.pMapFileAndCheckSumW(FullPath.StartOfString, &HeaderChecksum, &DataChecksum);
-    if (Err != 0) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of source failed: %y\n"), FileName);
-        YoriLibFreeStringContents(&FullPath);
-        return FALSE;
+    Err = YoriLibPeImageOpen(&FullPath, TRUE, &Image);
+    if (Err == ERROR_SUCCESS) {
+        if (PeToolIsVersionValidForArchitecture(Image.PeHeaders->ImageHeader.Machine, MajorVersion, MinorVersion)) {
+            Image.PeHeaders->OptionalHeader.MajorSubsystemVersion = MajorVersion;
+            Image.PeHeaders->OptionalHeader.MinorSubsystemVersion = MinorVersion;
+            YoriLibPeImageUpdateChecksum(&Image);
+        } else {
+            Err = ERROR_OLD_WIN_VERSION;
+        }
+        YoriLibPeImageClose(&Image);
     }
 
-    ASSERT(YoriLibIsStringNullTerminated(&FullPath));
-
-    Err = PeToolWriteChecksumToFile(&FullPath, DataChecksum);
     if (Err != ERROR_SUCCESS) {
-        LPTSTR ErrText;
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of file failed: %y: %s"), &FullPath, ErrText);
-        YoriLibFreeWinErrorText(ErrText);
+        PeToolDisplayError(&FullPath, Err);
         YoriLibFreeStringContents(&FullPath);
         return FALSE;
     }
@@ -602,15 +743,19 @@ ENTRYPOINT(
     )
 {
     BOOL ArgumentUnderstood;
+    BOOL BasicEnumeration = FALSE;
     DWORD i;
-    DWORD StartArg;
+    DWORD StartArg = 0;
+    DWORD MatchFlags;
     YORI_STRING Arg;
     PYORI_STRING FileName = NULL;
     PYORI_STRING NewSubsystemVersion = NULL;
+    PETOOL_BATCH_CONTEXT BatchContext;
     PETOOL_OP Op;
     DWORD Result;
 
     Op = PeToolOpNone;
+    ZeroMemory(&BatchContext, sizeof(BatchContext));
 
     for (i = 1; i < ArgC; i++) {
 
@@ -623,27 +768,28 @@ ENTRYPOINT(
                 PeToolHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2021"));
+                YoriLibDisplayMitLicense(_T("2021-2026"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
+                BasicEnumeration = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c")) == 0) {
-                if (ArgC > i + 1) {
-                    FileName = &ArgV[i + 1];
-                    Op = PeToolOpCalculateChecksum;
-                    ArgumentUnderstood = TRUE;
-                }
+                Op = PeToolOpCalculateChecksum;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("cu")) == 0) {
-                if (ArgC > i + 1) {
-                    FileName = &ArgV[i + 1];
-                    Op = PeToolOpUpdateChecksum;
-                    ArgumentUnderstood = TRUE;
-                }
+                Op = PeToolOpUpdateChecksum;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("os")) == 0) {
                 if (ArgC > i + 2) {
                     FileName = &ArgV[i + 1];
                     NewSubsystemVersion = &ArgV[i + 2];
                     Op = PeToolOpUpdateSubsystemVersion;
                     ArgumentUnderstood = TRUE;
+                    i += 2;
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
+                BatchContext.Recursive = TRUE;
+                ArgumentUnderstood = TRUE;
             }
         } else {
             ArgumentUnderstood = TRUE;
@@ -663,24 +809,70 @@ ENTRYPOINT(
 
     Result = EXIT_SUCCESS;
 
-    switch(Op) {
-        case PeToolOpCalculateChecksum:
-            if (!PeToolCalculateChecksum(FileName)) {
-                Result = EXIT_FAILURE;
-            }
-            break;
-        case PeToolOpUpdateChecksum:
-            if (!PeToolUpdateChecksum(FileName)) {
-                Result = EXIT_FAILURE;
-            }
-            break;
-        case PeToolOpUpdateSubsystemVersion:
-            if (!PeToolUpdateSubsystemVersion(FileName, NewSubsystemVersion)) {
-                Result = EXIT_FAILURE;
+    if (Op == PeToolOpUpdateSubsystemVersion) {
+        if (!PeToolUpdateSubsystemVersion(FileName, NewSubsystemVersion)) {
+            Result = EXIT_FAILURE;
+        }
+        return Result;
+    }
+
+    if (StartArg == 0 || StartArg == ArgC) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: missing argument\n"));
+        return EXIT_FAILURE;
+    }
+
+    if (Op == PeToolOpUpdateChecksum) {
+        BatchContext.Update = TRUE;
+    }
+
+    //
+    //  Collect every matching file first, and then process them together
+    //  so the files can be checksummed in parallel.
+    //
+
+    MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_DIRECTORY_CONTENTS;
+    if (BasicEnumeration) {
+        MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
+    }
+    if (BatchContext.Recursive) {
+        MatchFlags |= YORILIB_FILEENUM_RECURSE_AFTER_RETURN | YORILIB_FILEENUM_RECURSE_PRESERVE_WILD;
+    }
+
+    for (i = StartArg; i < ArgC; i++) {
+
+        BatchContext.FilesFoundThisArg = 0;
+        BatchContext.SavedErrorThisArg = ERROR_SUCCESS;
+
+        YoriLibForEachStream(&ArgV[i],
+                             MatchFlags,
+                             0,
+                             PeToolFileFoundCallback,
+                             PeToolFileEnumerateErrorCallback,
+                             &BatchContext);
+
+        if (BatchContext.FilesFoundThisArg == 0) {
+            YORI_STRING FullPath;
+            YoriLibInitEmptyString(&FullPath);
+            if (BatchContext.SavedErrorThisArg != ERROR_SUCCESS) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("File or directory not found: %y\n"), &ArgV[i]);
+            } else if (YoriLibUserStringToSingleFilePath(&ArgV[i], TRUE, &FullPath)) {
+                PeToolFileFoundCallback(&FullPath, NULL, 0, &BatchContext);
+                YoriLibFreeStringContents(&FullPath);
             }
-            break;
+        }
+    }
+
+    if (BatchContext.FileCount == 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: no matching files found\n"));
+        return EXIT_FAILURE;
     }
 
+    if (!PeToolProcessBatch(&BatchContext)) {
+        Result = EXIT_FAILURE;
+    }
+
+    PeToolCleanupBatch(&BatchContext);
+
     return Result;
 }
 
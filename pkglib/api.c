@@ -59,14 +59,7 @@ YoriPkgUpgradeInstalledPackages(
     BOOL Result;
     BOOL UpgradeThisPackage;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
-
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileSectionW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
-
-        return FALSE;
-    }
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -90,11 +83,19 @@ YoriPkgUpgradeInstalledPackages(
         return FALSE;
     }
 
+    if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&UpgradePath);
+        YoriLibFreeStringContents(&InstalledSection);
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     InstalledSection.LengthInChars =
-        DllKernel32.pGetPrivateProfileSectionW(_T("Installed"),
-                                               InstalledSection.StartOfString,
-                                               InstalledSection.LengthAllocated,
-                                               PkgIniFile.StartOfString);
+        YoriLibIniGetSection(IniDocument,
+                             _T("Installed"),
+                             InstalledSection.StartOfString,
+                             InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -116,30 +117,30 @@ YoriPkgUpgradeInstalledPackages(
         UpgradePath.LengthInChars = 0;
         if (Prefer == YoriPkgUpgradePreferStable) {
             UpgradePath.LengthInChars =
-                DllKernel32.pGetPrivateProfileStringW(PkgNameOnly.StartOfString,
-                                                      _T("UpgradeToStablePath"),
-                                                      _T(""),
-                                                      UpgradePath.StartOfString,
-                                                      UpgradePath.LengthAllocated,
-                                                      PkgIniFile.StartOfString);
+                YoriLibIniGetString(IniDocument,
+                                    PkgNameOnly.StartOfString,
+                                    _T("UpgradeToStablePath"),
+                                    _T(""),
+                                    UpgradePath.StartOfString,
+                                    UpgradePath.LengthAllocated);
         } else if (Prefer == YoriPkgUpgradePreferDaily) {
             UpgradePath.LengthInChars =
-                DllKernel32.pGetPrivateProfileStringW(PkgNameOnly.StartOfString,
-                                                      _T("UpgradeToDailyPath"),
-                                                      _T(""),
-                                                      UpgradePath.StartOfString,
-                                                      UpgradePath.LengthAllocated,
-                                                      PkgIniFile.StartOfString);
+                YoriLibIniGetString(IniDocument,
+                                    PkgNameOnly.StartOfString,
+                                    _T("UpgradeToDailyPath"),
+                                    _T(""),
+                                    UpgradePath.StartOfString,
+                                    UpgradePath.LengthAllocated);
         }
 
         if (UpgradePath.LengthInChars == 0) {
             UpgradePath.LengthInChars =
-                DllKernel32.pGetPrivateProfileStringW(PkgNameOnly.StartOfString,
-                                                      _T("UpgradePath"),
-                                                      _T(""),
-                                                      UpgradePath.StartOfString,
-                                                      UpgradePath.LengthAllocated,
-                                                      PkgIniFile.StartOfString);
+                YoriLibIniGetString(IniDocument,
+                                    PkgNameOnly.StartOfString,
+                                    _T("UpgradePath"),
+                                    _T(""),
+                                    UpgradePath.StartOfString,
+                                    UpgradePath.LengthAllocated);
         }
         if (UpgradePath.LengthInChars > 0) {
             UpgradeThisPackage = TRUE;
@@ -164,6 +165,18 @@ YoriPkgUpgradeInstalledPackages(
                     YoriPkgDisplayErrorStringForInstallFailure(Error);
                     goto Exit;
                 }
+
+                //
+                //  Preparing a package backs it up and removes it, along
+                //  with anything it replaces, from the INI file.  Reload so
+                //  later packages see the current state.
+                //
+
+                YoriLibIniFree(IniDocument);
+                if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
+                    IniDocument = NULL;
+                    goto Exit;
+                }
             }
         }
         if (Equals) {
@@ -174,6 +187,9 @@ YoriPkgUpgradeInstalledPackages(
         ThisLine++;
     }
 
+    YoriLibIniFree(IniDocument);
+    IniDocument = NULL;
+
     //
     //  Upgrade all packages which specify an upgrade path.
     //
@@ -181,6 +197,9 @@ YoriPkgUpgradeInstalledPackages(
     Result = YoriPkgInstallPendingPackages(&PkgIniFile, NULL, &PendingPackages);
 
 Exit:
+    if (IniDocument != NULL) {
+        YoriLibIniFree(IniDocument);
+    }
 
     //
     //  If there's any backup left, abort the install of those packages.
@@ -224,13 +243,7 @@ YoriPkgUpgradeSinglePackage(
     BOOL Result;
     DWORD Error;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
-
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
-
-        return FALSE;
-    }
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -247,14 +260,22 @@ YoriPkgUpgradeSinglePackage(
         return FALSE;
     }
 
+    if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&PkgIniFile);
+        YoriLibFreeStringContents(&IniValue);
+        return FALSE;
+    }
+
     IniValue.LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Installed"),
-                                              PackageName->StartOfString,
-                                              _T(""),
-                                              IniValue.StartOfString,
-                                              IniValue.LengthAllocated,
-                                              PkgIniFile.StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Installed"),
+                            PackageName->StartOfString,
+                            _T(""),
+                            IniValue.StartOfString,
+                            IniValue.LengthAllocated);
     if (IniValue.LengthInChars == 0) {
+        YoriLibIniFree(IniDocument);
         YoriPkgDeletePendingPackages(&PendingPackages);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
@@ -265,32 +286,34 @@ YoriPkgUpgradeSinglePackage(
     IniValue.LengthInChars = 0;
     if (Prefer == YoriPkgUpgradePreferStable) {
         IniValue.LengthInChars =
-            DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                                  _T("UpgradeToStablePath"),
-                                                  _T(""),
-                                                  IniValue.StartOfString,
-                                                  IniValue.LengthAllocated,
-                                                  PkgIniFile.StartOfString);
+            YoriLibIniGetString(IniDocument,
+                                PackageName->StartOfString,
+                                _T("UpgradeToStablePath"),
+                                _T(""),
+                                IniValue.StartOfString,
+                                IniValue.LengthAllocated);
     } else if (Prefer == YoriPkgUpgradePreferDaily) {
         IniValue.LengthInChars =
-            DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                                  _T("UpgradeToDailyPath"),
-                                                  _T(""),
-                                                  IniValue.StartOfString,
-                                                  IniValue.LengthAllocated,
-                                                  PkgIniFile.StartOfString);
+            YoriLibIniGetString(IniDocument,
+                                PackageName->StartOfString,
+                                _T("UpgradeToDailyPath"),
+                                _T(""),
+                                IniValue.StartOfString,
+                                IniValue.LengthAllocated);
     }
 
     if (IniValue.LengthInChars == 0) {
         IniValue.LengthInChars =
-            DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                                  _T("UpgradePath"),
-                                                  _T(""),
-                                                  IniValue.StartOfString,
-                                                  IniValue.LengthAllocated,
-                                                  PkgIniFile.StartOfString);
+            YoriLibIniGetString(IniDocument,
+                                PackageName->StartOfString,
+                                _T("UpgradePath"),
+                                _T(""),
+                                IniValue.StartOfString,
+                                IniValue.LengthAllocated);
     }
 
+    YoriLibIniFree(IniDocument);
+
     if (IniValue.LengthInChars == 0) {
         YoriPkgDeletePendingPackages(&PendingPackages);
         YoriLibFreeStringContents(&PkgIniFile);
@@ -347,10 +370,6 @@ YoriPkgInstallSinglePackage(
     DWORD Error;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
 
-    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
-        return FALSE;
-    }
-
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
     }
@@ -403,14 +422,7 @@ YoriPkgInstallSourceForInstalledPackages(VOID)
     DWORD Error;
     BOOL Result;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
-
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileSectionW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
-
-        return FALSE;
-    }
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -434,11 +446,19 @@ YoriPkgInstallSourceForInstalledPackages(VOID)
         return FALSE;
     }
 
+    if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&SourcePath);
+        YoriLibFreeStringContents(&InstalledSection);
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     InstalledSection.LengthInChars =
-        DllKernel32.pGetPrivateProfileSectionW(_T("Installed"),
-                                               InstalledSection.StartOfString,
-                                               InstalledSection.LengthAllocated,
-                                               PkgIniFile.StartOfString);
+        YoriLibIniGetSection(IniDocument,
+                             _T("Installed"),
+                             InstalledSection.StartOfString,
+                             InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -456,12 +476,12 @@ YoriPkgInstallSourceForInstalledPackages(VOID)
         }
 
         SourcePath.LengthInChars =
-            DllKernel32.pGetPrivateProfileStringW(PkgNameOnly.StartOfString,
-                                                  _T("SourcePath"),
-                                                  _T(""),
-                                                  SourcePath.StartOfString,
-                                                  SourcePath.LengthAllocated,
-                                                  PkgIniFile.StartOfString);
+            YoriLibIniGetString(IniDocument,
+                                PkgNameOnly.StartOfString,
+                                _T("SourcePath"),
+                                _T(""),
+                                SourcePath.StartOfString,
+                                SourcePath.LengthAllocated);
         if (SourcePath.LengthInChars > 0) {
             if (YoriLibIsPathUrl(&SourcePath)) {
                 YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Downloading source for %y from %y...\n"), &PkgNameOnly, &SourcePath);
@@ -480,6 +500,9 @@ YoriPkgInstallSourceForInstalledPackages(VOID)
         ThisLine++;
     }
 
+    YoriLibIniFree(IniDocument);
+    IniDocument = NULL;
+
     //
     //  Install all packages which specify a source path.
     //
@@ -487,6 +510,9 @@ YoriPkgInstallSourceForInstalledPackages(VOID)
     Result = YoriPkgInstallPendingPackages(&PkgIniFile, NULL, &PendingPackages);
 
 Exit:
+    if (IniDocument != NULL) {
+        YoriLibIniFree(IniDocument);
+    }
 
     //
     //  If there's any backup left, abort the install of those packages.
@@ -522,13 +548,7 @@ YoriPkgInstallSourceForSinglePackage(
     BOOL Result;
     DWORD Error;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
-
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
-
-        return FALSE;
-    }
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -545,14 +565,22 @@ YoriPkgInstallSourceForSinglePackage(
         return FALSE;
     }
 
+    if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&PkgIniFile);
+        YoriLibFreeStringContents(&IniValue);
+        return FALSE;
+    }
+
     IniValue.LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Installed"),
-                                              PackageName->StartOfString,
-                                              _T(""),
-                                              IniValue.StartOfString,
-                                              IniValue.LengthAllocated,
-                                              PkgIniFile.StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Installed"),
+                            PackageName->StartOfString,
+                            _T(""),
+                            IniValue.StartOfString,
+                            IniValue.LengthAllocated);
     if (IniValue.LengthInChars == 0) {
+        YoriLibIniFree(IniDocument);
         YoriPkgDeletePendingPackages(&PendingPackages);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
@@ -561,12 +589,13 @@ YoriPkgInstallSourceForSinglePackage(
     }
 
     IniValue.LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("SourcePath"),
-                                              _T(""),
-                                              IniValue.StartOfString,
-                                              IniValue.LengthAllocated,
-                                              PkgIniFile.StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            PackageName->StartOfString,
+                            _T("SourcePath"),
+                            _T(""),
+                            IniValue.StartOfString,
+                            IniValue.LengthAllocated);
+    YoriLibIniFree(IniDocument);
 
     if (IniValue.LengthInChars == 0) {
         YoriPkgDeletePendingPackages(&PendingPackages);
@@ -620,14 +649,7 @@ YoriPkgInstallSymbolsForInstalledPackages(VOID)
     DWORD Error;
     BOOL Result;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
-
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileSectionW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
-
-        return FALSE;
-    }
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -651,11 +673,19 @@ YoriPkgInstallSymbolsForInstalledPackages(VOID)
         return FALSE;
     }
 
+    if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&SymbolPath);
+        YoriLibFreeStringContents(&InstalledSection);
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     InstalledSection.LengthInChars =
-        DllKernel32.pGetPrivateProfileSectionW(_T("Installed"),
-                                               InstalledSection.StartOfString,
-                                               InstalledSection.LengthAllocated,
-                                               PkgIniFile.StartOfString);
+        YoriLibIniGetSection(IniDocument,
+                             _T("Installed"),
+                             InstalledSection.StartOfString,
+                             InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -674,12 +704,12 @@ YoriPkgInstallSymbolsForInstalledPackages(VOID)
         }
 
         SymbolPath.LengthInChars =
-            DllKernel32.pGetPrivateProfileStringW(PkgNameOnly.StartOfString,
-                                                  _T("SymbolPath"),
-                                                  _T(""),
-                                                  SymbolPath.StartOfString,
-                                                  SymbolPath.LengthAllocated,
-                                                  PkgIniFile.StartOfString);
+            YoriLibIniGetString(IniDocument,
+                                PkgNameOnly.StartOfString,
+                                _T("SymbolPath"),
+                                _T(""),
+                                SymbolPath.StartOfString,
+                                SymbolPath.LengthAllocated);
         if (SymbolPath.LengthInChars > 0) {
             if (YoriLibIsPathUrl(&SymbolPath)) {
                 YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Downloading symbols for %y from %y...\n"), &PkgNameOnly, &SymbolPath);
@@ -699,6 +729,9 @@ YoriPkgInstallSymbolsForInstalledPackages(VOID)
         ThisLine++;
     }
 
+    YoriLibIniFree(IniDocument);
+    IniDocument = NULL;
+
     //
     //  Install all packages which specify a source path.
     //
@@ -706,6 +739,9 @@ YoriPkgInstallSymbolsForInstalledPackages(VOID)
     Result = YoriPkgInstallPendingPackages(&PkgIniFile, NULL, &PendingPackages);
 
 Exit:
+    if (IniDocument != NULL) {
+        YoriLibIniFree(IniDocument);
+    }
 
     //
     //  If there's any backup left, abort the install of those packages.
@@ -741,13 +777,7 @@ YoriPkgInstallSymbolForSinglePackage(
     DWORD Error;
     BOOL Result;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
-
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
-
-        return FALSE;
-    }
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -764,14 +794,22 @@ YoriPkgInstallSymbolForSinglePackage(
         return FALSE;
     }
 
+    if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&PkgIniFile);
+        YoriLibFreeStringContents(&IniValue);
+        return FALSE;
+    }
+
     IniValue.LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Installed"),
-                                              PackageName->StartOfString,
-                                              _T(""),
-                                              IniValue.StartOfString,
-                                              IniValue.LengthAllocated,
-                                              PkgIniFile.StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Installed"),
+                            PackageName->StartOfString,
+                            _T(""),
+                            IniValue.StartOfString,
+                            IniValue.LengthAllocated);
     if (IniValue.LengthInChars == 0) {
+        YoriLibIniFree(IniDocument);
         YoriPkgDeletePendingPackages(&PendingPackages);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
@@ -780,12 +818,13 @@ YoriPkgInstallSymbolForSinglePackage(
     }
 
     IniValue.LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("SymbolPath"),
-                                              _T(""),
-                                              IniValue.StartOfString,
-                                              IniValue.LengthAllocated,
-                                              PkgIniFile.StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            PackageName->StartOfString,
+                            _T("SymbolPath"),
+                            _T(""),
+                            IniValue.StartOfString,
+                            IniValue.LengthAllocated);
+    YoriLibIniFree(IniDocument);
 
     if (IniValue.LengthInChars == 0) {
         YoriPkgDeletePendingPackages(&PendingPackages);
@@ -840,12 +879,7 @@ YoriPkgListInstalledPackages(
     YORI_STRING PkgNameOnly;
     YORI_STRING PkgVersion;
     YORI_STRING PkgArch;
-
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileSectionW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL) {
-        return FALSE;
-    }
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     if (!YoriPkgGetPackageIniFile(NULL, &PkgIniFile)) {
         return FALSE;
@@ -862,11 +896,18 @@ YoriPkgListInstalledPackages(
         return FALSE;
     }
 
+    if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&PkgArch);
+        YoriLibFreeStringContents(&InstalledSection);
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     InstalledSection.LengthInChars =
-        DllKernel32.pGetPrivateProfileSectionW(_T("Installed"),
-                                               InstalledSection.StartOfString,
-                                               InstalledSection.LengthAllocated,
-                                               PkgIniFile.StartOfString);
+        YoriLibIniGetSection(IniDocument,
+                             _T("Installed"),
+                             InstalledSection.StartOfString,
+                             InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     YoriLibInitEmptyString(&PkgVersion);
@@ -891,12 +932,12 @@ YoriPkgListInstalledPackages(
         PkgNameOnly.StartOfString[PkgNameOnly.LengthInChars] = '\0';
 
         PkgArch.LengthInChars =
-            DllKernel32.pGetPrivateProfileStringW(PkgNameOnly.StartOfString,
-                                                  _T("Architecture"),
-                                                  _T(""),
-                                                  PkgArch.StartOfString,
-                                                  PkgArch.LengthAllocated,
-                                                  PkgIniFile.StartOfString);
+            YoriLibIniGetString(IniDocument,
+                                PkgNameOnly.StartOfString,
+                                _T("Architecture"),
+                                _T(""),
+                                PkgArch.StartOfString,
+                                PkgArch.LengthAllocated);
 
         if (Verbose) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y (%y)\n"), &PkgNameOnly, &PkgVersion, &PkgArch);
@@ -905,6 +946,7 @@ YoriPkgListInstalledPackages(
         }
     }
 
+    YoriLibIniFree(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&InstalledSection);
     YoriLibFreeStringContents(&PkgArch);
@@ -937,40 +979,42 @@ YoriPkgDeletePackage(
     YORI_STRING IniValue;
     DWORD FileCount;
     DWORD Error;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
-
+    if (!YoriPkgGetPackageIniFile(TargetDirectory, &PkgIniFile)) {
         return FALSE;
     }
 
-    if (!YoriPkgGetPackageIniFile(TargetDirectory, &PkgIniFile)) {
+    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+        YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+    if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
         YoriLibFreeStringContents(&PkgIniFile);
+        YoriLibFreeStringContents(&IniValue);
         return FALSE;
     }
 
     IniValue.LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Installed"),
-                                              PackageName->StartOfString,
-                                              _T(""),
-                                              IniValue.StartOfString,
-                                              IniValue.LengthAllocated,
-                                              PkgIniFile.StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Installed"),
+                            PackageName->StartOfString,
+                            _T(""),
+                            IniValue.StartOfString,
+                            IniValue.LengthAllocated);
     if (IniValue.LengthInChars == 0) {
         if (WarnIfNotInstalled) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%y is not an installed package\n"), PackageName);
         }
+        YoriLibIniFree(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
         return FALSE;
     }
 
-    FileCount = DllKernel32.pGetPrivateProfileIntW(PackageName->StartOfString, _T("FileCount"), 0, PkgIniFile.StartOfString);
+    FileCount = YoriLibIniGetInt(IniDocument, PackageName->StartOfString, _T("FileCount"), 0);
+    YoriLibIniFree(IniDocument);
     if (FileCount == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%y contains nothing to remove\n"), PackageName);
         YoriLibFreeStringContents(&PkgIniFile);
@@ -1003,29 +1047,28 @@ YoriPkgDeleteAllPackages(VOID)
     YORI_STRING PkgNameOnly;
     BOOL Result;
     DWORD Error;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileSectionW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
-
+    if (!YoriPkgGetPackageIniFile(NULL, &PkgIniFile)) {
         return FALSE;
     }
 
-    if (!YoriPkgGetPackageIniFile(NULL, &PkgIniFile)) {
+    if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
+        YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
+    if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
         YoriLibFreeStringContents(&PkgIniFile);
+        YoriLibFreeStringContents(&InstalledSection);
         return FALSE;
     }
 
     InstalledSection.LengthInChars =
-        DllKernel32.pGetPrivateProfileSectionW(_T("Installed"),
-                                               InstalledSection.StartOfString,
-                                               InstalledSection.LengthAllocated,
-                                               PkgIniFile.StartOfString);
+        YoriLibIniGetSection(IniDocument,
+                             _T("Installed"),
+                             InstalledSection.StartOfString,
+                             InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -1058,6 +1101,7 @@ YoriPkgDeleteAllPackages(VOID)
     }
 
     if (!Result) {
+        YoriLibIniFree(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&InstalledSection);
 
@@ -1065,10 +1109,12 @@ YoriPkgDeleteAllPackages(VOID)
     }
 
     InstalledSection.LengthInChars =
-        DllKernel32.pGetPrivateProfileSectionW(_T("Installed"),
-                                               InstalledSection.StartOfString,
-                                               InstalledSection.LengthAllocated,
-                                               PkgIniFile.StartOfString);
+        YoriLibIniGetSection(IniDocument,
+                             _T("Installed"),
+                             InstalledSection.StartOfString,
+                             InstalledSection.LengthAllocated);
+
+    YoriLibIniFree(IniDocument);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -1137,32 +1183,37 @@ YoriPkgInstallPseudoPackage(
     YORI_STRING PkgIniFile;
     DWORD FileIndex;
     TCHAR FileIndexString[16];
+    PYORI_LIB_INI_DOCUMENT IniDocument;
+    BOOL Result;
 
-    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
+    if (!YoriPkgGetPackageIniFile(TargetDirectory, &PkgIniFile)) {
         return FALSE;
     }
 
-    if (!YoriPkgGetPackageIniFile(TargetDirectory, &PkgIniFile)) {
+    if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    DllKernel32.pWritePrivateProfileStringW(_T("Installed"), Name->StartOfString, Version->StartOfString, PkgIniFile.StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(Name->StartOfString, _T("Version"), Version->StartOfString, PkgIniFile.StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(Name->StartOfString, _T("Architecture"), Architecture->StartOfString, PkgIniFile.StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(Name->StartOfString, _T("BestEffortDelete"), _T("1"), PkgIniFile.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Installed"), Name->StartOfString, Version->StartOfString);
+    YoriLibIniSetString(IniDocument, Name->StartOfString, _T("Version"), Version->StartOfString);
+    YoriLibIniSetString(IniDocument, Name->StartOfString, _T("Architecture"), Architecture->StartOfString);
+    YoriLibIniSetString(IniDocument, Name->StartOfString, _T("BestEffortDelete"), _T("1"));
 
     for (FileIndex = 1; FileIndex <= FileCount; FileIndex++) {
         YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
 
-        DllKernel32.pWritePrivateProfileStringW(Name->StartOfString, FileIndexString, FileArray[FileIndex - 1].StartOfString, PkgIniFile.StartOfString);
+        YoriLibIniSetString(IniDocument, Name->StartOfString, FileIndexString, FileArray[FileIndex - 1].StartOfString);
     }
     YoriLibSPrintf(FileIndexString, _T("%i"), FileCount);
-    DllKernel32.pWritePrivateProfileStringW(Name->StartOfString, _T("FileCount"), FileIndexString, PkgIniFile.StartOfString);
+    YoriLibIniSetString(IniDocument, Name->StartOfString, _T("FileCount"), FileIndexString);
 
+    Result = YoriLibIniSave(IniDocument);
+    YoriLibIniFree(IniDocument);
 
     YoriLibFreeStringContents(&PkgIniFile);
 
-    return TRUE;
+    return Result;
 }
 
 /**
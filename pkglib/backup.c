@@ -96,7 +96,7 @@ YoriPkgDeleteRenamedFiles(
  this also restores each file entry back into the INI file.  Note this routine
  is best effort and continues on error.
 
- @param IniPath Pointer to the system global INI file.
+ @param IniDocument Pointer to the system global INI document.
 
  @param PackageBackup Pointer to the backed up package.
 
@@ -106,7 +106,7 @@ YoriPkgDeleteRenamedFiles(
  */
 VOID
 YoriPkgRollbackRenamedFiles(
-    __in PCYORI_STRING IniPath,
+    __in_opt PYORI_LIB_INI_DOCUMENT IniDocument,
     __in PYORIPKG_BACKUP_PACKAGE PackageBackup,
     __in BOOL RestoreIni
     )
@@ -117,8 +117,6 @@ YoriPkgRollbackRenamedFiles(
     DWORD Index;
     BOOL Result;
 
-    ASSERT(DllKernel32.pWritePrivateProfileStringW != NULL);
-
     ListEntry = YoriLibGetNextListEntry(&PackageBackup->FileList, ListEntry);
     Index = 1;
     while (ListEntry != NULL) {
@@ -128,7 +126,7 @@ YoriPkgRollbackRenamedFiles(
 
         if (RestoreIni) {
             YoriLibSPrintf(FileIndexString, _T("File%i"), Index);
-            DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, FileIndexString, BackupFile->OriginalRelativeName.StartOfString, IniPath->StartOfString);
+            YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, FileIndexString, BackupFile->OriginalRelativeName.StartOfString);
 
         }
 
@@ -171,10 +169,7 @@ YoriPkgRollbackPackage(
     )
 {
     TCHAR FileCountString[16];
-
-    ASSERT(DllKernel32.pWritePrivateProfileStringW != NULL);
-
-    ASSERT(YoriLibIsStringNullTerminated(IniPath));
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     ASSERT(YoriLibIsStringNullTerminated(&PackageBackup->PackageName));
     ASSERT(YoriLibIsStringNullTerminated(&PackageBackup->Version));
@@ -184,67 +179,79 @@ YoriPkgRollbackPackage(
     ASSERT(PackageBackup->Version.LengthInChars > 0);
     ASSERT(PackageBackup->Architecture.LengthInChars > 0);
 
+    //
+    //  If the INI file can't be loaded, still put the files back.
+    //
+
+    if (!YoriLibIniLoad(IniPath, &IniDocument)) {
+        YoriPkgRollbackRenamedFiles(NULL, PackageBackup, FALSE);
+        return;
+    }
+
     //
     //  Delete the entire existing section.  This will clear out any files
     //  added there that aren't part of the backed up package.
     //
 
-    DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, NULL, NULL, IniPath->StartOfString);
+    YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, NULL, NULL);
 
     //
     //  Put back the files and recreate their INI entries.
     //
 
-    YoriPkgRollbackRenamedFiles(IniPath, PackageBackup, TRUE);
+    YoriPkgRollbackRenamedFiles(IniDocument, PackageBackup, TRUE);
     YoriLibSPrintf(FileCountString, _T("%i"), PackageBackup->FileCount);
 
     //
     //  Restore all of the fixed headers for the package.
     //
 
-    DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("FileCount"), FileCountString, IniPath->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("Version"), PackageBackup->Version.StartOfString, IniPath->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("Architecture"), PackageBackup->Architecture.StartOfString, IniPath->StartOfString);
+    YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("FileCount"), FileCountString);
+    YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("Version"), PackageBackup->Version.StartOfString);
+    YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("Architecture"), PackageBackup->Architecture.StartOfString);
 
     //
     //  Restore any optional headers for the package.
     //
 
     if (PackageBackup->UpgradePath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("UpgradePath"), PackageBackup->UpgradePath.StartOfString, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("UpgradePath"), PackageBackup->UpgradePath.StartOfString);
     } else {
-        DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("UpgradePath"), NULL, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("UpgradePath"), NULL);
     }
 
     if (PackageBackup->SourcePath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("SourcePath"), PackageBackup->SourcePath.StartOfString, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("SourcePath"), PackageBackup->SourcePath.StartOfString);
     } else {
-        DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("SourcePath"), NULL, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("SourcePath"), NULL);
     }
 
     if (PackageBackup->SymbolPath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("SymbolPath"), PackageBackup->SymbolPath.StartOfString, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("SymbolPath"), PackageBackup->SymbolPath.StartOfString);
     } else {
-        DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("SymbolPath"), NULL, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("SymbolPath"), NULL);
     }
 
     if (PackageBackup->UpgradeToDailyPath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("UpgradeToDailyPath"), PackageBackup->UpgradeToDailyPath.StartOfString, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("UpgradeToDailyPath"), PackageBackup->UpgradeToDailyPath.StartOfString);
     } else {
-        DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("UpgradeToDailyPath"), NULL, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("UpgradeToDailyPath"), NULL);
     }
 
     if (PackageBackup->UpgradeToStablePath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("UpgradeToStablePath"), PackageBackup->UpgradeToStablePath.StartOfString, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("UpgradeToStablePath"), PackageBackup->UpgradeToStablePath.StartOfString);
     } else {
-        DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, _T("UpgradeToStablePath"), NULL, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("UpgradeToStablePath"), NULL);
     }
 
     //
     //  Indicate the package is installed.
     //
 
-    DllKernel32.pWritePrivateProfileStringW(_T("Installed"), PackageBackup->PackageName.StartOfString, PackageBackup->Version.StartOfString, IniPath->StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Installed"), PackageBackup->PackageName.StartOfString, PackageBackup->Version.StartOfString);
+
+    YoriLibIniSave(IniDocument);
+    YoriLibIniFree(IniDocument);
 }
 
 /**
@@ -285,13 +292,7 @@ YoriPkgBackupPackage(
     DWORD FileIndex;
     DWORD Err;
     TCHAR FileIndexString[16];
-
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
-
-        return ERROR_PROC_NOT_FOUND;
-    }
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     Context = YoriLibMalloc(sizeof(YORIPKG_BACKUP_PACKAGE));
     if (Context == NULL) {
@@ -339,15 +340,22 @@ YoriPkgBackupPackage(
         return ERROR_NOT_ENOUGH_MEMORY;
     }
 
-    Context->FileCount = DllKernel32.pGetPrivateProfileIntW(Context->PackageName.StartOfString, _T("FileCount"), 0, IniPath->StartOfString);
+    if (!YoriLibIniLoad(IniPath, &IniDocument)) {
+        YoriLibFreeStringContents(&FullTargetDirectory);
+        YoriPkgFreeBackupPackage(Context);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    Context->FileCount = YoriLibIniGetInt(IniDocument, Context->PackageName.StartOfString, _T("FileCount"), 0);
     if (Context->FileCount == 0) {
-        Err = GetLastError();
+        YoriLibIniFree(IniDocument);
         YoriLibFreeStringContents(&FullTargetDirectory);
         YoriPkgFreeBackupPackage(Context);
-        return Err;
+        return ERROR_FILE_NOT_FOUND;
     }
 
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+        YoriLibIniFree(IniDocument);
         YoriLibFreeStringContents(&FullTargetDirectory);
         YoriPkgFreeBackupPackage(Context);
         return ERROR_NOT_ENOUGH_MEMORY;
@@ -357,12 +365,12 @@ YoriPkgBackupPackage(
         YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
 
         IniValue.LengthInChars =
-            DllKernel32.pGetPrivateProfileStringW(Context->PackageName.StartOfString,
-                                                  FileIndexString,
-                                                  _T(""),
-                                                  IniValue.StartOfString,
-                                                  IniValue.LengthAllocated,
-                                                  IniPath->StartOfString);
+            YoriLibIniGetString(IniDocument,
+                                Context->PackageName.StartOfString,
+                                FileIndexString,
+                                _T(""),
+                                IniValue.StartOfString,
+                                IniValue.LengthAllocated);
 
         //
         //  Don't backup files with absolute paths
@@ -374,7 +382,8 @@ YoriPkgBackupPackage(
 
         BackupFile = YoriLibReferencedMalloc(sizeof(YORIPKG_BACKUP_FILE));
         if (BackupFile == NULL) {
-            YoriPkgRollbackRenamedFiles(IniPath, Context, FALSE);
+            YoriPkgRollbackRenamedFiles(IniDocument, Context, FALSE);
+            YoriLibIniFree(IniDocument);
             YoriLibFreeStringContents(&FullTargetDirectory);
             YoriLibFreeStringContents(&IniValue);
             YoriPkgFreeBackupPackage(Context);
@@ -385,7 +394,8 @@ YoriPkgBackupPackage(
 
         YoriLibYPrintf(&BackupFile->OriginalName, _T("%y\\%y"), &FullTargetDirectory, &IniValue);
         if (BackupFile->OriginalName.LengthInChars == 0) {
-            YoriPkgRollbackRenamedFiles(IniPath, Context, FALSE);
+            YoriPkgRollbackRenamedFiles(IniDocument, Context, FALSE);
+            YoriLibIniFree(IniDocument);
             YoriLibFreeStringContents(&FullTargetDirectory);
             YoriLibFreeStringContents(&IniValue);
             YoriLibDereference(BackupFile);
@@ -401,7 +411,8 @@ YoriPkgBackupPackage(
         if (!YoriLibRenameFileToBackupName(&BackupFile->OriginalName, &BackupFile->BackupName)) {
             Err = GetLastError();
             if (Err != ERROR_FILE_NOT_FOUND) {
-                YoriPkgRollbackRenamedFiles(IniPath, Context, FALSE);
+                YoriPkgRollbackRenamedFiles(IniDocument, Context, FALSE);
+            YoriLibIniFree(IniDocument);
                 YoriLibFreeStringContents(&BackupFile->OriginalName);
                 YoriLibFreeStringContents(&FullTargetDirectory);
                 YoriLibFreeStringContents(&IniValue);
@@ -414,6 +425,7 @@ YoriPkgBackupPackage(
         YoriLibAppendList(&Context->FileList, &BackupFile->ListEntry);
 
     }
+    YoriLibIniFree(IniDocument);
     YoriLibFreeStringContents(&FullTargetDirectory);
     YoriLibFreeStringContents(&IniValue);
 
@@ -438,10 +450,16 @@ YoriPkgRemoveSystemReferencesToPackage(
     __in PYORIPKG_BACKUP_PACKAGE PackageBackup
     )
 {
-    ASSERT(DllKernel32.pWritePrivateProfileStringW != NULL);
+    PYORI_LIB_INI_DOCUMENT IniDocument;
+
+    if (!YoriLibIniLoad(IniPath, &IniDocument)) {
+        return;
+    }
 
-    DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, NULL, NULL, IniPath->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(_T("Installed"), PackageBackup->PackageName.StartOfString, NULL, IniPath->StartOfString);
+    YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, NULL, NULL);
+    YoriLibIniSetString(IniDocument, _T("Installed"), PackageBackup->PackageName.StartOfString, NULL);
+    YoriLibIniSave(IniDocument);
+    YoriLibIniFree(IniDocument);
 }
 
 /**
@@ -469,8 +487,6 @@ YoriPkgRollbackAndFreeBackupPackageList(
     PYORI_LIST_ENTRY ListEntry = NULL;
     PYORIPKG_BACKUP_PACKAGE BackupPackage;
 
-    ASSERT(DllKernel32.pWritePrivateProfileStringW != NULL);
-
     ListEntry = YoriLibGetNextListEntry(ListHead, ListEntry);
     while (ListEntry != NULL) {
         BackupPackage = CONTAINING_RECORD(ListEntry, YORIPKG_BACKUP_PACKAGE, PackageList);
@@ -628,23 +644,24 @@ YoriPkgAddExistingFilesToPendingPackages(
     DWORD FileCount;
     DWORD FileIndex;
     TCHAR FileIndexString[16];
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileSectionW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL) {
+    if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
+    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+        YoriLibFreeStringContents(&InstalledSection);
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+    if (!YoriLibIniLoad(PkgIniFile, &IniDocument)) {
         YoriLibFreeStringContents(&InstalledSection);
+        YoriLibFreeStringContents(&IniValue);
         return FALSE;
     }
 
-    InstalledSection.LengthInChars = DllKernel32.pGetPrivateProfileSectionW(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile->StartOfString);
+    InstalledSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -662,19 +679,20 @@ YoriPkgAddExistingFilesToPendingPackages(
         ThisLine++;
         PkgNameOnly.StartOfString[PkgNameOnly.LengthInChars] = '\0';
 
-        FileCount = DllKernel32.pGetPrivateProfileIntW(PkgNameOnly.StartOfString, _T("FileCount"), 0, PkgIniFile->StartOfString);
+        FileCount = YoriLibIniGetInt(IniDocument, PkgNameOnly.StartOfString, _T("FileCount"), 0);
 
         for (FileIndex = 1; FileIndex <= FileCount; FileIndex++) {
             YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
 
             IniValue.LengthInChars =
-                DllKernel32.pGetPrivateProfileStringW(PkgNameOnly.StartOfString,
-                                                      FileIndexString,
-                                                      _T(""),
-                                                      IniValue.StartOfString,
-                                                      IniValue.LengthAllocated,
-                                                      PkgIniFile->StartOfString);
+                YoriLibIniGetString(IniDocument,
+                                    PkgNameOnly.StartOfString,
+                                    FileIndexString,
+                                    _T(""),
+                                    IniValue.StartOfString,
+                                    IniValue.LengthAllocated);
             if (!YoriPkgAddExistingFileToPendingPackages(PendingPackages, &IniValue)) {
+                YoriLibIniFree(IniDocument);
                 YoriLibFreeStringContents(&InstalledSection);
                 YoriLibFreeStringContents(&IniValue);
                 return FALSE;
@@ -682,6 +700,7 @@ YoriPkgAddExistingFilesToPendingPackages(
         }
     }
 
+    YoriLibIniFree(IniDocument);
     YoriLibFreeStringContents(&InstalledSection);
     YoriLibFreeStringContents(&IniValue);
 
@@ -842,12 +861,12 @@ YoriPkgPreparePackageForInstall(
     LPTSTR ThisLine;
     LPTSTR Equals;
     PYORIPKG_BACKUP_PACKAGE BackupPackage;
+    PYORI_LIB_INI_DOCUMENT PkgIniDocument;
+    PYORI_LIB_INI_DOCUMENT PkgInfoDocument;
     DWORD Result = ERROR_SUCCESS;
 
-    if (DllKernel32.pGetPrivateProfileSectionW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL) {
-        return ERROR_PROC_NOT_FOUND;
-    }
+    PkgIniDocument = NULL;
+    PkgInfoDocument = NULL;
 
     if (RedirectToPackageUrl != NULL) {
         YoriLibInitEmptyString(RedirectToPackageUrl);
@@ -934,18 +953,24 @@ YoriPkgPreparePackageForInstall(
     //  is already present.  If it is, we need to delete it.
     //
 
+    if (!YoriLibIniLoad(PkgIniFile, &PkgIniDocument)) {
+        PkgIniDocument = NULL;
+        Result = ERROR_NOT_ENOUGH_MEMORY;
+        goto Exit;
+    }
+
     if (!YoriLibAllocateString(&PkgInstalled, YORIPKG_MAX_FIELD_LENGTH)) {
         Result = ERROR_NOT_ENOUGH_MEMORY;
         goto Exit;
     }
 
     PkgInstalled.LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Installed"),
-                                              PendingPackage->PackageName.StartOfString,
-                                              _T(""),
-                                              PkgInstalled.StartOfString,
-                                              PkgInstalled.LengthAllocated,
-                                              PkgIniFile->StartOfString);
+        YoriLibIniGetString(PkgIniDocument,
+                            _T("Installed"),
+                            PendingPackage->PackageName.StartOfString,
+                            _T(""),
+                            PkgInstalled.StartOfString,
+                            PkgInstalled.LengthAllocated);
 
     //
     //  If the version being installed is already there, we're done.
@@ -994,6 +1019,7 @@ YoriPkgPreparePackageForInstall(
             goto Exit;
         }
         YoriPkgRemoveSystemReferencesToPackage(PkgIniFile, BackupPackage);
+        YoriLibIniSetString(PkgIniDocument, _T("Installed"), PendingPackage->PackageName.StartOfString, NULL);
         YoriLibAppendList(&PackageList->BackupPackages, &BackupPackage->PackageList);
     }
 
@@ -1008,8 +1034,16 @@ YoriPkgPreparePackageForInstall(
         goto Exit;
     }
 
+    if (!YoriLibIniLoad(&TempPath, &PkgInfoDocument)) {
+        PkgInfoDocument = NULL;
+        YoriLibFreeStringContents(&ReplacesList);
+        YoriLibFreeStringContents(&PkgInstalled);
+        Result = ERROR_NOT_ENOUGH_MEMORY;
+        goto Exit;
+    }
+
     YoriLibInitEmptyString(&PkgToReplace);
-    ReplacesList.LengthInChars = DllKernel32.pGetPrivateProfileSectionW(_T("Replaces"), ReplacesList.StartOfString, ReplacesList.LengthAllocated, TempPath.StartOfString);
+    ReplacesList.LengthInChars = YoriLibIniGetSection(PkgInfoDocument, _T("Replaces"), ReplacesList.StartOfString, ReplacesList.LengthAllocated);
     ThisLine = ReplacesList.StartOfString;
 
     while (*ThisLine != '\0') {
@@ -1029,25 +1063,35 @@ YoriPkgPreparePackageForInstall(
         //
 
         PkgInstalled.LengthInChars =
-            DllKernel32.pGetPrivateProfileStringW(_T("Installed"),
-                                                  PkgToReplace.StartOfString,
-                                                  _T(""),
-                                                  PkgInstalled.StartOfString,
-                                                  PkgInstalled.LengthAllocated,
-                                                  PkgIniFile->StartOfString);
+            YoriLibIniGetString(PkgIniDocument,
+                                _T("Installed"),
+                                PkgToReplace.StartOfString,
+                                _T(""),
+                                PkgInstalled.StartOfString,
+                                PkgInstalled.LengthAllocated);
         if (PkgInstalled.LengthInChars > 0) {
             Result = YoriPkgBackupPackage(PkgIniFile, &PkgToReplace, TargetDirectory, &BackupPackage);
             if (Result != ERROR_SUCCESS) {
                 YoriLibFreeStringContents(&ReplacesList);
+                YoriLibFreeStringContents(&PkgInstalled);
                 goto Exit;
             }
+
+            //
+            //  Keep the in memory copy consistent with the file, so a
+            //  package listed twice is only backed up once.
+            //
+
             YoriPkgRemoveSystemReferencesToPackage(PkgIniFile, BackupPackage);
+            YoriLibIniSetString(PkgIniDocument, _T("Installed"), PkgToReplace.StartOfString, NULL);
             YoriLibAppendList(&PackageList->BackupPackages, &BackupPackage->PackageList);
         }
         ThisLine += LineLength + 1;
     }
     YoriLibFreeStringContents(&ReplacesList);
     YoriLibFreeStringContents(&PkgInstalled);
+    YoriLibIniFree(PkgInfoDocument);
+    YoriLibIniFree(PkgIniDocument);
 
     DeleteFile(TempPath.StartOfString);
     YoriLibFreeStringContents(&TempPath);
@@ -1057,6 +1101,12 @@ YoriPkgPreparePackageForInstall(
 
 Exit:
 
+    if (PkgInfoDocument != NULL) {
+        YoriLibIniFree(PkgInfoDocument);
+    }
+    if (PkgIniDocument != NULL) {
+        YoriLibIniFree(PkgIniDocument);
+    }
     if (TempPath.LengthInChars > 0) {
         DeleteFile(TempPath.StartOfString);
     }
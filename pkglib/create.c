@@ -105,13 +105,10 @@ YoriPkgCreateBinaryPackage(
     PVOID LineContext = NULL;
     HANDLE FileListSource;
     DWORD Count;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     PVOID CabHandle;
 
-    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
-        return FALSE;
-    }
-
     __analysis_assume(ReplaceCount == 0 || Replaces != NULL);
 
     //
@@ -140,35 +137,49 @@ YoriPkgCreateBinaryPackage(
     TempFile.LengthInChars = _tcslen(TempFile.StartOfString);
     YoriLibFreeStringContents(&TempPath);
 
-    DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("Name"), PackageName->StartOfString, TempFile.StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("Architecture"), Architecture->StartOfString, TempFile.StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("Version"), Version->StartOfString, TempFile.StartOfString);
+    if (!YoriLibIniLoad(&TempFile, &IniDocument)) {
+        DeleteFile(TempFile.StartOfString);
+        YoriLibFreeStringContents(&TempFile);
+        return FALSE;
+    }
+
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Name"), PackageName->StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Architecture"), Architecture->StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Version"), Version->StartOfString);
     if (MinimumOSBuild != NULL) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("MinimumOSBuild"), MinimumOSBuild->StartOfString, TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Package"), _T("MinimumOSBuild"), MinimumOSBuild->StartOfString);
         if (PackagePathForOlderBuilds != NULL) {
-            DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("PackagePathForOlderBuilds"), PackagePathForOlderBuilds->StartOfString, TempFile.StartOfString);
+            YoriLibIniSetString(IniDocument, _T("Package"), _T("PackagePathForOlderBuilds"), PackagePathForOlderBuilds->StartOfString);
         }
     }
     if (UpgradePath != NULL) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("UpgradePath"), UpgradePath->StartOfString, TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Package"), _T("UpgradePath"), UpgradePath->StartOfString);
     }
     if (SourcePath != NULL) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("SourcePath"), SourcePath->StartOfString, TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Package"), _T("SourcePath"), SourcePath->StartOfString);
     }
     if (SymbolPath != NULL) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("SymbolPath"), SymbolPath->StartOfString, TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Package"), _T("SymbolPath"), SymbolPath->StartOfString);
     }
     if (UpgradeToStablePath != NULL) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("UpgradeToStablePath"), UpgradeToStablePath->StartOfString, TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Package"), _T("UpgradeToStablePath"), UpgradeToStablePath->StartOfString);
     }
     if (UpgradeToDailyPath != NULL) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("UpgradeToDailyPath"), UpgradeToDailyPath->StartOfString, TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Package"), _T("UpgradeToDailyPath"), UpgradeToDailyPath->StartOfString);
     }
 
     for (Count = 0; Count < ReplaceCount; Count++) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Replaces"), Replaces[Count].StartOfString, _T("1"), TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Replaces"), Replaces[Count].StartOfString, _T("1"));
     }
 
+    if (!YoriLibIniSave(IniDocument)) {
+        YoriLibIniFree(IniDocument);
+        DeleteFile(TempFile.StartOfString);
+        YoriLibFreeStringContents(&TempFile);
+        return FALSE;
+    }
+    YoriLibIniFree(IniDocument);
+
     if (!YoriLibUserStringToSingleFilePath(FileListFile, TRUE, &FullFileListFile)) {
         YoriLibFreeStringContents(&TempFile);
         return FALSE;
@@ -577,6 +588,7 @@ YoriPkgCreateSourcePackage(
     YORI_STRING PkgInfoName;
     YORI_STRING ExcludeFilePath;
     YORIPKG_CREATE_SOURCE_CONTEXT CreateSourceContext;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     ZeroMemory(&CreateSourceContext, sizeof(CreateSourceContext));
     YoriLibInitializeListHead(&CreateSourceContext.ExcludeList);
@@ -608,9 +620,23 @@ YoriPkgCreateSourcePackage(
     TempFile.LengthInChars = _tcslen(TempFile.StartOfString);
     YoriLibFreeStringContents(&TempPath);
 
-    DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("Name"), PackageName->StartOfString, TempFile.StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("Version"), Version->StartOfString, TempFile.StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(_T("Package"), _T("Architecture"), _T("noarch"), TempFile.StartOfString);
+    if (!YoriLibIniLoad(&TempFile, &IniDocument)) {
+        DeleteFile(TempFile.StartOfString);
+        YoriLibFreeStringContents(&TempFile);
+        return FALSE;
+    }
+
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Name"), PackageName->StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Version"), Version->StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Architecture"), _T("noarch"));
+
+    if (!YoriLibIniSave(IniDocument)) {
+        YoriLibIniFree(IniDocument);
+        DeleteFile(TempFile.StartOfString);
+        YoriLibFreeStringContents(&TempFile);
+        return FALSE;
+    }
+    YoriLibIniFree(IniDocument);
 
     if (!YoriLibCreateCab(FileName, &CreateSourceContext.CabHandle)) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("YoriLibCreateCab failure\n"));
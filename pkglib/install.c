@@ -136,12 +136,7 @@ YoriPkgCheckIfPackageDeleteable(
     TCHAR FileIndexString[16];
     BOOL DeleteResult;
     BOOL BestEffortDelete;
-
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL) {
-
-        return FALSE;
-    }
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
         return FALSE;
@@ -154,6 +149,7 @@ YoriPkgCheckIfPackageDeleteable(
         }
     } else {
         if (!YoriLibAllocateString(&AppPath, TargetDirectory->LengthInChars + MAX_PATH)) {
+            YoriLibFreeStringContents(&IniValue);
             return FALSE;
         }
         memcpy(AppPath.StartOfString, TargetDirectory->StartOfString, TargetDirectory->LengthInChars * sizeof(TCHAR));
@@ -161,10 +157,17 @@ YoriPkgCheckIfPackageDeleteable(
         AppPath.LengthInChars = TargetDirectory->LengthInChars;
     }
 
-    BestEffortDelete = DllKernel32.pGetPrivateProfileIntW(PackageName->StartOfString, _T("BestEffortDelete"), 0, PkgIniFile->StartOfString);
+    if (!YoriLibIniLoad(PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&AppPath);
+        YoriLibFreeStringContents(&IniValue);
+        return FALSE;
+    }
 
-    FileCount = DllKernel32.pGetPrivateProfileIntW(PackageName->StartOfString, _T("FileCount"), 0, PkgIniFile->StartOfString);
+    BestEffortDelete = YoriLibIniGetInt(IniDocument, PackageName->StartOfString, _T("BestEffortDelete"), 0);
+
+    FileCount = YoriLibIniGetInt(IniDocument, PackageName->StartOfString, _T("FileCount"), 0);
     if (FileCount == 0) {
+        YoriLibIniFree(IniDocument);
         YoriLibFreeStringContents(&AppPath);
         YoriLibFreeStringContents(&IniValue);
         return FALSE;
@@ -172,6 +175,7 @@ YoriPkgCheckIfPackageDeleteable(
 
     YoriLibInitEmptyString(&FileToDelete);
     if (!YoriLibAllocateString(&FileToDelete, AppPath.LengthInChars + YORIPKG_MAX_FIELD_LENGTH)) {
+        YoriLibIniFree(IniDocument);
         YoriLibFreeStringContents(&AppPath);
         YoriLibFreeStringContents(&IniValue);
         return FALSE;
@@ -181,12 +185,12 @@ YoriPkgCheckIfPackageDeleteable(
         YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
 
         IniValue.LengthInChars =
-            DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                                  FileIndexString,
-                                                  _T(""),
-                                                  IniValue.StartOfString,
-                                                  IniValue.LengthAllocated,
-                                                  PkgIniFile->StartOfString);
+            YoriLibIniGetString(IniDocument,
+                                PackageName->StartOfString,
+                                FileIndexString,
+                                _T(""),
+                                IniValue.StartOfString,
+                                IniValue.LengthAllocated);
         if (IniValue.LengthInChars > 0) {
             if (!YoriLibIsPathPrefixed(&IniValue)) {
                 YoriLibYPrintf(&FileToDelete, _T("%y\\%y"), &AppPath, &IniValue);
@@ -200,6 +204,10 @@ YoriPkgCheckIfPackageDeleteable(
                 YORI_STRING ModuleName;
 
                 if (!YoriPkgGetExecutableFile(&ModuleName)) {
+                    YoriLibIniFree(IniDocument);
+                    YoriLibFreeStringContents(&IniValue);
+                    YoriLibFreeStringContents(&AppPath);
+                    YoriLibFreeStringContents(&FileToDelete);
                     return FALSE;
                 }
 
@@ -220,6 +228,7 @@ YoriPkgCheckIfPackageDeleteable(
             //
 
             if (!DeleteResult && !BestEffortDelete) {
+                YoriLibIniFree(IniDocument);
                 YoriLibFreeStringContents(&IniValue);
                 YoriLibFreeStringContents(&AppPath);
                 YoriLibFreeStringContents(&FileToDelete);
@@ -228,6 +237,7 @@ YoriPkgCheckIfPackageDeleteable(
         }
     }
 
+    YoriLibIniFree(IniDocument);
     YoriLibFreeStringContents(&IniValue);
     YoriLibFreeStringContents(&AppPath);
     YoriLibFreeStringContents(&FileToDelete);
@@ -350,13 +360,7 @@ YoriPkgDeletePackageInternal(
     TCHAR FileIndexString[16];
     DWORD DeleteResult;
     BOOL BestEffortDelete;
-
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
-
-        return ERROR_PROC_NOT_FOUND;
-    }
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
         return ERROR_NOT_ENOUGH_MEMORY;
@@ -369,6 +373,7 @@ YoriPkgDeletePackageInternal(
         }
     } else {
         if (!YoriLibAllocateString(&AppPath, TargetDirectory->LengthInChars + MAX_PATH)) {
+            YoriLibFreeStringContents(&IniValue);
             return ERROR_NOT_ENOUGH_MEMORY;
         }
         memcpy(AppPath.StartOfString, TargetDirectory->StartOfString, TargetDirectory->LengthInChars * sizeof(TCHAR));
@@ -376,10 +381,17 @@ YoriPkgDeletePackageInternal(
         AppPath.LengthInChars = TargetDirectory->LengthInChars;
     }
 
-    BestEffortDelete = DllKernel32.pGetPrivateProfileIntW(PackageName->StartOfString, _T("BestEffortDelete"), 0, PkgIniFile->StartOfString);
+    if (!YoriLibIniLoad(PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&AppPath);
+        YoriLibFreeStringContents(&IniValue);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    BestEffortDelete = YoriLibIniGetInt(IniDocument, PackageName->StartOfString, _T("BestEffortDelete"), 0);
 
-    FileCount = DllKernel32.pGetPrivateProfileIntW(PackageName->StartOfString, _T("FileCount"), 0, PkgIniFile->StartOfString);
+    FileCount = YoriLibIniGetInt(IniDocument, PackageName->StartOfString, _T("FileCount"), 0);
     if (FileCount == 0) {
+        YoriLibIniFree(IniDocument);
         YoriLibFreeStringContents(&AppPath);
         YoriLibFreeStringContents(&IniValue);
         return ERROR_MOD_NOT_FOUND;
@@ -387,6 +399,7 @@ YoriPkgDeletePackageInternal(
 
     YoriLibInitEmptyString(&FileToDelete);
     if (!YoriLibAllocateString(&FileToDelete, AppPath.LengthInChars + YORIPKG_MAX_FIELD_LENGTH)) {
+        YoriLibIniFree(IniDocument);
         YoriLibFreeStringContents(&AppPath);
         YoriLibFreeStringContents(&IniValue);
         return ERROR_NOT_ENOUGH_MEMORY;
@@ -396,12 +409,12 @@ YoriPkgDeletePackageInternal(
         YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
 
         IniValue.LengthInChars =
-            DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                                  FileIndexString,
-                                                  _T(""),
-                                                  IniValue.StartOfString,
-                                                  IniValue.LengthAllocated,
-                                                  PkgIniFile->StartOfString);
+            YoriLibIniGetString(IniDocument,
+                                PackageName->StartOfString,
+                                FileIndexString,
+                                _T(""),
+                                IniValue.StartOfString,
+                                IniValue.LengthAllocated);
         if (IniValue.LengthInChars > 0) {
             if (!YoriLibIsPathPrefixed(&IniValue)) {
                 YoriLibYPrintf(&FileToDelete, _T("%y\\%y"), &AppPath, &IniValue);
@@ -415,7 +428,12 @@ YoriPkgDeletePackageInternal(
                 YORI_STRING ModuleName;
 
                 if (!YoriPkgGetExecutableFile(&ModuleName)) {
-                    return FALSE;
+                    YoriLibIniSave(IniDocument);
+                    YoriLibIniFree(IniDocument);
+                    YoriLibFreeStringContents(&IniValue);
+                    YoriLibFreeStringContents(&AppPath);
+                    YoriLibFreeStringContents(&FileToDelete);
+                    return ERROR_NOT_ENOUGH_MEMORY;
                 }
 
                 //
@@ -440,6 +458,7 @@ YoriPkgDeletePackageInternal(
             //
 
             if (DeleteResult != ERROR_SUCCESS && !BestEffortDelete && FileIndex == 1) {
+                YoriLibIniFree(IniDocument);
                 YoriLibFreeStringContents(&IniValue);
                 YoriLibFreeStringContents(&AppPath);
                 YoriLibFreeStringContents(&FileToDelete);
@@ -447,26 +466,33 @@ YoriPkgDeletePackageInternal(
             }
         }
 
-        DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, FileIndexString, NULL, PkgIniFile->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageName->StartOfString, FileIndexString, NULL);
     }
 
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("FileCount"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("Architecture"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("UpgradePath"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("SourcePath"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("SymbolPath"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("UpgradeToDailyPath"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("UpgradeToStablePath"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("Version"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(_T("Installed"), PackageName->StartOfString, NULL, PkgIniFile->StartOfString);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("FileCount"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("Architecture"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("UpgradePath"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("SourcePath"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("SymbolPath"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("UpgradeToDailyPath"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("UpgradeToStablePath"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("Version"), NULL);
+    YoriLibIniSetString(IniDocument, _T("Installed"), PackageName->StartOfString, NULL);
 
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, NULL, NULL, PkgIniFile->StartOfString);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, NULL, NULL);
 
+    if (!YoriLibIniSave(IniDocument)) {
+        DeleteResult = GetLastError();
+    } else {
+        DeleteResult = ERROR_SUCCESS;
+    }
+
+    YoriLibIniFree(IniDocument);
     YoriLibFreeStringContents(&IniValue);
     YoriLibFreeStringContents(&AppPath);
     YoriLibFreeStringContents(&FileToDelete);
 
-    return ERROR_SUCCESS;
+    return DeleteResult;
 }
 
 
@@ -482,9 +508,9 @@ typedef struct _YORIPKG_INSTALL_PKG_CONTEXT {
     PYORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
 
     /**
-     Path to the INI file recording package installation.
+     The INI document recording package installation.
      */
-    PYORI_STRING IniFileName;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     /**
      The name of the package being installed.
@@ -536,8 +562,6 @@ YoriPkgInstallPackageFileCallback(
     PYORIPKG_INSTALL_PKG_CONTEXT InstallContext = (PYORIPKG_INSTALL_PKG_CONTEXT)Context;
     TCHAR FileIndexString[16];
 
-    ASSERT(DllKernel32.pWritePrivateProfileStringW != NULL);
-
     if (InstallContext->ConflictingFileFound) {
         return FALSE;
     }
@@ -557,10 +581,10 @@ YoriPkgInstallPackageFileCallback(
     InstallContext->NumberFiles++;
     YoriLibSPrintf(FileIndexString, _T("File%i"), InstallContext->NumberFiles);
 
-    DllKernel32.pWritePrivateProfileStringW(InstallContext->PackageName->StartOfString,
-                                            FileIndexString,
-                                            RelativePath->StartOfString,
-                                            InstallContext->IniFileName->StartOfString);
+    YoriLibIniSetString(InstallContext->IniDocument,
+                        InstallContext->PackageName->StartOfString,
+                        FileIndexString,
+                        RelativePath->StartOfString);
     return TRUE;
 }
 
@@ -628,6 +652,7 @@ YoriPkgInstallPackage(
     DWORD Error = ERROR_SUCCESS;
     BOOL Result = FALSE;
     TCHAR FileIndexString[16];
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     ZeroMemory(&InstallContext, sizeof(InstallContext));
 
@@ -635,12 +660,7 @@ YoriPkgInstallPackage(
 
     YoriLibInitEmptyString(&FullTargetDirectory);
     YoriLibInitEmptyString(&PkgIniFile);
-
-    if (DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
-
-        goto Exit;
-    }
+    IniDocument = NULL;
 
     //
     //  Create path to system packages.ini
@@ -651,6 +671,11 @@ YoriPkgInstallPackage(
         goto Exit;
     }
 
+    if (!YoriLibIniLoad(&PkgIniFile, &IniDocument)) {
+        IniDocument = NULL;
+        goto Exit;
+    }
+
     if (TargetDirectory != NULL) {
         if (!YoriLibUserStringToSingleFilePath(TargetDirectory, FALSE, &FullTargetDirectory)) {
             YoriLibInitEmptyString(&FullTargetDirectory);
@@ -679,12 +704,12 @@ YoriPkgInstallPackage(
         }
 
         PkgToDelete.LengthInChars =
-            DllKernel32.pGetPrivateProfileStringW(_T("Installed"),
-                                                  Package->PackageName.StartOfString,
-                                                  _T(""),
-                                                  PkgToDelete.StartOfString,
-                                                  PkgToDelete.LengthAllocated,
-                                                  PkgIniFile.StartOfString);
+            YoriLibIniGetString(IniDocument,
+                                _T("Installed"),
+                                Package->PackageName.StartOfString,
+                                _T(""),
+                                PkgToDelete.StartOfString,
+                                PkgToDelete.LengthAllocated);
 
         //
         //  If the version being installed is already there, we're done.
@@ -715,12 +740,21 @@ YoriPkgInstallPackage(
     //  upgrade will detect a new version and will retry.
     //
 
-    DllKernel32.pWritePrivateProfileStringW(_T("Installed"), Package->PackageName.StartOfString, _T("0"), PkgIniFile.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Installed"), Package->PackageName.StartOfString, _T("0"));
     if (Package->UpgradePath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString,
-                                                _T("UpgradePath"),
-                                                Package->UpgradePath.StartOfString,
-                                                PkgIniFile.StartOfString);
+        YoriLibIniSetString(IniDocument,
+                            Package->PackageName.StartOfString,
+                            _T("UpgradePath"),
+                            Package->UpgradePath.StartOfString);
+    }
+
+    //
+    //  Commit the placeholder before extracting anything, so that an
+    //  interrupted install is still recorded on disk.
+    //
+
+    if (!YoriLibIniSave(IniDocument)) {
+        goto Exit;
     }
 
     if (YoriLibGetWofVersionAvailable(&FullTargetDirectory)) {
@@ -740,7 +774,7 @@ YoriPkgInstallPackage(
     //
 
     InstallContext.PendingPackages = PendingPackages;
-    InstallContext.IniFileName = &PkgIniFile;
+    InstallContext.IniDocument = IniDocument;
     InstallContext.PackageName = &Package->PackageName;
     InstallContext.NumberFiles = 0;
     InstallContext.ConflictingFileFound = FALSE;
@@ -762,7 +796,7 @@ YoriPkgInstallPackage(
         //  Mark the package as not requiring upgrade
         //
 
-        DllKernel32.pWritePrivateProfileStringW(_T("Installed"), Package->PackageName.StartOfString, NULL, PkgIniFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Installed"), Package->PackageName.StartOfString, NULL);
 
         //
         //  Remove any trailing newlines in the returned error string
@@ -789,44 +823,50 @@ YoriPkgInstallPackage(
     }
 
     if (InstallContext.ConflictingFileFound) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Installed"), Package->PackageName.StartOfString, NULL, PkgIniFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Installed"), Package->PackageName.StartOfString, NULL);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Install aborted due to file conflict\n"));
         goto Exit;
     }
 
-    DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("Version"), Package->Version.StartOfString, PkgIniFile.StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("Architecture"), Package->Architecture.StartOfString, PkgIniFile.StartOfString);
+    YoriLibIniSetString(IniDocument, Package->PackageName.StartOfString, _T("Version"), Package->Version.StartOfString);
+    YoriLibIniSetString(IniDocument, Package->PackageName.StartOfString, _T("Architecture"), Package->Architecture.StartOfString);
     if (Package->UpgradePath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("UpgradePath"), Package->UpgradePath.StartOfString, PkgIniFile.StartOfString);
+        YoriLibIniSetString(IniDocument, Package->PackageName.StartOfString, _T("UpgradePath"), Package->UpgradePath.StartOfString);
     }
     if (Package->SourcePath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("SourcePath"), Package->SourcePath.StartOfString, PkgIniFile.StartOfString);
+        YoriLibIniSetString(IniDocument, Package->PackageName.StartOfString, _T("SourcePath"), Package->SourcePath.StartOfString);
     }
     if (Package->SymbolPath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("SymbolPath"), Package->SymbolPath.StartOfString, PkgIniFile.StartOfString);
+        YoriLibIniSetString(IniDocument, Package->PackageName.StartOfString, _T("SymbolPath"), Package->SymbolPath.StartOfString);
     }
     if (Package->UpgradeToDailyPath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString,
-                                                _T("UpgradeToDailyPath"),
-                                                Package->UpgradeToDailyPath.StartOfString,
-                                                PkgIniFile.StartOfString);
+        YoriLibIniSetString(IniDocument,
+                            Package->PackageName.StartOfString,
+                            _T("UpgradeToDailyPath"),
+                            Package->UpgradeToDailyPath.StartOfString);
     }
 
     if (Package->UpgradeToStablePath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString,
-                                                _T("UpgradeToStablePath"),
-                                                Package->UpgradeToStablePath.StartOfString,
-                                                PkgIniFile.StartOfString);
+        YoriLibIniSetString(IniDocument,
+                            Package->PackageName.StartOfString,
+                            _T("UpgradeToStablePath"),
+                            Package->UpgradeToStablePath.StartOfString);
     }
 
     YoriLibSPrintf(FileIndexString, _T("%i"), InstallContext.NumberFiles);
 
-    DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("FileCount"), FileIndexString, PkgIniFile.StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(_T("Installed"), Package->PackageName.StartOfString, Package->Version.StartOfString, PkgIniFile.StartOfString);
+    YoriLibIniSetString(IniDocument, Package->PackageName.StartOfString, _T("FileCount"), FileIndexString);
+    YoriLibIniSetString(IniDocument, _T("Installed"), Package->PackageName.StartOfString, Package->Version.StartOfString);
 
     Result = TRUE;
 
 Exit:
+    if (IniDocument != NULL) {
+        if (!YoriLibIniSave(IniDocument)) {
+            Result = FALSE;
+        }
+        YoriLibIniFree(IniDocument);
+    }
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&FullTargetDirectory);
     if (InstallContext.CompressFiles) {
@@ -868,22 +908,25 @@ YoriPkgBuildUpgradeLocationForNewArchitecture(
 {
     YORI_STRING IniValue;
     YORI_STRING ExistingArchAndExtension;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
-    if (DllKernel32.pGetPrivateProfileStringW == NULL) {
+    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+    if (!YoriLibIniLoad(PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&IniValue);
         return FALSE;
     }
 
     IniValue.LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("Architecture"),
-                                              _T(""),
-                                              IniValue.StartOfString,
-                                              IniValue.LengthAllocated,
-                                              PkgIniFile->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            PackageName->StartOfString,
+                            _T("Architecture"),
+                            _T(""),
+                            IniValue.StartOfString,
+                            IniValue.LengthAllocated);
+    YoriLibIniFree(IniDocument);
     if (IniValue.LengthInChars == 0) {
         YoriLibFreeStringContents(&IniValue);
         return FALSE;
@@ -361,19 +361,22 @@ YoriPkgCollectSourcesFromIni(
     PYORIPKG_REMOTE_SOURCE ExistingSource;
     PYORI_LIST_ENTRY ListEntry;
     BOOL DuplicateFound;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     YoriLibInitEmptyString(&IniValue);
     YoriLibInitEmptyString(&IniKey);
+    IniDocument = NULL;
 
-    if (DllKernel32.pGetPrivateProfileStringW == NULL) {
+    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
         goto Exit;
     }
 
-    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+    if (!YoriLibAllocateString(&IniKey, YORIPKG_MAX_FIELD_LENGTH)) {
         goto Exit;
     }
 
-    if (!YoriLibAllocateString(&IniKey, YORIPKG_MAX_FIELD_LENGTH)) {
+    if (!YoriLibIniLoad(IniPath, &IniDocument)) {
+        IniDocument = NULL;
         goto Exit;
     }
 
@@ -382,12 +385,12 @@ YoriPkgCollectSourcesFromIni(
         while (TRUE) {
             IniKey.LengthInChars = YoriLibSPrintf(IniKey.StartOfString, _T("Source%i"), Index);
             IniValue.LengthInChars =
-                DllKernel32.pGetPrivateProfileStringW(_T("Sources"),
-                                                      IniKey.StartOfString,
-                                                      _T(""),
-                                                      IniValue.StartOfString,
-                                                      IniValue.LengthAllocated,
-                                                      IniPath->StartOfString);
+                YoriLibIniGetString(IniDocument,
+                                    _T("Sources"),
+                                    IniKey.StartOfString,
+                                    _T(""),
+                                    IniValue.StartOfString,
+                                    IniValue.LengthAllocated);
             if (IniValue.LengthInChars == 0) {
                 break;
             }
@@ -421,6 +424,9 @@ YoriPkgCollectSourcesFromIni(
 
     Result = TRUE;
 Exit:
+    if (IniDocument != NULL) {
+        YoriLibIniFree(IniDocument);
+    }
     YoriLibFreeStringContents(&IniValue);
     YoriLibFreeStringContents(&IniKey);
     return Result;
@@ -531,6 +537,7 @@ YoriPkgCollectPackagesFromSource(
     TCHAR IniKey[sizeof("noarch.packagepathforolderbuilds")];
     DWORD ArchIndex;
     DWORD Result;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     YoriLibInitEmptyString(&LocalPath);
     YoriLibInitEmptyString(&ProvidesSection);
@@ -538,13 +545,7 @@ YoriPkgCollectPackagesFromSource(
     YoriLibInitEmptyString(&PkgVersion);
     YoriLibInitEmptyString(&MinimumOSBuild);
     YoriLibInitEmptyString(&PackagePathForOlderBuilds);
-
-    if (DllKernel32.pGetPrivateProfileSectionW == NULL) {
-        Result = FALSE;
-        YoriLibInitEmptyString(&LocalPath);
-        DeleteWhenFinished = FALSE;
-        goto Exit;
-    }
+    IniDocument = NULL;
 
     Result = YoriPkgPackagePathToLocalPath(&Source->SourcePkgList, PackagesIni, &LocalPath, &DeleteWhenFinished);
     if (Result != ERROR_SUCCESS) {
@@ -572,11 +573,16 @@ YoriPkgCollectPackagesFromSource(
     YoriLibCloneString(&PackagePathForOlderBuilds, &MinimumOSBuild);
     PackagePathForOlderBuilds.StartOfString += YORIPKG_MAX_SECTION_LENGTH;
 
-    ProvidesSection.LengthInChars = DllKernel32.pGetPrivateProfileSectionW(
-                                                             _T("Provides"),
-                                                             ProvidesSection.StartOfString,
-                                                             ProvidesSection.LengthAllocated,
-                                                             LocalPath.StartOfString);
+    if (!YoriLibIniLoad(&LocalPath, &IniDocument)) {
+        IniDocument = NULL;
+        Result = ERROR_NOT_ENOUGH_MEMORY;
+        goto Exit;
+    }
+
+    ProvidesSection.LengthInChars = YoriLibIniGetSection(IniDocument,
+                                                         _T("Provides"),
+                                                         ProvidesSection.StartOfString,
+                                                         ProvidesSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = ProvidesSection.StartOfString;
@@ -595,24 +601,22 @@ YoriPkgCollectPackagesFromSource(
 
         PkgNameOnly.StartOfString[PkgNameOnly.LengthInChars] = '\0';
 
-        PkgVersion.LengthInChars = DllKernel32.pGetPrivateProfileStringW(
-                                                    PkgNameOnly.StartOfString,
-                                                    _T("Version"),
-                                                    _T(""),
-                                                    PkgVersion.StartOfString,
-                                                    PkgVersion.LengthAllocated,
-                                                    LocalPath.StartOfString);
+        PkgVersion.LengthInChars = YoriLibIniGetString(IniDocument,
+                                                       PkgNameOnly.StartOfString,
+                                                       _T("Version"),
+                                                       _T(""),
+                                                       PkgVersion.StartOfString,
+                                                       PkgVersion.LengthAllocated);
 
         if (PkgVersion.LengthInChars > 0) {
             for (ArchIndex = 0; ArchIndex < sizeof(KnownArchitectures)/sizeof(KnownArchitectures[0]); ArchIndex++) {
                 YoriLibConstantString(&Architecture, KnownArchitectures[ArchIndex]);
-                IniValue.LengthInChars = DllKernel32.pGetPrivateProfileStringW(
-                                                          PkgNameOnly.StartOfString,
-                                                          Architecture.StartOfString,
-                                                          _T(""),
-                                                          IniValue.StartOfString,
-                                                          IniValue.LengthAllocated,
-                                                          LocalPath.StartOfString);
+                IniValue.LengthInChars = YoriLibIniGetString(IniDocument,
+                                                             PkgNameOnly.StartOfString,
+                                                             Architecture.StartOfString,
+                                                             _T(""),
+                                                             IniValue.StartOfString,
+                                                             IniValue.LengthAllocated);
                 if (IniValue.LengthInChars > 0) {
                     PYORIPKG_REMOTE_PACKAGE Package;
 
@@ -620,22 +624,20 @@ YoriPkgCollectPackagesFromSource(
 
                     YoriLibSPrintf(IniKey, _T("%y.minimumosbuild"), &Architecture);
 
-                    MinimumOSBuild.LengthInChars = DllKernel32.pGetPrivateProfileStringW(
-                                                                    PkgNameOnly.StartOfString,
-                                                                    IniKey,
-                                                                    _T(""),
-                                                                    MinimumOSBuild.StartOfString,
-                                                                    MinimumOSBuild.LengthAllocated,
-                                                                    LocalPath.StartOfString);
+                    MinimumOSBuild.LengthInChars = YoriLibIniGetString(IniDocument,
+                                                                       PkgNameOnly.StartOfString,
+                                                                       IniKey,
+                                                                       _T(""),
+                                                                       MinimumOSBuild.StartOfString,
+                                                                       MinimumOSBuild.LengthAllocated);
                     if (MinimumOSBuild.LengthInChars > 0) {
                         YoriLibSPrintf(IniKey, _T("%y.packagepathforolderbuilds"), &Architecture);
-                        PackagePathForOlderBuilds.LengthInChars = DllKernel32.pGetPrivateProfileStringW(
-                                PkgNameOnly.StartOfString,
-                                IniKey,
-                                _T(""),
-                                PackagePathForOlderBuilds.StartOfString,
-                                PackagePathForOlderBuilds.LengthAllocated,
-                                LocalPath.StartOfString);
+                        PackagePathForOlderBuilds.LengthInChars = YoriLibIniGetString(IniDocument,
+                                                                                      PkgNameOnly.StartOfString,
+                                                                                      IniKey,
+                                                                                      _T(""),
+                                                                                      PackagePathForOlderBuilds.StartOfString,
+                                                                                      PackagePathForOlderBuilds.LengthAllocated);
                     }
 
                     Package = YoriPkgAllocateRemotePackage(&PkgNameOnly,
@@ -659,6 +661,9 @@ YoriPkgCollectPackagesFromSource(
     }
 
 Exit:
+    if (IniDocument != NULL) {
+        YoriLibIniFree(IniDocument);
+    }
     if (DeleteWhenFinished) {
         DeleteFile(LocalPath.StartOfString);
     }
@@ -909,10 +914,8 @@ YoriPkgDownloadRemotePackages(
     DWORD Index;
     DWORD Err;
     BOOL DeleteWhenFinished;
-
-    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
-        return FALSE;
-    }
+    BOOL Result;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     YoriPkgCollectAllSourcesAndPackages(Source, NULL, &SourcesList, &PackageList);
 
@@ -923,6 +926,12 @@ YoriPkgDownloadRemotePackages(
         return FALSE;
     }
 
+    if (!YoriLibIniLoad(&PackagesIni, &IniDocument)) {
+        YoriPkgFreeAllSourcesAndPackages(&SourcesList, &PackageList);
+        YoriLibFreeStringContents(&PackagesIni);
+        return FALSE;
+    }
+
     //
     //  Download the packages we found.
     //
@@ -983,27 +992,27 @@ YoriPkgDownloadRemotePackages(
 
             if (Err == ERROR_SUCCESS) {
                 YORI_STRING TempKeyString;
-                DllKernel32.pWritePrivateProfileStringW(_T("Provides"),
-                                                        Package->PackageName.StartOfString,
-                                                        Package->Version.StartOfString,
-                                                        PackagesIni.StartOfString);
-                DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString,
-                                                        _T("Version"),
-                                                        Package->Version.StartOfString,
-                                                        PackagesIni.StartOfString);
-                DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString,
-                                                        Package->Architecture.StartOfString,
-                                                        FinalFileName.StartOfString,
-                                                        PackagesIni.StartOfString);
+                YoriLibIniSetString(IniDocument,
+                                    _T("Provides"),
+                                    Package->PackageName.StartOfString,
+                                    Package->Version.StartOfString);
+                YoriLibIniSetString(IniDocument,
+                                    Package->PackageName.StartOfString,
+                                    _T("Version"),
+                                    Package->Version.StartOfString);
+                YoriLibIniSetString(IniDocument,
+                                    Package->PackageName.StartOfString,
+                                    Package->Architecture.StartOfString,
+                                    FinalFileName.StartOfString);
 
                 if (Package->MinimumOSBuild.LengthInChars != 0) {
                     YoriLibInitEmptyString(&TempKeyString);
                     YoriLibYPrintf(&TempKeyString, _T("%y.minimumosbuild"), &Package->Architecture);
                     if (TempKeyString.LengthInChars > 0) {
-                        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString,
-                                                                TempKeyString.StartOfString,
-                                                                Package->MinimumOSBuild.StartOfString,
-                                                                PackagesIni.StartOfString);
+                        YoriLibIniSetString(IniDocument,
+                                            Package->PackageName.StartOfString,
+                                            TempKeyString.StartOfString,
+                                            Package->MinimumOSBuild.StartOfString);
                         YoriLibFreeStringContents(&TempKeyString);
                     }
 
@@ -1013,10 +1022,10 @@ YoriPkgDownloadRemotePackages(
                     YoriLibInitEmptyString(&TempKeyString);
                     YoriLibYPrintf(&TempKeyString, _T("%y.packagepathforolderbuilds"), &Package->Architecture);
                     if (TempKeyString.LengthInChars > 0) {
-                        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString,
-                                                                TempKeyString.StartOfString,
-                                                                Package->PackagePathForOlderBuilds.StartOfString,
-                                                                PackagesIni.StartOfString);
+                        YoriLibIniSetString(IniDocument,
+                                            Package->PackageName.StartOfString,
+                                            TempKeyString.StartOfString,
+                                            Package->PackagePathForOlderBuilds.StartOfString);
                         YoriLibFreeStringContents(&TempKeyString);
                     }
 
@@ -1036,10 +1045,17 @@ YoriPkgDownloadRemotePackages(
         PackageEntry = YoriLibGetNextListEntry(&PackageList, PackageEntry);
     }
 
+    //
+    //  Write the index once, after all packages have been processed.
+    //
+
+    Result = YoriLibIniSave(IniDocument);
+    YoriLibIniFree(IniDocument);
+
     YoriPkgFreeAllSourcesAndPackages(&SourcesList, &PackageList);
     YoriLibFreeStringContents(&PackagesIni);
 
-    return TRUE;
+    return Result;
 }
 
 /**
@@ -1812,13 +1828,11 @@ YoriPkgAddNewSource(
     YORI_STRING PackagesIni;
     DWORD Index;
     YORI_STRING IniKey;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
+    BOOL Result;
 
     YoriLibInitializeListHead(&SourcesList);
 
-    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
-        return FALSE;
-    }
-
     if (!YoriPkgGetPackageIniFile(NULL, &PackagesIni)) {
         return FALSE;
     }
@@ -1863,7 +1877,15 @@ YoriPkgAddNewSource(
         YoriLibFreeStringContents(&PackagesIni);
         return FALSE;
     }
-    DllKernel32.pWritePrivateProfileStringW(_T("Sources"), NULL, NULL, PackagesIni.StartOfString);
+
+    if (!YoriLibIniLoad(&PackagesIni, &IniDocument)) {
+        YoriLibFreeStringContents(&IniKey);
+        YoriPkgFreeAllSourcesAndPackages(&SourcesList, NULL);
+        YoriLibFreeStringContents(&PackagesIni);
+        return FALSE;
+    }
+
+    YoriLibIniSetString(IniDocument, _T("Sources"), NULL, NULL);
     SourceEntry = NULL;
     Index = 1;
     SourceEntry = YoriLibGetNextListEntry(&SourcesList, SourceEntry);
@@ -1871,15 +1893,18 @@ YoriPkgAddNewSource(
         Source = CONTAINING_RECORD(SourceEntry, YORIPKG_REMOTE_SOURCE, SourceList);
         SourceEntry = YoriLibGetNextListEntry(&SourcesList, SourceEntry);
         IniKey.LengthInChars = YoriLibSPrintf(IniKey.StartOfString, _T("Source%i"), Index);
-        DllKernel32.pWritePrivateProfileStringW(_T("Sources"), IniKey.StartOfString, Source->SourceRootUrl.StartOfString, PackagesIni.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Sources"), IniKey.StartOfString, Source->SourceRootUrl.StartOfString);
         Index++;
     }
 
+    Result = YoriLibIniSave(IniDocument);
+    YoriLibIniFree(IniDocument);
+
     YoriLibFreeStringContents(&IniKey);
     YoriPkgFreeAllSourcesAndPackages(&SourcesList, NULL);
     YoriLibFreeStringContents(&PackagesIni);
 
-    return TRUE;
+    return Result;
 }
 
 /**
@@ -1901,6 +1926,8 @@ YoriPkgDeleteSource(
     YORI_STRING PackagesIni;
     DWORD Index;
     YORI_STRING IniKey;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
+    BOOL Result;
 
     YoriLibInitializeListHead(&SourcesList);
 
@@ -1937,7 +1964,15 @@ YoriPkgDeleteSource(
         YoriLibFreeStringContents(&PackagesIni);
         return FALSE;
     }
-    DllKernel32.pWritePrivateProfileStringW(_T("Sources"), NULL, NULL, PackagesIni.StartOfString);
+
+    if (!YoriLibIniLoad(&PackagesIni, &IniDocument)) {
+        YoriLibFreeStringContents(&IniKey);
+        YoriPkgFreeAllSourcesAndPackages(&SourcesList, NULL);
+        YoriLibFreeStringContents(&PackagesIni);
+        return FALSE;
+    }
+
+    YoriLibIniSetString(IniDocument, _T("Sources"), NULL, NULL);
     SourceEntry = NULL;
     Index = 1;
     SourceEntry = YoriLibGetNextListEntry(&SourcesList, SourceEntry);
@@ -1945,18 +1980,21 @@ YoriPkgDeleteSource(
         Source = CONTAINING_RECORD(SourceEntry, YORIPKG_REMOTE_SOURCE, SourceList);
         SourceEntry = YoriLibGetNextListEntry(&SourcesList, SourceEntry);
         IniKey.LengthInChars = YoriLibSPrintf(IniKey.StartOfString, _T("Source%i"), Index);
-        DllKernel32.pWritePrivateProfileStringW(_T("Sources"),
-                                                IniKey.StartOfString,
-                                                Source->SourceRootUrl.StartOfString,
-                                                PackagesIni.StartOfString);
+        YoriLibIniSetString(IniDocument,
+                            _T("Sources"),
+                            IniKey.StartOfString,
+                            Source->SourceRootUrl.StartOfString);
         Index++;
     }
 
+    Result = YoriLibIniSave(IniDocument);
+    YoriLibIniFree(IniDocument);
+
     YoriLibFreeStringContents(&IniKey);
     YoriPkgFreeAllSourcesAndPackages(&SourcesList, NULL);
     YoriLibFreeStringContents(&PackagesIni);
 
-    return TRUE;
+    return Result;
 }
 
 // vim:sw=4:ts=4:et:
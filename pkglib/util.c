@@ -199,12 +199,14 @@ YoriPkgGetPackageInfo(
 {
     YORI_STRING TempBuffer;
     DWORD MaxFieldSize = YORIPKG_MAX_FIELD_LENGTH;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
-    if (DllKernel32.pGetPrivateProfileStringW == NULL) {
+    if (!YoriLibIniLoad(IniPath, &IniDocument)) {
         return FALSE;
     }
 
     if (!YoriLibAllocateString(&TempBuffer, 10 * MaxFieldSize)) {
+        YoriLibIniFree(IniDocument);
         return FALSE;
     }
 
@@ -212,121 +214,122 @@ YoriPkgGetPackageInfo(
     PackageName->LengthAllocated = MaxFieldSize;
 
     PackageName->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Package"),
-                                              _T("Name"),
-                                              _T(""),
-                                              PackageName->StartOfString,
-                                              PackageName->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Package"),
+                            _T("Name"),
+                            _T(""),
+                            PackageName->StartOfString,
+                            PackageName->LengthAllocated);
 
     YoriLibCloneString(PackageVersion, &TempBuffer);
     PackageVersion->StartOfString += 1 * MaxFieldSize;
     PackageVersion->LengthAllocated = MaxFieldSize;
 
     PackageVersion->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Package"),
-                                              _T("Version"),
-                                              _T(""),
-                                              PackageVersion->StartOfString,
-                                              PackageVersion->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Package"),
+                            _T("Version"),
+                            _T(""),
+                            PackageVersion->StartOfString,
+                            PackageVersion->LengthAllocated);
 
     YoriLibCloneString(PackageArch, &TempBuffer);
     PackageArch->StartOfString += 2 * MaxFieldSize;
     PackageArch->LengthAllocated = MaxFieldSize;
 
     PackageArch->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Package"),
-                                              _T("Architecture"),
-                                              _T(""),
-                                              PackageArch->StartOfString,
-                                              PackageArch->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Package"),
+                            _T("Architecture"),
+                            _T(""),
+                            PackageArch->StartOfString,
+                            PackageArch->LengthAllocated);
 
     YoriLibCloneString(MinimumOSBuild, &TempBuffer);
     MinimumOSBuild->StartOfString += 3 * MaxFieldSize;
     MinimumOSBuild->LengthAllocated = MaxFieldSize;
 
     MinimumOSBuild->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Package"),
-                                              _T("MinimumOSBuild"),
-                                              _T(""),
-                                              MinimumOSBuild->StartOfString,
-                                              MinimumOSBuild->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Package"),
+                            _T("MinimumOSBuild"),
+                            _T(""),
+                            MinimumOSBuild->StartOfString,
+                            MinimumOSBuild->LengthAllocated);
 
     YoriLibCloneString(PackagePathForOlderBuilds, &TempBuffer);
     PackagePathForOlderBuilds->StartOfString += 4 * MaxFieldSize;
     PackagePathForOlderBuilds->LengthAllocated = MaxFieldSize;
 
     PackagePathForOlderBuilds->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Package"),
-                                              _T("PackagePathForOlderBuilds"),
-                                              _T(""),
-                                              PackagePathForOlderBuilds->StartOfString,
-                                              PackagePathForOlderBuilds->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Package"),
+                            _T("PackagePathForOlderBuilds"),
+                            _T(""),
+                            PackagePathForOlderBuilds->StartOfString,
+                            PackagePathForOlderBuilds->LengthAllocated);
 
     YoriLibCloneString(UpgradePath, &TempBuffer);
     UpgradePath->StartOfString += 5 * MaxFieldSize;
     UpgradePath->LengthAllocated = MaxFieldSize;
 
     UpgradePath->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Package"),
-                                              _T("UpgradePath"),
-                                              _T(""),
-                                              UpgradePath->StartOfString,
-                                              UpgradePath->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Package"),
+                            _T("UpgradePath"),
+                            _T(""),
+                            UpgradePath->StartOfString,
+                            UpgradePath->LengthAllocated);
 
     YoriLibCloneString(SourcePath, &TempBuffer);
     SourcePath->StartOfString += 6 * MaxFieldSize;
     SourcePath->LengthAllocated = MaxFieldSize;
 
     SourcePath->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Package"),
-                                              _T("SourcePath"),
-                                              _T(""),
-                                              SourcePath->StartOfString,
-                                              SourcePath->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Package"),
+                            _T("SourcePath"),
+                            _T(""),
+                            SourcePath->StartOfString,
+                            SourcePath->LengthAllocated);
 
     YoriLibCloneString(SymbolPath, &TempBuffer);
     SymbolPath->StartOfString += 7 * MaxFieldSize;
     SymbolPath->LengthAllocated = MaxFieldSize;
 
     SymbolPath->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Package"),
-                                              _T("SymbolPath"),
-                                              _T(""),
-                                              SymbolPath->StartOfString,
-                                              SymbolPath->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Package"),
+                            _T("SymbolPath"),
+                            _T(""),
+                            SymbolPath->StartOfString,
+                            SymbolPath->LengthAllocated);
 
     YoriLibCloneString(UpgradeToDailyPath, &TempBuffer);
     UpgradeToDailyPath->StartOfString += 8 * MaxFieldSize;
     UpgradeToDailyPath->LengthAllocated = MaxFieldSize;
 
     UpgradeToDailyPath->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Package"),
-                                              _T("UpgradeToDailyPath"),
-                                              _T(""),
-                                              UpgradeToDailyPath->StartOfString,
-                                              UpgradeToDailyPath->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Package"),
+                            _T("UpgradeToDailyPath"),
+                            _T(""),
+                            UpgradeToDailyPath->StartOfString,
+                            UpgradeToDailyPath->LengthAllocated);
 
     YoriLibCloneString(UpgradeToStablePath, &TempBuffer);
     UpgradeToStablePath->StartOfString += 9 * MaxFieldSize;
     UpgradeToStablePath->LengthAllocated = MaxFieldSize;
 
     UpgradeToStablePath->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Package"),
-                                              _T("UpgradeToStablePath"),
-                                              _T(""),
-                                              UpgradeToStablePath->StartOfString,
-                                              UpgradeToStablePath->LengthAllocated,
-                                              IniPath->StartOfString);
-
+        YoriLibIniGetString(IniDocument,
+                            _T("Package"),
+                            _T("UpgradeToStablePath"),
+                            _T(""),
+                            UpgradeToStablePath->StartOfString,
+                            UpgradeToStablePath->LengthAllocated);
+
+    YoriLibIniFree(IniDocument);
     YoriLibFreeStringContents(&TempBuffer);
     return TRUE;
 }
@@ -378,15 +381,16 @@ YoriPkgGetInstalledPackageInfo(
 {
     YORI_STRING TempBuffer;
     DWORD MaxFieldSize = YORIPKG_MAX_FIELD_LENGTH;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
-    ASSERT(YoriLibIsStringNullTerminated(IniPath));
     ASSERT(YoriLibIsStringNullTerminated(PackageName));
 
-    if (DllKernel32.pGetPrivateProfileStringW == NULL) {
+    if (!YoriLibIniLoad(IniPath, &IniDocument)) {
         return FALSE;
     }
 
     if (!YoriLibAllocateString(&TempBuffer, 7 * MaxFieldSize)) {
+        YoriLibIniFree(IniDocument);
         return FALSE;
     }
 
@@ -394,85 +398,86 @@ YoriPkgGetInstalledPackageInfo(
     PackageVersion->LengthAllocated = MaxFieldSize;
 
     PackageVersion->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("Version"),
-                                              _T(""),
-                                              PackageVersion->StartOfString,
-                                              PackageVersion->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            PackageName->StartOfString,
+                            _T("Version"),
+                            _T(""),
+                            PackageVersion->StartOfString,
+                            PackageVersion->LengthAllocated);
 
     YoriLibCloneString(PackageArch, &TempBuffer);
     PackageArch->StartOfString += 1 * MaxFieldSize;
     PackageArch->LengthAllocated = MaxFieldSize;
 
     PackageArch->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("Architecture"),
-                                              _T(""),
-                                              PackageArch->StartOfString,
-                                              PackageArch->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            PackageName->StartOfString,
+                            _T("Architecture"),
+                            _T(""),
+                            PackageArch->StartOfString,
+                            PackageArch->LengthAllocated);
 
     YoriLibCloneString(UpgradePath, &TempBuffer);
     UpgradePath->StartOfString += 2 * MaxFieldSize;
     UpgradePath->LengthAllocated = MaxFieldSize;
 
     UpgradePath->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("UpgradePath"),
-                                              _T(""),
-                                              UpgradePath->StartOfString,
-                                              UpgradePath->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            PackageName->StartOfString,
+                            _T("UpgradePath"),
+                            _T(""),
+                            UpgradePath->StartOfString,
+                            UpgradePath->LengthAllocated);
 
     YoriLibCloneString(SourcePath, &TempBuffer);
     SourcePath->StartOfString += 3 * MaxFieldSize;
     SourcePath->LengthAllocated = MaxFieldSize;
 
     SourcePath->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("SourcePath"),
-                                              _T(""),
-                                              SourcePath->StartOfString,
-                                              SourcePath->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            PackageName->StartOfString,
+                            _T("SourcePath"),
+                            _T(""),
+                            SourcePath->StartOfString,
+                            SourcePath->LengthAllocated);
 
     YoriLibCloneString(SymbolPath, &TempBuffer);
     SymbolPath->StartOfString += 4 * MaxFieldSize;
     SymbolPath->LengthAllocated = MaxFieldSize;
 
     SymbolPath->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("SymbolPath"),
-                                              _T(""),
-                                              SymbolPath->StartOfString,
-                                              SymbolPath->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            PackageName->StartOfString,
+                            _T("SymbolPath"),
+                            _T(""),
+                            SymbolPath->StartOfString,
+                            SymbolPath->LengthAllocated);
 
     YoriLibCloneString(UpgradeToDailyPath, &TempBuffer);
     UpgradeToDailyPath->StartOfString += 5 * MaxFieldSize;
     UpgradeToDailyPath->LengthAllocated = MaxFieldSize;
 
     UpgradeToDailyPath->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("UpgradeToDailyPath"),
-                                              _T(""),
-                                              UpgradeToDailyPath->StartOfString,
-                                              UpgradeToDailyPath->LengthAllocated,
-                                              IniPath->StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            PackageName->StartOfString,
+                            _T("UpgradeToDailyPath"),
+                            _T(""),
+                            UpgradeToDailyPath->StartOfString,
+                            UpgradeToDailyPath->LengthAllocated);
 
     YoriLibCloneString(UpgradeToStablePath, &TempBuffer);
     UpgradeToStablePath->StartOfString += 5 * MaxFieldSize;
     UpgradeToStablePath->LengthAllocated = MaxFieldSize;
 
     UpgradeToStablePath->LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("UpgradeToStablePath"),
-                                              _T(""),
-                                              UpgradeToStablePath->StartOfString,
-                                              UpgradeToStablePath->LengthAllocated,
-                                              IniPath->StartOfString);
-
+        YoriLibIniGetString(IniDocument,
+                            PackageName->StartOfString,
+                            _T("UpgradeToStablePath"),
+                            _T(""),
+                            UpgradeToStablePath->StartOfString,
+                            UpgradeToStablePath->LengthAllocated);
+
+    YoriLibIniFree(IniDocument);
     YoriLibFreeStringContents(&TempBuffer);
     return TRUE;
 }
@@ -524,20 +529,22 @@ YoriPkgLoadMirrorsFromIni(
     BOOL Result = FALSE;
     DWORD Index;
     PYORIPKG_MIRROR Mirror;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     YoriLibInitEmptyString(&IniSection);
     YoriLibInitEmptyString(&Find);
     YoriLibInitEmptyString(&Replace);
 
-    if (DllKernel32.pGetPrivateProfileSectionW == NULL) {
+    if (!YoriLibAllocateString(&IniSection, YORIPKG_MAX_SECTION_LENGTH)) {
         goto Exit;
     }
 
-    if (!YoriLibAllocateString(&IniSection, YORIPKG_MAX_SECTION_LENGTH)) {
+    if (!YoriLibIniLoad(IniFilePath, &IniDocument)) {
         goto Exit;
     }
 
-    IniSection.LengthInChars = DllKernel32.pGetPrivateProfileSectionW(_T("Mirrors"), IniSection.StartOfString, IniSection.LengthAllocated, IniFilePath->StartOfString);
+    IniSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Mirrors"), IniSection.StartOfString, IniSection.LengthAllocated);
+    YoriLibIniFree(IniDocument);
 
     ThisLine = IniSection.StartOfString;
 
@@ -705,13 +712,11 @@ YoriPkgAddNewMirror(
     PYORIPKG_MIRROR NewMirror;
     YORI_STRING PackagesIni;
     DWORD Index;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
+    BOOL Result;
 
     YoriLibInitializeListHead(&MirrorsList);
 
-    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
-        return FALSE;
-    }
-
     if (!YoriPkgGetPackageIniFile(NULL, &PackagesIni)) {
         return FALSE;
     }
@@ -808,13 +813,19 @@ YoriPkgAddNewMirror(
     //  Rewrite the section
     //
 
-    DllKernel32.pWritePrivateProfileStringW(_T("Mirrors"), NULL, NULL, PackagesIni.StartOfString);
-    MirrorEntry = NULL;
-    MirrorEntry = YoriLibGetNextListEntry(&MirrorsList, MirrorEntry);
-    while (MirrorEntry != NULL) {
-        Mirror = CONTAINING_RECORD(MirrorEntry, YORIPKG_MIRROR, MirrorList);
+    Result = FALSE;
+    if (YoriLibIniLoad(&PackagesIni, &IniDocument)) {
+        YoriLibIniSetString(IniDocument, _T("Mirrors"), NULL, NULL);
+        MirrorEntry = NULL;
         MirrorEntry = YoriLibGetNextListEntry(&MirrorsList, MirrorEntry);
-        DllKernel32.pWritePrivateProfileStringW(_T("Mirrors"), Mirror->SourceName.StartOfString, Mirror->TargetName.StartOfString, PackagesIni.StartOfString);
+        while (MirrorEntry != NULL) {
+            Mirror = CONTAINING_RECORD(MirrorEntry, YORIPKG_MIRROR, MirrorList);
+            MirrorEntry = YoriLibGetNextListEntry(&MirrorsList, MirrorEntry);
+            YoriLibIniSetString(IniDocument, _T("Mirrors"), Mirror->SourceName.StartOfString, Mirror->TargetName.StartOfString);
+        }
+
+        Result = YoriLibIniSave(IniDocument);
+        YoriLibIniFree(IniDocument);
     }
 
     //
@@ -823,7 +834,7 @@ YoriPkgAddNewMirror(
 
     YoriPkgFreeMirrorList(&MirrorsList);
     YoriLibFreeStringContents(&PackagesIni);
-    return TRUE;
+    return Result;
 }
 
 /**
@@ -843,13 +854,11 @@ YoriPkgDeleteMirror(
     PYORIPKG_MIRROR Mirror;
     YORI_STRING PackagesIni;
     DWORD Index;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
+    BOOL Result;
 
     YoriLibInitializeListHead(&MirrorsList);
 
-    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
-        return FALSE;
-    }
-
     if (!YoriPkgGetPackageIniFile(NULL, &PackagesIni)) {
         return FALSE;
     }
@@ -896,13 +905,19 @@ YoriPkgDeleteMirror(
     //  Rewrite the section
     //
 
-    DllKernel32.pWritePrivateProfileStringW(_T("Mirrors"), NULL, NULL, PackagesIni.StartOfString);
-    MirrorEntry = NULL;
-    MirrorEntry = YoriLibGetNextListEntry(&MirrorsList, MirrorEntry);
-    while (MirrorEntry != NULL) {
-        Mirror = CONTAINING_RECORD(MirrorEntry, YORIPKG_MIRROR, MirrorList);
+    Result = FALSE;
+    if (YoriLibIniLoad(&PackagesIni, &IniDocument)) {
+        YoriLibIniSetString(IniDocument, _T("Mirrors"), NULL, NULL);
+        MirrorEntry = NULL;
         MirrorEntry = YoriLibGetNextListEntry(&MirrorsList, MirrorEntry);
-        DllKernel32.pWritePrivateProfileStringW(_T("Mirrors"), Mirror->SourceName.StartOfString, Mirror->TargetName.StartOfString, PackagesIni.StartOfString);
+        while (MirrorEntry != NULL) {
+            Mirror = CONTAINING_RECORD(MirrorEntry, YORIPKG_MIRROR, MirrorList);
+            MirrorEntry = YoriLibGetNextListEntry(&MirrorsList, MirrorEntry);
+            YoriLibIniSetString(IniDocument, _T("Mirrors"), Mirror->SourceName.StartOfString, Mirror->TargetName.StartOfString);
+        }
+
+        Result = YoriLibIniSave(IniDocument);
+        YoriLibIniFree(IniDocument);
     }
 
     //
@@ -911,7 +926,7 @@ YoriPkgDeleteMirror(
 
     YoriPkgFreeMirrorList(&MirrorsList);
     YoriLibFreeStringContents(&PackagesIni);
-    return TRUE;
+    return Result;
 }
 
 
@@ -950,6 +965,7 @@ YoriPkgConvertUserPackagePathToMirroredPath(
     BOOL Result = FALSE;
     BOOL ReturnHumanPathIfNoMirrorFound = FALSE;
     DWORD Index;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     YoriLibInitEmptyString(&IniSection);
     YoriLibInitEmptyString(&HumanFullPath);
@@ -957,10 +973,6 @@ YoriPkgConvertUserPackagePathToMirroredPath(
     YoriLibInitEmptyString(&Find);
     YoriLibInitEmptyString(&Replace);
 
-    if (DllKernel32.pGetPrivateProfileSectionW == NULL) {
-        goto Exit;
-    }
-
     if (!YoriLibAllocateString(&IniSection, YORIPKG_MAX_SECTION_LENGTH)) {
         goto Exit;
     }
@@ -975,7 +987,12 @@ YoriPkgConvertUserPackagePathToMirroredPath(
         YoriLibCloneString(&HumanFullPath, PackagePath);
     }
 
-    IniSection.LengthInChars = DllKernel32.pGetPrivateProfileSectionW(_T("Mirrors"), IniSection.StartOfString, IniSection.LengthAllocated, IniFilePath->StartOfString);
+    if (!YoriLibIniLoad(IniFilePath, &IniDocument)) {
+        goto Exit;
+    }
+
+    IniSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Mirrors"), IniSection.StartOfString, IniSection.LengthAllocated);
+    YoriLibIniFree(IniDocument);
 
     ThisLine = IniSection.StartOfString;
 
@@ -46,7 +46,7 @@ CHAR strRegeditHelpText[] =
  The copyright year string to display with license text.
  */
 const
-TCHAR strRegeditCopyrightYear[] = _T("2022");
+TCHAR strRegeditCopyrightYear[] = _T("2019-2026");
 
 /**
  Display usage text to the user.
@@ -62,22 +62,6 @@ RegeditHelp(VOID)
     return TRUE;
 }
 
-/**
- A structure describing the well known root keys.
- */
-typedef struct _REGEDIT_KEY_NAME_PAIR {
-
-    /**
-     The string description of the root key name.
-     */
-    YORI_STRING KeyName;
-
-    /**
-     The pseudo handle to the root key.
-     */
-    HKEY KeyHandle;
-} REGEDIT_KEY_NAME_PAIR, *PREGEDIT_KEY_NAME_PAIR;
-
 /**
  An array of well known root keys.
  */
@@ -88,6 +72,35 @@ CONST REGEDIT_KEY_NAME_PAIR RegeditRootKeys[] = {
     {YORILIB_CONSTANT_STRING(_T("HKEY_USERS")), HKEY_USERS}
 };
 
+/**
+ The number of well known root keys.
+ */
+CONST DWORD RegeditRootKeyCount = sizeof(RegeditRootKeys)/sizeof(RegeditRootKeys[0]);
+
+/**
+ Return the name of a well known root key.
+
+ @param RootKey The pseudo handle to the root key.
+
+ @return Pointer to the name of the root key, or NULL if the key is not a
+         well known root key.
+ */
+PCYORI_STRING
+RegeditGetRootKeyName(
+    __in HKEY RootKey
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < sizeof(RegeditRootKeys)/sizeof(RegeditRootKeys[0]); Index++) {
+        if (RootKey == RegeditRootKeys[Index].KeyHandle) {
+            return &RegeditRootKeys[Index].KeyName;
+        }
+    }
+
+    return NULL;
+}
+
 /**
  Display a dialog box containing the string form of a Win32 error code.
 
@@ -135,11 +148,52 @@ RegeditKeyListSelectionChanged(
 {
     PYORI_WIN_CTRL_HANDLE Parent;
     PREGEDIT_CONTEXT RegeditContext;
+    YORI_STRING String;
+    YORI_STRING Subkey;
+    DWORD ActiveOption;
 
     Parent = YoriWinGetControlParent(Ctrl);
     RegeditContext = YoriWinGetControlContext(Parent);
 
     RegeditContext->MostRecentListSelectedControl = RegeditControlKeyList;
+
+    //
+    //  Start enumerating the selected key in the background, so that if the
+    //  user navigates into it, it can be displayed immediately.  The ..
+    //  entry refers to a parent, which has usually been displayed already.
+    //
+
+    if (!YoriWinListGetActiveOption(Ctrl, &ActiveOption)) {
+        return;
+    }
+
+    if (RegeditContext->TreeDepth == 0) {
+        if (ActiveOption < RegeditRootKeyCount) {
+            YoriLibInitEmptyString(&Subkey);
+            RegeditEnumPrefetch(RegeditContext, RegeditRootKeys[ActiveOption].KeyHandle, &Subkey);
+        }
+        return;
+    }
+
+    if (ActiveOption == 0) {
+        return;
+    }
+
+    YoriLibInitEmptyString(&String);
+    if (!YoriWinListGetItemText(Ctrl, ActiveOption, &String)) {
+        return;
+    }
+
+    if (YoriLibAllocateString(&Subkey, RegeditContext->Subkey.LengthInChars + 1 + String.LengthInChars + 1)) {
+        if (RegeditContext->TreeDepth == 1) {
+            YoriLibYPrintf(&Subkey, _T("%y"), &String);
+        } else {
+            YoriLibYPrintf(&Subkey, _T("%y\\%y"), &RegeditContext->Subkey, &String);
+        }
+        RegeditEnumPrefetch(RegeditContext, RegeditContext->ActiveRootKey, &Subkey);
+        YoriLibFreeStringContents(&Subkey);
+    }
+    YoriLibFreeStringContents(&String);
 }
 
 /**
@@ -163,8 +217,55 @@ RegeditValueListSelectionChanged(
 
 
 /**
- Open the current registry key and populate the lists containing the subkeys
- and values within the currently active key.
+ Update the label describing the currently active key.
+
+ @param RegeditContext Pointer to the global registry editor context.
+
+ @param Parent Pointer to the main window.
+ */
+VOID
+RegeditUpdateKeyCaption(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE Parent
+    )
+{
+    PYORI_WIN_CTRL_HANDLE KeyCaption;
+    PCYORI_STRING RootString;
+    YORI_STRING String;
+
+    KeyCaption = YoriWinFindControlById(Parent, RegeditControlKeyName);
+    ASSERT(KeyCaption != NULL);
+    __analysis_assume(KeyCaption != NULL);
+
+    if (RegeditContext->TreeDepth == 0) {
+        YoriLibConstantString(&String, _T(""));
+        YoriWinLabelSetCaption(KeyCaption, &String);
+        return;
+    }
+
+    RootString = RegeditGetRootKeyName(RegeditContext->ActiveRootKey);
+    ASSERT(RootString != NULL);
+    if (RootString == NULL) {
+        return;
+    }
+
+    if (YoriLibAllocateString(&String, RootString->LengthInChars + 1 + RegeditContext->Subkey.LengthInChars + 1)) {
+        if (RegeditContext->TreeDepth == 1) {
+            YoriLibYPrintf(&String, _T("%y"), RootString);
+        } else {
+            YoriLibYPrintf(&String, _T("%y\\%y"), RootString, &RegeditContext->Subkey);
+        }
+
+        YoriWinLabelSetCaption(KeyCaption, &String);
+        YoriLibFreeStringContents(&String);
+    }
+}
+
+/**
+ Populate the lists containing the subkeys and values within the currently
+ active key.  The key is enumerated on a background thread, so this displays
+ whatever is available after a short wait, and the remainder is added to the
+ lists as it arrives via @ref RegeditEnumUpdateLists .
 
  @param RegeditContext Pointer to the global registry context, indicating the
         currently active key.  This may be a root pseudohandle and subkey, or
@@ -175,6 +276,10 @@ RegeditValueListSelectionChanged(
 
  @param ValueListCtrl Pointer to the list control containing values.
 
+ @param Refresh If TRUE, the key is enumerated again even if its contents
+        have been enumerated previously.  If FALSE, previously enumerated
+        contents can be displayed if the key has not changed since.
+
  @param SelectKey Optionally points to a string containing the previously
         selected key.  On refresh the list of keys will change, but if
         supplied, either this key, or the one following it, or the last
@@ -190,19 +295,15 @@ RegeditPopulateKeyValueList(
     __in PREGEDIT_CONTEXT RegeditContext,
     __in PYORI_WIN_CTRL_HANDLE KeyListCtrl,
     __in PYORI_WIN_CTRL_HANDLE ValueListCtrl,
+    __in BOOLEAN Refresh,
     __in_opt PYORI_STRING SelectKey,
     __in_opt PYORI_STRING SelectValue
     )
 {
     DWORD Index;
+    DWORD Err;
+    YORI_STRING Text;
     PYORI_WIN_CTRL_HANDLE Parent;
-    DWORD ArrayCount;
-    DWORD ArrayElementSize;
-    DWORD SubKeyCount;
-    DWORD ValueCount;
-    DWORD MaxValueNameLength;
-    DWORD MaxSubKeyLength;
-    PYORI_STRING StringArray;
 
     Parent = YoriWinGetControlParent(KeyListCtrl);
     YoriWinListClearAllItems(KeyListCtrl);
@@ -213,212 +314,17 @@ RegeditPopulateKeyValueList(
             YoriWinListAddItems(KeyListCtrl, &RegeditRootKeys[Index].KeyName, 1);
         }
     } else {
-        YORI_STRING Text;
-        DWORD Err;
-        DWORD StringSize;
-        DWORD SelectIndex;
-        DWORD MaxClassLength;
-        DWORD MaxValueData;
-        DWORD SecurityDescriptorLength;
-        DWORD ClassLength;
-        HKEY Key;
-        FILETIME LastWriteTime;
-
         YoriLibConstantString(&Text, _T(".."));
         YoriWinListAddItems(KeyListCtrl, &Text, 1);
+    }
 
-        Err = DllAdvApi32.pRegOpenKeyExW(RegeditContext->ActiveRootKey, RegeditContext->Subkey.StartOfString, 0, KEY_READ, &Key);
-        if (Err != ERROR_SUCCESS) {
-            RegeditDisplayWin32Error(Parent, Err);
-            return;
-        }
-
-        ClassLength = 0;
-        Err = DllAdvApi32.pRegQueryInfoKeyW(Key,
-                                            NULL,
-                                            &ClassLength,
-                                            NULL,
-                                            &SubKeyCount,
-                                            &MaxSubKeyLength,
-                                            &MaxClassLength,
-                                            &ValueCount,
-                                            &MaxValueNameLength,
-                                            &MaxValueData,
-                                            &SecurityDescriptorLength,
-                                            &LastWriteTime);
-
-        //
-        //  Older versions of Windows insist all parameters are populated,
-        //  including the class name, which we don't care about.  If needed,
-        //  allocate space for it, call again, and throw it away.
-        //
-
-        if (Err == ERROR_MORE_DATA || Err == ERROR_INSUFFICIENT_BUFFER) {
-            if (!YoriLibAllocateString(&Text, ClassLength + 1)) {
-                RegeditDisplayWin32Error(Parent, GetLastError());
-                DllAdvApi32.pRegCloseKey(Key);
-                return;
-            }
-
-            ClassLength = Text.LengthAllocated;
-            Err = DllAdvApi32.pRegQueryInfoKeyW(Key,
-                                                Text.StartOfString,
-                                                &ClassLength,
-                                                NULL,
-                                                &SubKeyCount,
-                                                &MaxSubKeyLength,
-                                                &MaxClassLength,
-                                                &ValueCount,
-                                                &MaxValueNameLength,
-                                                &MaxValueData,
-                                                &SecurityDescriptorLength,
-                                                &LastWriteTime);
-            YoriLibFreeStringContents(&Text);
-        }
-
-        if (Err != ERROR_SUCCESS) {
-            RegeditDisplayWin32Error(Parent, Err);
-            return;
-        }
-
-        //
-        //  Use a single array both for keys and values.  This means the
-        //  allocations need to be for the larger of the two.
-        //
-
-        ArrayCount = SubKeyCount;
-        if (ValueCount > ArrayCount) {
-            ArrayCount = ValueCount;
-        }
-
-        ArrayElementSize = MaxSubKeyLength + 1;
-        if (MaxValueNameLength + 1 > ArrayElementSize) {
-            ArrayElementSize = MaxValueNameLength + 1;
-        }
-
-        StringArray = YoriLibMalloc(sizeof(YORI_STRING) * ArrayCount);
-        if (StringArray == NULL) {
-            RegeditDisplayWin32Error(Parent, GetLastError());
-            DllAdvApi32.pRegCloseKey(Key);
-            return;
-        }
-
-        for (Index = 0; Index < ArrayCount; Index++) {
-            YoriLibInitEmptyString(&StringArray[Index]);
-        }
-
-        //
-        //  Enumerate keys
-        //
-
-        for (Index = 0; Index < SubKeyCount; Index++) {
-            if (!YoriLibAllocateString(&StringArray[Index], ArrayElementSize)) {
-                Err = ERROR_OUTOFMEMORY;
-                break;
-            }
-            StringSize = ArrayElementSize;
-            Err = DllAdvApi32.pRegEnumKeyExW(Key, Index, StringArray[Index].StartOfString, &StringSize, NULL, NULL, NULL, &LastWriteTime);
-
-            //
-            //  MSFIX Possibly reallocate
-            //
-
-            if (Err == ERROR_NO_MORE_ITEMS) {
-                Err = ERROR_SUCCESS;
-                break;
-            } else if (Err != ERROR_SUCCESS) {
-                break;
-            }
-
-            StringArray[Index].LengthInChars = StringSize;
-        }
-
-        //
-        //  If it failed, tell the user.  Otherwise, sort, and add them to the
-        //  list.  If an item should be selected, find the index of a matching
-        //  string or the first item to be greater than it, and select that.
-        //
-
-        if (Err != ERROR_SUCCESS) {
-            RegeditDisplayWin32Error(Parent, Err);
-        } else if (Index > 0) {
-            YoriLibSortStringArray(StringArray, Index);
-            YoriWinListAddItems(KeyListCtrl, StringArray, Index);
-            if (SelectKey != NULL) {
-                for (SelectIndex = 0; SelectIndex < Index; SelectIndex++) {
-                    if (YoriLibCompareStringInsensitive(&StringArray[SelectIndex], SelectKey) >= 0) {
-                        break;
-                    }
-                }
-
-                //
-                //  Because of the .. entry above, we normally move forward one
-                //  element.  The exception is if we've already navigated
-                //  beyond the final element.
-                //
-
-                if (SelectIndex < Index) {
-                    SelectIndex++;
-                }
-                YoriWinListSetActiveOption(KeyListCtrl, SelectIndex);
-            }
-        }
-
-        Err = ERROR_SUCCESS;
-
-        //
-        //  Collect values, sort, find item to select, etc.
-        //
-
-        for (Index = 0; Index < ValueCount; Index++) {
-            if (StringArray[Index].LengthAllocated == 0) {
-                if (!YoriLibAllocateString(&StringArray[Index], MaxValueNameLength + 1)) {
-                    Err = ERROR_OUTOFMEMORY;
-                    break;
-                }
-            }
-            StringSize = StringArray[Index].LengthAllocated;
-            Err = DllAdvApi32.pRegEnumValueW(Key, Index, StringArray[Index].StartOfString, &StringSize, NULL, NULL, NULL, NULL);
-
-            //
-            //  MSFIX Possibly reallocate
-            //
-            if (Err == ERROR_NO_MORE_ITEMS) {
-                Err = ERROR_SUCCESS;
-                break;
-            } else if (Err != ERROR_SUCCESS) {
-                break;
-            }
-
-            StringArray[Index].LengthInChars = StringSize;
-        }
-
-        if (Err != ERROR_SUCCESS) {
-            RegeditDisplayWin32Error(Parent, Err);
-        } else {
-            YoriLibSortStringArray(StringArray, Index);
-            YoriWinListAddItems(ValueListCtrl, StringArray, Index);
-            if (SelectValue != NULL) {
-                for (SelectIndex = 0; SelectIndex < Index; SelectIndex++) {
-                    if (YoriLibCompareStringInsensitive(&StringArray[SelectIndex], SelectValue) >= 0) {
-                        break;
-                    }
-                }
-
-                if (SelectIndex == Index) {
-                    SelectIndex--;
-                }
-                YoriWinListSetActiveOption(ValueListCtrl, SelectIndex);
-            }
-        }
-
-        for (Index = 0; Index < ArrayCount; Index++) {
-            YoriLibFreeStringContents(&StringArray[Index]);
-        }
-        YoriLibFree(StringArray);
-
-        DllAdvApi32.pRegCloseKey(Key);
+    Err = RegeditEnumSetActiveKey(RegeditContext, Refresh, SelectKey, SelectValue);
+    if (Err != ERROR_SUCCESS) {
+        RegeditDisplayWin32Error(Parent, Err);
+        return;
     }
+
+    RegeditEnumUpdateLists(RegeditContext, KeyListCtrl, ValueListCtrl);
 }
 
 /**
@@ -483,7 +389,7 @@ RegeditRefreshView(
     //  currently selected text or something adjacent to it.
     //
 
-    RegeditPopulateKeyValueList(RegeditContext, KeyList, ValueList, SelectKey, SelectValue);
+    RegeditPopulateKeyValueList(RegeditContext, KeyList, ValueList, TRUE, SelectKey, SelectValue);
 
     YoriLibFreeStringContents(&PreviouslySelectedKey);
     YoriLibFreeStringContents(&PreviouslySelectedValue);
@@ -860,13 +766,7 @@ RegeditNavigateToSelectedKey(
     __in DWORD SelectedKeyIndex
     )
 {
-    PYORI_WIN_CTRL_HANDLE KeyCaption;
     YORI_STRING String;
-    YORI_STRING NewCaption;
-
-    KeyCaption = YoriWinFindControlById(Parent, RegeditControlKeyName);
-    ASSERT(KeyCaption != NULL);
-    __analysis_assume(KeyCaption != NULL);
 
     YoriLibInitEmptyString(&String);
     YoriWinListGetItemText(KeyList, SelectedKeyIndex, &String);
@@ -909,33 +809,83 @@ RegeditNavigateToSelectedKey(
     }
     YoriLibFreeStringContents(&String);
 
-    YoriLibInitEmptyString(&NewCaption);
-    if (RegeditContext->TreeDepth > 0) {
-        PCYORI_STRING RootString;
-        DWORD Index;
+    RegeditUpdateKeyCaption(RegeditContext, Parent);
+    RegeditPopulateKeyValueList(RegeditContext, KeyList, ValueList, FALSE, NULL, NULL);
+}
 
-        RootString = NULL;
-        for (Index = 0; Index < sizeof(RegeditRootKeys)/sizeof(RegeditRootKeys[0]); Index++) {
-            if (RegeditContext->ActiveRootKey == RegeditRootKeys[Index].KeyHandle) {
-                RootString = &RegeditRootKeys[Index].KeyName;
-            }
-        }
+/**
+ Navigate to a specified key, and select a subkey or value within it.  This
+ is used to display the results of a search.
 
-        ASSERT(RootString != NULL);
+ @param RegeditContext Pointer to the global registry editor context.
 
-        if (YoriLibAllocateString(&String, RootString->LengthInChars + 1 + RegeditContext->Subkey.LengthInChars + 1)) {
-            if (RegeditContext->TreeDepth == 1) {
-                YoriLibYPrintf(&String, _T("%y"), RootString);
-            } else {
-                YoriLibYPrintf(&String, _T("%y\\%y"), RootString, &RegeditContext->Subkey);
-            }
+ @param Parent Pointer to the main window.
 
-            YoriWinLabelSetCaption(KeyCaption, &String);
-            YoriLibFreeStringContents(&String);
+ @param RootKey The root key containing the key to navigate to.
+
+ @param Subkey Pointer to the path of the key to navigate to, relative to the
+        root key.  This may be empty to navigate to the root key itself.
+
+ @param SelectKey Optionally points to the name of a subkey to select.
+
+ @param SelectValue Optionally points to the name of a value to select.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+RegeditNavigateToKey(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE Parent,
+    __in HKEY RootKey,
+    __in PCYORI_STRING Subkey,
+    __in_opt PYORI_STRING SelectKey,
+    __in_opt PYORI_STRING SelectValue
+    )
+{
+    PYORI_WIN_CTRL_HANDLE KeyList;
+    PYORI_WIN_CTRL_HANDLE ValueList;
+    YORI_STRING NewSubkey;
+    DWORD Index;
+
+    KeyList = YoriWinFindControlById(Parent, RegeditControlKeyList);
+    ASSERT(KeyList != NULL);
+    __analysis_assume(KeyList != NULL);
+
+    ValueList = YoriWinFindControlById(Parent, RegeditControlValueList);
+    ASSERT(ValueList != NULL);
+    __analysis_assume(ValueList != NULL);
+
+    if (!YoriLibAllocateString(&NewSubkey, Subkey->LengthInChars + 1)) {
+        return FALSE;
+    }
+
+    memcpy(NewSubkey.StartOfString, Subkey->StartOfString, Subkey->LengthInChars * sizeof(TCHAR));
+    NewSubkey.LengthInChars = Subkey->LengthInChars;
+    NewSubkey.StartOfString[NewSubkey.LengthInChars] = '\0';
+
+    YoriLibFreeStringContents(&RegeditContext->Subkey);
+    memcpy(&RegeditContext->Subkey, &NewSubkey, sizeof(YORI_STRING));
+    RegeditContext->ActiveRootKey = RootKey;
+
+    //
+    //  Depth one is the root key itself, and each component of the subkey
+    //  adds one more level.
+    //
+
+    RegeditContext->TreeDepth = 1;
+    if (NewSubkey.LengthInChars > 0) {
+        RegeditContext->TreeDepth++;
+        for (Index = 0; Index < NewSubkey.LengthInChars; Index++) {
+            if (NewSubkey.StartOfString[Index] == '\\') {
+                RegeditContext->TreeDepth++;
+            }
         }
     }
 
-    RegeditPopulateKeyValueList(RegeditContext, KeyList, ValueList, NULL, NULL);
+    RegeditUpdateKeyCaption(RegeditContext, Parent);
+    RegeditPopulateKeyValueList(RegeditContext, KeyList, ValueList, FALSE, SelectKey, SelectValue);
+    return TRUE;
 }
 
 /**
@@ -1445,6 +1395,56 @@ RegeditCopyKeyButtonClicked(
 }
 
 
+/**
+ Callback invoked when the find menu item is clicked.  This prompts for text
+ and searches the current key and its subkeys for it.
+
+ @param Ctrl Pointer to the menu control.
+ */
+VOID
+RegeditFindButtonClicked(
+    __in PYORI_WIN_CTRL_HANDLE Ctrl
+    )
+{
+    PYORI_WIN_CTRL_HANDLE Parent;
+    PREGEDIT_CONTEXT RegeditContext;
+
+    Parent = YoriWinGetControlParent(Ctrl);
+    RegeditContext = YoriWinGetControlContext(Parent);
+
+    RegeditSearch(RegeditContext, Parent);
+}
+
+/**
+ Callback invoked periodically on the main window.  This adds any keys and
+ values that have been enumerated in the background to the lists.
+
+ @param WindowHandle Pointer to the main window.
+ */
+VOID
+RegeditMainWindowTimer(
+    __in PYORI_WIN_WINDOW_HANDLE WindowHandle
+    )
+{
+    PYORI_WIN_CTRL_HANDLE WindowCtrl;
+    PYORI_WIN_CTRL_HANDLE KeyList;
+    PYORI_WIN_CTRL_HANDLE ValueList;
+    PREGEDIT_CONTEXT RegeditContext;
+
+    WindowCtrl = YoriWinGetCtrlFromWindow(WindowHandle);
+    RegeditContext = YoriWinGetControlContext(WindowCtrl);
+
+    KeyList = YoriWinFindControlById(WindowCtrl, RegeditControlKeyList);
+    ASSERT(KeyList != NULL);
+    __analysis_assume(KeyList != NULL);
+
+    ValueList = YoriWinFindControlById(WindowCtrl, RegeditControlValueList);
+    ASSERT(ValueList != NULL);
+    __analysis_assume(ValueList != NULL);
+
+    RegeditEnumUpdateLists(RegeditContext, KeyList, ValueList);
+}
+
 /**
  Callback invoked when the refresh menu item is clicked.
 
@@ -1641,7 +1641,7 @@ RegeditPopulateMenuBar(
     )
 {
     YORI_WIN_MENU_ENTRY FileMenuEntries[1];
-    YORI_WIN_MENU_ENTRY EditMenuEntries[5];
+    YORI_WIN_MENU_ENTRY EditMenuEntries[7];
     YORI_WIN_MENU_ENTRY ViewMenuEntries[1];
     YORI_WIN_MENU_ENTRY NewMenuEntries[7];
     YORI_WIN_MENU_ENTRY HelpMenuEntries[1];
@@ -1701,6 +1701,13 @@ RegeditPopulateMenuBar(
     YoriLibConstantString(&EditMenuEntries[MenuIndex].Hotkey, _T("Ctrl+C"));
     RegeditContext->CopyKeyMenuIndex = MenuIndex;
 
+    MenuIndex++;
+    EditMenuEntries[MenuIndex].Flags = YORI_WIN_MENU_ENTRY_SEPERATOR;
+    MenuIndex++;
+    YoriLibConstantString(&EditMenuEntries[MenuIndex].Caption, _T("&Find..."));
+    EditMenuEntries[MenuIndex].NotifyCallback = RegeditFindButtonClicked;
+    YoriLibConstantString(&EditMenuEntries[MenuIndex].Hotkey, _T("Ctrl+F"));
+
     ZeroMemory(&ViewMenuEntries, sizeof(ViewMenuEntries));
     MenuIndex = 0;
     YoriLibConstantString(&ViewMenuEntries[MenuIndex].Caption, _T("&Refresh"));
@@ -2038,7 +2045,7 @@ RegeditCreateMainWindow(
     YoriWinSetControlId(ValueList, RegeditControlValueList);
     YoriWinListSetSelectionNotifyCallback(ValueList, RegeditValueListSelectionChanged);
 
-    RegeditPopulateKeyValueList(RegeditContext, KeyList, ValueList, NULL, NULL);
+    RegeditPopulateKeyValueList(RegeditContext, KeyList, ValueList, FALSE, NULL, NULL);
 
     Area.Top = (SHORT)(WindowSize.Y - 3);
     Area.Bottom = (SHORT)(Area.Top + 2);
@@ -2073,6 +2080,12 @@ RegeditCreateMainWindow(
 
     YoriWinSetWindowManagerResizeNotifyCallback(Parent, RegeditResizeWindowManager);
 
+    if (!YoriWinSetWindowTimerNotifyCallback(Parent, REGEDIT_UPDATE_INTERVAL, RegeditMainWindowTimer)) {
+        YoriWinDestroyWindow(Parent);
+        YoriWinCloseWindowManager(WinMgr);
+        return FALSE;
+    }
+
     Result = FALSE;
     if (!YoriWinProcessInputForWindow(Parent, &Result)) {
         Result = FALSE;
@@ -2119,6 +2132,7 @@ ENTRYPOINT(
 
     RegeditContext.UseAsciiDrawing = FALSE;
     RegeditContext.TreeDepth = 0;
+    RegeditContext.EnumCache = NULL;
     YoriLibInitEmptyString(&RegeditContext.Subkey);
 
 
@@ -2167,10 +2181,17 @@ ENTRYPOINT(
         return EXIT_FAILURE;
     }
 
+    if (!RegeditEnumInitialize(&RegeditContext)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("regedit: could not start key enumeration\n"));
+        return EXIT_FAILURE;
+    }
+
     if (!RegeditCreateMainWindow(&RegeditContext)) {
+        RegeditEnumCleanup(&RegeditContext);
         YoriLibFreeStringContents(&RegeditContext.Subkey);
         return EXIT_FAILURE;
     }
+    RegeditEnumCleanup(&RegeditContext);
     YoriLibFreeStringContents(&RegeditContext.Subkey);
     return EXIT_SUCCESS;
 }
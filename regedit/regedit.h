@@ -3,7 +3,7 @@
  *
  * Yori shell registry editor master header
  *
- * Copyright (c) 2019-2022 Malcolm J. Smith
+ * Copyright (c) 2019-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -38,6 +38,36 @@ typedef enum _REGEDIT_CONTROLS {
     RegeditControlValueCaption = 8,
 } REGEDIT_CONTROLS;
 
+/**
+ The interval in milliseconds between checks for results that have been
+ found by background threads.
+ */
+#define REGEDIT_UPDATE_INTERVAL (50)
+
+/**
+ A structure describing the well known root keys.
+ */
+typedef struct _REGEDIT_KEY_NAME_PAIR {
+
+    /**
+     The string description of the root key name.
+     */
+    YORI_STRING KeyName;
+
+    /**
+     The pseudo handle to the root key.
+     */
+    HKEY KeyHandle;
+} REGEDIT_KEY_NAME_PAIR, *PREGEDIT_KEY_NAME_PAIR;
+
+extern CONST REGEDIT_KEY_NAME_PAIR RegeditRootKeys[];
+extern CONST DWORD RegeditRootKeyCount;
+
+/**
+ An opaque structure containing the contents of keys which have been or are
+ being enumerated in the background.
+ */
+typedef struct _REGEDIT_ENUM_CACHE *PREGEDIT_ENUM_CACHE;
 
 /**
  Context for the regedit application.
@@ -89,6 +119,12 @@ typedef struct _REGEDIT_CONTEXT {
      */
     DWORD CopyKeyMenuIndex;
 
+    /**
+     The contents of keys which have been or are being enumerated in the
+     background.
+     */
+    PREGEDIT_ENUM_CACHE EnumCache;
+
     /**
      TRUE to use only 7 bit ASCII characters for visual display.
      */
@@ -96,6 +132,78 @@ typedef struct _REGEDIT_CONTEXT {
 
 } REGEDIT_CONTEXT, *PREGEDIT_CONTEXT;
 
+VOID
+RegeditDisplayWin32Error(
+    __in PYORI_WIN_CTRL_HANDLE Parent,
+    __in DWORD Error
+    );
+
+PCYORI_STRING
+RegeditGetRootKeyName(
+    __in HKEY RootKey
+    );
+
+__success(return)
+BOOLEAN
+RegeditNavigateToKey(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE Parent,
+    __in HKEY RootKey,
+    __in PCYORI_STRING Subkey,
+    __in_opt PYORI_STRING SelectKey,
+    __in_opt PYORI_STRING SelectValue
+    );
+
+DWORD
+RegeditQueryKeyInfo(
+    __in HKEY Key,
+    __out PDWORD SubKeyCount,
+    __out PDWORD MaxSubKeyLength,
+    __out PDWORD ValueCount,
+    __out PDWORD MaxValueNameLength,
+    __out PDWORD MaxValueDataLength,
+    __out PFILETIME LastWriteTime
+    );
+
+__success(return)
+BOOLEAN
+RegeditEnumInitialize(
+    __inout PREGEDIT_CONTEXT RegeditContext
+    );
+
+VOID
+RegeditEnumCleanup(
+    __inout PREGEDIT_CONTEXT RegeditContext
+    );
+
+VOID
+RegeditEnumPrefetch(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in HKEY RootKey,
+    __in PCYORI_STRING Subkey
+    );
+
+DWORD
+RegeditEnumSetActiveKey(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in BOOLEAN Refresh,
+    __in_opt PYORI_STRING SelectKey,
+    __in_opt PYORI_STRING SelectValue
+    );
+
+VOID
+RegeditEnumUpdateLists(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE KeyListCtrl,
+    __in PYORI_WIN_CTRL_HANDLE ValueListCtrl
+    );
+
+VOID
+RegeditSearch(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE Parent
+    );
+
 __success(return)
 BOOLEAN
 RegeditEditBinaryValue(
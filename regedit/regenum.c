@@ -0,0 +1,1247 @@
+/**
+ * @file regedit/regenum.c
+ *
+ * Yori shell registry editor background key enumeration
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yoriwin.h>
+#include <yoridlg.h>
+#include "regedit.h"
+
+/**
+ The maximum number of keys whose contents are retained.  When this is
+ exceeded, the least recently requested key is discarded.
+ */
+#define REGEDIT_ENUM_CACHE_SIZE (32)
+
+/**
+ The number of names to collect before making them visible to the user
+ interface.
+ */
+#define REGEDIT_ENUM_BATCH_SIZE (256)
+
+/**
+ The number of characters to allocate at a time to hold names.
+ */
+#define REGEDIT_ENUM_POOL_CHARS (16 * 1024)
+
+/**
+ The time in milliseconds to wait for a key to be enumerated before
+ displaying whatever is available.  This prevents the lists from visibly
+ flickering when displaying small keys.
+ */
+#define REGEDIT_ENUM_INITIAL_WAIT (100)
+
+/**
+ The state of enumerating the contents of a single key.
+ */
+typedef enum _REGEDIT_KEY_CONTENTS_STATE {
+    RegeditKeyContentsNotStarted = 0,
+    RegeditKeyContentsInProgress = 1,
+    RegeditKeyContentsComplete = 2
+} REGEDIT_KEY_CONTENTS_STATE;
+
+/**
+ A growable array of names.
+ */
+typedef struct _REGEDIT_NAME_ARRAY {
+
+    /**
+     Pointer to the array of names.
+     */
+    PYORI_STRING Names;
+
+    /**
+     The number of names in the array.
+     */
+    DWORD Count;
+
+    /**
+     The number of names allocated in the array.
+     */
+    DWORD Allocated;
+} REGEDIT_NAME_ARRAY, *PREGEDIT_NAME_ARRAY;
+
+/**
+ A block of memory that names are allocated from.  Each name holds a
+ reference to the block.
+ */
+typedef struct _REGEDIT_NAME_POOL {
+
+    /**
+     The referenced allocation that names are being allocated from, or NULL
+     if no block has been allocated.
+     */
+    LPTSTR Block;
+
+    /**
+     The number of characters that have been consumed from the block.
+     */
+    DWORD CharsUsed;
+
+    /**
+     The number of characters in the block.
+     */
+    DWORD CharsAllocated;
+} REGEDIT_NAME_POOL, *PREGEDIT_NAME_POOL;
+
+/**
+ The subkeys and values of a single registry key.
+ */
+typedef struct _REGEDIT_KEY_CONTENTS {
+
+    /**
+     The entry for this key on the list of cached keys.  The list is ordered
+     from most recently requested to least recently requested.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The root key containing the key.
+     */
+    HKEY RootKey;
+
+    /**
+     The path to the key relative to the root key.
+     */
+    YORI_STRING Subkey;
+
+    /**
+     The names of subkeys found so far.
+     */
+    REGEDIT_NAME_ARRAY Keys;
+
+    /**
+     The names of values.  These are only populated once enumeration is
+     complete, because they need to be sorted before display.
+     */
+    REGEDIT_NAME_ARRAY Values;
+
+    /**
+     The last write time of the key when it was enumerated.  This is used
+     to determine whether the contents are still current.
+     */
+    FILETIME LastWriteTime;
+
+    /**
+     The error that terminated enumeration, or ERROR_SUCCESS.
+     */
+    DWORD Error;
+
+    /**
+     The progress in enumerating this key.
+     */
+    REGEDIT_KEY_CONTENTS_STATE State;
+
+    /**
+     Set to TRUE if the subkeys were not returned in sorted order and have
+     been sorted, so any partially displayed list needs to be regenerated.
+     */
+    BOOLEAN KeysResorted;
+
+    /**
+     Set to TRUE if the entry has been removed from the cache while it was
+     being enumerated.  The enumerating thread frees it when it notices.
+     */
+    BOOLEAN Orphaned;
+} REGEDIT_KEY_CONTENTS, *PREGEDIT_KEY_CONTENTS;
+
+/**
+ The cache of key contents, and the state of the thread populating it.
+ */
+typedef struct _REGEDIT_ENUM_CACHE {
+
+    /**
+     Synchronizes access to all of the key contents and the fields below.
+     */
+    CRITICAL_SECTION Lock;
+
+    /**
+     The list of cached keys, most recently requested first.
+     */
+    YORI_LIST_ENTRY ContentsList;
+
+    /**
+     The number of entries on ContentsList.
+     */
+    DWORD ContentsCount;
+
+    /**
+     The key that is currently being displayed, or NULL if the root keys are
+     being displayed.
+     */
+    PREGEDIT_KEY_CONTENTS ActiveContents;
+
+    /**
+     The number of subkeys of ActiveContents that have been added to the
+     key list control.
+     */
+    DWORD KeysDisplayed;
+
+    /**
+     TRUE once the values of ActiveContents have been added to the value
+     list control.
+     */
+    BOOLEAN ValuesDisplayed;
+
+    /**
+     TRUE once any error from enumerating ActiveContents has been displayed.
+     */
+    BOOLEAN ErrorDisplayed;
+
+    /**
+     Set to TRUE to indicate the background thread should exit.
+     */
+    BOOLEAN Terminate;
+
+    /**
+     If not empty, the key to select once enumeration of ActiveContents is
+     complete.
+     */
+    YORI_STRING SelectKey;
+
+    /**
+     If not empty, the value to select once enumeration of ActiveContents is
+     complete.
+     */
+    YORI_STRING SelectValue;
+
+    /**
+     An event signalled when new work is available for the background
+     thread.
+     */
+    HANDLE WorkEvent;
+
+    /**
+     An event signalled by the background thread when it has made new names
+     available.
+     */
+    HANDLE ProgressEvent;
+
+    /**
+     The background thread enumerating keys.
+     */
+    HANDLE WorkerThread;
+} REGEDIT_ENUM_CACHE;
+
+/**
+ Query information about an opened key.  Older versions of Windows insist
+ all parameters are populated, including the class name, which isn't useful
+ here.  If needed, this allocates space for it, calls again, and throws it
+ away.
+
+ @param Key The opened registry key.
+
+ @param SubKeyCount On successful completion, the number of subkeys.
+
+ @param MaxSubKeyLength On successful completion, the length of the longest
+        subkey name, in characters.
+
+ @param ValueCount On successful completion, the number of values.
+
+ @param MaxValueNameLength On successful completion, the length of the
+        longest value name, in characters.
+
+ @param MaxValueDataLength On successful completion, the length of the
+        largest value data, in bytes.
+
+ @param LastWriteTime On successful completion, the time the key was last
+        written.
+
+ @return ERROR_SUCCESS to indicate success, or a Win32 error code to
+         indicate failure.
+ */
+DWORD
+RegeditQueryKeyInfo(
+    __in HKEY Key,
+    __out PDWORD SubKeyCount,
+    __out PDWORD MaxSubKeyLength,
+    __out PDWORD ValueCount,
+    __out PDWORD MaxValueNameLength,
+    __out PDWORD MaxValueDataLength,
+    __out PFILETIME LastWriteTime
+    )
+{
+    YORI_STRING Text;
+    DWORD Err;
+    DWORD MaxClassLength;
+    DWORD SecurityDescriptorLength;
+    DWORD ClassLength;
+
+    ClassLength = 0;
+    Err = DllAdvApi32.pRegQueryInfoKeyW(Key,
+                                        NULL,
+                                        &ClassLength,
+                                        NULL,
+                                        SubKeyCount,
+                                        MaxSubKeyLength,
+                                        &MaxClassLength,
+                                        ValueCount,
+                                        MaxValueNameLength,
+                                        MaxValueDataLength,
+                                        &SecurityDescriptorLength,
+                                        LastWriteTime);
+
+    if (Err == ERROR_MORE_DATA || Err == ERROR_INSUFFICIENT_BUFFER) {
+        if (!YoriLibAllocateString(&Text, ClassLength + 1)) {
+            return ERROR_NOT_ENOUGH_MEMORY;
+        }
+
+        ClassLength = Text.LengthAllocated;
+        Err = DllAdvApi32.pRegQueryInfoKeyW(Key,
+                                            Text.StartOfString,
+                                            &ClassLength,
+                                            NULL,
+                                            SubKeyCount,
+                                            MaxSubKeyLength,
+                                            &MaxClassLength,
+                                            ValueCount,
+                                            MaxValueNameLength,
+                                            MaxValueDataLength,
+                                            &SecurityDescriptorLength,
+                                            LastWriteTime);
+        YoriLibFreeStringContents(&Text);
+    }
+
+    return Err;
+}
+
+/**
+ Free all of the names in a name array.
+
+ @param Array Pointer to the array to free.
+ */
+VOID
+RegeditEnumFreeNameArray(
+    __inout PREGEDIT_NAME_ARRAY Array
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < Array->Count; Index++) {
+        YoriLibFreeStringContents(&Array->Names[Index]);
+    }
+    if (Array->Names != NULL) {
+        YoriLibFree(Array->Names);
+    }
+    Array->Names = NULL;
+    Array->Count = 0;
+    Array->Allocated = 0;
+}
+
+/**
+ Discard any enumerated contents of a key so it can be enumerated again.
+
+ @param Contents Pointer to the key contents.
+ */
+VOID
+RegeditEnumResetContents(
+    __inout PREGEDIT_KEY_CONTENTS Contents
+    )
+{
+    RegeditEnumFreeNameArray(&Contents->Keys);
+    RegeditEnumFreeNameArray(&Contents->Values);
+    Contents->Error = ERROR_SUCCESS;
+    Contents->KeysResorted = FALSE;
+    Contents->State = RegeditKeyContentsNotStarted;
+}
+
+/**
+ Free a key contents structure.
+
+ @param Contents Pointer to the key contents to free.
+ */
+VOID
+RegeditEnumFreeContents(
+    __in PREGEDIT_KEY_CONTENTS Contents
+    )
+{
+    RegeditEnumResetContents(Contents);
+    YoriLibFreeStringContents(&Contents->Subkey);
+    YoriLibFree(Contents);
+}
+
+/**
+ Remove a key contents structure from the cache.  If it is being enumerated
+ it is left for the background thread to free.  The cache lock must be held.
+
+ @param Cache Pointer to the cache.
+
+ @param Contents Pointer to the key contents to remove.
+ */
+VOID
+RegeditEnumRemoveContents(
+    __in PREGEDIT_ENUM_CACHE Cache,
+    __in PREGEDIT_KEY_CONTENTS Contents
+    )
+{
+    YoriLibRemoveListItem(&Contents->ListEntry);
+    Cache->ContentsCount--;
+    if (Cache->ActiveContents == Contents) {
+        Cache->ActiveContents = NULL;
+    }
+    if (Contents->State == RegeditKeyContentsInProgress) {
+        Contents->Orphaned = TRUE;
+    } else {
+        RegeditEnumFreeContents(Contents);
+    }
+}
+
+/**
+ Find the cached contents of a key, or allocate a new entry if the key is
+ not cached.  The entry is moved to the front of the cache, indicating it is
+ the most recently requested.  The cache lock must be held.
+
+ @param Cache Pointer to the cache.
+
+ @param RootKey The root key containing the key.
+
+ @param Subkey Pointer to the path of the key relative to the root key.
+
+ @return Pointer to the key contents, or NULL on allocation failure.
+ */
+PREGEDIT_KEY_CONTENTS
+RegeditEnumLookupContents(
+    __in PREGEDIT_ENUM_CACHE Cache,
+    __in HKEY RootKey,
+    __in PCYORI_STRING Subkey
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PREGEDIT_KEY_CONTENTS Contents;
+
+    ListEntry = YoriLibGetNextListEntry(&Cache->ContentsList, NULL);
+    while (ListEntry != NULL) {
+        Contents = CONTAINING_RECORD(ListEntry, REGEDIT_KEY_CONTENTS, ListEntry);
+        if (Contents->RootKey == RootKey &&
+            YoriLibCompareStringInsensitive(&Contents->Subkey, Subkey) == 0) {
+
+            YoriLibRemoveListItem(&Contents->ListEntry);
+            YoriLibInsertList(&Cache->ContentsList, &Contents->ListEntry);
+            return Contents;
+        }
+        ListEntry = YoriLibGetNextListEntry(&Cache->ContentsList, ListEntry);
+    }
+
+    Contents = YoriLibMalloc(sizeof(REGEDIT_KEY_CONTENTS));
+    if (Contents == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Contents, sizeof(REGEDIT_KEY_CONTENTS));
+    if (!YoriLibAllocateString(&Contents->Subkey, Subkey->LengthInChars + 1)) {
+        YoriLibFree(Contents);
+        return NULL;
+    }
+    memcpy(Contents->Subkey.StartOfString, Subkey->StartOfString, Subkey->LengthInChars * sizeof(TCHAR));
+    Contents->Subkey.LengthInChars = Subkey->LengthInChars;
+    Contents->Subkey.StartOfString[Contents->Subkey.LengthInChars] = '\0';
+    Contents->RootKey = RootKey;
+    Contents->State = RegeditKeyContentsNotStarted;
+
+    YoriLibInsertList(&Cache->ContentsList, &Contents->ListEntry);
+    Cache->ContentsCount++;
+
+    //
+    //  If the cache is too large, discard the least recently requested
+    //  entries that are not currently displayed or being enumerated.
+    //
+
+    ListEntry = YoriLibGetPreviousListEntry(&Cache->ContentsList, NULL);
+    while (ListEntry != NULL && Cache->ContentsCount > REGEDIT_ENUM_CACHE_SIZE) {
+        PREGEDIT_KEY_CONTENTS Victim;
+        Victim = CONTAINING_RECORD(ListEntry, REGEDIT_KEY_CONTENTS, ListEntry);
+        ListEntry = YoriLibGetPreviousListEntry(&Cache->ContentsList, ListEntry);
+        if (Victim != Contents &&
+            Victim != Cache->ActiveContents &&
+            Victim->State != RegeditKeyContentsInProgress) {
+
+            RegeditEnumRemoveContents(Cache, Victim);
+        }
+    }
+
+    return Contents;
+}
+
+/**
+ Copy a name into a name pool, and return a string referencing it.
+
+ @param Pool Pointer to the pool to allocate from.
+
+ @param Name Pointer to the characters of the name.
+
+ @param NameLength The length of the name, in characters.
+
+ @param String On successful completion, populated with a referenced string
+        containing the name.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+RegeditEnumAllocateName(
+    __inout PREGEDIT_NAME_POOL Pool,
+    __in LPCTSTR Name,
+    __in DWORD NameLength,
+    __out PYORI_STRING String
+    )
+{
+    LPTSTR NewBlock;
+    DWORD CharsToAllocate;
+
+    if (Pool->Block == NULL || Pool->CharsUsed + NameLength + 1 > Pool->CharsAllocated) {
+        CharsToAllocate = REGEDIT_ENUM_POOL_CHARS;
+        if (CharsToAllocate < NameLength + 1) {
+            CharsToAllocate = NameLength + 1;
+        }
+        NewBlock = YoriLibReferencedMalloc(CharsToAllocate * sizeof(TCHAR));
+        if (NewBlock == NULL) {
+            return FALSE;
+        }
+        if (Pool->Block != NULL) {
+            YoriLibDereference(Pool->Block);
+        }
+        Pool->Block = NewBlock;
+        Pool->CharsUsed = 0;
+        Pool->CharsAllocated = CharsToAllocate;
+    }
+
+    YoriLibInitEmptyString(String);
+    YoriLibReference(Pool->Block);
+    String->MemoryToFree = Pool->Block;
+    String->StartOfString = &Pool->Block[Pool->CharsUsed];
+    memcpy(String->StartOfString, Name, NameLength * sizeof(TCHAR));
+    String->StartOfString[NameLength] = '\0';
+    String->LengthInChars = NameLength;
+    String->LengthAllocated = NameLength + 1;
+    Pool->CharsUsed = Pool->CharsUsed + NameLength + 1;
+    return TRUE;
+}
+
+/**
+ Move a batch of names collected by the background thread into a key's
+ contents, where they can be seen by the user interface.  The cache lock
+ must be held.
+
+ @param Array Pointer to the array in the key contents to add names to.
+
+ @param Batch Pointer to an array of names to add.  On success, ownership
+        of these names is transferred to the key contents.
+
+ @param BatchCount The number of names in Batch.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+RegeditEnumPublishBatch(
+    __inout PREGEDIT_NAME_ARRAY Array,
+    __in PYORI_STRING Batch,
+    __in DWORD BatchCount
+    )
+{
+    PYORI_STRING NewNames;
+    DWORD NewAllocated;
+
+    if (Array->Count + BatchCount > Array->Allocated) {
+        NewAllocated = Array->Allocated * 2;
+        if (NewAllocated < Array->Count + BatchCount) {
+            NewAllocated = Array->Count + BatchCount;
+        }
+        NewNames = YoriLibMalloc(NewAllocated * sizeof(YORI_STRING));
+        if (NewNames == NULL) {
+            return FALSE;
+        }
+        if (Array->Names != NULL) {
+            memcpy(NewNames, Array->Names, Array->Count * sizeof(YORI_STRING));
+            YoriLibFree(Array->Names);
+        }
+        Array->Names = NewNames;
+        Array->Allocated = NewAllocated;
+    }
+
+    memcpy(&Array->Names[Array->Count], Batch, BatchCount * sizeof(YORI_STRING));
+    Array->Count = Array->Count + BatchCount;
+    return TRUE;
+}
+
+/**
+ Determine whether the background thread should stop enumerating a key.
+ This occurs if the key has been discarded from the cache, if the program
+ is exiting, or if the user has navigated to a different key that has not
+ been enumerated yet, which should take priority over any prefetching.  The
+ cache lock must be held.
+
+ @param Cache Pointer to the cache.
+
+ @param Contents Pointer to the key being enumerated.
+
+ @return TRUE if enumeration should stop, FALSE if it should continue.
+ */
+BOOL
+RegeditEnumShouldStop(
+    __in PREGEDIT_ENUM_CACHE Cache,
+    __in PREGEDIT_KEY_CONTENTS Contents
+    )
+{
+    if (Contents->Orphaned || Cache->Terminate) {
+        return TRUE;
+    }
+
+    if (Cache->ActiveContents != NULL &&
+        Cache->ActiveContents != Contents &&
+        Cache->ActiveContents->State == RegeditKeyContentsNotStarted) {
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Enumerate the subkeys and values of a single key from the background
+ thread, publishing subkeys in batches as they are found.
+
+ @param Cache Pointer to the cache.
+
+ @param Contents Pointer to the key to enumerate.  The caller has marked
+        this as in progress.
+ */
+VOID
+RegeditEnumEnumerateKey(
+    __in PREGEDIT_ENUM_CACHE Cache,
+    __in PREGEDIT_KEY_CONTENTS Contents
+    )
+{
+    HKEY Key;
+    DWORD Err;
+    DWORD Index;
+    DWORD SubKeyCount;
+    DWORD MaxSubKeyLength;
+    DWORD ValueCount;
+    DWORD MaxValueNameLength;
+    DWORD MaxValueDataLength;
+    DWORD NameLength;
+    DWORD BatchCount;
+    DWORD PassIndex;
+    FILETIME LastWriteTime;
+    FILETIME SubkeyWriteTime;
+    YORI_STRING NameBuffer;
+    YORI_STRING PreviousName;
+    PYORI_STRING Batch;
+    REGEDIT_NAME_POOL Pool;
+    BOOLEAN Sorted;
+    BOOLEAN Stop;
+
+    ZeroMemory(&Pool, sizeof(Pool));
+    YoriLibInitEmptyString(&NameBuffer);
+    YoriLibInitEmptyString(&PreviousName);
+    Batch = NULL;
+    Sorted = TRUE;
+    Stop = FALSE;
+
+    Err = DllAdvApi32.pRegOpenKeyExW(Contents->RootKey, Contents->Subkey.StartOfString, 0, KEY_READ, &Key);
+    if (Err != ERROR_SUCCESS) {
+        goto Complete;
+    }
+
+    Err = RegeditQueryKeyInfo(Key, &SubKeyCount, &MaxSubKeyLength, &ValueCount, &MaxValueNameLength, &MaxValueDataLength, &LastWriteTime);
+    if (Err != ERROR_SUCCESS) {
+        DllAdvApi32.pRegCloseKey(Key);
+        goto Complete;
+    }
+
+    Batch = YoriLibMalloc(REGEDIT_ENUM_BATCH_SIZE * sizeof(YORI_STRING));
+    if (Batch == NULL) {
+        Err = ERROR_NOT_ENOUGH_MEMORY;
+        DllAdvApi32.pRegCloseKey(Key);
+        goto Complete;
+    }
+
+    //
+    //  The first pass enumerates subkeys and the second enumerates values.
+    //
+
+    for (PassIndex = 0; PassIndex < 2 && !Stop; PassIndex++) {
+        NameLength = MaxSubKeyLength;
+        if (PassIndex == 1) {
+            NameLength = MaxValueNameLength;
+        }
+        if (NameBuffer.LengthAllocated < NameLength + 1) {
+            YoriLibFreeStringContents(&NameBuffer);
+            if (!YoriLibAllocateString(&NameBuffer, NameLength + 1)) {
+                Err = ERROR_NOT_ENOUGH_MEMORY;
+                break;
+            }
+        }
+
+        BatchCount = 0;
+        Index = 0;
+        while (TRUE) {
+            NameLength = NameBuffer.LengthAllocated;
+            if (PassIndex == 0) {
+                Err = DllAdvApi32.pRegEnumKeyExW(Key, Index, NameBuffer.StartOfString, &NameLength, NULL, NULL, NULL, &SubkeyWriteTime);
+            } else {
+                Err = DllAdvApi32.pRegEnumValueW(Key, Index, NameBuffer.StartOfString, &NameLength, NULL, NULL, NULL, NULL);
+            }
+
+            //
+            //  If a longer name has been added since the key was queried,
+            //  grow the buffer and try again.
+            //
+
+            if (Err == ERROR_MORE_DATA) {
+                NameLength = NameBuffer.LengthAllocated * 2;
+                YoriLibFreeStringContents(&NameBuffer);
+                if (!YoriLibAllocateString(&NameBuffer, NameLength)) {
+                    Err = ERROR_NOT_ENOUGH_MEMORY;
+                    break;
+                }
+                continue;
+            }
+
+            if (Err == ERROR_SUCCESS) {
+                if (!RegeditEnumAllocateName(&Pool, NameBuffer.StartOfString, NameLength, &Batch[BatchCount])) {
+                    Err = ERROR_NOT_ENOUGH_MEMORY;
+                } else {
+                    if (PassIndex == 0) {
+                        if (Sorted &&
+                            PreviousName.StartOfString != NULL &&
+                            YoriLibCompareStringInsensitive(&PreviousName, &Batch[BatchCount]) > 0) {
+
+                            Sorted = FALSE;
+                        }
+                        PreviousName.StartOfString = Batch[BatchCount].StartOfString;
+                        PreviousName.LengthInChars = Batch[BatchCount].LengthInChars;
+                    }
+                    BatchCount++;
+                    Index++;
+                }
+            }
+
+            //
+            //  Publish the batch if it is full or enumeration has finished.
+            //  Values are only published when complete, since they are
+            //  sorted before display.
+            //
+
+            if (BatchCount == REGEDIT_ENUM_BATCH_SIZE || Err != ERROR_SUCCESS) {
+                EnterCriticalSection(&Cache->Lock);
+                if (RegeditEnumShouldStop(Cache, Contents)) {
+                    Stop = TRUE;
+                } else if (!RegeditEnumPublishBatch(PassIndex == 0?&Contents->Keys:&Contents->Values, Batch, BatchCount)) {
+                    if (Err == ERROR_SUCCESS || Err == ERROR_NO_MORE_ITEMS) {
+                        Err = ERROR_NOT_ENOUGH_MEMORY;
+                    }
+                } else {
+                    BatchCount = 0;
+                }
+                LeaveCriticalSection(&Cache->Lock);
+
+                if (PassIndex == 0 && BatchCount == 0) {
+                    SetEvent(Cache->ProgressEvent);
+                }
+
+                while (BatchCount > 0) {
+                    BatchCount--;
+                    YoriLibFreeStringContents(&Batch[BatchCount]);
+                }
+
+                if (Stop || Err != ERROR_SUCCESS) {
+                    break;
+                }
+            }
+        }
+
+        if (Err == ERROR_NO_MORE_ITEMS) {
+            Err = ERROR_SUCCESS;
+        }
+
+        if (Err != ERROR_SUCCESS) {
+            break;
+        }
+    }
+
+    DllAdvApi32.pRegCloseKey(Key);
+
+Complete:
+
+    EnterCriticalSection(&Cache->Lock);
+    if (Contents->Orphaned) {
+        LeaveCriticalSection(&Cache->Lock);
+        RegeditEnumFreeContents(Contents);
+    } else if (Stop) {
+
+        //
+        //  If enumeration was abandoned to allow another key to be
+        //  enumerated, it will be restarted later if it's still needed.
+        //
+
+        RegeditEnumResetContents(Contents);
+        LeaveCriticalSection(&Cache->Lock);
+    } else {
+        if (Err == ERROR_SUCCESS) {
+            if (!Sorted) {
+                YoriLibSortStringArray(Contents->Keys.Names, Contents->Keys.Count);
+                Contents->KeysResorted = TRUE;
+            }
+            YoriLibSortStringArray(Contents->Values.Names, Contents->Values.Count);
+            Contents->LastWriteTime = LastWriteTime;
+        }
+        Contents->Error = Err;
+        Contents->State = RegeditKeyContentsComplete;
+        LeaveCriticalSection(&Cache->Lock);
+        SetEvent(Cache->ProgressEvent);
+    }
+
+    if (Pool.Block != NULL) {
+        YoriLibDereference(Pool.Block);
+    }
+    if (Batch != NULL) {
+        YoriLibFree(Batch);
+    }
+    YoriLibFreeStringContents(&NameBuffer);
+}
+
+/**
+ The background thread which enumerates keys.  The key being displayed is
+ enumerated first, followed by any keys which have been requested for
+ prefetch, most recent first.
+
+ @param Context Pointer to the cache.
+
+ @return Zero.
+ */
+DWORD WINAPI
+RegeditEnumWorker(
+    __in LPVOID Context
+    )
+{
+    PREGEDIT_ENUM_CACHE Cache;
+    PREGEDIT_KEY_CONTENTS Contents;
+    PYORI_LIST_ENTRY ListEntry;
+
+    Cache = (PREGEDIT_ENUM_CACHE)Context;
+
+    while (TRUE) {
+        EnterCriticalSection(&Cache->Lock);
+        if (Cache->Terminate) {
+            LeaveCriticalSection(&Cache->Lock);
+            break;
+        }
+
+        Contents = NULL;
+        if (Cache->ActiveContents != NULL &&
+            Cache->ActiveContents->State == RegeditKeyContentsNotStarted) {
+
+            Contents = Cache->ActiveContents;
+        } else {
+            ListEntry = YoriLibGetNextListEntry(&Cache->ContentsList, NULL);
+            while (ListEntry != NULL) {
+                Contents = CONTAINING_RECORD(ListEntry, REGEDIT_KEY_CONTENTS, ListEntry);
+                if (Contents->State == RegeditKeyContentsNotStarted) {
+                    break;
+                }
+                Contents = NULL;
+                ListEntry = YoriLibGetNextListEntry(&Cache->ContentsList, ListEntry);
+            }
+        }
+
+        if (Contents == NULL) {
+            LeaveCriticalSection(&Cache->Lock);
+            WaitForSingleObject(Cache->WorkEvent, INFINITE);
+            continue;
+        }
+
+        Contents->State = RegeditKeyContentsInProgress;
+        LeaveCriticalSection(&Cache->Lock);
+
+        RegeditEnumEnumerateKey(Cache, Contents);
+    }
+
+    return 0;
+}
+
+/**
+ Prepare for keys to be enumerated in the background.
+
+ @param RegeditContext Pointer to the registry editor context.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+RegeditEnumInitialize(
+    __inout PREGEDIT_CONTEXT RegeditContext
+    )
+{
+    PREGEDIT_ENUM_CACHE Cache;
+    DWORD ThreadId;
+
+    Cache = YoriLibMalloc(sizeof(REGEDIT_ENUM_CACHE));
+    if (Cache == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(Cache, sizeof(REGEDIT_ENUM_CACHE));
+    YoriLibInitializeListHead(&Cache->ContentsList);
+    InitializeCriticalSection(&Cache->Lock);
+
+    Cache->WorkEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    Cache->ProgressEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (Cache->WorkEvent != NULL && Cache->ProgressEvent != NULL) {
+        Cache->WorkerThread = CreateThread(NULL, 0, RegeditEnumWorker, Cache, 0, &ThreadId);
+    }
+
+    if (Cache->WorkerThread == NULL) {
+        if (Cache->WorkEvent != NULL) {
+            CloseHandle(Cache->WorkEvent);
+        }
+        if (Cache->ProgressEvent != NULL) {
+            CloseHandle(Cache->ProgressEvent);
+        }
+        DeleteCriticalSection(&Cache->Lock);
+        YoriLibFree(Cache);
+        return FALSE;
+    }
+
+    RegeditContext->EnumCache = Cache;
+    return TRUE;
+}
+
+/**
+ Stop enumerating keys in the background and free all cached key contents.
+
+ @param RegeditContext Pointer to the registry editor context.
+ */
+VOID
+RegeditEnumCleanup(
+    __inout PREGEDIT_CONTEXT RegeditContext
+    )
+{
+    PREGEDIT_ENUM_CACHE Cache;
+    PYORI_LIST_ENTRY ListEntry;
+    PREGEDIT_KEY_CONTENTS Contents;
+
+    Cache = RegeditContext->EnumCache;
+    if (Cache == NULL) {
+        return;
+    }
+
+    EnterCriticalSection(&Cache->Lock);
+    Cache->Terminate = TRUE;
+    LeaveCriticalSection(&Cache->Lock);
+    SetEvent(Cache->WorkEvent);
+    WaitForSingleObject(Cache->WorkerThread, INFINITE);
+    CloseHandle(Cache->WorkerThread);
+
+    ListEntry = YoriLibGetNextListEntry(&Cache->ContentsList, NULL);
+    while (ListEntry != NULL) {
+        Contents = CONTAINING_RECORD(ListEntry, REGEDIT_KEY_CONTENTS, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Cache->ContentsList, ListEntry);
+        RegeditEnumRemoveContents(Cache, Contents);
+    }
+
+    YoriLibFreeStringContents(&Cache->SelectKey);
+    YoriLibFreeStringContents(&Cache->SelectValue);
+    CloseHandle(Cache->WorkEvent);
+    CloseHandle(Cache->ProgressEvent);
+    DeleteCriticalSection(&Cache->Lock);
+    YoriLibFree(Cache);
+    RegeditContext->EnumCache = NULL;
+}
+
+/**
+ Request that a key be enumerated in the background if it is not already
+ cached, so that if the user navigates to it, its contents can be displayed
+ immediately.
+
+ @param RegeditContext Pointer to the registry editor context.
+
+ @param RootKey The root key containing the key.
+
+ @param Subkey Pointer to the path of the key relative to the root key.
+ */
+VOID
+RegeditEnumPrefetch(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in HKEY RootKey,
+    __in PCYORI_STRING Subkey
+    )
+{
+    PREGEDIT_ENUM_CACHE Cache;
+    PREGEDIT_KEY_CONTENTS Contents;
+
+    Cache = RegeditContext->EnumCache;
+
+    EnterCriticalSection(&Cache->Lock);
+    Contents = RegeditEnumLookupContents(Cache, RootKey, Subkey);
+    LeaveCriticalSection(&Cache->Lock);
+
+    if (Contents != NULL) {
+        SetEvent(Cache->WorkEvent);
+    }
+}
+
+/**
+ Indicate which key is being displayed, so that it is enumerated before any
+ other key.  If the key has already been enumerated and has not changed
+ since, the existing contents are used.  This waits briefly for the key to
+ be enumerated, but does not wait for large keys to be enumerated fully;
+ the caller is expected to call @ref RegeditEnumUpdateLists to display
+ contents as they become available.
+
+ @param RegeditContext Pointer to the registry editor context, indicating
+        the key to display.  If the tree depth is zero, root keys are being
+        displayed and no key is enumerated.
+
+ @param Refresh If TRUE, any previously enumerated contents are discarded
+        and the key is enumerated again.
+
+ @param SelectKey Optionally points to the name of a subkey to select once
+        enumeration is complete.
+
+ @param SelectValue Optionally points to the name of a value to select once
+        enumeration is complete.
+
+ @return ERROR_SUCCESS to indicate success, or a Win32 error code to
+         indicate failure.
+ */
+DWORD
+RegeditEnumSetActiveKey(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in BOOLEAN Refresh,
+    __in_opt PYORI_STRING SelectKey,
+    __in_opt PYORI_STRING SelectValue
+    )
+{
+    PREGEDIT_ENUM_CACHE Cache;
+    PREGEDIT_KEY_CONTENTS Contents;
+    FILETIME LastWriteTime;
+    DWORD SubKeyCount;
+    DWORD MaxSubKeyLength;
+    DWORD ValueCount;
+    DWORD MaxValueNameLength;
+    DWORD MaxValueDataLength;
+    BOOLEAN Current;
+    HKEY Key;
+
+    Cache = RegeditContext->EnumCache;
+
+    EnterCriticalSection(&Cache->Lock);
+    Cache->ActiveContents = NULL;
+    Cache->KeysDisplayed = 0;
+    Cache->ValuesDisplayed = FALSE;
+    Cache->ErrorDisplayed = FALSE;
+    YoriLibFreeStringContents(&Cache->SelectKey);
+    YoriLibFreeStringContents(&Cache->SelectValue);
+    if (SelectKey != NULL) {
+        YoriLibCopyString(&Cache->SelectKey, SelectKey);
+    }
+    if (SelectValue != NULL) {
+        YoriLibCopyString(&Cache->SelectValue, SelectValue);
+    }
+
+    if (RegeditContext->TreeDepth == 0) {
+        LeaveCriticalSection(&Cache->Lock);
+        return ERROR_SUCCESS;
+    }
+
+    Contents = RegeditEnumLookupContents(Cache, RegeditContext->ActiveRootKey, &RegeditContext->Subkey);
+    if (Contents == NULL) {
+        LeaveCriticalSection(&Cache->Lock);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    //
+    //  If the user asked to refresh and the key is being enumerated, start
+    //  again with a new entry.  If it's been enumerated, check whether it
+    //  has changed since.  Only the background thread changes the state
+    //  from not started, so this can check the state after dropping the
+    //  lock.
+    //
+
+    if (Refresh && Contents->State == RegeditKeyContentsInProgress) {
+        RegeditEnumRemoveContents(Cache, Contents);
+        Contents = RegeditEnumLookupContents(Cache, RegeditContext->ActiveRootKey, &RegeditContext->Subkey);
+        if (Contents == NULL) {
+            LeaveCriticalSection(&Cache->Lock);
+            return ERROR_NOT_ENOUGH_MEMORY;
+        }
+    }
+
+    if (Contents->State == RegeditKeyContentsComplete) {
+        Current = FALSE;
+        if (!Refresh && Contents->Error == ERROR_SUCCESS) {
+            if (DllAdvApi32.pRegOpenKeyExW(Contents->RootKey, Contents->Subkey.StartOfString, 0, KEY_READ, &Key) == ERROR_SUCCESS) {
+                if (RegeditQueryKeyInfo(Key, &SubKeyCount, &MaxSubKeyLength, &ValueCount, &MaxValueNameLength, &MaxValueDataLength, &LastWriteTime) == ERROR_SUCCESS &&
+                    LastWriteTime.dwLowDateTime == Contents->LastWriteTime.dwLowDateTime &&
+                    LastWriteTime.dwHighDateTime == Contents->LastWriteTime.dwHighDateTime &&
+                    SubKeyCount == Contents->Keys.Count &&
+                    ValueCount == Contents->Values.Count) {
+
+                    Current = TRUE;
+                }
+                DllAdvApi32.pRegCloseKey(Key);
+            }
+        }
+
+        if (!Current) {
+            RegeditEnumResetContents(Contents);
+        }
+    }
+
+    Cache->ActiveContents = Contents;
+    Current = (BOOLEAN)(Contents->State == RegeditKeyContentsComplete);
+    LeaveCriticalSection(&Cache->Lock);
+
+    if (!Current) {
+        ResetEvent(Cache->ProgressEvent);
+        SetEvent(Cache->WorkEvent);
+        WaitForSingleObject(Cache->ProgressEvent, REGEDIT_ENUM_INITIAL_WAIT);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/**
+ Find the index of the item to select within a sorted array of names, which
+ is either the matching name or the one following it.
+
+ @param Array Pointer to the array of names.
+
+ @param Name Pointer to the name to find.
+
+ @return The index of the name to select.  This may be equal to the number
+         of names if all names are less than the specified name.
+ */
+DWORD
+RegeditEnumFindSelection(
+    __in PREGEDIT_NAME_ARRAY Array,
+    __in PYORI_STRING Name
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < Array->Count; Index++) {
+        if (YoriLibCompareStringInsensitive(&Array->Names[Index], Name) >= 0) {
+            break;
+        }
+    }
+
+    return Index;
+}
+
+/**
+ Add any contents of the displayed key that have been enumerated since the
+ last call to the list controls.  Once enumeration is complete, values are
+ displayed, any item that the caller requested is selected, and any error
+ is displayed.
+
+ @param RegeditContext Pointer to the registry editor context.
+
+ @param KeyListCtrl Pointer to the list control containing subkeys.
+
+ @param ValueListCtrl Pointer to the list control containing values.
+ */
+VOID
+RegeditEnumUpdateLists(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE KeyListCtrl,
+    __in PYORI_WIN_CTRL_HANDLE ValueListCtrl
+    )
+{
+    PREGEDIT_ENUM_CACHE Cache;
+    PREGEDIT_KEY_CONTENTS Contents;
+    YORI_STRING Text;
+    DWORD SelectIndex;
+    DWORD Err;
+
+    Cache = RegeditContext->EnumCache;
+    Err = ERROR_SUCCESS;
+
+    EnterCriticalSection(&Cache->Lock);
+    Contents = Cache->ActiveContents;
+    if (Contents == NULL || Cache->ValuesDisplayed) {
+        LeaveCriticalSection(&Cache->Lock);
+        return;
+    }
+
+    //
+    //  If the subkeys were found to be out of order, they have been sorted,
+    //  so start again.
+    //
+
+    if (Contents->KeysResorted && Cache->KeysDisplayed > 0) {
+        YoriWinListClearAllItems(KeyListCtrl);
+        YoriLibConstantString(&Text, _T(".."));
+        YoriWinListAddItems(KeyListCtrl, &Text, 1);
+        Cache->KeysDisplayed = 0;
+    }
+
+    if (Contents->Keys.Count > Cache->KeysDisplayed) {
+        YoriWinListAddItems(KeyListCtrl, &Contents->Keys.Names[Cache->KeysDisplayed], Contents->Keys.Count - Cache->KeysDisplayed);
+        Cache->KeysDisplayed = Contents->Keys.Count;
+    }
+
+    if (Contents->State == RegeditKeyContentsComplete) {
+        Cache->ValuesDisplayed = TRUE;
+        YoriWinListAddItems(ValueListCtrl, Contents->Values.Names, Contents->Values.Count);
+
+        //
+        //  Because of the .. entry, the key to select is normally one
+        //  beyond its index in the array.  The exception is if it is beyond
+        //  the final element.
+        //
+
+        if (Cache->SelectKey.LengthInChars > 0 && Contents->Keys.Count > 0) {
+            SelectIndex = RegeditEnumFindSelection(&Contents->Keys, &Cache->SelectKey);
+            if (SelectIndex < Contents->Keys.Count) {
+                SelectIndex++;
+            }
+            YoriWinListSetActiveOption(KeyListCtrl, SelectIndex);
+        }
+
+        if (Cache->SelectValue.LengthInChars > 0 && Contents->Values.Count > 0) {
+            SelectIndex = RegeditEnumFindSelection(&Contents->Values, &Cache->SelectValue);
+            if (SelectIndex == Contents->Values.Count) {
+                SelectIndex--;
+            }
+            YoriWinListSetActiveOption(ValueListCtrl, SelectIndex);
+        }
+
+        if (!Cache->ErrorDisplayed) {
+            Cache->ErrorDisplayed = TRUE;
+            Err = Contents->Error;
+        }
+    }
+    LeaveCriticalSection(&Cache->Lock);
+
+    if (Err != ERROR_SUCCESS) {
+        RegeditDisplayWin32Error(YoriWinGetControlParent(KeyListCtrl), Err);
+    }
+}
+
+// vim:sw=4:ts=4:et:
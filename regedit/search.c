@@ -0,0 +1,1084 @@
+/**
+ * @file regedit/search.c
+ *
+ * Yori shell registry editor search
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yoriwin.h>
+#include <yoridlg.h>
+#include "regedit.h"
+
+/**
+ The maximum number of threads to search with.  Registry access is largely
+ CPU bound, so this is also limited by the number of processors.
+ */
+#define REGEDIT_SEARCH_MAX_THREADS (8)
+
+/**
+ A set of well known control IDs on the search results window.
+ */
+typedef enum _REGEDIT_SEARCH_CONTROLS {
+    RegeditSearchControlResultList = 1,
+    RegeditSearchControlStatus = 2
+} REGEDIT_SEARCH_CONTROLS;
+
+/**
+ A key which needs to be searched.
+ */
+typedef struct _REGEDIT_SEARCH_WORK_ITEM {
+
+    /**
+     The entry for this item on the list of keys to search.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The root key containing the key to search.
+     */
+    HKEY RootKey;
+
+    /**
+     The path to the key relative to the root key.
+     */
+    YORI_STRING Subkey;
+} REGEDIT_SEARCH_WORK_ITEM, *PREGEDIT_SEARCH_WORK_ITEM;
+
+/**
+ A key or value which matched the search.
+ */
+typedef struct _REGEDIT_SEARCH_RESULT {
+
+    /**
+     The entry for this result on the list of results which have not been
+     displayed yet.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The root key containing the match.
+     */
+    HKEY RootKey;
+
+    /**
+     The path to the matching key, or the key containing the matching value,
+     relative to the root key.
+     */
+    YORI_STRING Subkey;
+
+    /**
+     TRUE if the match is a value, FALSE if it is a key.
+     */
+    BOOLEAN IsValue;
+
+    /**
+     The name of the matching value.  Only meaningful if IsValue is TRUE.
+     */
+    YORI_STRING ValueName;
+
+    /**
+     The string to display to the user describing the match.
+     */
+    YORI_STRING DisplayString;
+} REGEDIT_SEARCH_RESULT, *PREGEDIT_SEARCH_RESULT;
+
+/**
+ State for a single search, shared between the user interface and the
+ threads performing the search.
+ */
+typedef struct _REGEDIT_SEARCH_CONTEXT {
+
+    /**
+     The text to search for.
+     */
+    YORI_STRING SearchText;
+
+    /**
+     TRUE if the search is case sensitive, FALSE if it is case insensitive.
+     */
+    BOOLEAN MatchCase;
+
+    /**
+     Set to TRUE to indicate the search should stop.
+     */
+    BOOLEAN Cancel;
+
+    /**
+     Set to TRUE when all keys have been searched.
+     */
+    BOOLEAN Complete;
+
+    /**
+     Synchronizes access to the lists and counts below.
+     */
+    CRITICAL_SECTION Lock;
+
+    /**
+     The list of keys which need to be searched.  Keys are removed from the
+     front of the list, and subkeys are added to the front, so the search
+     proceeds depth first and the list remains short.
+     */
+    YORI_LIST_ENTRY WorkList;
+
+    /**
+     A semaphore signalled once for each item added to WorkList, and once
+     for each thread when the search terminates.
+     */
+    HANDLE WorkSemaphore;
+
+    /**
+     The number of keys which are either on WorkList or being searched.
+     When this reaches zero, the search is complete.
+     */
+    DWORD Outstanding;
+
+    /**
+     The number of keys which have been searched.
+     */
+    DWORD KeysSearched;
+
+    /**
+     Results which have been found but not yet added to the list control.
+     */
+    YORI_LIST_ENTRY PendingResults;
+
+    /**
+     An array of results which have been added to the list control, in the
+     same order as the list control.  This is only accessed by the user
+     interface thread.
+     */
+    PREGEDIT_SEARCH_RESULT *Results;
+
+    /**
+     The number of results in the Results array.
+     */
+    DWORD ResultCount;
+
+    /**
+     The number of elements allocated in the Results array.
+     */
+    DWORD ResultsAllocated;
+
+    /**
+     The number of threads performing the search.
+     */
+    DWORD ThreadCount;
+
+    /**
+     Handles to the threads performing the search.
+     */
+    HANDLE Threads[REGEDIT_SEARCH_MAX_THREADS];
+} REGEDIT_SEARCH_CONTEXT, *PREGEDIT_SEARCH_CONTEXT;
+
+/**
+ Free a search result.
+
+ @param Result Pointer to the result to free.
+ */
+VOID
+RegeditSearchFreeResult(
+    __in PREGEDIT_SEARCH_RESULT Result
+    )
+{
+    YoriLibFreeStringContents(&Result->Subkey);
+    YoriLibFreeStringContents(&Result->ValueName);
+    YoriLibFreeStringContents(&Result->DisplayString);
+    YoriLibFree(Result);
+}
+
+/**
+ Add a key to the list of keys to search.  The caller must hold the search
+ lock.
+
+ @param SearchContext Pointer to the search context.
+
+ @param RootKey The root key containing the key to search.
+
+ @param Subkey Pointer to the path of the key relative to the root key.
+
+ @param ChildName Optionally points to the name of a child of Subkey.  If
+        specified, the child is searched rather than Subkey.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+RegeditSearchQueueKey(
+    __in PREGEDIT_SEARCH_CONTEXT SearchContext,
+    __in HKEY RootKey,
+    __in PCYORI_STRING Subkey,
+    __in_opt PCYORI_STRING ChildName
+    )
+{
+    PREGEDIT_SEARCH_WORK_ITEM WorkItem;
+    DWORD Length;
+
+    Length = Subkey->LengthInChars;
+    if (ChildName != NULL) {
+        Length = Length + 1 + ChildName->LengthInChars;
+    }
+
+    WorkItem = YoriLibMalloc(sizeof(REGEDIT_SEARCH_WORK_ITEM));
+    if (WorkItem == NULL) {
+        return FALSE;
+    }
+
+    if (!YoriLibAllocateString(&WorkItem->Subkey, Length + 1)) {
+        YoriLibFree(WorkItem);
+        return FALSE;
+    }
+
+    if (ChildName == NULL) {
+        YoriLibYPrintf(&WorkItem->Subkey, _T("%y"), Subkey);
+    } else if (Subkey->LengthInChars == 0) {
+        YoriLibYPrintf(&WorkItem->Subkey, _T("%y"), ChildName);
+    } else {
+        YoriLibYPrintf(&WorkItem->Subkey, _T("%y\\%y"), Subkey, ChildName);
+    }
+
+    WorkItem->RootKey = RootKey;
+    YoriLibInsertList(&SearchContext->WorkList, &WorkItem->ListEntry);
+    SearchContext->Outstanding++;
+    ReleaseSemaphore(SearchContext->WorkSemaphore, 1, NULL);
+    return TRUE;
+}
+
+/**
+ Determine whether a string contains the text being searched for.
+
+ @param SearchContext Pointer to the search context.
+
+ @param String Pointer to the string to check.
+
+ @return TRUE if the string contains the search text, FALSE if it does not.
+ */
+BOOLEAN
+RegeditSearchIsMatch(
+    __in PREGEDIT_SEARCH_CONTEXT SearchContext,
+    __in PCYORI_STRING String
+    )
+{
+    if (SearchContext->MatchCase) {
+        if (YoriLibFindFirstMatchingSubstring(String, 1, &SearchContext->SearchText, NULL) != NULL) {
+            return TRUE;
+        }
+    } else {
+        if (YoriLibFindFirstMatchingSubstringInsensitive(String, 1, &SearchContext->SearchText, NULL) != NULL) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ Record a key or value which matched the search, so it can be displayed by
+ the user interface.
+
+ @param SearchContext Pointer to the search context.
+
+ @param RootKey The root key containing the match.
+
+ @param Subkey Pointer to the path of the key containing the match.
+
+ @param Name Pointer to the name of the matching subkey or value.
+
+ @param IsValue TRUE if Name refers to a value, FALSE if it refers to a
+        subkey.
+ */
+VOID
+RegeditSearchAddResult(
+    __in PREGEDIT_SEARCH_CONTEXT SearchContext,
+    __in HKEY RootKey,
+    __in PCYORI_STRING Subkey,
+    __in PCYORI_STRING Name,
+    __in BOOLEAN IsValue
+    )
+{
+    PREGEDIT_SEARCH_RESULT Result;
+    PCYORI_STRING RootName;
+    YORI_STRING DefaultName;
+    PCYORI_STRING DisplayName;
+    DWORD Length;
+
+    RootName = RegeditGetRootKeyName(RootKey);
+    if (RootName == NULL) {
+        return;
+    }
+
+    Result = YoriLibMalloc(sizeof(REGEDIT_SEARCH_RESULT));
+    if (Result == NULL) {
+        return;
+    }
+
+    ZeroMemory(Result, sizeof(REGEDIT_SEARCH_RESULT));
+    Result->RootKey = RootKey;
+    Result->IsValue = IsValue;
+
+    //
+    //  For a key, the result refers to the matching key itself.  For a value,
+    //  it refers to the key containing the value.
+    //
+
+    Length = Subkey->LengthInChars;
+    if (!IsValue) {
+        Length = Length + 1 + Name->LengthInChars;
+    }
+
+    if (!YoriLibAllocateString(&Result->Subkey, Length + 1)) {
+        RegeditSearchFreeResult(Result);
+        return;
+    }
+
+    if (IsValue) {
+        YoriLibYPrintf(&Result->Subkey, _T("%y"), Subkey);
+        if (!YoriLibCopyString(&Result->ValueName, Name)) {
+            RegeditSearchFreeResult(Result);
+            return;
+        }
+    } else if (Subkey->LengthInChars == 0) {
+        YoriLibYPrintf(&Result->Subkey, _T("%y"), Name);
+    } else {
+        YoriLibYPrintf(&Result->Subkey, _T("%y\\%y"), Subkey, Name);
+    }
+
+    if (Result->Subkey.LengthInChars == 0) {
+        YoriLibYPrintf(&Result->DisplayString, _T("%y"), RootName);
+    } else {
+        YoriLibYPrintf(&Result->DisplayString, _T("%y\\%y"), RootName, &Result->Subkey);
+    }
+
+    if (IsValue) {
+        DisplayName = Name;
+        if (Name->LengthInChars == 0) {
+            YoriLibConstantString(&DefaultName, _T("(Default)"));
+            DisplayName = &DefaultName;
+        }
+        YoriLibFreeStringContents(&Result->DisplayString);
+        if (Result->Subkey.LengthInChars == 0) {
+            YoriLibYPrintf(&Result->DisplayString, _T("%y [%y]"), RootName, DisplayName);
+        } else {
+            YoriLibYPrintf(&Result->DisplayString, _T("%y\\%y [%y]"), RootName, &Result->Subkey, DisplayName);
+        }
+    }
+
+    if (Result->DisplayString.StartOfString == NULL) {
+        RegeditSearchFreeResult(Result);
+        return;
+    }
+
+    EnterCriticalSection(&SearchContext->Lock);
+    YoriLibAppendList(&SearchContext->PendingResults, &Result->ListEntry);
+    LeaveCriticalSection(&SearchContext->Lock);
+}
+
+/**
+ Search a single key for subkeys, value names and string value data which
+ contain the search text, and queue its subkeys to be searched.
+
+ @param SearchContext Pointer to the search context.
+
+ @param WorkItem Pointer to the key to search.
+
+ @param NameBuffer Pointer to a buffer to use for subkey and value names.
+        This may be reallocated by this function.
+
+ @param DataBuffer Pointer to a buffer to use for value data.  This may be
+        NULL on input, and is allocated or reallocated by this function.
+
+ @param DataBufferLength On input, points to the length of DataBuffer in
+        bytes.  This is updated if the buffer is reallocated.
+ */
+VOID
+RegeditSearchKey(
+    __in PREGEDIT_SEARCH_CONTEXT SearchContext,
+    __in PREGEDIT_SEARCH_WORK_ITEM WorkItem,
+    __inout PYORI_STRING NameBuffer,
+    __inout PUCHAR *DataBuffer,
+    __inout PDWORD DataBufferLength
+    )
+{
+    HKEY Key;
+    DWORD Err;
+    DWORD Index;
+    DWORD SubKeyCount;
+    DWORD MaxSubKeyLength;
+    DWORD ValueCount;
+    DWORD MaxValueNameLength;
+    DWORD MaxValueDataLength;
+    DWORD NameLength;
+    DWORD DataLength;
+    DWORD ValueType;
+    FILETIME LastWriteTime;
+    YORI_STRING Data;
+    PUCHAR NewBuffer;
+    BOOLEAN Queued;
+
+    if (DllAdvApi32.pRegOpenKeyExW(WorkItem->RootKey, WorkItem->Subkey.StartOfString, 0, KEY_READ, &Key) != ERROR_SUCCESS) {
+        return;
+    }
+
+    if (RegeditQueryKeyInfo(Key, &SubKeyCount, &MaxSubKeyLength, &ValueCount, &MaxValueNameLength, &MaxValueDataLength, &LastWriteTime) != ERROR_SUCCESS) {
+        DllAdvApi32.pRegCloseKey(Key);
+        return;
+    }
+
+    if (MaxValueNameLength > MaxSubKeyLength) {
+        MaxSubKeyLength = MaxValueNameLength;
+    }
+
+    if (NameBuffer->LengthAllocated < MaxSubKeyLength + 1) {
+        YoriLibFreeStringContents(NameBuffer);
+        if (!YoriLibAllocateString(NameBuffer, MaxSubKeyLength + 1)) {
+            DllAdvApi32.pRegCloseKey(Key);
+            return;
+        }
+    }
+
+    //
+    //  The data buffer must always be supplied when enumerating values.  If
+    //  it is NULL, the system reports success with only the required length,
+    //  and there is no data to search.
+    //
+
+    if (*DataBuffer == NULL || *DataBufferLength < MaxValueDataLength) {
+        DataLength = MaxValueDataLength;
+        if (DataLength < 1024) {
+            DataLength = 1024;
+        }
+        NewBuffer = YoriLibMalloc(DataLength);
+        if (NewBuffer == NULL) {
+            DllAdvApi32.pRegCloseKey(Key);
+            return;
+        }
+        if (*DataBuffer != NULL) {
+            YoriLibFree(*DataBuffer);
+        }
+        *DataBuffer = NewBuffer;
+        *DataBufferLength = DataLength;
+    }
+
+    //
+    //  Check each subkey name and queue the subkey to be searched.
+    //
+
+    Index = 0;
+    while (!SearchContext->Cancel) {
+        NameLength = NameBuffer->LengthAllocated;
+        Err = DllAdvApi32.pRegEnumKeyExW(Key, Index, NameBuffer->StartOfString, &NameLength, NULL, NULL, NULL, &LastWriteTime);
+        if (Err == ERROR_MORE_DATA) {
+            NameLength = NameBuffer->LengthAllocated * 2;
+            YoriLibFreeStringContents(NameBuffer);
+            if (!YoriLibAllocateString(NameBuffer, NameLength)) {
+                break;
+            }
+            continue;
+        }
+        if (Err != ERROR_SUCCESS) {
+            break;
+        }
+
+        NameBuffer->LengthInChars = NameLength;
+        if (RegeditSearchIsMatch(SearchContext, NameBuffer)) {
+            RegeditSearchAddResult(SearchContext, WorkItem->RootKey, &WorkItem->Subkey, NameBuffer, FALSE);
+        }
+
+        EnterCriticalSection(&SearchContext->Lock);
+        Queued = (BOOLEAN)RegeditSearchQueueKey(SearchContext, WorkItem->RootKey, &WorkItem->Subkey, NameBuffer);
+        LeaveCriticalSection(&SearchContext->Lock);
+        if (!Queued) {
+            break;
+        }
+        Index++;
+    }
+
+    //
+    //  Check each value name, and the data of any string values.
+    //
+
+    Index = 0;
+    while (!SearchContext->Cancel) {
+        NameLength = NameBuffer->LengthAllocated;
+        DataLength = *DataBufferLength;
+        Err = DllAdvApi32.pRegEnumValueW(Key, Index, NameBuffer->StartOfString, &NameLength, NULL, &ValueType, *DataBuffer, &DataLength);
+        if (Err == ERROR_MORE_DATA) {
+
+            //
+            //  The key may have changed since it was queried.  If the data
+            //  didn't fit, the required data length is returned, so grow
+            //  the data buffer to that size.  Otherwise the name didn't
+            //  fit, so grow the name buffer.
+            //
+
+            if (DataLength <= *DataBufferLength) {
+                NameLength = NameBuffer->LengthAllocated * 2;
+                YoriLibFreeStringContents(NameBuffer);
+                if (!YoriLibAllocateString(NameBuffer, NameLength)) {
+                    break;
+                }
+                continue;
+            }
+
+            NewBuffer = YoriLibMalloc(DataLength);
+            if (NewBuffer == NULL) {
+                break;
+            }
+            if (*DataBuffer != NULL) {
+                YoriLibFree(*DataBuffer);
+            }
+            *DataBuffer = NewBuffer;
+            *DataBufferLength = DataLength;
+            continue;
+        }
+        if (Err != ERROR_SUCCESS) {
+            break;
+        }
+
+        NameBuffer->LengthInChars = NameLength;
+        if (RegeditSearchIsMatch(SearchContext, NameBuffer)) {
+            RegeditSearchAddResult(SearchContext, WorkItem->RootKey, &WorkItem->Subkey, NameBuffer, TRUE);
+        } else if (ValueType == REG_SZ || ValueType == REG_EXPAND_SZ || ValueType == REG_MULTI_SZ) {
+            YoriLibInitEmptyString(&Data);
+            Data.StartOfString = (LPTSTR)*DataBuffer;
+            Data.LengthInChars = DataLength / sizeof(TCHAR);
+            if (RegeditSearchIsMatch(SearchContext, &Data)) {
+                RegeditSearchAddResult(SearchContext, WorkItem->RootKey, &WorkItem->Subkey, NameBuffer, TRUE);
+            }
+        }
+        Index++;
+    }
+
+    DllAdvApi32.pRegCloseKey(Key);
+}
+
+/**
+ A thread which searches keys until there are no more keys to search or the
+ search is cancelled.
+
+ @param Context Pointer to the search context.
+
+ @return Zero.
+ */
+DWORD WINAPI
+RegeditSearchWorker(
+    __in LPVOID Context
+    )
+{
+    PREGEDIT_SEARCH_CONTEXT SearchContext;
+    PREGEDIT_SEARCH_WORK_ITEM WorkItem;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_STRING NameBuffer;
+    PUCHAR DataBuffer;
+    DWORD DataBufferLength;
+    DWORD Index;
+
+    SearchContext = (PREGEDIT_SEARCH_CONTEXT)Context;
+    YoriLibInitEmptyString(&NameBuffer);
+    DataBuffer = NULL;
+    DataBufferLength = 0;
+
+    while (TRUE) {
+        WaitForSingleObject(SearchContext->WorkSemaphore, INFINITE);
+
+        EnterCriticalSection(&SearchContext->Lock);
+        ListEntry = NULL;
+        if (!SearchContext->Cancel) {
+            ListEntry = YoriLibGetNextListEntry(&SearchContext->WorkList, NULL);
+        }
+        if (ListEntry == NULL) {
+            LeaveCriticalSection(&SearchContext->Lock);
+            break;
+        }
+        YoriLibRemoveListItem(ListEntry);
+        LeaveCriticalSection(&SearchContext->Lock);
+
+        WorkItem = CONTAINING_RECORD(ListEntry, REGEDIT_SEARCH_WORK_ITEM, ListEntry);
+        RegeditSearchKey(SearchContext, WorkItem, &NameBuffer, &DataBuffer, &DataBufferLength);
+        YoriLibFreeStringContents(&WorkItem->Subkey);
+        YoriLibFree(WorkItem);
+
+        //
+        //  If this was the final key, wake every thread so they can observe
+        //  that there is no more work and exit.
+        //
+
+        EnterCriticalSection(&SearchContext->Lock);
+        SearchContext->KeysSearched++;
+        SearchContext->Outstanding--;
+        if (SearchContext->Outstanding == 0) {
+            SearchContext->Complete = TRUE;
+            for (Index = 0; Index < SearchContext->ThreadCount; Index++) {
+                ReleaseSemaphore(SearchContext->WorkSemaphore, 1, NULL);
+            }
+        }
+        LeaveCriticalSection(&SearchContext->Lock);
+    }
+
+    YoriLibFreeStringContents(&NameBuffer);
+    if (DataBuffer != NULL) {
+        YoriLibFree(DataBuffer);
+    }
+
+    return 0;
+}
+
+/**
+ Stop searching, wait for all threads to exit, and free the search context.
+
+ @param SearchContext Pointer to the search context.
+ */
+VOID
+RegeditSearchCleanup(
+    __in PREGEDIT_SEARCH_CONTEXT SearchContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PREGEDIT_SEARCH_WORK_ITEM WorkItem;
+    PREGEDIT_SEARCH_RESULT Result;
+    DWORD Index;
+
+    EnterCriticalSection(&SearchContext->Lock);
+    SearchContext->Cancel = TRUE;
+    for (Index = 0; Index < SearchContext->ThreadCount; Index++) {
+        ReleaseSemaphore(SearchContext->WorkSemaphore, 1, NULL);
+    }
+    LeaveCriticalSection(&SearchContext->Lock);
+
+    for (Index = 0; Index < SearchContext->ThreadCount; Index++) {
+        WaitForSingleObject(SearchContext->Threads[Index], INFINITE);
+        CloseHandle(SearchContext->Threads[Index]);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&SearchContext->WorkList, NULL);
+    while (ListEntry != NULL) {
+        WorkItem = CONTAINING_RECORD(ListEntry, REGEDIT_SEARCH_WORK_ITEM, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&SearchContext->WorkList, ListEntry);
+        YoriLibRemoveListItem(&WorkItem->ListEntry);
+        YoriLibFreeStringContents(&WorkItem->Subkey);
+        YoriLibFree(WorkItem);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&SearchContext->PendingResults, NULL);
+    while (ListEntry != NULL) {
+        Result = CONTAINING_RECORD(ListEntry, REGEDIT_SEARCH_RESULT, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&SearchContext->PendingResults, ListEntry);
+        YoriLibRemoveListItem(&Result->ListEntry);
+        RegeditSearchFreeResult(Result);
+    }
+
+    for (Index = 0; Index < SearchContext->ResultCount; Index++) {
+        RegeditSearchFreeResult(SearchContext->Results[Index]);
+    }
+    if (SearchContext->Results != NULL) {
+        YoriLibFree(SearchContext->Results);
+    }
+
+    if (SearchContext->WorkSemaphore != NULL) {
+        CloseHandle(SearchContext->WorkSemaphore);
+    }
+    DeleteCriticalSection(&SearchContext->Lock);
+    YoriLibFreeStringContents(&SearchContext->SearchText);
+    YoriLibFree(SearchContext);
+}
+
+/**
+ Callback invoked periodically on the search results window.  This adds
+ any results found since the previous call to the list, and updates the
+ status text.
+
+ @param WindowHandle Pointer to the search results window.
+ */
+VOID
+RegeditSearchWindowTimer(
+    __in PYORI_WIN_WINDOW_HANDLE WindowHandle
+    )
+{
+    PYORI_WIN_CTRL_HANDLE WindowCtrl;
+    PYORI_WIN_CTRL_HANDLE ResultList;
+    PYORI_WIN_CTRL_HANDLE Status;
+    PREGEDIT_SEARCH_CONTEXT SearchContext;
+    PREGEDIT_SEARCH_RESULT Result;
+    PREGEDIT_SEARCH_RESULT *NewResults;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_STRING Text;
+    DWORD NewAllocated;
+    DWORD KeysSearched;
+    DWORD FirstNewResult;
+    BOOLEAN Complete;
+
+    WindowCtrl = YoriWinGetCtrlFromWindow(WindowHandle);
+    SearchContext = YoriWinGetControlContext(WindowCtrl);
+
+    ResultList = YoriWinFindControlById(WindowCtrl, RegeditSearchControlResultList);
+    ASSERT(ResultList != NULL);
+    __analysis_assume(ResultList != NULL);
+
+    Status = YoriWinFindControlById(WindowCtrl, RegeditSearchControlStatus);
+    ASSERT(Status != NULL);
+    __analysis_assume(Status != NULL);
+
+    FirstNewResult = SearchContext->ResultCount;
+
+    EnterCriticalSection(&SearchContext->Lock);
+    ListEntry = YoriLibGetNextListEntry(&SearchContext->PendingResults, NULL);
+    while (ListEntry != NULL) {
+        if (SearchContext->ResultCount == SearchContext->ResultsAllocated) {
+            NewAllocated = SearchContext->ResultsAllocated * 2;
+            if (NewAllocated < 256) {
+                NewAllocated = 256;
+            }
+            NewResults = YoriLibMalloc(NewAllocated * sizeof(PREGEDIT_SEARCH_RESULT));
+            if (NewResults == NULL) {
+                break;
+            }
+            if (SearchContext->Results != NULL) {
+                memcpy(NewResults, SearchContext->Results, SearchContext->ResultCount * sizeof(PREGEDIT_SEARCH_RESULT));
+                YoriLibFree(SearchContext->Results);
+            }
+            SearchContext->Results = NewResults;
+            SearchContext->ResultsAllocated = NewAllocated;
+        }
+
+        Result = CONTAINING_RECORD(ListEntry, REGEDIT_SEARCH_RESULT, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&SearchContext->PendingResults, ListEntry);
+        YoriLibRemoveListItem(&Result->ListEntry);
+        SearchContext->Results[SearchContext->ResultCount] = Result;
+        SearchContext->ResultCount++;
+    }
+    KeysSearched = SearchContext->KeysSearched;
+    Complete = SearchContext->Complete;
+    LeaveCriticalSection(&SearchContext->Lock);
+
+    for (; FirstNewResult < SearchContext->ResultCount; FirstNewResult++) {
+        YoriWinListAddItems(ResultList, &SearchContext->Results[FirstNewResult]->DisplayString, 1);
+    }
+
+    YoriLibInitEmptyString(&Text);
+    YoriLibYPrintf(&Text,
+                   _T("%s: %i keys searched, %i found"),
+                   Complete?_T("Complete"):_T("Searching"),
+                   KeysSearched,
+                   SearchContext->ResultCount);
+    if (Text.StartOfString != NULL) {
+        YoriWinLabelSetCaption(Status, &Text);
+        YoriLibFreeStringContents(&Text);
+    }
+}
+
+/**
+ A callback invoked when the go button is clicked.
+
+ @param Ctrl Pointer to the button that was clicked.
+ */
+VOID
+RegeditSearchGoButtonClicked(
+    __in PYORI_WIN_CTRL_HANDLE Ctrl
+    )
+{
+    PYORI_WIN_CTRL_HANDLE Parent;
+    Parent = YoriWinGetControlParent(Ctrl);
+    YoriWinCloseWindow(Parent, TRUE);
+}
+
+/**
+ A callback invoked when the close button is clicked.
+
+ @param Ctrl Pointer to the button that was clicked.
+ */
+VOID
+RegeditSearchCloseButtonClicked(
+    __in PYORI_WIN_CTRL_HANDLE Ctrl
+    )
+{
+    PYORI_WIN_CTRL_HANDLE Parent;
+    Parent = YoriWinGetControlParent(Ctrl);
+    YoriWinCloseWindow(Parent, FALSE);
+}
+
+/**
+ Start searching for text beneath the currently active key.  If the root
+ keys are being displayed, all root keys are searched.
+
+ @param RegeditContext Pointer to the global registry editor context.
+
+ @param SearchContext Pointer to an initialized search context.
+
+ @return TRUE to indicate the search was started, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+RegeditSearchStart(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PREGEDIT_SEARCH_CONTEXT SearchContext
+    )
+{
+    SYSTEM_INFO SysInfo;
+    YORI_STRING EmptyString;
+    DWORD ThreadCount;
+    DWORD ThreadId;
+    DWORD Index;
+
+    EnterCriticalSection(&SearchContext->Lock);
+    if (RegeditContext->TreeDepth == 0) {
+        YoriLibInitEmptyString(&EmptyString);
+        for (Index = 0; Index < RegeditRootKeyCount; Index++) {
+            if (!RegeditSearchQueueKey(SearchContext, RegeditRootKeys[Index].KeyHandle, &EmptyString, NULL)) {
+                LeaveCriticalSection(&SearchContext->Lock);
+                return FALSE;
+            }
+        }
+    } else {
+        if (!RegeditSearchQueueKey(SearchContext, RegeditContext->ActiveRootKey, &RegeditContext->Subkey, NULL)) {
+            LeaveCriticalSection(&SearchContext->Lock);
+            return FALSE;
+        }
+    }
+    LeaveCriticalSection(&SearchContext->Lock);
+
+    GetSystemInfo(&SysInfo);
+    ThreadCount = SysInfo.dwNumberOfProcessors;
+    if (ThreadCount < 1) {
+        ThreadCount = 1;
+    }
+    if (ThreadCount > REGEDIT_SEARCH_MAX_THREADS) {
+        ThreadCount = REGEDIT_SEARCH_MAX_THREADS;
+    }
+
+    for (Index = 0; Index < ThreadCount; Index++) {
+        SearchContext->Threads[SearchContext->ThreadCount] = CreateThread(NULL, 0, RegeditSearchWorker, SearchContext, 0, &ThreadId);
+        if (SearchContext->Threads[SearchContext->ThreadCount] == NULL) {
+            break;
+        }
+        SearchContext->ThreadCount++;
+    }
+
+    if (SearchContext->ThreadCount == 0) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Prompt the user for text to search for, search the currently active key
+ and its subkeys for it, and display the results as they are found.  If the
+ user selects a result, navigate to it.
+
+ @param RegeditContext Pointer to the global registry editor context.
+
+ @param Parent Pointer to the main window.
+ */
+VOID
+RegeditSearch(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE Parent
+    )
+{
+    PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgr;
+    PREGEDIT_SEARCH_CONTEXT SearchContext;
+    PREGEDIT_SEARCH_RESULT Result;
+    PYORI_WIN_WINDOW_HANDLE SearchWindow;
+    PYORI_WIN_CTRL_HANDLE ResultList;
+    PYORI_WIN_CTRL_HANDLE Ctrl;
+    YORI_STRING Title;
+    YORI_STRING InitialText;
+    YORI_STRING Caption;
+    YORI_STRING SearchText;
+    SMALL_RECT Area;
+    COORD WindowSize;
+    COORD WinMgrSize;
+    DWORD_PTR WindowResult;
+    DWORD ActiveOption;
+    DWORD Err;
+    BOOLEAN MatchCase;
+
+    WinMgr = YoriWinGetWindowManagerHandle(YoriWinGetWindowFromWindowCtrl(Parent));
+
+    YoriLibConstantString(&Title, _T("Find"));
+    YoriLibConstantString(&InitialText, _T(""));
+    YoriLibInitEmptyString(&SearchText);
+
+    if (!YoriDlgFindText(WinMgr, &Title, &InitialText, &MatchCase, &SearchText)) {
+        return;
+    }
+
+    if (SearchText.LengthInChars == 0) {
+        YoriLibFreeStringContents(&SearchText);
+        return;
+    }
+
+    SearchContext = YoriLibMalloc(sizeof(REGEDIT_SEARCH_CONTEXT));
+    if (SearchContext == NULL) {
+        YoriLibFreeStringContents(&SearchText);
+        RegeditDisplayWin32Error(Parent, ERROR_NOT_ENOUGH_MEMORY);
+        return;
+    }
+
+    ZeroMemory(SearchContext, sizeof(REGEDIT_SEARCH_CONTEXT));
+    memcpy(&SearchContext->SearchText, &SearchText, sizeof(YORI_STRING));
+    SearchContext->MatchCase = MatchCase;
+    InitializeCriticalSection(&SearchContext->Lock);
+    YoriLibInitializeListHead(&SearchContext->WorkList);
+    YoriLibInitializeListHead(&SearchContext->PendingResults);
+
+    SearchContext->WorkSemaphore = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+    if (SearchContext->WorkSemaphore == NULL) {
+        Err = GetLastError();
+        RegeditSearchCleanup(SearchContext);
+        RegeditDisplayWin32Error(Parent, Err);
+        return;
+    }
+
+    if (!YoriWinGetWinMgrDimensions(WinMgr, &WinMgrSize)) {
+        RegeditSearchCleanup(SearchContext);
+        return;
+    }
+
+    WindowSize.X = (WORD)(WinMgrSize.X - 10);
+    WindowSize.Y = (WORD)(WinMgrSize.Y - 6);
+
+    YoriLibConstantString(&Caption, _T("Search Results"));
+
+    if (!YoriWinCreateWindow(WinMgr, WindowSize.X, WindowSize.Y, WindowSize.X, WindowSize.Y, YORI_WIN_WINDOW_STYLE_BORDER_SINGLE | YORI_WIN_WINDOW_STYLE_SHADOW_TRANSPARENT, &Caption, &SearchWindow)) {
+        RegeditSearchCleanup(SearchContext);
+        return;
+    }
+
+    YoriWinSetControlContext(SearchWindow, SearchContext);
+    YoriWinGetClientSize(SearchWindow, &WindowSize);
+
+    Area.Left = 1;
+    Area.Top = 0;
+    Area.Right = (WORD)(WindowSize.X - 2);
+    Area.Bottom = (WORD)(WindowSize.Y - 5);
+
+    ResultList = YoriWinListCreate(SearchWindow, &Area, YORI_WIN_LIST_STYLE_VSCROLLBAR);
+    if (ResultList == NULL) {
+        YoriWinDestroyWindow(SearchWindow);
+        RegeditSearchCleanup(SearchContext);
+        return;
+    }
+
+    YoriWinSetControlId(ResultList, RegeditSearchControlResultList);
+
+    YoriLibConstantString(&Caption, _T("Searching..."));
+
+    Area.Top = (WORD)(Area.Bottom + 1);
+    Area.Bottom = Area.Top;
+
+    Ctrl = YoriWinLabelCreate(SearchWindow, &Area, &Caption, YORI_WIN_LABEL_NO_ACCELERATOR);
+    if (Ctrl == NULL) {
+        YoriWinDestroyWindow(SearchWindow);
+        RegeditSearchCleanup(SearchContext);
+        return;
+    }
+
+    YoriWinSetControlId(Ctrl, RegeditSearchControlStatus);
+
+    YoriLibConstantString(&Caption, _T("&Go"));
+
+    Area.Top = (WORD)(Area.Bottom + 1);
+    Area.Bottom = (WORD)(Area.Top + 2);
+    Area.Left = 1;
+    Area.Right = (WORD)(Area.Left + 1 + 8);
+
+    Ctrl = YoriWinButtonCreate(SearchWindow, &Area, &Caption, YORI_WIN_BUTTON_STYLE_DEFAULT, RegeditSearchGoButtonClicked);
+    if (Ctrl == NULL) {
+        YoriWinDestroyWindow(SearchWindow);
+        RegeditSearchCleanup(SearchContext);
+        return;
+    }
+
+    YoriLibConstantString(&Caption, _T("&Close"));
+
+    Area.Left = (WORD)(Area.Right + 2);
+    Area.Right = (WORD)(Area.Left + 1 + 8);
+
+    Ctrl = YoriWinButtonCreate(SearchWindow, &Area, &Caption, YORI_WIN_BUTTON_STYLE_CANCEL, RegeditSearchCloseButtonClicked);
+    if (Ctrl == NULL) {
+        YoriWinDestroyWindow(SearchWindow);
+        RegeditSearchCleanup(SearchContext);
+        return;
+    }
+
+    if (!YoriWinSetWindowTimerNotifyCallback(SearchWindow, REGEDIT_UPDATE_INTERVAL, RegeditSearchWindowTimer)) {
+        YoriWinDestroyWindow(SearchWindow);
+        RegeditSearchCleanup(SearchContext);
+        return;
+    }
+
+    if (!RegeditSearchStart(RegeditContext, SearchContext)) {
+        YoriWinDestroyWindow(SearchWindow);
+        RegeditSearchCleanup(SearchContext);
+        RegeditDisplayWin32Error(Parent, ERROR_NOT_ENOUGH_MEMORY);
+        return;
+    }
+
+    WindowResult = FALSE;
+    if (!YoriWinProcessInputForWindow(SearchWindow, &WindowResult)) {
+        WindowResult = FALSE;
+    }
+
+    if (!WindowResult ||
+        !YoriWinListGetActiveOption(ResultList, &ActiveOption)) {
+
+        ActiveOption = (DWORD)-1;
+    }
+
+    YoriWinDestroyWindow(SearchWindow);
+
+    //
+    //  If the user selected a result, navigate to it.  For a key, this
+    //  navigates to its parent and selects the key; for a value, this
+    //  navigates to the key containing it and selects the value.
+    //
+
+    if (ActiveOption < SearchContext->ResultCount) {
+
+        Result = SearchContext->Results[ActiveOption];
+        if (Result->IsValue) {
+            RegeditNavigateToKey(RegeditContext, Parent, Result->RootKey, &Result->Subkey, NULL, &Result->ValueName);
+        } else {
+            YORI_STRING ParentKey;
+            YORI_STRING KeyName;
+            LPTSTR FinalSlash;
+
+            YoriLibInitEmptyString(&ParentKey);
+            YoriLibInitEmptyString(&KeyName);
+            ParentKey.StartOfString = Result->Subkey.StartOfString;
+            KeyName.StartOfString = Result->Subkey.StartOfString;
+            KeyName.LengthInChars = Result->Subkey.LengthInChars;
+            FinalSlash = YoriLibFindRightMostCharacter(&Result->Subkey, '\\');
+            if (FinalSlash != NULL) {
+                ParentKey.LengthInChars = (DWORD)(FinalSlash - Result->Subkey.StartOfString);
+                KeyName.StartOfString = FinalSlash + 1;
+                KeyName.LengthInChars = Result->Subkey.LengthInChars - ParentKey.LengthInChars - 1;
+            }
+            RegeditNavigateToKey(RegeditContext, Parent, Result->RootKey, &ParentKey, &KeyName, NULL);
+        }
+    }
+
+    RegeditSearchCleanup(SearchContext);
+}
+
+// vim:sw=4:ts=4:et:
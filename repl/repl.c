@@ -3,7 +3,7 @@
  *
  * Yori shell replace text with other text on an input stream
  *
- * Copyright (c) 2018-2021 Malcolm J. Smith
+ * Copyright (c) 2018-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -36,11 +36,18 @@ CHAR strReplHelpText[] =
         "Output the contents of one or more files with specified text replaced\n"
         "with alternate text.\n"
         "\n"
-        "REPL [-license] [-b] [-i] [-s] <old text> [<new text> [<file>...]]\n"
+        "REPL [-license] [-b] [-i] [-r] [-s] [-w] <old text> [<new text> [<file>...]]\n"
+        "REPL [-license] [-b] [-i] [-r] [-s] [-w] -e <old text> <new text>\n"
+        "     [-e <old text> <new text>...] [<file>...]\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
+        "   -e             Replace <old text> with <new text>.  If specified, all\n"
+        "                    pairs are applied in one pass, and all remaining\n"
+        "                    arguments are files\n"
         "   -i             Match insensitively\n"
-        "   -s             Process files from all subdirectories\n";
+        "   -r             Interpret old text as regular expressions\n"
+        "   -s             Process files from all subdirectories\n"
+        "   -w             Write changes back to each file instead of to output\n";
 
 /**
  Display usage text to the user.
@@ -56,167 +63,1259 @@ ReplHelp(VOID)
     return TRUE;
 }
 
+/**
+ The number of bytes of rewritten file contents to hold in memory before
+ moving it to a temporary file.  Since several files are rewritten at once,
+ this bounds the memory used for large files.
+ */
+#define REPL_SPILL_THRESHOLD (4 * 1024 * 1024)
+
+/**
+ The prefix to use for temporary files created while rewriting files.
+ */
+#define REPL_TEMP_PREFIX _T("REPL")
+
+/**
+ A file waiting to be rewritten by a background thread.
+ */
+typedef struct _REPL_PENDING_FILE {
+
+    /**
+     The entry of this file on the list of pending files.
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     The full path to the file.  The string is allocated as part of this
+     structure.
+     */
+    YORI_STRING FilePath;
+
+} REPL_PENDING_FILE, *PREPL_PENDING_FILE;
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
 typedef struct _REPL_CONTEXT {
 
-    /**
-     Records the total number of files processed.
-     */
-    LONGLONG FilesFound;
+    /**
+     Records the total number of files processed.
+     */
+    LONGLONG FilesFound;
+
+    /**
+     Records the number of files rewritten with changes.
+     */
+    LONG FilesChanged;
+
+    /**
+     TRUE if matches should be applied case insensitively, FALSE if they
+     should be applied case sensitively.
+     */
+    BOOL Insensitive;
+
+    /**
+     TRUE to indicate that files are being enumerated recursively.
+     */
+    BOOL Recursive;
+
+    /**
+     TRUE if the strings to search for are regular expressions, FALSE if
+     they are literal text.
+     */
+    BOOLEAN RegularExpressions;
+
+    /**
+     TRUE if changes should be written back to each file, FALSE if they
+     should be written to standard output.
+     */
+    BOOLEAN InPlace;
+
+    /**
+     Set to TRUE if any file could not be rewritten.
+     */
+    BOOLEAN Failed;
+
+    /**
+     The number of pairs of strings to search for and replace.
+     */
+    DWORD PairCount;
+
+    /**
+     An array of strings to compare with to determine a match.
+     */
+    PYORI_STRING MatchStrings;
+
+    /**
+     An array of strings to replace each match with.
+     */
+    PYORI_STRING NewStrings;
+
+    /**
+     All of the strings to search for, compiled to find the first match of
+     any in one pass.  Since a compiled expression can only be used by one
+     thread at a time, this is used by the main thread, and each background
+     thread compiles its own.
+     */
+    PYORI_LIB_REGEX Regex;
+
+    /**
+     The maximum number of background threads to create.
+     */
+    DWORD MaxThreads;
+
+    /**
+     The number of background threads created.
+     */
+    DWORD ThreadsAllocated;
+
+    /**
+     An array of handles to background threads.
+     */
+    PHANDLE Threads;
+
+    /**
+     A mutex protecting the list of pending files.
+     */
+    HANDLE Mutex;
+
+    /**
+     An event signalled when a file is added to the list of pending files.
+     This must immediately precede WorkerShutdownEvent, since background
+     threads wait on both.
+     */
+    HANDLE WorkerWaitEvent;
+
+    /**
+     An event signalled when background threads should terminate after
+     processing any pending files.
+     */
+    HANDLE WorkerShutdownEvent;
+
+    /**
+     A list of files waiting to be processed by background threads.
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     The number of files on the pending list.
+     */
+    DWORD ItemsQueued;
+
+} REPL_CONTEXT, *PREPL_CONTEXT;
+
+/**
+ Compile the strings to search for into a single expression.
+
+ @param ReplContext Pointer to the context containing the strings.
+
+ @param ReportErrors TRUE if an invalid expression should be reported to the
+        user.
+
+ @param Regex On successful completion, updated to point to the compiled
+        expression.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+ReplCompile(
+    __in PREPL_CONTEXT ReplContext,
+    __in BOOLEAN ReportErrors,
+    __out PYORI_LIB_REGEX *Regex
+    )
+{
+    PDWORD PatternFlags;
+    DWORD Index;
+    DWORD Flags;
+    DWORD ErrorPattern;
+    DWORD ErrorOffset;
+    BOOL Result;
+
+    PatternFlags = YoriLibMalloc(ReplContext->PairCount * sizeof(DWORD));
+    if (PatternFlags == NULL) {
+        return FALSE;
+    }
+
+    for (Index = 0; Index < ReplContext->PairCount; Index++) {
+        PatternFlags[Index] = 0;
+        if (!ReplContext->RegularExpressions) {
+            PatternFlags[Index] = YORI_LIB_REGEX_PATTERN_LITERAL;
+        }
+    }
+
+    Flags = 0;
+    if (ReplContext->Insensitive) {
+        Flags = YORI_LIB_REGEX_INSENSITIVE;
+    }
+
+    ErrorPattern = (DWORD)-1;
+    ErrorOffset = 0;
+    Result = YoriLibRegexCompile(ReplContext->PairCount, ReplContext->MatchStrings, PatternFlags, Flags, Regex, &ErrorPattern, &ErrorOffset);
+    YoriLibFree(PatternFlags);
+
+    if (!Result && ReportErrors) {
+        if (ErrorPattern == (DWORD)-1) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: out of memory\n"));
+        } else if (ErrorOffset < ReplContext->MatchStrings[ErrorPattern].LengthInChars) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: invalid expression %y at offset %i\n"), &ReplContext->MatchStrings[ErrorPattern], ErrorOffset);
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: invalid expression %y\n"), &ReplContext->MatchStrings[ErrorPattern]);
+        }
+    }
+
+    return Result;
+}
+
+/**
+ Append a string to a string, reallocating if required.
+
+ @param String Pointer to the string to append to.
+
+ @param Source Pointer to the string to append.
+
+ @return TRUE to indicate success, FALSE to indicate allocation failure.
+ */
+__success(return)
+BOOL
+ReplAppendString(
+    __inout PYORI_STRING String,
+    __in PCYORI_STRING Source
+    )
+{
+    DWORD LengthRequired;
+
+    LengthRequired = String->LengthInChars + Source->LengthInChars + 1;
+    if (LengthRequired > String->LengthAllocated) {
+        if (!YoriLibReallocateString(String, LengthRequired + 256)) {
+            return FALSE;
+        }
+    }
+
+    memcpy(&String->StartOfString[String->LengthInChars], Source->StartOfString, Source->LengthInChars * sizeof(TCHAR));
+    String->LengthInChars = String->LengthInChars + Source->LengthInChars;
+    String->StartOfString[String->LengthInChars] = '\0';
+    return TRUE;
+}
+
+/**
+ Apply all replacements to a single line.  The line is scanned once, and at
+ each position the earliest match of any search string is replaced.  Where
+ more than one search string matches at the same position, the one
+ specified first is used.  Matches which contain no text are not replaced.
+
+ @param ReplContext Pointer to the context containing the replacement
+        strings.
+
+ @param Regex Pointer to the compiled search strings.
+
+ @param Line Pointer to the line to process.
+
+ @param Output Pointer to a string which may be reallocated to contain the
+        line after replacement.
+
+ @param Result On successful completion, updated to point to either Line if
+        no replacement occurred, or Output if replacement occurred.
+
+ @return TRUE to indicate success, FALSE to indicate allocation failure.
+ */
+__success(return)
+BOOL
+ReplProcessLine(
+    __in PREPL_CONTEXT ReplContext,
+    __in PYORI_LIB_REGEX Regex,
+    __in PYORI_STRING Line,
+    __inout PYORI_STRING Output,
+    __out PYORI_STRING *Result
+    )
+{
+    YORI_STRING Portion;
+    DWORD CopiedOffset;
+    DWORD SearchOffset;
+    DWORD MatchOffset;
+    DWORD MatchLength;
+    DWORD PatternIndex;
+    BOOLEAN Replaced;
+
+    Output->LengthInChars = 0;
+    CopiedOffset = 0;
+    SearchOffset = 0;
+    Replaced = FALSE;
+
+    YoriLibInitEmptyString(&Portion);
+    while (YoriLibRegexFindFirst(Regex, Line, SearchOffset, &MatchOffset, &MatchLength, &PatternIndex)) {
+        if (MatchLength == 0) {
+            SearchOffset = MatchOffset + 1;
+            continue;
+        }
+
+        Portion.StartOfString = &Line->StartOfString[CopiedOffset];
+        Portion.LengthInChars = MatchOffset - CopiedOffset;
+        if (!ReplAppendString(Output, &Portion) ||
+            !ReplAppendString(Output, &ReplContext->NewStrings[PatternIndex])) {
+
+            return FALSE;
+        }
+
+        CopiedOffset = MatchOffset + MatchLength;
+        SearchOffset = CopiedOffset;
+        Replaced = TRUE;
+    }
+
+    if (!Replaced) {
+        *Result = Line;
+        return TRUE;
+    }
+
+    Portion.StartOfString = &Line->StartOfString[CopiedOffset];
+    Portion.LengthInChars = Line->LengthInChars - CopiedOffset;
+    if (!ReplAppendString(Output, &Portion)) {
+        return FALSE;
+    }
+
+    *Result = Output;
+    return TRUE;
+}
+
+/**
+ Process a stream and apply the repl criteria before outputting to standard
+ output.
+
+ @param hSource The incoming stream to highlight.
+
+ @param ReplContext Pointer to a set of criteria to apply to the stream
+        before outputting.
+
+ @return TRUE for success, FALSE on failure.
+ */
+BOOL
+ReplProcessStream(
+    __in HANDLE hSource,
+    __in PREPL_CONTEXT ReplContext
+    )
+{
+    PVOID LineContext = NULL;
+    CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
+    YORI_STRING LineString;
+    YORI_STRING Output;
+    PYORI_STRING SourceString;
+    BOOL Result;
+
+    YoriLibInitEmptyString(&LineString);
+    YoriLibInitEmptyString(&Output);
+    Result = TRUE;
+
+    ReplContext->FilesFound++;
+
+    while (TRUE) {
+
+        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+            break;
+        }
+
+        if (!ReplProcessLine(ReplContext, ReplContext->Regex, &LineString, &Output, &SourceString)) {
+            Result = FALSE;
+            break;
+        }
+
+        //
+        //  Output the line.
+        //
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), SourceString);
+        if (SourceString->LengthInChars == 0 || !GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ScreenInfo) || ScreenInfo.dwCursorPosition.X != 0) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+        }
+    }
+
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    YoriLibFreeStringContents(&Output);
+
+    return Result;
+}
+
+/**
+ Append a string to a buffer, converted to the encoding used to read files.
+
+ @param Buffer Pointer to the buffer.
+
+ @param Encoding The encoding to convert to.
+
+ @param String Pointer to the string to append.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+ReplAppendEncoded(
+    __inout PYORI_LIB_SEGMENTED_BUFFER Buffer,
+    __in DWORD Encoding,
+    __in PCYORI_STRING String
+    )
+{
+    PUCHAR Target;
+    DWORD BytesNeeded;
+
+    if (String->LengthInChars == 0) {
+        return TRUE;
+    }
+
+    if (Encoding == CP_UTF16) {
+        return YoriLibSegmentedBufferAppend(Buffer, String->StartOfString, String->LengthInChars * sizeof(TCHAR));
+    }
+
+    BytesNeeded = WideCharToMultiByte(Encoding, 0, String->StartOfString, String->LengthInChars, NULL, 0, NULL, NULL);
+    if (BytesNeeded == 0) {
+        return FALSE;
+    }
+
+    Target = YoriLibSegmentedBufferGetPointerToEnd(Buffer, BytesNeeded, NULL);
+    if (Target == NULL) {
+        return FALSE;
+    }
+
+    WideCharToMultiByte(Encoding, 0, String->StartOfString, String->LengthInChars, (LPSTR)Target, BytesNeeded, NULL, NULL);
+    return YoriLibSegmentedBufferAddToPopulatedLength(Buffer, BytesNeeded);
+}
+
+/**
+ The number of bytes to read from the original file at a time when checking
+ that its contents can be reproduced.
+ */
+#define REPL_ORIGINAL_READ_SIZE (64 * 1024)
+
+/**
+ State for reading the original bytes of a file being rewritten, so they can
+ be compared with the bytes that would be written for each line.
+ */
+typedef struct _REPL_ORIGINAL_READER {
+
+    /**
+     A handle to the original file, independent of the handle used to read
+     lines.
+     */
+    HANDLE FileHandle;
+
+    /**
+     A buffer of bytes read from the original file.
+     */
+    PUCHAR Buffer;
+
+    /**
+     The number of bytes in Buffer which were read from the file.
+     */
+    DWORD BytesValid;
+
+    /**
+     The offset within Buffer of the next byte to compare.
+     */
+    DWORD CurrentOffset;
+
+    /**
+     A buffer used to hold a line converted back to the file's encoding.
+     */
+    PUCHAR Encoded;
+
+    /**
+     The size of the Encoded buffer, in bytes.
+     */
+    DWORD EncodedAllocated;
+
+} REPL_ORIGINAL_READER, *PREPL_ORIGINAL_READER;
+
+/**
+ Free any buffers allocated by an original reader.  The file handle is owned
+ by the caller.
+
+ @param Reader Pointer to the reader.
+ */
+VOID
+ReplOriginalReaderCleanup(
+    __inout PREPL_ORIGINAL_READER Reader
+    )
+{
+    if (Reader->Buffer != NULL) {
+        YoriLibFree(Reader->Buffer);
+        Reader->Buffer = NULL;
+    }
+    if (Reader->Encoded != NULL) {
+        YoriLibFree(Reader->Encoded);
+        Reader->Encoded = NULL;
+    }
+}
+
+/**
+ Compare the next bytes of the original file with a sequence of bytes, and
+ advance past them.
+
+ @param Reader Pointer to the reader.
+
+ @param Bytes Pointer to the bytes to compare.
+
+ @param Length The number of bytes to compare.
+
+ @return TRUE if the original file contains exactly these bytes at the
+         current position, FALSE if it does not.
+ */
+BOOLEAN
+ReplOriginalCompareBytes(
+    __inout PREPL_ORIGINAL_READER Reader,
+    __in PUCHAR Bytes,
+    __in DWORD Length
+    )
+{
+    DWORD Offset;
+    DWORD Chunk;
+
+    Offset = 0;
+    while (Offset < Length) {
+        if (Reader->CurrentOffset == Reader->BytesValid) {
+            Reader->CurrentOffset = 0;
+            if (!ReadFile(Reader->FileHandle, Reader->Buffer, REPL_ORIGINAL_READ_SIZE, &Reader->BytesValid, NULL)) {
+                Reader->BytesValid = 0;
+            }
+            if (Reader->BytesValid == 0) {
+                return FALSE;
+            }
+        }
+
+        Chunk = Reader->BytesValid - Reader->CurrentOffset;
+        if (Chunk > Length - Offset) {
+            Chunk = Length - Offset;
+        }
+
+        if (memcmp(&Reader->Buffer[Reader->CurrentOffset], &Bytes[Offset], Chunk) != 0) {
+            return FALSE;
+        }
+
+        Reader->CurrentOffset = Reader->CurrentOffset + Chunk;
+        Offset = Offset + Chunk;
+    }
+
+    return TRUE;
+}
+
+/**
+ Check whether a string, converted to the encoding used to read files,
+ matches the next bytes of the original file.  This is used to verify that
+ the file can be reproduced exactly, which is not the case if it contains
+ bytes that are invalid in its encoding.
+
+ @param Reader Pointer to the reader.
+
+ @param Encoding The encoding of the file.
+
+ @param String Pointer to the string to compare.
+
+ @param Matches On successful completion, set to TRUE if the original file
+        contains the encoded string at the current position, or FALSE if it
+        does not.
+
+ @return TRUE to indicate success, FALSE to indicate allocation failure.
+ */
+__success(return)
+BOOL
+ReplOriginalCompareString(
+    __inout PREPL_ORIGINAL_READER Reader,
+    __in DWORD Encoding,
+    __in PCYORI_STRING String,
+    __out PBOOLEAN Matches
+    )
+{
+    DWORD BytesNeeded;
+
+    if (String->LengthInChars == 0) {
+        *Matches = TRUE;
+        return TRUE;
+    }
+
+    if (Encoding == CP_UTF16) {
+        *Matches = ReplOriginalCompareBytes(Reader, (PUCHAR)String->StartOfString, String->LengthInChars * sizeof(TCHAR));
+        return TRUE;
+    }
+
+    BytesNeeded = WideCharToMultiByte(Encoding, 0, String->StartOfString, String->LengthInChars, NULL, 0, NULL, NULL);
+    if (BytesNeeded == 0) {
+        *Matches = FALSE;
+        return TRUE;
+    }
+
+    if (BytesNeeded > Reader->EncodedAllocated) {
+        if (Reader->Encoded != NULL) {
+            YoriLibFree(Reader->Encoded);
+        }
+        Reader->EncodedAllocated = BytesNeeded + 256;
+        Reader->Encoded = YoriLibMalloc(Reader->EncodedAllocated);
+        if (Reader->Encoded == NULL) {
+            Reader->EncodedAllocated = 0;
+            return FALSE;
+        }
+    }
+
+    WideCharToMultiByte(Encoding, 0, String->StartOfString, String->LengthInChars, (LPSTR)Reader->Encoded, BytesNeeded, NULL, NULL);
+    *Matches = ReplOriginalCompareBytes(Reader, Reader->Encoded, BytesNeeded);
+    return TRUE;
+}
+
+/**
+ Check whether all bytes of the original file have been compared.
+
+ @param Reader Pointer to the reader.
+
+ @return TRUE if the original file contains no further bytes, FALSE if it
+         does.
+ */
+BOOLEAN
+ReplOriginalAtEnd(
+    __inout PREPL_ORIGINAL_READER Reader
+    )
+{
+    if (Reader->CurrentOffset < Reader->BytesValid) {
+        return FALSE;
+    }
+
+    Reader->CurrentOffset = 0;
+    if (!ReadFile(Reader->FileHandle, Reader->Buffer, REPL_ORIGINAL_READ_SIZE, &Reader->BytesValid, NULL)) {
+        Reader->BytesValid = 0;
+    }
+
+    if (Reader->BytesValid == 0) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Write new contents over an existing file through the file itself, rather
+ than by replacing it.  This is used for files which are reached through a
+ link, since replacing the file would replace the link rather than the data
+ it refers to.
+
+ @param FilePath Pointer to the full path to the file.
+
+ @param Buffer Pointer to the new contents of the file.
+
+ @return ERROR_SUCCESS to indicate success, or a Win32 error code on
+         failure.
+ */
+DWORD
+ReplWriteInPlace(
+    __in PYORI_STRING FilePath,
+    __in PYORI_LIB_SEGMENTED_BUFFER Buffer
+    )
+{
+    HANDLE hTarget;
+    DWORD Err;
+
+    hTarget = CreateFile(FilePath->StartOfString,
+                         GENERIC_WRITE,
+                         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                         NULL,
+                         OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL,
+                         NULL);
+
+    if (hTarget == INVALID_HANDLE_VALUE) {
+        return GetLastError();
+    }
+
+    Err = ERROR_SUCCESS;
+    if (!YoriLibSegmentedBufferWriteToHandle(Buffer, hTarget) ||
+        !SetEndOfFile(hTarget) ||
+        !FlushFileBuffers(hTarget)) {
+
+        Err = GetLastError();
+    }
+
+    CloseHandle(hTarget);
+    return Err;
+}
+
+/**
+ Write new contents to a temporary file in the same directory as an existing
+ file and replace the existing file with it, so the file is never observed
+ partially written.  Where ReplaceFile is available it is used, which
+ retains the security descriptor, attributes and alternate streams of the
+ existing file.
+
+ @param FilePath Pointer to the full path to the file.
+
+ @param Buffer Pointer to the new contents of the file.
+
+ @return ERROR_SUCCESS to indicate success, or a Win32 error code on
+         failure.
+ */
+DWORD
+ReplWriteReplacement(
+    __in PYORI_STRING FilePath,
+    __in PYORI_LIB_SEGMENTED_BUFFER Buffer
+    )
+{
+    YORI_STRING Directory;
+    YORI_STRING Prefix;
+    YORI_STRING TempFileName;
+    LPTSTR FinalSeperator;
+    HANDLE hTempFile;
+    DWORD Err;
+
+    YoriLibInitEmptyString(&Directory);
+    FinalSeperator = YoriLibFindRightMostCharacter(FilePath, '\\');
+    if (FinalSeperator != NULL) {
+        Directory.StartOfString = FilePath->StartOfString;
+        Directory.LengthInChars = (DWORD)(FinalSeperator - FilePath->StartOfString);
+    } else {
+        YoriLibConstantString(&Directory, _T("."));
+    }
+
+    YoriLibConstantString(&Prefix, REPL_TEMP_PREFIX);
+    if (!YoriLibGetTempFileName(&Directory, &Prefix, &hTempFile, &TempFileName)) {
+        return GetLastError();
+    }
 
-    /**
-     TRUE if matches should be applied case insensitively, FALSE if they
-     should be applied case sensitively.
-     */
-    BOOL Insensitive;
+    Err = ERROR_SUCCESS;
+    if (!YoriLibSegmentedBufferWriteToHandle(Buffer, hTempFile) ||
+        !FlushFileBuffers(hTempFile)) {
 
-    /**
-     TRUE to indicate that files are being enumerated recursively.
-     */
-    BOOL Recursive;
+        Err = GetLastError();
+    }
 
-    /**
-     A string to compare with to determine a match.
-     */
-    PYORI_STRING MatchString;
+    CloseHandle(hTempFile);
 
-    /**
-     A string to replace the match with.
-     */
-    PYORI_STRING NewString;
+    if (Err == ERROR_SUCCESS) {
+        if (DllKernel32.pReplaceFileW != NULL) {
+            if (!DllKernel32.pReplaceFileW(FilePath->StartOfString, TempFileName.StartOfString, NULL, 0, NULL, NULL)) {
+                Err = GetLastError();
+            }
+        } else {
+            Err = YoriLibMoveFile(&TempFileName, FilePath, TRUE, FALSE);
+        }
+    }
 
-} REPL_CONTEXT, *PREPL_CONTEXT;
+    if (Err != ERROR_SUCCESS) {
+        DeleteFile(TempFileName.StartOfString);
+    }
+
+    YoriLibFreeStringContents(&TempFileName);
+    return Err;
+}
 
 /**
- Process a stream and apply the repl criteria before outputting to standard
- output.
+ Apply all replacements to a file, and if any replacement occurred, replace
+ the file with the result.  Files containing no matches are not written.
+ Line endings and any byte order mark are preserved.
 
- @param hSource The incoming stream to highlight.
+ Lines are decoded to be searched and encoded again to be written, so each
+ line is compared with the bytes of the original file to ensure that lines
+ without matches are written back unchanged.  A file which cannot be
+ reproduced this way, because it contains bytes that are invalid in the
+ current encoding, is not modified.
 
- @param ReplContext Pointer to a set of criteria to apply to the stream
-        before outputting.
+ Normally the result is written to a temporary file which replaces the
+ original, retaining its security descriptor, attributes and alternate
+ streams where the system supports ReplaceFile.  Files which are symbolic
+ links or have multiple hard links are instead overwritten in place, so the
+ link continues to refer to the modified data, at the cost of the file being
+ observable while partially written.  Read only files are not modified.
 
- @return TRUE for success, FALSE on failure.
+ @param ReplContext Pointer to the context containing the replacement
+        strings.
+
+ @param Regex Pointer to the compiled search strings.  This must not be in
+        use by any other thread.
+
+ @param FilePath Pointer to the full path to the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
-ReplProcessStream(
-    __in HANDLE hSource,
-    __in PREPL_CONTEXT ReplContext
+ReplRewriteFile(
+    __in PREPL_CONTEXT ReplContext,
+    __in PYORI_LIB_REGEX Regex,
+    __in PYORI_STRING FilePath
     )
 {
     PVOID LineContext = NULL;
-    CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
+    YORI_LIB_SEGMENTED_BUFFER Buffer;
+    YORI_LIB_LINE_ENDING LineEnding;
+    REPL_ORIGINAL_READER Original;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
     YORI_STRING LineString;
-    YORI_STRING AlternateStrings[2];
-    YORI_STRING InitialPortion;
-    YORI_STRING TrailingPortion;
+    YORI_STRING Output;
+    YORI_STRING EndOfLine;
     PYORI_STRING SourceString;
-    DWORD SearchOffset;
-    YORI_STRING SearchSubset;
-    DWORD MatchOffset;
-    DWORD NextAlternate;
-    DWORD LengthRequired;
+    LPTSTR ErrText;
+    HANDLE hSource;
+    UCHAR Bom[3];
+    DWORD BomLength;
+    DWORD BytesRead;
+    DWORD Encoding;
+    DWORD LinkAttributes;
+    DWORD Err;
+    BOOL TimeoutReached;
+    BOOLEAN Changed;
+    BOOLEAN RoundTrip;
+    BOOLEAN Cancelled;
+    BOOL Result;
+
+    ASSERT(YoriLibIsStringNullTerminated(FilePath));
+
+    hSource = CreateFile(FilePath->StartOfString,
+                         GENERIC_READ,
+                         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                         NULL,
+                         OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL,
+                         NULL);
+
+    if (hSource == INVALID_HANDLE_VALUE) {
+        Err = GetLastError();
+        ErrText = YoriLibGetWinErrorText(Err);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: open of %y failed: %s"), FilePath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return FALSE;
+    }
+
+    ZeroMemory(&Original, sizeof(Original));
+    Original.FileHandle = CreateFile(FilePath->StartOfString,
+                                     GENERIC_READ,
+                                     FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                     NULL,
+                                     OPEN_EXISTING,
+                                     FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                                     NULL);
+
+    if (Original.FileHandle == INVALID_HANDLE_VALUE) {
+        Err = GetLastError();
+        ErrText = YoriLibGetWinErrorText(Err);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: open of %y failed: %s"), FilePath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        CloseHandle(hSource);
+        return FALSE;
+    }
+
+    if (!GetFileInformationByHandle(hSource, &FileInfo)) {
+        ZeroMemory(&FileInfo, sizeof(FileInfo));
+        FileInfo.nNumberOfLinks = 1;
+    }
+
+    //
+    //  The line reader skips any byte order mark, so check for one here so
+    //  it can be written to the new file.
+    //
+
+    Encoding = YoriLibGetMultibyteInputEncoding();
+    BomLength = 0;
+    if (ReadFile(hSource, Bom, sizeof(Bom), &BytesRead, NULL)) {
+        if (Encoding == CP_UTF8 && BytesRead >= 3 &&
+            Bom[0] == 0xEF && Bom[1] == 0xBB && Bom[2] == 0xBF) {
+
+            BomLength = 3;
+        } else if (Encoding == CP_UTF16 && BytesRead >= 2 &&
+                   ((Bom[0] == 0xFF && Bom[1] == 0xFE) || (Bom[0] == 0xFE && Bom[1] == 0xFF))) {
+
+            BomLength = 2;
+        }
+    }
+    SetFilePointer(hSource, 0, NULL, FILE_BEGIN);
+    SetFilePointer(Original.FileHandle, BomLength, NULL, FILE_BEGIN);
 
+    YoriLibSegmentedBufferInitialize(&Buffer, 0, REPL_SPILL_THRESHOLD);
     YoriLibInitEmptyString(&LineString);
-    YoriLibInitEmptyString(&AlternateStrings[0]);
-    YoriLibInitEmptyString(&AlternateStrings[1]);
+    YoriLibInitEmptyString(&Output);
+    Changed = FALSE;
+    RoundTrip = TRUE;
+    Cancelled = FALSE;
+    Result = TRUE;
+
+    Original.Buffer = YoriLibMalloc(REPL_ORIGINAL_READ_SIZE);
+    if (Original.Buffer == NULL) {
+        Result = FALSE;
+    }
 
-    ReplContext->FilesFound++;
+    if (Result && BomLength > 0 && !YoriLibSegmentedBufferAppend(&Buffer, Bom, BomLength)) {
+        Result = FALSE;
+    }
 
-    while (TRUE) {
+    while (Result) {
 
-        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+        if (YoriLibIsOperationCancelled()) {
+            Cancelled = TRUE;
+            Result = FALSE;
+            break;
+        }
+
+        if (!YoriLibReadLineToStringEx(&LineString, &LineContext, TRUE, INFINITE, hSource, &LineEnding, &TimeoutReached)) {
+            break;
+        }
+
+        if (!ReplProcessLine(ReplContext, Regex, &LineString, &Output, &SourceString)) {
+            Result = FALSE;
             break;
         }
 
+        if (SourceString == &Output) {
+            Changed = TRUE;
+        }
+
         //
-        //  Loop through the line, finding all occurrences of the MatchString
-        //  and replacing them with NewString
+        //  Once the file is known not to round trip it will not be written,
+        //  so keep reading only to determine whether it would have changed.
         //
 
-        SourceString = &LineString;
-        SearchOffset = 0;
-        NextAlternate = 0;
-        while(TRUE) {
+        if (!RoundTrip) {
+            continue;
+        }
+
+        switch(LineEnding) {
+            case YoriLibLineEndingCRLF:
+                YoriLibConstantString(&EndOfLine, _T("\r\n"));
+                break;
+            case YoriLibLineEndingLF:
+                YoriLibConstantString(&EndOfLine, _T("\n"));
+                break;
+            case YoriLibLineEndingCR:
+                YoriLibConstantString(&EndOfLine, _T("\r"));
+                break;
+            default:
+                YoriLibInitEmptyString(&EndOfLine);
+                break;
+        }
+
+        if (!ReplOriginalCompareString(&Original, Encoding, &LineString, &RoundTrip)) {
+            Result = FALSE;
+            break;
+        }
 
-            //
-            //  Continue searching after any previous replacements
-            //
+        if (RoundTrip &&
+            !ReplOriginalCompareString(&Original, Encoding, &EndOfLine, &RoundTrip)) {
 
-            YoriLibInitEmptyString(&SearchSubset);
-            SearchSubset.StartOfString = &SourceString->StartOfString[SearchOffset];
-            SearchSubset.LengthInChars = SourceString->LengthInChars - SearchOffset;
+            Result = FALSE;
+            break;
+        }
 
-            //
-            //  If no match is found, the line processing is complete
-            //
+        if (RoundTrip) {
+            if (!ReplAppendEncoded(&Buffer, Encoding, SourceString) ||
+                !ReplAppendEncoded(&Buffer, Encoding, &EndOfLine)) {
 
-            if (ReplContext->Insensitive) {
-                if (YoriLibFindFirstMatchingSubstringInsensitive(&SearchSubset, 1, ReplContext->MatchString, &MatchOffset) == NULL) {
-                    break;
-                }
-            } else {
-                if (YoriLibFindFirstMatchingSubstring(&SearchSubset, 1, ReplContext->MatchString, &MatchOffset) == NULL) {
-                    break;
-                }
+                Result = FALSE;
             }
+        }
+    }
+
+    if (Result && RoundTrip) {
+        RoundTrip = ReplOriginalAtEnd(&Original);
+    }
 
-            //
-            //  If a match is found, a new line needs to be assembled
-            //  consisting of characters already processed and not searched
-            //  for, characters before any match was found, the new string,
-            //  and any characters following the match.
-            //
+    YoriLibLineReadCloseOrCache(LineContext);
+    CloseHandle(hSource);
+    CloseHandle(Original.FileHandle);
+    ReplOriginalReaderCleanup(&Original);
+    YoriLibFreeStringContents(&LineString);
+    YoriLibFreeStringContents(&Output);
 
-            LengthRequired = SearchOffset + SearchSubset.LengthInChars + ReplContext->NewString->LengthInChars - ReplContext->MatchString->LengthInChars + 1;
+    if (!Result) {
+        if (!Cancelled) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: could not process %y\n"), FilePath);
+        }
+        YoriLibSegmentedBufferCleanup(&Buffer);
+        return FALSE;
+    }
 
-            if (LengthRequired > AlternateStrings[NextAlternate].LengthAllocated) {
-                YoriLibFreeStringContents(&AlternateStrings[NextAlternate]);
-                if (!YoriLibAllocateString(&AlternateStrings[NextAlternate], LengthRequired + 256)) {
-                    break;
-                }
-            }
+    if (!Changed) {
+        YoriLibSegmentedBufferCleanup(&Buffer);
+        return TRUE;
+    }
+
+    if (!RoundTrip) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: %y contains text that is invalid in the current encoding, not modified\n"), FilePath);
+        YoriLibSegmentedBufferCleanup(&Buffer);
+        return FALSE;
+    }
+
+    if (FileInfo.dwFileAttributes & FILE_ATTRIBUTE_READONLY) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: %y is read only, not modified\n"), FilePath);
+        YoriLibSegmentedBufferCleanup(&Buffer);
+        return FALSE;
+    }
+
+    LinkAttributes = GetFileAttributes(FilePath->StartOfString);
+    if ((LinkAttributes != (DWORD)-1 && (LinkAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0) ||
+        FileInfo.nNumberOfLinks > 1) {
+
+        Err = ReplWriteInPlace(FilePath, &Buffer);
+    } else {
+        Err = ReplWriteReplacement(FilePath, &Buffer);
+    }
+
+    YoriLibSegmentedBufferCleanup(&Buffer);
+
+    if (Err != ERROR_SUCCESS) {
+        ErrText = YoriLibGetWinErrorText(Err);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: could not write %y: %s"), FilePath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return FALSE;
+    }
+
+    InterlockedIncrement(&ReplContext->FilesChanged);
+    return TRUE;
+}
+
+/**
+ A background thread which rewrites files found on the list of pending
+ files.
+
+ @param Context Pointer to the repl context.
+
+ @return TRUE to indicate success, FALSE to indicate one or more files could
+         not be rewritten.
+ */
+DWORD WINAPI
+ReplWorker(
+    __in LPVOID Context
+    )
+{
+    PREPL_CONTEXT ReplContext = (PREPL_CONTEXT)Context;
+    PREPL_PENDING_FILE PendingFile;
+    PYORI_LIB_REGEX Regex;
+    DWORD FoundEvent;
+    BOOL Result = TRUE;
+
+    //
+    //  If this thread cannot compile its own expression, any files it
+    //  would have processed are left on the list for the main thread.
+    //
+
+    if (!ReplCompile(ReplContext, FALSE, &Regex)) {
+        return FALSE;
+    }
 
-            YoriLibInitEmptyString(&InitialPortion);
-            InitialPortion.StartOfString = SourceString->StartOfString;
-            InitialPortion.LengthInChars = SearchOffset + MatchOffset;
+    while (TRUE) {
+
+        //
+        //  Wait for an indication of more work or shutdown.
+        //
 
-            YoriLibInitEmptyString(&TrailingPortion);
-            TrailingPortion.StartOfString = &SourceString->StartOfString[SearchOffset + MatchOffset + ReplContext->MatchString->LengthInChars];
-            TrailingPortion.LengthInChars = SourceString->LengthInChars - SearchOffset - MatchOffset - ReplContext->MatchString->LengthInChars;
+        FoundEvent = WaitForMultipleObjectsEx(2, &ReplContext->WorkerWaitEvent, FALSE, INFINITE, FALSE);
 
-            AlternateStrings[NextAlternate].LengthInChars = YoriLibSPrintf(AlternateStrings[NextAlternate].StartOfString, _T("%y%y%y"), &InitialPortion, ReplContext->NewString, &TrailingPortion);
+        //
+        //  Process any queued work.
+        //
 
-            //
-            //  Continue searching from the newly assembled string after
-            //  the point of any substitutions.
-            //
+        while (TRUE) {
+            WaitForSingleObject(ReplContext->Mutex, INFINITE);
+            if (!YoriLibIsListEmpty(&ReplContext->PendingList)) {
+                PendingFile = CONTAINING_RECORD(ReplContext->PendingList.Next, REPL_PENDING_FILE, PendingList);
+                ASSERT(ReplContext->ItemsQueued > 0);
+                ReplContext->ItemsQueued--;
+                YoriLibRemoveListItem(&PendingFile->PendingList);
+                ReleaseMutex(ReplContext->Mutex);
+
+                //
+                //  If the user cancelled, drain the queue without touching
+                //  any more files.
+                //
+
+                if (YoriLibIsOperationCancelled()) {
+                    ReplContext->Failed = TRUE;
+                    Result = FALSE;
+                } else if (!ReplRewriteFile(ReplContext, Regex, &PendingFile->FilePath)) {
+                    ReplContext->Failed = TRUE;
+                    Result = FALSE;
+                }
+                YoriLibFree(PendingFile);
 
-            SourceString = &AlternateStrings[NextAlternate];
-            SearchOffset += MatchOffset + ReplContext->NewString->LengthInChars;
-            NextAlternate = (NextAlternate + 1) % 2;
+            } else {
+                ASSERT(ReplContext->ItemsQueued == 0);
+                ReleaseMutex(ReplContext->Mutex);
+                break;
+            }
         }
 
         //
-        //  Output the line.
+        //  If shutdown was requested, terminate the thread.
         //
 
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), SourceString);
-        if (SourceString->LengthInChars == 0 || !GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ScreenInfo) || ScreenInfo.dwCursorPosition.X != 0) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+        if (FoundEvent == (WAIT_OBJECT_0 + 1)) {
+            break;
         }
     }
 
-    YoriLibLineReadCloseOrCache(LineContext);
-    YoriLibFreeStringContents(&LineString);
-    YoriLibFreeStringContents(&AlternateStrings[0]);
-    YoriLibFreeStringContents(&AlternateStrings[1]);
+    YoriLibRegexFree(Regex);
+    return Result;
+}
+
+/**
+ Prepare to rewrite files on background threads.
+
+ @param ReplContext Pointer to the repl context.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+ReplInitializeWorkers(
+    __inout PREPL_CONTEXT ReplContext
+    )
+{
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+
+    //
+    //  Rewriting a file is a mix of computation and IO, so use a thread per
+    //  processor.  Threads are created as work is queued.
+    //
+
+    ReplContext->MaxThreads = SystemInfo.dwNumberOfProcessors;
+    if (ReplContext->MaxThreads < 1) {
+        ReplContext->MaxThreads = 1;
+    }
+    if (ReplContext->MaxThreads > 32) {
+        ReplContext->MaxThreads = 32;
+    }
+
+    YoriLibInitializeListHead(&ReplContext->PendingList);
+    ReplContext->WorkerWaitEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (ReplContext->WorkerWaitEvent == NULL) {
+        return FALSE;
+    }
+
+    ReplContext->WorkerShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (ReplContext->WorkerShutdownEvent == NULL) {
+        return FALSE;
+    }
+
+    ReplContext->Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (ReplContext->Mutex == NULL) {
+        return FALSE;
+    }
+
+    ReplContext->Threads = YoriLibMalloc(sizeof(HANDLE) * ReplContext->MaxThreads);
+    if (ReplContext->Threads == NULL) {
+        return FALSE;
+    }
 
     return TRUE;
 }
 
+/**
+ Wait for background threads to complete any pending files, rewrite any
+ files they could not, and free the state used for background threads.
+
+ @param ReplContext Pointer to the repl context.
+ */
+VOID
+ReplCleanupWorkers(
+    __inout PREPL_CONTEXT ReplContext
+    )
+{
+    PREPL_PENDING_FILE PendingFile;
+    DWORD Index;
+
+    if (ReplContext->ThreadsAllocated > 0) {
+        SetEvent(ReplContext->WorkerShutdownEvent);
+        WaitForMultipleObjectsEx(ReplContext->ThreadsAllocated, ReplContext->Threads, TRUE, INFINITE, FALSE);
+        for (Index = 0; Index < ReplContext->ThreadsAllocated; Index++) {
+            CloseHandle(ReplContext->Threads[Index]);
+            ReplContext->Threads[Index] = NULL;
+        }
+        ReplContext->ThreadsAllocated = 0;
+    }
+
+    if (ReplContext->PendingList.Next != NULL) {
+        while (!YoriLibIsListEmpty(&ReplContext->PendingList)) {
+            PendingFile = CONTAINING_RECORD(ReplContext->PendingList.Next, REPL_PENDING_FILE, PendingList);
+            YoriLibRemoveListItem(&PendingFile->PendingList);
+            ReplContext->ItemsQueued--;
+            if (YoriLibIsOperationCancelled()) {
+                ReplContext->Failed = TRUE;
+            } else if (!ReplRewriteFile(ReplContext, ReplContext->Regex, &PendingFile->FilePath)) {
+                ReplContext->Failed = TRUE;
+            }
+            YoriLibFree(PendingFile);
+        }
+    }
+
+    if (ReplContext->WorkerWaitEvent != NULL) {
+        CloseHandle(ReplContext->WorkerWaitEvent);
+        ReplContext->WorkerWaitEvent = NULL;
+    }
+    if (ReplContext->WorkerShutdownEvent != NULL) {
+        CloseHandle(ReplContext->WorkerShutdownEvent);
+        ReplContext->WorkerShutdownEvent = NULL;
+    }
+    if (ReplContext->Mutex != NULL) {
+        CloseHandle(ReplContext->Mutex);
+        ReplContext->Mutex = NULL;
+    }
+    if (ReplContext->Threads != NULL) {
+        YoriLibFree(ReplContext->Threads);
+        ReplContext->Threads = NULL;
+    }
+}
+
+/**
+ Add a file to the queue of files to be rewritten by background threads.  If
+ the background threads already have an excessively large queue of work,
+ this function returns FALSE to indicate the file should be rewritten by the
+ foreground thread, which prevents enumeration from running arbitrarily far
+ ahead of processing.
+
+ @param ReplContext Pointer to the repl context.
+
+ @param FilePath Pointer to the full path to the file.
+
+ @return TRUE if the file was queued to be processed by background threads,
+         or FALSE if it should be processed by the foreground thread.
+ */
+BOOL
+ReplAddToBackgroundQueue(
+    __in PREPL_CONTEXT ReplContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    PREPL_PENDING_FILE PendingFile;
+    BOOL Result = FALSE;
+    DWORD ThreadId;
+
+    WaitForSingleObject(ReplContext->Mutex, INFINITE);
+    if (ReplContext->ThreadsAllocated == 0 ||
+        (ReplContext->ItemsQueued > ReplContext->ThreadsAllocated * 2 &&
+         ReplContext->ThreadsAllocated < ReplContext->MaxThreads)) {
+
+        ReplContext->Threads[ReplContext->ThreadsAllocated] = CreateThread(NULL, 0, ReplWorker, ReplContext, 0, &ThreadId);
+        if (ReplContext->Threads[ReplContext->ThreadsAllocated] != NULL) {
+            ReplContext->ThreadsAllocated++;
+        }
+    }
+
+    if (ReplContext->ThreadsAllocated > 0 &&
+        ReplContext->ItemsQueued < ReplContext->MaxThreads * 2) {
+
+        PendingFile = YoriLibMalloc(sizeof(REPL_PENDING_FILE) + (FilePath->LengthInChars + 1) * sizeof(TCHAR));
+        if (PendingFile != NULL) {
+            YoriLibInitEmptyString(&PendingFile->FilePath);
+            PendingFile->FilePath.StartOfString = (LPTSTR)(PendingFile + 1);
+            PendingFile->FilePath.LengthInChars = FilePath->LengthInChars;
+            PendingFile->FilePath.LengthAllocated = FilePath->LengthInChars + 1;
+            memcpy(PendingFile->FilePath.StartOfString, FilePath->StartOfString, FilePath->LengthInChars * sizeof(TCHAR));
+            PendingFile->FilePath.StartOfString[FilePath->LengthInChars] = '\0';
+
+            YoriLibAppendList(&ReplContext->PendingList, &PendingFile->PendingList);
+            ReplContext->ItemsQueued++;
+            Result = TRUE;
+        }
+    }
+
+    ReleaseMutex(ReplContext->Mutex);
+
+    if (Result) {
+        SetEvent(ReplContext->WorkerWaitEvent);
+    }
+    return Result;
+}
+
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -248,6 +1347,21 @@ ReplFileFoundCallback(
     ASSERT(YoriLibIsStringNullTerminated(FilePath));
 
     if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+
+        if (ReplContext->InPlace) {
+            if (YoriLibIsOperationCancelled()) {
+                ReplContext->Failed = TRUE;
+                return FALSE;
+            }
+            ReplContext->FilesFound++;
+            if (!ReplAddToBackgroundQueue(ReplContext, FilePath)) {
+                if (!ReplRewriteFile(ReplContext, ReplContext->Regex, FilePath)) {
+                    ReplContext->Failed = TRUE;
+                }
+            }
+            return TRUE;
+        }
+
         FileHandle = CreateFile(FilePath->StartOfString,
                                 GENERIC_READ,
                                 FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
@@ -365,12 +1479,26 @@ ENTRYPOINT(
     DWORD i;
     DWORD StartArg = 0;
     DWORD MatchFlags;
+    DWORD ExitCode;
     BOOL BasicEnumeration = FALSE;
     REPL_CONTEXT ReplContext;
     YORI_STRING Arg;
     YORI_STRING EmptyString;
 
     ZeroMemory(&ReplContext, sizeof(ReplContext));
+    YoriLibInitEmptyString(&EmptyString);
+
+    //
+    //  Each pair consumes at least two arguments, so this is the most pairs
+    //  that can be specified.
+    //
+
+    ReplContext.MatchStrings = YoriLibMalloc((ArgC / 2 + 1) * 2 * sizeof(YORI_STRING));
+    if (ReplContext.MatchStrings == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: out of memory\n"));
+        return EXIT_FAILURE;
+    }
+    ReplContext.NewStrings = &ReplContext.MatchStrings[ArgC / 2 + 1];
 
     for (i = 1; i < ArgC; i++) {
 
@@ -381,19 +1509,35 @@ ENTRYPOINT(
 
             if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("?")) == 0) {
                 ReplHelp();
+                YoriLibFree(ReplContext.MatchStrings);
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2018-2021"));
+                YoriLibDisplayMitLicense(_T("2018-2026"));
+                YoriLibFree(ReplContext.MatchStrings);
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("e")) == 0) {
+                if (i + 2 < ArgC) {
+                    memcpy(&ReplContext.MatchStrings[ReplContext.PairCount], &ArgV[i + 1], sizeof(YORI_STRING));
+                    memcpy(&ReplContext.NewStrings[ReplContext.PairCount], &ArgV[i + 2], sizeof(YORI_STRING));
+                    ReplContext.PairCount++;
+                    ArgumentUnderstood = TRUE;
+                    i += 2;
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("i")) == 0) {
                 ReplContext.Insensitive = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
+                ReplContext.RegularExpressions = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 ReplContext.Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("w")) == 0) {
+                ReplContext.InPlace = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("-")) == 0) {
                 StartArg = i + 1;
                 ArgumentUnderstood = TRUE;
@@ -410,29 +1554,55 @@ ENTRYPOINT(
         }
     }
 
-    if (StartArg == 0 || StartArg >= ArgC) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: missing argument\n"));
-        return EXIT_FAILURE;
-    }
-
     //
     //  Locate arguments.  It's valid to replace something with nothing, but
-    //  it's not valid to replace nothing with something.
+    //  it's not valid to replace nothing with something.  If pairs were
+    //  specified with -e, all remaining arguments are files.
     //
 
-    YoriLibInitEmptyString(&EmptyString);
-    ReplContext.MatchString = &ArgV[StartArg];
-    if (ReplContext.MatchString->LengthInChars == 0) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: missing search string\n"));
+    if (ReplContext.PairCount == 0) {
+        if (StartArg == 0 || StartArg >= ArgC) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: missing argument\n"));
+            YoriLibFree(ReplContext.MatchStrings);
+            return EXIT_FAILURE;
+        }
+
+        memcpy(&ReplContext.MatchStrings[0], &ArgV[StartArg], sizeof(YORI_STRING));
+        if (StartArg + 1 >= ArgC) {
+            memcpy(&ReplContext.NewStrings[0], &EmptyString, sizeof(YORI_STRING));
+        } else {
+            memcpy(&ReplContext.NewStrings[0], &ArgV[StartArg + 1], sizeof(YORI_STRING));
+        }
+        ReplContext.PairCount = 1;
+        StartArg += 2;
+    }
+
+    for (i = 0; i < ReplContext.PairCount; i++) {
+        if (ReplContext.MatchStrings[i].LengthInChars == 0) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: missing search string\n"));
+            YoriLibFree(ReplContext.MatchStrings);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (ReplContext.InPlace && (StartArg == 0 || StartArg >= ArgC)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: -w requires files to modify\n"));
+        YoriLibFree(ReplContext.MatchStrings);
         return EXIT_FAILURE;
     }
 
-    if (StartArg + 1 >= ArgC) {
-        ReplContext.NewString = &EmptyString;
-    } else {
-        ReplContext.NewString = &ArgV[StartArg + 1];
+    if (!ReplCompile(&ReplContext, TRUE, &ReplContext.Regex)) {
+        YoriLibFree(ReplContext.MatchStrings);
+        return EXIT_FAILURE;
+    }
+
+    if (ReplContext.InPlace && !ReplInitializeWorkers(&ReplContext)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("repl: out of memory\n"));
+        ReplCleanupWorkers(&ReplContext);
+        YoriLibRegexFree(ReplContext.Regex);
+        YoriLibFree(ReplContext.MatchStrings);
+        return EXIT_FAILURE;
     }
-    StartArg += 2;
 
 #if YORI_BUILTIN
     YoriLibCancelEnable(FALSE);
@@ -446,6 +1616,8 @@ ENTRYPOINT(
     if (StartArg == 0 || StartArg >= ArgC) {
         if (YoriLibIsStdInConsole()) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("No file or pipe for input\n"));
+            YoriLibRegexFree(ReplContext.Regex);
+            YoriLibFree(ReplContext.MatchStrings);
             return EXIT_FAILURE;
         }
 
@@ -468,8 +1640,15 @@ ENTRYPOINT(
                                  ReplFileEnumerateErrorCallback,
                                  &ReplContext);
         }
+
+        if (ReplContext.InPlace) {
+            ReplCleanupWorkers(&ReplContext);
+        }
     }
 
+    YoriLibRegexFree(ReplContext.Regex);
+    YoriLibFree(ReplContext.MatchStrings);
+
 #if !YORI_BUILTIN
     YoriLibLineReadCleanupCache();
 #endif
@@ -479,7 +1658,12 @@ ENTRYPOINT(
         return EXIT_FAILURE;
     }
 
-    return EXIT_SUCCESS;
+    ExitCode = EXIT_SUCCESS;
+    if (ReplContext.Failed) {
+        ExitCode = EXIT_FAILURE;
+    }
+
+    return ExitCode;
 }
 
 // vim:sw=4:ts=4:et:
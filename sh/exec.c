@@ -775,7 +775,9 @@ YoriShExecuteExpression(
         return FALSE;
     }
 
+    YORI_TRACE_BEGIN("Shell execute expression");
     YoriShExecExecPlan(&ExecPlan, NULL);
+    YORI_TRACE_END("Shell execute expression");
 
     YoriLibShFreeExecPlan(&ExecPlan);
     YoriLibShFreeCmdContext(&CmdContext);
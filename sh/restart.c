@@ -230,9 +230,11 @@ YoriShSaveRestartStateWorker(
     YORI_STRING RestartFileName;
     YORI_STRING RestartBufferFileName;
     YORI_STRING Env;
+    YORI_STRING Section;
     LPTSTR Comma;
     DWORD Count;
     DWORD LineCount;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     UNREFERENCED_PARAMETER(Ignored);
 
@@ -246,8 +248,7 @@ YoriShSaveRestartStateWorker(
     if (DllKernel32.pRegisterApplicationRestart == NULL ||
         DllKernel32.pGetConsoleScreenBufferInfoEx == NULL ||
         DllKernel32.pGetCurrentConsoleFontEx == NULL ||
-        DllKernel32.pGetConsoleWindow == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
+        DllKernel32.pGetConsoleWindow == NULL) {
 
         return 0;
     }
@@ -325,34 +326,51 @@ YoriShSaveRestartStateWorker(
         return 0;
     }
 
-    YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
-                   _T("\\yori-restart-%x.ini"),
-                   GetCurrentProcessId());
+    RestartFileName.LengthInChars = RestartFileName.LengthInChars +
+        YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
+                       _T("\\yori-restart-%x.ini"),
+                       GetCurrentProcessId());
 
     if (!YoriLibAllocateString(&WriteBuffer, 64 * 1024)) {
         YoriLibFreeStringContents(&RestartFileName);
         return 0;
     }
 
+    //
+    //  The document describing the saved state is retained across saves.
+    //  Each save updates it in memory, and it is only written if something
+    //  changed since the previous save, which is the common case when the
+    //  user is running commands that don't change shell state.
+    //
+
+    if (YoriShGlobal.RestartState == NULL) {
+        if (!YoriLibIniLoad(&RestartFileName, &YoriShGlobal.RestartState)) {
+            YoriLibFreeStringContents(&WriteBuffer);
+            YoriLibFreeStringContents(&RestartFileName);
+            return 0;
+        }
+    }
+    IniDocument = YoriShGlobal.RestartState;
+
     YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.dwSize.X);
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("BufferWidth"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Window"), _T("BufferWidth"), WriteBuffer.StartOfString);
     YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.dwSize.Y);
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("BufferHeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Window"), _T("BufferHeight"), WriteBuffer.StartOfString);
     YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.srWindow.Right - ScreenBufferInfo.srWindow.Left + 1);
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("WindowWidth"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Window"), _T("WindowWidth"), WriteBuffer.StartOfString);
     YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.srWindow.Bottom - ScreenBufferInfo.srWindow.Top + 1);
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("WindowHeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Window"), _T("WindowHeight"), WriteBuffer.StartOfString);
 
     YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), YoriLibVtGetDefaultColor());
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("DefaultColor"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Window"), _T("DefaultColor"), WriteBuffer.StartOfString);
     YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.wPopupAttributes);
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("PopupColor"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Window"), _T("PopupColor"), WriteBuffer.StartOfString);
 
     for (Count = 0; Count < sizeof(ScreenBufferInfo.ColorTable)/sizeof(ScreenBufferInfo.ColorTable[0]); Count++) {
         TCHAR ColorName[32];
         YoriLibSPrintf(ColorName, _T("Color%i"), Count);
         YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.ColorTable[Count]);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), ColorName, WriteBuffer.StartOfString, RestartFileName.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Window"), ColorName, WriteBuffer.StartOfString);
     }
 
     //
@@ -366,9 +384,9 @@ YoriShSaveRestartStateWorker(
 
         if (DllUser32.pGetWindowRect(DllKernel32.pGetConsoleWindow(), &WindowRect)) {
             YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), WindowRect.left);
-            DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("WindowLeft"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+            YoriLibIniSetString(IniDocument, _T("Window"), _T("WindowLeft"), WriteBuffer.StartOfString);
             YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), WindowRect.top);
-            DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("WindowTop"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+            YoriLibIniSetString(IniDocument, _T("Window"), _T("WindowTop"), WriteBuffer.StartOfString);
         }
     }
 
@@ -378,7 +396,7 @@ YoriShSaveRestartStateWorker(
 
     WriteBuffer.LengthInChars = GetConsoleTitle(WriteBuffer.StartOfString, 4095);
     if (WriteBuffer.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("Title"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Window"), _T("Title"), WriteBuffer.StartOfString);
     } else {
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Error getting window title: %i\n"), GetLastError());
     }
@@ -391,16 +409,16 @@ YoriShSaveRestartStateWorker(
     FontInfo.cbSize = sizeof(FontInfo);
     if (DllKernel32.pGetCurrentConsoleFontEx(GetStdHandle(STD_OUTPUT_HANDLE), FALSE, &FontInfo)) {
         YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.nFont);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontIndex"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Window"), _T("FontIndex"), WriteBuffer.StartOfString);
         YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.dwFontSize.X);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontWidth"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Window"), _T("FontWidth"), WriteBuffer.StartOfString);
         YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.dwFontSize.Y);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontHeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Window"), _T("FontHeight"), WriteBuffer.StartOfString);
         YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.FontFamily);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontFamily"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Window"), _T("FontFamily"), WriteBuffer.StartOfString);
         YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.FontWeight);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontWeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontName"), FontInfo.FaceName, RestartFileName.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Window"), _T("FontWeight"), WriteBuffer.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Window"), _T("FontName"), FontInfo.FaceName);
     }
 
     //
@@ -409,65 +427,58 @@ YoriShSaveRestartStateWorker(
 
     WriteBuffer.LengthInChars = GetCurrentDirectory(WriteBuffer.LengthAllocated, WriteBuffer.StartOfString);
     if (WriteBuffer.LengthInChars > 0 && WriteBuffer.LengthInChars < WriteBuffer.LengthAllocated) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("CurrentDirectory"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Window"), _T("CurrentDirectory"), WriteBuffer.StartOfString);
     }
 
     //
-    //  Write the current environment
+    //  Write the current environment.  Each section is constructed in full
+    //  and replaces the previous contents of the section, so variables that
+    //  have been removed since the previous save are removed here too.
     //
 
     if (YoriLibGetEnvironmentStrings(&Env)) {
         LPTSTR ThisPair;
         LPTSTR ThisVar;
-        LPTSTR ThisValue;
 
-        ThisPair = Env.StartOfString;
-        while (*ThisPair != '\0') {
-            ThisVar = ThisPair;
-            ThisPair += _tcslen(ThisPair) + 1;
+        if (YoriLibAllocateString(&Section, Env.LengthInChars + 2)) {
+            ThisPair = Env.StartOfString;
+            while (*ThisPair != '\0') {
+                ThisVar = ThisPair;
+                ThisPair += _tcslen(ThisPair) + 1;
 
-            if (ThisVar[0] != '=') {
-                ThisValue = _tcschr(ThisVar, '=');
-                if (ThisValue) {
-                    ThisValue[0] = '\0';
-                    ThisValue++;
-
-                    DllKernel32.pWritePrivateProfileStringW(_T("Environment"), ThisVar, ThisValue, RestartFileName.StartOfString);
-
-                    ThisValue--;
-                    ThisValue[0] = '=';
+                if (ThisVar[0] != '=' && _tcschr(ThisVar, '=') != NULL) {
+                    Section.LengthInChars += YoriLibSPrintf(Section.StartOfString + Section.LengthInChars, _T("%s"), ThisVar) + 1;
                 }
             }
-        }
-
-        //
-        //  With the "regular" environment done, go through and write a new
-        //  section for current directories on alternate drives.  These are
-        //  part of the environment but inexpressible in the INI format as
-        //  regular entries, so they get their own section.
-        //
-
-        ThisPair = Env.StartOfString;
-        while (*ThisPair != '\0') {
-            ThisVar = ThisPair;
-            ThisPair += _tcslen(ThisPair) + 1;
+            Section.StartOfString[Section.LengthInChars] = '\0';
+            YoriLibIniSetSection(IniDocument, _T("Environment"), Section.StartOfString);
 
-            if (ThisVar[0] == '=' &&
-                ((ThisVar[1] >= 'A' && ThisVar[1] <= 'Z') ||
-                 (ThisVar[1] >= 'a' && ThisVar[1] <= 'z')) &&
-                ThisVar[2] == ':' &&
-                ThisVar[3] == '=') {
+            //
+            //  With the "regular" environment done, go through and write a
+            //  new section for current directories on alternate drives.
+            //  These are part of the environment but inexpressible in the
+            //  INI format as regular entries, so they get their own section.
+            //
 
-                ThisValue = &ThisVar[3];
-                ThisVar++;
-                ThisValue[0] = '\0';
-                ThisValue++;
+            Section.LengthInChars = 0;
+            ThisPair = Env.StartOfString;
+            while (*ThisPair != '\0') {
+                ThisVar = ThisPair;
+                ThisPair += _tcslen(ThisPair) + 1;
 
-                DllKernel32.pWritePrivateProfileStringW(_T("CurrentDirectories"), ThisVar, ThisValue, RestartFileName.StartOfString);
+                if (ThisVar[0] == '=' &&
+                    ((ThisVar[1] >= 'A' && ThisVar[1] <= 'Z') ||
+                     (ThisVar[1] >= 'a' && ThisVar[1] <= 'z')) &&
+                    ThisVar[2] == ':' &&
+                    ThisVar[3] == '=') {
 
-                ThisValue--;
-                ThisValue[0] = '=';
+                    Section.LengthInChars += YoriLibSPrintf(Section.StartOfString + Section.LengthInChars, _T("%s"), &ThisVar[1]) + 1;
+                }
             }
+            Section.StartOfString[Section.LengthInChars] = '\0';
+            YoriLibIniSetSection(IniDocument, _T("CurrentDirectories"), Section.StartOfString);
+
+            YoriLibFreeStringContents(&Section);
         }
 
         YoriLibFreeStringContents(&Env);
@@ -481,21 +492,19 @@ YoriShSaveRestartStateWorker(
     if (YoriShGetAliasStrings(YORI_SH_GET_ALIAS_STRINGS_INCLUDE_USER, &Env)) {
         LPTSTR ThisPair;
         LPTSTR ThisVar;
-        LPTSTR ThisValue;
 
-        ThisPair = Env.StartOfString;
-        while (*ThisPair != '\0') {
-            ThisVar = ThisPair;
-            ThisPair += _tcslen(ThisPair) + 1;
-            if (ThisVar[0] != '=') {
-                ThisValue = _tcschr(ThisVar, '=');
-                if (ThisValue) {
-                    ThisValue[0] = '\0';
-                    ThisValue++;
-
-                    DllKernel32.pWritePrivateProfileStringW(_T("Aliases"), ThisVar, ThisValue, RestartFileName.StartOfString);
+        if (YoriLibAllocateString(&Section, Env.LengthInChars + 2)) {
+            ThisPair = Env.StartOfString;
+            while (*ThisPair != '\0') {
+                ThisVar = ThisPair;
+                ThisPair += _tcslen(ThisPair) + 1;
+                if (ThisVar[0] != '=' && _tcschr(ThisVar, '=') != NULL) {
+                    Section.LengthInChars += YoriLibSPrintf(Section.StartOfString + Section.LengthInChars, _T("%s"), ThisVar) + 1;
                 }
             }
+            Section.StartOfString[Section.LengthInChars] = '\0';
+            YoriLibIniSetSection(IniDocument, _T("Aliases"), Section.StartOfString);
+            YoriLibFreeStringContents(&Section);
         }
 
         YoriLibFreeStringContents(&Env);
@@ -509,15 +518,30 @@ YoriShSaveRestartStateWorker(
     if (YoriShGetHistoryStrings(100, &Env)) {
         LPTSTR ThisValue;
 
+        //
+        //  Count the entries to determine the space needed for keys.
+        //
+
+        Count = 0;
         ThisValue = Env.StartOfString;
-        Count = 1;
         while (*ThisValue != '\0') {
-            YoriLibSPrintf(WriteBuffer.StartOfString, _T("%03i"), Count);
-            DllKernel32.pWritePrivateProfileStringW(_T("History"), WriteBuffer.StartOfString, ThisValue, RestartFileName.StartOfString);
             ThisValue += _tcslen(ThisValue) + 1;
             Count++;
         }
 
+        if (YoriLibAllocateString(&Section, Env.LengthInChars + Count * (sizeof("4294967295=") - 1) + 2)) {
+            ThisValue = Env.StartOfString;
+            Count = 1;
+            while (*ThisValue != '\0') {
+                Section.LengthInChars += YoriLibSPrintf(Section.StartOfString + Section.LengthInChars, _T("%03i=%s"), Count, ThisValue) + 1;
+                ThisValue += _tcslen(ThisValue) + 1;
+                Count++;
+            }
+            Section.StartOfString[Section.LengthInChars] = '\0';
+            YoriLibIniSetSection(IniDocument, _T("History"), Section.StartOfString);
+            YoriLibFreeStringContents(&Section);
+        }
+
         YoriLibFreeStringContents(&Env);
     }
 
@@ -529,11 +553,15 @@ YoriShSaveRestartStateWorker(
 
         HANDLE hBufferFile;
 
+        //
+        //  The buffer file has the same name as the INI file with a
+        //  different extension.
+        //
+
         memcpy(RestartBufferFileName.StartOfString, RestartFileName.StartOfString, RestartFileName.LengthInChars * sizeof(TCHAR));
         RestartBufferFileName.LengthInChars = RestartFileName.LengthInChars;
-        YoriLibSPrintf(RestartBufferFileName.StartOfString + RestartBufferFileName.LengthInChars,
-                       _T("\\yori-restart-%x.txt"),
-                       GetCurrentProcessId());
+        YoriLibSPrintf(RestartBufferFileName.StartOfString + RestartBufferFileName.LengthInChars - sizeof("ini") + 1,
+                       _T("txt"));
 
         hBufferFile = CreateFile(RestartBufferFileName.StartOfString,
                                  GENERIC_WRITE,
@@ -545,13 +573,15 @@ YoriShSaveRestartStateWorker(
 
         if (hBufferFile != INVALID_HANDLE_VALUE) {
             YoriLibRewriteConsoleContents(hBufferFile, LineCount, 0);
-            DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("Contents"), RestartBufferFileName.StartOfString, RestartFileName.StartOfString);
+            YoriLibIniSetString(IniDocument, _T("Window"), _T("Contents"), RestartBufferFileName.StartOfString);
             CloseHandle(hBufferFile);
         }
 
         YoriLibFreeStringContents(&RestartBufferFileName);
     }
 
+    YoriLibIniSave(IniDocument);
+
     //
     //  Register the process to be restarted on failure
     //
@@ -640,15 +670,13 @@ YoriShLoadSavedRestartState(
     HWND ConsoleWindow;
     INT WindowLeft;
     INT WindowTop;
+    PYORI_LIB_INI_DOCUMENT IniDocument;
 
     YoriLibLoadUser32Functions();
 
     if (DllKernel32.pSetConsoleScreenBufferInfoEx == NULL ||
         DllKernel32.pSetCurrentConsoleFontEx == NULL ||
         DllKernel32.pGetConsoleWindow == NULL ||
-        DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileSectionW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
         DllUser32.pGetWindowRect == NULL ||
         DllUser32.pSetWindowPos == NULL) {
 
@@ -662,26 +690,34 @@ YoriShLoadSavedRestartState(
     ZeroMemory(&ScreenBufferInfo, sizeof(ScreenBufferInfo));
     ScreenBufferInfo.cbSize = sizeof(ScreenBufferInfo);
 
-    YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
-                   _T("\\yori-restart-%y.ini"),
-                   ProcessId);
+    RestartFileName.LengthInChars = RestartFileName.LengthInChars +
+        YoriLibSPrintf(RestartFileName.StartOfString + RestartFileName.LengthInChars,
+                       _T("\\yori-restart-%y.ini"),
+                       ProcessId);
+
+    if (!YoriLibIniLoad(&RestartFileName, &IniDocument)) {
+        YoriLibFreeStringContents(&RestartFileName);
+        return FALSE;
+    }
 
     //
     //  Read and populate window settings
     //
 
-    ScreenBufferInfo.dwSize.X = (USHORT)DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("BufferWidth"), 0, RestartFileName.StartOfString);
-    ScreenBufferInfo.dwSize.Y = (USHORT)DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("BufferHeight"), 0, RestartFileName.StartOfString);
+    ScreenBufferInfo.dwSize.X = (USHORT)YoriLibIniGetInt(IniDocument, _T("Window"), _T("BufferWidth"), 0);
+    ScreenBufferInfo.dwSize.Y = (USHORT)YoriLibIniGetInt(IniDocument, _T("Window"), _T("BufferHeight"), 0);
 
     if (ScreenBufferInfo.dwSize.X == 0 || ScreenBufferInfo.dwSize.Y == 0) {
+        YoriLibIniFree(IniDocument);
         YoriLibFreeStringContents(&RestartFileName);
         return FALSE;
     }
 
-    ScreenBufferInfo.dwMaximumWindowSize.X = (USHORT)DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("WindowWidth"), 0, RestartFileName.StartOfString);
-    ScreenBufferInfo.dwMaximumWindowSize.Y = (USHORT)DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("WindowHeight"), 0, RestartFileName.StartOfString);
+    ScreenBufferInfo.dwMaximumWindowSize.X = (USHORT)YoriLibIniGetInt(IniDocument, _T("Window"), _T("WindowWidth"), 0);
+    ScreenBufferInfo.dwMaximumWindowSize.Y = (USHORT)YoriLibIniGetInt(IniDocument, _T("Window"), _T("WindowHeight"), 0);
 
     if (ScreenBufferInfo.dwMaximumWindowSize.X == 0 || ScreenBufferInfo.dwMaximumWindowSize.Y == 0) {
+        YoriLibIniFree(IniDocument);
         YoriLibFreeStringContents(&RestartFileName);
         return FALSE;
     }
@@ -689,13 +725,13 @@ YoriShLoadSavedRestartState(
     ScreenBufferInfo.srWindow.Bottom = (USHORT)(ScreenBufferInfo.dwMaximumWindowSize.Y);
     ScreenBufferInfo.srWindow.Right = (USHORT)(ScreenBufferInfo.dwMaximumWindowSize.X);
 
-    ScreenBufferInfo.wAttributes = (USHORT)DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("DefaultColor"), 0, RestartFileName.StartOfString);
-    ScreenBufferInfo.wPopupAttributes = (USHORT)DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("PopupColor"), 0, RestartFileName.StartOfString);
+    ScreenBufferInfo.wAttributes = (USHORT)YoriLibIniGetInt(IniDocument, _T("Window"), _T("DefaultColor"), 0);
+    ScreenBufferInfo.wPopupAttributes = (USHORT)YoriLibIniGetInt(IniDocument, _T("Window"), _T("PopupColor"), 0);
 
     for (Count = 0; Count < sizeof(ScreenBufferInfo.ColorTable)/sizeof(ScreenBufferInfo.ColorTable[0]); Count++) {
         TCHAR ColorName[32];
         YoriLibSPrintf(ColorName, _T("Color%i"), Count);
-        ScreenBufferInfo.ColorTable[Count] = DllKernel32.pGetPrivateProfileIntW(_T("Window"), ColorName, 0, RestartFileName.StartOfString);
+        ScreenBufferInfo.ColorTable[Count] = YoriLibIniGetInt(IniDocument, _T("Window"), ColorName, 0);
     }
 
     YoriLibVtSetDefaultColor(ScreenBufferInfo.wAttributes);
@@ -706,6 +742,7 @@ YoriShLoadSavedRestartState(
     //
 
     if (!YoriLibAllocateString(&ReadBuffer, 64 * 1024)) {
+        YoriLibIniFree(IniDocument);
         YoriLibFreeStringContents(&RestartFileName);
         return FALSE;
     }
@@ -716,17 +753,17 @@ YoriShLoadSavedRestartState(
 
     ZeroMemory(&FontInfo, sizeof(FontInfo));
     FontInfo.cbSize = sizeof(FontInfo);
-    FontInfo.nFont = DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("FontIndex"), 0, RestartFileName.StartOfString);
-    FontInfo.dwFontSize.X = (USHORT)DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("FontWidth"), 0, RestartFileName.StartOfString);
-    FontInfo.dwFontSize.Y = (USHORT)DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("FontHeight"), 0, RestartFileName.StartOfString);
-    FontInfo.FontFamily = DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("FontFamily"), 0, RestartFileName.StartOfString);
-    FontInfo.FontWeight = DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("FontWeight"), 0, RestartFileName.StartOfString);
-    DllKernel32.pGetPrivateProfileStringW(_T("Window"),
-                                          _T("FontName"),
-                                          _T(""),
-                                          FontInfo.FaceName,
-                                          sizeof(FontInfo.FaceName)/sizeof(FontInfo.FaceName[0]),
-                                          RestartFileName.StartOfString);
+    FontInfo.nFont = YoriLibIniGetInt(IniDocument, _T("Window"), _T("FontIndex"), 0);
+    FontInfo.dwFontSize.X = (USHORT)YoriLibIniGetInt(IniDocument, _T("Window"), _T("FontWidth"), 0);
+    FontInfo.dwFontSize.Y = (USHORT)YoriLibIniGetInt(IniDocument, _T("Window"), _T("FontHeight"), 0);
+    FontInfo.FontFamily = YoriLibIniGetInt(IniDocument, _T("Window"), _T("FontFamily"), 0);
+    FontInfo.FontWeight = YoriLibIniGetInt(IniDocument, _T("Window"), _T("FontWeight"), 0);
+    YoriLibIniGetString(IniDocument,
+                        _T("Window"),
+                        _T("FontName"),
+                        _T(""),
+                        FontInfo.FaceName,
+                        sizeof(FontInfo.FaceName)/sizeof(FontInfo.FaceName[0]));
 
     if (FontInfo.dwFontSize.X > 0 && FontInfo.dwFontSize.Y > 0 && FontInfo.FontWeight > 0) {
         DllKernel32.pSetCurrentConsoleFontEx(GetStdHandle(STD_OUTPUT_HANDLE), FALSE, &FontInfo);
@@ -739,8 +776,8 @@ YoriShLoadSavedRestartState(
     //
 
     ConsoleWindow = DllKernel32.pGetConsoleWindow();
-    WindowLeft = DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("WindowLeft"), INT_MAX, RestartFileName.StartOfString);
-    WindowTop = DllKernel32.pGetPrivateProfileIntW(_T("Window"), _T("WindowTop"), INT_MAX, RestartFileName.StartOfString);
+    WindowLeft = YoriLibIniGetInt(IniDocument, _T("Window"), _T("WindowLeft"), INT_MAX);
+    WindowTop = YoriLibIniGetInt(IniDocument, _T("Window"), _T("WindowTop"), INT_MAX);
 
     if (WindowLeft != INT_MAX &&
         WindowTop != INT_MAX) {
@@ -752,24 +789,24 @@ YoriShLoadSavedRestartState(
     //  Read and populate the window title
     //
 
-    DllKernel32.pGetPrivateProfileStringW(_T("Window"),
-                                          _T("Title"),
-                                          _T("Yori"),
-                                          ReadBuffer.StartOfString,
-                                          ReadBuffer.LengthAllocated,
-                                          RestartFileName.StartOfString);
+    YoriLibIniGetString(IniDocument,
+                        _T("Window"),
+                        _T("Title"),
+                        _T("Yori"),
+                        ReadBuffer.StartOfString,
+                        ReadBuffer.LengthAllocated);
     SetConsoleTitle(ReadBuffer.StartOfString);
 
     //
     //  Read and populate the current directory
     //
 
-    ReadBuffer.LengthInChars = DllKernel32.pGetPrivateProfileStringW(_T("Window"),
-                                                                     _T("CurrentDirectory"),
-                                                                     _T(""),
-                                                                     ReadBuffer.StartOfString,
-                                                                     ReadBuffer.LengthAllocated,
-                                                                     RestartFileName.StartOfString);
+    ReadBuffer.LengthInChars = YoriLibIniGetString(IniDocument,
+                                                   _T("Window"),
+                                                   _T("CurrentDirectory"),
+                                                   _T(""),
+                                                   ReadBuffer.StartOfString,
+                                                   ReadBuffer.LengthAllocated);
     if (ReadBuffer.LengthInChars > 0) {
         YoriLibSetCurrentDirectory(&ReadBuffer);
     }
@@ -779,10 +816,10 @@ YoriShLoadSavedRestartState(
     //
 
     ReadBuffer.LengthInChars =
-        DllKernel32.pGetPrivateProfileSectionW(_T("Environment"),
-                                               ReadBuffer.StartOfString,
-                                               ReadBuffer.LengthAllocated,
-                                               RestartFileName.StartOfString);
+        YoriLibIniGetSection(IniDocument,
+                             _T("Environment"),
+                             ReadBuffer.StartOfString,
+                             ReadBuffer.LengthAllocated);
 
     if (ReadBuffer.LengthInChars > 0) {
         LPTSTR ThisPair;
@@ -810,10 +847,10 @@ YoriShLoadSavedRestartState(
     //
 
     ReadBuffer.LengthInChars =
-        DllKernel32.pGetPrivateProfileSectionW(_T("CurrentDirectories"),
-                                               ReadBuffer.StartOfString,
-                                               ReadBuffer.LengthAllocated,
-                                               RestartFileName.StartOfString);
+        YoriLibIniGetSection(IniDocument,
+                             _T("CurrentDirectories"),
+                             ReadBuffer.StartOfString,
+                             ReadBuffer.LengthAllocated);
 
     if (ReadBuffer.LengthInChars > 0) {
         LPTSTR ThisPair;
@@ -847,10 +884,10 @@ YoriShLoadSavedRestartState(
     //
 
     ReadBuffer.LengthInChars =
-        DllKernel32.pGetPrivateProfileSectionW(_T("Aliases"),
-                                               ReadBuffer.StartOfString,
-                                               ReadBuffer.LengthAllocated,
-                                               RestartFileName.StartOfString);
+        YoriLibIniGetSection(IniDocument,
+                             _T("Aliases"),
+                             ReadBuffer.StartOfString,
+                             ReadBuffer.LengthAllocated);
 
     if (ReadBuffer.LengthInChars > 0) {
         LPTSTR ThisPair;
@@ -878,10 +915,10 @@ YoriShLoadSavedRestartState(
     //
 
     ReadBuffer.LengthInChars =
-        DllKernel32.pGetPrivateProfileSectionW(_T("History"),
-                                               ReadBuffer.StartOfString,
-                                               ReadBuffer.LengthAllocated,
-                                               RestartFileName.StartOfString);
+        YoriLibIniGetSection(IniDocument,
+                             _T("History"),
+                             ReadBuffer.StartOfString,
+                             ReadBuffer.LengthAllocated);
 
     if (ReadBuffer.LengthInChars > 0) {
         LPTSTR ThisPair;
@@ -921,12 +958,12 @@ YoriShLoadSavedRestartState(
     //
 
     ReadBuffer.LengthInChars =
-        DllKernel32.pGetPrivateProfileStringW(_T("Window"),
-                                              _T("Contents"),
-                                              _T(""),
-                                              ReadBuffer.StartOfString,
-                                              ReadBuffer.LengthAllocated,
-                                              RestartFileName.StartOfString);
+        YoriLibIniGetString(IniDocument,
+                            _T("Window"),
+                            _T("Contents"),
+                            _T(""),
+                            ReadBuffer.StartOfString,
+                            ReadBuffer.LengthAllocated);
 
     if (ReadBuffer.LengthInChars > 0) {
         HANDLE hBufferFile;
@@ -956,6 +993,7 @@ YoriShLoadSavedRestartState(
         }
     }
 
+    YoriLibIniFree(IniDocument);
     YoriLibFreeStringContents(&ReadBuffer);
     YoriLibFreeStringContents(&RestartFileName);
 
@@ -988,6 +1026,11 @@ YoriShDiscardSavedRestartState(
         YoriShGlobal.RestartSaveThread = NULL;
     }
 
+    if (ProcessId == NULL && YoriShGlobal.RestartState != NULL) {
+        YoriLibIniFree(YoriShGlobal.RestartState);
+        YoriShGlobal.RestartState = NULL;
+    }
+
     if (!YoriLibGetTempPath(&RestartFileName, sizeof("\\yori-restart-.ini") + 2 * sizeof(DWORD))) {
         return;
     }
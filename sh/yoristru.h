@@ -491,6 +491,14 @@ typedef struct _YORI_SH_GLOBALS {
      */
     HANDLE RestartSaveThread;
 
+    /**
+     The document describing restart state, which is retained across saves
+     so that the file is only rewritten when the state has changed.  This is
+     only accessed by the restart save thread, or after that thread has
+     completed.
+     */
+    PYORI_LIB_INI_DOCUMENT RestartState;
+
     /**
      List of command history.
      */
@@ -3,7 +3,7 @@
  *
  * Yori shell split a file into pieces
  *
- * Copyright (c) 2018-2019 Malcolm J. Smith
+ * Copyright (c) 2018-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -56,99 +56,847 @@ SplitHelp(VOID)
     return TRUE;
 }
 
+/**
+ The size of each buffer used to transfer data.  Memory use is bounded by
+ this multiplied by the number of threads, regardless of the size of each
+ part.
+ */
+#define SPLIT_BUFFER_SIZE (1024 * 1024)
+
+/**
+ The maximum number of parts to copy concurrently.  Copying is bound by the
+ device rather than the processor, so a small number of requests in flight
+ is sufficient.
+ */
+#define SPLIT_MAX_THREADS (4)
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
-typedef struct _SPLIT_CONTEXT {
+typedef struct _SPLIT_CONTEXT {
+
+    /**
+     If TRUE, the contents should be split into portions based on a determined
+     number of lines.  If FALSE, the contents should be split into portions
+     based on the number of bytes.
+     */
+    BOOL LinesMode;
+
+    /**
+     If LinesMode is FALSE, specifies the number of bytes per part.
+     */
+    LONGLONG BytesPerPart;
+
+    /**
+     If LinesMode is TRUE, specifies the number of lines per part.
+     */
+    LONGLONG LinesPerPart;
+
+    /**
+     Indicates the next part to open.
+     */
+    LONGLONG CurrentPartNumber;
+
+    /**
+     A string containing the prefix of newly created split fragments. The
+     fragment number is appended to this prefix.
+     */
+    YORI_STRING Prefix;
+
+} SPLIT_CONTEXT, *PSPLIT_CONTEXT;
+
+/**
+ A single range of bytes to copy from one file to another.
+ */
+typedef struct _SPLIT_COPY_JOB {
+
+    /**
+     The name of the file to read from.
+     */
+    YORI_STRING SourceName;
+
+    /**
+     The name of the file to write to.
+     */
+    YORI_STRING TargetName;
+
+    /**
+     The offset within the source file to read from.
+     */
+    LONGLONG SourceOffset;
+
+    /**
+     The offset within the target file to write to.
+     */
+    LONGLONG TargetOffset;
+
+    /**
+     The number of bytes to copy.
+     */
+    LONGLONG Length;
+
+    /**
+     If TRUE, the target file is created by this job and is sized to Length
+     before writing.  If FALSE, the target file has already been created and
+     sized, and other jobs may be writing to other ranges of it.
+     */
+    BOOLEAN CreateTarget;
+
+} SPLIT_COPY_JOB, *PSPLIT_COPY_JOB;
+
+/**
+ A set of ranges to copy, which are processed concurrently by several
+ threads.
+ */
+typedef struct _SPLIT_COPY_CONTEXT {
+
+    /**
+     An array of ranges to copy.  If NULL, each range is a part of
+     SplitSource, which is determined from its index when a thread takes it,
+     so memory use does not depend on the number of parts.
+     */
+    PSPLIT_COPY_JOB Jobs;
+
+    /**
+     The number of ranges to copy.
+     */
+    DWORD JobCount;
+
+    /**
+     If Jobs is NULL, the full path to the file being split.
+     */
+    PYORI_STRING SplitSource;
+
+    /**
+     If Jobs is NULL, the prefix of part files.
+     */
+    PYORI_STRING SplitPrefix;
+
+    /**
+     If Jobs is NULL, the number of the part generated from the first range.
+     */
+    LONGLONG FirstPartNumber;
+
+    /**
+     If Jobs is NULL, the number of bytes in each part other than the final
+     one.
+     */
+    LONGLONG BytesPerPart;
+
+    /**
+     If Jobs is NULL, the number of bytes in SplitSource.
+     */
+    LONGLONG SourceLength;
+
+    /**
+     The index of the next job for a thread to process.  This is
+     incremented atomically as each thread takes a job.
+     */
+    LONG NextJob;
+
+    /**
+     Set to TRUE if any job failed.
+     */
+    BOOLEAN Failed;
+
+} SPLIT_COPY_CONTEXT, *PSPLIT_COPY_CONTEXT;
+
+/**
+ Allocate a buffer for transferring data.  The buffer is page aligned, so
+ transfers are not split across pages unnecessarily.
+
+ @return Pointer to the buffer, or NULL on failure.  The buffer should be
+         freed with @ref SplitFreeBuffer .
+ */
+PUCHAR
+SplitAllocateBuffer(VOID)
+{
+    return VirtualAlloc(NULL, SPLIT_BUFFER_SIZE, MEM_COMMIT, PAGE_READWRITE);
+}
+
+/**
+ Free a buffer allocated with @ref SplitAllocateBuffer .
+
+ @param Buffer Pointer to the buffer to free.
+ */
+VOID
+SplitFreeBuffer(
+    __in PUCHAR Buffer
+    )
+{
+    VirtualFree(Buffer, 0, MEM_RELEASE);
+}
+
+/**
+ Generate the file name for a single part.
+
+ @param Prefix Pointer to the prefix of part files.
+
+ @param PartNumber The number of the part.
+
+ @param PartName On successful completion, populated with a newly allocated
+        string containing the name of the part.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+SplitBuildPartName(
+    __in PYORI_STRING Prefix,
+    __in LONGLONG PartNumber,
+    __out PYORI_STRING PartName
+    )
+{
+    YORI_STRING NumberString;
+
+    YoriLibInitEmptyString(&NumberString);
+    if (!YoriLibNumberToString(&NumberString, PartNumber, 10, 0, '\0')) {
+        return FALSE;
+    }
+
+    if (!YoriLibAllocateString(PartName, Prefix->LengthInChars + NumberString.LengthInChars + 1)) {
+        YoriLibFreeStringContents(&NumberString);
+        return FALSE;
+    }
+
+    PartName->LengthInChars = YoriLibSPrintf(PartName->StartOfString, _T("%y%y"), Prefix, &NumberString);
+    YoriLibFreeStringContents(&NumberString);
+    return TRUE;
+}
+
+/**
+ Set the current position of a file.
+
+ @param hFile Handle to the file.
+
+ @param Offset The new position.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SplitSeek(
+    __in HANDLE hFile,
+    __in LONGLONG Offset
+    )
+{
+    LARGE_INTEGER liOffset;
+
+    liOffset.QuadPart = Offset;
+    liOffset.LowPart = SetFilePointer(hFile, liOffset.LowPart, &liOffset.HighPart, FILE_BEGIN);
+    if (liOffset.LowPart == (DWORD)-1 && GetLastError() != NO_ERROR) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Copy a single range of bytes from one file to another.
+
+ @param Job Pointer to the range to copy.
+
+ @param Buffer Pointer to a buffer of SPLIT_BUFFER_SIZE bytes to use for the
+        transfer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SplitCopyRange(
+    __in PSPLIT_COPY_JOB Job,
+    __in PUCHAR Buffer
+    )
+{
+    HANDLE SourceHandle;
+    HANDLE TargetHandle;
+    LONGLONG Remaining;
+    DWORD BytesToRead;
+    DWORD BytesRead;
+    DWORD BytesWritten;
+    DWORD LastError;
+    LPTSTR ErrText;
+    BOOL Result;
+
+    SourceHandle = CreateFile(Job->SourceName.StartOfString,
+                              GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_SEQUENTIAL_SCAN,
+                              NULL);
+
+    if (SourceHandle == INVALID_HANDLE_VALUE) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: open of %y failed: %s"), &Job->SourceName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return FALSE;
+    }
+
+    TargetHandle = CreateFile(Job->TargetName.StartOfString,
+                              GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL,
+                              Job->CreateTarget?CREATE_ALWAYS:OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                              NULL);
+
+    if (TargetHandle == INVALID_HANDLE_VALUE) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: open of %y failed: %s"), &Job->TargetName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        CloseHandle(SourceHandle);
+        return FALSE;
+    }
+
+    //
+    //  Allocate the whole part up front, so the file system can find
+    //  contiguous space and any lack of space is found before copying.
+    //
+
+    Result = TRUE;
+    if (Job->CreateTarget) {
+        if (!SplitSeek(TargetHandle, Job->Length) ||
+            !SetEndOfFile(TargetHandle)) {
+
+            Result = FALSE;
+        }
+    }
+
+    if (Result) {
+        if (!SplitSeek(TargetHandle, Job->TargetOffset) ||
+            !SplitSeek(SourceHandle, Job->SourceOffset)) {
+
+            Result = FALSE;
+        }
+    }
+
+    if (!Result) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: could not prepare %y: %s"), &Job->TargetName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+    }
+
+    Remaining = Job->Length;
+    while (Result && Remaining > 0) {
+        BytesToRead = SPLIT_BUFFER_SIZE;
+        if ((LONGLONG)BytesToRead > Remaining) {
+            BytesToRead = (DWORD)Remaining;
+        }
+
+        if (!ReadFile(SourceHandle, Buffer, BytesToRead, &BytesRead, NULL)) {
+            LastError = GetLastError();
+            ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: read of %y failed: %s"), &Job->SourceName, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            Result = FALSE;
+            break;
+        }
+
+        if (BytesRead == 0) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: %y changed size while being read\n"), &Job->SourceName);
+            Result = FALSE;
+            break;
+        }
+
+        if (!WriteFile(TargetHandle, Buffer, BytesRead, &BytesWritten, NULL) ||
+            BytesWritten != BytesRead) {
+
+            LastError = GetLastError();
+            ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: write to %y failed: %s"), &Job->TargetName, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            Result = FALSE;
+            break;
+        }
+
+        Remaining = Remaining - BytesRead;
+    }
+
+    CloseHandle(TargetHandle);
+    CloseHandle(SourceHandle);
+    return Result;
+}
+
+/**
+ Describe the range of a file being split which forms a single part.
+
+ @param CopyContext Pointer to the copy context describing the file being
+        split.
+
+ @param Index The index of the part within this split operation.
+
+ @param Job On successful completion, populated with the range to copy.  The
+        source name refers to the string in CopyContext, and the target name
+        is newly allocated and should be freed by the caller.
+
+ @return TRUE to indicate success, FALSE to indicate allocation failure.
+ */
+__success(return)
+BOOL
+SplitBuildPartJob(
+    __in PSPLIT_COPY_CONTEXT CopyContext,
+    __in DWORD Index,
+    __out PSPLIT_COPY_JOB Job
+    )
+{
+    ZeroMemory(Job, sizeof(SPLIT_COPY_JOB));
+    if (!SplitBuildPartName(CopyContext->SplitPrefix, CopyContext->FirstPartNumber + Index, &Job->TargetName)) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&Job->SourceName);
+    Job->SourceName.StartOfString = CopyContext->SplitSource->StartOfString;
+    Job->SourceName.LengthInChars = CopyContext->SplitSource->LengthInChars;
+
+    Job->SourceOffset = Index * CopyContext->BytesPerPart;
+    Job->TargetOffset = 0;
+    Job->Length = CopyContext->BytesPerPart;
+    if (Job->SourceOffset + Job->Length > CopyContext->SourceLength) {
+        Job->Length = CopyContext->SourceLength - Job->SourceOffset;
+    }
+    Job->CreateTarget = TRUE;
+    return TRUE;
+}
+
+/**
+ A thread which copies ranges until no ranges remain to be copied.
+
+ @param Context Pointer to the copy context.
+
+ @return TRUE to indicate all ranges copied by this thread succeeded, FALSE
+         to indicate one or more failed.
+ */
+DWORD WINAPI
+SplitCopyWorker(
+    __in LPVOID Context
+    )
+{
+    PSPLIT_COPY_CONTEXT CopyContext = (PSPLIT_COPY_CONTEXT)Context;
+    SPLIT_COPY_JOB PartJob;
+    PSPLIT_COPY_JOB Job;
+    PUCHAR Buffer;
+    DWORD JobIndex;
+    BOOL Result = TRUE;
+
+    Buffer = SplitAllocateBuffer();
+    if (Buffer == NULL) {
+        return FALSE;
+    }
+
+    while (TRUE) {
+        JobIndex = (DWORD)(InterlockedIncrement(&CopyContext->NextJob) - 1);
+        if (JobIndex >= CopyContext->JobCount) {
+            break;
+        }
+
+        if (CopyContext->Jobs != NULL) {
+            Job = &CopyContext->Jobs[JobIndex];
+        } else {
+            if (!SplitBuildPartJob(CopyContext, JobIndex, &PartJob)) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: out of memory\n"));
+                CopyContext->Failed = TRUE;
+                Result = FALSE;
+                continue;
+            }
+            Job = &PartJob;
+        }
+
+        if (!SplitCopyRange(Job, Buffer)) {
+            CopyContext->Failed = TRUE;
+            Result = FALSE;
+        }
+
+        if (Job == &PartJob) {
+            YoriLibFreeStringContents(&PartJob.TargetName);
+        }
+    }
+
+    SplitFreeBuffer(Buffer);
+    return Result;
+}
+
+/**
+ Copy a set of ranges, using several threads so that reads and writes for
+ different ranges are in flight at the same time.
+
+ @param CopyContext Pointer to the set of ranges to copy.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SplitCopyRanges(
+    __in PSPLIT_COPY_CONTEXT CopyContext
+    )
+{
+    HANDLE Threads[SPLIT_MAX_THREADS];
+    SYSTEM_INFO SystemInfo;
+    DWORD ThreadCount;
+    DWORD MaxThreads;
+    DWORD ThreadId;
+    DWORD Index;
+
+    GetSystemInfo(&SystemInfo);
+    MaxThreads = SystemInfo.dwNumberOfProcessors;
+    if (MaxThreads < 2) {
+        MaxThreads = 2;
+    }
+    if (MaxThreads > SPLIT_MAX_THREADS) {
+        MaxThreads = SPLIT_MAX_THREADS;
+    }
+    if (MaxThreads > CopyContext->JobCount) {
+        MaxThreads = CopyContext->JobCount;
+    }
+
+    CopyContext->NextJob = 0;
+    CopyContext->Failed = FALSE;
+
+    ThreadCount = 0;
+    for (Index = 0; Index < MaxThreads; Index++) {
+        Threads[ThreadCount] = CreateThread(NULL, 0, SplitCopyWorker, CopyContext, 0, &ThreadId);
+        if (Threads[ThreadCount] != NULL) {
+            ThreadCount++;
+        }
+    }
+
+    //
+    //  If no threads could be created, copy everything on this thread.
+    //  Note that if a thread could not allocate a buffer it terminates
+    //  without copying anything, so copy any remaining ranges here too.
+    //
+
+    if (ThreadCount > 0) {
+        WaitForMultipleObjects(ThreadCount, Threads, TRUE, INFINITE);
+        for (Index = 0; Index < ThreadCount; Index++) {
+            CloseHandle(Threads[Index]);
+        }
+    }
+
+    if (CopyContext->NextJob < (LONG)CopyContext->JobCount) {
+        if (!SplitCopyWorker(CopyContext)) {
+            CopyContext->Failed = TRUE;
+        }
+        if (CopyContext->NextJob < (LONG)CopyContext->JobCount) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: out of memory\n"));
+            CopyContext->Failed = TRUE;
+        }
+    }
+
+    if (CopyContext->Failed) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Free the file names allocated for a set of ranges, and the array of ranges.
+
+ @param Jobs Pointer to an array of ranges.
+
+ @param JobCount The number of elements in the array.
+ */
+VOID
+SplitFreeJobs(
+    __in PSPLIT_COPY_JOB Jobs,
+    __in DWORD JobCount
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < JobCount; Index++) {
+        YoriLibFreeStringContents(&Jobs[Index].SourceName);
+        YoriLibFreeStringContents(&Jobs[Index].TargetName);
+    }
+    YoriLibFree(Jobs);
+}
+
+/**
+ Open a file in which to output the result of a fragment of the split
+ operation.
+
+ @param SplitContext Pointer to a context describing the split operation
+        and its current state.
+
+ @return Handle to the opened object, or NULL on failure.
+ */
+HANDLE
+SplitOpenTargetForCurrentPart(
+    __in PSPLIT_CONTEXT SplitContext
+    )
+{
+    YORI_STRING NewFileName;
+    HANDLE hDestFile;
+
+    if (!SplitBuildPartName(&SplitContext->Prefix, SplitContext->CurrentPartNumber, &NewFileName)) {
+        return NULL;
+    }
+
+    hDestFile = CreateFile(NewFileName.StartOfString,
+                           GENERIC_WRITE,
+                           FILE_SHARE_READ|FILE_SHARE_DELETE,
+                           NULL,
+                           CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                           NULL);
+    if (hDestFile == INVALID_HANDLE_VALUE) {
+        DWORD LastError = GetLastError();
+        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: open of %y failed: %s"), &NewFileName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        YoriLibFreeStringContents(&NewFileName);
+        return NULL;
+    }
+    YoriLibFreeStringContents(&NewFileName);
+
+    return hDestFile;
+}
+
+/**
+ Write data to a part, displaying an error on failure.
+
+ @param hDestFile Handle to the part.
+
+ @param Buffer Pointer to the data to write.
+
+ @param Length The number of bytes to write.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SplitWritePart(
+    __in HANDLE hDestFile,
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD BytesWritten;
+
+    if (!WriteFile(hDestFile, Buffer, Length, &BytesWritten, NULL) ||
+        BytesWritten != Length) {
+
+        DWORD LastError = GetLastError();
+        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: write failed: %s"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Find the next carriage return or line feed character in a buffer of narrow
+ characters.  This compares a machine word at a time, so long lines are
+ skipped quickly.
+
+ @param Start Pointer to the first byte to search.
+
+ @param End Pointer to the byte after the final byte to search.
+
+ @return Pointer to the carriage return or line feed, or NULL if neither is
+         found.
+ */
+PUCHAR
+SplitFindLineEnd(
+    __in PUCHAR Start,
+    __in PUCHAR End
+    )
+{
+    DWORD_PTR LowBits;
+    DWORD_PTR HighBits;
+    DWORD_PTR LineFeeds;
+    DWORD_PTR CarriageReturns;
+    DWORD_PTR Word;
+    DWORD_PTR LineFeedWord;
+    DWORD_PTR CarriageReturnWord;
+
+    while (Start < End && ((DWORD_PTR)Start % sizeof(DWORD_PTR)) != 0) {
+        if (*Start == '\n' || *Start == '\r') {
+            return Start;
+        }
+        Start++;
+    }
+
+    //
+    //  After XORing with a word full of line feeds, any byte which was a
+    //  line feed is zero.  Subtracting one from each byte borrows into the
+    //  high bit of any byte which was zero, so this detects any line feed
+    //  within the word.  Carriage returns are detected the same way.
+    //
+
+    LowBits = ((DWORD_PTR)-1) / 0xFF;
+    HighBits = LowBits * 0x80;
+    LineFeeds = LowBits * '\n';
+    CarriageReturns = LowBits * '\r';
+
+    while ((DWORD_PTR)(End - Start) >= sizeof(DWORD_PTR)) {
+        Word = *(DWORD_PTR *)Start;
+        LineFeedWord = Word ^ LineFeeds;
+        CarriageReturnWord = Word ^ CarriageReturns;
+        if ((((LineFeedWord - LowBits) & ~LineFeedWord) |
+             ((CarriageReturnWord - LowBits) & ~CarriageReturnWord)) & HighBits) {
+            break;
+        }
+        Start += sizeof(DWORD_PTR);
+    }
+
+    while (Start < End) {
+        if (*Start == '\n' || *Start == '\r') {
+            return Start;
+        }
+        Start++;
+    }
+
+    return NULL;
+}
+
+/**
+ Find the next carriage return or line feed character in a buffer of UTF-16
+ characters.
+
+ @param Base Pointer to the beginning of the buffer.  This must be at an
+        even offset from the beginning of the stream.
+
+ @param Start Pointer to the first byte to search.
+
+ @param End Pointer to the byte after the final byte to search.
+
+ @return Pointer to the first byte of the carriage return or line feed, or
+         NULL if neither is found.
+ */
+PUCHAR
+SplitFindWideLineEnd(
+    __in PUCHAR Base,
+    __in PUCHAR Start,
+    __in PUCHAR End
+    )
+{
+    while (End - Start >= 2) {
+        Start = SplitFindLineEnd(Start, End - 1);
+        if (Start == NULL) {
+            return NULL;
+        }
 
-    /**
-     If TRUE, the contents should be split into portions based on a determined
-     number of lines.  If FALSE, the contents should be split into portions
-     based on the number of bytes.
-     */
-    BOOL LinesMode;
+        //
+        //  This can find the high byte of a character, or a character whose
+        //  high byte is nonzero.  Skip both.
+        //
 
-    /**
-     If LinesMode is FALSE, specifies the number of bytes per part.
-     */
-    LONGLONG BytesPerPart;
+        if (((Start - Base) % 2) == 0 && Start[1] == '\0') {
+            return Start;
+        }
+        Start++;
+    }
 
-    /**
-     If LinesMode is TRUE, specifies the number of lines per part.
-     */
-    LONGLONG LinesPerPart;
+    return NULL;
+}
 
-    /**
-     Indicates the next part to open.
-     */
-    LONGLONG CurrentPartNumber;
+/**
+ Return the end of a line terminator.  A carriage return followed by a line
+ feed is a single terminator; a carriage return or line feed alone is also a
+ terminator.
 
-    /**
-     A string containing the prefix of newly created split fragments. The
-     fragment number is appended to this prefix.
-     */
-    YORI_STRING Prefix;
+ @param Terminator Pointer to the first byte of a carriage return or line
+        feed character.
 
-} SPLIT_CONTEXT, *PSPLIT_CONTEXT;
+ @param End Pointer to the byte after the final byte in the buffer.
+
+ @param Wide TRUE if the buffer contains UTF-16 characters, FALSE if it
+        contains narrow characters.
+
+ @return Pointer to the byte following the line terminator.
+ */
+PUCHAR
+SplitSkipLineEnd(
+    __in PUCHAR Terminator,
+    __in PUCHAR End,
+    __in BOOLEAN Wide
+    )
+{
+    if (Wide) {
+        if (Terminator[0] == '\r' &&
+            End - Terminator >= 4 &&
+            Terminator[2] == '\n' &&
+            Terminator[3] == '\0') {
+
+            return Terminator + 4;
+        }
+        return Terminator + 2;
+    }
+
+    if (Terminator[0] == '\r' &&
+        End - Terminator >= 2 &&
+        Terminator[1] == '\n') {
+
+        return Terminator + 2;
+    }
+    return Terminator + 1;
+}
 
 /**
- Open a file in which to output the result of a fragment of the split
- operation.
+ The number of bytes at the beginning of a stream to examine when checking
+ whether it contains UTF-16 text without a byte order mark.
+ */
+#define SPLIT_UTF16_SAMPLE_SIZE (256)
 
- @param SplitContext Pointer to a context describing the split operation
-        and its current state.
+/**
+ Determine whether a stream contains UTF-16 text.  This is true if the input
+ encoding is UTF-16, if the stream begins with a UTF-16 byte order mark, or
+ if the beginning of the stream consists of nonzero characters whose high
+ byte is zero, which is how UTF-16 text without a byte order mark typically
+ appears.
 
- @return Handle to the opened object, or NULL on failure.
+ @param Buffer Pointer to the beginning of the stream.
+
+ @param Length The number of bytes in Buffer.
+
+ @return TRUE if the stream should be treated as UTF-16, FALSE if it should
+         be treated as narrow characters.
  */
-HANDLE
-SplitOpenTargetForCurrentPart(
-    __in PSPLIT_CONTEXT SplitContext
+BOOLEAN
+SplitIsStreamWide(
+    __in PUCHAR Buffer,
+    __in DWORD Length
     )
 {
-    LPTSTR NewFileName;
-    YORI_STRING NumberString;
-    HANDLE hDestFile;
+    DWORD Index;
 
-    YoriLibInitEmptyString(&NumberString);
-    if (!YoriLibNumberToString(&NumberString, SplitContext->CurrentPartNumber, 10, 0, '\0')) {
-        return NULL;
+    if (YoriLibGetMultibyteInputEncoding() == CP_UTF16) {
+        return TRUE;
     }
 
-    NewFileName = YoriLibMalloc((SplitContext->Prefix.LengthInChars + NumberString.LengthInChars + 1) * sizeof(TCHAR));
-    if (NewFileName == NULL) {
-        YoriLibFreeStringContents(&NumberString);
-        return NULL;
+    if (Length >= 2 && Buffer[0] == 0xFF && Buffer[1] == 0xFE) {
+        return TRUE;
     }
 
-    YoriLibSPrintf(NewFileName, _T("%y%y"), &SplitContext->Prefix, &NumberString);
-    YoriLibFreeStringContents(&NumberString);
+    if (Length > SPLIT_UTF16_SAMPLE_SIZE) {
+        Length = SPLIT_UTF16_SAMPLE_SIZE;
+    }
+    Length = Length & ~1;
 
-    hDestFile = CreateFile(NewFileName,
-                           GENERIC_WRITE,
-                           FILE_SHARE_READ|FILE_SHARE_DELETE,
-                           NULL,
-                           CREATE_ALWAYS,
-                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
-                           NULL);
-    if (hDestFile == INVALID_HANDLE_VALUE) {
-        DWORD LastError = GetLastError();
-        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: open of %s failed: %s"), NewFileName, ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        YoriLibFree(NewFileName);
-        return NULL;
+    if (Length < 4) {
+        return FALSE;
     }
-    YoriLibFree(NewFileName);
 
-    return hDestFile;
+    for (Index = 0; Index < Length; Index += 2) {
+        if (Buffer[Index] == '\0' || Buffer[Index + 1] != '\0') {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
 }
 
 /**
- Take a single incoming stream and break it into pieces.
+ Take a single incoming stream and break it into pieces.  Data is copied
+ without translation, so joining the pieces reproduces the original stream
+ exactly.
 
  @param hSource A handle to the incoming stream, which may be a file or a
         pipe.
- 
+
  @param SplitContext Pointer to a context describing the actions to perform.
 
  @return TRUE to indicate success, FALSE to indicate failure.
@@ -160,89 +908,261 @@ SplitProcessStream(
     )
 {
     HANDLE hDestFile = NULL;
+    PUCHAR Buffer;
+    PUCHAR Current;
+    PUCHAR End;
+    PUCHAR LineEnd;
+    DWORD BytesRead;
+    DWORD BytesValid;
+    DWORD BytesToRead;
+    DWORD CarryBytes;
+    LONGLONG PartRemaining;
+    LONGLONG LinesInPart;
+    BOOLEAN FirstRead;
+    BOOLEAN Wide;
+    BOOL Result;
+
+    Buffer = SplitAllocateBuffer();
+    if (Buffer == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: out of memory\n"));
+        return FALSE;
+    }
 
-    if (SplitContext->LinesMode) {
-        PVOID LineContext = NULL;
-        YORI_STRING LineString;
-        LONGLONG LineNumber;
+    Result = TRUE;
+    FirstRead = TRUE;
+    Wide = FALSE;
+    CarryBytes = 0;
+    LinesInPart = 0;
+    PartRemaining = SplitContext->BytesPerPart;
 
-        LineNumber = 0;
-        YoriLibInitEmptyString(&LineString);
-        while (TRUE) {
-            if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
-                break;
+    while (TRUE) {
+
+        //
+        //  In bytes mode, never read beyond the end of the current part,
+        //  so each read can be written to a single part.
+        //
+
+        BytesToRead = SPLIT_BUFFER_SIZE - CarryBytes;
+        if (!SplitContext->LinesMode && (LONGLONG)BytesToRead > PartRemaining) {
+            BytesToRead = (DWORD)PartRemaining;
+        }
+
+        if (!ReadFile(hSource, Buffer + CarryBytes, BytesToRead, &BytesRead, NULL)) {
+            BytesRead = 0;
+        }
+
+        BytesValid = CarryBytes + BytesRead;
+        CarryBytes = 0;
+        if (BytesValid == 0) {
+            break;
+        }
+
+        //
+        //  In lines mode, check whether the stream is UTF-16, which
+        //  requires at least the first two bytes.
+        //
+
+        if (SplitContext->LinesMode && FirstRead) {
+            if (BytesValid < 2 && BytesRead > 0) {
+                CarryBytes = BytesValid;
+                continue;
             }
+            Wide = SplitIsStreamWide(Buffer, BytesValid);
+            FirstRead = FALSE;
+        }
 
-            if ((LineNumber % SplitContext->LinesPerPart) == 0) {
-                if (hDestFile != NULL) {
-                    CloseHandle(hDestFile);
-                    hDestFile = NULL;
+        //
+        //  When searching UTF-16 text, only search complete characters, and
+        //  carry any partial character into the next read.  A carriage
+        //  return at the end of the buffer may be followed by a line feed
+        //  in the next read, so carry it too unless the stream has ended.
+        //
+
+        if (SplitContext->LinesMode && BytesRead > 0) {
+            if (Wide && (BytesValid % 2) != 0) {
+                BytesValid--;
+                CarryBytes = 1;
+            }
+            if (Wide) {
+                if (BytesValid >= 2 && Buffer[BytesValid - 2] == '\r' && Buffer[BytesValid - 1] == '\0') {
+                    BytesValid = BytesValid - 2;
+                    CarryBytes = CarryBytes + 2;
                 }
+            } else if (BytesValid >= 1 && Buffer[BytesValid - 1] == '\r') {
+                BytesValid--;
+                CarryBytes = 1;
             }
+        }
+
+        Current = Buffer;
+        End = Buffer + BytesValid;
+
+        while (Current < End) {
 
             if (hDestFile == NULL) {
                 hDestFile = SplitOpenTargetForCurrentPart(SplitContext);
                 if (hDestFile == NULL) {
-                    YoriLibLineReadCloseOrCache(LineContext);
-                    YoriLibFreeStringContents(&LineString);
-                    return FALSE;
+                    Result = FALSE;
+                    break;
                 }
                 SplitContext->CurrentPartNumber++;
+                LinesInPart = 0;
             }
 
-            YoriLibOutputToDevice(hDestFile, 0, _T("%y\n"), &LineString);
-            LineNumber++;
-        }
-
-        YoriLibLineReadCloseOrCache(LineContext);
-        YoriLibFreeStringContents(&LineString);
-    } else {
-        PVOID Buffer;
-        ULONG BytesRead;
-
-        Buffer = YoriLibMalloc((DWORD)SplitContext->BytesPerPart);
-        if (Buffer == NULL) {
-            return FALSE;
-        }
+            //
+            //  Find the end of the data belonging to this part.  If the part
+            //  is complete, it is closed after writing.
+            //
+
+            LineEnd = NULL;
+            if (SplitContext->LinesMode) {
+                PUCHAR Search = Current;
+                while (Search < End) {
+                    if (Wide) {
+                        Search = SplitFindWideLineEnd(Buffer, Search, End);
+                    } else {
+                        Search = SplitFindLineEnd(Search, End);
+                    }
+                    if (Search == NULL) {
+                        break;
+                    }
+                    Search = SplitSkipLineEnd(Search, End, Wide);
+                    LinesInPart++;
+                    if (LinesInPart == SplitContext->LinesPerPart) {
+                        LineEnd = Search;
+                        break;
+                    }
+                }
+            } else {
+                if ((LONGLONG)(End - Current) >= PartRemaining) {
+                    LineEnd = Current + (DWORD)PartRemaining;
+                }
+            }
 
-        while (TRUE) {
-            if (!ReadFile(hSource, Buffer, (DWORD)SplitContext->BytesPerPart, &BytesRead, NULL)) {
-                break;
+            if (LineEnd == NULL) {
+                LineEnd = End;
             }
 
-            if (BytesRead == 0) {
+            if (!SplitWritePart(hDestFile, Current, (DWORD)(LineEnd - Current))) {
+                Result = FALSE;
                 break;
             }
 
-            hDestFile = SplitOpenTargetForCurrentPart(SplitContext);
-            if (hDestFile == NULL) {
-                YoriLibFree(Buffer);
-                return FALSE;
-            }
-            SplitContext->CurrentPartNumber++;
+            PartRemaining = PartRemaining - (LineEnd - Current);
+            if ((SplitContext->LinesMode && LinesInPart == SplitContext->LinesPerPart) ||
+                (!SplitContext->LinesMode && PartRemaining == 0)) {
 
-            if (!WriteFile(hDestFile, Buffer, BytesRead, &BytesRead, NULL)) {
-                DWORD LastError = GetLastError();
-                LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: write failed: %s"), ErrText);
-                YoriLibFreeWinErrorText(ErrText);
                 CloseHandle(hDestFile);
-                YoriLibFree(Buffer);
-                return FALSE;
+                hDestFile = NULL;
+                PartRemaining = SplitContext->BytesPerPart;
             }
 
-            CloseHandle(hDestFile);
+            Current = LineEnd;
+        }
+
+        if (!Result) {
+            break;
+        }
+
+        if (CarryBytes > 0) {
+            memmove(Buffer, Buffer + BytesValid, CarryBytes);
         }
+    }
 
-        YoriLibFree(Buffer);
+    if (hDestFile != NULL) {
+        CloseHandle(hDestFile);
     }
 
-    return TRUE;
+    SplitFreeBuffer(Buffer);
+    return Result;
+}
+
+/**
+ Break a file into pieces by number of bytes.  Since the location of each
+ part is known in advance, all parts are copied concurrently by several
+ threads, each with its own handles, and each part is allocated at its final
+ size before it is written.  If the file is not a regular file, it is
+ processed as a stream.
+
+ @param FilePath Pointer to the full path to the file.
+
+ @param SplitContext Pointer to a context describing the actions to perform.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SplitProcessFile(
+    __in PYORI_STRING FilePath,
+    __in PSPLIT_CONTEXT SplitContext
+    )
+{
+    HANDLE FileHandle;
+    LARGE_INTEGER FileSize;
+    SPLIT_COPY_CONTEXT CopyContext;
+    LONGLONG PartCount;
+    BOOL Result;
+
+    FileHandle = CreateFile(FilePath->StartOfString,
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                            NULL);
+
+    if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
+        DWORD LastError = GetLastError();
+        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: open of %y failed: %s"), FilePath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return FALSE;
+    }
+
+    if (SplitContext->LinesMode || GetFileType(FileHandle) != FILE_TYPE_DISK) {
+        Result = SplitProcessStream(FileHandle, SplitContext);
+        CloseHandle(FileHandle);
+        return Result;
+    }
+
+    FileSize.LowPart = GetFileSize(FileHandle, &FileSize.HighPart);
+    CloseHandle(FileHandle);
+    if (FileSize.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) {
+        return FALSE;
+    }
+
+    PartCount = (FileSize.QuadPart + SplitContext->BytesPerPart - 1) / SplitContext->BytesPerPart;
+    if (PartCount == 0) {
+        return TRUE;
+    }
+
+    //
+    //  The index of the next part is incremented atomically as a signed
+    //  value.
+    //
+
+    if (PartCount >= 0x7FFFFFFF) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: too many parts\n"));
+        return FALSE;
+    }
+
+    ZeroMemory(&CopyContext, sizeof(CopyContext));
+    CopyContext.JobCount = (DWORD)PartCount;
+    CopyContext.SplitSource = FilePath;
+    CopyContext.SplitPrefix = &SplitContext->Prefix;
+    CopyContext.FirstPartNumber = SplitContext->CurrentPartNumber;
+    CopyContext.BytesPerPart = SplitContext->BytesPerPart;
+    CopyContext.SourceLength = FileSize.QuadPart;
+
+    Result = SplitCopyRanges(&CopyContext);
+    SplitContext->CurrentPartNumber += PartCount;
+    return Result;
 }
 
 /**
  Join a series of files with a given prefix back into a single file.  This is
- the inverse of split.
+ the inverse of split.  The size of each part is determined first, so the
+ combined file can be allocated at its final size, and all parts can be
+ copied into it concurrently.
 
  @param Prefix Pointer to the string containing the prefix name of the set of
         files.
@@ -260,64 +1180,35 @@ SplitJoin(
 {
     HANDLE SourceHandle;
     HANDLE TargetHandle;
-    PUCHAR Buffer;
-    DWORD BytesRead;
-    DWORD BytesAllocated;
-    LONGLONG CurrentFragment;
-    LPTSTR FragmentFileName;
-    YORI_STRING NumberString;
+    SPLIT_COPY_CONTEXT CopyContext;
+    PSPLIT_COPY_JOB NewJobs;
+    PSPLIT_COPY_JOB Job;
+    DWORD JobsAllocated;
+    LARGE_INTEGER FileSize;
+    LONGLONG TotalSize;
+    YORI_STRING FragmentFileName;
     DWORD LastError;
     LPTSTR ErrText;
+    BOOL Result;
 
     ASSERT(YoriLibIsStringNullTerminated(OutputFile));
 
-    BytesAllocated = 256 * 1024;
-
-    Buffer = YoriLibMalloc(BytesAllocated);
-    if (Buffer == NULL) {
-        return FALSE;
-    }
-
-    TargetHandle = CreateFile(OutputFile->StartOfString,
-                              GENERIC_WRITE,
-                              FILE_SHARE_READ | FILE_SHARE_DELETE,
-                              NULL,
-                              CREATE_ALWAYS,
-                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
-                              NULL);
-
-    if (TargetHandle == NULL || TargetHandle == INVALID_HANDLE_VALUE) {
-        LastError = GetLastError();
-        ErrText = YoriLibGetWinErrorText(LastError);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: open of %y failed: %s"), OutputFile, ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        YoriLibFree(Buffer);
-        return FALSE;
-    }
+    ZeroMemory(&CopyContext, sizeof(CopyContext));
+    JobsAllocated = 0;
+    TotalSize = 0;
 
-    CurrentFragment = 0;
+    //
+    //  Find each part and its size.
+    //
 
     while(TRUE) {
 
-        YoriLibInitEmptyString(&NumberString);
-        if (!YoriLibNumberToString(&NumberString, CurrentFragment, 10, 0, '\0')) {
-            CloseHandle(TargetHandle);
-            YoriLibFree(Buffer);
+        if (!SplitBuildPartName(Prefix, CopyContext.JobCount, &FragmentFileName)) {
+            SplitFreeJobs(CopyContext.Jobs, CopyContext.JobCount);
             return FALSE;
         }
 
-        FragmentFileName = YoriLibMalloc((Prefix->LengthInChars + NumberString.LengthInChars + 1) * sizeof(TCHAR));
-        if (FragmentFileName == NULL) {
-            YoriLibFreeStringContents(&NumberString);
-            CloseHandle(TargetHandle);
-            YoriLibFree(Buffer);
-            return FALSE;
-        }
-
-        YoriLibSPrintf(FragmentFileName, _T("%y%y"), Prefix, &NumberString);
-        YoriLibFreeStringContents(&NumberString);
-
-        SourceHandle = CreateFile(FragmentFileName,
+        SourceHandle = CreateFile(FragmentFileName.StartOfString,
                                   GENERIC_READ,
                                   FILE_SHARE_READ|FILE_SHARE_DELETE,
                                   NULL,
@@ -326,61 +1217,96 @@ SplitJoin(
                                   NULL);
         if (SourceHandle == INVALID_HANDLE_VALUE) {
             LastError = GetLastError();
-            if (LastError == ERROR_FILE_NOT_FOUND && CurrentFragment > 0) {
-                YoriLibFree(FragmentFileName);
+            if (LastError == ERROR_FILE_NOT_FOUND && CopyContext.JobCount > 0) {
+                YoriLibFreeStringContents(&FragmentFileName);
                 break;
             }
             ErrText = YoriLibGetWinErrorText(LastError);
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: open of %s failed: %s"), FragmentFileName, ErrText);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: open of %y failed: %s"), &FragmentFileName, ErrText);
             YoriLibFreeWinErrorText(ErrText);
-            YoriLibFree(FragmentFileName);
-            CloseHandle(TargetHandle);
-            YoriLibFree(Buffer);
+            YoriLibFreeStringContents(&FragmentFileName);
+            SplitFreeJobs(CopyContext.Jobs, CopyContext.JobCount);
             return FALSE;
         }
 
-        while(TRUE) {
+        FileSize.LowPart = GetFileSize(SourceHandle, &FileSize.HighPart);
+        LastError = GetLastError();
+        CloseHandle(SourceHandle);
+        if (FileSize.LowPart == INVALID_FILE_SIZE && LastError != NO_ERROR) {
+            ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: read of %y failed: %s"), &FragmentFileName, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            YoriLibFreeStringContents(&FragmentFileName);
+            SplitFreeJobs(CopyContext.Jobs, CopyContext.JobCount);
+            return FALSE;
+        }
 
-            if (!ReadFile(SourceHandle, Buffer, BytesAllocated, &BytesRead, NULL)) {
-                LastError = GetLastError();
-                if (LastError == ERROR_HANDLE_EOF) {
-                    break;
-                }
-                ErrText = YoriLibGetWinErrorText(LastError);
-                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: read of %s failed: %s"), FragmentFileName, ErrText);
-                YoriLibFreeWinErrorText(ErrText);
-                YoriLibFree(FragmentFileName);
-                CloseHandle(TargetHandle);
-                CloseHandle(SourceHandle);
-                YoriLibFree(Buffer);
+        if (CopyContext.JobCount >= JobsAllocated) {
+            JobsAllocated = JobsAllocated * 2 + 16;
+            NewJobs = YoriLibMalloc(JobsAllocated * sizeof(SPLIT_COPY_JOB));
+            if (NewJobs == NULL) {
+                YoriLibFreeStringContents(&FragmentFileName);
+                SplitFreeJobs(CopyContext.Jobs, CopyContext.JobCount);
                 return FALSE;
             }
-
-            if (BytesRead == 0) {
-                break;
-            }
-
-            if (!WriteFile(TargetHandle, Buffer, BytesRead, &BytesRead, NULL)) {
-                LastError = GetLastError();
-                ErrText = YoriLibGetWinErrorText(LastError);
-                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: write to %y failed: %s"), OutputFile, ErrText);
-                YoriLibFreeWinErrorText(ErrText);
-                YoriLibFree(FragmentFileName);
-                CloseHandle(TargetHandle);
-                CloseHandle(SourceHandle);
-                YoriLibFree(Buffer);
-                return FALSE;
+            if (CopyContext.Jobs != NULL) {
+                memcpy(NewJobs, CopyContext.Jobs, CopyContext.JobCount * sizeof(SPLIT_COPY_JOB));
+                YoriLibFree(CopyContext.Jobs);
             }
+            CopyContext.Jobs = NewJobs;
         }
 
-        CloseHandle(SourceHandle);
-        YoriLibFree(FragmentFileName);
-        CurrentFragment++;
+        Job = &CopyContext.Jobs[CopyContext.JobCount];
+        ZeroMemory(Job, sizeof(SPLIT_COPY_JOB));
+        memcpy(&Job->SourceName, &FragmentFileName, sizeof(YORI_STRING));
+        YoriLibCloneString(&Job->TargetName, OutputFile);
+        Job->SourceOffset = 0;
+        Job->TargetOffset = TotalSize;
+        Job->Length = FileSize.QuadPart;
+        Job->CreateTarget = FALSE;
+        CopyContext.JobCount++;
+
+        TotalSize = TotalSize + FileSize.QuadPart;
+    }
+
+    //
+    //  Create the combined file at its final size.
+    //
+
+    TargetHandle = CreateFile(OutputFile->StartOfString,
+                              GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              NULL,
+                              CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                              NULL);
+
+    if (TargetHandle == NULL || TargetHandle == INVALID_HANDLE_VALUE) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: open of %y failed: %s"), OutputFile, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        SplitFreeJobs(CopyContext.Jobs, CopyContext.JobCount);
+        return FALSE;
+    }
+
+    if (!SplitSeek(TargetHandle, TotalSize) ||
+        !SetEndOfFile(TargetHandle)) {
+
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: could not prepare %y: %s"), OutputFile, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        CloseHandle(TargetHandle);
+        SplitFreeJobs(CopyContext.Jobs, CopyContext.JobCount);
+        return FALSE;
     }
 
-    YoriLibFree(Buffer);
     CloseHandle(TargetHandle);
-    return TRUE;
+
+    Result = SplitCopyRanges(&CopyContext);
+    SplitFreeJobs(CopyContext.Jobs, CopyContext.JobCount);
+    return Result;
 }
 
 #ifdef YORI_BUILTIN
@@ -432,7 +1358,7 @@ ENTRYPOINT(
                 SplitHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2018-2019"));
+                YoriLibDisplayMitLicense(_T("2018-2026"));
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 if (ArgC > i + 1) {
@@ -516,7 +1442,7 @@ ENTRYPOINT(
                 Result = EXIT_FAILURE;
             }
         } else {
-            if (SplitContext.BytesPerPart == 0 || SplitContext.BytesPerPart >= (DWORD)-1) {
+            if (SplitContext.BytesPerPart <= 0) {
                 YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: invalid bytes per part\n"));
                 Result = EXIT_FAILURE;
             }
@@ -550,40 +1476,18 @@ ENTRYPOINT(
                 }
             }
         } else {
-            HANDLE FileHandle;
             YORI_STRING FilePath;
 
             if (!YoriLibUserStringToSingleFilePath(&ArgV[StartArg], TRUE, &FilePath)) {
                 Result = EXIT_FAILURE;
             }
 
-            FileHandle = NULL;
             if (Result == EXIT_SUCCESS) {
-                FileHandle = CreateFile(FilePath.StartOfString,
-                                        GENERIC_READ,
-                                        FILE_SHARE_READ | FILE_SHARE_DELETE,
-                                        NULL,
-                                        OPEN_EXISTING,
-                                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
-                                        NULL);
-
-                if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
-                    DWORD LastError = GetLastError();
-                    LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: open of %y failed: %s"), &FilePath, ErrText);
-                    YoriLibFreeWinErrorText(ErrText);
+                if (!SplitProcessFile(&FilePath, &SplitContext)) {
                     Result = EXIT_FAILURE;
                 }
-
                 YoriLibFreeStringContents(&FilePath);
             }
-
-            if (Result == EXIT_SUCCESS) {
-                if (!SplitProcessStream(FileHandle, &SplitContext)) {
-                    Result = EXIT_FAILURE;
-                }
-                CloseHandle(FileHandle);
-            }
         }
         YoriLibFreeStringContents(&SplitContext.Prefix);
     }
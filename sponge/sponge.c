@@ -54,173 +54,10 @@ SpongeHelp(VOID)
 }
 
 /**
- A buffer for a single data stream.
+ The number of bytes of input to hold in memory before moving input into a
+ temporary file.
  */
-typedef struct _SPONGE_BUFFER {
-
-    /**
-     The number of bytes currently allocated to this buffer.
-     */
-    DWORD BytesAllocated;
-
-    /**
-     The number of bytes populated with data in this buffer.
-     */
-    DWORD BytesPopulated;
-
-    /**
-     A handle to a pipe which is the source of data for this buffer.
-     */
-    HANDLE hSource;
-
-    /**
-     The data buffer.
-     */
-    PCHAR Buffer;
-
-} SPONGE_BUFFER, *PSPONGE_BUFFER;
-
-/**
- Populate data from stdin into an in memory buffer.
-
- @param ThisBuffer A pointer to the process buffer set.
-
- @return TRUE to indicate success, FALSE to indicate failure.
- */
-BOOL
-SpongeBufferPump(
-    __in PSPONGE_BUFFER ThisBuffer
-    )
-{
-    DWORD BytesRead;
-    BOOL Result = FALSE;
-
-    while (TRUE) {
-
-        if (ReadFile(ThisBuffer->hSource,
-                     YoriLibAddToPointer(ThisBuffer->Buffer, ThisBuffer->BytesPopulated),
-                     ThisBuffer->BytesAllocated - ThisBuffer->BytesPopulated,
-                     &BytesRead,
-                     NULL)) {
-
-            if (BytesRead == 0) {
-                Result = TRUE;
-                break;
-            }
-
-            ThisBuffer->BytesPopulated += BytesRead;
-            ASSERT(ThisBuffer->BytesPopulated <= ThisBuffer->BytesAllocated);
-            if (ThisBuffer->BytesPopulated >= ThisBuffer->BytesAllocated) {
-                DWORD NewBytesAllocated;
-                PCHAR NewBuffer;
-
-                if (ThisBuffer->BytesAllocated >= ((DWORD)-1) / 4) {
-                    break;
-                }
-
-                NewBytesAllocated = ThisBuffer->BytesAllocated * 4;
-
-                NewBuffer = YoriLibMalloc(NewBytesAllocated);
-                if (NewBuffer == NULL) {
-                    break;
-                }
-
-                memcpy(NewBuffer, ThisBuffer->Buffer, ThisBuffer->BytesAllocated);
-                YoriLibFree(ThisBuffer->Buffer);
-                ThisBuffer->Buffer = NewBuffer;
-                ThisBuffer->BytesAllocated = NewBytesAllocated;
-            }
-        } else {
-            Result = TRUE;
-            break;
-        }
-    }
-
-    return Result;
-}
-
-/**
- Output the collected buffer to a stream.
-
- @param ThisBuffer Pointer to the buffer to output.
-
- @param hTarget Handle to the target stream to output the buffer to.
-
- @return TRUE to indicate success, FALSE to indicate failure.
- */
-BOOL
-SpongeBufferForward(
-    __in PSPONGE_BUFFER ThisBuffer,
-    __in HANDLE hTarget
-    )
-{
-    DWORD BytesSent;
-    BOOL Result;
-
-    BytesSent = 0;
-    Result = TRUE;
-
-    while (BytesSent < ThisBuffer->BytesPopulated) {
-        DWORD BytesToWrite;
-        DWORD BytesWritten;
-        BytesToWrite = 4096;
-        if (BytesSent + BytesToWrite > ThisBuffer->BytesPopulated) {
-            BytesToWrite = ThisBuffer->BytesPopulated - BytesSent;
-        }
-
-        if (WriteFile(hTarget,
-                      YoriLibAddToPointer(ThisBuffer->Buffer, BytesSent),
-                      BytesToWrite,
-                      &BytesWritten,
-                      NULL)) {
-
-            BytesSent += BytesWritten;
-        } else {
-            Result = FALSE;
-        }
-
-        ASSERT(BytesSent <= ThisBuffer->BytesPopulated);
-    }
-
-    return Result;
-}
-
-/**
- Allocate and initialize a buffer for an input stream.
-
- @param Buffer Pointer to the buffer to allocate structures for.
-
- @return TRUE if the buffer is successfully initialized, FALSE if it is not.
- */
-BOOL
-SpongeAllocateBuffer(
-    __out PSPONGE_BUFFER Buffer
-    )
-{
-    Buffer->BytesAllocated = 1024;
-    Buffer->Buffer = YoriLibMalloc(Buffer->BytesAllocated);
-    if (Buffer->Buffer == NULL) {
-        return FALSE;
-    }
-
-    return TRUE;
-}
-
-/**
- Free structures associated with a single input stream.
-
- @param ThisBuffer Pointer to the single stream's buffers to deallocate.
- */
-VOID
-SpongeFreeBuffer(
-    __in PSPONGE_BUFFER ThisBuffer
-    )
-{
-    if (ThisBuffer->Buffer != NULL) {
-        YoriLibFree(ThisBuffer->Buffer);
-    }
-}
-
+#define SPONGE_SPILL_THRESHOLD (32 * 1024 * 1024)
 
 #ifdef YORI_BUILTIN
 /**
@@ -253,12 +90,10 @@ ENTRYPOINT(
     DWORD i;
     DWORD StartArg = 0;
     YORI_STRING Arg;
-    SPONGE_BUFFER SpongeBuffer;
+    YORI_LIB_SEGMENTED_BUFFER SpongeBuffer;
     YORI_STRING FullFilePath;
     HANDLE hTarget;
 
-    ZeroMemory(&SpongeBuffer, sizeof(SpongeBuffer));
-
     for (i = 1; i < ArgC; i++) {
 
         ArgumentUnderstood = FALSE;
@@ -296,23 +131,21 @@ ENTRYPOINT(
         return EXIT_FAILURE;
     }
 
-    if (!SpongeAllocateBuffer(&SpongeBuffer)) {
-        return EXIT_FAILURE;
-    }
-    SpongeBuffer.hSource = GetStdHandle(STD_INPUT_HANDLE);
+    YoriLibSegmentedBufferInitialize(&SpongeBuffer, 0, SPONGE_SPILL_THRESHOLD);
 
     YoriLibInitEmptyString(&FullFilePath);
     hTarget = GetStdHandle(STD_OUTPUT_HANDLE);
     if (StartArg != 0 && StartArg < ArgC) {
         YoriLibInitEmptyString(&FullFilePath);
         if (!YoriLibUserStringToSingleFilePath(&ArgV[StartArg], TRUE, &FullFilePath)) {
-            SpongeFreeBuffer(&SpongeBuffer);
+            YoriLibSegmentedBufferCleanup(&SpongeBuffer);
             return EXIT_FAILURE;
         }
     }
 
-    if (!SpongeBufferPump(&SpongeBuffer)) {
-        SpongeFreeBuffer(&SpongeBuffer);
+    if (!YoriLibSegmentedBufferReadFromHandle(&SpongeBuffer, GetStdHandle(STD_INPUT_HANDLE))) {
+        YoriLibSegmentedBufferCleanup(&SpongeBuffer);
+        YoriLibFreeStringContents(&FullFilePath);
         return EXIT_FAILURE;
     }
 
@@ -327,7 +160,7 @@ ENTRYPOINT(
         if (hTarget == INVALID_HANDLE_VALUE) {
             DWORD LastError = GetLastError();
             LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-            SpongeFreeBuffer(&SpongeBuffer);
+            YoriLibSegmentedBufferCleanup(&SpongeBuffer);
             YoriLibFreeStringContents(&FullFilePath);
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sponge: open file failed: %s"), ErrText);
             YoriLibFreeWinErrorText(ErrText);
@@ -335,14 +168,14 @@ ENTRYPOINT(
         }
     }
 
-    SpongeBufferForward(&SpongeBuffer, hTarget);
+    YoriLibSegmentedBufferWriteToHandle(&SpongeBuffer, hTarget);
 
     if (FullFilePath.LengthInChars > 0) {
         CloseHandle(hTarget);
         YoriLibFreeStringContents(&FullFilePath);
     }
 
-    SpongeFreeBuffer(&SpongeBuffer);
+    YoriLibSegmentedBufferCleanup(&SpongeBuffer);
 
     return EXIT_SUCCESS;
 }
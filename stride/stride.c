@@ -3,7 +3,7 @@
  *
  * Yori shell output a periodic range of data from an input stream
  *
- * Copyright (c) 2017-2019 Malcolm J. Smith
+ * Copyright (c) 2017-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -35,13 +35,15 @@ CHAR strStrideHelpText[] =
         "\n"
         "Output periodic contents of one or more files.\n"
         "\n"
-        "STRIDE [-license] [-b] [-s] [-h <num>] [-n] [<file>...]\n"
+        "STRIDE [-license] [-a|-x] [-b] [-i <num>] [-l <num>] [-o <num>] [-s] [<file>...]\n"
         "\n"
+        "   -a             Seek through files approximately based on average line length\n"
         "   -b             Use basic search criteria for files only\n"
         "   -i <num>       The number of lines between each output\n"
         "   -l <num>       The number of lines to output on each interval\n"
         "   -o <num>       The number of lines to offset from each interval\n"
-        "   -s             Process files from all subdirectories\n";
+        "   -s             Process files from all subdirectories\n"
+        "   -x             Seek through files exactly using a saved index of lines\n";
 
 /**
  Display usage text to the user.
@@ -90,6 +92,28 @@ typedef struct _STRIDE_CONTEXT {
      */
     DWORD LinesOnEachInterval;
 
+    /**
+     TRUE if seekable files should be sampled by seeking to estimated byte
+     offsets rather than reading every line.
+     */
+    BOOLEAN Approximate;
+
+    /**
+     TRUE if seekable files should be sampled by seeking using a saved line
+     index rather than reading every line.
+     */
+    BOOLEAN Indexed;
+
+    /**
+     TRUE if output is to a console.
+     */
+    BOOLEAN OutputIsConsole;
+
+    /**
+     Handle to standard output.
+     */
+    HANDLE OutputHandle;
+
     /**
      Records the total number of files processed.
      */
@@ -108,6 +132,146 @@ typedef struct _STRIDE_CONTEXT {
 
 } STRIDE_CONTEXT, *PSTRIDE_CONTEXT;
 
+/**
+ The number of lines described by each entry in a saved line index.
+ */
+#define STRIDE_INDEX_LINES_PER_ENTRY (1024)
+
+/**
+ The size of the buffer used to scan a file when building a line index.
+ */
+#define STRIDE_SCAN_BUFFER_SIZE (1024 * 1024)
+
+/**
+ The amount of data at the start of a file used to estimate the average
+ length of a line when seeking approximately.
+ */
+#define STRIDE_ESTIMATE_SIZE (64 * 1024)
+
+/**
+ The minimum number of bytes between samples for seeking to be used in
+ preference to reading through the data.  Below this, the file system is
+ reading the data between samples anyway.
+ */
+#define STRIDE_MINIMUM_SEEK_DISTANCE (64 * 1024)
+
+/**
+ The signature at the start of a saved line index, 'YSLI'.
+ */
+#define STRIDE_INDEX_SIGNATURE (0x494c5359)
+
+/**
+ The version of the saved line index format.
+ */
+#define STRIDE_INDEX_VERSION (1)
+
+/**
+ The header of a saved line index.  This is followed by the full path of
+ the indexed file, in characters, followed by an array of byte offsets.
+ */
+typedef struct _STRIDE_INDEX_HEADER {
+
+    /**
+     Set to STRIDE_INDEX_SIGNATURE.
+     */
+    DWORD Signature;
+
+    /**
+     Set to STRIDE_INDEX_VERSION.
+     */
+    DWORD Version;
+
+    /**
+     The number of lines described by each entry.
+     */
+    DWORD LinesPerEntry;
+
+    /**
+     Nonzero if lines were located by searching for 16 bit line feeds,
+     zero if lines were located by searching for 8 bit line feeds.
+     */
+    DWORD WideChars;
+
+    /**
+     The size of the indexed file.
+     */
+    LARGE_INTEGER FileSize;
+
+    /**
+     The last write time of the indexed file.
+     */
+    FILETIME LastWriteTime;
+
+    /**
+     The number of lines in the indexed file.
+     */
+    DWORDLONG LineCount;
+
+    /**
+     The number of entries following the header and path.
+     */
+    DWORD EntryCount;
+
+    /**
+     The length of the path to the indexed file, in characters.
+     */
+    DWORD PathLengthInChars;
+} STRIDE_INDEX_HEADER, *PSTRIDE_INDEX_HEADER;
+
+/**
+ An in memory line index, recording the byte offset of every
+ STRIDE_INDEX_LINES_PER_ENTRY line.
+ */
+typedef struct _STRIDE_INDEX {
+
+    /**
+     The number of lines in the file.
+     */
+    DWORDLONG LineCount;
+
+    /**
+     The number of entries in the Offsets array.
+     */
+    DWORD EntryCount;
+
+    /**
+     The number of entries allocated in the Offsets array.
+     */
+    DWORD EntriesAllocated;
+
+    /**
+     An array of byte offsets.  Entry N refers to the line numbered
+     N * STRIDE_INDEX_LINES_PER_ENTRY.
+     */
+    PDWORDLONG Offsets;
+} STRIDE_INDEX, *PSTRIDE_INDEX;
+
+/**
+ Output a single line to standard output.
+
+ @param LineString Pointer to the line to output.
+
+ @param StrideContext Pointer to context information describing the output
+        device.
+ */
+VOID
+StrideOutputLine(
+    __in PYORI_STRING LineString,
+    __in PSTRIDE_CONTEXT StrideContext
+    )
+{
+    CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), LineString);
+    if (LineString->LengthInChars == 0 ||
+        !StrideContext->OutputIsConsole ||
+        !GetConsoleScreenBufferInfo(StrideContext->OutputHandle, &ScreenInfo) ||
+        ScreenInfo.dwCursorPosition.X != 0) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+    }
+}
+
 /**
  Process a single opened stream, enumerating through all lines and displaying
  the set requested by the user.
@@ -126,15 +290,8 @@ StrideProcessStream(
     )
 {
     PVOID LineContext = NULL;
-    CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
     YORI_STRING LineString;
-    BOOL OutputIsConsole;
-    DWORD dwMode;
-    DWORD CharactersDisplayed;
     DWORD LineRelativeToStride;
-    HANDLE OutputHandle;
-
-    OutputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
 
     YoriLibInitEmptyString(&LineString);
 
@@ -142,11 +299,6 @@ StrideProcessStream(
     StrideContext->FilesFoundThisArg++;
     StrideContext->FileLinesFound = 0;
 
-    OutputIsConsole = FALSE;
-    if (GetConsoleMode(OutputHandle, &dwMode)) {
-        OutputIsConsole = TRUE;
-    }
-
     while (TRUE) {
 
         if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
@@ -157,22 +309,648 @@ StrideProcessStream(
         StrideContext->FileLinesFound++;
 
         if (LineRelativeToStride < StrideContext->LinesOnEachInterval) {
+            StrideOutputLine(&LineString, StrideContext);
+        }
+    }
+
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&LineString);
+
+    return TRUE;
+}
+
+/**
+ Move the file pointer of a seekable file to a specified byte offset.
+
+ @param hSource The opened source file.
+
+ @param Offset The byte offset to move to.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+StrideSeekTo(
+    __in HANDLE hSource,
+    __in DWORDLONG Offset
+    )
+{
+    LARGE_INTEGER Position;
+
+    Position.QuadPart = Offset;
+    if (SetFilePointer(hSource, Position.LowPart, &Position.HighPart, FILE_BEGIN) == (DWORD)-1 &&
+        GetLastError() != NO_ERROR) {
+
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ Read lines starting from a specified byte offset within a seekable file,
+ and output a range of them.
+
+ @param hSource The opened source file.
+
+ @param Offset The byte offset to start reading from.
+
+ @param DiscardPartialLine If TRUE, the offset may be in the middle of a
+        line, and data up to the next line ending should be discarded.
+
+ @param LinesToSkip The number of complete lines to read and discard before
+        output begins.
+
+ @param LinesToOutput The number of lines to output.
+
+ @param StrideContext Pointer to context information describing the output
+        device.
+
+ @return TRUE if lines were output, FALSE if the end of the file was
+         reached first.
+ */
+BOOL
+StrideOutputLinesAt(
+    __in HANDLE hSource,
+    __in DWORDLONG Offset,
+    __in BOOLEAN DiscardPartialLine,
+    __in DWORD LinesToSkip,
+    __in DWORD LinesToOutput,
+    __in PSTRIDE_CONTEXT StrideContext
+    )
+{
+    PVOID LineContext = NULL;
+    YORI_STRING LineString;
+    DWORD Index;
+    BOOL Result;
+
+    if (!StrideSeekTo(hSource, Offset)) {
+        return FALSE;
+    }
 
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &LineString);
-            CharactersDisplayed = LineString.LengthInChars;
-            if (CharactersDisplayed == 0 ||
-                !OutputIsConsole ||
-                !GetConsoleScreenBufferInfo(OutputHandle, &ScreenInfo) ||
-                ScreenInfo.dwCursorPosition.X != 0) {
+    YoriLibInitEmptyString(&LineString);
+    Result = FALSE;
+
+    if (DiscardPartialLine) {
+        LinesToSkip++;
+    }
+
+    for (Index = 0; Index < LinesToSkip; Index++) {
+        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+            break;
+        }
+    }
 
-                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+    if (Index == LinesToSkip) {
+        for (Index = 0; Index < LinesToOutput; Index++) {
+            if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+                break;
             }
+            StrideOutputLine(&LineString, StrideContext);
+            Result = TRUE;
         }
     }
 
     YoriLibLineReadCloseOrCache(LineContext);
     YoriLibFreeStringContents(&LineString);
 
+    return Result;
+}
+
+/**
+ Sample a seekable file by estimating the average length of a line from the
+ start of the file and seeking by the corresponding number of bytes between
+ each interval.  After each seek, output resumes at the next line boundary.
+ This is approximate: the lines output are only the lines that would be
+ output when reading the file to the extent that line lengths are uniform.
+
+ @param hSource The opened source file.
+
+ @param FileSize The size of the file, in bytes.
+
+ @param StrideContext Pointer to context information specifying which lines
+        to display.
+
+ @return TRUE if the file was processed, FALSE if seeking would not help
+         and the caller should read the file sequentially instead.
+ */
+BOOL
+StrideProcessApproximate(
+    __in HANDLE hSource,
+    __in DWORDLONG FileSize,
+    __in PSTRIDE_CONTEXT StrideContext
+    )
+{
+    PUCHAR Buffer;
+    DWORD BytesRead;
+    DWORD Index;
+    DWORD LineCount;
+    DWORD CharSize;
+    DWORDLONG AverageLineLength;
+    DWORDLONG ByteStride;
+    DWORDLONG Position;
+
+    if (StrideContext->Interval == 0 ||
+        StrideContext->LinesOnEachInterval >= StrideContext->Interval ||
+        FileSize < STRIDE_MINIMUM_SEEK_DISTANCE) {
+
+        return FALSE;
+    }
+
+    CharSize = sizeof(UCHAR);
+    if (YoriLibGetMultibyteInputEncoding() == CP_UTF16) {
+        CharSize = sizeof(WCHAR);
+    }
+
+    Buffer = YoriLibMalloc(STRIDE_ESTIMATE_SIZE);
+    if (Buffer == NULL) {
+        return FALSE;
+    }
+
+    if (!ReadFile(hSource, Buffer, STRIDE_ESTIMATE_SIZE, &BytesRead, NULL)) {
+        BytesRead = 0;
+    }
+
+    LineCount = 0;
+    for (Index = 0; Index + CharSize <= BytesRead; Index += CharSize) {
+        if (Buffer[Index] == '\n' &&
+            (CharSize == sizeof(UCHAR) || Buffer[Index + 1] == '\0')) {
+
+            LineCount++;
+        }
+    }
+
+    YoriLibFree(Buffer);
+
+    //
+    //  If no line ending is found in the estimate, lines are too long to
+    //  meaningfully estimate.
+    //
+
+    if (LineCount == 0) {
+        return FALSE;
+    }
+
+    AverageLineLength = BytesRead / LineCount;
+    ByteStride = AverageLineLength * StrideContext->Interval;
+    if (ByteStride < STRIDE_MINIMUM_SEEK_DISTANCE) {
+        return FALSE;
+    }
+
+    StrideContext->FilesFound++;
+    StrideContext->FilesFoundThisArg++;
+
+    //
+    //  Samples after the first start by reading the character before the
+    //  target position, so that if the target is the start of a line, the
+    //  partial line being discarded is empty.
+    //
+
+    Position = AverageLineLength * StrideContext->Offset;
+    Position = Position - (Position % CharSize);
+    while (Position < FileSize) {
+        if (Position == 0) {
+            if (!StrideOutputLinesAt(hSource, 0, FALSE, 0, StrideContext->LinesOnEachInterval, StrideContext)) {
+                break;
+            }
+        } else {
+            if (!StrideOutputLinesAt(hSource, Position - CharSize, TRUE, 0, StrideContext->LinesOnEachInterval, StrideContext)) {
+                break;
+            }
+        }
+        Position = Position + ByteStride;
+        Position = Position - (Position % CharSize);
+    }
+
+    return TRUE;
+}
+
+/**
+ Scan a file to build an index of the byte offset of every
+ STRIDE_INDEX_LINES_PER_ENTRY line.  Lines are located by their line feed
+ characters.
+
+ @param hSource The opened source file.
+
+ @param WideChars TRUE if the file consists of 16 bit characters, FALSE if
+        it consists of 8 bit characters.
+
+ @param Index On successful completion, populated with the index.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+StrideBuildIndex(
+    __in HANDLE hSource,
+    __in BOOLEAN WideChars,
+    __out PSTRIDE_INDEX Index
+    )
+{
+    PUCHAR Buffer;
+    PDWORDLONG NewOffsets;
+    DWORDLONG BufferOffset;
+    DWORD BytesRead;
+    DWORD CharIndex;
+    DWORD CharSize;
+    BOOLEAN AtLineStart;
+
+    Index->LineCount = 0;
+    Index->EntryCount = 0;
+    Index->EntriesAllocated = 0;
+    Index->Offsets = NULL;
+
+    if (!StrideSeekTo(hSource, 0)) {
+        return FALSE;
+    }
+
+    Buffer = YoriLibMalloc(STRIDE_SCAN_BUFFER_SIZE);
+    if (Buffer == NULL) {
+        return FALSE;
+    }
+
+    CharSize = sizeof(UCHAR);
+    if (WideChars) {
+        CharSize = sizeof(WCHAR);
+    }
+
+    BufferOffset = 0;
+    AtLineStart = TRUE;
+
+    while (ReadFile(hSource, Buffer, STRIDE_SCAN_BUFFER_SIZE, &BytesRead, NULL) &&
+           BytesRead > 0) {
+
+        for (CharIndex = 0; CharIndex + CharSize <= BytesRead; CharIndex += CharSize) {
+            if (AtLineStart) {
+                AtLineStart = FALSE;
+                if ((Index->LineCount % STRIDE_INDEX_LINES_PER_ENTRY) == 0) {
+                    if (Index->EntryCount == Index->EntriesAllocated) {
+                        Index->EntriesAllocated = Index->EntriesAllocated * 2 + 1024;
+                        NewOffsets = YoriLibMalloc(Index->EntriesAllocated * sizeof(DWORDLONG));
+                        if (NewOffsets == NULL) {
+                            YoriLibFree(Buffer);
+                            if (Index->Offsets != NULL) {
+                                YoriLibFree(Index->Offsets);
+                                Index->Offsets = NULL;
+                            }
+                            return FALSE;
+                        }
+                        if (Index->Offsets != NULL) {
+                            memcpy(NewOffsets, Index->Offsets, Index->EntryCount * sizeof(DWORDLONG));
+                            YoriLibFree(Index->Offsets);
+                        }
+                        Index->Offsets = NewOffsets;
+                    }
+                    Index->Offsets[Index->EntryCount] = BufferOffset + CharIndex;
+                    Index->EntryCount++;
+                }
+            }
+
+            if (Buffer[CharIndex] == '\n' &&
+                (!WideChars || Buffer[CharIndex + 1] == '\0')) {
+
+                Index->LineCount++;
+                AtLineStart = TRUE;
+            }
+        }
+
+        BufferOffset = BufferOffset + BytesRead;
+    }
+
+    //
+    //  A final line without a line ending is still a line.
+    //
+
+    if (!AtLineStart) {
+        Index->LineCount++;
+    }
+
+    YoriLibFree(Buffer);
+    return TRUE;
+}
+
+/**
+ Generate the name of the file used to save the line index for a file.  The
+ index is kept in the temporary directory so that indexing never modifies
+ the source file or the directory containing it.
+
+ @param FilePath Pointer to the full path to the file being indexed.
+
+ @param IndexFileName On successful completion, populated with the name of
+        the index file.  The caller should free this with
+        @ref YoriLibFreeStringContents .
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+StrideGetIndexFileName(
+    __in PYORI_STRING FilePath,
+    __out PYORI_STRING IndexFileName
+    )
+{
+    if (!YoriLibGetTempPath(IndexFileName, sizeof("ystride12345678.idx"))) {
+        return FALSE;
+    }
+
+    IndexFileName->LengthInChars += YoriLibSPrintf(&IndexFileName->StartOfString[IndexFileName->LengthInChars],
+                                                   _T("ystride%08x.idx"),
+                                                   YoriLibHashString32(0, FilePath));
+    return TRUE;
+}
+
+/**
+ Attempt to load a previously saved line index.  The index is only used if
+ it describes the same file, and that file has not changed since the index
+ was saved.
+
+ @param IndexFileName Pointer to the name of the saved index.
+
+ @param Expected Pointer to a header describing the current state of the
+        file.  The index is only loaded if its header matches this.
+
+ @param FilePath Pointer to the full path to the file being indexed.
+
+ @param Index On successful completion, populated with the index.
+
+ @return TRUE if the index was loaded, FALSE if it was not present or does
+         not describe the current file.
+ */
+BOOL
+StrideLoadIndex(
+    __in PYORI_STRING IndexFileName,
+    __in PSTRIDE_INDEX_HEADER Expected,
+    __in PYORI_STRING FilePath,
+    __out PSTRIDE_INDEX Index
+    )
+{
+    STRIDE_INDEX_HEADER Header;
+    YORI_STRING SavedPath;
+    HANDLE hIndex;
+    DWORD BytesRead;
+    DWORD BytesToRead;
+    DWORD Entry;
+    BOOL Result;
+
+    hIndex = CreateFile(IndexFileName->StartOfString,
+                        GENERIC_READ,
+                        FILE_SHARE_READ | FILE_SHARE_DELETE,
+                        NULL,
+                        OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL,
+                        NULL);
+
+    if (hIndex == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&SavedPath);
+    Index->Offsets = NULL;
+    Result = FALSE;
+
+    if (!ReadFile(hIndex, &Header, sizeof(Header), &BytesRead, NULL) ||
+        BytesRead != sizeof(Header) ||
+        Header.Signature != Expected->Signature ||
+        Header.Version != Expected->Version ||
+        Header.LinesPerEntry != Expected->LinesPerEntry ||
+        Header.WideChars != Expected->WideChars ||
+        Header.FileSize.QuadPart != Expected->FileSize.QuadPart ||
+        Header.LastWriteTime.dwLowDateTime != Expected->LastWriteTime.dwLowDateTime ||
+        Header.LastWriteTime.dwHighDateTime != Expected->LastWriteTime.dwHighDateTime ||
+        Header.PathLengthInChars != FilePath->LengthInChars ||
+        Header.FileSize.QuadPart < 0) {
+
+        goto Exit;
+    }
+
+    //
+    //  The index is in a shared temporary directory, so don't trust the
+    //  counts in it.  Every line other than the last ends with a newline,
+    //  so a file can't have more lines than bytes, or more entries than
+    //  one per LinesPerEntry bytes plus one.  Limiting the entry count
+    //  also ensures the size of the offset array can't overflow.
+    //
+
+    if (Header.LineCount > (DWORDLONG)Header.FileSize.QuadPart + 1 ||
+        Header.EntryCount > (DWORDLONG)Header.FileSize.QuadPart / Header.LinesPerEntry + 1 ||
+        Header.EntryCount > ((DWORD)-1 - 1) / sizeof(DWORDLONG) ||
+        Header.EntryCount != (Header.LineCount + Header.LinesPerEntry - 1) / Header.LinesPerEntry) {
+
+        goto Exit;
+    }
+
+    if (!YoriLibAllocateString(&SavedPath, Header.PathLengthInChars + 1)) {
+        goto Exit;
+    }
+
+    BytesToRead = Header.PathLengthInChars * sizeof(TCHAR);
+    if (!ReadFile(hIndex, SavedPath.StartOfString, BytesToRead, &BytesRead, NULL) ||
+        BytesRead != BytesToRead) {
+
+        goto Exit;
+    }
+    SavedPath.LengthInChars = Header.PathLengthInChars;
+
+    if (YoriLibCompareStringInsensitive(&SavedPath, FilePath) != 0) {
+        goto Exit;
+    }
+
+    Index->Offsets = YoriLibMalloc(Header.EntryCount * sizeof(DWORDLONG) + 1);
+    if (Index->Offsets == NULL) {
+        goto Exit;
+    }
+
+    BytesToRead = Header.EntryCount * sizeof(DWORDLONG);
+    if (!ReadFile(hIndex, Index->Offsets, BytesToRead, &BytesRead, NULL) ||
+        BytesRead != BytesToRead) {
+
+        YoriLibFree(Index->Offsets);
+        Index->Offsets = NULL;
+        goto Exit;
+    }
+
+    for (Entry = 0; Entry < Header.EntryCount; Entry++) {
+        if (Index->Offsets[Entry] > (DWORDLONG)Header.FileSize.QuadPart) {
+            YoriLibFree(Index->Offsets);
+            Index->Offsets = NULL;
+            goto Exit;
+        }
+    }
+
+    Index->LineCount = Header.LineCount;
+    Index->EntryCount = Header.EntryCount;
+    Index->EntriesAllocated = Header.EntryCount;
+    Result = TRUE;
+
+Exit:
+    YoriLibFreeStringContents(&SavedPath);
+    CloseHandle(hIndex);
+    return Result;
+}
+
+/**
+ Save a line index so that later invocations can use it without scanning
+ the file.  Failure to save is not fatal, so no error is returned.
+
+ @param IndexFileName Pointer to the name of the index file to write.
+
+ @param Header Pointer to a header describing the state of the file when
+        it was indexed.
+
+ @param FilePath Pointer to the full path to the file that was indexed.
+
+ @param Index Pointer to the index to save.
+ */
+VOID
+StrideSaveIndex(
+    __in PYORI_STRING IndexFileName,
+    __in PSTRIDE_INDEX_HEADER Header,
+    __in PYORI_STRING FilePath,
+    __in PSTRIDE_INDEX Index
+    )
+{
+    HANDLE hIndex;
+    DWORD BytesWritten;
+    DWORD BytesToWrite;
+    BOOL Success;
+
+    hIndex = CreateFile(IndexFileName->StartOfString,
+                        GENERIC_WRITE,
+                        0,
+                        NULL,
+                        CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL,
+                        NULL);
+
+    if (hIndex == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    Header->LineCount = Index->LineCount;
+    Header->EntryCount = Index->EntryCount;
+    Header->PathLengthInChars = FilePath->LengthInChars;
+
+    Success = FALSE;
+    if (WriteFile(hIndex, Header, sizeof(STRIDE_INDEX_HEADER), &BytesWritten, NULL) &&
+        BytesWritten == sizeof(STRIDE_INDEX_HEADER)) {
+
+        BytesToWrite = FilePath->LengthInChars * sizeof(TCHAR);
+        if (WriteFile(hIndex, FilePath->StartOfString, BytesToWrite, &BytesWritten, NULL) &&
+            BytesWritten == BytesToWrite) {
+
+            BytesToWrite = Index->EntryCount * sizeof(DWORDLONG);
+            if (WriteFile(hIndex, Index->Offsets, BytesToWrite, &BytesWritten, NULL) &&
+                BytesWritten == BytesToWrite) {
+
+                Success = TRUE;
+            }
+        }
+    }
+
+    CloseHandle(hIndex);
+
+    //
+    //  Don't leave a partial index to be validated by a later invocation.
+    //
+
+    if (!Success) {
+        DeleteFile(IndexFileName->StartOfString);
+    }
+}
+
+/**
+ Sample a seekable file using a line index, so that the exact lines that
+ would be output by reading the file are output, but only the regions of
+ the file containing those lines are read.  If a saved index describing the
+ file exists it is used, otherwise the file is scanned once and the index
+ is saved for later invocations.
+
+ Indexed lines are located by line feed characters.  Files containing lines
+ terminated by a carriage return alone will be numbered differently to the
+ sequential case.
+
+ @param hSource The opened source file.
+
+ @param FilePath Pointer to the full path to the file.
+
+ @param FileSize The size of the file, in bytes.
+
+ @param StrideContext Pointer to context information specifying which lines
+        to display.
+
+ @return TRUE if the file was processed, FALSE if the index would not help
+         and the caller should read the file sequentially instead.
+ */
+BOOL
+StrideProcessIndexed(
+    __in HANDLE hSource,
+    __in PYORI_STRING FilePath,
+    __in DWORDLONG FileSize,
+    __in PSTRIDE_CONTEXT StrideContext
+    )
+{
+    STRIDE_INDEX_HEADER Header;
+    STRIDE_INDEX Index;
+    YORI_STRING IndexFileName;
+    DWORDLONG LineNumber;
+    DWORD Entry;
+
+    //
+    //  If consecutive samples are within one index entry of each other,
+    //  the index can't avoid reading the data between them.
+    //
+
+    if (StrideContext->Interval <= STRIDE_INDEX_LINES_PER_ENTRY ||
+        StrideContext->LinesOnEachInterval >= StrideContext->Interval) {
+
+        return FALSE;
+    }
+
+    ZeroMemory(&Header, sizeof(Header));
+    Header.Signature = STRIDE_INDEX_SIGNATURE;
+    Header.Version = STRIDE_INDEX_VERSION;
+    Header.LinesPerEntry = STRIDE_INDEX_LINES_PER_ENTRY;
+    if (YoriLibGetMultibyteInputEncoding() == CP_UTF16) {
+        Header.WideChars = TRUE;
+    }
+    Header.FileSize.QuadPart = FileSize;
+    if (!GetFileTime(hSource, NULL, NULL, &Header.LastWriteTime)) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&IndexFileName);
+    if (!StrideGetIndexFileName(FilePath, &IndexFileName)) {
+        return FALSE;
+    }
+
+    if (!StrideLoadIndex(&IndexFileName, &Header, FilePath, &Index)) {
+        if (!StrideBuildIndex(hSource, (BOOLEAN)Header.WideChars, &Index)) {
+            YoriLibFreeStringContents(&IndexFileName);
+            return FALSE;
+        }
+        StrideSaveIndex(&IndexFileName, &Header, FilePath, &Index);
+    }
+
+    YoriLibFreeStringContents(&IndexFileName);
+
+    StrideContext->FilesFound++;
+    StrideContext->FilesFoundThisArg++;
+
+    for (LineNumber = StrideContext->Offset; LineNumber < Index.LineCount; LineNumber += StrideContext->Interval) {
+        Entry = (DWORD)(LineNumber / STRIDE_INDEX_LINES_PER_ENTRY);
+        if (Entry >= Index.EntryCount) {
+            break;
+        }
+        if (!StrideOutputLinesAt(hSource,
+                                 Index.Offsets[Entry],
+                                 FALSE,
+                                 (DWORD)(LineNumber % STRIDE_INDEX_LINES_PER_ENTRY),
+                                 StrideContext->LinesOnEachInterval,
+                                 StrideContext)) {
+            break;
+        }
+    }
+
+    if (Index.Offsets != NULL) {
+        YoriLibFree(Index.Offsets);
+    }
+
     return TRUE;
 }
 
@@ -201,6 +979,8 @@ StrideFileFoundCallback(
     )
 {
     HANDLE FileHandle;
+    LARGE_INTEGER FileSize;
+    BOOL Processed;
     PSTRIDE_CONTEXT StrideContext = (PSTRIDE_CONTEXT)Context;
 
     UNREFERENCED_PARAMETER(Depth);
@@ -229,7 +1009,34 @@ StrideFileFoundCallback(
         }
 
         StrideContext->SavedErrorThisArg = ERROR_SUCCESS;
-        StrideProcessStream(FileHandle, StrideContext);
+
+        //
+        //  If the user asked to seek and the file supports it, try to
+        //  seek.  If that isn't possible or wouldn't help, rewind and
+        //  read the file.
+        //
+
+        Processed = FALSE;
+        if ((StrideContext->Approximate || StrideContext->Indexed) &&
+            GetFileType(FileHandle) == FILE_TYPE_DISK) {
+
+            FileSize.LowPart = GetFileSize(FileHandle, (LPDWORD)&FileSize.HighPart);
+            if (FileSize.LowPart != INVALID_FILE_SIZE || GetLastError() == NO_ERROR) {
+                if (StrideContext->Indexed) {
+                    Processed = StrideProcessIndexed(FileHandle, FilePath, FileSize.QuadPart, StrideContext);
+                } else {
+                    Processed = StrideProcessApproximate(FileHandle, FileSize.QuadPart, StrideContext);
+                }
+            }
+
+            if (!Processed && !StrideSeekTo(FileHandle, 0)) {
+                Processed = TRUE;
+            }
+        }
+
+        if (!Processed) {
+            StrideProcessStream(FileHandle, StrideContext);
+        }
 
         CloseHandle(FileHandle);
     }
@@ -333,11 +1140,16 @@ ENTRYPOINT(
     STRIDE_CONTEXT StrideContext;
     YORI_STRING Arg;
     DWORD CharsConsumed;
+    DWORD dwMode;
     LONGLONG llTemp;
 
     ZeroMemory(&StrideContext, sizeof(StrideContext));
     StrideContext.Interval = 10;
     StrideContext.LinesOnEachInterval = 1;
+    StrideContext.OutputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (GetConsoleMode(StrideContext.OutputHandle, &dwMode)) {
+        StrideContext.OutputIsConsole = TRUE;
+    }
 
     for (i = 1; i < ArgC; i++) {
 
@@ -349,8 +1161,12 @@ ENTRYPOINT(
                 StrideHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2017-2019"));
+                YoriLibDisplayMitLicense(_T("2017-2026"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("a")) == 0) {
+                StrideContext.Approximate = TRUE;
+                StrideContext.Indexed = FALSE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -387,6 +1203,10 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 StrideContext.Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("x")) == 0) {
+                StrideContext.Indexed = TRUE;
+                StrideContext.Approximate = FALSE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("-")) == 0) {
                 StartArg = i + 1;
                 ArgumentUnderstood = TRUE;
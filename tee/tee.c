@@ -3,7 +3,7 @@
  *
  * Yori shell output to a file and stdout
  *
- * Copyright (c) 2017-2023 Malcolm J. Smith
+ * Copyright (c) 2017-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -33,13 +33,16 @@
 const
 CHAR strTeeHelpText[] =
         "\n"
-        "Output the contents of standard input to standard output and a file.\n"
+        "Output the contents of standard input to standard output and files.\n"
         "\n"
-        "TEE [-license] -c\n"
-        "TEE [-license] [-a] <file>]\n"
+        "TEE [-license] [-a] [-c] [-d] [-s] [-p <cmd>...] [<file>...]\n"
         "\n"
-        "   -a             Append to the file\n"
-        "   -c             Write to the console and standard output\n";
+        "   -a             Append to files\n"
+        "   -c             Write to the console and standard output\n"
+        "   -d             Discard data for any output which falls too far behind\n"
+        "                    rather than waiting for it\n"
+        "   -p <cmd>       Write to the input of a program\n"
+        "   -s             Display statistics for each output when complete\n";
 
 /**
  Display usage text to the user.
@@ -56,71 +59,767 @@ TeeHelp(VOID)
 }
 
 /**
- Context passed to the callback which is invoked for each source stream
- processed.
+ The number of bytes to read from input at a time.
+ */
+#define TEE_BUFFER_SIZE (64 * 1024)
+
+/**
+ The number of buffers which can be waiting to be written to a single output.
+ When this is exceeded, reading input either waits for the output to catch
+ up, or discards data for that output.
+ */
+#define TEE_QUEUE_DEPTH (64)
+
+/**
+ A block of data read from input.  Each block is reference counted, with a
+ reference held by each output which has not yet written it.
+ */
+typedef struct _TEE_BUFFER {
+
+    /**
+     The number of bytes of Data which are populated.
+     */
+    DWORD BytesPopulated;
+
+    /**
+     The data read from input.
+     */
+    UCHAR Data[TEE_BUFFER_SIZE];
+
+} TEE_BUFFER, *PTEE_BUFFER;
+
+/**
+ A single output which receives a copy of input.  Each output is written by
+ its own thread from its own queue, so a slow output does not delay others.
+ */
+typedef struct _TEE_SINK {
+
+    /**
+     A name for the output, used when reporting errors or statistics.
+     */
+    YORI_STRING Name;
+
+    /**
+     Handle to the device to write to.
+     */
+    HANDLE hDevice;
+
+    /**
+     If the output is the input to a program, a handle to the process.
+     Otherwise NULL.
+     */
+    HANDLE hProcess;
+
+    /**
+     Handle to the thread writing to this output.
+     */
+    HANDLE hThread;
+
+    /**
+     A mutex protecting the queue.
+     */
+    HANDLE Mutex;
+
+    /**
+     An event signalled when a buffer is added to the queue, or the thread
+     should terminate.
+     */
+    HANDLE DataEvent;
+
+    /**
+     An event signalled when a buffer is removed from the queue.
+     */
+    HANDLE SpaceEvent;
+
+    /**
+     An array of buffers waiting to be written, used as a circular queue.
+     */
+    PTEE_BUFFER Queue[TEE_QUEUE_DEPTH];
+
+    /**
+     The index of the oldest buffer in the queue.
+     */
+    DWORD QueueHead;
+
+    /**
+     The number of buffers in the queue.
+     */
+    DWORD QueueCount;
+
+    /**
+     The number of bytes written to this output.
+     */
+    DWORDLONG BytesWritten;
+
+    /**
+     The number of bytes discarded because this output fell too far behind.
+     */
+    DWORDLONG BytesDropped;
+
+    /**
+     The tick count when the thread writing to this output started.
+     */
+    DWORD StartTime;
+
+    /**
+     The tick count when the most recent write to this output completed.
+     */
+    DWORD LastWriteTime;
+
+    /**
+     The error which caused writes to this output to fail, if Failed is
+     TRUE.
+     */
+    DWORD Error;
+
+    /**
+     When writing to a console, the number of bytes at the end of the
+     previous buffer which did not form a complete character.
+     */
+    DWORD CarryLength;
+
+    /**
+     When writing to a console, the bytes at the end of the previous buffer
+     which did not form a complete character.
+     */
+    UCHAR Carry[4];
+
+    /**
+     When writing to a console, a buffer containing the data to convert.
+     */
+    PUCHAR DecodeBuffer;
+
+    /**
+     When writing to a console, a buffer containing the converted text.
+     */
+    LPTSTR DisplayBuffer;
+
+    /**
+     TRUE if the output is a console, so data needs to be converted to text
+     before writing.
+     */
+    BOOLEAN IsConsole;
+
+    /**
+     TRUE if hDevice was opened by this program and should be closed.
+     */
+    BOOLEAN CloseDevice;
+
+    /**
+     TRUE if a write to this output failed.  Further data for this output
+     is discarded.
+     */
+    BOOLEAN Failed;
+
+    /**
+     TRUE if the thread should terminate when the queue is empty.
+     */
+    BOOLEAN Shutdown;
+
+} TEE_SINK, *PTEE_SINK;
+
+/**
+ Context describing the operation to perform.
  */
 typedef struct _TEE_CONTEXT {
 
     /**
-     Handle to a file which will receive all output in addition to standard
-     output.
+     An array of outputs.
      */
-    HANDLE hFile;
+    PTEE_SINK Sinks;
 
     /**
-     TRUE if hFile is a handle to a console; FALSE if it is a handle to a
-     different type of device.
+     The number of elements in the Sinks array which are initialized.
      */
-    BOOLEAN FileIsConsole;
+    DWORD SinkCount;
+
+    /**
+     TRUE if data for an output should be discarded when its queue is full.
+     FALSE if reading input should wait until the output has written data
+     from its queue.
+     */
+    BOOLEAN DiscardWhenFull;
+
+    /**
+     TRUE if statistics should be displayed for each output on completion.
+     */
+    BOOLEAN DisplayStatistics;
 
 } TEE_CONTEXT, *PTEE_CONTEXT;
 
 /**
- Write a single line to an output device.
+ Determine how many bytes in a buffer form complete characters in the input
+ encoding.  Bytes after this form part of a character which continues in the
+ next buffer.
+
+ @param Buffer Pointer to the buffer.
+
+ @param Length The number of bytes in the buffer.
+
+ @return The number of bytes which form complete characters.
+ */
+DWORD
+TeeGetCompleteLength(
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD Encoding;
+    DWORD Index;
+    DWORD SequenceLength;
+    UCHAR Char;
+
+    Encoding = YoriLibGetMultibyteInputEncoding();
+    if (Encoding == CP_UTF16) {
+        return Length & ~(1);
+    }
+
+    if (Encoding != CP_UTF8) {
+        return Length;
+    }
+
+    //
+    //  Look for the byte which starts the final character, and check
+    //  whether all of its bytes are present.
+    //
+
+    for (Index = 1; Index <= 4 && Index <= Length; Index++) {
+        Char = Buffer[Length - Index];
+        if ((Char & 0xC0) != 0x80) {
+            if (Char >= 0xF0) {
+                SequenceLength = 4;
+            } else if (Char >= 0xE0) {
+                SequenceLength = 3;
+            } else if (Char >= 0xC0) {
+                SequenceLength = 2;
+            } else {
+                SequenceLength = 1;
+            }
+
+            if (SequenceLength > Index) {
+                return Length - Index;
+            }
+            break;
+        }
+    }
+
+    return Length;
+}
+
+/**
+ Write a buffer to a console.  The buffer is converted from the input
+ encoding, carrying any partial character into the next buffer.
+
+ @param Sink Pointer to the output, which refers to a console.
+
+ @param Buffer Pointer to the data to write.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+TeeWriteToConsole(
+    __in PTEE_SINK Sink,
+    __in PTEE_BUFFER Buffer
+    )
+{
+    YORI_STRING Text;
+    DWORD Length;
+    DWORD CompleteLength;
+    DWORD CharsNeeded;
+
+    if (Sink->DecodeBuffer == NULL) {
+        Sink->DecodeBuffer = YoriLibMalloc(TEE_BUFFER_SIZE + sizeof(Sink->Carry));
+        Sink->DisplayBuffer = YoriLibMalloc((TEE_BUFFER_SIZE + sizeof(Sink->Carry)) * sizeof(TCHAR));
+        if (Sink->DecodeBuffer == NULL || Sink->DisplayBuffer == NULL) {
+            Sink->Error = ERROR_NOT_ENOUGH_MEMORY;
+            return FALSE;
+        }
+    }
+
+    memcpy(Sink->DecodeBuffer, Sink->Carry, Sink->CarryLength);
+    memcpy(Sink->DecodeBuffer + Sink->CarryLength, Buffer->Data, Buffer->BytesPopulated);
+    Length = Sink->CarryLength + Buffer->BytesPopulated;
+
+    CompleteLength = TeeGetCompleteLength(Sink->DecodeBuffer, Length);
+    Sink->CarryLength = Length - CompleteLength;
+    memcpy(Sink->Carry, Sink->DecodeBuffer + CompleteLength, Sink->CarryLength);
+
+    if (CompleteLength == 0) {
+        return TRUE;
+    }
+
+    if (YoriLibGetMultibyteInputEncoding() == CP_UTF16) {
+        CharsNeeded = CompleteLength / sizeof(WCHAR);
+        YoriLibMultibyteInput((LPCSTR)Sink->DecodeBuffer, CharsNeeded, Sink->DisplayBuffer, CharsNeeded);
+    } else {
+        CharsNeeded = YoriLibGetMultibyteInputSizeNeeded((LPCSTR)Sink->DecodeBuffer, CompleteLength);
+        if (CharsNeeded > TEE_BUFFER_SIZE + sizeof(Sink->Carry)) {
+            Sink->Error = ERROR_INSUFFICIENT_BUFFER;
+            return FALSE;
+        }
+        YoriLibMultibyteInput((LPCSTR)Sink->DecodeBuffer, CompleteLength, Sink->DisplayBuffer, CharsNeeded);
+    }
+
+    YoriLibInitEmptyString(&Text);
+    Text.StartOfString = Sink->DisplayBuffer;
+    Text.LengthInChars = CharsNeeded;
+    YoriLibOutputToDevice(Sink->hDevice, 0, _T("%y"), &Text);
+    return TRUE;
+}
+
+/**
+ Write a buffer to an output.
+
+ @param Sink Pointer to the output.
+
+ @param Buffer Pointer to the data to write.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+TeeWriteToSink(
+    __in PTEE_SINK Sink,
+    __in PTEE_BUFFER Buffer
+    )
+{
+    DWORD BytesWritten;
+    DWORD Offset;
+
+    if (Sink->IsConsole) {
+        return TeeWriteToConsole(Sink, Buffer);
+    }
+
+    Offset = 0;
+    while (Offset < Buffer->BytesPopulated) {
+        if (!WriteFile(Sink->hDevice, Buffer->Data + Offset, Buffer->BytesPopulated - Offset, &BytesWritten, NULL)) {
+            Sink->Error = GetLastError();
+            return FALSE;
+        }
+        Offset = Offset + BytesWritten;
+    }
+
+    return TRUE;
+}
+
+/**
+ A thread which writes buffers from the queue of a single output until told
+ to terminate.
+
+ @param Context Pointer to the output.
+
+ @return TRUE to indicate all data was written, FALSE if a write failed.
+ */
+DWORD WINAPI
+TeeSinkWorker(
+    __in LPVOID Context
+    )
+{
+    PTEE_SINK Sink = (PTEE_SINK)Context;
+    PTEE_BUFFER Buffer;
+
+    Sink->StartTime = GetTickCount();
+    Sink->LastWriteTime = Sink->StartTime;
+
+    while (TRUE) {
+        WaitForSingleObject(Sink->Mutex, INFINITE);
+        if (Sink->QueueCount > 0) {
+            Buffer = Sink->Queue[Sink->QueueHead];
+            Sink->Queue[Sink->QueueHead] = NULL;
+            Sink->QueueHead = (Sink->QueueHead + 1) % TEE_QUEUE_DEPTH;
+            Sink->QueueCount--;
+            ReleaseMutex(Sink->Mutex);
+            SetEvent(Sink->SpaceEvent);
+
+            //
+            //  If writing has failed, keep removing buffers from the queue
+            //  so input is never waiting for this output.
+            //
+
+            if (!Sink->Failed) {
+                if (TeeWriteToSink(Sink, Buffer)) {
+                    Sink->BytesWritten = Sink->BytesWritten + Buffer->BytesPopulated;
+                    Sink->LastWriteTime = GetTickCount();
+                } else {
+                    Sink->Failed = TRUE;
+                }
+            }
+            YoriLibDereference(Buffer);
+            continue;
+        }
+
+        if (Sink->Shutdown) {
+            ReleaseMutex(Sink->Mutex);
+            break;
+        }
+
+        ReleaseMutex(Sink->Mutex);
+        WaitForSingleObject(Sink->DataEvent, INFINITE);
+    }
+
+    if (Sink->Failed) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ Add a buffer to the queue of an output.  If the queue is full, this either
+ waits for space or discards the buffer for this output, depending on the
+ policy specified by the user.
+
+ @param TeeContext Pointer to the context describing the policy to apply.
+
+ @param Sink Pointer to the output.
+
+ @param Buffer Pointer to the buffer to add.
+ */
+VOID
+TeeQueueBuffer(
+    __in PTEE_CONTEXT TeeContext,
+    __in PTEE_SINK Sink,
+    __in PTEE_BUFFER Buffer
+    )
+{
+    WaitForSingleObject(Sink->Mutex, INFINITE);
+    while (Sink->QueueCount == TEE_QUEUE_DEPTH && !Sink->Failed) {
+        if (TeeContext->DiscardWhenFull) {
+            Sink->BytesDropped = Sink->BytesDropped + Buffer->BytesPopulated;
+            ReleaseMutex(Sink->Mutex);
+            return;
+        }
+        ReleaseMutex(Sink->Mutex);
+        WaitForSingleObject(Sink->SpaceEvent, INFINITE);
+        WaitForSingleObject(Sink->Mutex, INFINITE);
+    }
+
+    if (Sink->Failed) {
+        ReleaseMutex(Sink->Mutex);
+        return;
+    }
+
+    YoriLibReference(Buffer);
+    Sink->Queue[(Sink->QueueHead + Sink->QueueCount) % TEE_QUEUE_DEPTH] = Buffer;
+    Sink->QueueCount++;
+    ReleaseMutex(Sink->Mutex);
+    SetEvent(Sink->DataEvent);
+}
+
+/**
+ Prepare an output for use, and start the thread which writes to it.
+
+ @param Sink Pointer to the output, where Name and hDevice have been
+        initialized.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+TeeStartSink(
+    __inout PTEE_SINK Sink
+    )
+{
+    DWORD ConsoleMode;
+    DWORD ThreadId;
 
- @param hDevice Handle to the output device.
+    if (GetConsoleMode(Sink->hDevice, &ConsoleMode)) {
+        Sink->IsConsole = TRUE;
+    }
+
+    Sink->Mutex = CreateMutex(NULL, FALSE, NULL);
+    Sink->DataEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    Sink->SpaceEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (Sink->Mutex == NULL || Sink->DataEvent == NULL || Sink->SpaceEvent == NULL) {
+        return FALSE;
+    }
+
+    Sink->hThread = CreateThread(NULL, 0, TeeSinkWorker, Sink, 0, &ThreadId);
+    if (Sink->hThread == NULL) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
 
- @param IsConsole TRUE if the output device is a console; FALSE if it is not.
-        This is used to determine whether a newline needs to be inserted in
-        cases where the console has advanced to the next line automatically.
+/**
+ Wait for an output to write all queued data, terminate its thread, and
+ free any resources associated with it.
 
- @param Line Pointer to the line to output.
+ @param Sink Pointer to the output.
  */
 VOID
-TeeWriteLine(
-    __in HANDLE hDevice,
-    __in BOOLEAN IsConsole,
-    __in PYORI_STRING Line
+TeeStopSink(
+    __inout PTEE_SINK Sink
     )
 {
-    CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
+    if (Sink->hThread != NULL) {
+        WaitForSingleObject(Sink->Mutex, INFINITE);
+        Sink->Shutdown = TRUE;
+        ReleaseMutex(Sink->Mutex);
+        SetEvent(Sink->DataEvent);
+        WaitForSingleObject(Sink->hThread, INFINITE);
+        CloseHandle(Sink->hThread);
+        Sink->hThread = NULL;
+    }
+
+    if (Sink->Mutex != NULL) {
+        CloseHandle(Sink->Mutex);
+        Sink->Mutex = NULL;
+    }
+    if (Sink->DataEvent != NULL) {
+        CloseHandle(Sink->DataEvent);
+        Sink->DataEvent = NULL;
+    }
+    if (Sink->SpaceEvent != NULL) {
+        CloseHandle(Sink->SpaceEvent);
+        Sink->SpaceEvent = NULL;
+    }
 
     //
-    //  If it's not a console, output the line and newline in one operation.
-    //  If it is a console, output the line, and see where the cursor is,
-    //  then optionally include a newline.
+    //  Closing the input to a program indicates the end of data, so the
+    //  program can complete.
     //
 
-    if (!IsConsole) {
-        YoriLibOutputToDevice(hDevice, 0, _T("%y\n"), Line);
+    if (Sink->CloseDevice && Sink->hDevice != NULL) {
+        CloseHandle(Sink->hDevice);
+        Sink->hDevice = NULL;
+    }
+
+    if (Sink->hProcess != NULL) {
+        WaitForSingleObject(Sink->hProcess, INFINITE);
+        CloseHandle(Sink->hProcess);
+        Sink->hProcess = NULL;
+    }
+
+    if (Sink->DecodeBuffer != NULL) {
+        YoriLibFree(Sink->DecodeBuffer);
+        Sink->DecodeBuffer = NULL;
+    }
+    if (Sink->DisplayBuffer != NULL) {
+        YoriLibFree(Sink->DisplayBuffer);
+        Sink->DisplayBuffer = NULL;
+    }
+}
+
+/**
+ Launch a program whose input is a copy of the input to tee.  The program's
+ output and errors go to the same place as the output and errors of tee.
+
+ @param CmdLine Pointer to the command line of the program.
+
+ @param Sink Pointer to the output to initialize with a handle to the
+        program's input and a handle to the program.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+TeeLaunchProgram(
+    __in PYORI_STRING CmdLine,
+    __inout PTEE_SINK Sink
+    )
+{
+    STARTUPINFO StartupInfo;
+    PROCESS_INFORMATION ProcessInfo;
+    YORI_STRING CmdLineCopy;
+    HANDLE hProcessInput;
+    HANDLE hParentOutput;
+    HANDLE hProcessOutput;
+    HANDLE hProcessError;
+    DWORD LastError;
+    LPTSTR ErrText;
+    BOOL Result;
+
+    //
+    //  CreateProcess can modify the command line, so give it a copy.
+    //
+
+    if (!YoriLibCopyString(&CmdLineCopy, CmdLine)) {
+        return FALSE;
+    }
+
+    if (!CreatePipe(&hProcessInput, &hParentOutput, NULL, 0)) {
+        YoriLibFreeStringContents(&CmdLineCopy);
+        return FALSE;
+    }
+
+    hProcessOutput = NULL;
+    hProcessError = NULL;
+    if (!YoriLibMakeInheritableHandle(hProcessInput, &hProcessInput) ||
+        !DuplicateHandle(GetCurrentProcess(), GetStdHandle(STD_OUTPUT_HANDLE), GetCurrentProcess(), &hProcessOutput, 0, TRUE, DUPLICATE_SAME_ACCESS) ||
+        !DuplicateHandle(GetCurrentProcess(), GetStdHandle(STD_ERROR_HANDLE), GetCurrentProcess(), &hProcessError, 0, TRUE, DUPLICATE_SAME_ACCESS)) {
+
+        Result = FALSE;
     } else {
-        YoriLibOutputToDevice(hDevice, 0, _T("%y"), Line);
-        if (Line->LengthInChars == 0 ||
-            !GetConsoleScreenBufferInfo(hDevice, &ScreenInfo) ||
-            ScreenInfo.dwCursorPosition.X != 0) {
+        ZeroMemory(&StartupInfo, sizeof(StartupInfo));
+        StartupInfo.cb = sizeof(StartupInfo);
+        StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+        StartupInfo.hStdInput = hProcessInput;
+        StartupInfo.hStdOutput = hProcessOutput;
+        StartupInfo.hStdError = hProcessError;
+
+        Result = CreateProcess(NULL,
+                               CmdLineCopy.StartOfString,
+                               NULL,
+                               NULL,
+                               TRUE,
+                               CREATE_DEFAULT_ERROR_MODE,
+                               NULL,
+                               NULL,
+                               &StartupInfo,
+                               &ProcessInfo);
+    }
 
-            YoriLibOutputToDevice(hDevice, 0, _T("\n"));
+    if (!Result) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: launch of %y failed: %s"), CmdLine, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        CloseHandle(hParentOutput);
+    } else {
+        CloseHandle(ProcessInfo.hThread);
+        Sink->hProcess = ProcessInfo.hProcess;
+        Sink->hDevice = hParentOutput;
+        Sink->CloseDevice = TRUE;
+    }
+
+    CloseHandle(hProcessInput);
+    if (hProcessOutput != NULL) {
+        CloseHandle(hProcessOutput);
+    }
+    if (hProcessError != NULL) {
+        CloseHandle(hProcessError);
+    }
+    YoriLibFreeStringContents(&CmdLineCopy);
+    return Result;
+}
+
+/**
+ Open a file to receive a copy of input.
+
+ @param FileName Pointer to the name of the file, as specified by the user.
+        This is ignored if Console is TRUE.
+
+ @param Console TRUE if the file name refers to the console.
+
+ @param Append TRUE if data should be appended to the file, FALSE if the file
+        should be overwritten.
+
+ @param Sink Pointer to the output to initialize with the name and handle of
+        the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+TeeOpenFile(
+    __in_opt PYORI_STRING FileName,
+    __in BOOLEAN Console,
+    __in BOOLEAN Append,
+    __inout PTEE_SINK Sink
+    )
+{
+    DWORD DesiredAccess;
+
+    if (Console) {
+        YoriLibConstantString(&Sink->Name, _T("CONOUT$"));
+
+        //
+        //  Open for read and write so we can query the cursor location.
+        //
+
+        DesiredAccess = GENERIC_READ | GENERIC_WRITE;
+    } else {
+
+        if (!YoriLibUserStringToSingleFilePath(FileName, TRUE, &Sink->Name)) {
+            DWORD LastError = GetLastError();
+            LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: getfullpathname of %y failed: %s"), FileName, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            return FALSE;
         }
+
+        DesiredAccess = (Append?FILE_APPEND_DATA:FILE_WRITE_DATA) | SYNCHRONIZE;
     }
+
+    Sink->hDevice = CreateFile(Sink->Name.StartOfString,
+                               DesiredAccess,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               NULL,
+                               OPEN_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL,
+                               NULL);
+
+    if (Sink->hDevice == INVALID_HANDLE_VALUE || Sink->hDevice == NULL) {
+        DWORD LastError = GetLastError();
+        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: open of %y failed: %s"), &Sink->Name, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        Sink->hDevice = NULL;
+        return FALSE;
+    }
+
+    Sink->CloseDevice = TRUE;
+    return TRUE;
 }
 
 /**
- Process a single stream.
+ Display the amount of data written to each output and the rate at which it
+ was written.
+
+ @param TeeContext Pointer to the context containing the outputs.
+ */
+VOID
+TeeDisplayStatistics(
+    __in PTEE_CONTEXT TeeContext
+    )
+{
+    PTEE_SINK Sink;
+    YORI_STRING SizeString;
+    YORI_STRING RateString;
+    TCHAR SizeStringBuffer[16];
+    TCHAR RateStringBuffer[16];
+    LARGE_INTEGER liSize;
+    DWORD Elapsed;
+    DWORD Index;
+
+    YoriLibInitEmptyString(&SizeString);
+    SizeString.StartOfString = SizeStringBuffer;
+    SizeString.LengthAllocated = sizeof(SizeStringBuffer)/sizeof(SizeStringBuffer[0]);
+
+    YoriLibInitEmptyString(&RateString);
+    RateString.StartOfString = RateStringBuffer;
+    RateString.LengthAllocated = sizeof(RateStringBuffer)/sizeof(RateStringBuffer[0]);
+
+    for (Index = 0; Index < TeeContext->SinkCount; Index++) {
+        Sink = &TeeContext->Sinks[Index];
+
+        Elapsed = Sink->LastWriteTime - Sink->StartTime;
+        if (Elapsed == 0) {
+            Elapsed = 1;
+        }
+
+        liSize.QuadPart = Sink->BytesWritten;
+        YoriLibFileSizeToString(&SizeString, &liSize);
+        liSize.QuadPart = Sink->BytesWritten * 1000 / Elapsed;
+        YoriLibFileSizeToString(&RateString, &liSize);
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%y: %y written in %i ms, %y/s"), &Sink->Name, &SizeString, Elapsed, &RateString);
+        if (Sink->BytesDropped > 0) {
+            liSize.QuadPart = Sink->BytesDropped;
+            YoriLibFileSizeToString(&SizeString, &liSize);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T(", %y discarded"), &SizeString);
+        }
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("\n"));
+    }
+}
+
+/**
+ Read from a single stream and copy it to all outputs.
 
  @param hSource Handle to the source.
 
- @param TeeContext Pointer to the context for the operation, including a
-        handle to the output stream to write data to.
+ @param TeeContext Pointer to the context for the operation, including the
+        outputs to write data to.
 
  @return TRUE to indicate success or FALSE to indicate failure.
  */
@@ -130,34 +829,30 @@ TeeProcessStream(
     __in PTEE_CONTEXT TeeContext
     )
 {
-    PVOID LineContext = NULL;
-    DWORD Junk;
-    YORI_STRING LineString;
-    HANDLE StdOutHandle;
-    BOOLEAN StdOutIsConsole;
-
-    StdOutIsConsole = FALSE;
-
-    StdOutHandle = GetStdHandle(STD_OUTPUT_HANDLE);
-    if (GetConsoleMode(StdOutHandle, &Junk)) {
-        StdOutIsConsole = TRUE;
-    }
-
-    YoriLibInitEmptyString(&LineString);
+    PTEE_BUFFER Buffer;
+    DWORD BytesRead;
+    DWORD Index;
 
     while (TRUE) {
+        Buffer = YoriLibReferencedMalloc(sizeof(TEE_BUFFER));
+        if (Buffer == NULL) {
+            return FALSE;
+        }
+
+        if (!ReadFile(hSource, Buffer->Data, TEE_BUFFER_SIZE, &BytesRead, NULL) ||
+            BytesRead == 0) {
 
-        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+            YoriLibDereference(Buffer);
             break;
         }
 
-        TeeWriteLine(StdOutHandle, StdOutIsConsole, &LineString);
-        TeeWriteLine(TeeContext->hFile, TeeContext->FileIsConsole, &LineString);
+        Buffer->BytesPopulated = BytesRead;
+        for (Index = 0; Index < TeeContext->SinkCount; Index++) {
+            TeeQueueBuffer(TeeContext, &TeeContext->Sinks[Index], Buffer);
+        }
+        YoriLibDereference(Buffer);
     }
 
-    YoriLibLineReadCloseOrCache(LineContext);
-    YoriLibFreeStringContents(&LineString);
-
     return TRUE;
 }
 
@@ -192,15 +887,22 @@ ENTRYPOINT(
     BOOL ArgumentUnderstood;
     DWORD i;
     DWORD StartArg = 0;
-    DWORD DesiredAccess;
+    DWORD ProgramCount = 0;
+    DWORD Result;
+    PDWORD ProgramArgs;
+    PTEE_SINK Sink;
     BOOLEAN Append = FALSE;
     BOOLEAN Console = FALSE;
     TEE_CONTEXT TeeContext;
-    YORI_STRING FileName;
     YORI_STRING Arg;
 
     ZeroMemory(&TeeContext, sizeof(TeeContext));
 
+    ProgramArgs = YoriLibMalloc(ArgC * sizeof(DWORD));
+    if (ProgramArgs == NULL) {
+        return EXIT_FAILURE;
+    }
+
     for (i = 1; i < ArgC; i++) {
 
         ArgumentUnderstood = FALSE;
@@ -210,9 +912,11 @@ ENTRYPOINT(
 
             if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("?")) == 0) {
                 TeeHelp();
+                YoriLibFree(ProgramArgs);
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2017-2023"));
+                YoriLibDisplayMitLicense(_T("2017-2026"));
+                YoriLibFree(ProgramArgs);
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("a")) == 0) {
                 Append = TRUE;
@@ -220,6 +924,19 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c")) == 0) {
                 Console = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("d")) == 0) {
+                TeeContext.DiscardWhenFull = TRUE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("p")) == 0) {
+                if (ArgC > i + 1) {
+                    ProgramArgs[ProgramCount] = i + 1;
+                    ProgramCount++;
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
+                TeeContext.DisplayStatistics = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("-")) == 0) {
                 StartArg = i + 1;
                 ArgumentUnderstood = TRUE;
@@ -236,69 +953,117 @@ ENTRYPOINT(
         }
     }
 
-    //
-    //  If no file name is specified, use stdin; otherwise open
-    //  the file and use that
-    //
+    if (StartArg == 0) {
+        StartArg = ArgC;
+    }
 
-    if (!Console && (StartArg == 0 || StartArg == ArgC)) {
+    if (!Console && ProgramCount == 0 && StartArg == ArgC) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: argument missing\n"));
+        YoriLibFree(ProgramArgs);
         return EXIT_FAILURE;
     }
 
     if (YoriLibIsStdInConsole()) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: No file or pipe for input\n"));
+        YoriLibFree(ProgramArgs);
         return EXIT_FAILURE;
     }
 
-    if (Console) {
-        YoriLibConstantString(&FileName, _T("CONOUT$"));
-        TeeContext.FileIsConsole = TRUE;
+    //
+    //  Outputs are standard output, the console if requested, each file,
+    //  and each program.
+    //
+
+    TeeContext.Sinks = YoriLibMalloc((2 + (ArgC - StartArg) + ProgramCount) * sizeof(TEE_SINK));
+    if (TeeContext.Sinks == NULL) {
+        YoriLibFree(ProgramArgs);
+        return EXIT_FAILURE;
+    }
+
+    Result = EXIT_SUCCESS;
+
+    Sink = &TeeContext.Sinks[TeeContext.SinkCount];
+    ZeroMemory(Sink, sizeof(TEE_SINK));
+    YoriLibConstantString(&Sink->Name, _T("(stdout)"));
+    Sink->hDevice = GetStdHandle(STD_OUTPUT_HANDLE);
+    TeeContext.SinkCount++;
+    if (!TeeStartSink(Sink)) {
+        Result = EXIT_FAILURE;
+    }
+
+    if (Result == EXIT_SUCCESS && Console) {
+        Sink = &TeeContext.Sinks[TeeContext.SinkCount];
+        ZeroMemory(Sink, sizeof(TEE_SINK));
+        TeeContext.SinkCount++;
+        if (!TeeOpenFile(NULL, TRUE, FALSE, Sink) ||
+            !TeeStartSink(Sink)) {
+
+            Result = EXIT_FAILURE;
+        }
+    }
+
+    for (i = StartArg; Result == EXIT_SUCCESS && i < ArgC; i++) {
+        Sink = &TeeContext.Sinks[TeeContext.SinkCount];
+        ZeroMemory(Sink, sizeof(TEE_SINK));
+        TeeContext.SinkCount++;
+        if (!TeeOpenFile(&ArgV[i], FALSE, Append, Sink) ||
+            !TeeStartSink(Sink)) {
+
+            Result = EXIT_FAILURE;
+        }
+    }
+
+    for (i = 0; Result == EXIT_SUCCESS && i < ProgramCount; i++) {
+        Sink = &TeeContext.Sinks[TeeContext.SinkCount];
+        ZeroMemory(Sink, sizeof(TEE_SINK));
+        TeeContext.SinkCount++;
+        YoriLibCloneString(&Sink->Name, &ArgV[ProgramArgs[i]]);
+        if (!TeeLaunchProgram(&ArgV[ProgramArgs[i]], Sink) ||
+            !TeeStartSink(Sink)) {
+
+            Result = EXIT_FAILURE;
+        }
+    }
+
+    if (Result == EXIT_SUCCESS) {
+        TeeProcessStream(GetStdHandle(STD_INPUT_HANDLE), &TeeContext);
+    }
+
+    for (i = 0; i < TeeContext.SinkCount; i++) {
+        TeeStopSink(&TeeContext.Sinks[i]);
+    }
+
+    for (i = 0; i < TeeContext.SinkCount; i++) {
+        Sink = &TeeContext.Sinks[i];
 
         //
-        //  Open for read and write so we can query the cursor location.
+        //  A reader which exits without reading all of its input is not
+        //  treated as an error.
         //
 
-        DesiredAccess = GENERIC_READ | GENERIC_WRITE;
-    } else {
+        if (Sink->Failed &&
+            Sink->Error != ERROR_NO_DATA &&
+            Sink->Error != ERROR_BROKEN_PIPE) {
 
-        if (!YoriLibUserStringToSingleFilePath(&ArgV[StartArg], TRUE, &FileName)) {
-            DWORD LastError = GetLastError();
-            LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: getfullpathname of %y failed: %s"), &ArgV[StartArg], ErrText);
+            LPTSTR ErrText = YoriLibGetWinErrorText(Sink->Error);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: write to %y failed: %s"), &Sink->Name, ErrText);
             YoriLibFreeWinErrorText(ErrText);
-            return EXIT_FAILURE;
+            Result = EXIT_FAILURE;
         }
-        DesiredAccess = (Append?FILE_APPEND_DATA:FILE_WRITE_DATA) | SYNCHRONIZE;
     }
 
-    TeeContext.hFile = CreateFile(FileName.StartOfString,
-                                  DesiredAccess,
-                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-                                  NULL,
-                                  OPEN_ALWAYS,
-                                  FILE_ATTRIBUTE_NORMAL,
-                                  NULL);
-
-    if (TeeContext.hFile == INVALID_HANDLE_VALUE || TeeContext.hFile == NULL) {
-        DWORD LastError = GetLastError();
-        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: open of %y failed: %s"), &FileName, ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        YoriLibFreeStringContents(&FileName);
-        return EXIT_FAILURE;
+    if (Result == EXIT_SUCCESS && TeeContext.DisplayStatistics) {
+        TeeDisplayStatistics(&TeeContext);
     }
 
-    TeeProcessStream(GetStdHandle(STD_INPUT_HANDLE), &TeeContext);
-
-#if !YORI_BUILTIN
-    YoriLibLineReadCleanupCache();
-#endif
+    for (i = 0; i < TeeContext.SinkCount; i++) {
+        YoriLibFreeStringContents(&TeeContext.Sinks[i].Name);
+    }
 
-    CloseHandle(TeeContext.hFile);
-    YoriLibFreeStringContents(&FileName);
+    YoriLibFree(TeeContext.Sinks);
+    YoriLibFree(ProgramArgs);
 
-    return EXIT_SUCCESS;
+    return Result;
 }
 
 // vim:sw=4:ts=4:et:
@@ -0,0 +1,489 @@
+/**
+ * @file test/bench.c
+ *
+ * Yori library benchmark suite
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "bench.h"
+
+/**
+ Help text to display to the user.
+ */
+const
+CHAR strBenchHelpText[] =
+        "\n"
+        "Run library benchmarks and output results as JSON.\n"
+        "\n"
+        "YBENCH [-license] [-r Runs] [-s Scale] [-v Benchmark] [-x Benchmark]\n"
+        "\n"
+        "   -r             The number of timed runs per benchmark, default 5\n"
+        "   -s             A multiplier for the work performed per run, default 1\n"
+        "   -v             Benchmark to include\n"
+        "   -x             Benchmark to exclude\n"
+        "\n"
+        "Supported benchmarks:\n";
+
+/**
+ A structure to describe a benchmark.
+ */
+typedef struct _BENCH_VARIATION {
+
+    /**
+     The function to call to invoke the benchmark.
+     */
+    PYORI_BENCH_FN Fn;
+
+    /**
+     The name of the benchmark.
+     */
+    LPCTSTR Name;
+
+    /**
+     If TRUE, the execution status of this benchmark was set explicitly via
+     command line parameter.  If FALSE, default execution should apply.
+     */
+    BOOLEAN ExplicitlySpecified;
+
+    /**
+     If TRUE, the benchmark should execute.  If FALSE, it should not.  Only
+     meaningful when ExplicitlySpecified is TRUE.
+     */
+    BOOLEAN Execute;
+
+} BENCH_VARIATION, *PBENCH_VARIATION;
+
+/**
+ A list of benchmarks to execute.  Names are emitted into the JSON output and
+ are used to compare results between releases, so should not be changed once
+ published.
+ */
+BENCH_VARIATION BenchVariations[] = {
+    {BenchStringCompare,                   _T("StringCompare")},
+    {BenchStringSearch,                    _T("StringSearch")},
+    {BenchStringSort,                      _T("StringSort")},
+    {BenchHashTable,                       _T("HashTable")},
+    {BenchOutputFormat,                    _T("OutputFormat")},
+    {BenchVariableExpand,                  _T("VariableExpand")},
+    {BenchLineReadAnsi,                    _T("LineReadAnsi")},
+    {BenchLineReadUtf8,                    _T("LineReadUtf8")},
+    {BenchLineReadUtf16,                   _T("LineReadUtf16")},
+    {BenchDirEnum,                         _T("DirEnum")},
+    {BenchArgParse,                        _T("ArgParse")},
+    {BenchExecPlan,                        _T("ExecPlan")},
+};
+
+/**
+ Display usage text to the user.
+ */
+BOOL
+BenchHelp(VOID)
+{
+    DWORD i;
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("YBench %i.%02i\n"), YORI_VER_MAJOR, YORI_VER_MINOR);
+#if YORI_BUILD_ID
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Build %i\n"), YORI_BUILD_ID);
+#endif
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%hs"), strBenchHelpText);
+    for (i = 0; i < sizeof(BenchVariations)/sizeof(BenchVariations[0]); i++) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("    %s\n"), BenchVariations[i].Name);
+    }
+    return TRUE;
+}
+
+/**
+ Indicate that a benchmark is about to commence the code being measured.
+
+ @param Result Pointer to the benchmark state.
+ */
+VOID
+BenchBeginRun(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    QueryPerformanceCounter(&Result->RunStart);
+}
+
+/**
+ Indicate that a benchmark has completed the code being measured.
+
+ @param Result Pointer to the benchmark state.
+
+ @param Operations The number of operations performed in the run.
+ */
+VOID
+BenchEndRun(
+    __inout PYORI_BENCH_RESULT Result,
+    __in DWORDLONG Operations
+    )
+{
+    LARGE_INTEGER RunEnd;
+
+    QueryPerformanceCounter(&RunEnd);
+    ASSERT(Result->RunsCompleted < YORI_BENCH_MAX_RUNS);
+    Result->Ticks[Result->RunsCompleted] = (DWORDLONG)(RunEnd.QuadPart - Result->RunStart.QuadPart);
+    Result->OperationsPerRun = Operations;
+    Result->RunsCompleted++;
+}
+
+/**
+ Generate a pseudo random number.  This is deliberately deterministic so that
+ each benchmark operates on identical data across runs and releases.
+
+ @param Seed Pointer to the generator state, updated on return.
+
+ @return A pseudo random number.
+ */
+DWORD
+BenchRandom(
+    __inout PDWORD Seed
+    )
+{
+    *Seed = *Seed * 1103515245 + 12345;
+    return (*Seed >> 16) & 0x7FFF;
+}
+
+/**
+ Generate an array of pseudo random strings.
+
+ @param Count The number of strings to generate.
+
+ @param MinimumLength The minimum length of each string, in characters.
+
+ @param MaximumLength The maximum length of each string, in characters.
+
+ @param Seed The initial seed for the generator.
+
+ @param StringArray On successful completion, populated with an array of
+        strings.  This should be freed with @ref BenchFreeStrings .
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+BenchGenerateStrings(
+    __in DWORD Count,
+    __in DWORD MinimumLength,
+    __in DWORD MaximumLength,
+    __in DWORD Seed,
+    __out PYORI_STRING *StringArray
+    )
+{
+    LPCTSTR Alphabet = _T("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_.");
+    PYORI_STRING Strings;
+    DWORD Index;
+    DWORD CharIndex;
+    DWORD Length;
+
+    Strings = YoriLibMalloc(Count * sizeof(YORI_STRING));
+    if (Strings == NULL) {
+        return FALSE;
+    }
+
+    for (Index = 0; Index < Count; Index++) {
+        Length = MinimumLength;
+        if (MaximumLength > MinimumLength) {
+            Length = Length + BenchRandom(&Seed) % (MaximumLength - MinimumLength + 1);
+        }
+
+        if (!YoriLibAllocateString(&Strings[Index], Length + 1)) {
+            BenchFreeStrings(Index, Strings);
+            return FALSE;
+        }
+
+        for (CharIndex = 0; CharIndex < Length; CharIndex++) {
+            Strings[Index].StartOfString[CharIndex] = Alphabet[BenchRandom(&Seed) % 64];
+        }
+        Strings[Index].StartOfString[Length] = '\0';
+        Strings[Index].LengthInChars = Length;
+    }
+
+    *StringArray = Strings;
+    return TRUE;
+}
+
+/**
+ Free an array of strings allocated with @ref BenchGenerateStrings .
+
+ @param Count The number of strings in the array.
+
+ @param StringArray Pointer to the array of strings.
+ */
+VOID
+BenchFreeStrings(
+    __in DWORD Count,
+    __in PYORI_STRING StringArray
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < Count; Index++) {
+        YoriLibFreeStringContents(&StringArray[Index]);
+    }
+    YoriLibFree(StringArray);
+}
+
+/**
+ Convert a number of performance counter ticks into nanoseconds.
+
+ @param Ticks The number of ticks.
+
+ @param Frequency The performance counter frequency.
+
+ @return The number of nanoseconds.
+ */
+DWORDLONG
+BenchTicksToNs(
+    __in DWORDLONG Ticks,
+    __in DWORDLONG Frequency
+    )
+{
+    return (Ticks / Frequency) * 1000000000 + (Ticks % Frequency) * 1000000000 / Frequency;
+}
+
+/**
+ Output the result of a single benchmark as a JSON object.
+
+ @param Name The name of the benchmark.
+
+ @param Result Pointer to the completed benchmark state.
+
+ @param Frequency The performance counter frequency.
+
+ @param First TRUE if this is the first benchmark to be output, FALSE if a
+        seperator is needed from a previous benchmark.
+ */
+VOID
+BenchOutputResult(
+    __in LPCTSTR Name,
+    __in PYORI_BENCH_RESULT Result,
+    __in DWORDLONG Frequency,
+    __in BOOLEAN First
+    )
+{
+    DWORDLONG Sorted[YORI_BENCH_MAX_RUNS];
+    DWORDLONG Swap;
+    DWORDLONG Total;
+    DWORDLONG Median;
+    DWORDLONG OpsPerRun;
+    DWORD Index;
+    DWORD Inner;
+
+    //
+    //  The number of runs is small, so a simple insertion sort is adequate
+    //  to find the median.
+    //
+
+    Total = 0;
+    for (Index = 0; Index < Result->RunsCompleted; Index++) {
+        Sorted[Index] = BenchTicksToNs(Result->Ticks[Index], Frequency);
+        Total = Total + Sorted[Index];
+        for (Inner = Index; Inner > 0 && Sorted[Inner - 1] > Sorted[Inner]; Inner--) {
+            Swap = Sorted[Inner];
+            Sorted[Inner] = Sorted[Inner - 1];
+            Sorted[Inner - 1] = Swap;
+        }
+    }
+
+    Median = Sorted[Result->RunsCompleted / 2];
+    OpsPerRun = Result->OperationsPerRun;
+    if (OpsPerRun == 0) {
+        OpsPerRun = 1;
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                  _T("%s    {\"name\": \"%s\", \"runs\": %i, \"operations\": %llu, ")
+                  _T("\"minNs\": %llu, \"medianNs\": %llu, \"maxNs\": %llu, \"meanNs\": %llu, ")
+                  _T("\"medianNsPerOp\": %llu}"),
+                  First?_T(""):_T(",\n"),
+                  Name,
+                  Result->RunsCompleted,
+                  Result->OperationsPerRun,
+                  Sorted[0],
+                  Median,
+                  Sorted[Result->RunsCompleted - 1],
+                  Total / Result->RunsCompleted,
+                  Median / OpsPerRun);
+}
+
+/**
+ The main entrypoint for the benchmark cmdlet.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV An array of arguments.
+
+ @return Exit code of the process, zero indicating success or nonzero on
+         failure.
+ */
+DWORD
+ymain(
+    __in DWORD ArgC,
+    __in YORI_STRING ArgV[]
+    )
+{
+    DWORD i;
+    DWORD Var;
+    DWORD Failed;
+    DWORD Runs;
+    DWORD Scale;
+    YORI_STRING Arg;
+    BOOLEAN ArgumentUnderstood;
+    BOOLEAN RunAll;
+    BOOLEAN ExecuteVariation;
+    BOOLEAN First;
+    YORI_BENCH_RESULT Result;
+    LARGE_INTEGER Frequency;
+    LONGLONG llTemp;
+    DWORD CharsConsumed;
+
+    RunAll = TRUE;
+    Runs = 5;
+    Scale = 1;
+
+    for (i = 1; i < ArgC; i++) {
+
+        ArgumentUnderstood = FALSE;
+        ASSERT(YoriLibIsStringNullTerminated(&ArgV[i]));
+
+        if (YoriLibIsCommandLineOption(&ArgV[i], &Arg)) {
+
+            if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("?")) == 0) {
+                BenchHelp();
+                return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
+                YoriLibDisplayMitLicense(_T("2026"));
+                return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
+                if (ArgC > i + 1 &&
+                    YoriLibStringToNumber(&ArgV[i + 1], TRUE, &llTemp, &CharsConsumed) &&
+                    CharsConsumed > 0 &&
+                    llTemp > 0) {
+
+                    Runs = (DWORD)llTemp;
+                    if (Runs > YORI_BENCH_MAX_RUNS) {
+                        Runs = YORI_BENCH_MAX_RUNS;
+                    }
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
+                if (ArgC > i + 1 &&
+                    YoriLibStringToNumber(&ArgV[i + 1], TRUE, &llTemp, &CharsConsumed) &&
+                    CharsConsumed > 0 &&
+                    llTemp > 0) {
+
+                    Scale = (DWORD)llTemp;
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("v")) == 0) {
+                if (ArgC > i + 1) {
+                    for (Var = 0; Var < sizeof(BenchVariations)/sizeof(BenchVariations[0]); Var++) {
+                        if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], BenchVariations[Var].Name) == 0) {
+                            BenchVariations[Var].ExplicitlySpecified = TRUE;
+                            BenchVariations[Var].Execute = TRUE;
+                            RunAll = FALSE;
+                        }
+                    }
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("x")) == 0) {
+                if (ArgC > i + 1) {
+                    for (Var = 0; Var < sizeof(BenchVariations)/sizeof(BenchVariations[0]); Var++) {
+                        if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], BenchVariations[Var].Name) == 0) {
+                            BenchVariations[Var].ExplicitlySpecified = TRUE;
+                            BenchVariations[Var].Execute = FALSE;
+                        }
+                    }
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
+            }
+        }
+
+        if (!ArgumentUnderstood) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Argument not understood, ignored: %y\n"), &ArgV[i]);
+        }
+    }
+
+    if (!QueryPerformanceFrequency(&Frequency) || Frequency.QuadPart == 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ybench: high resolution timer not available\n"));
+        return EXIT_FAILURE;
+    }
+
+    Failed = 0;
+    First = TRUE;
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                  _T("{\n  \"version\": \"%i.%02i\",\n  \"build\": %i,\n  \"runs\": %i,\n  \"scale\": %i,\n  \"benchmarks\": [\n"),
+                  YORI_VER_MAJOR,
+                  YORI_VER_MINOR,
+                  YORI_BUILD_ID,
+                  Runs,
+                  Scale);
+
+    for (i = 0; i < sizeof(BenchVariations)/sizeof(BenchVariations[0]); i++) {
+
+        ExecuteVariation = FALSE;
+        if (RunAll) {
+            if (!BenchVariations[i].ExplicitlySpecified ||
+                BenchVariations[i].Execute) {
+
+                ExecuteVariation = TRUE;
+            }
+        } else {
+            if (BenchVariations[i].ExplicitlySpecified &&
+                BenchVariations[i].Execute) {
+
+                ExecuteVariation = TRUE;
+            }
+        }
+
+        if (ExecuteVariation) {
+            ZeroMemory(&Result, sizeof(Result));
+            Result.RunsRequested = Runs;
+            Result.Scale = Scale;
+            if (BenchVariations[i].Fn(&Result) &&
+                Result.RunsCompleted == Result.RunsRequested) {
+
+                BenchOutputResult(BenchVariations[i].Name, &Result, Frequency.QuadPart, First);
+                First = FALSE;
+            } else {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%s FAILED\n"), BenchVariations[i].Name);
+                Failed++;
+            }
+        }
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n  ],\n  \"failed\": %i\n}\n"), Failed);
+
+    if (Failed == 0) {
+        return EXIT_SUCCESS;
+    }
+    return EXIT_FAILURE;
+}
+
+// vim:sw=4:ts=4:et:
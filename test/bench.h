@@ -0,0 +1,182 @@
+/**
+ * @file test/bench.h
+ *
+ * Yori library benchmark header
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ The maximum number of timed runs that can be requested for a single
+ benchmark.
+ */
+#define YORI_BENCH_MAX_RUNS 32
+
+/**
+ State for a single benchmark.  The benchmark populates the timing for each
+ run by calling @ref BenchBeginRun and @ref BenchEndRun around the code
+ being measured, so that setup and cleanup are excluded from the result.
+ */
+typedef struct _YORI_BENCH_RESULT {
+
+    /**
+     The number of timed runs the benchmark should perform.
+     */
+    DWORD RunsRequested;
+
+    /**
+     The number of timed runs the benchmark has completed.
+     */
+    DWORD RunsCompleted;
+
+    /**
+     A multiplier applied to the amount of work performed in each run.  This
+     allows the same benchmark to be scaled for faster or slower machines.
+     */
+    DWORD Scale;
+
+    /**
+     The number of operations performed within each run.  The meaning of an
+     operation is defined by each benchmark, but is consistent across runs
+     and releases so results can be compared.
+     */
+    DWORDLONG OperationsPerRun;
+
+    /**
+     The performance counter value when the current run started.
+     */
+    LARGE_INTEGER RunStart;
+
+    /**
+     The number of performance counter ticks consumed by each run.
+     */
+    DWORDLONG Ticks[YORI_BENCH_MAX_RUNS];
+
+} YORI_BENCH_RESULT, *PYORI_BENCH_RESULT;
+
+/**
+ Specifies the function signature for a benchmark.
+ */
+typedef
+BOOLEAN
+YORI_BENCH_FN(
+    __inout PYORI_BENCH_RESULT Result
+    );
+
+/**
+ A pointer to a benchmark.
+ */
+typedef YORI_BENCH_FN *PYORI_BENCH_FN;
+
+VOID
+BenchBeginRun(
+    __inout PYORI_BENCH_RESULT Result
+    );
+
+VOID
+BenchEndRun(
+    __inout PYORI_BENCH_RESULT Result,
+    __in DWORDLONG Operations
+    );
+
+DWORD
+BenchRandom(
+    __inout PDWORD Seed
+    );
+
+__success(return)
+BOOLEAN
+BenchGenerateStrings(
+    __in DWORD Count,
+    __in DWORD MinimumLength,
+    __in DWORD MaximumLength,
+    __in DWORD Seed,
+    __out PYORI_STRING *StringArray
+    );
+
+VOID
+BenchFreeStrings(
+    __in DWORD Count,
+    __in PYORI_STRING StringArray
+    );
+
+/**
+ A benchmark comparing strings case sensitively and insensitively.
+ */
+YORI_BENCH_FN BenchStringCompare;
+
+/**
+ A benchmark searching a line of text for a set of substrings.
+ */
+YORI_BENCH_FN BenchStringSearch;
+
+/**
+ A benchmark sorting an array of strings.
+ */
+YORI_BENCH_FN BenchStringSort;
+
+/**
+ A benchmark inserting, looking up and removing hash table entries.
+ */
+YORI_BENCH_FN BenchHashTable;
+
+/**
+ A benchmark formatting text through printf style routines.
+ */
+YORI_BENCH_FN BenchOutputFormat;
+
+/**
+ A benchmark expanding $ delimited variables backed by a hash table, as
+ performed by ymake and the shell.
+ */
+YORI_BENCH_FN BenchVariableExpand;
+
+/**
+ A benchmark reading lines from an ANSI encoded file.
+ */
+YORI_BENCH_FN BenchLineReadAnsi;
+
+/**
+ A benchmark reading lines from a UTF-8 encoded file.
+ */
+YORI_BENCH_FN BenchLineReadUtf8;
+
+/**
+ A benchmark reading lines from a UTF-16 encoded file.
+ */
+YORI_BENCH_FN BenchLineReadUtf16;
+
+/**
+ A benchmark enumerating a generated directory tree.
+ */
+YORI_BENCH_FN BenchDirEnum;
+
+/**
+ A benchmark parsing command lines into argument arrays.
+ */
+YORI_BENCH_FN BenchArgParse;
+
+/**
+ A benchmark parsing command lines into shell execution plans.
+ */
+YORI_BENCH_FN BenchExecPlan;
+
+// vim:sw=4:ts=4:et:
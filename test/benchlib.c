@@ -0,0 +1,909 @@
+/**
+ * @file test/benchlib.c
+ *
+ * Yori library benchmarks for string, hash, formatting and file routines
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "bench.h"
+
+/**
+ The number of strings to generate for string and hash benchmarks, before
+ scaling.
+ */
+#define BENCH_STRING_COUNT 4000
+
+/**
+ The number of lines to generate for line reading benchmarks, before
+ scaling.
+ */
+#define BENCH_LINE_COUNT 20000
+
+/**
+ A location to store results of benchmark loops so the compiler cannot
+ discard the work being measured.
+ */
+volatile DWORD BenchSink;
+
+/**
+ A benchmark comparing strings case sensitively and insensitively.
+ */
+BOOLEAN
+BenchStringCompare(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    PYORI_STRING Strings;
+    PYORI_STRING Copies;
+    DWORD Count;
+    DWORD Index;
+    DWORD Run;
+    int Accumulator;
+
+    Count = BENCH_STRING_COUNT * Result->Scale;
+    if (!BenchGenerateStrings(Count, 8, 80, 1, &Strings)) {
+        return FALSE;
+    }
+
+    //
+    //  Generate the same strings again so that comparisons of equal strings
+    //  need to traverse the whole buffer rather than observing identical
+    //  pointers.
+    //
+
+    if (!BenchGenerateStrings(Count, 8, 80, 1, &Copies)) {
+        BenchFreeStrings(Count, Strings);
+        return FALSE;
+    }
+
+    Accumulator = 0;
+    for (Run = 0; Run < Result->RunsRequested; Run++) {
+        BenchBeginRun(Result);
+        for (Index = 0; Index < Count; Index++) {
+            Accumulator += YoriLibCompareString(&Strings[Index], &Copies[Index]);
+            Accumulator += YoriLibCompareStringInsensitive(&Strings[Index], &Copies[Index]);
+            Accumulator += YoriLibCompareString(&Strings[Index], &Copies[(Index + 1) % Count]);
+            Accumulator += YoriLibCompareStringInsensitive(&Strings[Index], &Copies[(Index + 1) % Count]);
+        }
+        BenchEndRun(Result, (DWORDLONG)Count * 4);
+    }
+
+    BenchFreeStrings(Count, Copies);
+    BenchFreeStrings(Count, Strings);
+
+    BenchSink = (DWORD)Accumulator;
+    return TRUE;
+}
+
+/**
+ A benchmark searching a line of text for a set of substrings.
+ */
+BOOLEAN
+BenchStringSearch(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    PYORI_STRING Lines;
+    YORI_STRING Matches[4];
+    DWORD Count;
+    DWORD Index;
+    DWORD Run;
+    DWORD Offset;
+    DWORD Found;
+
+    Count = BENCH_STRING_COUNT * Result->Scale;
+    if (!BenchGenerateStrings(Count, 60, 200, 2, &Lines)) {
+        return FALSE;
+    }
+
+    YoriLibConstantString(&Matches[0], _T("Error"));
+    YoriLibConstantString(&Matches[1], _T("warn"));
+    YoriLibConstantString(&Matches[2], _T("x_9"));
+    YoriLibConstantString(&Matches[3], _T("Q."));
+
+    Found = 0;
+    for (Run = 0; Run < Result->RunsRequested; Run++) {
+        BenchBeginRun(Result);
+        for (Index = 0; Index < Count; Index++) {
+            if (YoriLibFindFirstMatchingSubstring(&Lines[Index], 4, Matches, &Offset) != NULL) {
+                Found++;
+            }
+            if (YoriLibFindFirstMatchingSubstringInsensitive(&Lines[Index], 4, Matches, &Offset) != NULL) {
+                Found++;
+            }
+        }
+        BenchEndRun(Result, (DWORDLONG)Count * 2);
+    }
+
+    BenchFreeStrings(Count, Lines);
+    BenchSink = Found;
+    return TRUE;
+}
+
+/**
+ A benchmark sorting an array of strings.
+ */
+BOOLEAN
+BenchStringSort(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    PYORI_STRING Strings;
+    PYORI_STRING SortArray;
+    DWORD Count;
+    DWORD Run;
+
+    Count = BENCH_STRING_COUNT * Result->Scale;
+    if (!BenchGenerateStrings(Count, 4, 40, 3, &Strings)) {
+        return FALSE;
+    }
+
+    SortArray = YoriLibMalloc(Count * sizeof(YORI_STRING));
+    if (SortArray == NULL) {
+        BenchFreeStrings(Count, Strings);
+        return FALSE;
+    }
+
+    //
+    //  The sort swaps string structures in place, so each run starts by
+    //  restoring the original unsorted order.  This copies structures only
+    //  and is small relative to the sort itself.
+    //
+
+    for (Run = 0; Run < Result->RunsRequested; Run++) {
+        memcpy(SortArray, Strings, Count * sizeof(YORI_STRING));
+        BenchBeginRun(Result);
+        YoriLibSortStringArray(SortArray, Count);
+        BenchEndRun(Result, Count);
+    }
+
+    YoriLibFree(SortArray);
+    BenchFreeStrings(Count, Strings);
+    return TRUE;
+}
+
+/**
+ A benchmark inserting, looking up and removing hash table entries.
+ */
+BOOLEAN
+BenchHashTable(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    PYORI_STRING Strings;
+    PYORI_HASH_TABLE HashTable;
+    PYORI_HASH_ENTRY Entries;
+    DWORD Count;
+    DWORD Index;
+    DWORD Run;
+    DWORD Found;
+
+    Count = BENCH_STRING_COUNT * Result->Scale;
+    if (!BenchGenerateStrings(Count, 6, 32, 4, &Strings)) {
+        return FALSE;
+    }
+
+    Entries = YoriLibMalloc(Count * sizeof(YORI_HASH_ENTRY));
+    if (Entries == NULL) {
+        BenchFreeStrings(Count, Strings);
+        return FALSE;
+    }
+
+    HashTable = YoriLibAllocateHashTable(1000);
+    if (HashTable == NULL) {
+        YoriLibFree(Entries);
+        BenchFreeStrings(Count, Strings);
+        return FALSE;
+    }
+
+    Found = 0;
+    for (Run = 0; Run < Result->RunsRequested; Run++) {
+        BenchBeginRun(Result);
+        for (Index = 0; Index < Count; Index++) {
+            YoriLibHashInsertByKey(HashTable, &Strings[Index], &Strings[Index], &Entries[Index]);
+        }
+        for (Index = 0; Index < Count; Index++) {
+            if (YoriLibHashLookupByKey(HashTable, &Strings[Index]) != NULL) {
+                Found++;
+            }
+        }
+        for (Index = 0; Index < Count; Index++) {
+            YoriLibHashRemoveByEntry(&Entries[Index]);
+        }
+        BenchEndRun(Result, (DWORDLONG)Count * 3);
+    }
+
+    YoriLibFreeEmptyHashTable(HashTable);
+    YoriLibFree(Entries);
+    BenchFreeStrings(Count, Strings);
+
+    if (Found != Count * Result->RunsRequested) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i hash lookup found %i of %i entries\n"), __FILE__, __LINE__, Found, Count * Result->RunsRequested);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ A benchmark formatting text through printf style routines and writing the
+ result to the NUL device, so the cost of formatting and encoding is measured
+ without being dominated by a terminal.
+ */
+BOOLEAN
+BenchOutputFormat(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    HANDLE hNul;
+    YORI_STRING Sample;
+    DWORD Count;
+    DWORD Index;
+    DWORD Run;
+    LONGLONG BigNumber;
+
+    hNul = CreateFile(_T("NUL"), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+    if (hNul == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    YoriLibConstantString(&Sample, _T("C:\\Program Files\\Yori\\ybench.exe"));
+    BigNumber = 0x123456789AB;
+    Count = 20000 * Result->Scale;
+
+    for (Run = 0; Run < Result->RunsRequested; Run++) {
+        BenchBeginRun(Result);
+        for (Index = 0; Index < Count; Index++) {
+            YoriLibOutputToDevice(hNul, 0, _T("%s %i %08x %lli %y\n"), _T("Iteration"), Index, Index, BigNumber, &Sample);
+        }
+        BenchEndRun(Result, Count);
+    }
+
+    CloseHandle(hNul);
+    return TRUE;
+}
+
+/**
+ Context for the variable expansion benchmark.
+ */
+typedef struct _BENCH_EXPAND_CONTEXT {
+
+    /**
+     A hash table of variable names to values.
+     */
+    PYORI_HASH_TABLE Variables;
+
+    /**
+     The number of variables that could not be found.
+     */
+    DWORD NotFound;
+} BENCH_EXPAND_CONTEXT, *PBENCH_EXPAND_CONTEXT;
+
+/**
+ Expand a single variable by looking it up in a hash table.
+
+ @param OutputBuffer Pointer to a buffer to populate with the variable value.
+
+ @param VariableName The name of the variable to expand.
+
+ @param Context Pointer to the expansion context.
+
+ @return The number of characters needed to contain the value.
+ */
+DWORD
+BenchExpandVariable(
+    __inout PYORI_STRING OutputBuffer,
+    __in PYORI_STRING VariableName,
+    __in PVOID Context
+    )
+{
+    PBENCH_EXPAND_CONTEXT ExpandContext = (PBENCH_EXPAND_CONTEXT)Context;
+    PYORI_HASH_ENTRY Entry;
+    PYORI_STRING Value;
+
+    Entry = YoriLibHashLookupByKey(ExpandContext->Variables, VariableName);
+    if (Entry == NULL) {
+        ExpandContext->NotFound++;
+        return 0;
+    }
+
+    Value = Entry->Context;
+    if (OutputBuffer->LengthAllocated >= Value->LengthInChars) {
+        memcpy(OutputBuffer->StartOfString, Value->StartOfString, Value->LengthInChars * sizeof(TCHAR));
+        OutputBuffer->LengthInChars = Value->LengthInChars;
+    }
+
+    return Value->LengthInChars;
+}
+
+/**
+ The number of variables defined for the variable expansion benchmark.
+ */
+#define BENCH_VARIABLE_COUNT 200
+
+/**
+ The number of lines to expand for the variable expansion benchmark, before
+ scaling.
+ */
+#define BENCH_EXPAND_LINE_COUNT 500
+
+/**
+ A benchmark expanding $ delimited variables backed by a hash table.  ymake
+ variables require a full make context to evaluate, so this measures the
+ shared components ymake and the shell rely on: scanning a line for
+ variables, hashed variable lookup and building the expanded line.
+ */
+BOOLEAN
+BenchVariableExpand(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    BENCH_EXPAND_CONTEXT ExpandContext;
+    YORI_STRING Names[BENCH_VARIABLE_COUNT];
+    YORI_HASH_ENTRY Entries[BENCH_VARIABLE_COUNT];
+    PYORI_STRING Values;
+    PYORI_STRING Lines;
+    YORI_STRING Expanded;
+    DWORD LineCount;
+    DWORD Index;
+    DWORD Run;
+    DWORD Seed;
+    BOOLEAN Success;
+
+    if (!BenchGenerateStrings(BENCH_VARIABLE_COUNT, 4, 64, 5, &Values)) {
+        return FALSE;
+    }
+
+    ExpandContext.NotFound = 0;
+    ExpandContext.Variables = YoriLibAllocateHashTable(250);
+    if (ExpandContext.Variables == NULL) {
+        BenchFreeStrings(BENCH_VARIABLE_COUNT, Values);
+        return FALSE;
+    }
+
+    for (Index = 0; Index < BENCH_VARIABLE_COUNT; Index++) {
+        YoriLibInitEmptyString(&Names[Index]);
+        YoriLibYPrintf(&Names[Index], _T("VAR%03i"), Index);
+        YoriLibHashInsertByKey(ExpandContext.Variables, &Names[Index], &Values[Index], &Entries[Index]);
+    }
+
+    //
+    //  Generate lines resembling compiler invocations, each referring to
+    //  several variables.
+    //
+
+    Success = FALSE;
+    LineCount = BENCH_EXPAND_LINE_COUNT * Result->Scale;
+    Lines = YoriLibMalloc(LineCount * sizeof(YORI_STRING));
+    YoriLibInitEmptyString(&Expanded);
+    if (Lines != NULL) {
+        Seed = 6;
+        for (Index = 0; Index < LineCount; Index++) {
+            YoriLibInitEmptyString(&Lines[Index]);
+            YoriLibYPrintf(&Lines[Index],
+                           _T("$VAR%03i$ -c $VAR%03i$ -I$VAR%03i$ -Fo$VAR%03i$ source%i.c $VAR%03i$"),
+                           BenchRandom(&Seed) % BENCH_VARIABLE_COUNT,
+                           BenchRandom(&Seed) % BENCH_VARIABLE_COUNT,
+                           BenchRandom(&Seed) % BENCH_VARIABLE_COUNT,
+                           BenchRandom(&Seed) % BENCH_VARIABLE_COUNT,
+                           Index,
+                           BenchRandom(&Seed) % BENCH_VARIABLE_COUNT);
+        }
+
+        Success = TRUE;
+        for (Run = 0; Run < Result->RunsRequested; Run++) {
+            BenchBeginRun(Result);
+            for (Index = 0; Index < LineCount; Index++) {
+                if (!YoriLibExpandCommandVariables(&Lines[Index], '$', FALSE, BenchExpandVariable, &ExpandContext, &Expanded)) {
+                    Success = FALSE;
+                }
+            }
+            BenchEndRun(Result, LineCount);
+        }
+
+        for (Index = 0; Index < LineCount; Index++) {
+            YoriLibFreeStringContents(&Lines[Index]);
+        }
+        YoriLibFree(Lines);
+    }
+
+    YoriLibFreeStringContents(&Expanded);
+    for (Index = 0; Index < BENCH_VARIABLE_COUNT; Index++) {
+        YoriLibHashRemoveByEntry(&Entries[Index]);
+        YoriLibFreeStringContents(&Names[Index]);
+    }
+    YoriLibFreeEmptyHashTable(ExpandContext.Variables);
+    BenchFreeStrings(BENCH_VARIABLE_COUNT, Values);
+
+    if (ExpandContext.NotFound > 0) {
+        return FALSE;
+    }
+
+    return Success;
+}
+
+/**
+ The encodings that line reading benchmarks can generate.
+ */
+typedef enum _BENCH_LINE_ENCODING {
+    BenchLineEncodingAnsi = 0,
+    BenchLineEncodingUtf8 = 1,
+    BenchLineEncodingUtf16 = 2
+} BENCH_LINE_ENCODING;
+
+/**
+ Create a temporary file containing lines of text in a specified encoding.
+
+ @param Encoding The encoding to generate.
+
+ @param LineCount The number of lines to generate.
+
+ @param FileHandle On successful completion, populated with a handle to the
+        file, opened for read and write.
+
+ @param FileName On successful completion, populated with the name of the
+        file so it can be deleted when no longer needed.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+BenchCreateLineFile(
+    __in BENCH_LINE_ENCODING Encoding,
+    __in DWORD LineCount,
+    __out PHANDLE FileHandle,
+    __out PYORI_STRING FileName
+    )
+{
+    YORI_STRING TempPath;
+    YORI_STRING Prefix;
+    YORI_LIB_BYTE_BUFFER Buffer;
+    HANDLE Handle;
+    PUCHAR Dest;
+    DWORD Index;
+    DWORD BytesWritten;
+    DWORD LineLength;
+
+    if (!YoriLibGetTempPath(&TempPath, 0)) {
+        return FALSE;
+    }
+
+    if (TempPath.LengthInChars > 0 &&
+        YoriLibIsSep(TempPath.StartOfString[TempPath.LengthInChars - 1])) {
+
+        TempPath.LengthInChars--;
+    }
+
+    YoriLibConstantString(&Prefix, _T("YBN"));
+    if (!YoriLibGetTempFileName(&TempPath, &Prefix, &Handle, FileName)) {
+        YoriLibFreeStringContents(&TempPath);
+        return FALSE;
+    }
+    YoriLibFreeStringContents(&TempPath);
+
+    if (!YoriLibByteBufferInitialize(&Buffer, 128 * 1024)) {
+        CloseHandle(Handle);
+        DeleteFile(FileName->StartOfString);
+        YoriLibFreeStringContents(FileName);
+        return FALSE;
+    }
+
+    if (Encoding == BenchLineEncodingUtf16) {
+        Dest = YoriLibByteBufferGetPointerToEnd(&Buffer, 2, NULL);
+        if (Dest == NULL) {
+            goto Failure;
+        }
+        Dest[0] = 0xFF;
+        Dest[1] = 0xFE;
+        YoriLibByteBufferAddToPopulatedLength(&Buffer, 2);
+    }
+
+    for (Index = 0; Index < LineCount; Index++) {
+        Dest = YoriLibByteBufferGetPointerToEnd(&Buffer, 256, NULL);
+        if (Dest == NULL) {
+            goto Failure;
+        }
+
+        if (Encoding == BenchLineEncodingUtf16) {
+            LineLength = YoriLibSPrintfS((LPTSTR)Dest, 128, _T("Line %08i of benchmark input with caf\x00e9 \x20ac text\r\n"), Index);
+            LineLength = LineLength * sizeof(TCHAR);
+        } else if (Encoding == BenchLineEncodingUtf8) {
+            LineLength = YoriLibSPrintfSA((LPSTR)Dest, 256, "Line %08i of benchmark input with caf\xc3\xa9 \xe2\x82\xac text\r\n", Index);
+        } else {
+            LineLength = YoriLibSPrintfSA((LPSTR)Dest, 256, "Line %08i of benchmark input with plain ascii text\r\n", Index);
+        }
+
+        YoriLibByteBufferAddToPopulatedLength(&Buffer, LineLength);
+    }
+
+    if (!WriteFile(Handle, Buffer.Buffer, (DWORD)Buffer.BytesPopulated, &BytesWritten, NULL) ||
+        BytesWritten != (DWORD)Buffer.BytesPopulated) {
+
+        goto Failure;
+    }
+
+    YoriLibByteBufferCleanup(&Buffer);
+    *FileHandle = Handle;
+    return TRUE;
+
+Failure:
+    YoriLibByteBufferCleanup(&Buffer);
+    CloseHandle(Handle);
+    DeleteFile(FileName->StartOfString);
+    YoriLibFreeStringContents(FileName);
+    return FALSE;
+}
+
+/**
+ Read every line from a generated file in a specified encoding, repeating for
+ each run.
+
+ @param Result Pointer to the benchmark state.
+
+ @param Encoding The encoding to generate and read.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchLineRead(
+    __inout PYORI_BENCH_RESULT Result,
+    __in BENCH_LINE_ENCODING Encoding
+    )
+{
+    HANDLE Handle;
+    YORI_STRING FileName;
+    YORI_STRING LineString;
+    PVOID LineContext;
+    DWORD LineCount;
+    DWORD LinesRead;
+    DWORD Run;
+    DWORD OldEncoding;
+    BOOLEAN Success;
+
+    LineCount = BENCH_LINE_COUNT * Result->Scale;
+    if (!BenchCreateLineFile(Encoding, LineCount, &Handle, &FileName)) {
+        return FALSE;
+    }
+
+    OldEncoding = YoriLibGetMultibyteInputEncoding();
+    if (Encoding == BenchLineEncodingUtf16) {
+        YoriLibSetMultibyteInputEncoding(CP_UTF16);
+    } else if (Encoding == BenchLineEncodingUtf8) {
+        YoriLibSetMultibyteInputEncoding(CP_UTF8);
+    } else {
+        YoriLibSetMultibyteInputEncoding(1252);
+    }
+
+    Success = TRUE;
+    YoriLibInitEmptyString(&LineString);
+    for (Run = 0; Run < Result->RunsRequested; Run++) {
+        SetFilePointer(Handle, 0, NULL, FILE_BEGIN);
+        LineContext = NULL;
+        LinesRead = 0;
+        BenchBeginRun(Result);
+        while (YoriLibReadLineToString(&LineString, &LineContext, Handle) != NULL) {
+            LinesRead++;
+        }
+        BenchEndRun(Result, LinesRead);
+        YoriLibLineReadClose(LineContext);
+
+        if (LinesRead != LineCount) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i read %i lines, expected %i\n"), __FILE__, __LINE__, LinesRead, LineCount);
+            Success = FALSE;
+        }
+    }
+
+    YoriLibSetMultibyteInputEncoding(OldEncoding);
+    YoriLibFreeStringContents(&LineString);
+    CloseHandle(Handle);
+    DeleteFile(FileName.StartOfString);
+    YoriLibFreeStringContents(&FileName);
+    return Success;
+}
+
+/**
+ A benchmark reading lines from an ANSI encoded file.
+ */
+BOOLEAN
+BenchLineReadAnsi(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    return BenchLineRead(Result, BenchLineEncodingAnsi);
+}
+
+/**
+ A benchmark reading lines from a UTF-8 encoded file.
+ */
+BOOLEAN
+BenchLineReadUtf8(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    return BenchLineRead(Result, BenchLineEncodingUtf8);
+}
+
+/**
+ A benchmark reading lines from a UTF-16 encoded file.
+ */
+BOOLEAN
+BenchLineReadUtf16(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    return BenchLineRead(Result, BenchLineEncodingUtf16);
+}
+
+/**
+ The number of top level directories in the generated tree.
+ */
+#define BENCH_DIR_TOP_COUNT 10
+
+/**
+ The number of child directories within each top level directory.
+ */
+#define BENCH_DIR_CHILD_COUNT 10
+
+/**
+ The number of files within each child directory, before scaling.
+ */
+#define BENCH_DIR_FILE_COUNT 20
+
+/**
+ Build the name of an object within the generated directory tree.
+
+ @param Root The root of the generated tree.
+
+ @param Top The index of the top level directory, or -1 for the root.
+
+ @param Child The index of the child directory, or -1 for the top level
+        directory.
+
+ @param File The index of the file, or -1 for the child directory.
+
+ @param Name On successful completion, updated to contain the name.  This
+        should be allocated by the caller and may be reallocated here.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+BenchBuildTreeName(
+    __in PYORI_STRING Root,
+    __in DWORD Top,
+    __in DWORD Child,
+    __in DWORD File,
+    __inout PYORI_STRING Name
+    )
+{
+    int Length;
+
+    if (Top == (DWORD)-1) {
+        Length = YoriLibYPrintf(Name, _T("%y"), Root);
+    } else if (Child == (DWORD)-1) {
+        Length = YoriLibYPrintf(Name, _T("%y\\Dir%02i"), Root, Top);
+    } else if (File == (DWORD)-1) {
+        Length = YoriLibYPrintf(Name, _T("%y\\Dir%02i\\Sub%02i"), Root, Top, Child);
+    } else {
+        Length = YoriLibYPrintf(Name, _T("%y\\Dir%02i\\Sub%02i\\File%04i.txt"), Root, Top, Child, File);
+    }
+
+    if (Length < 0) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Create or delete the generated directory tree.
+
+ @param Root The root of the generated tree.
+
+ @param FileCount The number of files in each child directory.
+
+ @param Create If TRUE, the tree is created.  If FALSE, it is deleted.
+
+ @return TRUE to indicate success, FALSE to indicate failure.  Deletion is
+         best effort and always returns TRUE.
+ */
+BOOLEAN
+BenchCreateOrDeleteTree(
+    __in PYORI_STRING Root,
+    __in DWORD FileCount,
+    __in BOOLEAN Create
+    )
+{
+    YORI_STRING Name;
+    DWORD Top;
+    DWORD Child;
+    DWORD File;
+    HANDLE Handle;
+
+    YoriLibInitEmptyString(&Name);
+
+    if (Create) {
+        if (!CreateDirectory(Root->StartOfString, NULL)) {
+            return FALSE;
+        }
+    }
+
+    for (Top = 0; Top < BENCH_DIR_TOP_COUNT; Top++) {
+        if (Create) {
+            if (!BenchBuildTreeName(Root, Top, (DWORD)-1, (DWORD)-1, &Name) ||
+                !CreateDirectory(Name.StartOfString, NULL)) {
+                YoriLibFreeStringContents(&Name);
+                return FALSE;
+            }
+        }
+
+        for (Child = 0; Child < BENCH_DIR_CHILD_COUNT; Child++) {
+            if (Create) {
+                if (!BenchBuildTreeName(Root, Top, Child, (DWORD)-1, &Name) ||
+                    !CreateDirectory(Name.StartOfString, NULL)) {
+                    YoriLibFreeStringContents(&Name);
+                    return FALSE;
+                }
+            }
+
+            for (File = 0; File < FileCount; File++) {
+                if (!BenchBuildTreeName(Root, Top, Child, File, &Name)) {
+                    YoriLibFreeStringContents(&Name);
+                    return FALSE;
+                }
+                if (Create) {
+                    Handle = CreateFile(Name.StartOfString, GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+                    if (Handle == INVALID_HANDLE_VALUE) {
+                        YoriLibFreeStringContents(&Name);
+                        return FALSE;
+                    }
+                    CloseHandle(Handle);
+                } else {
+                    DeleteFile(Name.StartOfString);
+                }
+            }
+
+            if (!Create) {
+                if (BenchBuildTreeName(Root, Top, Child, (DWORD)-1, &Name)) {
+                    RemoveDirectory(Name.StartOfString);
+                }
+            }
+        }
+
+        if (!Create) {
+            if (BenchBuildTreeName(Root, Top, (DWORD)-1, (DWORD)-1, &Name)) {
+                RemoveDirectory(Name.StartOfString);
+            }
+        }
+    }
+
+    if (!Create) {
+        RemoveDirectory(Root->StartOfString);
+    }
+
+    YoriLibFreeStringContents(&Name);
+    return TRUE;
+}
+
+/**
+ A callback invoked for each object found in the generated tree.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.
+
+ @param Depth Specifies recursion depth.  Ignored in this application.
+
+ @param Context Pointer to a count of objects found.
+
+ @return TRUE to continue enumerating, FALSE to abort.
+ */
+BOOL
+BenchDirEnumCallback(
+    __in PYORI_STRING FilePath,
+    __in_opt PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PDWORD Found = (PDWORD)Context;
+
+    UNREFERENCED_PARAMETER(FilePath);
+    UNREFERENCED_PARAMETER(FileInfo);
+    UNREFERENCED_PARAMETER(Depth);
+
+    (*Found)++;
+    return TRUE;
+}
+
+/**
+ A benchmark enumerating a generated directory tree.
+ */
+BOOLEAN
+BenchDirEnum(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    YORI_STRING TempPath;
+    YORI_STRING Root;
+    YORI_STRING FileSpec;
+    DWORD FileCount;
+    DWORD Expected;
+    DWORD Found;
+    DWORD Run;
+    BOOLEAN Success;
+
+    if (!YoriLibGetTempPath(&TempPath, 0)) {
+        return FALSE;
+    }
+
+    if (TempPath.LengthInChars > 0 &&
+        YoriLibIsSep(TempPath.StartOfString[TempPath.LengthInChars - 1])) {
+
+        TempPath.LengthInChars--;
+    }
+
+    YoriLibInitEmptyString(&Root);
+    YoriLibInitEmptyString(&FileSpec);
+    if (YoriLibYPrintf(&Root, _T("%y\\ybench.%i"), &TempPath, GetCurrentProcessId()) < 0 ||
+        YoriLibYPrintf(&FileSpec, _T("%y\\*"), &Root) < 0) {
+
+        YoriLibFreeStringContents(&FileSpec);
+        YoriLibFreeStringContents(&Root);
+        YoriLibFreeStringContents(&TempPath);
+        return FALSE;
+    }
+    YoriLibFreeStringContents(&TempPath);
+
+    FileCount = BENCH_DIR_FILE_COUNT * Result->Scale;
+    Expected = BENCH_DIR_TOP_COUNT + BENCH_DIR_TOP_COUNT * BENCH_DIR_CHILD_COUNT * (1 + FileCount);
+
+    Success = FALSE;
+    if (BenchCreateOrDeleteTree(&Root, FileCount, TRUE)) {
+        Success = TRUE;
+        for (Run = 0; Run < Result->RunsRequested; Run++) {
+            Found = 0;
+            BenchBeginRun(Result);
+            YoriLibForEachFile(&FileSpec,
+                               YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES | YORILIB_FILEENUM_RECURSE_BEFORE_RETURN,
+                               0,
+                               BenchDirEnumCallback,
+                               NULL,
+                               &Found);
+            BenchEndRun(Result, Found);
+
+            if (Found != Expected) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i found %i objects, expected %i\n"), __FILE__, __LINE__, Found, Expected);
+                Success = FALSE;
+            }
+        }
+    }
+
+    BenchCreateOrDeleteTree(&Root, FileCount, FALSE);
+    YoriLibFreeStringContents(&FileSpec);
+    YoriLibFreeStringContents(&Root);
+    return Success;
+}
+
+// vim:sw=4:ts=4:et:
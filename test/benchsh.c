@@ -0,0 +1,138 @@
+/**
+ * @file test/benchsh.c
+ *
+ * Yori library benchmarks for command line parsing
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yorish.h>
+#include "bench.h"
+
+/**
+ A set of command lines to parse, chosen to exercise quoting, escapes,
+ redirection and pipelines.
+ */
+LPCTSTR BenchCmdLines[] = {
+    _T("cl -nologo -c -Zi -W4 -WX -I..\\lib -DUNICODE source.c"),
+    _T("\"C:\\Program Files\\Yori\\ydir.exe\" -b -s \"C:\\Some Path\\*.c\""),
+    _T("ytype file.txt | ycut -f 2 -d , | ysort > \"output file.txt\""),
+    _T("set PATH=C:\\Tools;%PATH% & ymake -j 8 all 2>&1 >> build.log"),
+    _T("echo ^\"escaped^\" text with carets ^& ampersands && if ok (echo yes) || echo no"),
+    _T("for -p 4 %%i in (*.c) do cl -c %%i"),
+};
+
+/**
+ The number of passes over the command line set per run, before scaling.
+ */
+#define BENCH_CMD_PASSES 2000
+
+/**
+ A benchmark parsing command lines into argument arrays.
+ */
+BOOLEAN
+BenchArgParse(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    PYORI_STRING ArgV;
+    DWORD ArgC;
+    DWORD Passes;
+    DWORD Pass;
+    DWORD Index;
+    DWORD ArgIndex;
+    DWORD Run;
+    DWORD Operations;
+
+    Passes = BENCH_CMD_PASSES * Result->Scale;
+
+    for (Run = 0; Run < Result->RunsRequested; Run++) {
+        Operations = 0;
+        BenchBeginRun(Result);
+        for (Pass = 0; Pass < Passes; Pass++) {
+            for (Index = 0; Index < sizeof(BenchCmdLines)/sizeof(BenchCmdLines[0]); Index++) {
+                ArgV = YoriLibCmdlineToArgcArgv(BenchCmdLines[Index], (DWORD)-1, TRUE, &ArgC);
+                if (ArgV == NULL) {
+                    return FALSE;
+                }
+                for (ArgIndex = 0; ArgIndex < ArgC; ArgIndex++) {
+                    YoriLibFreeStringContents(&ArgV[ArgIndex]);
+                }
+                YoriLibDereference(ArgV);
+                Operations++;
+            }
+        }
+        BenchEndRun(Result, Operations);
+    }
+
+    return TRUE;
+}
+
+/**
+ A benchmark parsing command lines into shell execution plans.  This
+ includes parsing into a command context, which is the first step of
+ building an execution plan.
+ */
+BOOLEAN
+BenchExecPlan(
+    __inout PYORI_BENCH_RESULT Result
+    )
+{
+    YORI_LIBSH_CMD_CONTEXT CmdContext;
+    YORI_LIBSH_EXEC_PLAN ExecPlan;
+    YORI_STRING CmdLine;
+    DWORD Passes;
+    DWORD Pass;
+    DWORD Index;
+    DWORD Run;
+    DWORD Operations;
+
+    Passes = BENCH_CMD_PASSES * Result->Scale;
+
+    for (Run = 0; Run < Result->RunsRequested; Run++) {
+        Operations = 0;
+        BenchBeginRun(Result);
+        for (Pass = 0; Pass < Passes; Pass++) {
+            for (Index = 0; Index < sizeof(BenchCmdLines)/sizeof(BenchCmdLines[0]); Index++) {
+                YoriLibConstantString(&CmdLine, BenchCmdLines[Index]);
+                if (!YoriLibShParseCmdlineToCmdContext(&CmdLine, 0, &CmdContext)) {
+                    return FALSE;
+                }
+
+                if (!YoriLibShParseCmdContextToExecPlan(&CmdContext, &ExecPlan, NULL, NULL, NULL, NULL)) {
+                    YoriLibShFreeCmdContext(&CmdContext);
+                    return FALSE;
+                }
+
+                YoriLibShFreeExecPlan(&ExecPlan);
+                YoriLibShFreeCmdContext(&CmdContext);
+                Operations++;
+            }
+        }
+        BenchEndRun(Result, Operations);
+    }
+
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
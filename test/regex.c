@@ -0,0 +1,226 @@
+/**
+ * @file test/regex.c
+ *
+ * Yori regular expression tests
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "test.h"
+
+/**
+ A single expression to search for within a string, and the expected result.
+ */
+typedef struct _TEST_REGEX_CASE {
+
+    /**
+     The expression to compile.
+     */
+    LPCTSTR Pattern;
+
+    /**
+     Flags to compile the expression with.
+     */
+    DWORD Flags;
+
+    /**
+     The text to search.
+     */
+    LPCTSTR Text;
+
+    /**
+     The expected offset of the match, or -1 if no match is expected.
+     */
+    DWORD MatchOffset;
+
+    /**
+     The expected length of the match.
+     */
+    DWORD MatchLength;
+} TEST_REGEX_CASE, *PTEST_REGEX_CASE;
+
+/**
+ Expressions to search for and the expected results.
+ */
+TEST_REGEX_CASE TestRegexCases[] = {
+    {_T("abc"),             0,                          _T("xxabcxx"),       2,         3},
+    {_T("a+"),              0,                          _T("baaab"),         1,         3},
+    {_T("^ab"),             0,                          _T("xab"),           (DWORD)-1, 0},
+    {_T("ab$"),             0,                          _T("abab"),          2,         2},
+    {_T("[^a-c]+"),         0,                          _T("abcxyz"),        3,         3},
+    {_T("(foo|foobar)"),    0,                          _T("afoobarx"),      1,         6},
+    {_T("\\d{2,3}"),        0,                          _T("a12345"),        1,         3},
+    {_T("a{,2}"),           0,                          _T("a{,2}"),         0,         5},
+    {_T("HELLO"),           YORI_LIB_REGEX_INSENSITIVE, _T("say hello"),     4,         5},
+    {_T("\\w+\\s\\w+"),     0,                          _T("  ab cd"),       2,         5},
+    {_T("a.c"),             0,                          _T("a\nc abc"),      4,         3},
+    {_T("(x+x+)+y"),        0,                          _T("xxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"), (DWORD)-1, 0},
+    {_T("abcd|c"),          0,                          _T("xabcd"),         1,         4},
+    {_T("abcd|bcdefg"),     0,                          _T("abcdefg"),       0,         4},
+    {_T("^a|ba"),           0,                          _T("ba"),            0,         2},
+    {_T("b*$"),             0,                          _T("abb"),           1,         2},
+};
+
+/**
+ A test variation to search for a set of regular expressions.
+ */
+BOOLEAN
+TestRegexFindFirst(VOID)
+{
+    PYORI_LIB_REGEX Regex;
+    YORI_STRING Pattern;
+    YORI_STRING Text;
+    DWORD Index;
+    DWORD MatchOffset;
+    DWORD MatchLength;
+    BOOLEAN Found;
+
+    for (Index = 0; Index < sizeof(TestRegexCases)/sizeof(TestRegexCases[0]); Index++) {
+        YoriLibConstantString(&Pattern, TestRegexCases[Index].Pattern);
+        YoriLibConstantString(&Text, TestRegexCases[Index].Text);
+
+        if (!YoriLibRegexCompile(1, &Pattern, NULL, TestRegexCases[Index].Flags, &Regex, NULL, NULL)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                          _T("%hs:%i YoriLibRegexCompile failed on '%y'\n"),
+                          __FILE__,
+                          __LINE__,
+                          &Pattern);
+            return FALSE;
+        }
+
+        Found = YoriLibRegexFindFirst(Regex, &Text, 0, &MatchOffset, &MatchLength, NULL);
+        YoriLibRegexFree(Regex);
+
+        if (TestRegexCases[Index].MatchOffset == (DWORD)-1) {
+            if (Found) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                              _T("%hs:%i YoriLibRegexFindFirst unexpectedly found '%y' in '%y' at %i\n"),
+                              __FILE__,
+                              __LINE__,
+                              &Pattern,
+                              &Text,
+                              MatchOffset);
+                return FALSE;
+            }
+        } else if (!Found ||
+                   MatchOffset != TestRegexCases[Index].MatchOffset ||
+                   MatchLength != TestRegexCases[Index].MatchLength) {
+
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                          _T("%hs:%i YoriLibRegexFindFirst returned unexpected match for '%y' in '%y', expected %i,%i\n"),
+                          __FILE__,
+                          __LINE__,
+                          &Pattern,
+                          &Text,
+                          TestRegexCases[Index].MatchOffset,
+                          TestRegexCases[Index].MatchLength);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ A test variation to search for several patterns at once, where the earliest
+ match is returned, and the lowest numbered pattern where several match at the
+ same position.
+ */
+BOOLEAN
+TestRegexMultiPattern(VOID)
+{
+    PYORI_LIB_REGEX Regex;
+    YORI_STRING Patterns[3];
+    DWORD PatternFlags[3];
+    YORI_STRING Text;
+    DWORD MatchOffset;
+    DWORD MatchLength;
+    DWORD PatternIndex;
+
+    YoriLibConstantString(&Patterns[0], _T("cd"));
+    YoriLibConstantString(&Patterns[1], _T("b.d"));
+    YoriLibConstantString(&Patterns[2], _T("b"));
+    PatternFlags[0] = 0;
+    PatternFlags[1] = YORI_LIB_REGEX_PATTERN_LITERAL;
+    PatternFlags[2] = 0;
+
+    if (!YoriLibRegexCompile(3, Patterns, PatternFlags, 0, &Regex, NULL, NULL)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                      _T("%hs:%i YoriLibRegexCompile failed\n"),
+                      __FILE__,
+                      __LINE__);
+        return FALSE;
+    }
+
+    //
+    //  The literal "b.d" does not match "bcd", so "b" is the earliest
+    //  match.  When "b.d" is present it is preferred over "b".
+    //
+
+    YoriLibConstantString(&Text, _T("abcd"));
+    if (!YoriLibRegexFindFirst(Regex, &Text, 0, &MatchOffset, &MatchLength, &PatternIndex) ||
+        MatchOffset != 1 ||
+        MatchLength != 1 ||
+        PatternIndex != 2) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                      _T("%hs:%i YoriLibRegexFindFirst returned unexpected match in '%y'\n"),
+                      __FILE__,
+                      __LINE__,
+                      &Text);
+        YoriLibRegexFree(Regex);
+        return FALSE;
+    }
+
+    YoriLibConstantString(&Text, _T("ab.dcd"));
+    if (!YoriLibRegexFindFirst(Regex, &Text, 0, &MatchOffset, &MatchLength, &PatternIndex) ||
+        MatchOffset != 1 ||
+        MatchLength != 3 ||
+        PatternIndex != 1) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                      _T("%hs:%i YoriLibRegexFindFirst returned unexpected match in '%y'\n"),
+                      __FILE__,
+                      __LINE__,
+                      &Text);
+        YoriLibRegexFree(Regex);
+        return FALSE;
+    }
+
+    if (!YoriLibRegexMatchAny(Regex, &Text, &PatternIndex) ||
+        PatternIndex != 0) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                      _T("%hs:%i YoriLibRegexMatchAny returned unexpected pattern in '%y'\n"),
+                      __FILE__,
+                      __LINE__,
+                      &Text);
+        YoriLibRegexFree(Regex);
+        return FALSE;
+    }
+
+    YoriLibRegexFree(Regex);
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
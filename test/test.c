@@ -93,6 +93,8 @@ TEST_VARIATION TestVariations[] = {
     {TestArgOneArgEnclosedInQuotesCmd,     _T("ArgOneArgEnclosedInQuotesCmd")},
     {TestArgRedirectWithEndingQuoteCmd,    _T("ArgRedirectWithEndingQuoteCmd")},
     {TestArgBackslashEscapeCmd,            _T("ArgBackslashEscapeCmd")},
+    {TestRegexFindFirst,                   _T("RegexFindFirst")},
+    {TestRegexMultiPattern,                _T("RegexMultiPattern")},
 };
 
 
@@ -125,4 +125,14 @@ YORI_TEST_FN TestArgRedirectWithEndingQuoteCmd;
  */
 YORI_TEST_FN TestArgBackslashEscapeCmd;
 
+/**
+ A test variation to search for a set of regular expressions.
+ */
+YORI_TEST_FN TestRegexFindFirst;
+
+/**
+ A test variation to search for several regular expressions at once.
+ */
+YORI_TEST_FN TestRegexMultiPattern;
+
 // vim:sw=4:ts=4:et:
@@ -3,7 +3,7 @@
  *
  * Yori shell display file contents
  *
- * Copyright (c) 2017-2019 Malcolm J. Smith
+ * Copyright (c) 2017-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -56,6 +56,12 @@ TypeHelp(VOID)
     return TRUE;
 }
 
+/**
+ The size of the buffer used to copy files which are output without any
+ interpretation.
+ */
+#define TYPE_COPY_BUFFER_SIZE (1024 * 1024)
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -71,6 +77,14 @@ typedef struct _TYPE_CONTEXT {
      */
     BOOLEAN DisplayLineNumbers;
 
+    /**
+     TRUE to indicate that file contents should be copied to output without
+     being interpreted as lines.  This is possible when no lines are being
+     numbered or limited, output is not to a console, and input and output
+     use the same encoding.
+     */
+    BOOLEAN PassThrough;
+
     /**
      The first error encountered when enumerating objects from a single arg.
      This is used to preserve file not found/path not found errors so that
@@ -100,8 +114,80 @@ typedef struct _TYPE_CONTEXT {
      */
     DWORDLONG FileLinesFound;
 
+    /**
+     A buffer used to copy file contents when PassThrough is TRUE.  This is
+     allocated on first use.
+     */
+    PUCHAR CopyBuffer;
+
 } TYPE_CONTEXT, *PTYPE_CONTEXT;
 
+/**
+ Copy a single opened stream to output without interpreting its contents.
+ Any byte order mark at the start of the stream is not copied, consistent
+ with the output generated when lines are interpreted.
+
+ @param hSource The opened source stream.
+
+ @param TypeContext Pointer to context information.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+TypeCopyStream(
+    __in HANDLE hSource,
+    __in PTYPE_CONTEXT TypeContext
+    )
+{
+    HANDLE OutputHandle;
+    DWORD BytesRead;
+    DWORD BytesWritten;
+    DWORD BomLength;
+    DWORD Encoding;
+    BOOLEAN FirstRead;
+    PUCHAR Buffer;
+
+    if (TypeContext->CopyBuffer == NULL) {
+        TypeContext->CopyBuffer = YoriLibMalloc(TYPE_COPY_BUFFER_SIZE);
+        if (TypeContext->CopyBuffer == NULL) {
+            return FALSE;
+        }
+    }
+
+    OutputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+    Encoding = YoriLibGetMultibyteInputEncoding();
+    Buffer = TypeContext->CopyBuffer;
+    FirstRead = TRUE;
+
+    while (TRUE) {
+        if (!ReadFile(hSource, Buffer, TYPE_COPY_BUFFER_SIZE, &BytesRead, NULL) ||
+            BytesRead == 0) {
+
+            break;
+        }
+
+        BomLength = 0;
+        if (FirstRead) {
+            FirstRead = FALSE;
+            if (Encoding == CP_UTF8 && BytesRead >= 3 &&
+                Buffer[0] == 0xEF && Buffer[1] == 0xBB && Buffer[2] == 0xBF) {
+
+                BomLength = 3;
+            } else if (Encoding == CP_UTF16 && BytesRead >= 2 &&
+                       ((Buffer[0] == 0xFF && Buffer[1] == 0xFE) || (Buffer[0] == 0xFE && Buffer[1] == 0xFF))) {
+
+                BomLength = 2;
+            }
+        }
+
+        if (!WriteFile(OutputHandle, Buffer + BomLength, BytesRead - BomLength, &BytesWritten, NULL)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
 /**
  Process a single opened stream, enumerating through all lines and displaying
  the set requested by the user.
@@ -127,14 +213,18 @@ TypeProcessStream(
     DWORD CharactersDisplayed;
     HANDLE OutputHandle;
 
-    OutputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
-
-    YoriLibInitEmptyString(&LineString);
-
     TypeContext->FilesFound++;
     TypeContext->FilesFoundThisArg++;
     TypeContext->FileLinesFound = 0;
 
+    if (TypeContext->PassThrough) {
+        return TypeCopyStream(hSource, TypeContext);
+    }
+
+    OutputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+
+    YoriLibInitEmptyString(&LineString);
+
     OutputIsConsole = FALSE;
     if (GetConsoleMode(OutputHandle, &dwMode)) {
         OutputIsConsole = TRUE;
@@ -327,6 +417,7 @@ ENTRYPOINT(
     DWORD i;
     DWORD StartArg = 0;
     DWORD MatchFlags;
+    DWORD ConsoleMode;
     BOOL BasicEnumeration = FALSE;
     TYPE_CONTEXT TypeContext;
     YORI_STRING Arg;
@@ -343,7 +434,7 @@ ENTRYPOINT(
                 TypeHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2017-2019"));
+                YoriLibDisplayMitLicense(_T("2017-2026"));
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
@@ -411,6 +502,20 @@ ENTRYPOINT(
 
     YoriLibEnableBackupPrivilege();
 
+    //
+    //  If the output does not need to be interpreted, copy it directly.
+    //  Output to a console is always interpreted, since console output is
+    //  not in a multibyte encoding.
+    //
+
+    if (!TypeContext.DisplayLineNumbers &&
+        TypeContext.HeadLines == 0 &&
+        !GetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), &ConsoleMode) &&
+        YoriLibGetMultibyteInputEncoding() == YoriLibGetMultibyteOutputEncoding()) {
+
+        TypeContext.PassThrough = TRUE;
+    }
+
     //
     //  If no file name is specified, use stdin; otherwise open
     //  the file and use that
@@ -462,6 +567,10 @@ ENTRYPOINT(
     YoriLibLineReadCleanupCache();
 #endif
 
+    if (TypeContext.CopyBuffer != NULL) {
+        YoriLibFree(TypeContext.CopyBuffer);
+    }
+
     if (TypeContext.FilesFound == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("type: no matching files found\n"));
         return EXIT_FAILURE;
@@ -3,7 +3,7 @@
  *
  * Yori shell vhdtool for managing VHD files
  *
- * Copyright (c) 2019 Malcolm J. Smith
+ * Copyright (c) 2019-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -99,7 +99,353 @@ typedef enum _VHDTOOL_SECTOR_SIZE {
 } VHDTOOL_SECTOR_SIZE;
 
 /**
- Clone a fixed ISO file.
+ The size of each buffer used when cloning a device into an image.
+ */
+#define VHDTOOL_CLONE_BUFFER_SIZE (1024 * 1024)
+
+/**
+ The number of buffers used when cloning.  While the target is being written
+ from one buffer, the source can be read into the others.
+ */
+#define VHDTOOL_CLONE_BUFFER_COUNT (4)
+
+/**
+ The granularity at which regions of zeroes are detected and skipped when
+ cloning.  Each buffer is divided into this many regions, so the number of
+ regions per buffer must fit in the bits of a DWORD.
+ */
+#define VHDTOOL_CLONE_ZERO_CHUNK_SIZE (64 * 1024)
+
+/**
+ A single buffer used when cloning.
+ */
+typedef struct _VHDTOOL_CLONE_BUFFER {
+
+    /**
+     The data read from the source.
+     */
+    PUCHAR Buffer;
+
+    /**
+     The number of bytes of valid data in the buffer.  If zero, the end of
+     the source has been reached.
+     */
+    DWORD BytesValid;
+
+    /**
+     A bitmask of regions within the buffer that contain only zeroes.  Bit N
+     refers to the region starting at N * VHDTOOL_CLONE_ZERO_CHUNK_SIZE.
+     */
+    DWORD ZeroMask;
+} VHDTOOL_CLONE_BUFFER, *PVHDTOOL_CLONE_BUFFER;
+
+/**
+ Context shared between the thread reading from the source and the thread
+ writing to the target when cloning.
+ */
+typedef struct _VHDTOOL_CLONE_CONTEXT {
+
+    /**
+     Handle to the source file or device.
+     */
+    HANDLE SourceHandle;
+
+    /**
+     The sector size of the source.  Reads that fail near the end of a
+     device are retried in units of this size.
+     */
+    DWORD BytesPerSector;
+
+    /**
+     An error encountered reading from the source, or ERROR_SUCCESS.
+     */
+    DWORD ReadError;
+
+    /**
+     Set to TRUE by the writer to indicate the reader should stop.
+     */
+    BOOLEAN Abort;
+
+    /**
+     A semaphore counting the buffers that have been read and are ready to
+     be written.
+     */
+    HANDLE FilledSemaphore;
+
+    /**
+     A semaphore counting the buffers that have been written and are ready
+     to be read into.
+     */
+    HANDLE EmptySemaphore;
+
+    /**
+     The buffers used to transfer data.  These are used in order, so the
+     reader and writer each only need to track their own position.
+     */
+    VHDTOOL_CLONE_BUFFER Buffers[VHDTOOL_CLONE_BUFFER_COUNT];
+} VHDTOOL_CLONE_CONTEXT, *PVHDTOOL_CLONE_CONTEXT;
+
+/**
+ Check whether a region of memory consists entirely of zeroes.  This is
+ performed on a pointer sized word at a time, examining several words
+ before each branch.
+
+ @param Buffer Pointer to the region to check.  This must be pointer
+        aligned.
+
+ @param Length The length of the region, in bytes.
+
+ @return TRUE if the region contains only zeroes, FALSE if it contains
+         data.
+ */
+BOOLEAN
+VhdToolCloneIsZero(
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    PDWORD_PTR Words;
+    DWORD WordCount;
+    DWORD Index;
+
+    Words = (PDWORD_PTR)Buffer;
+    WordCount = Length / sizeof(DWORD_PTR);
+
+    for (Index = 0; Index + 8 <= WordCount; Index += 8) {
+        if ((Words[Index] | Words[Index + 1] | Words[Index + 2] | Words[Index + 3] |
+             Words[Index + 4] | Words[Index + 5] | Words[Index + 6] | Words[Index + 7]) != 0) {
+
+            return FALSE;
+        }
+    }
+
+    for (; Index < WordCount; Index++) {
+        if (Words[Index] != 0) {
+            return FALSE;
+        }
+    }
+
+    for (Index = WordCount * sizeof(DWORD_PTR); Index < Length; Index++) {
+        if (Buffer[Index] != 0) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Fill a single buffer from the source.  Devices fail reads that extend
+ beyond the end of the device, so if a large read fails, the remainder of
+ this buffer is read one sector at a time.  The next buffer starts again
+ with large reads.
+
+ @param CloneContext Pointer to the clone context.
+
+ @param Buffer Pointer to the buffer to fill.  On completion, BytesValid is
+        zero if no more data can be read.
+
+ @return TRUE if more data may follow, FALSE if the end of the source has
+         been reached or an error occurred.
+ */
+BOOL
+VhdToolCloneFillBuffer(
+    __in PVHDTOOL_CLONE_CONTEXT CloneContext,
+    __in PVHDTOOL_CLONE_BUFFER Buffer
+    )
+{
+    DWORD BytesToRead;
+    DWORD BytesRead;
+    DWORD Offset;
+    DWORD Err;
+    BOOLEAN SectorReads;
+    BOOL MoreData;
+
+    SectorReads = FALSE;
+    MoreData = TRUE;
+    Buffer->BytesValid = 0;
+
+    while (Buffer->BytesValid < VHDTOOL_CLONE_BUFFER_SIZE) {
+        BytesToRead = VHDTOOL_CLONE_BUFFER_SIZE - Buffer->BytesValid;
+        if (SectorReads && BytesToRead > CloneContext->BytesPerSector) {
+            BytesToRead = CloneContext->BytesPerSector;
+        }
+
+        if (!ReadFile(CloneContext->SourceHandle, &Buffer->Buffer[Buffer->BytesValid], BytesToRead, &BytesRead, NULL)) {
+            Err = GetLastError();
+            if (Err == ERROR_INVALID_FUNCTION) {
+                if (!SectorReads && BytesToRead > CloneContext->BytesPerSector) {
+                    SectorReads = TRUE;
+                    continue;
+                }
+            } else if (Err != ERROR_HANDLE_EOF) {
+                CloneContext->ReadError = Err;
+            }
+            MoreData = FALSE;
+            break;
+        }
+
+        if (BytesRead == 0) {
+            MoreData = FALSE;
+            break;
+        }
+
+        Buffer->BytesValid = Buffer->BytesValid + BytesRead;
+    }
+
+    Buffer->ZeroMask = 0;
+    for (Offset = 0; Offset < Buffer->BytesValid; Offset += VHDTOOL_CLONE_ZERO_CHUNK_SIZE) {
+        BytesToRead = Buffer->BytesValid - Offset;
+        if (BytesToRead > VHDTOOL_CLONE_ZERO_CHUNK_SIZE) {
+            BytesToRead = VHDTOOL_CLONE_ZERO_CHUNK_SIZE;
+        }
+        if (VhdToolCloneIsZero(&Buffer->Buffer[Offset], BytesToRead)) {
+            Buffer->ZeroMask = Buffer->ZeroMask | (1 << (Offset / VHDTOOL_CLONE_ZERO_CHUNK_SIZE));
+        }
+    }
+
+    return MoreData;
+}
+
+/**
+ A background thread which reads from the source into each buffer in turn,
+ and indicates to the writer when each buffer is ready.  When the end of the
+ source is reached, a buffer with no data is queued to terminate the writer.
+
+ @param Context Pointer to the clone context.
+
+ @return Zero.
+ */
+DWORD WINAPI
+VhdToolCloneReader(
+    __in LPVOID Context
+    )
+{
+    PVHDTOOL_CLONE_CONTEXT CloneContext;
+    PVHDTOOL_CLONE_BUFFER Buffer;
+    DWORD Index;
+    BOOL MoreData;
+
+    CloneContext = (PVHDTOOL_CLONE_CONTEXT)Context;
+    Index = 0;
+    MoreData = TRUE;
+
+    while (TRUE) {
+        WaitForSingleObject(CloneContext->EmptySemaphore, INFINITE);
+        if (CloneContext->Abort) {
+            break;
+        }
+
+        Buffer = &CloneContext->Buffers[Index];
+        if (MoreData) {
+            MoreData = VhdToolCloneFillBuffer(CloneContext, Buffer);
+        } else {
+            Buffer->BytesValid = 0;
+        }
+
+        ReleaseSemaphore(CloneContext->FilledSemaphore, 1, NULL);
+        if (Buffer->BytesValid == 0) {
+            break;
+        }
+
+        Index = (Index + 1) % VHDTOOL_CLONE_BUFFER_COUNT;
+    }
+
+    return 0;
+}
+
+/**
+ Display the progress of a clone operation.
+
+ @param BytesProcessed The number of bytes read from the source so far.
+
+ @param BytesSkipped The number of bytes which were zero and not written.
+
+ @param TotalBytes The total size of the source, or zero if not known.
+
+ @param ElapsedMs The number of milliseconds since the operation started.
+
+ @param Final TRUE if this is the final report once the operation is
+        complete, FALSE if the operation is ongoing.
+ */
+VOID
+VhdToolCloneDisplayProgress(
+    __in DWORDLONG BytesProcessed,
+    __in DWORDLONG BytesSkipped,
+    __in DWORDLONG TotalBytes,
+    __in DWORD ElapsedMs,
+    __in BOOLEAN Final
+    )
+{
+    YORI_STRING ProcessedString;
+    YORI_STRING TotalString;
+    YORI_STRING SkippedString;
+    YORI_STRING RateString;
+    TCHAR ProcessedStringBuffer[16];
+    TCHAR TotalStringBuffer[16];
+    TCHAR SkippedStringBuffer[16];
+    TCHAR RateStringBuffer[16];
+    LARGE_INTEGER liSize;
+
+    YoriLibInitEmptyString(&ProcessedString);
+    ProcessedString.StartOfString = ProcessedStringBuffer;
+    ProcessedString.LengthAllocated = sizeof(ProcessedStringBuffer)/sizeof(ProcessedStringBuffer[0]);
+
+    YoriLibInitEmptyString(&TotalString);
+    TotalString.StartOfString = TotalStringBuffer;
+    TotalString.LengthAllocated = sizeof(TotalStringBuffer)/sizeof(TotalStringBuffer[0]);
+
+    YoriLibInitEmptyString(&SkippedString);
+    SkippedString.StartOfString = SkippedStringBuffer;
+    SkippedString.LengthAllocated = sizeof(SkippedStringBuffer)/sizeof(SkippedStringBuffer[0]);
+
+    YoriLibInitEmptyString(&RateString);
+    RateString.StartOfString = RateStringBuffer;
+    RateString.LengthAllocated = sizeof(RateStringBuffer)/sizeof(RateStringBuffer[0]);
+
+    if (ElapsedMs == 0) {
+        ElapsedMs = 1;
+    }
+
+    liSize.QuadPart = BytesProcessed;
+    YoriLibFileSizeToString(&ProcessedString, &liSize);
+    liSize.QuadPart = BytesSkipped;
+    YoriLibFileSizeToString(&SkippedString, &liSize);
+    liSize.QuadPart = BytesProcessed * 1000 / ElapsedMs;
+    YoriLibFileSizeToString(&RateString, &liSize);
+
+    if (Final) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                      _T("%y copied in %i seconds, %y/s, %y of zeroes skipped\n"),
+                      &ProcessedString,
+                      ElapsedMs / 1000,
+                      &RateString,
+                      &SkippedString);
+    } else if (TotalBytes > 0) {
+        liSize.QuadPart = TotalBytes;
+        YoriLibFileSizeToString(&TotalString, &liSize);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                      _T("\r%y of %y (%i%%), %y/s, %y skipped "),
+                      &ProcessedString,
+                      &TotalString,
+                      (DWORD)(BytesProcessed * 100 / TotalBytes),
+                      &RateString,
+                      &SkippedString);
+    } else {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                      _T("\r%y, %y/s, %y skipped "),
+                      &ProcessedString,
+                      &RateString,
+                      &SkippedString);
+    }
+}
+
+/**
+ Clone a fixed ISO file.  The source is read on a background thread into a
+ small ring of buffers while the target is written from previously read
+ buffers.  Regions of the source which are entirely zero are not written,
+ and the target is marked sparse where the file system supports it, so
+ those regions do not consume space in the target.
 
  @param Path Pointer to the path of the file to create.
 
@@ -113,18 +459,33 @@ VhdToolCloneIso(
     __in PYORI_STRING SourcePath
     )
 {
-    HANDLE SourceHandle;
+    VHDTOOL_CLONE_CONTEXT CloneContext;
+    PVHDTOOL_CLONE_BUFFER Buffer;
     HANDLE TargetHandle;
+    HANDLE ReaderThread;
     YORI_STRING FullPath;
     YORI_STRING FullSourcePath;
-    PVOID Buffer;
-    DWORD BufferSize;
     DWORD BytesRead;
+    DWORD BytesWritten;
     DWORD SectorsPerCluster;
-    DWORD BytesPerSector;
     DWORD FreeClusters;
     DWORD TotalClusters;
+    DWORD ThreadId;
+    DWORD Index;
+    DWORD Offset;
+    DWORD RunLength;
+    DWORD StartTime;
+    DWORD LastProgressTime;
+    DWORD CurrentTime;
+    DWORD dwMode;
+    DWORDLONG TotalBytes;
+    DWORDLONG BytesProcessed;
+    DWORDLONG BytesSkipped;
+    LARGE_INTEGER TargetOffset;
     DISK_GEOMETRY DiskGeometry;
+    BOOLEAN RunIsZero;
+    BOOLEAN DisplayProgress;
+    BOOL Result;
     LPTSTR ErrText;
     DWORD Err;
 
@@ -140,12 +501,14 @@ VhdToolCloneIso(
         return FALSE;
     }
 
+    ZeroMemory(&CloneContext, sizeof(CloneContext));
+
     //
     //  Open the source.  Note this can be a file or a device.
     //
 
-    SourceHandle = CreateFile(FullSourcePath.StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (SourceHandle == INVALID_HANDLE_VALUE) {
+    CloneContext.SourceHandle = CreateFile(FullSourcePath.StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (CloneContext.SourceHandle == INVALID_HANDLE_VALUE) {
         Err = GetLastError();
         ErrText = YoriLibGetWinErrorText(Err);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of source failed: %y: %s"), &FullSourcePath, ErrText);
@@ -156,13 +519,13 @@ VhdToolCloneIso(
     }
 
     TargetHandle = CreateFile(FullPath.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (SourceHandle == INVALID_HANDLE_VALUE) {
+    if (TargetHandle == INVALID_HANDLE_VALUE) {
         Err = GetLastError();
         ErrText = YoriLibGetWinErrorText(Err);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of target failed: %y: %s"), &FullPath, ErrText);
         YoriLibFreeStringContents(&FullPath);
         YoriLibFreeStringContents(&FullSourcePath);
-        CloseHandle(SourceHandle);
+        CloseHandle(CloneContext.SourceHandle);
         YoriLibFreeWinErrorText(ErrText);
         return FALSE;
     }
@@ -172,53 +535,205 @@ VhdToolCloneIso(
     //  that fails, as a file.
     //
 
-    if (DeviceIoControl(SourceHandle, IOCTL_DISK_GET_DRIVE_GEOMETRY, NULL, 0, &DiskGeometry, sizeof(DiskGeometry), &BytesRead, NULL)) {
-        BytesPerSector = DiskGeometry.BytesPerSector;
-    } else if (!GetDiskFreeSpace(FullSourcePath.StartOfString, &SectorsPerCluster, &BytesPerSector, &FreeClusters, &TotalClusters)) {
-        BytesPerSector = 4096;
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("BytesPerSector could not be detected, using default %i\n"), BytesPerSector);
+    if (DeviceIoControl(CloneContext.SourceHandle, IOCTL_DISK_GET_DRIVE_GEOMETRY, NULL, 0, &DiskGeometry, sizeof(DiskGeometry), &BytesRead, NULL)) {
+        CloneContext.BytesPerSector = DiskGeometry.BytesPerSector;
+    } else if (!GetDiskFreeSpace(FullSourcePath.StartOfString, &SectorsPerCluster, &CloneContext.BytesPerSector, &FreeClusters, &TotalClusters)) {
+        CloneContext.BytesPerSector = 4096;
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("BytesPerSector could not be detected, using default %i\n"), CloneContext.BytesPerSector);
     }
 
-    BufferSize = 1024 * 1024;
-    Buffer = YoriLibMalloc(BufferSize);
-    if (Buffer == NULL) {
-        YoriLibFreeStringContents(&FullPath);
-        YoriLibFreeStringContents(&FullSourcePath);
-        CloseHandle(SourceHandle);
-        CloseHandle(TargetHandle);
-        return FALSE;
+    if (CloneContext.BytesPerSector == 0) {
+        CloneContext.BytesPerSector = 4096;
     }
 
     //
-    //  Copy data.  Devices appear to fail outright if the end of the device
-    //  is reached, so the final portion is read one sector at a time.
+    //  The total size is only used to display progress, so it's not fatal
+    //  if it can't be determined.
     //
 
-    while(TRUE) {
-        if (!ReadFile(SourceHandle, Buffer, BufferSize, &BytesRead, NULL)) {
-            Err = GetLastError();
-            if (Err == ERROR_INVALID_FUNCTION) {
-                if (BufferSize != BytesPerSector) {
-                    BufferSize = BytesPerSector;
-                    continue;
+    if (YoriLibGetFileOrDeviceSize(CloneContext.SourceHandle, &TotalBytes) != ERROR_SUCCESS) {
+        TotalBytes = 0;
+    }
+
+    //
+    //  Regions of zeroes are skipped rather than written.  If the file
+    //  system supports sparse files, these regions do not need to be
+    //  allocated.  If not, they are filled with zeroes by the file system.
+    //
+
+    DeviceIoControl(TargetHandle, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &BytesRead, NULL);
+
+    Result = FALSE;
+    ReaderThread = NULL;
+
+    for (Index = 0; Index < VHDTOOL_CLONE_BUFFER_COUNT; Index++) {
+        CloneContext.Buffers[Index].Buffer = VirtualAlloc(NULL, VHDTOOL_CLONE_BUFFER_SIZE, MEM_COMMIT, PAGE_READWRITE);
+        if (CloneContext.Buffers[Index].Buffer == NULL) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("vhdtool: out of memory\n"));
+            goto Exit;
+        }
+    }
+
+    CloneContext.FilledSemaphore = CreateSemaphore(NULL, 0, VHDTOOL_CLONE_BUFFER_COUNT, NULL);
+    CloneContext.EmptySemaphore = CreateSemaphore(NULL, VHDTOOL_CLONE_BUFFER_COUNT, VHDTOOL_CLONE_BUFFER_COUNT, NULL);
+    if (CloneContext.FilledSemaphore == NULL || CloneContext.EmptySemaphore == NULL) {
+        Err = GetLastError();
+        ErrText = YoriLibGetWinErrorText(Err);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("vhdtool: CreateSemaphore failed: %s"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        goto Exit;
+    }
+
+    ReaderThread = CreateThread(NULL, 0, VhdToolCloneReader, &CloneContext, 0, &ThreadId);
+    if (ReaderThread == NULL) {
+        Err = GetLastError();
+        ErrText = YoriLibGetWinErrorText(Err);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("vhdtool: CreateThread failed: %s"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        goto Exit;
+    }
+
+    DisplayProgress = FALSE;
+    if (GetConsoleMode(GetStdHandle(STD_ERROR_HANDLE), &dwMode)) {
+        DisplayProgress = TRUE;
+    }
+
+    BytesProcessed = 0;
+    BytesSkipped = 0;
+    TargetOffset.QuadPart = 0;
+    StartTime = GetTickCount();
+    LastProgressTime = StartTime;
+    Index = 0;
+    Result = TRUE;
+
+    //
+    //  Write each buffer as it becomes available.  Consecutive regions of
+    //  data are written together, and consecutive regions of zeroes are
+    //  skipped by advancing the target offset.
+    //
+
+    while (TRUE) {
+        WaitForSingleObject(CloneContext.FilledSemaphore, INFINITE);
+        Buffer = &CloneContext.Buffers[Index];
+        if (Buffer->BytesValid == 0) {
+            break;
+        }
+
+        for (Offset = 0; Offset < Buffer->BytesValid; Offset += RunLength) {
+            RunIsZero = (BOOLEAN)((Buffer->ZeroMask & (1 << (Offset / VHDTOOL_CLONE_ZERO_CHUNK_SIZE))) != 0);
+            RunLength = 0;
+            do {
+                RunLength = RunLength + VHDTOOL_CLONE_ZERO_CHUNK_SIZE;
+            } while (Offset + RunLength < Buffer->BytesValid &&
+                     RunIsZero == (BOOLEAN)((Buffer->ZeroMask & (1 << ((Offset + RunLength) / VHDTOOL_CLONE_ZERO_CHUNK_SIZE))) != 0));
+
+            if (Offset + RunLength > Buffer->BytesValid) {
+                RunLength = Buffer->BytesValid - Offset;
+            }
+
+            if (RunIsZero) {
+                BytesSkipped = BytesSkipped + RunLength;
+            } else {
+                if (SetFilePointer(TargetHandle, TargetOffset.LowPart, &TargetOffset.HighPart, FILE_BEGIN) == (DWORD)-1 &&
+                    GetLastError() != NO_ERROR) {
+
+                    Result = FALSE;
+                } else if (!WriteFile(TargetHandle, &Buffer->Buffer[Offset], RunLength, &BytesWritten, NULL) ||
+                           BytesWritten != RunLength) {
+
+                    Result = FALSE;
+                }
+
+                if (!Result) {
+                    Err = GetLastError();
+                    ErrText = YoriLibGetWinErrorText(Err);
+                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Write to target failed: %y: %s"), &FullPath, ErrText);
+                    YoriLibFreeWinErrorText(ErrText);
+                    break;
                 }
             }
-            break;
+
+            TargetOffset.QuadPart = TargetOffset.QuadPart + RunLength;
         }
 
-        if (BytesRead == 0) {
+        BytesProcessed = BytesProcessed + Buffer->BytesValid;
+
+        //
+        //  If the write failed, tell the reader to stop, and release a
+        //  buffer in case the reader is waiting for one.
+        //
+
+        if (!Result) {
+            CloneContext.Abort = TRUE;
+            ReleaseSemaphore(CloneContext.EmptySemaphore, 1, NULL);
             break;
         }
 
-        WriteFile(TargetHandle, Buffer, BytesRead, &BytesRead, NULL);
+        ReleaseSemaphore(CloneContext.EmptySemaphore, 1, NULL);
+        Index = (Index + 1) % VHDTOOL_CLONE_BUFFER_COUNT;
+
+        CurrentTime = GetTickCount();
+        if (DisplayProgress && CurrentTime - LastProgressTime >= 1000) {
+            LastProgressTime = CurrentTime;
+            VhdToolCloneDisplayProgress(BytesProcessed, BytesSkipped, TotalBytes, CurrentTime - StartTime, FALSE);
+        }
+    }
+
+    WaitForSingleObject(ReaderThread, INFINITE);
+
+    if (DisplayProgress) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("\n"));
+    }
+
+    //
+    //  If the source ended with zeroes, the target needs to be extended to
+    //  include them.
+    //
+
+    if (Result) {
+        if ((SetFilePointer(TargetHandle, TargetOffset.LowPart, &TargetOffset.HighPart, FILE_BEGIN) == (DWORD)-1 &&
+             GetLastError() != NO_ERROR) ||
+            !SetEndOfFile(TargetHandle)) {
+
+            Err = GetLastError();
+            ErrText = YoriLibGetWinErrorText(Err);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Extending target failed: %y: %s"), &FullPath, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            Result = FALSE;
+        }
     }
 
-    YoriLibFree(Buffer);
+    if (Result && CloneContext.ReadError != ERROR_SUCCESS) {
+        ErrText = YoriLibGetWinErrorText(CloneContext.ReadError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Read from source failed: %y: %s"), &FullSourcePath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        Result = FALSE;
+    }
+
+    if (Result) {
+        VhdToolCloneDisplayProgress(BytesProcessed, BytesSkipped, TotalBytes, GetTickCount() - StartTime, TRUE);
+    }
+
+Exit:
+    if (ReaderThread != NULL) {
+        CloseHandle(ReaderThread);
+    }
+    if (CloneContext.FilledSemaphore != NULL) {
+        CloseHandle(CloneContext.FilledSemaphore);
+    }
+    if (CloneContext.EmptySemaphore != NULL) {
+        CloseHandle(CloneContext.EmptySemaphore);
+    }
+    for (Index = 0; Index < VHDTOOL_CLONE_BUFFER_COUNT; Index++) {
+        if (CloneContext.Buffers[Index].Buffer != NULL) {
+            VirtualFree(CloneContext.Buffers[Index].Buffer, 0, MEM_RELEASE);
+        }
+    }
     YoriLibFreeStringContents(&FullPath);
     YoriLibFreeStringContents(&FullSourcePath);
-    CloseHandle(SourceHandle);
+    CloseHandle(CloneContext.SourceHandle);
     CloseHandle(TargetHandle);
-    return TRUE;
+    return Result;
 }
 
 /**
@@ -1008,7 +1523,7 @@ ENTRYPOINT(
                 VhdToolHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2019"));
+                YoriLibDisplayMitLicense(_T("2019-2026"));
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("clonedynamic")) == 0) {
                 if (ArgC > i + 2) {
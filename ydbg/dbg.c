@@ -3,7 +3,7 @@
  *
  * Yori shell debug processes
  *
- * Copyright (c) 2018-2021 Malcolm J. Smith
+ * Copyright (c) 2018-2026 Malcolm J. Smith
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -36,11 +36,12 @@ CHAR strYDbgHelpText[] =
         "Debugs processes and system components.\n"
         "\n"
         "YDBG -c <file>\n"
-        "YDBG -d <pid> <file>\n"
+        "YDBG [-m <type>] -d <pid> <file>\n"
         "YDBG [-l] [-w] -e <executable> <args>\n"
         "YDBG -license\n"
         "YDBG -k <file>\n"
         "YDBG -ks <pid> <file>\n"
+        "YDBG [-m <type>] -t <pid> <directory>\n"
         "\n"
         "   -c             Dump memory from kernel and user processes to a file\n"
         "   -d             Dump memory from a process to a file\n"
@@ -48,6 +49,8 @@ CHAR strYDbgHelpText[] =
         "   -k             Dump memory from kernel to a file\n"
         "   -ks            Dump memory from kernel stacks associated with a process to a file\n"
         "   -l             Enable loader snaps for a child process\n"
+        "   -m             The type of process dump, being full (default), heap or mini\n"
+        "   -t             Suspend a process and its descendants and dump each to a directory\n"
         "   -w             Create child process in a new window\n";
 
 /**
@@ -64,6 +67,29 @@ YDbgHelp(VOID)
     return TRUE;
 }
 
+/**
+ A dump containing all accessible memory in the process.
+ MiniDumpWithFullMemory.
+ */
+#define YDBG_DUMP_TYPE_FULL (0x00000002)
+
+/**
+ A dump containing writable memory in the process and information about
+ threads, handles and modules, but not memory that is backed by image
+ files.  MiniDumpWithDataSegs | MiniDumpWithHandleData |
+ MiniDumpWithUnloadedModules | MiniDumpWithPrivateReadWriteMemory |
+ MiniDumpWithFullMemoryInfo | MiniDumpWithThreadInfo.
+ */
+#define YDBG_DUMP_TYPE_HEAP (0x00001A25)
+
+/**
+ A dump containing thread stacks and the memory they refer to, along with
+ information about threads, handles and modules.  MiniDumpWithHandleData |
+ MiniDumpWithUnloadedModules | MiniDumpWithIndirectlyReferencedMemory |
+ MiniDumpWithThreadInfo.
+ */
+#define YDBG_DUMP_TYPE_MINI (0x00001064)
+
 /**
  Write the memory from a process to a dump file.
 
@@ -71,12 +97,16 @@ YDbgHelp(VOID)
 
  @param FileName Specifies the file name to write the memory to.
 
+ @param DumpType Specifies the type of dump to write, as a set of
+        MINIDUMP_TYPE flags.
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
 YDbgDumpProcess(
     __in DWORD ProcessPid,
-    __in PYORI_STRING FileName
+    __in PYORI_STRING FileName,
+    __in DWORD DumpType
     )
 {
     HANDLE ProcessHandle;
@@ -122,7 +152,7 @@ YDbgDumpProcess(
         return FALSE;
     }
 
-    if (!DllDbgHelp.pMiniDumpWriteDump(ProcessHandle, ProcessPid, FileHandle, 2, NULL, NULL, NULL)) {
+    if (!DllDbgHelp.pMiniDumpWriteDump(ProcessHandle, ProcessPid, FileHandle, DumpType, NULL, NULL, NULL)) {
         LastError = GetLastError();
         ErrText = YoriLibGetWinErrorText(LastError);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: MiniDumpWriteDump failed: %s"), ErrText);
@@ -167,37 +197,26 @@ YDbgBuildThreadArrayForProcessId(
     __out DWORD *HandleCount
     )
 {
-    PYORI_SYSTEM_PROCESS_INFORMATION ProcessInfo;
+    PYORI_LIB_PROCESS_SNAPSHOT Snapshot;
     PYORI_SYSTEM_PROCESS_INFORMATION CurrentEntry;
     PYORI_SYSTEM_THREAD_INFORMATION CurrentThread;
     DWORD Index;
     PHANDLE LocalHandleArray;
 
-    if (!YoriLibGetSystemProcessList(&ProcessInfo)) {
+    if (!YoriLibCreateProcessSnapshot(&Snapshot)) {
         return FALSE;
     }
 
-    CurrentEntry = ProcessInfo;
-    do {
-        if (CurrentEntry->ProcessId == ProcessPid) {
-            break;
-        }
-        if (CurrentEntry->NextEntryOffset == 0) {
-            CurrentEntry = NULL;
-            break;
-        }
-        CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
-    } while(TRUE);
-
+    CurrentEntry = YoriLibProcessSnapshotFindById(Snapshot, ProcessPid);
     if (CurrentEntry == NULL) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: process %i not found\n"), ProcessPid);
-        YoriLibFree(ProcessInfo);
+        YoriLibFreeProcessSnapshot(Snapshot);
         return FALSE;
     }
 
     LocalHandleArray = YoriLibMalloc(CurrentEntry->NumberOfThreads * sizeof(HANDLE));
     if (LocalHandleArray == NULL) {
-        YoriLibFree(ProcessInfo);
+        YoriLibFreeProcessSnapshot(Snapshot);
         return FALSE;
     }
 
@@ -219,17 +238,693 @@ YDbgBuildThreadArrayForProcessId(
                 CloseHandle(LocalHandleArray[Index - 1]);
             }
             YoriLibFree(LocalHandleArray);
-            YoriLibFree(ProcessInfo);
+            YoriLibFreeProcessSnapshot(Snapshot);
             return FALSE;
         }
     }
     *HandleArray = LocalHandleArray;
     *HandleCount = CurrentEntry->NumberOfThreads;
 
-    YoriLibFree(ProcessInfo);
+    YoriLibFreeProcessSnapshot(Snapshot);
+    return TRUE;
+}
+
+
+/**
+ The maximum number of dumps to write concurrently.
+ */
+#define YDBG_MAX_DUMP_THREADS (16)
+
+/**
+ Information about a single process to dump as part of a process tree.
+ */
+typedef struct _YDBG_TREE_DUMP_ENTRY {
+
+    /**
+     The process ID.
+     */
+    DWORD ProcessId;
+
+    /**
+     A handle to the process used to suspend and resume it, or NULL if the
+     process could not be opened.
+     */
+    HANDLE ProcessHandle;
+
+    /**
+     TRUE if the process was suspended and needs to be resumed.
+     */
+    BOOLEAN Suspended;
+
+    /**
+     TRUE if the dump was written successfully.
+     */
+    BOOLEAN Succeeded;
+
+    /**
+     The image name of the process.
+     */
+    YORI_STRING ImageName;
+
+    /**
+     The file name to write the dump to.
+     */
+    YORI_STRING FileName;
+
+    /**
+     The number of milliseconds taken to write the dump.
+     */
+    DWORD ElapsedTime;
+
+    /**
+     The size of the dump file in bytes.
+     */
+    LARGE_INTEGER FileSize;
+
+} YDBG_TREE_DUMP_ENTRY, *PYDBG_TREE_DUMP_ENTRY;
+
+/**
+ Context describing a set of processes to dump concurrently.
+ */
+typedef struct _YDBG_TREE_DUMP_CONTEXT {
+
+    /**
+     An array of processes to dump.
+     */
+    PYDBG_TREE_DUMP_ENTRY Entries;
+
+    /**
+     The number of elements populated in the Entries array.
+     */
+    DWORD EntryCount;
+
+    /**
+     The number of elements allocated in the Entries array.
+     */
+    DWORD EntriesAllocated;
+
+    /**
+     The index of the next entry for a worker thread to dump.
+     */
+    LONG NextEntry;
+
+    /**
+     The type of dump to write.
+     */
+    DWORD DumpType;
+
+    /**
+     The fully qualified directory to write dumps into.
+     */
+    YORI_STRING Directory;
+
+    /**
+     The path to this program.  dbghelp is not safe to call from multiple
+     threads, so each worker dumps by launching a copy of this program.  If
+     empty, dumps are written serially from this process.
+     */
+    YORI_STRING ModuleName;
+
+    /**
+     An array of process IDs which must not be suspended or dumped.  These
+     are this process, its parents, and any console host serving them,
+     since suspending any of these would prevent this process from
+     completing or displaying its results.
+     */
+    PDWORD ExcludedProcessIds;
+
+    /**
+     The number of elements populated in the ExcludedProcessIds array.
+     */
+    DWORD ExcludedCount;
+
+    /**
+     The number of elements allocated in the ExcludedProcessIds array.
+     */
+    DWORD ExcludedAllocated;
+
+    /**
+     Set to TRUE if memory could not be allocated while building the set of
+     excluded processes or the set of processes to dump.
+     */
+    BOOLEAN AllocationFailed;
+
+} YDBG_TREE_DUMP_CONTEXT, *PYDBG_TREE_DUMP_CONTEXT;
+
+/**
+ Add a process to the set of processes which must not be suspended or
+ dumped.
+
+ @param DumpContext Pointer to the tree dump context.
+
+ @param ProcessId The process ID to exclude.
+
+ @return TRUE to indicate success, FALSE to indicate allocation failure.
+ */
+BOOL
+YDbgAddExcludedProcess(
+    __inout PYDBG_TREE_DUMP_CONTEXT DumpContext,
+    __in DWORD ProcessId
+    )
+{
+    PDWORD NewIds;
+    DWORD NewAllocated;
+
+    if (DumpContext->ExcludedCount >= DumpContext->ExcludedAllocated) {
+        NewAllocated = DumpContext->ExcludedAllocated * 2 + 8;
+        NewIds = YoriLibMalloc(NewAllocated * sizeof(DWORD));
+        if (NewIds == NULL) {
+            DumpContext->AllocationFailed = TRUE;
+            return FALSE;
+        }
+
+        if (DumpContext->ExcludedProcessIds != NULL) {
+            memcpy(NewIds, DumpContext->ExcludedProcessIds, DumpContext->ExcludedCount * sizeof(DWORD));
+            YoriLibFree(DumpContext->ExcludedProcessIds);
+        }
+
+        DumpContext->ExcludedProcessIds = NewIds;
+        DumpContext->ExcludedAllocated = NewAllocated;
+    }
+
+    DumpContext->ExcludedProcessIds[DumpContext->ExcludedCount] = ProcessId;
+    DumpContext->ExcludedCount++;
+    return TRUE;
+}
+
+/**
+ Check whether a process must not be suspended or dumped.
+
+ @param DumpContext Pointer to the tree dump context.
+
+ @param ProcessId The process ID to check.
+
+ @return TRUE if the process is excluded, FALSE if it may be dumped.
+ */
+BOOLEAN
+YDbgIsProcessExcluded(
+    __in PYDBG_TREE_DUMP_CONTEXT DumpContext,
+    __in DWORD ProcessId
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < DumpContext->ExcludedCount; Index++) {
+        if (DumpContext->ExcludedProcessIds[Index] == ProcessId) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ A callback invoked for each child of this process or one of its parents,
+ which excludes any console host.
+
+ @param Process Pointer to information about the process.
+
+ @param Context Pointer to the tree dump context.
+
+ @return TRUE to continue enumerating, FALSE to stop.
+ */
+BOOL
+YDbgExcludeConsoleHost(
+    __in PYORI_SYSTEM_PROCESS_INFORMATION Process,
+    __in PVOID Context
+    )
+{
+    PYDBG_TREE_DUMP_CONTEXT DumpContext;
+    YORI_STRING ImageName;
+
+    DumpContext = (PYDBG_TREE_DUMP_CONTEXT)Context;
+
+    YoriLibInitEmptyString(&ImageName);
+    ImageName.StartOfString = Process->ImageName;
+    ImageName.LengthInChars = Process->ImageNameLengthInBytes / sizeof(WCHAR);
+
+    if (YoriLibCompareStringWithLiteralInsensitive(&ImageName, _T("conhost.exe")) == 0) {
+        return YDbgAddExcludedProcess(DumpContext, (DWORD)Process->ProcessId);
+    }
+
+    return TRUE;
+}
+
+/**
+ Build the set of processes which must not be suspended or dumped: this
+ process, each of its parents, and any console host they own.
+
+ @param DumpContext Pointer to the tree dump context.
+
+ @param Snapshot Pointer to a snapshot of processes in the system.
+
+ @return TRUE to indicate success, FALSE to indicate allocation failure.
+ */
+BOOL
+YDbgFindExcludedProcesses(
+    __inout PYDBG_TREE_DUMP_CONTEXT DumpContext,
+    __in PYORI_LIB_PROCESS_SNAPSHOT Snapshot
+    )
+{
+    PYORI_SYSTEM_PROCESS_INFORMATION Process;
+    DWORD AncestorCount;
+    DWORD Index;
+
+    if (!YDbgAddExcludedProcess(DumpContext, GetCurrentProcessId())) {
+        return FALSE;
+    }
+
+    Process = YoriLibProcessSnapshotFindById(Snapshot, GetCurrentProcessId());
+    while (Process != NULL) {
+        Process = YoriLibProcessSnapshotFindParent(Snapshot, Process);
+        if (Process != NULL) {
+            if (!YDbgAddExcludedProcess(DumpContext, (DWORD)Process->ProcessId)) {
+                return FALSE;
+            }
+        }
+    }
+
+    AncestorCount = DumpContext->ExcludedCount;
+    for (Index = 0; Index < AncestorCount; Index++) {
+        YoriLibProcessSnapshotEnumerateChildren(Snapshot, DumpContext->ExcludedProcessIds[Index], YDbgExcludeConsoleHost, DumpContext);
+        if (DumpContext->AllocationFailed) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ A callback invoked for each process in a tree to add it to the set of
+ processes to dump.
+
+ @param Process Pointer to information about the process.
+
+ @param Context Pointer to the tree dump context.
+
+ @return TRUE to continue enumerating, FALSE to stop.
+ */
+BOOL
+YDbgAddTreeDumpEntry(
+    __in PYORI_SYSTEM_PROCESS_INFORMATION Process,
+    __in PVOID Context
+    )
+{
+    PYDBG_TREE_DUMP_CONTEXT DumpContext;
+    PYDBG_TREE_DUMP_ENTRY NewEntries;
+    PYDBG_TREE_DUMP_ENTRY Entry;
+    YORI_STRING ImageName;
+    DWORD NewAllocated;
+
+    DumpContext = (PYDBG_TREE_DUMP_CONTEXT)Context;
+
+    YoriLibInitEmptyString(&ImageName);
+    ImageName.StartOfString = Process->ImageName;
+    ImageName.LengthInChars = Process->ImageNameLengthInBytes / sizeof(WCHAR);
+    if (ImageName.LengthInChars == 0) {
+        YoriLibConstantString(&ImageName, _T("process"));
+    }
+
+    if (YDbgIsProcessExcluded(DumpContext, (DWORD)Process->ProcessId)) {
+        if (Process->ProcessId != GetCurrentProcessId()) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: skipping %y (%i) because this program depends on it\n"), &ImageName, (DWORD)Process->ProcessId);
+        }
+        return TRUE;
+    }
+
+    if (DumpContext->EntryCount == DumpContext->EntriesAllocated) {
+        NewAllocated = DumpContext->EntriesAllocated * 2;
+        if (NewAllocated == 0) {
+            NewAllocated = 32;
+        }
+
+        NewEntries = YoriLibMalloc(NewAllocated * sizeof(YDBG_TREE_DUMP_ENTRY));
+        if (NewEntries == NULL) {
+            DumpContext->AllocationFailed = TRUE;
+            return FALSE;
+        }
+
+        if (DumpContext->EntryCount > 0) {
+            memcpy(NewEntries, DumpContext->Entries, DumpContext->EntryCount * sizeof(YDBG_TREE_DUMP_ENTRY));
+        }
+        if (DumpContext->Entries != NULL) {
+            YoriLibFree(DumpContext->Entries);
+        }
+
+        DumpContext->Entries = NewEntries;
+        DumpContext->EntriesAllocated = NewAllocated;
+    }
+
+    Entry = &DumpContext->Entries[DumpContext->EntryCount];
+    ZeroMemory(Entry, sizeof(YDBG_TREE_DUMP_ENTRY));
+    Entry->ProcessId = (DWORD)Process->ProcessId;
+
+    if (!YoriLibAllocateString(&Entry->ImageName, ImageName.LengthInChars + 1)) {
+        DumpContext->AllocationFailed = TRUE;
+        return FALSE;
+    }
+    memcpy(Entry->ImageName.StartOfString, ImageName.StartOfString, ImageName.LengthInChars * sizeof(TCHAR));
+    Entry->ImageName.LengthInChars = ImageName.LengthInChars;
+    Entry->ImageName.StartOfString[Entry->ImageName.LengthInChars] = '\0';
+
+    YoriLibInitEmptyString(&Entry->FileName);
+    YoriLibYPrintf(&Entry->FileName, _T("%y\\%y_%i.dmp"), &DumpContext->Directory, &Entry->ImageName, Entry->ProcessId);
+    if (Entry->FileName.StartOfString == NULL) {
+        YoriLibFreeStringContents(&Entry->ImageName);
+        DumpContext->AllocationFailed = TRUE;
+        return FALSE;
+    }
+
+    DumpContext->EntryCount++;
     return TRUE;
 }
 
+/**
+ Write the dump for a single process within a tree, recording how long it
+ took and how large the result is.
+
+ @param DumpContext Pointer to the tree dump context.
+
+ @param Entry Pointer to the process to dump.
+ */
+VOID
+YDbgDumpTreeEntry(
+    __in PYDBG_TREE_DUMP_CONTEXT DumpContext,
+    __inout PYDBG_TREE_DUMP_ENTRY Entry
+    )
+{
+    STARTUPINFO StartupInfo;
+    PROCESS_INFORMATION ProcessInfo;
+    YORI_STRING CmdLine;
+    HANDLE FileHandle;
+    DWORD StartTime;
+    DWORD ExitCode;
+
+    StartTime = GetTickCount();
+
+    if (DumpContext->ModuleName.LengthInChars == 0) {
+        Entry->Succeeded = (BOOLEAN)YDbgDumpProcess(Entry->ProcessId, &Entry->FileName, DumpContext->DumpType);
+    } else {
+
+        //
+        //  Launch a copy of this program to write the dump.  The child
+        //  inherits no handles and has no console, so it cannot hold
+        //  open anything belonging to this process or to the processes
+        //  being dumped, and does not create a console host of its own.
+        //  This means errors from the child are not displayed; a failed
+        //  dump is reported when results are displayed.
+        //
+
+        YoriLibInitEmptyString(&CmdLine);
+        YoriLibYPrintf(&CmdLine, _T("\"%y\" -m %i -d %i \"%y\""), &DumpContext->ModuleName, DumpContext->DumpType, Entry->ProcessId, &Entry->FileName);
+        if (CmdLine.StartOfString == NULL) {
+            return;
+        }
+
+        ZeroMemory(&StartupInfo, sizeof(StartupInfo));
+        StartupInfo.cb = sizeof(StartupInfo);
+
+        if (CreateProcess(NULL, CmdLine.StartOfString, NULL, NULL, FALSE, DETACHED_PROCESS, NULL, NULL, &StartupInfo, &ProcessInfo)) {
+            WaitForSingleObject(ProcessInfo.hProcess, INFINITE);
+            if (GetExitCodeProcess(ProcessInfo.hProcess, &ExitCode) && ExitCode == EXIT_SUCCESS) {
+                Entry->Succeeded = TRUE;
+            }
+            CloseHandle(ProcessInfo.hProcess);
+            CloseHandle(ProcessInfo.hThread);
+        }
+
+        YoriLibFreeStringContents(&CmdLine);
+    }
+
+    Entry->ElapsedTime = GetTickCount() - StartTime;
+
+    if (Entry->Succeeded) {
+        FileHandle = CreateFile(Entry->FileName.StartOfString, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (FileHandle != INVALID_HANDLE_VALUE) {
+            Entry->FileSize.LowPart = GetFileSize(FileHandle, (PDWORD)&Entry->FileSize.HighPart);
+            CloseHandle(FileHandle);
+        }
+    }
+}
+
+/**
+ A worker thread which dumps processes from a tree until none remain.
+
+ @param Context Pointer to the tree dump context.
+
+ @return Zero.
+ */
+DWORD WINAPI
+YDbgDumpTreeWorker(
+    __in LPVOID Context
+    )
+{
+    PYDBG_TREE_DUMP_CONTEXT DumpContext = (PYDBG_TREE_DUMP_CONTEXT)Context;
+    DWORD EntryIndex;
+
+    while (TRUE) {
+        EntryIndex = (DWORD)(InterlockedIncrement(&DumpContext->NextEntry) - 1);
+        if (EntryIndex >= DumpContext->EntryCount) {
+            break;
+        }
+
+        YDbgDumpTreeEntry(DumpContext, &DumpContext->Entries[EntryIndex]);
+    }
+
+    return 0;
+}
+
+/**
+ Write dumps of a process and all of its descendants into a directory.  All
+ processes in the tree are suspended before any dump is written, so the
+ dumps describe a consistent point in time, and are resumed once all dumps
+ are complete.  Dumps are written concurrently.  This process, its
+ parents and their console hosts are never suspended or dumped, even if they
+ are within the tree.
+
+ @param ProcessPid Specifies the process at the root of the tree.
+
+ @param DirectoryName Specifies the directory to write dumps into.
+
+ @param DumpType Specifies the type of dump to write.
+
+ @return TRUE to indicate all dumps were written, FALSE to indicate failure.
+ */
+BOOL
+YDbgDumpProcessTree(
+    __in DWORD ProcessPid,
+    __in PYORI_STRING DirectoryName,
+    __in DWORD DumpType
+    )
+{
+    YDBG_TREE_DUMP_CONTEXT DumpContext;
+    PYORI_LIB_PROCESS_SNAPSHOT Snapshot;
+    PYDBG_TREE_DUMP_ENTRY Entry;
+    HANDLE Threads[YDBG_MAX_DUMP_THREADS];
+    SYSTEM_INFO SystemInfo;
+    DWORD ThreadCount;
+    DWORD MaxThreads;
+    DWORD ThreadId;
+    DWORD Index;
+    DWORD StartTime;
+    DWORD LastError;
+    DWORD FailedCount;
+    LPTSTR ErrText;
+    YORI_STRING SizeString;
+    TCHAR SizeStringBuffer[6];
+    BOOL Result;
+
+    YoriLibLoadDbgHelpFunctions();
+    if (DllDbgHelp.pMiniDumpWriteDump == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: OS support not present\n"));
+        return FALSE;
+    }
+
+    YoriLibEnableDebugPrivilege();
+
+    ZeroMemory(&DumpContext, sizeof(DumpContext));
+    DumpContext.DumpType = DumpType;
+
+    if (!YoriLibUserStringToSingleFilePath(DirectoryName, TRUE, &DumpContext.Directory)) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: getfullpathname of %y failed: %s"), DirectoryName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return FALSE;
+    }
+
+    if (!YoriLibCreateDirectoryAndParents(&DumpContext.Directory)) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: could not create %y: %s"), &DumpContext.Directory, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        YoriLibFreeStringContents(&DumpContext.Directory);
+        return FALSE;
+    }
+
+    //
+    //  Find every process in the tree.
+    //
+
+    if (!YoriLibCreateProcessSnapshot(&Snapshot)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: could not enumerate processes\n"));
+        YoriLibFreeStringContents(&DumpContext.Directory);
+        return FALSE;
+    }
+
+    //
+    //  Never suspend this process, anything waiting on it, or the console
+    //  it is writing to, since that would hang this process.
+    //
+
+    if (YDbgFindExcludedProcesses(&DumpContext, Snapshot)) {
+        if (YoriLibProcessSnapshotEnumerateTree(Snapshot, ProcessPid, YDbgAddTreeDumpEntry, &DumpContext) == (DWORD)-1) {
+            DumpContext.AllocationFailed = TRUE;
+        }
+    }
+    YoriLibFreeProcessSnapshot(Snapshot);
+
+    if (DumpContext.AllocationFailed || DumpContext.EntryCount == 0) {
+        if (DumpContext.AllocationFailed) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: out of memory\n"));
+        } else if (YDbgIsProcessExcluded(&DumpContext, ProcessPid)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: no processes to dump in tree %i\n"), ProcessPid);
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: process %i not found\n"), ProcessPid);
+        }
+        for (Index = 0; Index < DumpContext.EntryCount; Index++) {
+            YoriLibFreeStringContents(&DumpContext.Entries[Index].ImageName);
+            YoriLibFreeStringContents(&DumpContext.Entries[Index].FileName);
+        }
+        YoriLibFreeStringContents(&DumpContext.Directory);
+        if (DumpContext.Entries != NULL) {
+            YoriLibFree(DumpContext.Entries);
+        }
+        if (DumpContext.ExcludedProcessIds != NULL) {
+            YoriLibFree(DumpContext.ExcludedProcessIds);
+        }
+        return FALSE;
+    }
+
+    //
+    //  Suspend every process in the tree before dumping any of them.
+    //
+
+    StartTime = GetTickCount();
+    for (Index = 0; Index < DumpContext.EntryCount; Index++) {
+        Entry = &DumpContext.Entries[Index];
+        if (DllNtDll.pNtSuspendProcess == NULL ||
+            DllNtDll.pNtResumeProcess == NULL) {
+
+            break;
+        }
+
+        Entry->ProcessHandle = OpenProcess(PROCESS_SUSPEND_RESUME, FALSE, Entry->ProcessId);
+        if (Entry->ProcessHandle != NULL &&
+            DllNtDll.pNtSuspendProcess(Entry->ProcessHandle) == 0) {
+
+            Entry->Suspended = TRUE;
+        }
+    }
+
+    //
+    //  When running as a standalone program, launch copies of this program
+    //  to write dumps concurrently.  When running as a builtin, the host
+    //  cannot be relaunched in this way, so write the dumps serially.
+    //
+
+#ifndef YORI_BUILTIN
+    if (YoriLibAllocateString(&DumpContext.ModuleName, 32768)) {
+        DumpContext.ModuleName.LengthInChars = GetModuleFileName(NULL, DumpContext.ModuleName.StartOfString, DumpContext.ModuleName.LengthAllocated);
+        if (DumpContext.ModuleName.LengthInChars >= DumpContext.ModuleName.LengthAllocated) {
+            DumpContext.ModuleName.LengthInChars = 0;
+        }
+    }
+#endif
+
+    MaxThreads = 1;
+    if (DumpContext.ModuleName.LengthInChars > 0) {
+        GetSystemInfo(&SystemInfo);
+        MaxThreads = SystemInfo.dwNumberOfProcessors;
+        if (MaxThreads < 2) {
+            MaxThreads = 2;
+        }
+        if (MaxThreads > YDBG_MAX_DUMP_THREADS) {
+            MaxThreads = YDBG_MAX_DUMP_THREADS;
+        }
+        if (MaxThreads > DumpContext.EntryCount) {
+            MaxThreads = DumpContext.EntryCount;
+        }
+    }
+
+    ThreadCount = 0;
+    if (MaxThreads > 1) {
+        for (Index = 0; Index < MaxThreads; Index++) {
+            Threads[ThreadCount] = CreateThread(NULL, 0, YDbgDumpTreeWorker, &DumpContext, 0, &ThreadId);
+            if (Threads[ThreadCount] != NULL) {
+                ThreadCount++;
+            }
+        }
+    }
+
+    if (ThreadCount > 0) {
+        WaitForMultipleObjects(ThreadCount, Threads, TRUE, INFINITE);
+        for (Index = 0; Index < ThreadCount; Index++) {
+            CloseHandle(Threads[Index]);
+        }
+    }
+
+    //
+    //  If no threads were created, dump everything on this thread.
+    //
+
+    YDbgDumpTreeWorker(&DumpContext);
+
+    for (Index = 0; Index < DumpContext.EntryCount; Index++) {
+        Entry = &DumpContext.Entries[Index];
+        if (Entry->Suspended) {
+            DllNtDll.pNtResumeProcess(Entry->ProcessHandle);
+        }
+        if (Entry->ProcessHandle != NULL) {
+            CloseHandle(Entry->ProcessHandle);
+        }
+    }
+
+    //
+    //  Report the result of each dump.
+    //
+
+    YoriLibInitEmptyString(&SizeString);
+    SizeString.StartOfString = SizeStringBuffer;
+    SizeString.LengthAllocated = sizeof(SizeStringBuffer)/sizeof(SizeStringBuffer[0]);
+
+    FailedCount = 0;
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Pid  | Process         | Size  | Time (ms) | File\n"));
+    for (Index = 0; Index < DumpContext.EntryCount; Index++) {
+        Entry = &DumpContext.Entries[Index];
+        if (Entry->Succeeded) {
+            YoriLibFileSizeToString(&SizeString, &Entry->FileSize);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%-6i | %-15y | %-5y | %-9i | %y\n"), Entry->ProcessId, &Entry->ImageName, &SizeString, Entry->ElapsedTime, &Entry->FileName);
+        } else {
+            FailedCount++;
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%-6i | %-15y | failed            | %y\n"), Entry->ProcessId, &Entry->ImageName, &Entry->FileName);
+        }
+        YoriLibFreeStringContents(&Entry->ImageName);
+        YoriLibFreeStringContents(&Entry->FileName);
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n%i of %i processes dumped in %ims\n"), DumpContext.EntryCount - FailedCount, DumpContext.EntryCount, GetTickCount() - StartTime);
+
+    Result = (FailedCount == 0);
+
+    YoriLibFree(DumpContext.Entries);
+    YoriLibFree(DumpContext.ExcludedProcessIds);
+    YoriLibFreeStringContents(&DumpContext.ModuleName);
+    YoriLibFreeStringContents(&DumpContext.Directory);
+    return Result;
+}
+
 
 /**
  Write the kernel stacks owned by a process to a dump file.
@@ -1127,6 +1822,7 @@ typedef enum _YDBG_OP {
     YDbgOperationCompleteDump = 3,
     YDbgOperationProcessKernelStacks = 4,
     YDbgOperationDebugChildProcess = 5,
+    YDbgOperationProcessTreeDump = 6,
 } YDBG_OP;
 
 #ifdef YORI_BUILTIN
@@ -1167,11 +1863,13 @@ ENTRYPOINT(
     LONGLONG llTemp;
     DWORD CharsConsumed;
     DWORD ExitResult;
+    DWORD DumpType;
     BOOLEAN EnableLoaderSnaps;
     BOOLEAN CreateNewWindow;
 
     EnableLoaderSnaps = FALSE;
     CreateNewWindow = FALSE;
+    DumpType = YDBG_DUMP_TYPE_FULL;
     Op = YDbgOperationNone;
 
     for (i = 1; i < ArgC; i++) {
@@ -1185,7 +1883,7 @@ ENTRYPOINT(
                 YDbgHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2018-2021"));
+                YoriLibDisplayMitLicense(_T("2018-2026"));
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c")) == 0) {
                 if (ArgC > i + 1) {
@@ -1235,6 +1933,36 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
                 EnableLoaderSnaps = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
+                if (ArgC > i + 1) {
+                    ArgumentUnderstood = TRUE;
+                    if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("full")) == 0) {
+                        DumpType = YDBG_DUMP_TYPE_FULL;
+                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("heap")) == 0) {
+                        DumpType = YDBG_DUMP_TYPE_HEAP;
+                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("mini")) == 0) {
+                        DumpType = YDBG_DUMP_TYPE_MINI;
+                    } else if (YoriLibStringToNumber(&ArgV[i + 1], TRUE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                        DumpType = (DWORD)llTemp;
+                    } else {
+                        ArgumentUnderstood = FALSE;
+                    }
+                    if (ArgumentUnderstood) {
+                        i += 1;
+                    }
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("t")) == 0) {
+                if (ArgC > i + 2) {
+                    Op = YDbgOperationProcessTreeDump;
+                    if (!YoriLibStringToNumber(&ArgV[i + 1], TRUE, &llTemp, &CharsConsumed)) {
+                        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%y is not a valid pid.\n"), &ArgV[i + 1]);
+                        return EXIT_FAILURE;
+                    }
+                    ProcessPid = (DWORD)llTemp;
+                    FileName = &ArgV[i + 2];
+                    ArgumentUnderstood = TRUE;
+                    i += 2;
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("w")) == 0) {
                 CreateNewWindow = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -1259,7 +1987,11 @@ ENTRYPOINT(
 
     ExitResult = EXIT_SUCCESS;
     if (Op == YDbgOperationProcessDump) {
-        if (!YDbgDumpProcess(ProcessPid, FileName)) {
+        if (!YDbgDumpProcess(ProcessPid, FileName, DumpType)) {
+            ExitResult = EXIT_FAILURE;
+        }
+    } else if (Op == YDbgOperationProcessTreeDump) {
+        if (!YDbgDumpProcessTree(ProcessPid, FileName, DumpType)) {
             ExitResult = EXIT_FAILURE;
         }
     } else if (Op == YDbgOperationProcessKernelStacks) {